@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Preprocessed assets on disk, keyed by a hash of everything they were made
+// from (source bytes, settings and a format version). A changed source gives
+// a new key, so entries never need invalidating, only clearing now and then.
+class AssetCache {
+public:
+    explicit AssetCache(std::string directory);
+
+    std::optional<std::vector<std::uint8_t>> Load(std::uint64_t key) const;
+    // Written to a temporary file first, readers never see half an entry.
+    // Throws std::runtime_error when the directory can't be written.
+    void Store(std::uint64_t key, const std::vector<std::uint8_t> &data) const;
+
+    const std::string &Directory() const { return m_directory; }
+    // Where the entry is or would be stored, for readers that send or map
+    // the file themselves
+    std::string PathOf(std::uint64_t key) const;
+
+private:
+
+    std::string m_directory;
+};
+
+// FNV-1a, chain calls through seed to hash several buffers
+const std::uint64_t HashSeed = 0xCBF29CE484222325ull;
+std::uint64_t HashBytes(const void *data, std::size_t size, std::uint64_t seed = HashSeed);
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "AssetCache.h"
+#include "ImageIO.h"
+
+#include <cstdint>
+#include <vector>
+
+// CPU block compression of RGBA8 images, for the offline preprocessing of
+// textures. BC1 and BC3 use a fast principal axis fit, BC7 searches harder
+// for quality over its one and two subset modes. Images of any size are
+// handled, partial blocks at the edges repeat the last row and column.
+
+enum class BlockFormat {
+    // RGB with 1 bit alpha, 8 bytes per block
+    BC1,
+    // RGB with interpolated alpha, 16 bytes per block
+    BC3,
+    // RGBA, 16 bytes per block
+    BC7,
+};
+
+std::uint32_t BlockBytes(BlockFormat format);
+const char *BlockFormatName(BlockFormat format);
+
+struct CompressedImage {
+    int width = 0;
+    int height = 0;
+    BlockFormat format = BlockFormat::BC7;
+    // Rows of blocks, tightly packed
+    std::vector<std::uint8_t> blocks;
+};
+
+// Source rows must be tightly packed. Rows of blocks are spread over the pool.
+CompressedImage CompressImage(const DecodedImage &image, BlockFormat format, ThreadPool &pool);
+DecodedImage DecompressImage(const CompressedImage &image);
+
+// Over the four channels with colors premultiplied by alpha, so those of
+// transparent texels don't count. Infinite for identical images.
+double ComputePsnr(const DecodedImage &a, const DecodedImage &b);
+// Over count channels from first, none weighted, for alpha that isn't
+// coverage: the colors and the distance of a distance field are measured
+// apart
+double ComputeChannelPsnr(const DecodedImage &a, const DecodedImage &b, int first, int count);
+
+// DDS file with a DX10 header holding a mip chain, levels in order. Decode
+// only reads the files written by Encode and throws std::runtime_error on
+// anything else.
+std::vector<std::uint8_t> EncodeDds(const std::vector<CompressedImage> &mips, bool srgb);
+std::vector<CompressedImage> DecodeDds(const std::vector<std::uint8_t> &data);
+
+// Every level of the chain compressed, from the cache when it was done
+// before. A cache that can't be written only costs the compression next time.
+std::vector<CompressedImage> CachedCompression(const AssetCache &cache,
+                                               const std::vector<DecodedImage> &mips, BlockFormat format,
+                                               ThreadPool &pool, bool *cacheHit = nullptr);
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "InputQueue.h"
+
+#include <cstdint>
+#include <vector>
+
+// Orbit camera driven by timestamped input. Input moves a goal state right
+// away, the camera follows it with critically damped smoothing integrated at
+// a fixed step, so motion is the same whatever the frame or message rate.
+// Frames sample the state interpolated between the last two steps.
+
+struct CameraState {
+    // Degrees around the up axis and above the horizon
+    float theta = 0.f;
+    float phi = -45.f;
+    // Translation of the map, the orbit is around the origin
+    float target[3] = {0.f, 0.f, 0.f};
+    // Vertical field of view in degrees
+    float fov = 45.f;
+};
+
+struct CameraSettings {
+    // Simulation step in seconds
+    double step = 1.0 / 120.0;
+    // Time for the camera to get most of the way to the goal, 0 follows
+    // input directly
+    float smoothTime = 0.06f;
+    float degreesPerPixel = 1.f;
+    float panPerPixel = 1.f;
+    // Field of view change per WHEEL_DELTA unit
+    float fovPerWheel = -1.f / 60.f;
+    float minPhi = -89.f;
+    float maxPhi = 89.f;
+    float minFov = 1.f;
+    float maxFov = 170.f;
+    // Frames further apart than this skip the simulation ahead instead of
+    // catching up step by step
+    double maxCatchUp = 0.25;
+};
+
+// Matrices of a camera, row major for row vectors like DirectXMath. The map
+// is moved by the target translation and the camera orbits the origin.
+struct CameraMatrices {
+    float view[16];
+    float projection[16];
+    // Map translation, view and projection together
+    float viewProjection[16];
+    // Camera position in map space
+    float eye[3];
+};
+
+// Same as XMMatrixLookAtLH and XMMatrixPerspectiveFovLH, so the viewer and
+// headless runs agree, with the depth range the viewer renders with
+CameraMatrices ComputeCameraMatrices(const CameraState &state, float aspect);
+
+// Time from input events to the first frame sampled after they were applied,
+// in seconds
+struct InputLatency {
+    double last = 0.0;
+    double worst = 0.0;
+    double total = 0.0;
+    std::uint32_t count = 0;
+
+    double Average() const { return count ? total / count : 0.0; }
+};
+
+class CameraController {
+public:
+    explicit CameraController(const CameraState &initial = {}, const CameraSettings &settings = {});
+
+    // Starts the simulation clock, the first Advance steps from here. The
+    // cursor is forgotten, so replays starting here move the same way.
+    void Reset(const CameraState &state, double time);
+
+    // Steps the simulation up to time. Events must be in time order and not
+    // later than time, each is applied at the step it falls in. Key events
+    // are ignored.
+    void Advance(double time, const std::vector<InputEvent> &events);
+
+    // Camera at time, which should be the last Advance time. Closes the
+    // latency measurement of the events applied since the last call.
+    CameraState Sample(double time);
+
+    // Where input has put the camera, what it is moving towards
+    const CameraState &Goal() const { return m_goal; }
+    // True once the camera has come to rest on the goal
+    bool IsSettled() const;
+    // Jumps straight to state, without smoothing
+    void Teleport(const CameraState &state);
+    // Eases the orbit onto center, in map space, with the field of view
+    // narrowed to fit a sphere of radius around it. The angles are kept.
+    void Focus(const float center[3], float radius);
+
+    const InputLatency &Latency() const { return m_latency; }
+    std::uint64_t StepCount() const { return m_steps; }
+    const CameraSettings &Settings() const { return m_settings; }
+
+private:
+    void Apply(const InputEvent &event);
+    void Step();
+
+    CameraSettings m_settings;
+    CameraState m_goal;
+    CameraState m_current;
+    CameraState m_previous;
+    // Velocity of every smoothed value, in the order of CameraState
+    float m_velocity[6] = {};
+    // Time at the end of the last step
+    double m_time = 0.0;
+    bool m_started = false;
+    std::uint64_t m_steps = 0;
+
+    // Last cursor position, moves are applied as deltas from it
+    bool m_haveCursor = false;
+    std::int16_t m_cursorX = 0;
+    std::int16_t m_cursorY = 0;
+
+    // Oldest event applied but not seen by a frame yet, negative when none
+    double m_unsampledSince = -1.0;
+    InputLatency m_latency;
+};
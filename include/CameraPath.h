@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CameraController.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scripted camera paths for repeatable performance runs. One command per
+// line, '#' starts a comment, durations are in seconds:
+//   fps 60                  frame rate of the expanded path
+//   world 3                 shows a world, 1 based like the item data
+//   camera 30 -45 45 0 0 0  jumps to theta, phi, fov and an optional target
+//   orbit 360 4             turns around the map by degrees
+//   tilt 20 1               moves the camera up by degrees
+//   zoom 20 2               changes the field of view to degrees
+//   pan 100 0 -50 2         moves the target by x, y and z
+//   wait 1                  holds still
+
+struct CameraPathFrame {
+    double time = 0.0;
+    // Index of the world shown, 0 based
+    std::uint32_t world = 0;
+    CameraState camera;
+};
+
+// The path one frame at a time, motions are linear from start to end.
+// Throws std::runtime_error naming the line of the first bad command.
+std::vector<CameraPathFrame> ParseCameraPath(const std::string &text);
+std::vector<CameraPathFrame> LoadCameraPath(const std::string &path);
@@ -30,6 +30,13 @@ public:
     virtual void OnMouseMove(short, short /*coords*/, bool, bool, bool /*LButton, RButton, CTRL*/) {}
     virtual void OnMouseWheel(short /*xDelta*/) {}
 
+    // The window needs drawing again: input, exposure or resizing.
+    virtual void OnInvalidate() {}
+    // Called when the message queue is empty. Returns how many seconds the
+    // next frame can wait, 0 draws one now. The main loop sleeps until then
+    // or until a message comes in.
+    virtual double OnIdle() { return 0.0; }
+
     // Accessors.
     UINT GetWidth() const { return m_width; }
     UINT GetHeight() const { return m_height; }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Watches the files of a single directory (not recursive). Uses inotify on
+// Linux and ReadDirectoryChangesW on Windows, both polled without blocking.
+class FileWatcher {
+public:
+    explicit FileWatcher(const std::string &directory);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // Names (relative to the directory) of the files written since the last
+    // call, without duplicates. A file is only reported once its writer
+    // closed it, a save in progress shows up in a later call.
+    std::vector<std::string> Poll();
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "AssetCache.h"
+
+#include <cstdint>
+#include <vector>
+
+struct ImFontAtlas;
+
+// Built ImGui font atlases on disk. Building rasterizes every glyph of every
+// range with stb_truetype, which gets slow with large fonts and CJK ranges.
+// A stored atlas holds the texture, the glyph tables and the custom rects,
+// loading it skips rasterizing and packing entirely.
+
+// Hash of everything a build depends on: font data, font configs, glyph
+// ranges, custom rects and atlas settings. Fonts must be added already.
+std::uint64_t FontAtlasKey(const ImFontAtlas &atlas);
+
+// The atlas must be built. Deserializing fills the fonts already added to
+// atlas, which must be the ones it was serialized with, and throws
+// std::runtime_error on damaged data.
+std::vector<std::uint8_t> SerializeFontAtlas(const ImFontAtlas &atlas);
+void DeserializeFontAtlas(const std::vector<std::uint8_t> &data, ImFontAtlas &atlas);
+
+// Builds the fonts added to atlas (the default font when there are none)
+// or loads them from cache. Returns true when the atlas came from cache.
+bool BuildFontAtlasCached(ImFontAtlas &atlas, const AssetCache &cache);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Utility.h"
+
+#include <cstdint>
+
+// Decides when the viewer draws. Frames are drawn while some source is dirty
+// and otherwise only on a slow heartbeat, so a static map costs next to
+// nothing. Sources are either marked dirty for a number of frames (a click,
+// a reload) or kept animating until cleared (a camera still moving).
+
+enum DirtySource : std::uint32_t {
+    // Exposed, resized or activated window
+    DirtyWindow = 1 << 0,
+    // Mouse and keyboard, the UI reacts to them
+    DirtyInput = 1 << 1,
+    DirtyCamera = 1 << 2,
+    // Reloaded data and uploads
+    DirtyData = 1 << 3,
+    DirtyAnimation = 1 << 4,
+};
+
+struct FrameSchedulerSettings {
+    // Seconds between frames when nothing is dirty, 0 never draws idle frames
+    double heartbeat = 1.0;
+    // CPU time a frame should fit in, frames over it are counted
+    double budget = 1.0 / 60.0;
+};
+
+struct FrameStats {
+    std::uint64_t frames = 0;
+    std::uint64_t heartbeats = 0;
+    std::uint64_t overBudget = 0;
+    // DirtySource bits behind the last frame, 0 for a heartbeat
+    std::uint32_t lastReasons = 0;
+    // From BeginFrame to EndFrame, in seconds
+    double lastFrame = 0.0;
+    double worstFrame = 0.0;
+    double totalFrame = 0.0;
+    // Time between frames, mostly waiting with nothing to draw
+    double idle = 0.0;
+
+    double AverageFrame() const { return frames ? totalFrame / frames : 0.0; }
+};
+
+class FrameScheduler {
+public:
+    explicit FrameScheduler(Clock clock = SteadyClockSeconds, const FrameSchedulerSettings &settings = {});
+
+    // Draws at least the next frames frames, UI needs a few to settle after
+    // input
+    void MarkDirty(std::uint32_t sources, std::uint32_t frames = 1);
+    // Keeps drawing every frame until cleared
+    void SetAnimating(std::uint32_t sources, bool animating);
+
+    // 0 when a frame should be drawn now, otherwise how long until the next
+    // heartbeat
+    double SecondsUntilFrame() const;
+    // Accounts for the time since the last frame as idle
+    void BeginFrame();
+    void EndFrame();
+
+    std::uint32_t DirtySources() const;
+    const FrameStats &Stats() const { return m_stats; }
+    FrameSchedulerSettings &Settings() { return m_settings; }
+
+private:
+    static const int SourceCount = 5;
+
+    Clock m_clock;
+    FrameSchedulerSettings m_settings;
+    // Frames left to draw for each source
+    std::uint32_t m_dirtyFrames[SourceCount] = {};
+    std::uint32_t m_animating = 0;
+    double m_frameStart = 0.0;
+    double m_lastFrameEnd = 0.0;
+    bool m_inFrame = false;
+    FrameStats m_stats;
+};
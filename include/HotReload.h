@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ItemData.h"
+#include "WorldMesh.h"
+
+// Diffing of reloaded data files against what the viewer currently holds, so
+// a reload only touches what changed. Nothing here depends on the renderer.
+
+struct ItemsDiff {
+    static const std::uint32_t Removed = 0xFFFFFFFF;
+
+    // For every current item, its id in the reloaded list or Removed
+    std::vector<std::uint32_t> newIds;
+    // Ids in the reloaded list of the items that did not exist before
+    std::vector<std::uint32_t> added;
+    // Worlds (1 based) with at least one added or removed item
+    std::vector<std::uint32_t> affectedWorlds;
+
+    bool Empty() const { return affectedWorlds.empty(); }
+};
+
+// Items are matched by value, an item that moved or changed type shows up as
+// one removal and one addition
+ItemsDiff DiffItems(const std::vector<ItemRecord> &current, const std::vector<ItemRecord> &reloaded);
+
+struct WorldMeshDiff {
+    // Room layout or sizes changed, the world buffers have to be recreated
+    bool rebuild = false;
+    // Otherwise, rooms whose vertices or indices changed in place
+    std::vector<std::uint32_t> dirtyRooms;
+
+    bool Empty() const { return !rebuild && dirtyRooms.empty(); }
+};
+
+WorldMeshDiff DiffWorldMesh(const WorldMesh &current, const WorldMesh &reloaded);
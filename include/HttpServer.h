@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Serves a fixed set of files over HTTP/1.1 from one thread, for remote
+// viewers of the map. Linux only: an epoll loop over non-blocking sockets,
+// bodies go out with sendfile straight from the page cache. Files are opened
+// once when added and must not change while served.
+//
+// Every response carries the file's ETag and asks clients to revalidate, a
+// matching If-None-Match gets an empty 304. Clients accepting gzip get the
+// precompressed variant when there is one.
+//
+// WebSocket endpoints keep their clients subscribed for broadcasts. A
+// broadcast is framed once and queued by reference on every client, clients
+// too far behind are dropped and start over with a fresh join.
+
+struct HttpFile {
+    std::string contentType;
+    std::string file;
+    // Empty when there is no gzip variant
+    std::string gzipFile;
+    // Unquoted, the gzip variant gets "-gz" appended
+    std::string etag;
+};
+
+// Handlers run on the server thread
+struct WebSocketEndpoint {
+    // First message to a client that joined, empty sends nothing
+    std::function<std::vector<std::uint8_t>()> onJoin;
+    // Complete text or binary messages from clients
+    std::function<void(const std::vector<std::uint8_t> &)> onMessage;
+};
+
+struct HttpServerStats {
+    std::uint64_t connections = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t notModified = 0;
+    std::uint64_t gzipped = 0;
+    // 4xx answers, bad requests close the connection after the answer
+    std::uint64_t errors = 0;
+    std::uint64_t bytesSent = 0;
+    std::uint64_t webSocketJoins = 0;
+    std::uint64_t webSocketMessages = 0;
+    std::uint64_t broadcasts = 0;
+    // Clients closed for falling too far behind a broadcast
+    std::uint64_t dropped = 0;
+};
+
+class HttpServer {
+public:
+    HttpServer();
+    ~HttpServer();
+
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+
+    // Throws std::runtime_error when a file can't be opened
+    void Add(const std::string &path, const HttpFile &file);
+    void AddWebSocket(const std::string &path, const WebSocketEndpoint &endpoint);
+    // Calls tick on the server thread every seconds while Run runs
+    void SetTick(double seconds, std::function<void()> tick);
+    // Sends message to every client joined to path. Server thread only, from
+    // a handler or the tick.
+    void Broadcast(const std::string &path, const std::vector<std::uint8_t> &message);
+
+    // Binds address ("0.0.0.0" for every interface), port 0 picks a free one.
+    // Returns the port bound, throws std::runtime_error on failure.
+    std::uint16_t Listen(const std::string &address, std::uint16_t port);
+    // Serves until Stop is called
+    void Run();
+    // Safe from other threads and signal handlers
+    void Stop();
+
+    // Only updated by Run, read it from elsewhere after Run returned
+    const HttpServerStats &Stats() const { return m_stats; }
+
+private:
+    struct Entry {
+        std::string contentType;
+        int fd = -1;
+        std::uint64_t size = 0;
+        int gzipFd = -1;
+        std::uint64_t gzipSize = 0;
+        std::string etag;
+    };
+    struct Connection;
+
+    void Accept();
+    void OnReadable(Connection &connection);
+    // Answers the complete requests in the input, stops at one that can't be
+    // sent in full yet
+    void Process(Connection &connection);
+    void Respond(Connection &connection, const std::string &request);
+    void ProcessFrames(Connection &connection);
+    void Queue(Connection &connection, std::shared_ptr<const std::string> frame);
+    // False once the socket would block
+    bool Flush(Connection &connection);
+    void WatchWrites(Connection &connection, bool write);
+    void Close(int fd);
+    // For connections that may be in use further up the stack
+    void CloseLater(int fd);
+
+    std::unordered_map<std::string, Entry> m_files;
+    std::unordered_map<std::string, WebSocketEndpoint> m_endpoints;
+    std::unordered_map<int, std::unique_ptr<Connection>> m_connections;
+    // Joined WebSocket clients of each endpoint
+    std::unordered_map<std::string, std::vector<Connection *>> m_subscribers;
+    std::vector<int> m_closing;
+    std::function<void()> m_tick;
+    int m_epoll = -1;
+    int m_listen = -1;
+    int m_wake = -1;
+    int m_timer = -1;
+    HttpServerStats m_stats;
+};
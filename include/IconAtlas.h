@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Tightly packed RGBA8 source image for one pickup type
+struct IconImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+struct AtlasUV {
+    float u0, v0;
+    float u1, v1;
+};
+
+struct IconAtlasDesc {
+    // Gutter around every icon, filled by extruding its border pixels so
+    // bilinear filtering never picks up a neighbour
+    int gutter = 2;
+    // Icon origins are aligned to this many pixels, the first log2(alignment)
+    // mips of the atlas then keep every icon in its own texel blocks
+    int alignment = 4;
+    int maxSize = 4096;
+};
+
+struct IconAtlas {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+    // Indexed by item type
+    std::vector<AtlasUV> uvs;
+};
+
+// Packs every icon in a single RGBA8 texture, atlas sizes are powers of two.
+// Throws if the icons do not fit in desc.maxSize.
+IconAtlas BuildIconAtlas(const std::vector<IconImage> &icons, const IconAtlasDesc &desc = {});
+
+// Number of mips that can be generated from the atlas without icons bleeding
+// into each other.
+int IconAtlasSafeMipCount(const IconAtlasDesc &desc);
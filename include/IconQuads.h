@@ -0,0 +1,24 @@
+#pragma once
+
+#include "IconAtlas.h"
+#include "ItemData.h"
+
+#include <cstdint>
+#include <vector>
+
+// Camera facing billboard of one item icon, two triangles laid out like
+// IconVert in overlay.hlsl
+struct IconQuad {
+    float pos[6][3];
+    float uvs[6][2];
+    // Multiplies the icon color and coverage
+    float tint[4];
+};
+
+// Quads of the given items, size wide in map units. view is row major like
+// CameraMatrices::view, item positions swap y and z like the map meshes.
+// Unknown item types use the first icon. tints holds an RGBA8 color per item
+// id, red in the low byte, icons are white without it.
+void BuildIconQuads(const std::vector<ItemRecord> &items, const std::vector<std::uint32_t> &ids,
+                    const std::vector<AtlasUV> &uvs, const float view[16], float size,
+                    std::vector<IconQuad> &quads, const std::uint32_t *tints = nullptr);
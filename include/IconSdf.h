@@ -0,0 +1,41 @@
+#pragma once
+
+#include "IconAtlas.h"
+#include "ThreadPool.h"
+
+#include <cstdint>
+#include <vector>
+
+// Signed distance field versions of the icons. The silhouette distance goes
+// in alpha, 0.5 on the edge and rising inside, and the colors keep the source
+// pixels, spread outwards from the silhouette so filtering never picks up
+// the transparent texels around it. Edges stay sharp at any icon size.
+
+struct SdfDesc {
+    // Output texels per source pixel
+    int scale = 4;
+    // Distances are resolved at scale * supersample texels per source pixel
+    // and averaged down
+    int supersample = 4;
+    // Distance in output texels from the edge to alpha 0 or 1
+    float spread = 4.f;
+    // Source alpha at and above which a pixel is inside
+    std::uint8_t threshold = 128;
+};
+
+// Squared euclidean distance of every cell to the nearest cell set in mask,
+// exact (Felzenszwalb and Huttenlocher). nearest gets the index of that cell
+// when given, -1 and a huge distance when mask is empty.
+void SquaredDistanceTransform(const std::vector<std::uint8_t> &mask, int width, int height,
+                              std::vector<float> &distances, std::vector<std::int32_t> *nearest = nullptr);
+
+// Output is scale times the source size
+IconImage GenerateIconSdf(const IconImage &icon, const SdfDesc &desc = {});
+
+// One field per icon, icons are spread over the pool
+std::vector<IconImage> GenerateIconSdfs(const std::vector<IconImage> &icons, const SdfDesc &desc,
+                                        ThreadPool &pool);
+
+// CPU reference of the overlay pixel shader: the field drawn at the given
+// size with bilinear sampling, coverage ramps over one output pixel
+IconImage RenderIconSdf(const IconImage &sdf, int width, int height);
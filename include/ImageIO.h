@@ -24,16 +24,39 @@
 #define ANTERU_D3D12_SAMPLE_IMAGEIO_H_
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
+class ThreadPool;
+
 #ifdef LoadImage
 #undef LoadImage
 #endif
 
+// PNG files go through the built-in decoder on every platform, other formats
+// need WIC and are only supported on Windows. Rows are padded to a multiple of
+// rowAlignment pixels, throws std::runtime_error when the image can't be read.
 std::vector<std::uint8_t> LoadImageFromFile(const char *path, const int rowAlignment, int *width,
                                             int *height);
 
 std::vector<std::uint8_t> LoadImageFromMemory(const void *data, const std::size_t size,
                                               const int rowAlignment, int *width, int *height);
 
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint8_t> pixels;
+};
+
+// Reads and decodes all files at once on the pool, results are in the order
+// of paths. Rethrows the first failure once every file was tried.
+std::vector<DecodedImage> LoadImagesFromFiles(const std::vector<std::string> &paths, const int rowAlignment,
+                                              ThreadPool &pool);
+
+#ifdef _WIN32
+// Always decodes through WIC, whatever the format
+std::vector<std::uint8_t> LoadImageFromMemoryWic(const void *data, const std::size_t size,
+                                                 const int rowAlignment, int *width, int *height);
+#endif
+
 #endif
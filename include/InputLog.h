@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CameraController.h"
+#include "InputQueue.h"
+#include "ItemQuery.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recorded viewer sessions. A log holds the state the viewer was in when
+// recording started and the input that followed, replaying it through the
+// fixed step camera gives the same camera path on every run and build.
+
+// UI state a recording starts from
+struct ViewerSnapshot {
+    // Index of the world shown, 0 based
+    std::uint32_t world = 1;
+    float iconSize = 15.f;
+    ItemFilter filter{{true, true}, 0, 99, false};
+    bool portalCulling = true;
+    CameraState camera;
+};
+
+struct InputLog {
+    ViewerSnapshot snapshot;
+    // Times in seconds from the start of the recording, in order
+    std::vector<InputEvent> events;
+};
+
+class InputRecorder {
+public:
+    void Start(const ViewerSnapshot &snapshot, double time);
+    // Events drained from the input queue, stamped with the same clock
+    void Record(const std::vector<InputEvent> &events);
+    InputLog Stop();
+
+    bool IsRecording() const { return m_recording; }
+    size_t EventCount() const { return m_log.events.size(); }
+
+private:
+    InputLog m_log;
+    double m_start = 0.0;
+    bool m_recording = false;
+};
+
+// Queues the events of a log as if they came in from start on
+void QueueReplay(const InputLog &log, double start, InputQueue &queue);
+
+// "MPIR" files: times are varint microsecond deltas and cursor positions
+// zigzag deltas, a few bytes per event. Times come back rounded to the
+// microsecond. Deserializing throws std::runtime_error on damaged data.
+std::vector<std::uint8_t> SerializeInputLog(const InputLog &log);
+InputLog DeserializeInputLog(const std::vector<std::uint8_t> &data);
+void SaveInputLog(const std::string &path, const InputLog &log);
+InputLog LoadInputLog(const std::string &path);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Utility.h"
+
+#include <cstdint>
+#include <vector>
+
+// Platform neutral input, stamped when it arrives so it can be applied at
+// the time it happened rather than whenever the next frame runs.
+
+enum class InputEventType : std::uint8_t {
+    MouseMove,
+    MouseWheel,
+    KeyDown,
+};
+
+struct InputEvent {
+    InputEventType type = InputEventType::MouseMove;
+    double time = 0.0;
+    // MouseMove: cursor position in client pixels and the buttons held
+    std::int16_t x = 0;
+    std::int16_t y = 0;
+    bool left = false;
+    bool right = false;
+    bool ctrl = false;
+    // MouseWheel: in WHEEL_DELTA units, 120 per notch
+    std::int16_t wheel = 0;
+    // KeyDown: virtual key code
+    std::uint8_t key = 0;
+};
+
+// Events in arrival order, filled by the window messages and drained once a
+// frame. Only used from the thread running the message loop.
+class InputQueue {
+public:
+    explicit InputQueue(Clock clock = SteadyClockSeconds);
+
+    double Now() const { return m_clock(); }
+
+    void PushMouseMove(std::int16_t x, std::int16_t y, bool left, bool right, bool ctrl);
+    void PushMouseWheel(std::int16_t wheel);
+    void PushKeyDown(std::uint8_t key);
+    // Keeps the time of the event, for replays
+    void Push(const InputEvent &event);
+
+    // Removes and returns the events up to time, oldest first
+    std::vector<InputEvent> Drain(double time);
+    bool Empty() const { return m_events.empty(); }
+
+private:
+    Clock m_clock;
+    std::vector<InputEvent> m_events;
+};
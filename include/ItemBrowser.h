@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ItemData.h"
+#include "ItemQuery.h"
+
+#include <cstdint>
+#include <vector>
+
+// Table of every item for the ImGui UI. Only the rows on screen are built
+// each frame, the filtered and sorted row order is cached and recomputed
+// when the data, the filters or the sort columns change.
+
+enum ItemColumn : std::uint32_t {
+    ItemColumn_Type,
+    ItemColumn_World,
+    ItemColumn_Room,
+    ItemColumn_X,
+    ItemColumn_Y,
+    ItemColumn_Z,
+    ItemColumn_Collected,
+    ItemColumnCount
+};
+
+struct ItemSortKey {
+    ItemColumn column;
+    bool descending;
+};
+
+// Orders ids by the keys in turn, then by id so the order is the same on
+// every run
+void SortItemIds(const std::vector<ItemRecord> &items, const ItemIndex &index,
+                 const std::vector<ItemSortKey> &keys, std::vector<std::uint32_t> &ids);
+
+struct ItemBrowserStats {
+    std::uint32_t rows = 0;
+    // Filtering and sorting, only when the row order was rebuilt
+    double rebuildMs = 0.0;
+    std::uint64_t rebuilds = 0;
+    // Building the table this frame
+    double drawUs = 0.0;
+};
+
+class ItemBrowser {
+public:
+    // Items were reloaded or collected outside the browser
+    void Invalidate() { m_rowsDirty = true; }
+    // Brings a row to the top of the table on the next Draw
+    void ScrollToRow(std::uint32_t row) { m_scrollRow = (int)row; }
+    // Same for the row of an item, if the filters show it
+    void ScrollToItem(std::uint32_t id) { m_scrollItem = (std::int64_t)id; }
+
+    // Draws the table in the current window, height in pixels. Collected
+    // check boxes write to index, returns true when one was changed.
+    bool Draw(const std::vector<ItemRecord> &items, ItemIndex &index, float height);
+
+    const ItemBrowserStats &Stats() const { return m_stats; }
+
+private:
+    void RebuildRows(const std::vector<ItemRecord> &items, const ItemIndex &index);
+    bool DependsOnCollected() const;
+
+    // Filters, -1 and world 0 show everything
+    int m_type = -1;
+    int m_world = 0;
+    // 0 all, 1 collected only, 2 missing only
+    int m_collected = 0;
+
+    std::vector<ItemSortKey> m_sortKeys;
+    // Item ids in display order
+    std::vector<std::uint32_t> m_rows;
+    bool m_rowsDirty = true;
+    int m_scrollRow = -1;
+    std::int64_t m_scrollItem = -1;
+    // Measured by the clipper, 0 until a row was drawn
+    float m_rowHeight = 0.f;
+    ItemBrowserStats m_stats;
+};
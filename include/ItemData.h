@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum ItemType : std::uint8_t {
+    ItemType_EnergyTank = 0,
+    ItemType_Missile = 1,
+    ItemTypeCount
+};
+
+// One line of data/items.data, "type:world:room:x, y, z"
+// Positions are kept as written in the file, the viewer swaps y and z
+struct ItemRecord {
+    std::uint8_t type;
+    std::uint32_t worldIndex; // 1 based, as in the data file
+    std::uint32_t roomIndex;
+    float x, y, z;
+};
+
+std::vector<ItemRecord> ParseItemsData(const std::string &text);
+std::vector<ItemRecord> LoadItemsData(const char *path);
+
+const char *ItemTypeName(std::uint8_t type);
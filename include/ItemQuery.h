@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ItemData.h"
+#include "RoaringBitmap.h"
+
+#include <memory>
+#include <unordered_map>
+
+// Bitmap indexes over a list of items, item ids are indices in that list
+class ItemIndex {
+public:
+    void Build(const std::vector<ItemRecord> &items);
+
+    std::uint32_t Size() const { return m_size; }
+    RoaringBitmap All() const { return RoaringBitmap::Range(0, m_size); }
+
+    const RoaringBitmap &Type(std::uint8_t type) const;
+    const RoaringBitmap &World(std::uint32_t worldIndex) const;
+    const RoaringBitmap &Room(std::uint32_t worldIndex, std::uint32_t roomIndex) const;
+    // Rooms [firstRoom, lastRoom] of a world
+    RoaringBitmap Rooms(std::uint32_t worldIndex, std::uint32_t firstRoom, std::uint32_t lastRoom) const;
+
+    void SetCollected(std::uint32_t id, bool collected);
+    bool IsCollected(std::uint32_t id) const { return (m_collected[id >> 6] >> (id & 63)) & 1; }
+    void ClearCollected();
+    RoaringBitmap Collected() const;
+
+private:
+    static std::uint64_t RoomKey(std::uint32_t worldIndex, std::uint32_t roomIndex) {
+        return ((std::uint64_t)worldIndex << 32) | roomIndex;
+    }
+
+    std::uint32_t m_size = 0;
+    std::vector<RoaringBitmap> m_types;
+    std::unordered_map<std::uint32_t, RoaringBitmap> m_worlds;
+    std::unordered_map<std::uint64_t, RoaringBitmap> m_rooms;
+    // Collected flags change one at a time, a plain bitset is cheaper to
+    // update than a compressed one
+    std::vector<std::uint64_t> m_collected;
+};
+
+// Composable predicate over indexed items, evaluates to the matching ids
+//   auto q = ItemQuery::Type(ItemType_Missile) & ItemQuery::Rooms(3, 10, 30) & !ItemQuery::Collected();
+class ItemQuery {
+public:
+    static ItemQuery All();
+    static ItemQuery Type(std::uint8_t type);
+    static ItemQuery World(std::uint32_t worldIndex);
+    static ItemQuery Rooms(std::uint32_t worldIndex, std::uint32_t firstRoom, std::uint32_t lastRoom);
+    static ItemQuery Collected();
+
+    ItemQuery operator&(const ItemQuery &other) const;
+    ItemQuery operator|(const ItemQuery &other) const;
+    ItemQuery operator!() const;
+
+    RoaringBitmap Evaluate(const ItemIndex &index) const;
+
+private:
+    enum class Op { All, Type, World, Rooms, Collected, And, Or, Not };
+
+    struct Node {
+        Op op;
+        std::uint32_t args[3]{};
+        std::shared_ptr<const Node> lhs, rhs;
+    };
+
+    explicit ItemQuery(std::shared_ptr<const Node> node) : m_node(std::move(node)) {}
+
+    static RoaringBitmap Evaluate(const Node &node, const ItemIndex &index);
+
+    std::shared_ptr<const Node> m_node;
+};
+
+// Filters of the viewer UI over the items of one world
+struct ItemFilter {
+    bool types[ItemTypeCount];
+    int firstRoom;
+    int lastRoom;
+    bool hideCollected;
+};
+
+// Ids of the items of worldIndex passing filter, in increasing order
+std::vector<std::uint32_t> ApplyItemFilter(const ItemIndex &index, const ItemFilter &filter,
+                                           std::uint32_t worldIndex);
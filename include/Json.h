@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// JSON parsed in place. A first pass finds every structural character and
+// the start of every string and scalar 64 bytes at a time (SSE2 where there
+// is, bit tricks for strings and escapes), a second walks just those into a
+// flat list of nodes. Strings are unescaped inside the text they came in and
+// nodes point there, so a document is the text plus 16 bytes per value, and
+// a document reused for the next text allocates nothing once warm.
+
+enum class JsonType : std::uint8_t {
+    Null,
+    False,
+    True,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+struct JsonNode {
+    JsonType type;
+    // Strings: the unescaped text, numbers: as written
+    std::uint32_t start;
+    std::uint32_t length;
+    // The node after this one and everything inside it
+    std::uint32_t end;
+};
+
+class JsonDocument {
+public:
+    static constexpr std::uint32_t None = 0xFFFFFFFF;
+
+    // text has to stay alive and untouched while the document is used, its
+    // strings are rewritten unescaped. Throws std::runtime_error with the
+    // byte offset on anything that isn't JSON.
+    void Parse(std::string &text);
+
+    // Node 0 is the root value
+    const JsonNode &operator[](std::uint32_t index) const { return m_nodes[index]; }
+    std::uint32_t Size() const { return (std::uint32_t)m_nodes.size(); }
+    std::string_view Text(std::uint32_t index) const {
+        return {m_text + m_nodes[index].start, m_nodes[index].length};
+    }
+    // 0 for anything that isn't a number
+    double Number(std::uint32_t index) const;
+
+    // Value of key in an object, None when it isn't an object or has no key
+    std::uint32_t Find(std::uint32_t object, std::string_view key) const;
+
+    template <typename F> void ForEachElement(std::uint32_t array, F f) const {
+        if (m_nodes[array].type != JsonType::Array) {
+            return;
+        }
+        for (std::uint32_t i = array + 1; i < m_nodes[array].end; i = m_nodes[i].end) {
+            f(i);
+        }
+    }
+
+    // f(key, value), keys are string nodes
+    template <typename F> void ForEachMember(std::uint32_t object, F f) const {
+        if (m_nodes[object].type != JsonType::Object) {
+            return;
+        }
+        for (std::uint32_t key = object + 1; key < m_nodes[object].end; key = m_nodes[key + 1].end) {
+            f(key, key + 1);
+        }
+    }
+
+private:
+    void FindStructurals(const char *text, std::size_t size);
+    std::uint32_t String(std::uint32_t offset);
+    void Scalar(std::uint32_t offset, std::size_t size);
+
+    char *m_text = nullptr;
+    std::vector<std::uint32_t> m_structurals;
+    std::vector<JsonNode> m_nodes;
+    std::vector<std::uint32_t> m_open;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ItemData.h"
+#include "Json.h"
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Randomizer layouts (spoiler logs) turned into item records. A layout says
+// which pickup lies at every location, the locations the viewer knows are the
+// records of items.data. Accepted shapes, the first game of a multiworld
+// log is used:
+//   {"game_modifications": [{"locations": {...}}]} or {"locations": {...}}
+// with locations either nested by region or flat:
+//   {"Chozo Ruins": {"Main Plaza/Half-Pipe": "Missile Expansion", ...}, ...}
+//   {"Chozo Ruins/Main Plaza/Half-Pipe": "Missile Expansion", ...}
+// Regions and rooms match the world names and the OBJ room names, ignoring
+// case, spaces and punctuation. The n-th location a layout names in a room
+// is the n-th record of that room in items.data.
+
+// Name randomizers give a world, worldIndex 1 based
+const char *LayoutRegionName(std::uint32_t worldIndex);
+// Item type of a pickup name, -1 for the pickups the viewer has no icon for
+int PickupItemType(std::string_view pickup);
+
+struct LayoutItems {
+    // Energy tanks and missiles at known locations, in items.data order
+    std::vector<ItemRecord> items;
+    std::uint32_t locations = 0;
+    // Locations of a region or room the viewer doesn't know, or past the
+    // records of their room
+    std::uint32_t unknownLocations = 0;
+    // Pickups without an item type, upgrades, artifacts and the like
+    std::uint32_t otherPickups = 0;
+};
+
+// Where a layout puts its pickups
+struct LayoutPlacement {
+    // The pickup at every record of items.data, empty where the layout names
+    // none. Views into the layout text.
+    std::vector<std::string_view> pickups;
+    std::uint32_t locations = 0;
+    std::uint32_t unknownLocations = 0;
+    // The pickups at those
+    std::vector<std::string_view> elsewhere;
+    // Records of every room taken so far
+    std::vector<std::uint32_t> used;
+};
+
+class LayoutImporter {
+public:
+    explicit LayoutImporter(const std::vector<ItemRecord> &locations);
+
+    // Room names of a world, 1 based like items.data
+    void AddWorld(std::uint32_t worldIndex, const WorldMesh &mesh);
+
+    // json is unescaped in place and document reused, both belong to the
+    // calling thread. Throws std::runtime_error when it isn't JSON or has no
+    // locations.
+    LayoutItems Import(std::string &json, JsonDocument &document) const;
+    // Same for every pickup, placement is reused
+    void Place(std::string &json, JsonDocument &document, LayoutPlacement &placement) const;
+
+private:
+    void AddLocation(std::uint32_t worldIndex, std::string_view location, std::string_view pickup,
+                     LayoutPlacement &placement) const;
+
+    std::vector<ItemRecord> m_locations;
+    // World index by the hash of the normalized region name
+    std::unordered_map<std::uint64_t, std::uint32_t> m_worlds;
+    // Slot in m_roomLocations by the hash of the normalized room name, seeded
+    // with the world index
+    std::unordered_map<std::uint64_t, std::uint32_t> m_rooms;
+    // Records of every room in file order
+    std::vector<std::vector<std::uint32_t>> m_roomLocations;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AssetCache.h"
+#include "ItemData.h"
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compact binary forms of the map for remote viewers, little endian and laid
+// out so a browser can hand them to the GPU without unpacking.
+
+// "MPWG": a 44 byte header (magic, version, vertex count, index count, index
+// size, bounds min and max), then 8 bytes per vertex: x, y and z quantized
+// to 16 bits inside the bounds and the octahedral normal in two signed bytes.
+// Indices follow, 16 bit when the vertices allow it and counted from the
+// first vertex of the file rather than the room, padded to 4 bytes.
+std::vector<std::uint8_t> EncodeWorldGeometry(const WorldMesh &mesh);
+// Vertices dequantized, room list empty. Throws std::runtime_error on damaged
+// data.
+WorldMesh DecodeWorldGeometry(const std::vector<std::uint8_t> &data);
+
+// "MPRL": magic, version, room count, then per room its index, vertex and
+// index ranges, bounds and name (a length byte and up to 255 bytes)
+std::vector<std::uint8_t> EncodeRoomList(const WorldMesh &mesh);
+
+// "MPIM": magic, version, item count, then per item of the world its type, a
+// pad byte, room index (16 bit) and position in map space (y and z swapped)
+std::vector<std::uint8_t> EncodeItemMarkers(const std::vector<ItemRecord> &items, std::uint32_t worldIndex);
+
+// One converted file, ready to be sent as is
+struct MapFile {
+    // "/world/<1-7>/geometry", "/progressive", "/rooms" or "/items"
+    std::string path;
+    std::string file;
+    // Same content gzip compressed, empty when it isn't worth it or the tools
+    // were built without zlib
+    std::string gzipFile;
+    // Cache key of the content, changes with the source and the format
+    std::uint64_t key;
+};
+
+// Converts the worlds and items of dataDirectory into cache, files already
+// converted from the same sources are reused. Throws std::runtime_error when
+// a source can't be read or the cache written.
+std::vector<MapFile> PrepareMapFiles(const std::string &dataDirectory, const AssetCache &cache);
@@ -11,10 +11,31 @@
 
 #pragma once
 
+#include "AssetCache.h"
+#include "CameraController.h"
 #include "DXSample.h"
+#include "FileWatcher.h"
+#include "FrameScheduler.h"
+#include "IconAtlas.h"
+#include "IconQuads.h"
+#include "InputLog.h"
+#include "InputQueue.h"
+#include "ItemBrowser.h"
+#include "ItemQuery.h"
+#include "NameSearch.h"
+#include "NavMesh.h"
+#include "Portals.h"
+#include "Reachability.h"
+#include "RoomGraph.h"
+#include "SeedStats.h"
+#include "ThreadPool.h"
+#include "TourSolver.h"
+#include "WorldMesh.h"
 #include <DirectXMath.h>
 
 #include <array>
+#include <chrono>
+#include <memory>
 
 using namespace DirectX;
 
@@ -37,6 +58,8 @@ public:
     virtual void OnKeyDown(UINT8 key) override;
     virtual void OnMouseMove(short x, short y, bool LButton, bool RButton, bool ctrl) override;
     virtual void OnMouseWheel(short z) override;
+    virtual void OnInvalidate() override;
+    virtual double OnIdle() override;
 
 private:
     // In this sample we overload the meaning of FrameCount to mean both the
@@ -60,11 +83,6 @@ private:
         XMFLOAT4 normal;
     };
 
-    struct IconGeometry {
-        XMFLOAT3 pos[6];
-        XMFLOAT2 uvs[6];
-    };
-
     struct Draws {
         std::vector<size_t> indexStarts;
         std::vector<size_t> vertexStarts;
@@ -72,9 +90,25 @@ private:
         size_t drawCount;
     };
 
-    struct IconDraw {
-        size_t instanceCount;
-        size_t instanceStart;
+    struct WorldBuffers {
+        ComPtr<ID3D12Resource> vertexBuffer;
+        D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+        ComPtr<ID3D12Resource> indexBuffer;
+        D3D12_INDEX_BUFFER_VIEW indexBufferView;
+    };
+
+    // World buffers to (re)upload at the start of the next frame
+    struct PendingUpload {
+        UINT world;
+        bool rebuild;
+        std::vector<std::uint32_t> rooms;
+    };
+
+    struct CullBenchmark {
+        std::uint32_t views;
+        float averageUs;
+        float worstUs;
+        float averageRooms;
     };
 
     struct ConstantBuffer {
@@ -82,13 +116,6 @@ private:
         XMMATRIX world;
     };
 
-    struct ItemMetadata {
-        unsigned char type;
-        UINT worldIndex;
-        UINT roomIndex;
-        XMVECTOR position;
-    };
-
     // Pipeline objects.
     CD3DX12_VIEWPORT m_viewport;
     CD3DX12_RECT m_scissorRect;
@@ -120,19 +147,18 @@ private:
     UINT m_srvDescriptorSize;
 
     // App resources.
-    ComPtr<ID3D12Resource> m_uploadBuffer;
-    ComPtr<ID3D12Resource> m_vertexBuffer;
-    D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
-    ComPtr<ID3D12Resource> m_indexBuffer;
-    D3D12_INDEX_BUFFER_VIEW m_indexBufferView;
+    // Staging buffers of the last world uploads, kept alive until the GPU is done with them
+    std::vector<ComPtr<ID3D12Resource>> m_uploadBuffers;
+    std::array<WorldBuffers, WorldCount> m_worldBuffers;
 
     ComPtr<ID3D12Resource> m_constBuffer;
 
-    ComPtr<ID3D12Resource> m_imgUploadBuffer[2];
-    ComPtr<ID3D12Resource> m_img[2];
+    // Staging buffer holding every subresource of the icon atlas
+    ComPtr<ID3D12Resource> m_iconAtlasUpload;
+    ComPtr<ID3D12Resource> m_iconAtlas;
 
     ComPtr<ID3D12Resource> m_iconVertices;
-    ComPtr<ID3D12Resource> m_iconTypes;
+    size_t m_iconCapacity = 0;
 
     // Synchronization objects.
     UINT m_frameIndex;
@@ -145,28 +171,147 @@ private:
     UINT m_height = 0;
     UINT m_mapIndex = 1;
 
-    UINT m_mx = 0;
-    UINT m_my = 0;
-    float m_orbTheta = 0.f;
-    float m_orbPhi = -45.f;
-    float m_orbRad = 600.f;
-    float m_tx = 0.f;
-    float m_ty = 0.f;
-    float m_tz = 0.f;
+    // Window input is queued with timestamps and applied to the camera at
+    // the start of the next frame
+    InputQueue m_input;
+    CameraController m_cameraController;
+    // Camera of the current frame
+    CameraState m_camera;
+
+    // Recorded sessions, live input is dropped while one is replayed
+    InputRecorder m_recorder;
+    bool m_replaying = false;
+    double m_replayEnd = 0.0;
+    std::string m_replayStatus = "none";
+
+    // Frames are only drawn when something changed, or on a slow heartbeat
+    FrameScheduler m_scheduler;
+    bool m_alwaysRedraw = false;
 
-    float m_fov = 45.0;
     float m_iconSize = 15.0;
+    // Last model view projection, for things drawn through ImGui
+    XMFLOAT4X4 m_mvp{};
+
+    // CPU side asset work, image decoding
+    ThreadPool m_threadPool;
+    // Preprocessed assets (icon mips), rebuilt when missing
+    AssetCache m_assetCache{"cache"};
 
     // UI Values
     bool m_uiOpen = true;
-
+    ItemFilter m_itemFilter{{true, true}, 0, 99, false};
+    float m_filterTimeUs = 0.f;
+    // Table of every item, sorted and filtered apart from the map icons
+    ItemBrowser m_itemBrowser;
+    // Rooms of every world and the items by name, a hit moves the camera to
+    // it. Targets are in entry order, NoTarget where it isn't a room or item.
+    struct SearchTarget {
+        UINT world;
+        std::uint32_t room;
+        std::uint32_t item;
+    };
+    static constexpr std::uint32_t NoTarget = 0xFFFFFFFF;
+    NameSearch m_nameSearch;
+    std::vector<SearchTarget> m_searchTargets;
+    char m_searchText[NameSearch::MaxQueryLength + 1] = {};
+    std::vector<NameHit> m_searchHits;
+    float m_searchTimeUs = 0.f;
+
+    // Hot reload of the data folder
+    std::unique_ptr<FileWatcher> m_dataWatcher;
+    std::vector<PendingUpload> m_pendingUploads;
+    std::chrono::steady_clock::time_point m_reloadStart;
+    bool m_reloadInFlight = false;
+    float m_reloadLatencyMs = 0.f;
+    std::string m_reloadStatus = "none";
+
+    // Rooms drawn this frame, from the portals seen by the camera
+    std::array<std::vector<Portal>, WorldCount> m_worldPortals;
+    std::array<PortalCuller, WorldCount> m_portalCullers;
+    bool m_portalCulling = true;
+    std::vector<std::uint32_t> m_visibleRooms;
+    PortalCullStats m_cullStats;
+    float m_cullTimeUs = 0.f;
+    CullBenchmark m_cullBenchmark{};
+
+    // Collection route over the items passing the filters
+    RoomGraph m_roomGraph;
+    TourOptions m_routeOptions;
+    bool m_routeAllWorlds = false;
+    std::vector<std::uint32_t> m_route;
+    float m_routeLength = 0.f;
+    float m_routeTimeMs = 0.f;
+
+    // Walked path between two items of a world, over navigation meshes built
+    // the first time a world is measured
+    std::array<NavMesh, WorldCount> m_navMeshes;
+    std::array<bool, WorldCount> m_navMeshBuilt{};
+    std::array<float, WorldCount> m_navBuildMs{};
+    std::uint32_t m_measureFrom = NoTarget;
+    std::uint32_t m_measureTo = NoTarget;
+    UINT m_measureWorld = 0;
+    // Measured since the items were picked, found or not
+    bool m_measured = false;
+    bool m_measureFound = false;
+    NavPath m_measurePath;
+    float m_measureStraight = 0.f;
+    // How far the items were moved onto the floors
+    float m_measureMoved[2] = {};
+    float m_measureUs = 0.f;
+
+    // What the runner can get to with the collected items and the upgrades
+    // set in the UI, icons out of reach are dimmed
+    Reachability m_reachability;
+    bool m_dimUnreachable = true;
+    std::vector<std::uint32_t> m_iconTints;
+    float m_reachTimeUs = 0.f;
+    // Layout statistics from MP-MapTools seed-stats, empty when they were
+    // made for other items. Icons can be colored by them.
+    SeedStats m_seedStats;
+    int m_heatmap = 0;
+
+    std::array<WorldMesh, WorldCount> m_worldMeshes;
     std::array<Draws, WorldCount> m_worldDraws;
-    std::array<std::vector<ItemMetadata>, WorldCount> m_worldItems;
-    std::array<IconDraw, WorldCount> m_iconDraws;
+    std::vector<ItemRecord> m_items;
+    ItemIndex m_itemIndex;
+    // Items passing the current filter, in the order icons are written
+    std::vector<std::uint32_t> m_visibleItems;
+    std::vector<AtlasUV> m_iconUVs;
+    std::vector<IconQuad> m_iconQuads;
 
     void LoadPipeline();
     void LoadAssets();
     void PopulateCommandList();
     void MoveToNextFrame();
     void WaitForGpu();
+    void UpdateItemFilter();
+    void HandleKey(UINT8 key);
+    ViewerSnapshot TakeSnapshot() const;
+    void ApplySnapshot(const ViewerSnapshot &snapshot);
+    void StartRecording();
+    void StopRecording();
+    void StartReplay();
+    void BuildPortals(UINT world);
+    void CullRooms(const CameraMatrices &matrices);
+    void BenchmarkCulling();
+    void BuildRoomGraph();
+    void PlanRoute();
+    void DrawRoute();
+    void MeasurePath();
+    void DrawMeasure();
+    void BuildReachability();
+    void UpdateInventory();
+    void UpdateIconTints();
+    void LoadSeedStats();
+    void BuildNameSearch();
+    void SearchNames();
+    void JumpTo(const SearchTarget &target);
+
+    void CreateWorldBuffers(UINT world);
+    void PatchWorldRooms(UINT world, const std::vector<std::uint32_t> &rooms);
+    void CreateIconVertices(size_t capacity);
+    void PollHotReload();
+    std::vector<ItemRecord> LoadItems();
+    bool ReloadItems();
+    bool ReloadWorld(UINT world);
 };
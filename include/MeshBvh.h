@@ -0,0 +1,68 @@
+#pragma once
+
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+// Bounding volume hierarchy over the triangles of a world, for closest point
+// queries in the world mesh space. Built with binned SAH splits, nodes hold
+// their children next to each other and leaves copies of their triangles so
+// a query doesn't go through the index buffer. Zero area triangles are left
+// out, their edges belong to the triangles around them.
+
+struct SurfaceHit {
+    float position[3];
+    // Unit normal of the triangle, as wound
+    float normal[3];
+    float distance;
+    // Index of the first of its indices in WorldMesh::indices, divided by 3
+    std::uint32_t triangle;
+    // Index in WorldMesh::rooms
+    std::uint32_t room;
+};
+
+class MeshBvh {
+public:
+    static constexpr std::uint32_t LeafSize = 4;
+    // Deeper nodes become leaves whatever their size, bounds the query stack
+    static constexpr std::uint32_t MaxDepth = 48;
+
+    void Build(const WorldMesh &mesh);
+
+    // Closest point on any triangle, false when none is within maxDistance.
+    // Thread safe, the hierarchy is only read.
+    bool Closest(const float point[3], float maxDistance, SurfaceHit &hit) const;
+    // Same over every triangle one by one, to check Closest against
+    bool ClosestBruteForce(const float point[3], float maxDistance, SurfaceHit &hit) const;
+
+    std::uint32_t TriangleCount() const { return (std::uint32_t)m_triangles.size(); }
+    std::uint32_t NodeCount() const { return (std::uint32_t)m_nodes.size(); }
+    std::uint32_t Depth() const { return m_depth; }
+    size_t MemoryBytes() const;
+
+private:
+    struct Node {
+        float boundsMin[3];
+        // First triangle of a leaf, first of the two children otherwise
+        std::uint32_t first;
+        float boundsMax[3];
+        // Triangles of a leaf, 0 for inner nodes
+        std::uint32_t count;
+    };
+
+    struct Triangle {
+        float a[3];
+        float b[3];
+        float c[3];
+        std::uint32_t triangle;
+        std::uint32_t room;
+    };
+
+    static void Fill(const Triangle &triangle, const float position[3], float distanceSquared,
+                     SurfaceHit &hit);
+
+    std::vector<Node> m_nodes;
+    std::vector<Triangle> m_triangles;
+    std::uint32_t m_depth = 0;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "AssetCache.h"
+#include "ImageIO.h"
+
+#include <cstdint>
+#include <vector>
+
+// Mip chains for RGBA8 images. Filtering happens in linear space on
+// premultiplied alpha, so colors don't darken and transparent texels don't
+// bleed their color into visible ones. Alpha that isn't coverage, like the
+// distance of a distance field, is filtered apart from the colors instead.
+// Every level is computed from the float result of the previous one, not from
+// its 8 bit version.
+
+enum class MipFilter {
+    // Average of the parent texels covered, a 2x2 block for even sizes
+    Box,
+    // Kaiser windowed sinc reaching 4 parent texels on each side, sharper
+    // than Box but reads across block boundaries
+    Kaiser,
+};
+
+struct MipDesc {
+    MipFilter filter = MipFilter::Kaiser;
+    // Levels in the chain including the source, 0 for a full chain down to 1x1
+    int levelCount = 0;
+    // Color channels are sRGB encoded, alpha is always linear
+    bool srgb = true;
+    // Colors are weighted by alpha, off when alpha isn't coverage
+    bool premultiply = true;
+};
+
+int FullMipCount(int width, int height);
+
+// Level 0 is a copy of the source, all levels are tightly packed. Levels
+// halve in size, rounding down, like D3D12 mips.
+std::vector<DecodedImage> GenerateMipChain(const DecodedImage &image, const MipDesc &desc = {});
+
+// One chain per image, images are spread over the pool
+std::vector<std::vector<DecodedImage>> GenerateMipChains(const std::vector<DecodedImage> &images,
+                                                         const MipDesc &desc, ThreadPool &pool);
+
+// Flat form of a chain for the asset cache, Deserialize throws
+// std::runtime_error on data it did not write
+std::vector<std::uint8_t> SerializeMipChain(const std::vector<DecodedImage> &chain);
+std::vector<DecodedImage> DeserializeMipChain(const std::vector<std::uint8_t> &data);
+
+// Chain from the cache when the same image and settings were seen before,
+// generated and stored otherwise. A cache that can't be written only costs
+// the generation next time.
+std::vector<DecodedImage> CachedMipChain(const AssetCache &cache, const DecodedImage &image,
+                                         const MipDesc &desc = {}, bool *cacheHit = nullptr);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Typo tolerant search over room and item names. Names are normalized to
+// lower case words of letters and digits and interned, the same name added
+// twice is stored once. Every word is cut in trigrams padded like "  ab",
+// "abc", "bc " and the index lists the names holding each trigram. A query
+// scores the names sharing enough of its trigrams: half of the share of the
+// query they hold plus half of the share of the name the query covers.
+//
+// Candidates come from the rarest query trigram lists only, the common lists
+// are just checked against them, so frequent trigrams don't cost a scan. How
+// many are taken and checked is capped, so a query costs about the same on a
+// million names, at the price of now and then missing a name with a typo.
+
+struct NameHit {
+    std::uint32_t entry;
+    float score;
+};
+
+class NameSearch {
+public:
+    // Share of the query trigrams a name has to hold to be a hit, and how
+    // many it may miss at most, a typo costs up to four
+    static constexpr float MinShared = 0.3f;
+    static constexpr std::uint32_t MaxMissing = 8;
+    // Longer queries are cut
+    static constexpr std::uint32_t MaxQueryLength = 64;
+    // Names taken from the rare trigram lists at most, and the ones of them
+    // counted on the common lists, bounding the work of a query whatever the
+    // index size
+    static constexpr std::uint32_t MaxCandidates = 4096;
+    static constexpr std::uint32_t MaxCounted = 256;
+
+    // "00_Exterior_Docking-Hangar" to "00 exterior docking hangar"
+    static std::string Normalize(std::string_view name);
+
+    // Entries are numbered in the order they are added. Search needs a
+    // Build after the last Add.
+    std::uint32_t Add(std::string_view name);
+    void Build();
+    void Clear();
+
+    std::uint32_t EntryCount() const { return (std::uint32_t)m_entryName.size(); }
+    // Distinct names after normalizing
+    std::uint32_t NameCount() const { return (std::uint32_t)m_names.size(); }
+    std::string_view Name(std::uint32_t entry) const;
+    size_t MemoryBytes() const;
+
+    // Best first, at most maxHits, ties in entry order. Reuses scratch, one
+    // search at a time.
+    void Search(std::string_view query, std::uint32_t maxHits, std::vector<NameHit> &hits);
+
+private:
+    struct Span {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+    // Query trigrams a name was found with so far, next to its own count
+    // (capped), so a candidate is one memory access
+    struct Tally {
+        std::uint8_t shared = 0;
+        std::uint8_t trigrams = 0;
+    };
+
+    std::uint32_t Intern(const std::string &normalized);
+
+    // Normalized names back to back
+    std::string m_pool;
+    std::vector<Span> m_names;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_nameOf;
+    std::vector<std::uint32_t> m_entryName;
+
+    // Names by trigram and entries by name, ascending
+    std::vector<std::uint32_t> m_postingStart;
+    std::vector<std::uint32_t> m_postings;
+    std::vector<Tally> m_tally;
+    std::vector<std::uint32_t> m_entryStart;
+    std::vector<std::uint32_t> m_entries;
+
+    std::vector<std::uint32_t> m_query;
+    std::vector<std::uint32_t> m_candidates;
+    std::vector<float> m_bounds;
+    std::vector<NameHit> m_scored;
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Portals.h"
+#include "WorldMesh.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Walkable surface of a world as convex polygons, for path lengths between
+// items that follow the floors instead of cutting through them. Built the way
+// Recast does: triangles are voxelized into spans of solid space per column,
+// the tops of spans with a walkable slope and enough head room become floor,
+// floor is eroded by the agent radius and split into monotone regions, whose
+// outlines are simplified, triangulated and merged into polygons.
+//
+// The world is cut into square tiles built independently on the thread pool,
+// each voxelizing a border of its neighbors so erosion agrees on both sides.
+// Polygons meeting on a tile edge are linked where their edges overlap.
+//
+// Rooms are closed shells, so the walls both close a door with are left out
+// and the gap between the shells is floored for the floors on either side to
+// meet. Floors a step apart at most are walked between, higher ledges get one
+// way links from the edge above or below them like Unity's generated
+// off-mesh links. The map geometry has no platforms or lifts, so what is left
+// apart in a room is linked where it comes closest, and rooms at their doors,
+// as long as the link stays short. Paths tell how much of them is such links.
+// Positions are in the world mesh space, y up.
+
+struct NavMeshConfig {
+    // Voxel size across and up
+    float cellSize = 0.5f;
+    float cellHeight = 0.25f;
+    // Head room the agent needs, the step it can climb and its radius
+    float agentHeight = 2.f;
+    float agentClimb = 1.f;
+    float agentRadius = 0.5f;
+    // Steepest walkable slope, in degrees
+    float maxSlope = 50.f;
+    // Tile side in cells
+    std::uint32_t tileSize = 64;
+    // How far a simplified outline may stray from the voxels, in world units
+    float maxEdgeError = 1.3f;
+    // Connected floor of fewer cells is dropped, unless it reaches a tile edge
+    std::uint32_t minRegionCells = 16;
+    // Walls within this distance of a door's bounds are left out
+    float doorTolerance = 0.1f;
+    // Ledges the agent jumps up or drops down from, across a gap of at most
+    // jumpDistance
+    float jumpHeight = 4.f;
+    float dropHeight = 16.f;
+    float jumpDistance = 2.f;
+    // Link floor of a room the mesh has no way to, and rooms at their doors,
+    // across no more than maxRoomLink and up no more than maxRoomLift the
+    // way a lift would
+    bool linkRooms = true;
+    float maxRoomLink = 16.f;
+    float maxRoomLift = 64.f;
+};
+
+struct NavMeshStats {
+    std::uint32_t tiles = 0;
+    // Tiles holding polygons
+    std::uint32_t usedTiles = 0;
+    // Floor cells left after erosion
+    std::uint64_t floorCells = 0;
+    std::uint32_t regions = 0;
+    std::uint32_t polygons = 0;
+    std::uint32_t vertices = 0;
+    std::uint32_t links = 0;
+    std::uint32_t tileLinks = 0;
+    // Wall triangles left out of doors
+    std::uint32_t doorTriangles = 0;
+    // Doors floored across where the rooms' shells leave a gap
+    std::uint32_t doorBridges = 0;
+    std::uint32_t ledgeLinks = 0;
+    // Pairs of links joining floor within a room or across a door
+    std::uint32_t roomLinks = 0;
+    // Outlines that could not be triangulated completely
+    std::uint32_t failedOutlines = 0;
+};
+
+class NavMesh {
+public:
+    static constexpr std::uint32_t MaxVertices = 6;
+    static constexpr std::uint32_t NoPolygon = 0xFFFFFFFF;
+
+    struct Polygon {
+        std::uint32_t vertices[MaxVertices];
+        std::uint32_t vertexCount;
+        std::uint32_t firstLink;
+        std::uint32_t linkCount;
+        float center[3];
+    };
+
+    // Where a polygon can be left for another, a part of one of its edges, or
+    // a point on one for ledges and room links (a and b are then the same)
+    struct Link {
+        std::uint32_t polygon;
+        float a[3];
+        float b[3];
+        // Room links only, how far it is to the other polygon with no floor
+        // between
+        float gap = 0.f;
+    };
+
+    // doors as ExtractPortals finds them. pool may be null, tiles are then
+    // built one after the other.
+    void Build(const WorldMesh &mesh, const std::vector<Portal> &doors, const NavMeshConfig &config = {},
+               ThreadPool *pool = nullptr);
+
+    // Polygon closest to point with its closest position on it, searching the
+    // box of half size extents around point. NoPolygon when none is there.
+    std::uint32_t FindPolygon(const float point[3], const float extents[3], float nearest[3]) const;
+    // The same, doubling the box until a polygon is in it. NoPolygon only
+    // when the mesh is empty.
+    std::uint32_t FindNearestPolygon(const float point[3], const float extents[3], float nearest[3]) const;
+
+    const std::vector<Polygon> &Polygons() const { return m_polygons; }
+    const std::vector<Link> &Links() const { return m_links; }
+    const float *Vertex(std::uint32_t index) const { return &m_vertices[index * 3]; }
+    const NavMeshConfig &Config() const { return m_config; }
+    const NavMeshStats &Stats() const { return m_stats; }
+    size_t MemoryBytes() const;
+
+private:
+    void ClosestOnPolygon(const Polygon &polygon, const float point[3], float closest[3]) const;
+    // Polygon within extents of probe whose height differs from edge the
+    // least, past a step and within a jump up or a drop down
+    std::uint32_t FindLedge(const float probe[3], const float extents[3], const float edge[3]) const;
+
+    NavMeshConfig m_config;
+    NavMeshStats m_stats;
+    float m_origin[3] = {};
+    std::uint32_t m_tilesX = 0;
+    std::uint32_t m_tilesZ = 0;
+    // Polygons of a tile are m_tileStart[tile] up to m_tileStart[tile + 1]
+    std::vector<std::uint32_t> m_tileStart;
+    std::vector<float> m_vertices;
+    std::vector<Polygon> m_polygons;
+    std::vector<Link> m_links;
+};
+
+struct NavPath {
+    // Corners of the shortest path with the points where it crosses from
+    // polygon to polygon, from start to end on the mesh
+    std::vector<std::array<float, 3>> points;
+    std::vector<std::uint32_t> polygons;
+    float length = 0.f;
+    // Of length, what is crossed on room links rather than walked on floor
+    float linkLength = 0.f;
+};
+
+// A* over the polygons of a mesh and the funnel over the portals of the
+// result. Keeps scratch between queries, one per thread.
+class NavQuery {
+public:
+    explicit NavQuery(const NavMesh &mesh);
+
+    // Start and end are moved to the closest polygon in the box of half size
+    // extents around them, or the nearest one past it. False when the mesh
+    // is empty or the end can't be walked to.
+    bool FindPath(const float start[3], const float end[3], const float extents[3], NavPath &path);
+    // Polygons taken off the open list by the last FindPath
+    std::uint32_t NodesVisited() const { return m_visited; }
+
+private:
+    struct Node {
+        float cost;
+        float total;
+        float position[3];
+        std::uint32_t parent;
+        std::uint32_t stamp;
+        bool closed;
+    };
+
+    void Funnel(const float start[3], const float end[3], NavPath &path);
+
+    const NavMesh &m_mesh;
+    std::vector<Node> m_nodes;
+    std::uint32_t m_stamp = 0;
+    std::uint32_t m_visited = 0;
+    std::vector<std::pair<float, std::uint32_t>> m_open;
+    std::vector<std::array<float, 3>> m_left;
+    std::vector<std::array<float, 3>> m_right;
+};
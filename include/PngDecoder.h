@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Built-in PNG decoder used by ImageIO on every platform. Handles every
+// color type and bit depth of the format, including palettes, transparency
+// chunks and Adam7 interlacing. Output is always 8 bit RGBA.
+
+bool IsPng(const void *data, std::size_t size);
+
+// Decodes straight into an RGBA buffer whose rows are padded to a multiple of
+// rowAlignment pixels, throws std::runtime_error on malformed files. Images
+// are at most 16384 pixels wide and high, and chunk CRCs are checked except
+// on the image data.
+std::vector<std::uint8_t> DecodePng(const void *data, std::size_t size, int rowAlignment, int *width,
+                                    int *height);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+// Doors between the rooms of a world, and the per frame room visibility they
+// give. Matrices are row major and transform row vectors (v * M) like
+// DirectXMath does, so an XMFLOAT4X4 can be passed as is.
+
+struct Portal {
+    // Indices in WorldMesh::rooms, roomA < roomB
+    std::uint32_t roomA;
+    std::uint32_t roomB;
+    // Bounds of the vertices where both rooms touch
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+struct PortalDesc {
+    // Vertices of two rooms closer than this are considered to touch
+    float tolerance = 2.f;
+    // Touching vertices needed before two rooms get a portal, a single one is
+    // usually two corners meeting rather than a door
+    std::uint32_t minVertices = 2;
+};
+
+std::vector<Portal> ExtractPortals(const WorldMesh &mesh, const PortalDesc &desc = {});
+
+struct PortalCullStats {
+    // Room the camera is in, -1 when outside every room (rooms are then only
+    // frustum culled)
+    int cameraRoom = -1;
+    std::uint32_t portalsTested = 0;
+    std::uint32_t roomsVisible = 0;
+};
+
+class PortalCuller {
+public:
+    void Build(const WorldMesh &mesh, std::vector<Portal> portals);
+
+    // Rooms seen from eye (in the world mesh space) through the portals,
+    // sorted by index
+    void Cull(const float *viewProjection, const float *eye, std::vector<std::uint32_t> &visibleRooms,
+              PortalCullStats *stats = nullptr);
+
+    std::uint32_t RoomCount() const { return (std::uint32_t)m_rooms.size(); }
+    const std::vector<Portal> &Portals() const { return m_portals; }
+
+private:
+    struct Rect {
+        float x0, y0, x1, y1;
+    };
+
+    struct Room {
+        float boundsMin[3];
+        float boundsMax[3];
+        std::vector<std::uint32_t> portals;
+    };
+
+    int FindRoom(const float *eye) const;
+    void Visit(std::uint32_t room, const Rect &rect, std::uint32_t depth);
+
+    std::vector<Room> m_rooms;
+    std::vector<Portal> m_portals;
+
+    // Traversal state
+    const float *m_viewProjection = nullptr;
+    std::vector<bool> m_onPath;
+    std::vector<bool> m_visible;
+    std::uint32_t m_portalsTested = 0;
+};
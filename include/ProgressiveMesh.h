@@ -0,0 +1,80 @@
+#pragma once
+
+#include "WorldMesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Progressive world geometry: a coarse base mesh, then vertex splits that add
+// the detail back one vertex at a time, the splits removing the most error
+// first. Any prefix of the stream past the base is a drawable mesh, the
+// whole stream is the world again.
+//
+// The worlds are flat shaded, so only positions travel and normals come from
+// the faces. Vertices are welded by their 16 bit quantized position, faces
+// that collapse under the quantization are dropped.
+//
+// "MPPM", little endian: a 52 byte header (magic, version, base vertex and
+// face count, split count, final vertex and face count, bounds min and max),
+// the base vertices as three 16 bit coordinates, the base faces as three
+// varint vertex ids each, then per split:
+//   varint u, the vertex it splits
+//   the new vertex as three zigzag varints, its offset from u
+//   varint count of the faces it adds
+//   a bit per face of u (in the decoder's order), set when it moves to the
+//   new vertex, in (face count of u + 7) / 8 bytes
+//   per added face varint (w << 1 | order), the face being (u, new, w), or
+//   (u, w, new) when order is set
+// Vertices and faces are numbered in the order they appear.
+
+// Builds the stream. splitErrors, when given, receives the error every split
+// removes: the root of its quadric error, roughly world units with open
+// edges weighing more.
+std::vector<std::uint8_t> EncodeProgressiveMesh(const WorldMesh &mesh,
+                                                std::vector<float> *splitErrors = nullptr);
+
+// Refines as the stream comes in: positions only grow and faces keep their
+// slot, so a renderer can upload the new vertices and the changed faces.
+class ProgressiveMeshDecoder {
+public:
+    // Takes the next bytes of the stream and applies the base and every split
+    // they complete, returns the number of splits applied. Throws
+    // std::runtime_error on damaged data.
+    std::size_t Feed(const std::uint8_t *data, std::size_t size);
+
+    bool HasBase() const { return m_hasBase; }
+    bool Complete() const { return m_hasBase && m_splitsApplied == m_splitCount; }
+    std::uint32_t SplitsApplied() const { return m_splitsApplied; }
+    std::uint32_t SplitCount() const { return m_splitCount; }
+    std::uint32_t VertexCount() const { return (std::uint32_t)m_positions.size() / 3; }
+    std::uint32_t FaceCount() const { return (std::uint32_t)m_faces.size() / 3; }
+
+    // Three per vertex, in world units
+    const std::vector<float> &Positions() const { return m_positions; }
+    // Three vertex ids per face
+    const std::vector<std::uint32_t> &Faces() const { return m_faces; }
+    // The current level flat shaded, three vertices per face, no rooms
+    WorldMesh Mesh() const;
+
+private:
+    bool ReadHeader(const std::uint8_t *data, std::size_t size, std::size_t &used);
+    bool ReadBase(const std::uint8_t *data, std::size_t size, std::size_t &used);
+    bool ReadSplit(const std::uint8_t *data, std::size_t size, std::size_t &used);
+
+    std::vector<std::uint8_t> m_pending;
+    bool m_hasHeader = false;
+    bool m_hasBase = false;
+    std::uint32_t m_baseVertices = 0;
+    std::uint32_t m_baseFaces = 0;
+    std::uint32_t m_splitCount = 0;
+    std::uint32_t m_splitsApplied = 0;
+    std::uint32_t m_finalVertices = 0;
+    std::uint32_t m_finalFaces = 0;
+    float m_boundsMin[3] = {};
+    float m_boundsMax[3] = {};
+    std::vector<std::uint16_t> m_quantized;
+    std::vector<float> m_positions;
+    std::vector<std::uint32_t> m_faces;
+    std::vector<std::vector<std::uint32_t>> m_facesOf;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "ItemData.h"
+#include "RoomGraph.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Rooms and item locations the runner can get to with what they have. Links,
+// rooms and locations carry requirements over the inventory, one per line of
+// a logic file, rooms written as world:room like items.data:
+//   start 4:00                      the room the runner starts in
+//   4:16 - 7:00: Artifact 12        the link, both ways
+//   2:05 > 2:06: Morph Ball         the link from 2:05 to 2:06 only
+//   3:10: Varia Suit | Energy Tank 3   entering the room
+//   2:05.1: Boost Ball              the first item of the room
+// Requirements are item names with an optional count (1 by default) joined
+// with & and |, grouped with parentheses, so names can't end in a number. Anything after a # is a comment,
+// a second line for the same thing has to pass as well.
+//
+// Every (item, count) the logic names is a condition bit and requirements
+// compile to a list of condition sets, one of which has to be held. Gaining
+// an item only retests the links and locations watching the conditions it
+// newly meets, from rooms already reached.
+class Reachability {
+public:
+    static constexpr std::uint32_t MaxConditions = 128;
+    static constexpr std::uint32_t NoNode = 0xFFFFFFFF;
+
+    // Rooms and links of the graph, every item a location in its room. Drops
+    // the logic and the inventory.
+    void Build(const RoomGraph &graph, const std::vector<ItemRecord> &items);
+    // Throws std::runtime_error on a line it can't read or that names a room
+    // or link the graph doesn't have, the lines before it stay applied
+    void ApplyLogic(const std::string &text);
+    void LoadLogic(const char *path);
+
+    // Items the logic names, in the order it names them
+    std::uint32_t KindCount() const { return (std::uint32_t)m_kinds.size(); }
+    const std::string &KindName(std::uint32_t kind) const { return m_kinds[kind].name; }
+    // Highest count the logic asks for
+    std::uint32_t KindMaximum(std::uint32_t kind) const { return m_kinds[kind].maximum; }
+    // -1 when the logic never names it
+    int Kind(std::string_view name) const;
+
+    std::uint32_t Count(std::uint32_t kind) const { return m_kinds[kind].count; }
+    // Solves from the frontier when the inventory only gains conditions, from
+    // the start room otherwise
+    void SetCount(std::uint32_t kind, std::uint32_t count);
+    // Nothing held, solved from the start room
+    void ClearInventory();
+    // From the start room
+    void Solve();
+
+    bool RoomReachable(std::uint32_t node) const { return m_roomReachable[node]; }
+    bool LocationReachable(std::uint32_t id) const { return m_locationReachable[id]; }
+    std::uint32_t ReachableRooms() const { return m_reachableRooms; }
+    std::uint32_t ReachableLocations() const { return m_reachableLocations; }
+    std::uint32_t RoomCount() const { return (std::uint32_t)m_roomReachable.size(); }
+    std::uint32_t LocationCount() const { return (std::uint32_t)m_locationReachable.size(); }
+    // Requirements tested by the last update
+    std::uint32_t LastTests() const { return m_tests; }
+
+private:
+    struct Conditions {
+        std::uint64_t bits[MaxConditions / 64] = {};
+    };
+    // Clauses [first, first + count) of m_clauses, any one has to be held
+    struct Requirement {
+        std::uint32_t first = 0;
+        std::uint32_t count = 1;
+    };
+    struct ItemKind {
+        std::string name;
+        std::uint32_t count = 0;
+        std::uint32_t maximum = 0;
+        // (count, condition bit), ascending
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> thresholds;
+    };
+    // Kinds are looked up by the names in layouts without a copy
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+    struct Edge {
+        std::uint32_t from;
+        std::uint32_t to;
+        Requirement requirement;
+    };
+
+    std::vector<Conditions> ParseRequirement(std::string_view text);
+    std::vector<Conditions> ParseOr(std::string_view &text);
+    std::vector<Conditions> ParseAnd(std::string_view &text);
+    std::vector<Conditions> ParseAtom(std::string_view &text);
+    std::uint32_t Condition(std::string_view name, std::uint32_t count);
+    Requirement Store(const std::vector<Conditions> &clauses);
+    std::vector<Conditions> Load(Requirement requirement) const;
+    void Restrict(Requirement &requirement, const std::vector<Conditions> &clauses);
+    std::uint32_t Node(std::uint32_t worldIndex, int roomIndex) const;
+    std::uint32_t FindEdge(std::uint32_t from, std::uint32_t to) const;
+
+    void Compile();
+    bool Passes(Requirement requirement);
+    void Reach(std::uint32_t node);
+    void Propagate();
+
+    std::vector<ItemKind> m_kinds;
+    std::unordered_map<std::string, std::uint32_t, NameHash, std::equal_to<>> m_kindOf;
+    std::uint32_t m_conditionCount = 0;
+    Conditions m_held;
+
+    std::vector<Conditions> m_clauses;
+    std::vector<RoomNode> m_nodes;
+    std::uint32_t m_start = 0;
+    // Directed, both ways of every link, grouped by the room they leave
+    std::vector<Edge> m_edges;
+    std::vector<std::uint32_t> m_edgeStart;
+    std::vector<Requirement> m_roomRequirements;
+    // Items by room, in id order
+    std::vector<std::uint32_t> m_locationNode;
+    std::vector<Requirement> m_locationRequirements;
+    std::vector<std::uint32_t> m_locationStart;
+    std::vector<std::uint32_t> m_locations;
+
+    // Links (entering their room included) and locations by the conditions
+    // they name, locations are marked with the top bit
+    bool m_compiled = false;
+    std::vector<Requirement> m_edgeTests;
+    std::vector<std::uint32_t> m_watchStart;
+    std::vector<std::uint32_t> m_watchers;
+
+    std::vector<std::uint8_t> m_roomReachable;
+    std::vector<std::uint8_t> m_locationReachable;
+    std::uint32_t m_reachableRooms = 0;
+    std::uint32_t m_reachableLocations = 0;
+    std::vector<std::uint32_t> m_worklist;
+    std::uint32_t m_tests = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+// Compressed bitmap of 32 bit values following the Roaring layout: values are
+// split in chunks of 2^16 by their high bits, each chunk is stored either as a
+// sorted array of low bits (sparse) or as a 8KB bitset (dense).
+class RoaringBitmap {
+public:
+    // Values must be added in increasing order to take the fast path
+    void Add(std::uint32_t value);
+    bool Contains(std::uint32_t value) const;
+    std::size_t Cardinality() const;
+    bool Empty() const { return m_containers.empty(); }
+
+    // Every value in [begin, end)
+    static RoaringBitmap Range(std::uint32_t begin, std::uint32_t end);
+    // Bit i of words[i / 64] set means value i is in the set
+    static RoaringBitmap FromWords(const std::uint64_t *words, std::size_t wordCount);
+
+    static RoaringBitmap And(const RoaringBitmap &a, const RoaringBitmap &b);
+    static RoaringBitmap Or(const RoaringBitmap &a, const RoaringBitmap &b);
+    static RoaringBitmap AndNot(const RoaringBitmap &a, const RoaringBitmap &b);
+    // Union of many sets in a single pass, much cheaper than chaining Or
+    static RoaringBitmap OrMany(const std::vector<const RoaringBitmap *> &sets);
+
+    template <typename F> void ForEach(F &&f) const {
+        for (const Container &c : m_containers) {
+            const std::uint32_t high = (std::uint32_t)c.key << 16;
+            if (c.IsBitmap()) {
+                for (std::uint32_t w = 0; w < BitmapWords; w++) {
+                    std::uint64_t word = c.bits[w];
+                    while (word) {
+                        f(high | (w * 64 + std::countr_zero(word)));
+                        word &= word - 1;
+                    }
+                }
+            } else {
+                for (std::uint16_t low : c.array) {
+                    f(high | low);
+                }
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> ToVector() const;
+
+private:
+    static const std::uint32_t BitmapWords = 1024;
+    // Above this many values a bitmap container is smaller than an array one
+    static const std::uint32_t ArrayMaxSize = 4096;
+
+    struct Container {
+        std::uint16_t key = 0;
+        std::uint32_t cardinality = 0;
+        std::vector<std::uint16_t> array;
+        std::vector<std::uint64_t> bits;
+
+        bool IsBitmap() const { return !bits.empty(); }
+        bool Contains(std::uint16_t low) const;
+        void Add(std::uint16_t low);
+        void ToBitmap();
+        // Picks the cheapest representation once cardinality is known
+        void Optimize();
+    };
+
+    static Container AndContainers(const Container &a, const Container &b);
+    static Container OrContainers(const Container &a, const Container &b);
+    static Container AndNotContainers(const Container &a, const Container &b);
+
+    std::vector<Container> m_containers; // Sorted by key
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Portals.h"
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Rooms of every world as nodes of one graph. Rooms of a world are linked
+// through their portals, links between worlds (elevators, the crater) come
+// from a manual overrides file.
+
+struct RoomNode {
+    std::uint32_t worldIndex; // 1 based, like items.data
+    int roomIndex;
+    // Center of the room bounds, in the viewer space of its world
+    float center[3];
+};
+
+struct RoomLink {
+    std::uint32_t a;
+    std::uint32_t b;
+    float cost;
+};
+
+class RoomGraph {
+public:
+    static constexpr float Unreachable = 1e30f;
+
+    void AddWorld(std::uint32_t worldIndex, const WorldMesh &mesh, const std::vector<Portal> &portals);
+
+    // One override per line, rooms written as world:room like items.data
+    //   + 2:00 4:14 [cost]   adds a link, cost defaults to the distance between
+    //                        the room centers, 0 between worlds
+    //   - 2:01 2:02          removes a detected link
+    // Anything after a # is a comment
+    void ApplyOverrides(const std::string &text);
+    void LoadOverrides(const char *path);
+
+    // All pairs shortest paths, needed by Distance and Path
+    void ComputeShortestPaths();
+
+    // Node id of a room, -1 if it is not in the graph
+    int Node(std::uint32_t worldIndex, int roomIndex) const;
+    float Distance(std::uint32_t a, std::uint32_t b) const { return m_distances[a * m_nodes.size() + b]; }
+    // Nodes from a to b included, empty when b cannot be reached
+    std::vector<std::uint32_t> Path(std::uint32_t a, std::uint32_t b) const;
+
+    const std::vector<RoomNode> &Nodes() const { return m_nodes; }
+    const std::vector<RoomLink> &Links() const { return m_links; }
+
+private:
+    void Link(std::uint32_t a, std::uint32_t b, float cost);
+    void Unlink(std::uint32_t a, std::uint32_t b);
+
+    std::vector<RoomNode> m_nodes;
+    std::vector<RoomLink> m_links;
+    std::vector<float> m_distances;
+    // Next node on the shortest path, row major like m_distances
+    std::vector<std::uint32_t> m_next;
+};
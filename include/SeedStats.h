@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ItemData.h"
+#include "Json.h"
+#include "LayoutImport.h"
+#include "Reachability.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Statistics of many randomizer layouts over the item locations of
+// items.data, for tuning seed generation. Sphere 0 is what can be reached
+// with nothing, sphere n + 1 what the pickups of the spheres up to n open,
+// a layout's depth is its number of spheres. Pickups at locations outside
+// items.data count as held from the start, the viewer can't place them.
+
+enum PickupClass : std::uint8_t {
+    PickupClass_EnergyTank,
+    PickupClass_Missile,
+    PickupClass_Artifact,
+    PickupClass_Upgrade,
+    PickupClass_Nothing,
+    PickupClassCount
+};
+
+const char *PickupClassName(std::uint8_t pickupClass);
+
+// "MPSS", little endian: magic, version, seed count, location count, sphere
+// bucket count, pickup class count, then every count below as 32 bits
+struct SeedStats {
+    // Deeper spheres count in the last bucket, locations never reached in
+    // the one after it
+    static constexpr std::uint32_t SphereBuckets = 16;
+    static constexpr std::uint32_t Never = SphereBuckets;
+
+    explicit SeedStats(std::uint32_t locationCount = 0);
+
+    std::uint32_t LocationCount() const { return m_locationCount; }
+    void Add(const SeedStats &other);
+    bool operator==(const SeedStats &other) const = default;
+
+    // Mean sphere where the location was reached, -1 when it never was
+    float AverageSphere(std::uint32_t id) const;
+    // Share of the layouts putting an artifact or an upgrade there
+    float MajorShare(std::uint32_t id) const;
+
+    std::vector<std::uint8_t> Encode() const;
+    // Throws std::runtime_error on damaged data
+    static SeedStats Decode(const std::vector<std::uint8_t> &data);
+
+    // One row per location, and per room of items.data
+    std::string LocationsCsv(const std::vector<ItemRecord> &items) const;
+    std::string RoomsCsv(const std::vector<ItemRecord> &items) const;
+
+    std::uint32_t seeds = 0;
+    // SphereBuckets + 1 counts per location
+    std::vector<std::uint32_t> spheres;
+    // PickupClassCount counts per location
+    std::vector<std::uint32_t> pickups;
+    // Layouts by depth, bucketed like spheres
+    std::vector<std::uint32_t> depths;
+
+private:
+    std::uint32_t m_locationCount = 0;
+};
+
+// Works through layouts one after the other, one analyzer per thread
+class SeedAnalyzer {
+public:
+    // logic is built over the items of importer and has its logic applied
+    SeedAnalyzer(const LayoutImporter &importer, const Reachability &logic);
+
+    // Adds a layout to stats and returns its depth. json is unescaped in
+    // place. Throws std::runtime_error when it isn't a layout.
+    std::uint32_t Analyze(std::string &json, SeedStats &stats);
+
+private:
+    const LayoutImporter &m_importer;
+    Reachability m_solver;
+    JsonDocument m_document;
+    LayoutPlacement m_placement;
+    std::vector<std::uint32_t> m_sphere;
+    std::vector<std::uint32_t> m_opened;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for the CPU heavy parts of asset loading. The
+// thread calling ParallelFor works on the loop too, so a pool with no worker
+// runs everything inline and nested loops can't deadlock. Every thread starts
+// on its own share of the indices and steals half of another's remaining
+// share once done, so uneven tasks and late workers don't hold a loop up.
+class ThreadPool {
+public:
+    // 0 picks one thread per hardware thread, the caller included
+    explicit ThreadPool(std::uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads working on a loop, the caller included
+    std::uint32_t ThreadCount() const { return (std::uint32_t)m_workers.size() + 1; }
+
+    // Runs task(i) for every i in [0, count) and returns once all are done.
+    // The first exception thrown by a task is rethrown here, after the other
+    // indices ran.
+    void ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)> &task);
+    // task(i, slot), no two tasks run at once with the same slot, slots are
+    // below ThreadCount(). For per thread scratch and partial results.
+    void ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t, std::uint32_t)> &task);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::function<void()>> m_queue;
+    bool m_stop = false;
+};
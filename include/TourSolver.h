@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ItemData.h"
+#include "RoomGraph.h"
+
+#include <cstdint>
+#include <vector>
+
+// Orders a set of stops so the path visiting all of them is short. Stops are
+// given as a symmetric cost matrix, the path is open (it does not come back to
+// its first stop).
+
+struct TourOptions {
+    // Independent nearest neighbour starts, each improved with 2-opt and Or-opt
+    std::uint32_t restarts = 16;
+    // 0 uses one thread per hardware thread
+    std::uint32_t threads = 0;
+    std::uint32_t seed = 1;
+    // Stop the path has to start from, -1 to leave both ends free
+    int start = -1;
+};
+
+struct Tour {
+    // Stops in visiting order
+    std::vector<std::uint32_t> order;
+    float length = 0.f;
+};
+
+// costs is row major, count * count
+Tour SolveTour(const std::vector<float> &costs, std::uint32_t count, const TourOptions &options = {});
+
+// Travel costs between items for SolveTour. Items in the same room are joined
+// by a straight line, otherwise the path goes to the room center, through the
+// room graph and on to the other item.
+std::vector<float> ItemTravelCosts(const RoomGraph &graph, const std::vector<ItemRecord> &items,
+                                   const std::vector<std::uint32_t> &ids);
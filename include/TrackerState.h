@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ItemData.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Collected items shared by every viewer of a race. The server side holds
+// the state and turns what changed during a frame into one delta, mirrors
+// rebuild the same state from a snapshot and the deltas after it.
+//
+// Messages are binary, all numbers varints:
+//   'S' snapshot: version, item count, collected bitset ((count + 7) / 8
+//       bytes), world count, then collected and total per world
+//   'D' delta: version, change count, per change (id gap << 1 | collected)
+//       with ids ascending, then the changed worlds and their new collected
+//       count
+//   'T' toggles, from clients: count, per toggle (id << 1 | collected)
+
+struct WorldProgress {
+    std::uint32_t collected = 0;
+    std::uint32_t total = 0;
+};
+
+class TrackerState {
+public:
+    explicit TrackerState(const std::vector<ItemRecord> &items);
+
+    // Out of range ids are ignored. The change is held until TakeDelta, a
+    // change undone before it never goes out.
+    void Set(std::uint32_t id, bool collected);
+    // Applies a 'T' message, false when it is damaged (nothing is applied)
+    bool ApplyToggles(const std::uint8_t *data, std::size_t size);
+    bool HasPendingChanges() const { return !m_touched.empty(); }
+
+    // The changes since the last delta as a 'D' message, empty when there is
+    // no net change. Bumps the version otherwise.
+    std::vector<std::uint8_t> TakeDelta();
+    // The state as of the last delta, what a joining client starts from
+    std::vector<std::uint8_t> Snapshot() const;
+
+    std::uint32_t Version() const { return m_version; }
+    std::uint32_t ItemCount() const { return (std::uint32_t)m_worldOf.size(); }
+    // As of the last delta, index is the 1 based world minus one
+    const std::vector<WorldProgress> &Progress() const { return m_progress; }
+    bool IsCollected(std::uint32_t id) const { return (m_published[id >> 6] >> (id & 63)) & 1; }
+
+private:
+    std::vector<std::uint32_t> m_worldOf;
+    std::vector<std::uint64_t> m_current;
+    std::vector<std::uint64_t> m_published;
+    // Ids set since the last delta, each once
+    std::vector<std::uint32_t> m_touched;
+    std::vector<std::uint64_t> m_touchedBits;
+    std::vector<WorldProgress> m_progress;
+    std::uint32_t m_version = 0;
+};
+
+// Client side copy of a TrackerState, fed with the messages it broadcasts
+class TrackerMirror {
+public:
+    // Throws std::runtime_error on damaged messages and on a delta that
+    // doesn't follow the current version
+    void Apply(const std::uint8_t *data, std::size_t size);
+
+    bool Joined() const { return m_joined; }
+    std::uint32_t Version() const { return m_version; }
+    std::uint32_t ItemCount() const { return m_count; }
+    bool IsCollected(std::uint32_t id) const { return (m_collected[id >> 6] >> (id & 63)) & 1; }
+    const std::vector<WorldProgress> &Progress() const { return m_progress; }
+
+private:
+    bool m_joined = false;
+    std::uint32_t m_version = 0;
+    std::uint32_t m_count = 0;
+    std::vector<std::uint64_t> m_collected;
+    std::vector<WorldProgress> m_progress;
+};
+
+// A 'T' message
+std::vector<std::uint8_t> EncodeTrackerToggles(const std::vector<std::pair<std::uint32_t, bool>> &toggles);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Places the subresources of any number of textures in one staging buffer,
+// following the D3D12 copy rules, so a whole batch goes up with one upload
+// allocation and one CopyTextureRegion per subresource. Kept free of D3D12
+// types so the layout can be checked on any platform.
+
+struct SubresourceDesc {
+    std::uint32_t width;
+    std::uint32_t height;
+    // Block compressed formats use 4, rows are then rows of blocks
+    std::uint32_t blockSize = 1;
+    // Bytes per pixel, or per block when blockSize > 1
+    std::uint32_t bytesPerBlock = 4;
+};
+
+struct UploadPlanDesc {
+    // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+    std::uint32_t rowPitchAlignment = 256;
+    // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+    std::uint32_t placementAlignment = 512;
+};
+
+// Matches the fields of D3D12_PLACED_SUBRESOURCE_FOOTPRINT
+struct SubresourceFootprint {
+    std::uint64_t offset;
+    std::uint32_t rowPitch;
+    // Bytes of each row actually holding data
+    std::uint32_t rowBytes;
+    std::uint32_t rowCount;
+};
+
+struct UploadPlan {
+    std::vector<SubresourceFootprint> footprints;
+    std::uint64_t totalSize = 0;
+};
+
+UploadPlan PlanUpload(const std::vector<SubresourceDesc> &subresources, const UploadPlanDesc &desc = {});
+
+// Copies the rows of one subresource to its place in the mapped staging
+// buffer, sourceRowPitch can be larger than the row size
+void CopyToStaging(const SubresourceFootprint &footprint, const void *source, std::uint64_t sourceRowPitch,
+                   void *staging);
@@ -24,6 +24,7 @@
 #define ANTERU_D3D12_SAMPLE_UTILITY_H_
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -33,4 +34,8 @@ template <typename T> constexpr T RoundToNextMultiple(const T a, const T multipl
 
 std::vector<std::uint8_t> ReadFile(const char *filename);
 
+// Seconds from an arbitrary start. Tests and replays swap in their own.
+using Clock = std::function<double()>;
+double SteadyClockSeconds();
+
 #endif
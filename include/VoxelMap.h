@@ -0,0 +1,114 @@
+#pragma once
+
+#include "WorldMesh.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Sparse occupancy of a world in cubic voxels, for volumetric queries in the
+// world mesh space: is a point in a wall, which room is it in, what does a
+// ray hit first. Voxels are grouped into bricks of 8^3 held as bit masks, and
+// bricks into nodes of 8^3 listed in a dense grid over the world. Only nodes
+// and bricks with something in them are stored.
+//
+// A voxel is solid when a triangle touches it, the conservative rasterization
+// of Schwarz and Seidel, so a closed shell leaves no 6-connected gap. Rooms
+// are rasterized one per task on the thread pool and flood filled from the
+// outside of their bounds, whole empty bricks at a time. What the fill
+// doesn't reach is the room, its shell included. Where rooms overlap the
+// first one in WorldMesh::rooms owns the voxel.
+
+struct VoxelHit {
+    // Along the ray to where it enters the voxel
+    float distance;
+    float position[3];
+    std::int32_t voxel[3];
+};
+
+struct VoxelMapStats {
+    std::uint32_t nodes = 0;
+    std::uint32_t bricks = 0;
+    std::uint64_t solidVoxels = 0;
+    // Bricks wholly in one room, and masks of a room in a brick shared with
+    // the outside or other rooms
+    std::uint32_t roomBricks = 0;
+    std::uint32_t roomMasks = 0;
+    // Rooms with empty voxels inside their shell, thin rooms at coarse sizes
+    // have none and are only their shell
+    std::uint32_t filledRooms = 0;
+};
+
+class VoxelMap {
+public:
+    static constexpr std::int32_t BrickSize = 8;
+    static constexpr std::int32_t NodeSize = 8;
+    static constexpr std::uint32_t NoRoom = 0xFFFFFFFF;
+
+    // pool may be null, rooms are then rasterized one after the other
+    void Build(const WorldMesh &mesh, float voxelSize, ThreadPool *pool = nullptr);
+
+    bool Solid(const float point[3]) const;
+    // Index in WorldMesh::rooms of the room point is in, NoRoom outside of all
+    std::uint32_t RoomAt(const float point[3]) const;
+
+    // First solid voxel along a ray with a unit direction, within maxDistance.
+    // A voxel DDA that skips empty bricks and nodes whole.
+    bool Raycast(const float origin[3], const float direction[3], float maxDistance, VoxelHit &hit) const;
+    // Same voxel after voxel, to check Raycast against
+    bool RaycastVoxels(const float origin[3], const float direction[3], float maxDistance,
+                       VoxelHit &hit) const;
+
+    float VoxelSize() const { return m_voxelSize; }
+    const float *BoundsMin() const { return m_origin; }
+    const float *BoundsMax() const { return m_boundsMax; }
+    const VoxelMapStats &Stats() const { return m_stats; }
+    size_t MemoryBytes() const;
+
+private:
+    struct Brick {
+        // Bit x + y * 8 of word z
+        std::uint64_t bits[BrickSize];
+    };
+
+    // Room masks of a brick are chained, the first with a voxel set owns it
+    struct RoomMask {
+        Brick mask;
+        std::uint32_t room;
+        std::uint32_t next;
+    };
+
+    static constexpr std::uint32_t NoIndex = 0xFFFFFFFF;
+    // Set in Node::rooms for a brick wholly in the room of the low bits,
+    // otherwise the first RoomMask or NoIndex
+    static constexpr std::uint32_t WholeRoom = 0x80000000;
+
+    struct Node {
+        std::uint32_t bricks[NodeSize * NodeSize * NodeSize];
+        std::uint32_t rooms[NodeSize * NodeSize * NodeSize];
+    };
+
+    // Bricks of one room, in a box of bricks around it
+    struct RoomResult;
+    void BuildRoom(const WorldMesh &mesh, const RoomMesh &room, RoomResult &result) const;
+
+    bool Voxel(const float point[3], std::int32_t voxel[3]) const;
+    const Node *NodeAt(const std::int32_t voxel[3]) const;
+    Node &NodeFor(const std::int32_t voxel[3]);
+    bool SolidVoxel(const std::int32_t voxel[3]) const;
+    bool March(const float origin[3], const float direction[3], float maxDistance, bool skipEmpty,
+               VoxelHit &hit) const;
+    void AddRoomMask(std::uint32_t &rooms, std::uint32_t room, const Brick &mask);
+
+    float m_origin[3] = {};
+    float m_boundsMax[3] = {};
+    float m_voxelSize = 1.f;
+    // Nodes across the grid on each axis
+    std::int32_t m_nodes[3] = {};
+    std::vector<std::uint32_t> m_grid;
+    std::vector<Node> m_nodeData;
+    std::vector<Brick> m_bricks;
+    std::vector<RoomMask> m_roomMasks;
+    VoxelMapStats m_stats;
+};
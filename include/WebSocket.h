@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The parts of RFC 6455 the map server and its test clients share: the
+// handshake key and framing. Nothing here touches sockets.
+
+enum class WebSocketOpcode : std::uint8_t {
+    Continuation = 0x0,
+    Text = 0x1,
+    Binary = 0x2,
+    Close = 0x8,
+    Ping = 0x9,
+    Pong = 0xA,
+};
+
+// Sec-WebSocket-Accept for a client's Sec-WebSocket-Key
+std::string WebSocketAccept(const std::string &key);
+
+// Appends one final frame. Clients mask what they send, servers don't: mask
+// is 4 bytes or null.
+void AppendWebSocketFrame(std::string &out, WebSocketOpcode opcode, const void *payload, std::size_t size,
+                          const std::uint8_t *mask = nullptr);
+
+struct WebSocketFrame {
+    WebSocketOpcode opcode = WebSocketOpcode::Binary;
+    bool final = true;
+    bool masked = false;
+    // Unmasked
+    std::string payload;
+};
+
+// Parses the frame at the start of data. Returns the bytes it took, 0 when
+// the frame is not complete yet. Throws std::runtime_error on reserved bits,
+// unknown opcodes or a payload over maxPayload.
+std::size_t ParseWebSocketFrame(const char *data, std::size_t size, std::size_t maxPayload,
+                                WebSocketFrame &frame);
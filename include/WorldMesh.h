@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct MeshVertex {
+    float position[3];
+    float normal[3];
+};
+
+// One OBJ object, rooms are exported as "<index>_<Name>_MAP.<id>"
+struct RoomMesh {
+    std::string name;
+    int roomIndex; // -1 when the name does not start with a number
+    std::uint32_t firstVertex;
+    std::uint32_t vertexCount;
+    // Indices are relative to firstVertex
+    std::uint32_t firstIndex;
+    std::uint32_t indexCount;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Geometry of a whole world, converted to the viewer's left handed space the
+// same way aiProcess_ConvertToLeftHanded does (z flipped, winding reversed)
+struct WorldMesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<std::uint32_t> indices;
+    std::vector<RoomMesh> rooms;
+};
+
+WorldMesh ParseWorldObj(const std::string &text);
+WorldMesh LoadWorldObj(const char *path);
+
+// "02_Main_Plaza_MAP.580" to "Main Plaza"
+std::string RoomDisplayName(std::string_view objectName);
@@ -1,15 +1,17 @@
-Texture2D energyT : register(t0);
-Texture2D missileT : register(t1);
+// Every pickup icon lives in this atlas, the per-type UVs are baked in the
+// icon vertices on the CPU. Alpha holds the distance to the icon silhouette,
+// 0.5 on the edge.
+Texture2D iconAtlas : register(t0);
 
 SamplerState s : register(s0);
 
 struct IconVert {
     float3 pos[6];
     float2 uvs[6];
+    float4 tint;
 };
 
-StructuredBuffer<IconVert> vertexBuffer : register(t2);
-StructuredBuffer<uint> typeBuffer : register(t3);
+StructuredBuffer<IconVert> vertexBuffer : register(t1);
 
 cbuffer PerDraw : register(b0) { uint instanceOffset; };
 cbuffer PerFrame : register(b1) {
@@ -25,7 +27,7 @@ struct VSIn {
 struct PSIn {
     float4 Pos : SV_Position;
     float2 Uvs : TEXCOORD0;
-    float Type : TEXCOORD1;
+    float4 Tint : COLOR0;
 };
 
 PSIn VSMain(VSIn input) {
@@ -35,17 +37,15 @@ PSIn VSMain(VSIn input) {
     PSIn output;
     output.Pos = mul(mvp, float4(v.pos[input.VertId], 1.0));
     output.Uvs = v.uvs[input.VertId];
-    output.Type = vertIdx;
+    output.Tint = v.tint;
     return output;
 }
 
+// RenderIconSdf in IconSdf.cpp is the CPU reference of this
 float4 PSMain(PSIn input) : SV_TARGET {
-    uint vertIdx = (uint)input.Type;
-    uint type = typeBuffer.Load(vertIdx);
-
-    if (type == 0) {
-        return energyT.Sample(s, input.Uvs);
-    } else {
-        return missileT.Sample(s, input.Uvs);
-    }
+    float4 texel = iconAtlas.Sample(s, input.Uvs);
+    // Coverage ramps over one screen pixel around the edge, whatever the
+    // icon size on screen
+    float coverage = saturate((texel.a - 0.5) / max(fwidth(texel.a), 1e-5) + 0.5);
+    return float4(texel.rgb, coverage) * input.Tint;
 }
@@ -0,0 +1,60 @@
+#include "AssetCache.h"
+
+#include "Utility.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+
+AssetCache::AssetCache(std::string directory) : m_directory(std::move(directory)) {}
+
+std::string AssetCache::PathOf(std::uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return m_directory + name;
+}
+
+std::optional<std::vector<std::uint8_t>> AssetCache::Load(std::uint64_t key) const {
+    const std::string path = PathOf(key);
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        return std::nullopt;
+    }
+    try {
+        return ReadFile(path.c_str());
+    } catch (const std::runtime_error &) {
+        return std::nullopt;
+    }
+}
+
+void AssetCache::Store(std::uint64_t key, const std::vector<std::uint8_t> &data) const {
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+
+    const std::string path = PathOf(key);
+    const std::string temporary = path + ".tmp";
+    FILE *handle = std::fopen(temporary.c_str(), "wb");
+    if (!handle) {
+        throw std::runtime_error("Could not write " + temporary);
+    }
+    const bool written = std::fwrite(data.data(), 1, data.size(), handle) == data.size();
+    std::fclose(handle);
+
+    if (written) {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+std::uint64_t HashBytes(const void *data, std::size_t size, std::uint64_t seed) {
+    const std::uint8_t *bytes = static_cast<const std::uint8_t *>(data);
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,1055 @@
+#include "BlockCompression.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+struct Block {
+    std::uint8_t texels[16][4];
+};
+
+// Texels past the right and bottom edges repeat the last column and row
+Block FetchBlock(const DecodedImage &image, int bx, int by) {
+    Block block;
+    for (int y = 0; y < 4; y++) {
+        const int sy = std::min(by * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; x++) {
+            const int sx = std::min(bx * 4 + x, image.width - 1);
+            memcpy(block.texels[y * 4 + x], &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+        }
+    }
+    return block;
+}
+
+void StoreBlock(const Block &block, DecodedImage &image, int bx, int by) {
+    for (int y = 0; y < 4 && by * 4 + y < image.height; y++) {
+        for (int x = 0; x < 4 && bx * 4 + x < image.width; x++) {
+            const size_t offset = ((size_t)(by * 4 + y) * image.width + bx * 4 + x) * 4;
+            memcpy(&image.pixels[offset], block.texels[y * 4 + x], 4);
+        }
+    }
+}
+
+// Line through the texels selected by mask, over their first channels. The
+// ends are where the texels project at the extremes of the principal axis.
+void FitLine(const Block &block, std::uint32_t mask, int channels, float lo[4], float hi[4]) {
+    float mean[4] = {};
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            for (int c = 0; c < channels; c++) {
+                mean[c] += block.texels[i][c];
+            }
+            count++;
+        }
+    }
+    for (int c = 0; c < channels; c++) {
+        mean[c] /= count;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            for (int a = 0; a < channels; a++) {
+                for (int b = 0; b < channels; b++) {
+                    covariance[a][b] += (block.texels[i][a] - mean[a]) * (block.texels[i][b] - mean[b]);
+                }
+            }
+        }
+    }
+
+    // Power iteration, starting from the channel that varies the most
+    float axis[4] = {};
+    int widest = 0;
+    for (int c = 1; c < channels; c++) {
+        widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+    }
+    axis[widest] = 1.f;
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        if (length < 1e-12f) {
+            break;
+        }
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float tMin = 0.f, tMax = 0.f;
+    for (int i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            float t = 0.f;
+            for (int c = 0; c < channels; c++) {
+                t += (block.texels[i][c] - mean[c]) * axis[c];
+            }
+            tMin = std::min(tMin, t);
+            tMax = std::max(tMax, t);
+        }
+    }
+    for (int c = 0; c < channels; c++) {
+        lo[c] = mean[c] + axis[c] * tMin;
+        hi[c] = mean[c] + axis[c] * tMax;
+    }
+}
+
+// Least squares endpoints for the given indices, weights[i] being how much
+// of e1 palette entry i holds. False when the indices don't pin both down.
+bool SolveEndpoints(const Block &block, std::uint32_t mask, int channels, const std::uint8_t indices[16],
+                    const float *weights, float e0[4], float e1[4]) {
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    float ax[4] = {}, bx[4] = {};
+    for (int i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            const float w = weights[indices[i]];
+            aa += (1.f - w) * (1.f - w);
+            ab += (1.f - w) * w;
+            bb += w * w;
+            for (int c = 0; c < channels; c++) {
+                ax[c] += (1.f - w) * block.texels[i][c];
+                bx[c] += w * block.texels[i][c];
+            }
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (std::abs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < channels; c++) {
+        e0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        e1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+int Squared(int v) { return v * v; }
+
+///////////////////////////////////////////////////////////////////////////////
+// BC1 and the color half of BC3
+
+std::uint16_t To565(const float c[3]) {
+    const int r = std::clamp((int)std::lround(c[0] * 31.f / 255.f), 0, 31);
+    const int g = std::clamp((int)std::lround(c[1] * 63.f / 255.f), 0, 63);
+    const int b = std::clamp((int)std::lround(c[2] * 31.f / 255.f), 0, 31);
+    return (std::uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void From565(std::uint16_t v, int out[3]) {
+    const int r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// BC3 color blocks always have four colors, BC1 ones only when c0 > c1 and
+// have three plus a transparent black otherwise
+int ColorPalette(std::uint16_t c0, std::uint16_t c1, bool alwaysFour, int palette[4][3]) {
+    From565(c0, palette[0]);
+    From565(c1, palette[1]);
+    const bool four = alwaysFour || c0 > c1;
+    for (int c = 0; c < 3; c++) {
+        if (four) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    return four ? 4 : 3;
+}
+
+// Texels outside of opaque take the transparent entry, returns the error
+int ColorIndices(const Block &block, std::uint32_t opaque, std::uint16_t c0, std::uint16_t c1,
+                 bool alwaysFour, std::uint8_t indices[16]) {
+    int palette[4][3];
+    const int count = ColorPalette(c0, c1, alwaysFour, palette);
+
+    int total = 0;
+    for (int i = 0; i < 16; i++) {
+        if (!(opaque >> i & 1)) {
+            indices[i] = 3;
+            continue;
+        }
+        int best = std::numeric_limits<int>::max();
+        for (int p = 0; p < count; p++) {
+            const int error = Squared(block.texels[i][0] - palette[p][0]) +
+                              Squared(block.texels[i][1] - palette[p][1]) +
+                              Squared(block.texels[i][2] - palette[p][2]);
+            if (error < best) {
+                best = error;
+                indices[i] = (std::uint8_t)p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+void EncodeColorBlock(const Block &block, bool bc3, std::uint8_t out[8]) {
+    // BC1 punches through texels under half alpha
+    std::uint32_t opaque = 0xFFFF;
+    if (!bc3) {
+        opaque = 0;
+        for (int i = 0; i < 16; i++) {
+            opaque |= (block.texels[i][3] >= 128 ? 1u : 0u) << i;
+        }
+    }
+
+    std::uint16_t c0 = 0, c1 = 0;
+    std::uint8_t indices[16];
+    std::fill_n(indices, 16, 3);
+
+    if (opaque != 0) {
+        // Four color blocks need c0 > c1, three color ones the opposite
+        const bool threeColor = opaque != 0xFFFF;
+        static const float fourWeights[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+        static const float threeWeights[4] = {0.f, 1.f, 0.5f, 0.f};
+        const float *weights = threeColor ? threeWeights : fourWeights;
+
+        auto order = [&](std::uint16_t &a, std::uint16_t &b) {
+            if (!bc3 && (threeColor ? a > b : a < b)) {
+                std::swap(a, b);
+            }
+        };
+
+        float lo[4], hi[4];
+        FitLine(block, opaque, 3, lo, hi);
+        c0 = To565(hi);
+        c1 = To565(lo);
+        order(c0, c1);
+        int best = ColorIndices(block, opaque, c0, c1, bc3, indices);
+
+        for (int iteration = 0; iteration < 2 && best > 0; iteration++) {
+            float e0[4], e1[4];
+            if (!SolveEndpoints(block, opaque, 3, indices, weights, e0, e1)) {
+                break;
+            }
+            std::uint16_t n0 = To565(e0), n1 = To565(e1);
+            order(n0, n1);
+            std::uint8_t candidate[16];
+            const int error = ColorIndices(block, opaque, n0, n1, bc3, candidate);
+            if (error >= best) {
+                break;
+            }
+            best = error;
+            c0 = n0;
+            c1 = n1;
+            std::copy_n(candidate, 16, indices);
+        }
+    }
+
+    std::uint32_t bits = 0;
+    for (int i = 0; i < 16; i++) {
+        bits |= (std::uint32_t)indices[i] << (2 * i);
+    }
+    out[0] = (std::uint8_t)c0;
+    out[1] = (std::uint8_t)(c0 >> 8);
+    out[2] = (std::uint8_t)c1;
+    out[3] = (std::uint8_t)(c1 >> 8);
+    memcpy(out + 4, &bits, 4);
+}
+
+void DecodeColorBlock(const std::uint8_t in[8], bool bc3, Block &block) {
+    const std::uint16_t c0 = (std::uint16_t)(in[0] | (in[1] << 8));
+    const std::uint16_t c1 = (std::uint16_t)(in[2] | (in[3] << 8));
+    std::uint32_t bits;
+    memcpy(&bits, in + 4, 4);
+
+    int palette[4][3];
+    const int count = ColorPalette(c0, c1, bc3, palette);
+    for (int i = 0; i < 16; i++) {
+        const int index = (bits >> (2 * i)) & 3;
+        for (int c = 0; c < 3; c++) {
+            block.texels[i][c] = (std::uint8_t)palette[index][c];
+        }
+        block.texels[i][3] = count == 3 && index == 3 ? 0 : 255;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Alpha half of BC3
+
+void AlphaPalette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int k = 2; k < 8; k++) {
+            palette[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+        }
+    } else {
+        for (int k = 2; k < 6; k++) {
+            palette[k] = ((6 - k) * a0 + (k - 1) * a1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+void EncodeAlphaBlock(const Block &block, std::uint8_t out[8]) {
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++) {
+        a0 = std::max(a0, (int)block.texels[i][3]);
+        a1 = std::min(a1, (int)block.texels[i][3]);
+    }
+
+    int palette[8];
+    AlphaPalette(a0, a1, palette);
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 16 && a0 != a1; i++) {
+        int best = 0;
+        for (int k = 1; k < 8; k++) {
+            if (std::abs(block.texels[i][3] - palette[k]) < std::abs(block.texels[i][3] - palette[best])) {
+                best = k;
+            }
+        }
+        bits |= (std::uint64_t)best << (3 * i);
+    }
+
+    out[0] = (std::uint8_t)a0;
+    out[1] = (std::uint8_t)a1;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (std::uint8_t)(bits >> (8 * i));
+    }
+}
+
+void DecodeAlphaBlock(const std::uint8_t in[8], Block &block) {
+    int palette[8];
+    AlphaPalette(in[0], in[1], palette);
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 6; i++) {
+        bits |= (std::uint64_t)in[2 + i] << (8 * i);
+    }
+    for (int i = 0; i < 16; i++) {
+        block.texels[i][3] = (std::uint8_t)palette[(bits >> (3 * i)) & 7];
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BC7. Every block tries modes 4 to 6, one subset with alpha either on the
+// color line or on its own indices, then modes 1, 3 and 7, two subsets, over
+// the few partitions whose unquantized fit is best. Endpoints come from a
+// principal axis fit refined by least squares for every p-bit choice, and the
+// candidate with the smallest visible error is kept. Modes 0 and 2, three
+// subsets, are neither written nor read.
+
+struct Bc7Mode {
+    int subsets;
+    int partitionBits;
+    int rotationBits;
+    int indexSelectionBits;
+    int colorBits;
+    // 0 when alpha is always 255
+    int alphaBits;
+    // A p-bit per endpoint, or one shared by the two endpoints of a subset
+    int endpointPBits;
+    int sharedPBits;
+    int indexBits;
+    // Second index set, 0 when alpha uses the color indices
+    int secondIndexBits;
+};
+
+const Bc7Mode Bc7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0}, {2, 6, 0, 0, 6, 0, 0, 1, 3, 0}, {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0}, {1, 0, 2, 1, 5, 6, 0, 0, 2, 3}, {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0}, {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+};
+
+const int Bc7Weights2[4] = {0, 21, 43, 64};
+const int Bc7Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+const int Bc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+const int *Bc7Weights(int indexBits) {
+    return indexBits == 2 ? Bc7Weights2 : indexBits == 3 ? Bc7Weights3 : Bc7Weights4;
+}
+
+// Two subset partitions, bit i set when texel i is in the second subset
+const std::uint16_t Bc7Partitions[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8,
+    0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110,
+    0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696,
+    0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720,
+    0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+// Texel of the second subset whose index is stored without its top bit, the
+// first subset's is always texel 0
+const std::uint8_t Bc7Anchors[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8, 2,  2, 8,
+    8,  15, 2,  8,  2,  2,  8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2, 8,  2, 2,
+    2,  15, 15, 6,  6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2, 15,
+};
+
+struct Bc7Block {
+    int mode = 6;
+    int partition = 0;
+    // Color channel swapped with alpha after decoding, plus one
+    int rotation = 0;
+    // Color takes the second index set of mode 4
+    int indexSelection = 0;
+    // Quantized, per subset and endpoint, RGBA
+    int endpoints[2][2][4] = {};
+    int pbits[2][2] = {};
+    std::uint8_t colorIndices[16] = {};
+    // Same as the color ones unless the mode has a second index set
+    std::uint8_t alphaIndices[16] = {};
+};
+
+int Bc7Subset(const Bc7Block &encoded, int texel) {
+    return Bc7Modes[encoded.mode].subsets == 2 ? Bc7Partitions[encoded.partition] >> texel & 1 : 0;
+}
+
+bool Bc7IsAnchor(const Bc7Block &encoded, int texel) {
+    return texel == 0 || (Bc7Modes[encoded.mode].subsets == 2 && texel == Bc7Anchors[encoded.partition]);
+}
+
+int Bc7ColorIndexBits(const Bc7Block &encoded) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    return encoded.indexSelection ? mode.secondIndexBits : mode.indexBits;
+}
+
+int Bc7AlphaIndexBits(const Bc7Block &encoded) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    return mode.secondIndexBits == 0 ? mode.indexBits
+           : encoded.indexSelection  ? mode.indexBits
+                                     : mode.secondIndexBits;
+}
+
+// pbit is -1 when the mode has none
+int Bc7Unquantize(int value, int pbit, int bits) {
+    if (pbit >= 0) {
+        value = value << 1 | pbit;
+        bits++;
+    }
+    value <<= 8 - bits;
+    return value | value >> bits;
+}
+
+int Bc7Quantize(float value, int pbit, int bits) {
+    const int levels = (1 << (bits + (pbit >= 0))) - 1;
+    const float scaled = value * levels / 255.f;
+    const int quantized = pbit >= 0 ? (int)std::lround((scaled - pbit) / 2.f) : (int)std::lround(scaled);
+    return std::clamp(quantized, 0, (1 << bits) - 1);
+}
+
+int Bc7PBit(const Bc7Block &encoded, int subset, int endpoint) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    return mode.endpointPBits ? encoded.pbits[subset][endpoint]
+           : mode.sharedPBits ? encoded.pbits[subset][0]
+                              : -1;
+}
+
+void DecodeBc7(const Bc7Block &encoded, Block &block) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    int endpoints[2][2][4];
+    for (int s = 0; s < mode.subsets; s++) {
+        for (int j = 0; j < 2; j++) {
+            for (int c = 0; c < 4; c++) {
+                const int bits = c < 3 ? mode.colorBits : mode.alphaBits;
+                endpoints[s][j][c] =
+                    bits == 0 ? 255 : Bc7Unquantize(encoded.endpoints[s][j][c], Bc7PBit(encoded, s, j), bits);
+            }
+        }
+    }
+
+    const int *colorWeights = Bc7Weights(Bc7ColorIndexBits(encoded));
+    const int *alphaWeights = Bc7Weights(Bc7AlphaIndexBits(encoded));
+    for (int i = 0; i < 16; i++) {
+        const int(*e)[4] = endpoints[Bc7Subset(encoded, i)];
+        for (int c = 0; c < 4; c++) {
+            const int w =
+                c < 3 ? colorWeights[encoded.colorIndices[i]] : alphaWeights[encoded.alphaIndices[i]];
+            block.texels[i][c] = (std::uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+        }
+        if (encoded.rotation > 0) {
+            std::swap(block.texels[i][encoded.rotation - 1], block.texels[i][3]);
+        }
+    }
+}
+
+class BitWriter {
+public:
+    explicit BitWriter(std::uint8_t *out) : m_out(out) {}
+    void Write(std::uint32_t value, int count) {
+        for (int i = 0; i < count; i++, m_position++) {
+            m_out[m_position >> 3] |= (std::uint8_t)(((value >> i) & 1) << (m_position & 7));
+        }
+    }
+
+private:
+    std::uint8_t *m_out;
+    int m_position = 0;
+};
+
+class BitReader {
+public:
+    explicit BitReader(const std::uint8_t *in) : m_in(in) {}
+    std::uint32_t Read(int count) {
+        std::uint32_t value = 0;
+        for (int i = 0; i < count; i++, m_position++) {
+            value |= (std::uint32_t)((m_in[m_position >> 3] >> (m_position & 7)) & 1) << i;
+        }
+        return value;
+    }
+
+private:
+    const std::uint8_t *m_in;
+    int m_position = 0;
+};
+
+// Anchor indices must have their top bit clear
+void PackBc7Block(const Bc7Block &encoded, std::uint8_t out[16]) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    memset(out, 0, 16);
+    BitWriter writer(out);
+    writer.Write(1u << encoded.mode, encoded.mode + 1);
+    writer.Write(encoded.partition, mode.partitionBits);
+    writer.Write(encoded.rotation, mode.rotationBits);
+    writer.Write(encoded.indexSelection, mode.indexSelectionBits);
+    for (int c = 0; c < 4; c++) {
+        for (int s = 0; s < mode.subsets; s++) {
+            for (int j = 0; j < 2; j++) {
+                writer.Write(encoded.endpoints[s][j][c], c < 3 ? mode.colorBits : mode.alphaBits);
+            }
+        }
+    }
+    for (int s = 0; s < mode.subsets; s++) {
+        writer.Write(encoded.pbits[s][0], mode.endpointPBits + mode.sharedPBits);
+        writer.Write(encoded.pbits[s][1], mode.endpointPBits);
+    }
+
+    // Mode 4 stores its 2 bit set first, whichever channels it is for
+    const bool swapped = mode.secondIndexBits > 0 && encoded.indexSelection;
+    const std::uint8_t *first = swapped ? encoded.alphaIndices : encoded.colorIndices;
+    const std::uint8_t *second = swapped ? encoded.colorIndices : encoded.alphaIndices;
+    for (int i = 0; i < 16; i++) {
+        writer.Write(first[i], mode.indexBits - Bc7IsAnchor(encoded, i));
+    }
+    for (int i = 0; i < 16 && mode.secondIndexBits > 0; i++) {
+        writer.Write(second[i], mode.secondIndexBits - (i == 0));
+    }
+}
+
+void DecodeBc7Block(const std::uint8_t in[16], Block &block) {
+    Bc7Block encoded;
+    BitReader reader(in);
+    encoded.mode = 0;
+    while (encoded.mode < 8 && reader.Read(1) == 0) {
+        encoded.mode++;
+    }
+    if (encoded.mode == 8) {
+        throw std::runtime_error("Reserved BC7 mode");
+    }
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    if (mode.subsets == 3) {
+        throw std::runtime_error("BC7 blocks with three subsets can't be decoded");
+    }
+
+    encoded.partition = (int)reader.Read(mode.partitionBits);
+    encoded.rotation = (int)reader.Read(mode.rotationBits);
+    encoded.indexSelection = (int)reader.Read(mode.indexSelectionBits);
+    for (int c = 0; c < 4; c++) {
+        for (int s = 0; s < mode.subsets; s++) {
+            for (int j = 0; j < 2; j++) {
+                encoded.endpoints[s][j][c] = (int)reader.Read(c < 3 ? mode.colorBits : mode.alphaBits);
+            }
+        }
+    }
+    for (int s = 0; s < mode.subsets; s++) {
+        encoded.pbits[s][0] = (int)reader.Read(mode.endpointPBits + mode.sharedPBits);
+        encoded.pbits[s][1] = (int)reader.Read(mode.endpointPBits);
+    }
+
+    const bool swapped = mode.secondIndexBits > 0 && encoded.indexSelection;
+    std::uint8_t *first = swapped ? encoded.alphaIndices : encoded.colorIndices;
+    std::uint8_t *second = swapped ? encoded.colorIndices : encoded.alphaIndices;
+    for (int i = 0; i < 16; i++) {
+        first[i] = (std::uint8_t)reader.Read(mode.indexBits - Bc7IsAnchor(encoded, i));
+    }
+    for (int i = 0; i < 16; i++) {
+        second[i] = mode.secondIndexBits > 0 ? (std::uint8_t)reader.Read(mode.secondIndexBits - (i == 0))
+                                             : first[i];
+    }
+    DecodeBc7(encoded, block);
+}
+
+// Over the first channels of the texels in mask, the squared distance to
+// their principal axis line, to rank partitions without quantizing
+float LineError(const Block &block, std::uint32_t mask, int channels) {
+    float lo[4], hi[4];
+    FitLine(block, mask, channels, lo, hi);
+    float axis[4], length = 0.f;
+    for (int c = 0; c < channels; c++) {
+        axis[c] = hi[c] - lo[c];
+        length += axis[c] * axis[c];
+    }
+    float error = 0.f;
+    for (int i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            float t = 0.f;
+            for (int c = 0; c < channels; c++) {
+                t += (block.texels[i][c] - lo[c]) * axis[c];
+            }
+            t = length > 0.f ? std::clamp(t / length, 0.f, 1.f) : 0.f;
+            for (int c = 0; c < channels; c++) {
+                const float d = block.texels[i][c] - (lo[c] + axis[c] * t);
+                error += d * d;
+            }
+        }
+    }
+    return error;
+}
+
+// Endpoints of bits per channel for the texels in mask, over the first
+// channels of block, trying every p-bit choice: pbitCount is 0, 1 when both
+// endpoints share it or 2. Returns the squared error over those channels.
+int FitBc7Subset(const Block &block, std::uint32_t mask, int channels, int bits, int pbitCount, int indexBits,
+                 int values[2][4], int pbits[2], std::uint8_t indices[16]) {
+    const int *weightTable = Bc7Weights(indexBits);
+    const int paletteSize = 1 << indexBits;
+    float weights[16];
+    for (int k = 0; k < paletteSize; k++) {
+        weights[k] = weightTable[k] / 64.f;
+    }
+
+    float lo[4], hi[4];
+    FitLine(block, mask, channels, lo, hi);
+
+    int bestError = std::numeric_limits<int>::max();
+    for (int p = 0; p < 1 << pbitCount && bestError > 0; p++) {
+        const int p0 = pbitCount == 0 ? -1 : p & 1;
+        const int p1 = pbitCount == 0 ? -1 : pbitCount == 1 ? p0 : p >> 1;
+        float e0[4], e1[4];
+        std::copy_n(lo, 4, e0);
+        std::copy_n(hi, 4, e1);
+        for (int iteration = 0; iteration < 3; iteration++) {
+            int quantized[2][4] = {}, palette[16][4];
+            for (int c = 0; c < channels; c++) {
+                quantized[0][c] = Bc7Quantize(e0[c], p0, bits);
+                quantized[1][c] = Bc7Quantize(e1[c], p1, bits);
+                const int u0 = Bc7Unquantize(quantized[0][c], p0, bits);
+                const int u1 = Bc7Unquantize(quantized[1][c], p1, bits);
+                for (int k = 0; k < paletteSize; k++) {
+                    palette[k][c] = ((64 - weightTable[k]) * u0 + weightTable[k] * u1 + 32) >> 6;
+                }
+            }
+
+            std::uint8_t candidate[16] = {};
+            int error = 0;
+            for (int i = 0; i < 16; i++) {
+                if (!(mask >> i & 1)) {
+                    continue;
+                }
+                int best = std::numeric_limits<int>::max();
+                for (int k = 0; k < paletteSize; k++) {
+                    int distance = 0;
+                    for (int c = 0; c < channels; c++) {
+                        distance += Squared(block.texels[i][c] - palette[k][c]);
+                    }
+                    if (distance < best) {
+                        best = distance;
+                        candidate[i] = (std::uint8_t)k;
+                    }
+                }
+                error += best;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                std::copy_n(&quantized[0][0], 8, &values[0][0]);
+                pbits[0] = std::max(p0, 0);
+                pbits[1] = std::max(p1, 0);
+                for (int i = 0; i < 16; i++) {
+                    indices[i] = mask >> i & 1 ? candidate[i] : indices[i];
+                }
+            }
+            if (error == 0 || !SolveEndpoints(block, mask, channels, candidate, weights, e0, e1)) {
+                break;
+            }
+        }
+    }
+    return bestError;
+}
+
+// Colors weigh by their alpha, like once blended
+float VisibleError(const std::uint8_t a[4], const std::uint8_t b[4]) {
+    float error = Squared(a[3] - b[3]);
+    for (int c = 0; c < 3; c++) {
+        const float d = (a[c] * a[3] - b[c] * b[3]) / 255.f;
+        error += d * d;
+    }
+    return error;
+}
+
+// Flips the endpoints of every subset whose anchor index has its top bit
+// set, separately for the two index sets of modes 4 and 5
+void FixBc7Anchors(Bc7Block &encoded) {
+    const Bc7Mode &mode = Bc7Modes[encoded.mode];
+    const int colorTop = 1 << (Bc7ColorIndexBits(encoded) - 1);
+    const int alphaTop = 1 << (Bc7AlphaIndexBits(encoded) - 1);
+    for (int s = 0; s < mode.subsets; s++) {
+        const int anchor = s == 0 ? 0 : Bc7Anchors[encoded.partition];
+        const bool flipColor = encoded.colorIndices[anchor] >= colorTop;
+        const bool flipAlpha =
+            mode.secondIndexBits > 0 ? encoded.alphaIndices[anchor] >= alphaTop : flipColor;
+        for (int c = 0; c < 4; c++) {
+            if (c < 3 ? flipColor : flipAlpha) {
+                std::swap(encoded.endpoints[s][0][c], encoded.endpoints[s][1][c]);
+            }
+        }
+        if (flipColor) {
+            std::swap(encoded.pbits[s][0], encoded.pbits[s][1]);
+        }
+        for (int i = 0; i < 16; i++) {
+            if (Bc7Subset(encoded, i) != s) {
+                continue;
+            }
+            if (flipColor) {
+                encoded.colorIndices[i] = (std::uint8_t)(2 * colorTop - 1 - encoded.colorIndices[i]);
+            }
+            if (mode.secondIndexBits == 0) {
+                encoded.alphaIndices[i] = encoded.colorIndices[i];
+            } else if (flipAlpha) {
+                encoded.alphaIndices[i] = (std::uint8_t)(2 * alphaTop - 1 - encoded.alphaIndices[i]);
+            }
+        }
+    }
+}
+
+// Partitions tried with the two subset modes
+const int Bc7PartitionCandidates = 4;
+
+void EncodeBc7Block(const Block &block, std::uint8_t out[16]) {
+    float bestError = std::numeric_limits<float>::max();
+    auto consider = [&](Bc7Block &encoded) {
+        FixBc7Anchors(encoded);
+        Block decoded;
+        DecodeBc7(encoded, decoded);
+        float error = 0.f;
+        for (int i = 0; i < 16; i++) {
+            error += VisibleError(block.texels[i], decoded.texels[i]);
+        }
+        if (error < bestError) {
+            bestError = error;
+            PackBc7Block(encoded, out);
+        }
+    };
+
+    bool opaque = true;
+    for (int i = 0; i < 16; i++) {
+        opaque &= block.texels[i][3] == 255;
+    }
+
+    {
+        Bc7Block encoded;
+        encoded.mode = 6;
+        FitBc7Subset(block, 0xFFFF, 4, 7, 2, 4, encoded.endpoints[0], encoded.pbits[0], encoded.colorIndices);
+        consider(encoded);
+    }
+
+    // Alpha on its own indices, possibly swapped with a color channel
+    for (int mode = 4; mode <= 5 && bestError > 0.f; mode++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            Block rotated = block;
+            Block alpha = block;
+            for (int i = 0; i < 16; i++) {
+                if (rotation > 0) {
+                    std::swap(rotated.texels[i][rotation - 1], rotated.texels[i][3]);
+                }
+                alpha.texels[i][0] = rotated.texels[i][3];
+            }
+            for (int selection = 0; selection <= (mode == 4 ? 1 : 0); selection++) {
+                Bc7Block encoded;
+                encoded.mode = mode;
+                encoded.rotation = rotation;
+                encoded.indexSelection = selection;
+                int values[2][4], pbits[2];
+                FitBc7Subset(rotated, 0xFFFF, 3, Bc7Modes[mode].colorBits, 0, Bc7ColorIndexBits(encoded),
+                             values, pbits, encoded.colorIndices);
+                for (int j = 0; j < 2; j++) {
+                    std::copy_n(values[j], 3, encoded.endpoints[0][j]);
+                }
+                FitBc7Subset(alpha, 0xFFFF, 1, Bc7Modes[mode].alphaBits, 0, Bc7AlphaIndexBits(encoded),
+                             values, pbits, encoded.alphaIndices);
+                encoded.endpoints[0][0][3] = values[0][0];
+                encoded.endpoints[0][1][3] = values[1][0];
+                consider(encoded);
+            }
+        }
+    }
+
+    // Modes 1 and 3 leave alpha at 255, mode 7 fits all four channels
+    if (bestError == 0.f) {
+        return;
+    }
+    const int channels = opaque ? 3 : 4;
+    std::pair<float, int> ranked[64];
+    for (int p = 0; p < 64; p++) {
+        const std::uint32_t mask = Bc7Partitions[p];
+        ranked[p] = {LineError(block, ~mask & 0xFFFF, channels) + LineError(block, mask, channels), p};
+    }
+    std::partial_sort(ranked, ranked + Bc7PartitionCandidates, ranked + 64);
+    for (int candidate = 0; candidate < Bc7PartitionCandidates && bestError > 0.f; candidate++) {
+        for (int mode : {1, 3, 7}) {
+            if ((mode == 7) == opaque) {
+                continue;
+            }
+            const Bc7Mode &description = Bc7Modes[mode];
+            Bc7Block encoded;
+            encoded.mode = mode;
+            encoded.partition = ranked[candidate].second;
+            for (int s = 0; s < 2; s++) {
+                const std::uint32_t partition = Bc7Partitions[encoded.partition];
+                FitBc7Subset(block, s ? partition : ~partition & 0xFFFF, channels, description.colorBits,
+                             description.endpointPBits ? 2 : description.sharedPBits, description.indexBits,
+                             encoded.endpoints[s], encoded.pbits[s], encoded.colorIndices);
+            }
+            consider(encoded);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DDS container, little endian
+
+const std::uint32_t DdsMagic = 0x20534444;      // "DDS "
+const std::uint32_t DdsFourCCDx10 = 0x30315844; // "DX10"
+const std::uint32_t DdsHeaderWords = 32;        // Magic included
+const std::uint32_t DdsDx10Words = 5;
+const std::uint32_t DxgiFormats[3][2] = {{71, 72}, {77, 78}, {98, 99}}; // UNORM, UNORM_SRGB
+
+// Bumped when the encoders change, older cache entries are then ignored
+const std::uint32_t CompressionVersion = 2;
+
+int BlocksAcross(int size) { return (size + 3) / 4; }
+
+// From the summed squared error of samples values
+double Psnr(double sum, size_t samples) {
+    if (sum == 0.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    const double mse = sum / samples;
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void CheckSameSize(const DecodedImage &a, const DecodedImage &b) {
+    if (a.width != b.width || a.height != b.height || a.pixels.size() != b.pixels.size()) {
+        throw std::runtime_error("PSNR of images of different sizes");
+    }
+}
+} // namespace
+
+std::uint32_t BlockBytes(BlockFormat format) { return format == BlockFormat::BC1 ? 8 : 16; }
+
+const char *BlockFormatName(BlockFormat format) {
+    switch (format) {
+    case BlockFormat::BC1:
+        return "BC1";
+    case BlockFormat::BC3:
+        return "BC3";
+    default:
+        return "BC7";
+    }
+}
+
+CompressedImage CompressImage(const DecodedImage &image, BlockFormat format, ThreadPool &pool) {
+    const int blocksX = BlocksAcross(image.width);
+    const int blocksY = BlocksAcross(image.height);
+    const std::uint32_t blockBytes = BlockBytes(format);
+
+    CompressedImage result{image.width, image.height, format, {}};
+    result.blocks.resize((size_t)blocksX * blocksY * blockBytes);
+    pool.ParallelFor(blocksY, [&](std::uint32_t by) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const Block block = FetchBlock(image, bx, by);
+            std::uint8_t *out = &result.blocks[((size_t)by * blocksX + bx) * blockBytes];
+            switch (format) {
+            case BlockFormat::BC1:
+                EncodeColorBlock(block, false, out);
+                break;
+            case BlockFormat::BC3:
+                EncodeAlphaBlock(block, out);
+                EncodeColorBlock(block, true, out + 8);
+                break;
+            case BlockFormat::BC7:
+                EncodeBc7Block(block, out);
+                break;
+            }
+        }
+    });
+    return result;
+}
+
+DecodedImage DecompressImage(const CompressedImage &image) {
+    const int blocksX = BlocksAcross(image.width);
+    const int blocksY = BlocksAcross(image.height);
+    const std::uint32_t blockBytes = BlockBytes(image.format);
+
+    DecodedImage result{image.width, image.height, {}};
+    result.pixels.resize((size_t)image.width * image.height * 4);
+    for (int by = 0; by < blocksY; by++) {
+        for (int bx = 0; bx < blocksX; bx++) {
+            const std::uint8_t *in = &image.blocks[((size_t)by * blocksX + bx) * blockBytes];
+            Block block;
+            switch (image.format) {
+            case BlockFormat::BC1:
+                DecodeColorBlock(in, false, block);
+                break;
+            case BlockFormat::BC3:
+                DecodeColorBlock(in + 8, true, block);
+                DecodeAlphaBlock(in, block);
+                break;
+            case BlockFormat::BC7:
+                DecodeBc7Block(in, block);
+                break;
+            }
+            StoreBlock(block, result, bx, by);
+        }
+    }
+    return result;
+}
+
+double ComputePsnr(const DecodedImage &a, const DecodedImage &b) {
+    CheckSameSize(a, b);
+    double sum = 0.0;
+    for (size_t i = 0; i < a.pixels.size(); i += 4) {
+        sum += VisibleError(&a.pixels[i], &b.pixels[i]);
+    }
+    return Psnr(sum, a.pixels.size());
+}
+
+double ComputeChannelPsnr(const DecodedImage &a, const DecodedImage &b, int first, int count) {
+    CheckSameSize(a, b);
+    if (first < 0 || count < 1 || first + count > 4) {
+        throw std::runtime_error("PSNR of channels an image doesn't have");
+    }
+    double sum = 0.0;
+    for (size_t i = 0; i < a.pixels.size(); i += 4) {
+        for (int c = first; c < first + count; c++) {
+            sum += Squared(a.pixels[i + c] - b.pixels[i + c]);
+        }
+    }
+    return Psnr(sum, a.pixels.size() / 4 * count);
+}
+
+std::vector<std::uint8_t> EncodeDds(const std::vector<CompressedImage> &mips, bool srgb) {
+    if (mips.empty()) {
+        throw std::runtime_error("DDS without any level");
+    }
+    const CompressedImage &top = mips.front();
+
+    std::uint32_t header[DdsHeaderWords + DdsDx10Words] = {};
+    header[0] = DdsMagic;
+    header[1] = 124;
+    // Caps, height, width, pixel format, mip count and linear size
+    header[2] = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;
+    header[3] = (std::uint32_t)top.height;
+    header[4] = (std::uint32_t)top.width;
+    header[5] = (std::uint32_t)top.blocks.size();
+    header[7] = (std::uint32_t)mips.size();
+    // Pixel format
+    header[19] = 32;
+    header[20] = 0x4;
+    header[21] = DdsFourCCDx10;
+    // Texture, plus complex and mipmap with several levels
+    header[27] = 0x1000 | (mips.size() > 1 ? 0x8 | 0x400000 : 0);
+    // DX10 header: format, 2D texture, no flags, one element
+    header[32] = DxgiFormats[(int)top.format][srgb ? 1 : 0];
+    header[33] = 3;
+    header[35] = 1;
+
+    std::vector<std::uint8_t> data((const std::uint8_t *)header, (const std::uint8_t *)std::end(header));
+    for (const CompressedImage &mip : mips) {
+        data.insert(data.end(), mip.blocks.begin(), mip.blocks.end());
+    }
+    return data;
+}
+
+std::vector<CompressedImage> DecodeDds(const std::vector<std::uint8_t> &data) {
+    std::uint32_t header[DdsHeaderWords + DdsDx10Words];
+    if (data.size() < sizeof(header)) {
+        throw std::runtime_error("Truncated DDS");
+    }
+    memcpy(header, data.data(), sizeof(header));
+    if (header[0] != DdsMagic || header[21] != DdsFourCCDx10) {
+        throw std::runtime_error("Not a DX10 DDS file");
+    }
+
+    int format = -1;
+    for (int f = 0; f < 3; f++) {
+        if (header[32] == DxgiFormats[f][0] || header[32] == DxgiFormats[f][1]) {
+            format = f;
+        }
+    }
+    const int levelCount = (int)std::max(header[7], 1u);
+    if (format < 0 || levelCount > 16 || header[3] > 1 << 15 || header[4] > 1 << 15) {
+        throw std::runtime_error("Unsupported DDS file");
+    }
+
+    std::vector<CompressedImage> mips(levelCount);
+    size_t offset = sizeof(header);
+    for (int level = 0; level < levelCount; level++) {
+        CompressedImage &mip = mips[level];
+        mip.width = std::max(1, (int)header[4] >> level);
+        mip.height = std::max(1, (int)header[3] >> level);
+        mip.format = (BlockFormat)format;
+
+        const size_t size =
+            (size_t)BlocksAcross(mip.width) * BlocksAcross(mip.height) * BlockBytes(mip.format);
+        if (offset + size > data.size()) {
+            throw std::runtime_error("Truncated DDS");
+        }
+        mip.blocks.assign(data.begin() + offset, data.begin() + offset + size);
+        offset += size;
+    }
+    return mips;
+}
+
+std::vector<CompressedImage> CachedCompression(const AssetCache &cache,
+                                               const std::vector<DecodedImage> &mips, BlockFormat format,
+                                               ThreadPool &pool, bool *cacheHit) {
+    const std::uint32_t settings[] = {CompressionVersion, (std::uint32_t)format, (std::uint32_t)mips.size()};
+    std::uint64_t key = HashBytes(settings, sizeof(settings));
+    for (const DecodedImage &mip : mips) {
+        const std::int32_t size[] = {mip.width, mip.height};
+        key = HashBytes(mip.pixels.data(), mip.pixels.size(), HashBytes(size, sizeof(size), key));
+    }
+
+    if (std::optional<std::vector<std::uint8_t>> data = cache.Load(key)) {
+        try {
+            std::vector<CompressedImage> compressed = DecodeDds(*data);
+            if (cacheHit) {
+                *cacheHit = true;
+            }
+            return compressed;
+        } catch (const std::runtime_error &) {
+            // Damaged entry, overwritten below
+        }
+    }
+
+    std::vector<CompressedImage> compressed;
+    for (const DecodedImage &mip : mips) {
+        compressed.push_back(CompressImage(mip, format, pool));
+    }
+    try {
+        cache.Store(key, EncodeDds(compressed, false));
+    } catch (const std::runtime_error &) {
+    }
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+    return compressed;
+}
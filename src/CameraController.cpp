@@ -0,0 +1,273 @@
+#include "CameraController.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const float DegreesToRadians = 3.14159265f / 180.f;
+const int ValueCount = 6;
+
+void ToValues(const CameraState &state, float values[ValueCount]) {
+    values[0] = state.theta;
+    values[1] = state.phi;
+    std::copy_n(state.target, 3, values + 2);
+    values[5] = state.fov;
+}
+
+void FromValues(const float values[ValueCount], CameraState &state) {
+    state.theta = values[0];
+    state.phi = values[1];
+    std::copy_n(values + 2, 3, state.target);
+    state.fov = values[5];
+}
+
+// Critically damped spring towards goal over dt, exact for a constant goal
+// up to the approximation of exp (Game Programming Gems 4, 1.10)
+float SmoothDamp(float current, float goal, float &velocity, float smoothTime, float dt) {
+    const float omega = 2.f / smoothTime;
+    const float x = omega * dt;
+    const float decay = 1.f / (1.f + x + 0.48f * x * x + 0.235f * x * x * x);
+    const float change = current - goal;
+    const float temp = (velocity + omega * change) * dt;
+    velocity = (velocity - omega * temp) * decay;
+    return goal + (change + temp) * decay;
+}
+
+void Normalize(float v[3]) {
+    const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int i = 0; i < 3; i++) {
+        v[i] /= length;
+    }
+}
+
+void Cross(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+float Dot(const float a[3], const float b[3]) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+void Multiply(const float a[16], const float b[16], float out[16]) {
+    for (int row = 0; row < 4; row++) {
+        for (int column = 0; column < 4; column++) {
+            float sum = 0.f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[row * 4 + k] * b[k * 4 + column];
+            }
+            out[row * 4 + column] = sum;
+        }
+    }
+}
+
+const float OrbitRadius = 600.f;
+const float NearPlane = 0.1f;
+const float FarPlane = 100000.f;
+} // namespace
+
+CameraMatrices ComputeCameraMatrices(const CameraState &state, float aspect) {
+    CameraMatrices result;
+
+    // Pitch then yaw applied to (0, 0, radius)
+    const float pitch = state.phi * DegreesToRadians;
+    const float yaw = state.theta * DegreesToRadians;
+    const float camera[3] = {OrbitRadius * std::cos(pitch) * std::sin(yaw), -OrbitRadius * std::sin(pitch),
+                             OrbitRadius * std::cos(pitch) * std::cos(yaw)};
+
+    // Looking at the origin, y up
+    const float up[3] = {0.f, 1.f, 0.f};
+    float zAxis[3] = {-camera[0], -camera[1], -camera[2]};
+    Normalize(zAxis);
+    float xAxis[3];
+    Cross(up, zAxis, xAxis);
+    Normalize(xAxis);
+    float yAxis[3];
+    Cross(zAxis, xAxis, yAxis);
+    const float view[16] = {xAxis[0], yAxis[0], zAxis[0], 0.f, //
+                            xAxis[1], yAxis[1], zAxis[1], 0.f, //
+                            xAxis[2], yAxis[2], zAxis[2], 0.f, //
+                            -Dot(xAxis, camera), -Dot(yAxis, camera), -Dot(zAxis, camera), 1.f};
+    std::copy_n(view, 16, result.view);
+
+    const float halfFov = 0.5f * state.fov * DegreesToRadians;
+    const float height = std::cos(halfFov) / std::sin(halfFov);
+    const float range = FarPlane / (FarPlane - NearPlane);
+    const float projection[16] = {height / aspect, 0.f, 0.f, 0.f, //
+                                  0.f, height, 0.f, 0.f,          //
+                                  0.f, 0.f, range, 1.f,           //
+                                  0.f, 0.f, -range * NearPlane, 0.f};
+    std::copy_n(projection, 16, result.projection);
+
+    const float model[16] = {1.f, 0.f, 0.f, 0.f, //
+                             0.f, 1.f, 0.f, 0.f, //
+                             0.f, 0.f, 1.f, 0.f, //
+                             state.target[0], state.target[1], state.target[2], 1.f};
+    float modelView[16];
+    Multiply(model, view, modelView);
+    Multiply(modelView, projection, result.viewProjection);
+
+    for (int i = 0; i < 3; i++) {
+        result.eye[i] = camera[i] - state.target[i];
+    }
+    return result;
+}
+
+CameraController::CameraController(const CameraState &initial, const CameraSettings &settings)
+    : m_settings(settings), m_goal(initial), m_current(initial), m_previous(initial) {}
+
+void CameraController::Reset(const CameraState &state, double time) {
+    Teleport(state);
+    m_time = time;
+    m_started = true;
+    m_haveCursor = false;
+    m_unsampledSince = -1.0;
+}
+
+void CameraController::Teleport(const CameraState &state) {
+    m_goal = m_current = m_previous = state;
+    std::fill_n(m_velocity, ValueCount, 0.f);
+}
+
+void CameraController::Focus(const float center[3], float radius) {
+    for (int i = 0; i < 3; i++) {
+        m_goal.target[i] = -center[i];
+    }
+    const float fov = 2.f * std::atan(1.5f * radius / OrbitRadius) / DegreesToRadians;
+    m_goal.fov = std::clamp(fov, m_settings.minFov, m_settings.maxFov);
+}
+
+void CameraController::Advance(double time, const std::vector<InputEvent> &events) {
+    if (!m_started) {
+        m_time = time;
+        m_started = true;
+    }
+    // After a long stall only the end of it is simulated, the events in it
+    // all land on the first step
+    if (time - m_time > m_settings.maxCatchUp) {
+        m_time = time - m_settings.maxCatchUp;
+    }
+
+    size_t next = 0;
+    while (m_time + m_settings.step <= time) {
+        const double stepEnd = m_time + m_settings.step;
+        for (; next < events.size() && events[next].time <= stepEnd; next++) {
+            Apply(events[next]);
+        }
+        Step();
+    }
+    // The rest falls in the next step, which starts from the same goal
+    for (; next < events.size(); next++) {
+        Apply(events[next]);
+    }
+}
+
+CameraState CameraController::Sample(double time) {
+    if (m_unsampledSince >= 0.0) {
+        const double latency = time - m_unsampledSince;
+        m_latency.last = latency;
+        m_latency.worst = std::max(m_latency.worst, latency);
+        m_latency.total += latency;
+        m_latency.count++;
+        m_unsampledSince = -1.0;
+    }
+
+    // Frames show the state one step back, between the last two steps
+    const float t = (float)std::clamp((time - m_time) / m_settings.step, 0.0, 1.0);
+    float previous[ValueCount], current[ValueCount], result[ValueCount];
+    ToValues(m_previous, previous);
+    ToValues(m_current, current);
+    for (int i = 0; i < ValueCount; i++) {
+        result[i] = previous[i] + (current[i] - previous[i]) * t;
+    }
+    CameraState state;
+    FromValues(result, state);
+    return state;
+}
+
+bool CameraController::IsSettled() const {
+    // Far below what a frame can show, in degrees and map units
+    const float rest = 1e-3f;
+    float goal[ValueCount], current[ValueCount], previous[ValueCount];
+    ToValues(m_goal, goal);
+    ToValues(m_current, current);
+    ToValues(m_previous, previous);
+    for (int i = 0; i < ValueCount; i++) {
+        if (std::abs(goal[i] - current[i]) > rest || std::abs(current[i] - previous[i]) > rest ||
+            std::abs(m_velocity[i]) > rest) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CameraController::Apply(const InputEvent &event) {
+    switch (event.type) {
+    case InputEventType::MouseMove: {
+        // Make sure the mouse is on screen
+        if (event.x < 0 || event.y < 0) {
+            return;
+        }
+        const float dx = m_haveCursor ? (float)m_cursorX - event.x : 0.f;
+        const float dy = m_haveCursor ? (float)m_cursorY - event.y : 0.f;
+        m_haveCursor = true;
+        m_cursorX = event.x;
+        m_cursorY = event.y;
+        if (dx == 0.f && dy == 0.f) {
+            return;
+        }
+
+        if (event.left) {
+            m_goal.theta -= dx * m_settings.degreesPerPixel;
+            m_goal.phi = std::clamp(m_goal.phi + dy * m_settings.degreesPerPixel, m_settings.minPhi,
+                                    m_settings.maxPhi);
+            // Kept in [0, 360) by moving every state a whole turn, smoothing
+            // then never goes the long way around
+            const float turn = m_goal.theta < 0.f ? 360.f : m_goal.theta >= 360.f ? -360.f : 0.f;
+            m_goal.theta += turn;
+            m_current.theta += turn;
+            m_previous.theta += turn;
+        }
+        if (event.right && !event.ctrl) {
+            // Pans on the xz plane along the screen axes
+            const float cosT = std::cos(m_goal.theta * DegreesToRadians);
+            const float sinT = std::sin(m_goal.theta * DegreesToRadians);
+            m_goal.target[0] += (dx * cosT - dy * sinT) * m_settings.panPerPixel;
+            m_goal.target[2] -= (dx * sinT + dy * cosT) * m_settings.panPerPixel;
+        } else if (event.right) {
+            m_goal.target[1] += dy * m_settings.panPerPixel;
+        }
+        break;
+    }
+    case InputEventType::MouseWheel:
+        m_goal.fov = std::clamp(m_goal.fov + event.wheel * m_settings.fovPerWheel, m_settings.minFov,
+                                m_settings.maxFov);
+        break;
+    case InputEventType::KeyDown:
+        return;
+    }
+
+    if (m_unsampledSince < 0.0) {
+        m_unsampledSince = event.time;
+    }
+}
+
+void CameraController::Step() {
+    m_previous = m_current;
+
+    float goal[ValueCount], current[ValueCount];
+    ToValues(m_goal, goal);
+    ToValues(m_current, current);
+    const float dt = (float)m_settings.step;
+    for (int i = 0; i < ValueCount; i++) {
+        if (m_settings.smoothTime > 0.f) {
+            current[i] = SmoothDamp(current[i], goal[i], m_velocity[i], m_settings.smoothTime, dt);
+        } else {
+            current[i] = goal[i];
+            m_velocity[i] = 0.f;
+        }
+    }
+    FromValues(current, m_current);
+
+    m_time += m_settings.step;
+    m_steps++;
+}
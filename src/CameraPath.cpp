@@ -0,0 +1,151 @@
+#include "CameraPath.h"
+
+#include "Utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+CameraState Interpolate(const CameraState &a, const CameraState &b, float t) {
+    CameraState result;
+    result.theta = a.theta + (b.theta - a.theta) * t;
+    result.phi = a.phi + (b.phi - a.phi) * t;
+    for (int i = 0; i < 3; i++) {
+        result.target[i] = a.target[i] + (b.target[i] - a.target[i]) * t;
+    }
+    result.fov = a.fov + (b.fov - a.fov) * t;
+    return result;
+}
+
+struct PathBuilder {
+    CameraState state;
+    std::uint32_t world = 0;
+    double fps = 60.0;
+    std::vector<CameraPathFrame> frames;
+
+    void Emit(const CameraState &camera) {
+        CameraPathFrame frame;
+        frame.time = frames.empty() ? 0.0 : frames.back().time + 1.0 / fps;
+        frame.world = world;
+        frame.camera = camera;
+        frames.push_back(frame);
+    }
+
+    // Frames from the current state to goal, the first motion also shows
+    // where it starts
+    void Move(const CameraState &goal, double seconds) {
+        if (frames.empty()) {
+            Emit(state);
+        }
+        const int steps = (int)std::lround(seconds * fps);
+        for (int i = 1; i <= steps; i++) {
+            Emit(Interpolate(state, goal, (float)i / steps));
+        }
+        state = goal;
+    }
+};
+
+// Values taken by each command, the last one of a motion is its duration
+int ArgumentCount(const std::string &command, int given) {
+    if (command == "fps" || command == "world" || command == "wait") {
+        return 1;
+    }
+    if (command == "orbit" || command == "tilt" || command == "zoom") {
+        return 2;
+    }
+    if (command == "pan") {
+        return 4;
+    }
+    if (command == "camera") {
+        return given > 3 ? 6 : 3;
+    }
+    return -1;
+}
+} // namespace
+
+std::vector<CameraPathFrame> ParseCameraPath(const std::string &text) {
+    std::stringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+    PathBuilder path;
+    const CameraSettings limits;
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        const std::string where = " on camera path line " + std::to_string(lineNumber);
+
+        char name[16] = {};
+        int consumed = 0;
+        if (sscanf(line.c_str(), " %15s%n", name, &consumed) <= 0) {
+            continue;
+        }
+        float v[6] = {};
+        const int given = std::max(0, sscanf(line.c_str() + consumed, "%f %f %f %f %f %f", &v[0], &v[1],
+                                             &v[2], &v[3], &v[4], &v[5]));
+
+        const std::string command = name;
+        const int expected = ArgumentCount(command, given);
+        if (expected < 0) {
+            throw std::runtime_error("Unknown command " + command + where);
+        }
+        if (given != expected) {
+            throw std::runtime_error("Wrong argument count" + where);
+        }
+
+        const float seconds = v[expected - 1];
+        CameraState goal = path.state;
+        if (command == "fps") {
+            if (v[0] <= 0.f) {
+                throw std::runtime_error("Bad frame rate" + where);
+            }
+            path.fps = v[0];
+            continue;
+        }
+        if (command == "world") {
+            if (v[0] < 1.f) {
+                throw std::runtime_error("Bad world" + where);
+            }
+            path.world = (std::uint32_t)v[0] - 1;
+            continue;
+        }
+        if (command == "camera") {
+            path.state.theta = v[0];
+            path.state.phi = std::clamp(v[1], limits.minPhi, limits.maxPhi);
+            path.state.fov = std::clamp(v[2], limits.minFov, limits.maxFov);
+            if (expected == 6) {
+                std::copy_n(v + 3, 3, path.state.target);
+            }
+            continue;
+        }
+
+        if (seconds < 0.f) {
+            throw std::runtime_error("Negative duration" + where);
+        }
+        if (command == "orbit") {
+            goal.theta += v[0];
+        } else if (command == "tilt") {
+            goal.phi = std::clamp(goal.phi + v[0], limits.minPhi, limits.maxPhi);
+        } else if (command == "zoom") {
+            goal.fov = std::clamp(v[0], limits.minFov, limits.maxFov);
+        } else if (command == "pan") {
+            for (int i = 0; i < 3; i++) {
+                goal.target[i] += v[i];
+            }
+        }
+        path.Move(goal, seconds);
+    }
+
+    if (path.frames.empty()) {
+        path.Emit(path.state);
+    }
+    return std::move(path.frames);
+}
+
+std::vector<CameraPathFrame> LoadCameraPath(const std::string &path) {
+    const std::vector<std::uint8_t> data = ReadFile(path.c_str());
+    return ParseCameraPath(std::string(data.begin(), data.end()));
+}
@@ -0,0 +1,162 @@
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+void AddUnique(std::vector<std::string> &names, std::string name) {
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(std::move(name));
+    }
+}
+} // namespace
+
+#ifdef _WIN32
+struct FileWatcher::Impl {
+    std::string path;
+    HANDLE directory = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped{};
+    alignas(DWORD) std::uint8_t buffer[16 * 1024];
+    // Written to but maybe still open, Windows has no IN_CLOSE_WRITE and
+    // reports every write of a save in progress
+    std::vector<std::string> pending;
+
+    void Issue() {
+        ReadDirectoryChangesW(directory, buffer, sizeof(buffer), FALSE,
+                              FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr,
+                              &overlapped, nullptr);
+    }
+};
+
+namespace {
+// A file is done being written once nobody else holds it open for writing:
+// opening it while only sharing reads fails until the writer closes it
+bool WriterClosed(const std::string &path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        // Removed or renamed away since, there is nothing to wait for
+        return GetLastError() != ERROR_SHARING_VIOLATION;
+    }
+    CloseHandle(file);
+    return true;
+}
+} // namespace
+
+FileWatcher::FileWatcher(const std::string &directory) : m_impl(std::make_unique<Impl>()) {
+    m_impl->path = directory;
+    const DWORD share = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    m_impl->directory = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, share, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (m_impl->directory == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not watch directory " + directory);
+    }
+
+    m_impl->overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    m_impl->Issue();
+}
+
+FileWatcher::~FileWatcher() {
+    CancelIo(m_impl->directory);
+    CloseHandle(m_impl->overlapped.hEvent);
+    CloseHandle(m_impl->directory);
+}
+
+std::vector<std::string> FileWatcher::Poll() {
+    std::vector<std::string> names;
+
+    DWORD bytes = 0;
+    while (GetOverlappedResult(m_impl->directory, &m_impl->overlapped, &bytes, FALSE)) {
+        // No bytes means the buffer overflowed and the changes were lost
+        const std::uint8_t *p = m_impl->buffer;
+        while (bytes > 0) {
+            auto info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(p);
+
+            const int length = (int)(info->FileNameLength / sizeof(WCHAR));
+            const int size =
+                WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, nullptr, 0, nullptr, nullptr);
+            std::string name(size, '\0');
+            WideCharToMultiByte(CP_UTF8, 0, info->FileName, length, name.data(), size, nullptr, nullptr);
+
+            if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+                AddUnique(m_impl->pending, std::move(name));
+            }
+
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            p += info->NextEntryOffset;
+        }
+
+        ResetEvent(m_impl->overlapped.hEvent);
+        m_impl->Issue();
+    }
+
+    // Files still open for writing are reported by a later poll
+    std::vector<std::string> &pending = m_impl->pending;
+    auto waiting = std::remove_if(pending.begin(), pending.end(), [&](const std::string &name) {
+        if (!WriterClosed(m_impl->path + "/" + name)) {
+            return false;
+        }
+        names.push_back(name);
+        return true;
+    });
+    pending.erase(waiting, pending.end());
+    return names;
+}
+#else
+struct FileWatcher::Impl {
+    int fd = -1;
+    int watch = -1;
+};
+
+FileWatcher::FileWatcher(const std::string &directory) : m_impl(std::make_unique<Impl>()) {
+    m_impl->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_impl->fd < 0) {
+        throw std::runtime_error("Could not initialize inotify");
+    }
+
+    // Editors either rewrite files in place or save to a temporary file and
+    // rename it over the original
+    m_impl->watch = inotify_add_watch(m_impl->fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (m_impl->watch < 0) {
+        close(m_impl->fd);
+        throw std::runtime_error("Could not watch directory " + directory);
+    }
+}
+
+FileWatcher::~FileWatcher() { close(m_impl->fd); }
+
+std::vector<std::string> FileWatcher::Poll() {
+    std::vector<std::string> names;
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    for (;;) {
+        const ssize_t bytes = read(m_impl->fd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < bytes;) {
+            auto event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            if (event->len > 0) {
+                AddUnique(names, event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return names;
+}
+#endif
@@ -0,0 +1,313 @@
+#include "FontAtlasCache.h"
+
+#include "imgui/imgui.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const char Magic[4] = {'M', 'P', 'F', 'A'};
+// Bump when the layout below changes
+const std::uint32_t FormatVersion = 1;
+
+void AppendBytes(std::vector<std::uint8_t> &out, const void *data, size_t size) {
+    const size_t offset = out.size();
+    out.resize(offset + size);
+    if (size > 0) {
+        memcpy(out.data() + offset, data, size);
+    }
+}
+
+template <typename T> void Append(std::vector<std::uint8_t> &out, const T &value) {
+    AppendBytes(out, &value, sizeof(T));
+}
+
+class AtlasReader {
+public:
+    explicit AtlasReader(const std::vector<std::uint8_t> &in) : m_in(in) {}
+
+    template <typename T> T Read() {
+        T value;
+        ReadBytes(&value, sizeof(T));
+        return value;
+    }
+
+    void ReadBytes(void *out, size_t size) {
+        if (size > m_in.size() - m_offset) {
+            throw std::runtime_error("Truncated font atlas");
+        }
+        memcpy(out, m_in.data() + m_offset, size);
+        m_offset += size;
+    }
+
+    // Element count of an array that follows, checked against what is left
+    std::uint32_t Count(size_t elementSize) {
+        const std::uint32_t count = Read<std::uint32_t>();
+        if (elementSize > 0 && count > (m_in.size() - m_offset) / elementSize) {
+            throw std::runtime_error("Truncated font atlas");
+        }
+        return count;
+    }
+
+    bool AtEnd() const { return m_offset == m_in.size(); }
+
+private:
+    const std::vector<std::uint8_t> &m_in;
+    size_t m_offset = 0;
+};
+
+int FontIndex(const ImFontAtlas &atlas, const ImFont *font) {
+    for (int i = 0; i < atlas.Fonts.Size; i++) {
+        if (atlas.Fonts[i] == font) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+template <typename T> std::uint64_t HashValue(const T &value, std::uint64_t seed) {
+    return HashBytes(&value, sizeof(T), seed);
+}
+} // namespace
+
+std::uint64_t FontAtlasKey(const ImFontAtlas &atlas) {
+    std::uint64_t key = HashBytes(Magic, sizeof(Magic));
+    key = HashValue(FormatVersion, key);
+    // Glyph and rect layouts change between ImGui versions
+    key = HashValue(IMGUI_VERSION_NUM, key);
+    key = HashValue(sizeof(ImFontGlyph), key);
+    key = HashValue(sizeof(ImWchar), key);
+
+    key = HashValue(atlas.Flags, key);
+    key = HashValue(atlas.TexDesiredWidth, key);
+    key = HashValue(atlas.TexGlyphPadding, key);
+    key = HashValue(atlas.FontBuilderFlags, key);
+    key = HashValue(atlas.Fonts.Size, key);
+
+    for (const ImFontConfig &config : atlas.ConfigData) {
+        key = HashBytes(config.FontData, (size_t)config.FontDataSize, key);
+        key = HashValue(config.FontNo, key);
+        key = HashValue(config.SizePixels, key);
+        key = HashValue(config.OversampleH, key);
+        key = HashValue(config.OversampleV, key);
+        key = HashValue(config.PixelSnapH, key);
+        key = HashValue(config.GlyphExtraSpacing, key);
+        key = HashValue(config.GlyphOffset, key);
+        key = HashValue(config.GlyphMinAdvanceX, key);
+        key = HashValue(config.GlyphMaxAdvanceX, key);
+        key = HashValue(config.MergeMode, key);
+        key = HashValue(config.FontBuilderFlags, key);
+        key = HashValue(config.RasterizerMultiply, key);
+        key = HashValue(config.EllipsisChar, key);
+        key = HashValue(FontIndex(atlas, config.DstFont), key);
+
+        // GetGlyphRangesDefault only returns a static table, it is not const
+        const ImWchar *ranges = config.GlyphRanges ? config.GlyphRanges
+                                                   : const_cast<ImFontAtlas &>(atlas).GetGlyphRangesDefault();
+        for (; *ranges; ranges++) {
+            key = HashValue(*ranges, key);
+        }
+    }
+
+    for (const ImFontAtlasCustomRect &rect : atlas.CustomRects) {
+        key = HashValue(rect.Width, key);
+        key = HashValue(rect.Height, key);
+        key = HashValue(rect.GlyphID, key);
+        key = HashValue(rect.GlyphAdvanceX, key);
+        key = HashValue(rect.GlyphOffset, key);
+        key = HashValue(FontIndex(atlas, rect.Font), key);
+    }
+    return key;
+}
+
+std::vector<std::uint8_t> SerializeFontAtlas(const ImFontAtlas &atlas) {
+    if (!atlas.IsBuilt()) {
+        throw std::runtime_error("Font atlas is not built");
+    }
+
+    std::vector<std::uint8_t> data;
+    AppendBytes(data, Magic, sizeof(Magic));
+    Append(data, FormatVersion);
+
+    // Texture, alpha only unless a font brought colors
+    const bool alpha = atlas.TexPixelsAlpha8 != nullptr;
+    const size_t pixelCount = (size_t)atlas.TexWidth * atlas.TexHeight;
+    Append(data, atlas.TexWidth);
+    Append(data, atlas.TexHeight);
+    Append(data, alpha);
+    Append(data, atlas.TexPixelsUseColors);
+    if (alpha) {
+        AppendBytes(data, atlas.TexPixelsAlpha8, pixelCount);
+    } else {
+        AppendBytes(data, atlas.TexPixelsRGBA32, pixelCount * 4);
+    }
+    Append(data, atlas.TexUvWhitePixel);
+    AppendBytes(data, atlas.TexUvLines, sizeof(atlas.TexUvLines));
+    Append(data, atlas.PackIdMouseCursors);
+    Append(data, atlas.PackIdLines);
+
+    Append(data, (std::uint32_t)atlas.CustomRects.Size);
+    for (const ImFontAtlasCustomRect &rect : atlas.CustomRects) {
+        Append(data, rect.Width);
+        Append(data, rect.Height);
+        Append(data, rect.X);
+        Append(data, rect.Y);
+        Append(data, rect.GlyphID);
+        Append(data, rect.GlyphAdvanceX);
+        Append(data, rect.GlyphOffset);
+        Append(data, FontIndex(atlas, rect.Font));
+    }
+
+    Append(data, (std::uint32_t)atlas.Fonts.Size);
+    for (const ImFont *font : atlas.Fonts) {
+        Append(data, font->FontSize);
+        Append(data, font->Ascent);
+        Append(data, font->Descent);
+        Append(data, font->FallbackChar);
+        Append(data, font->EllipsisChar);
+        Append(data, font->DotChar);
+        Append(data, font->MetricsTotalSurface);
+        Append(data, (std::uint32_t)font->Glyphs.Size);
+        AppendBytes(data, font->Glyphs.Data, sizeof(ImFontGlyph) * font->Glyphs.Size);
+    }
+    return data;
+}
+
+void DeserializeFontAtlas(const std::vector<std::uint8_t> &data, ImFontAtlas &atlas) {
+    if (data.size() < sizeof(Magic) || memcmp(data.data(), Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error("Not a font atlas");
+    }
+    AtlasReader reader(data);
+    reader.Read<std::uint32_t>();
+    if (reader.Read<std::uint32_t>() != FormatVersion) {
+        throw std::runtime_error("Unsupported font atlas version");
+    }
+
+    const int width = reader.Read<int>();
+    const int height = reader.Read<int>();
+    const bool alpha = reader.Read<bool>();
+    const bool useColors = reader.Read<bool>();
+    if (width <= 0 || height <= 0 || width > 1 << 15 || height > 1 << 15) {
+        throw std::runtime_error("Bad font atlas size");
+    }
+    const size_t textureBytes = (size_t)width * height * (alpha ? 1 : 4);
+    std::vector<std::uint8_t> pixels(textureBytes);
+    reader.ReadBytes(pixels.data(), textureBytes);
+    const ImVec2 whitePixel = reader.Read<ImVec2>();
+    ImVec4 uvLines[IM_ARRAYSIZE(atlas.TexUvLines)];
+    reader.ReadBytes(uvLines, sizeof(uvLines));
+    const int packIdMouseCursors = reader.Read<int>();
+    const int packIdLines = reader.Read<int>();
+
+    ImVector<ImFontAtlasCustomRect> rects;
+    rects.resize((int)reader.Count(1));
+    for (ImFontAtlasCustomRect &rect : rects) {
+        rect.Width = reader.Read<unsigned short>();
+        rect.Height = reader.Read<unsigned short>();
+        rect.X = reader.Read<unsigned short>();
+        rect.Y = reader.Read<unsigned short>();
+        rect.GlyphID = reader.Read<unsigned int>();
+        rect.GlyphAdvanceX = reader.Read<float>();
+        rect.GlyphOffset = reader.Read<ImVec2>();
+        const int font = reader.Read<int>();
+        if (font >= atlas.Fonts.Size) {
+            throw std::runtime_error("Bad font in font atlas");
+        }
+        rect.Font = font >= 0 ? atlas.Fonts[font] : nullptr;
+    }
+
+    if (reader.Count(0) != (std::uint32_t)atlas.Fonts.Size) {
+        throw std::runtime_error("Font atlas holds other fonts");
+    }
+    // Parsed fully before the atlas is touched, a damaged file leaves it as it was
+    struct FontData {
+        float size, ascent, descent;
+        ImWchar fallback, ellipsis, dot;
+        int surface;
+        ImVector<ImFontGlyph> glyphs;
+    };
+    std::vector<FontData> fonts(atlas.Fonts.Size);
+    for (FontData &font : fonts) {
+        font.size = reader.Read<float>();
+        font.ascent = reader.Read<float>();
+        font.descent = reader.Read<float>();
+        font.fallback = reader.Read<ImWchar>();
+        font.ellipsis = reader.Read<ImWchar>();
+        font.dot = reader.Read<ImWchar>();
+        font.surface = reader.Read<int>();
+        font.glyphs.resize((int)reader.Count(sizeof(ImFontGlyph)));
+        reader.ReadBytes(font.glyphs.Data, sizeof(ImFontGlyph) * font.glyphs.Size);
+        if (font.glyphs.Size == 0) {
+            throw std::runtime_error("Font without glyphs in font atlas");
+        }
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Trailing data in font atlas");
+    }
+
+    atlas.ClearTexData();
+    atlas.TexWidth = width;
+    atlas.TexHeight = height;
+    atlas.TexUvScale = ImVec2(1.f / width, 1.f / height);
+    atlas.TexUvWhitePixel = whitePixel;
+    memcpy(atlas.TexUvLines, uvLines, sizeof(uvLines));
+    atlas.TexPixelsUseColors = useColors;
+    void *texture = IM_ALLOC(textureBytes);
+    memcpy(texture, pixels.data(), textureBytes);
+    if (alpha) {
+        atlas.TexPixelsAlpha8 = static_cast<unsigned char *>(texture);
+    } else {
+        atlas.TexPixelsRGBA32 = static_cast<unsigned int *>(texture);
+    }
+    atlas.CustomRects.swap(rects);
+    atlas.PackIdMouseCursors = packIdMouseCursors;
+    atlas.PackIdLines = packIdLines;
+
+    for (int i = 0; i < atlas.Fonts.Size; i++) {
+        ImFont *font = atlas.Fonts[i];
+        FontData &source = fonts[i];
+        font->ClearOutputData();
+        font->ContainerAtlas = &atlas;
+        font->ConfigData = nullptr;
+        font->ConfigDataCount = 0;
+        for (const ImFontConfig &config : atlas.ConfigData) {
+            if (config.DstFont == font) {
+                font->ConfigData = font->ConfigData ? font->ConfigData : &config;
+                font->ConfigDataCount++;
+            }
+        }
+        font->FontSize = source.size;
+        font->Ascent = source.ascent;
+        font->Descent = source.descent;
+        font->FallbackChar = source.fallback;
+        font->EllipsisChar = source.ellipsis;
+        font->DotChar = source.dot;
+        font->MetricsTotalSurface = source.surface;
+        font->Glyphs.swap(source.glyphs);
+        font->BuildLookupTable();
+    }
+    atlas.TexReady = true;
+}
+
+bool BuildFontAtlasCached(ImFontAtlas &atlas, const AssetCache &cache) {
+    if (atlas.Fonts.empty()) {
+        atlas.AddFontDefault();
+    }
+
+    const std::uint64_t key = FontAtlasKey(atlas);
+    if (std::optional<std::vector<std::uint8_t>> data = cache.Load(key)) {
+        try {
+            DeserializeFontAtlas(*data, atlas);
+            return true;
+        } catch (const std::runtime_error &) {
+            // Damaged entry, overwritten below
+        }
+    }
+
+    atlas.Build();
+    try {
+        cache.Store(key, SerializeFontAtlas(atlas));
+    } catch (const std::runtime_error &) {
+    }
+    return false;
+}
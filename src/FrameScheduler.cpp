@@ -0,0 +1,70 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+FrameScheduler::FrameScheduler(Clock clock, const FrameSchedulerSettings &settings)
+    : m_clock(std::move(clock)), m_settings(settings) {
+    m_lastFrameEnd = m_clock();
+}
+
+void FrameScheduler::MarkDirty(std::uint32_t sources, std::uint32_t frames) {
+    for (int i = 0; i < SourceCount; i++) {
+        if (sources >> i & 1) {
+            m_dirtyFrames[i] = std::max(m_dirtyFrames[i], frames);
+        }
+    }
+}
+
+void FrameScheduler::SetAnimating(std::uint32_t sources, bool animating) {
+    m_animating = animating ? m_animating | sources : m_animating & ~sources;
+}
+
+std::uint32_t FrameScheduler::DirtySources() const {
+    std::uint32_t sources = m_animating;
+    for (int i = 0; i < SourceCount; i++) {
+        sources |= (m_dirtyFrames[i] > 0 ? 1u : 0u) << i;
+    }
+    return sources;
+}
+
+double FrameScheduler::SecondsUntilFrame() const {
+    if (DirtySources() != 0) {
+        return 0.0;
+    }
+    if (m_settings.heartbeat <= 0.0) {
+        // Only dirt wakes the viewer, check back now and then
+        return 1.0;
+    }
+    return std::max(0.0, m_lastFrameEnd + m_settings.heartbeat - m_clock());
+}
+
+void FrameScheduler::BeginFrame() {
+    m_frameStart = m_clock();
+    m_inFrame = true;
+    m_stats.idle += std::max(0.0, m_frameStart - m_lastFrameEnd);
+
+    m_stats.lastReasons = DirtySources();
+    if (m_stats.lastReasons == 0) {
+        m_stats.heartbeats++;
+    }
+    for (std::uint32_t &frames : m_dirtyFrames) {
+        frames = frames > 0 ? frames - 1 : 0;
+    }
+}
+
+void FrameScheduler::EndFrame() {
+    if (!m_inFrame) {
+        return;
+    }
+    m_inFrame = false;
+    m_lastFrameEnd = m_clock();
+
+    const double frame = m_lastFrameEnd - m_frameStart;
+    m_stats.frames++;
+    m_stats.lastFrame = frame;
+    m_stats.worstFrame = std::max(m_stats.worstFrame, frame);
+    m_stats.totalFrame += frame;
+    if (frame > m_settings.budget) {
+        m_stats.overBudget++;
+    }
+}
@@ -0,0 +1,121 @@
+#include "HotReload.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+struct ItemKey {
+    std::uint8_t type;
+    std::uint32_t worldIndex;
+    std::uint32_t roomIndex;
+    std::uint32_t position[3]; // Bit patterns, positions are compared exactly
+
+    ItemKey(const ItemRecord &item)
+        : type(item.type), worldIndex(item.worldIndex), roomIndex(item.roomIndex) {
+        memcpy(&position[0], &item.x, 4);
+        memcpy(&position[1], &item.y, 4);
+        memcpy(&position[2], &item.z, 4);
+    }
+
+    bool operator==(const ItemKey &o) const {
+        return type == o.type && worldIndex == o.worldIndex && roomIndex == o.roomIndex &&
+               memcmp(position, o.position, sizeof(position)) == 0;
+    }
+};
+
+struct ItemKeyHash {
+    size_t operator()(const ItemKey &k) const {
+        std::uint64_t h = 1469598103934665603ull;
+        const std::uint32_t fields[] = {k.type,        k.worldIndex,  k.roomIndex,
+                                        k.position[0], k.position[1], k.position[2]};
+        for (std::uint32_t v : fields) {
+            h = (h ^ v) * 1099511628211ull;
+        }
+        return (size_t)h;
+    }
+};
+
+void AddWorld(std::vector<std::uint32_t> &worlds, std::uint32_t world) {
+    if (std::find(worlds.begin(), worlds.end(), world) == worlds.end()) {
+        worlds.push_back(world);
+    }
+}
+} // namespace
+
+ItemsDiff DiffItems(const std::vector<ItemRecord> &current, const std::vector<ItemRecord> &reloaded) {
+    // Duplicated lines are matched in file order
+    std::unordered_map<ItemKey, std::vector<std::uint32_t>, ItemKeyHash> available;
+    for (std::uint32_t id = (std::uint32_t)reloaded.size(); id-- > 0;) {
+        available[reloaded[id]].push_back(id);
+    }
+
+    ItemsDiff diff;
+    diff.newIds.resize(current.size());
+    std::vector<bool> matched(reloaded.size(), false);
+
+    for (std::uint32_t id = 0; id < current.size(); id++) {
+        auto it = available.find(current[id]);
+        if (it == available.end() || it->second.empty()) {
+            diff.newIds[id] = ItemsDiff::Removed;
+            AddWorld(diff.affectedWorlds, current[id].worldIndex);
+            continue;
+        }
+
+        diff.newIds[id] = it->second.back();
+        matched[it->second.back()] = true;
+        it->second.pop_back();
+    }
+
+    for (std::uint32_t id = 0; id < reloaded.size(); id++) {
+        if (!matched[id]) {
+            diff.added.push_back(id);
+            AddWorld(diff.affectedWorlds, reloaded[id].worldIndex);
+        }
+    }
+
+    std::sort(diff.affectedWorlds.begin(), diff.affectedWorlds.end());
+    return diff;
+}
+
+WorldMeshDiff DiffWorldMesh(const WorldMesh &current, const WorldMesh &reloaded) {
+    WorldMeshDiff diff;
+
+    // In place patches need every room to keep its ranges in the buffers
+    if (current.rooms.size() != reloaded.rooms.size() ||
+        current.vertices.size() != reloaded.vertices.size() ||
+        current.indices.size() != reloaded.indices.size()) {
+        diff.rebuild = true;
+        return diff;
+    }
+    for (size_t i = 0; i < current.rooms.size(); i++) {
+        const RoomMesh &a = current.rooms[i];
+        const RoomMesh &b = reloaded.rooms[i];
+        if (a.firstVertex != b.firstVertex || a.vertexCount != b.vertexCount ||
+            a.firstIndex != b.firstIndex || a.indexCount != b.indexCount) {
+            diff.rebuild = true;
+            return diff;
+        }
+    }
+
+    for (std::uint32_t i = 0; i < current.rooms.size(); i++) {
+        const RoomMesh &room = current.rooms[i];
+
+        // An empty room at the end starts one past the last element, it has
+        // nothing to compare and must not be indexed
+        const bool verticesChanged =
+            room.vertexCount > 0 && memcmp(current.vertices.data() + room.firstVertex,
+                                           reloaded.vertices.data() + room.firstVertex,
+                                           room.vertexCount * sizeof(MeshVertex)) != 0;
+        const bool indicesChanged =
+            room.indexCount > 0 && memcmp(current.indices.data() + room.firstIndex,
+                                          reloaded.indices.data() + room.firstIndex,
+                                          room.indexCount * sizeof(std::uint32_t)) != 0;
+
+        if (verticesChanged || indicesChanged) {
+            diff.dirtyRooms.push_back(i);
+        }
+    }
+
+    return diff;
+}
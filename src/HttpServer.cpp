@@ -0,0 +1,757 @@
+#include "HttpServer.h"
+
+#include "WebSocket.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+// Requests are a line and a few headers, anything longer is refused
+const size_t MaxRequestSize = 16 * 1024;
+const int MaxEvents = 256;
+// Tracker messages are a few bytes, maps are not uploaded
+const size_t MaxMessageSize = 64 * 1024;
+// Frames queued on a client before it is dropped, many seconds of deltas
+const size_t MaxQueuedBytes = 1024 * 1024;
+
+std::string Lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return text;
+}
+
+std::string Trim(const std::string &text) {
+    const size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+// Comma separated list elements, trimmed
+std::vector<std::string> SplitList(const std::string &value) {
+    std::vector<std::string> elements;
+    size_t begin = 0;
+    while (begin <= value.size()) {
+        size_t end = value.find(',', begin);
+        if (end == std::string::npos) {
+            end = value.size();
+        }
+        const std::string element = Trim(value.substr(begin, end - begin));
+        if (!element.empty()) {
+            elements.push_back(element);
+        }
+        begin = end + 1;
+    }
+    return elements;
+}
+
+bool AcceptsGzip(const std::string &acceptEncoding) {
+    for (const std::string &element : SplitList(Lowercase(acceptEncoding))) {
+        const size_t semicolon = element.find(';');
+        const std::string coding = Trim(element.substr(0, semicolon));
+        if (coding != "gzip" && coding != "*") {
+            continue;
+        }
+        // "gzip;q=0" refuses it
+        const size_t q = element.find("q=", semicolon == std::string::npos ? element.size() : semicolon);
+        return q == std::string::npos || atof(element.c_str() + q + 2) > 0.0;
+    }
+    return false;
+}
+
+bool HasToken(const std::string &list, const char *token) {
+    const std::vector<std::string> elements = SplitList(Lowercase(list));
+    return std::find(elements.begin(), elements.end(), token) != elements.end();
+}
+
+// Weak comparison, as If-None-Match asks for
+bool MatchesEtag(const std::string &ifNoneMatch, const std::string &etag) {
+    for (std::string element : SplitList(ifNoneMatch)) {
+        if (element == "*") {
+            return true;
+        }
+        if (element.compare(0, 2, "W/") == 0) {
+            element.erase(0, 2);
+        }
+        if (element == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *StatusText(int status) {
+    switch (status) {
+    case 200:
+        return "OK";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 426:
+        return "Upgrade Required";
+    case 431:
+        return "Request Header Fields Too Large";
+    default:
+        return "Internal Server Error";
+    }
+}
+} // namespace
+
+struct HttpServer::Connection {
+    int fd = -1;
+    std::string input;
+    // Head of the response being sent, small bodies included
+    std::string output;
+    size_t outputSent = 0;
+    int bodyFd = -1;
+    off_t bodyOffset = 0;
+    off_t bodyEnd = 0;
+    bool closeAfter = false;
+    bool failed = false;
+    bool watchingWrites = false;
+
+    // Endpoint path once upgraded to a WebSocket
+    std::string webSocket;
+    // Frames after the output, broadcasts share theirs between clients
+    std::deque<std::shared_ptr<const std::string>> frames;
+    size_t frameSent = 0;
+    size_t queuedBytes = 0;
+    // Fragments of a message still coming in
+    std::string message;
+
+    bool Sending() const { return outputSent < output.size() || bodyFd >= 0 || !frames.empty(); }
+};
+
+HttpServer::HttpServer() {
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wake < 0) {
+        throw std::runtime_error(std::string("Could not create the event loop: ") + strerror(errno));
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_wake;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event);
+}
+
+HttpServer::~HttpServer() {
+    for (auto &[fd, connection] : m_connections) {
+        close(fd);
+    }
+    for (auto &[path, entry] : m_files) {
+        close(entry.fd);
+        if (entry.gzipFd >= 0) {
+            close(entry.gzipFd);
+        }
+    }
+    for (int fd : {m_listen, m_wake, m_timer, m_epoll}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void HttpServer::Add(const std::string &path, const HttpFile &file) {
+    auto open = [](const std::string &name, std::uint64_t &size) {
+        const int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Could not open " + name);
+        }
+        size = (std::uint64_t)info.st_size;
+        return fd;
+    };
+
+    Entry entry;
+    entry.contentType = file.contentType;
+    entry.etag = file.etag;
+    entry.fd = open(file.file, entry.size);
+    if (!file.gzipFile.empty()) {
+        entry.gzipFd = open(file.gzipFile, entry.gzipSize);
+    }
+
+    auto it = m_files.find(path);
+    if (it != m_files.end()) {
+        close(it->second.fd);
+        if (it->second.gzipFd >= 0) {
+            close(it->second.gzipFd);
+        }
+    }
+    m_files[path] = entry;
+}
+
+void HttpServer::AddWebSocket(const std::string &path, const WebSocketEndpoint &endpoint) {
+    m_endpoints[path] = endpoint;
+}
+
+void HttpServer::SetTick(double seconds, std::function<void()> tick) {
+    if (m_timer < 0) {
+        m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (m_timer < 0) {
+            throw std::runtime_error(std::string("Could not create a timer: ") + strerror(errno));
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = m_timer;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_timer, &event);
+    }
+    m_tick = std::move(tick);
+
+    const long long nanoseconds = std::max(1ll, (long long)std::llround(seconds * 1e9));
+    itimerspec interval{};
+    interval.it_interval.tv_sec = (time_t)(nanoseconds / 1000000000);
+    interval.it_interval.tv_nsec = (long)(nanoseconds % 1000000000);
+    interval.it_value = interval.it_interval;
+    timerfd_settime(m_timer, 0, &interval, nullptr);
+}
+
+void HttpServer::Broadcast(const std::string &path, const std::vector<std::uint8_t> &message) {
+    auto it = m_subscribers.find(path);
+    if (it == m_subscribers.end() || it->second.empty()) {
+        return;
+    }
+    m_stats.broadcasts++;
+    auto frame = std::make_shared<std::string>();
+    AppendWebSocketFrame(*frame, WebSocketOpcode::Binary, message.data(), message.size());
+    // Queue can drop clients, which changes the list
+    const std::vector<Connection *> subscribers = it->second;
+    for (Connection *connection : subscribers) {
+        Queue(*connection, frame);
+    }
+}
+
+std::uint16_t HttpServer::Listen(const std::string &address, std::uint16_t port) {
+    sockaddr_in bound{};
+    bound.sin_family = AF_INET;
+    bound.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &bound.sin_addr) != 1) {
+        throw std::runtime_error("Bad address " + address);
+    }
+
+    m_listen = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int on = 1;
+    setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    socklen_t length = sizeof(bound);
+    if (m_listen < 0 || bind(m_listen, (sockaddr *)&bound, sizeof(bound)) != 0 ||
+        listen(m_listen, SOMAXCONN) != 0 || getsockname(m_listen, (sockaddr *)&bound, &length) != 0) {
+        throw std::runtime_error("Could not listen on " + address + ":" + std::to_string(port) + ": " +
+                                 strerror(errno));
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_listen;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listen, &event);
+    return ntohs(bound.sin_port);
+}
+
+void HttpServer::Run() {
+    epoll_event events[MaxEvents];
+    for (;;) {
+        const int count = epoll_wait(m_epoll, events, MaxEvents, -1);
+        if (count < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Event loop failed: ") + strerror(errno));
+        }
+        for (int i = 0; i < count; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == m_wake) {
+                std::uint64_t value;
+                (void)read(m_wake, &value, sizeof(value));
+                return;
+            }
+            if (fd == m_listen) {
+                Accept();
+                continue;
+            }
+            if (fd == m_timer) {
+                std::uint64_t expirations;
+                // Ticks missed while busy are not made up for
+                if (read(m_timer, &expirations, sizeof(expirations)) > 0 && m_tick) {
+                    m_tick();
+                }
+                for (int closing : m_closing) {
+                    Close(closing);
+                }
+                m_closing.clear();
+                continue;
+            }
+            // Closed by an earlier event of the same batch
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) {
+                continue;
+            }
+            Connection &connection = *it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                Close(fd);
+            } else if (events[i].events & EPOLLOUT) {
+                if (Flush(connection)) {
+                    if (connection.failed || connection.closeAfter) {
+                        Close(fd);
+                    } else {
+                        Process(connection);
+                    }
+                }
+            } else if (events[i].events & EPOLLIN) {
+                OnReadable(connection);
+            }
+            for (int closing : m_closing) {
+                Close(closing);
+            }
+            m_closing.clear();
+        }
+    }
+}
+
+void HttpServer::Stop() {
+    const std::uint64_t one = 1;
+    (void)write(m_wake, &one, sizeof(one));
+}
+
+void HttpServer::Accept() {
+    for (;;) {
+        const int fd = accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN once the backlog is empty, anything else (out of files)
+            // is retried on the next wakeup
+            return;
+        }
+        // Responses are written whole, don't hold back their last segment
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        m_connections[fd] = std::move(connection);
+        m_stats.connections++;
+    }
+}
+
+void HttpServer::OnReadable(Connection &connection) {
+    char buffer[4096];
+    for (;;) {
+        const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0) {
+            connection.input.append(buffer, (size_t)received);
+            if (connection.input.size() > MaxRequestSize) {
+                break;
+            }
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        // Closed by the client or reset
+        Close(connection.fd);
+        return;
+    }
+    Process(connection);
+}
+
+void HttpServer::Process(Connection &connection) {
+    if (!connection.webSocket.empty()) {
+        ProcessFrames(connection);
+        return;
+    }
+    while (!connection.Sending() && connection.webSocket.empty()) {
+        const size_t end = connection.input.find("\r\n\r\n");
+        if (end == std::string::npos && connection.input.size() <= MaxRequestSize) {
+            WatchWrites(connection, false);
+            return;
+        }
+        if (end == std::string::npos || end + 4 > MaxRequestSize) {
+            connection.input.clear();
+            Respond(connection, {});
+        } else {
+            const std::string request = connection.input.substr(0, end + 4);
+            connection.input.erase(0, end + 4);
+            Respond(connection, request);
+        }
+
+        if (!Flush(connection)) {
+            // Reading stops until the response is out, pipelined requests
+            // wait in the socket buffer
+            WatchWrites(connection, true);
+            return;
+        }
+        if (connection.failed || connection.closeAfter) {
+            Close(connection.fd);
+            return;
+        }
+    }
+    if (!connection.webSocket.empty()) {
+        ProcessFrames(connection);
+    }
+}
+
+void HttpServer::Respond(Connection &connection, const std::string &request) {
+    m_stats.requests++;
+    auto fail = [&](int status, const char *extra = "") {
+        m_stats.errors++;
+        const std::string body = std::string(StatusText(status)) + "\n";
+        char head[256];
+        snprintf(head, sizeof(head),
+                 "HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n%s"
+                 "Connection: close\r\n\r\n",
+                 status, StatusText(status), body.size(), extra);
+        connection.output = head + body;
+        connection.outputSent = 0;
+        connection.closeAfter = true;
+    };
+    if (request.empty()) {
+        fail(431);
+        return;
+    }
+
+    // Request line: method, target and version
+    const size_t lineEnd = request.find("\r\n");
+    const std::string line = request.substr(0, lineEnd);
+    const size_t space1 = line.find(' ');
+    const size_t space2 = line.find(' ', space1 + 1);
+    if (space1 == std::string::npos || space2 == std::string::npos) {
+        fail(400);
+        return;
+    }
+    const std::string method = line.substr(0, space1);
+    std::string target = line.substr(space1 + 1, space2 - space1 - 1);
+    const std::string version = line.substr(space2 + 1);
+    if (version != "HTTP/1.1" && version != "HTTP/1.0") {
+        fail(400);
+        return;
+    }
+    target = target.substr(0, target.find_first_of("?#"));
+
+    std::string ifNoneMatch, acceptEncoding, connectionHeader, upgrade, webSocketKey, webSocketVersion;
+    size_t begin = lineEnd + 2;
+    while (begin < request.size()) {
+        const size_t end = request.find("\r\n", begin);
+        if (end == begin) {
+            break;
+        }
+        const std::string header = request.substr(begin, end - begin);
+        begin = end + 2;
+        const size_t colon = header.find(':');
+        if (colon == std::string::npos) {
+            fail(400);
+            return;
+        }
+        const std::string name = Lowercase(header.substr(0, colon));
+        const std::string value = Trim(header.substr(colon + 1));
+        if (name == "if-none-match") {
+            ifNoneMatch = value;
+        } else if (name == "accept-encoding") {
+            acceptEncoding = value;
+        } else if (name == "connection") {
+            connectionHeader = Lowercase(value);
+        } else if (name == "upgrade") {
+            upgrade = Lowercase(value);
+        } else if (name == "sec-websocket-key") {
+            webSocketKey = value;
+        } else if (name == "sec-websocket-version") {
+            webSocketVersion = value;
+        }
+    }
+    connection.closeAfter =
+        version == "HTTP/1.0" ? connectionHeader != "keep-alive" : connectionHeader == "close";
+
+    if (method != "GET" && method != "HEAD") {
+        fail(405, "Allow: GET, HEAD\r\n");
+        return;
+    }
+    auto endpoint = m_endpoints.find(target);
+    if (endpoint != m_endpoints.end()) {
+        if (method != "GET" || upgrade != "websocket" || !HasToken(connectionHeader, "upgrade") ||
+            webSocketKey.empty()) {
+            fail(426, "Upgrade: websocket\r\nSec-WebSocket-Version: 13\r\n");
+            return;
+        }
+        if (webSocketVersion != "13") {
+            fail(400, "Sec-WebSocket-Version: 13\r\n");
+            return;
+        }
+        connection.output = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                            "Connection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: " +
+                            WebSocketAccept(webSocketKey) + "\r\n\r\n";
+        connection.outputSent = 0;
+        connection.closeAfter = false;
+        connection.webSocket = target;
+        m_subscribers[target].push_back(&connection);
+        m_stats.webSocketJoins++;
+        if (endpoint->second.onJoin) {
+            const std::vector<std::uint8_t> first = endpoint->second.onJoin();
+            if (!first.empty()) {
+                auto frame = std::make_shared<std::string>();
+                AppendWebSocketFrame(*frame, WebSocketOpcode::Binary, first.data(), first.size());
+                connection.queuedBytes += frame->size();
+                connection.frames.push_back(std::move(frame));
+            }
+        }
+        return;
+    }
+    auto it = m_files.find(target);
+    if (it == m_files.end()) {
+        fail(404);
+        return;
+    }
+
+    const Entry &entry = it->second;
+    const bool gzip = entry.gzipFd >= 0 && AcceptsGzip(acceptEncoding);
+    const std::string etag = "\"" + entry.etag + (gzip ? "-gz" : "") + "\"";
+    const bool notModified = !ifNoneMatch.empty() && MatchesEtag(ifNoneMatch, etag);
+
+    // no-cache keeps clients asking, the ETag makes asking cheap
+    std::string head = notModified ? "HTTP/1.1 304 Not Modified\r\n" : "HTTP/1.1 200 OK\r\n";
+    head += "ETag: " + etag + "\r\nCache-Control: no-cache\r\nAccess-Control-Allow-Origin: *\r\n";
+    if (entry.gzipFd >= 0) {
+        head += "Vary: Accept-Encoding\r\n";
+    }
+    if (!notModified) {
+        head += "Content-Type: " + entry.contentType + "\r\n";
+        head += "Content-Length: " + std::to_string(gzip ? entry.gzipSize : entry.size) + "\r\n";
+        if (gzip) {
+            head += "Content-Encoding: gzip\r\n";
+        }
+    }
+    if (connection.closeAfter) {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+
+    connection.output = std::move(head);
+    connection.outputSent = 0;
+    if (notModified) {
+        m_stats.notModified++;
+    } else if (method == "GET") {
+        connection.bodyFd = gzip ? entry.gzipFd : entry.fd;
+        connection.bodyOffset = 0;
+        connection.bodyEnd = (off_t)(gzip ? entry.gzipSize : entry.size);
+        m_stats.gzipped += gzip ? 1 : 0;
+    }
+}
+
+bool HttpServer::Flush(Connection &connection) {
+    while (connection.outputSent < connection.output.size()) {
+        // MSG_MORE lets the head share a segment with the start of the body
+        const int flags = MSG_NOSIGNAL | (connection.bodyFd >= 0 ? MSG_MORE : 0);
+        const ssize_t sent = send(connection.fd, connection.output.data() + connection.outputSent,
+                                  connection.output.size() - connection.outputSent, flags);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0) {
+            connection.failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return connection.failed;
+        }
+        connection.outputSent += (size_t)sent;
+        m_stats.bytesSent += (std::uint64_t)sent;
+    }
+    connection.output.clear();
+    connection.outputSent = 0;
+
+    while (connection.bodyFd >= 0 && connection.bodyOffset < connection.bodyEnd) {
+        // The offset is ours, several connections share one file
+        const ssize_t sent = sendfile(connection.fd, connection.bodyFd, &connection.bodyOffset,
+                                      (size_t)(connection.bodyEnd - connection.bodyOffset));
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            // 0 would mean the file shrank under us
+            connection.failed = sent == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            if (!connection.failed) {
+                return false;
+            }
+            break;
+        }
+        m_stats.bytesSent += (std::uint64_t)sent;
+    }
+    connection.bodyFd = -1;
+
+    while (!connection.frames.empty()) {
+        const std::string &frame = *connection.frames.front();
+        const ssize_t sent = send(connection.fd, frame.data() + connection.frameSent,
+                                  frame.size() - connection.frameSent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0) {
+            connection.failed = errno != EAGAIN && errno != EWOULDBLOCK;
+            return connection.failed;
+        }
+        connection.frameSent += (size_t)sent;
+        m_stats.bytesSent += (std::uint64_t)sent;
+        if (connection.frameSent == frame.size()) {
+            connection.queuedBytes -= frame.size();
+            connection.frameSent = 0;
+            connection.frames.pop_front();
+        }
+    }
+    return true;
+}
+
+void HttpServer::ProcessFrames(Connection &connection) {
+    const WebSocketEndpoint &endpoint = m_endpoints[connection.webSocket];
+    size_t offset = 0;
+    try {
+        WebSocketFrame frame;
+        while (!connection.closeAfter) {
+            const size_t used = ParseWebSocketFrame(connection.input.data() + offset,
+                                                    connection.input.size() - offset, MaxMessageSize, frame);
+            if (used == 0) {
+                break;
+            }
+            offset += used;
+            if (!frame.masked) {
+                throw std::runtime_error("Unmasked frame from a client");
+            }
+
+            switch (frame.opcode) {
+            case WebSocketOpcode::Continuation:
+            case WebSocketOpcode::Text:
+            case WebSocketOpcode::Binary:
+                connection.message += frame.payload;
+                if (connection.message.size() > MaxMessageSize) {
+                    throw std::runtime_error("WebSocket message too big");
+                }
+                if (frame.final) {
+                    m_stats.webSocketMessages++;
+                    if (endpoint.onMessage) {
+                        endpoint.onMessage(
+                            std::vector<std::uint8_t>(connection.message.begin(), connection.message.end()));
+                    }
+                    connection.message.clear();
+                }
+                break;
+            case WebSocketOpcode::Ping: {
+                auto pong = std::make_shared<std::string>();
+                AppendWebSocketFrame(*pong, WebSocketOpcode::Pong, frame.payload.data(),
+                                     frame.payload.size());
+                Queue(connection, std::move(pong));
+                break;
+            }
+            case WebSocketOpcode::Pong:
+                break;
+            case WebSocketOpcode::Close: {
+                // Echoed, then the connection goes
+                auto echo = std::make_shared<std::string>();
+                AppendWebSocketFrame(*echo, WebSocketOpcode::Close, frame.payload.data(),
+                                     std::min<size_t>(frame.payload.size(), 2));
+                Queue(connection, std::move(echo));
+                connection.closeAfter = true;
+                break;
+            }
+            }
+        }
+    } catch (const std::runtime_error &) {
+        // 1002, protocol error
+        const std::uint8_t code[2] = {0x03, 0xEA};
+        auto close = std::make_shared<std::string>();
+        AppendWebSocketFrame(*close, WebSocketOpcode::Close, code, sizeof(code));
+        Queue(connection, std::move(close));
+        connection.closeAfter = true;
+    }
+    connection.input.erase(0, offset);
+
+    if (connection.failed) {
+        CloseLater(connection.fd);
+    } else if (!Flush(connection)) {
+        WatchWrites(connection, true);
+    } else if (connection.failed || connection.closeAfter) {
+        CloseLater(connection.fd);
+    } else {
+        WatchWrites(connection, false);
+    }
+}
+
+void HttpServer::Queue(Connection &connection, std::shared_ptr<const std::string> frame) {
+    if (connection.failed) {
+        return;
+    }
+    if (connection.queuedBytes + frame->size() > MaxQueuedBytes) {
+        m_stats.dropped++;
+        connection.failed = true;
+        CloseLater(connection.fd);
+        return;
+    }
+    connection.queuedBytes += frame->size();
+    connection.frames.push_back(std::move(frame));
+    // Waiting for the socket already, the frame goes out with the rest
+    if (connection.watchingWrites) {
+        return;
+    }
+    if (!Flush(connection)) {
+        WatchWrites(connection, true);
+    } else if (connection.failed) {
+        CloseLater(connection.fd);
+    }
+}
+
+void HttpServer::WatchWrites(Connection &connection, bool write) {
+    if (connection.watchingWrites == write) {
+        return;
+    }
+    epoll_event event{};
+    event.events = write ? EPOLLOUT : EPOLLIN;
+    event.data.fd = connection.fd;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.watchingWrites = write;
+}
+
+void HttpServer::Close(int fd) {
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end()) {
+        return;
+    }
+    Connection *connection = it->second.get();
+    if (!connection->webSocket.empty()) {
+        std::vector<Connection *> &subscribers = m_subscribers[connection->webSocket];
+        auto subscriber = std::find(subscribers.begin(), subscribers.end(), connection);
+        if (subscriber != subscribers.end()) {
+            *subscriber = subscribers.back();
+            subscribers.pop_back();
+        }
+    }
+    // Closing removes it from the epoll set too
+    close(fd);
+    m_connections.erase(it);
+}
+
+void HttpServer::CloseLater(int fd) {
+    if (std::find(m_closing.begin(), m_closing.end(), fd) == m_closing.end()) {
+        m_closing.push_back(fd);
+    }
+}
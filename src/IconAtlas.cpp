@@ -0,0 +1,137 @@
+#include "IconAtlas.h"
+
+#include "Utility.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// imgui_draw.cpp keeps its own copy of the packer static, so there is none
+// to link against and we do the same here. Like imgui_draw.cpp, the helpers
+// this file doesn't call are not warned about.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#if defined(_MSC_VER)
+#pragma warning(push)
+#pragma warning(disable : 4505) // unreferenced function with internal linkage has been removed
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "imgui/imstb_rectpack.h"
+#if defined(_MSC_VER)
+#pragma warning(pop)
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace {
+int NextPowerOfTwo(int v) {
+    int p = 1;
+    while (p < v) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Rects are packed in units of desc.alignment so every origin ends up aligned
+bool TryPack(std::vector<stbrp_rect> &rects, int width, int height, int alignment) {
+    const int blocksX = width / alignment;
+    const int blocksY = height / alignment;
+
+    std::vector<stbrp_node> nodes(blocksX);
+    stbrp_context context;
+    stbrp_init_target(&context, blocksX, blocksY, nodes.data(), (int)nodes.size());
+
+    for (stbrp_rect &r : rects) {
+        r.was_packed = 0;
+    }
+    return stbrp_pack_rects(&context, rects.data(), (int)rects.size()) == 1;
+}
+
+void BlitWithGutter(IconAtlas &atlas, const IconImage &icon, int x0, int y0, int gutter) {
+    const int w = icon.width + 2 * gutter;
+    const int h = icon.height + 2 * gutter;
+
+    for (int y = 0; y < h; y++) {
+        // Clamping the source coordinates extrudes the border into the gutter
+        const int sy = std::clamp(y - gutter, 0, icon.height - 1);
+        std::uint8_t *dst = &atlas.pixels[((size_t)(y0 + y) * atlas.width + x0) * 4];
+
+        for (int x = 0; x < w; x++) {
+            const int sx = std::clamp(x - gutter, 0, icon.width - 1);
+            memcpy(dst + x * 4, &icon.pixels[((size_t)sy * icon.width + sx) * 4], 4);
+        }
+    }
+}
+} // namespace
+
+IconAtlas BuildIconAtlas(const std::vector<IconImage> &icons, const IconAtlasDesc &desc) {
+    if (desc.alignment <= 0 || (desc.alignment & (desc.alignment - 1)) != 0) {
+        throw std::invalid_argument("Icon atlas alignment must be a power of two");
+    }
+
+    std::vector<stbrp_rect> rects(icons.size());
+    long long area = 0;
+    int minSize = desc.alignment;
+
+    for (size_t i = 0; i < icons.size(); i++) {
+        const int w = RoundToNextMultiple(icons[i].width + 2 * desc.gutter, desc.alignment);
+        const int h = RoundToNextMultiple(icons[i].height + 2 * desc.gutter, desc.alignment);
+
+        rects[i].id = (int)i;
+        rects[i].w = w / desc.alignment;
+        rects[i].h = h / desc.alignment;
+
+        area += (long long)w * h;
+        minSize = std::max({minSize, w, h});
+    }
+
+    // Start from the smallest square that could hold everything and grow
+    // one axis at a time until the packer is happy
+    int width = NextPowerOfTwo(minSize);
+    int height = width;
+    while ((long long)width * height < area) {
+        (width <= height ? width : height) *= 2;
+    }
+    if (width > desc.maxSize || height > desc.maxSize) {
+        throw std::runtime_error("Icons do not fit in the maximum atlas size");
+    }
+
+    while (!TryPack(rects, width, height, desc.alignment)) {
+        (width <= height ? width : height) *= 2;
+        if (width > desc.maxSize || height > desc.maxSize) {
+            throw std::runtime_error("Icons do not fit in the maximum atlas size");
+        }
+    }
+
+    IconAtlas atlas;
+    atlas.width = width;
+    atlas.height = height;
+    atlas.pixels.assign((size_t)width * height * 4, 0);
+    atlas.uvs.resize(icons.size());
+
+    for (const stbrp_rect &r : rects) {
+        const IconImage &icon = icons[r.id];
+        const int x0 = r.x * desc.alignment;
+        const int y0 = r.y * desc.alignment;
+
+        BlitWithGutter(atlas, icon, x0, y0, desc.gutter);
+
+        AtlasUV &uv = atlas.uvs[r.id];
+        uv.u0 = (float)(x0 + desc.gutter) / width;
+        uv.v0 = (float)(y0 + desc.gutter) / height;
+        uv.u1 = (float)(x0 + desc.gutter + icon.width) / width;
+        uv.v1 = (float)(y0 + desc.gutter + icon.height) / height;
+    }
+
+    return atlas;
+}
+
+int IconAtlasSafeMipCount(const IconAtlasDesc &desc) {
+    int count = 1;
+    for (int a = desc.alignment; a > 1; a >>= 1) {
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,48 @@
+#include "IconQuads.h"
+
+#include <cmath>
+
+namespace {
+// Column of the upper 3x3 of view, scaled to length
+void ViewAxis(const float view[16], int column, float length, float axis[3]) {
+    for (int i = 0; i < 3; i++) {
+        axis[i] = view[i * 4 + column];
+    }
+    const float scale = length / std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int i = 0; i < 3; i++) {
+        axis[i] *= scale;
+    }
+}
+} // namespace
+
+void BuildIconQuads(const std::vector<ItemRecord> &items, const std::vector<std::uint32_t> &ids,
+                    const std::vector<AtlasUV> &uvs, const float view[16], float size,
+                    std::vector<IconQuad> &quads, const std::uint32_t *tints) {
+    float right[3], up[3];
+    ViewAxis(view, 0, size * 0.5f, right);
+    ViewAxis(view, 1, size * 0.5f, up);
+
+    // Corners as signs of right and up, with the matching uv corner
+    static const float Corners[6][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, -1}, {-1, 1}, {1, 1}};
+
+    quads.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        const ItemRecord &item = items[ids[i]];
+        const float position[3] = {item.x, item.z, item.y};
+        const AtlasUV &uv = uvs[item.type < uvs.size() ? item.type : 0];
+
+        IconQuad &quad = quads[i];
+        for (int v = 0; v < 6; v++) {
+            const float sx = Corners[v][0], sy = Corners[v][1];
+            for (int c = 0; c < 3; c++) {
+                quad.pos[v][c] = position[c] + sx * right[c] + sy * up[c];
+            }
+            quad.uvs[v][0] = sx < 0.f ? uv.u0 : uv.u1;
+            quad.uvs[v][1] = sy < 0.f ? uv.v1 : uv.v0;
+        }
+        const std::uint32_t tint = tints ? tints[ids[i]] : 0xFFFFFFFFu;
+        for (int c = 0; c < 4; c++) {
+            quad.tint[c] = (float)((tint >> (c * 8)) & 0xFF) / 255.f;
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#include "IconSdf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+// Distance of cells without any set cell in reach, squared distances of real
+// cells never get close
+const float Far = 1e20f;
+
+// Lower envelope of the parabolas (q - v)^2 + f[v], d[q] gets its minimum and
+// arg[q] the v reaching it. v and z are scratch of n and n + 1 entries.
+void Transform1D(const float *f, int n, float *d, std::int32_t *arg, std::int32_t *v, float *z) {
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<float>::infinity();
+    z[1] = std::numeric_limits<float>::infinity();
+    for (int q = 1; q < n; q++) {
+        float s;
+        while (true) {
+            const int p = v[k];
+            s = ((f[q] + (float)q * q) - (f[p] + (float)p * p)) / (2.f * (q - p));
+            if (s > z[k]) {
+                break;
+            }
+            k--;
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<float>::infinity();
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        const int p = v[k];
+        d[q] = (float)(q - p) * (q - p) + f[p];
+        arg[q] = p;
+    }
+}
+
+float Bilinear(const IconImage &image, float x, float y, int channel) {
+    x = std::clamp(x, 0.f, (float)(image.width - 1));
+    y = std::clamp(y, 0.f, (float)(image.height - 1));
+    const int x0 = (int)x, y0 = (int)y;
+    const int x1 = std::min(x0 + 1, image.width - 1), y1 = std::min(y0 + 1, image.height - 1);
+    const float fx = x - x0, fy = y - y0;
+    auto at = [&](int px, int py) {
+        return (float)image.pixels[((size_t)py * image.width + px) * 4 + channel];
+    };
+    const float top = at(x0, y0) + (at(x1, y0) - at(x0, y0)) * fx;
+    const float bottom = at(x0, y1) + (at(x1, y1) - at(x0, y1)) * fx;
+    return top + (bottom - top) * fy;
+}
+} // namespace
+
+void SquaredDistanceTransform(const std::vector<std::uint8_t> &mask, int width, int height,
+                              std::vector<float> &distances, std::vector<std::int32_t> *nearest) {
+    const size_t cells = (size_t)width * height;
+    const int longest = std::max(width, height);
+    std::vector<float> f(longest), d(longest), z(longest + 1);
+    std::vector<std::int32_t> arg(longest), v(longest);
+
+    // Columns first, keeping the row of the nearest set cell
+    std::vector<float> columns(cells);
+    std::vector<std::int32_t> rows(cells);
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            f[y] = mask[(size_t)y * width + x] ? 0.f : Far;
+        }
+        Transform1D(f.data(), height, d.data(), arg.data(), v.data(), z.data());
+        for (int y = 0; y < height; y++) {
+            columns[(size_t)y * width + x] = d[y];
+            rows[(size_t)y * width + x] = arg[y];
+        }
+    }
+
+    // Then rows over the column distances
+    distances.resize(cells);
+    if (nearest) {
+        nearest->resize(cells);
+    }
+    for (int y = 0; y < height; y++) {
+        const size_t row = (size_t)y * width;
+        Transform1D(&columns[row], width, &distances[row], arg.data(), v.data(), z.data());
+        if (nearest) {
+            for (int x = 0; x < width; x++) {
+                (*nearest)[row + x] =
+                    distances[row + x] >= Far ? -1 : rows[row + arg[x]] * width + arg[x];
+            }
+        }
+    }
+}
+
+IconImage GenerateIconSdf(const IconImage &icon, const SdfDesc &desc) {
+    if (desc.scale < 1 || desc.supersample < 1 || desc.spread <= 0.f) {
+        throw std::invalid_argument("Invalid icon SDF settings");
+    }
+    const int sub = desc.scale * desc.supersample;
+    const int fineWidth = icon.width * sub;
+    const int fineHeight = icon.height * sub;
+
+    // Silhouette of the bilinear filtered alpha, so diagonal runs of pixels
+    // come out as smooth edges instead of stairs
+    std::vector<std::uint8_t> inside((size_t)fineWidth * fineHeight);
+    std::vector<std::uint8_t> outside(inside.size());
+    for (int y = 0; y < fineHeight; y++) {
+        const float sy = (y + 0.5f) / sub - 0.5f;
+        for (int x = 0; x < fineWidth; x++) {
+            const float sx = (x + 0.5f) / sub - 0.5f;
+            const bool in = Bilinear(icon, sx, sy, 3) >= desc.threshold;
+            inside[(size_t)y * fineWidth + x] = in;
+            outside[(size_t)y * fineWidth + x] = !in;
+        }
+    }
+    std::vector<float> toInside, toOutside;
+    SquaredDistanceTransform(inside, fineWidth, fineHeight, toInside);
+    SquaredDistanceTransform(outside, fineWidth, fineHeight, toOutside);
+
+    // Colors of the pixels under the threshold come from the nearest one above
+    std::vector<std::uint8_t> solid((size_t)icon.width * icon.height);
+    for (size_t i = 0; i < solid.size(); i++) {
+        solid[i] = icon.pixels[i * 4 + 3] >= desc.threshold;
+    }
+    std::vector<float> unused;
+    std::vector<std::int32_t> nearestSolid;
+    SquaredDistanceTransform(solid, icon.width, icon.height, unused, &nearestSolid);
+
+    IconImage sdf;
+    sdf.width = icon.width * desc.scale;
+    sdf.height = icon.height * desc.scale;
+    sdf.pixels.resize((size_t)sdf.width * sdf.height * 4);
+    const float toAlpha = 1.f / (2.f * desc.spread * desc.supersample);
+    for (int y = 0; y < sdf.height; y++) {
+        for (int x = 0; x < sdf.width; x++) {
+            // Signed distance in fine texels, the edge lies halfway between
+            // an inside and an outside texel
+            float distance = 0.f;
+            for (int fy = y * desc.supersample; fy < (y + 1) * desc.supersample; fy++) {
+                for (int fx = x * desc.supersample; fx < (x + 1) * desc.supersample; fx++) {
+                    const size_t i = (size_t)fy * fineWidth + fx;
+                    distance += inside[i] ? std::sqrt(toOutside[i]) - 0.5f : 0.5f - std::sqrt(toInside[i]);
+                }
+            }
+            distance /= (float)(desc.supersample * desc.supersample);
+
+            std::uint8_t *out = &sdf.pixels[((size_t)y * sdf.width + x) * 4];
+            const int source = (y / desc.scale) * icon.width + x / desc.scale;
+            const int colorSource = solid[source] ? source : nearestSolid[source];
+            if (colorSource >= 0) {
+                memcpy(out, &icon.pixels[(size_t)colorSource * 4], 3);
+            }
+            out[3] = (std::uint8_t)(std::clamp(0.5f + distance * toAlpha, 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
+    return sdf;
+}
+
+std::vector<IconImage> GenerateIconSdfs(const std::vector<IconImage> &icons, const SdfDesc &desc,
+                                        ThreadPool &pool) {
+    std::vector<IconImage> sdfs(icons.size());
+    pool.ParallelFor((std::uint32_t)icons.size(),
+                     [&](std::uint32_t i) { sdfs[i] = GenerateIconSdf(icons[i], desc); });
+    return sdfs;
+}
+
+IconImage RenderIconSdf(const IconImage &sdf, int width, int height) {
+    IconImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+
+    const float scaleX = (float)sdf.width / width;
+    const float scaleY = (float)sdf.height / height;
+    auto alphaAt = [&](int x, int y) {
+        return Bilinear(sdf, (x + 0.5f) * scaleX - 0.5f, (y + 0.5f) * scaleY - 0.5f, 3) / 255.f;
+    };
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const float sx = (x + 0.5f) * scaleX - 0.5f;
+            const float sy = (y + 0.5f) * scaleY - 0.5f;
+            std::uint8_t *out = &image.pixels[((size_t)y * width + x) * 4];
+            for (int c = 0; c < 3; c++) {
+                out[c] = (std::uint8_t)(Bilinear(sdf, sx, sy, c) + 0.5f);
+            }
+
+            // fwidth, from the neighbours to the right and below
+            const float alpha = alphaAt(x, y);
+            const float change = std::abs(alphaAt(x + 1, y) - alpha) + std::abs(alphaAt(x, y + 1) - alpha);
+            const float coverage = std::clamp((alpha - 0.5f) / std::max(change, 1e-5f) + 0.5f, 0.f, 1.f);
+            out[3] = (std::uint8_t)(coverage * 255.f + 0.5f);
+        }
+    }
+    return image;
+}
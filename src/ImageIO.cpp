@@ -22,14 +22,18 @@
 
 #include "ImageIO.h"
 
+#include "PngDecoder.h"
+#include "ThreadPool.h"
 #include "Utility.h"
 
+#include <stdexcept>
+
+#ifdef _WIN32
 #include <Windows.h>
 #include <wincodec.h>
 #include <wrl.h>
 // for _com_error
 #include <comdef.h>
-#include <stdexcept>
 #define SAFE_WIC(expr)                                                                                       \
     do {                                                                                                     \
         const auto r = expr;                                                                                 \
@@ -45,7 +49,36 @@ using namespace Microsoft::WRL;
 #undef LoadImage
 
 namespace {
-std::vector<std::uint8_t> LoadInternal(ComPtr<IWICImagingFactory> factory, ComPtr<IWICStream> stream,
+// The factory is free threaded, one is created for the whole process and
+// never released so it can't outlive COM at exit
+IWICImagingFactory *WicFactory() {
+    static IWICImagingFactory *factory = []() {
+        IWICImagingFactory *result = nullptr;
+        HRESULT hr =
+            CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&result));
+
+        if (FAILED(hr)) {
+            throw std::runtime_error("Could not create WIC factory");
+        }
+        return result;
+    }();
+    return factory;
+}
+
+// Only formats other than PNG need COM, pool threads join the multithreaded
+// apartment while they decode
+struct ComScope {
+    ComScope() : hr(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+    ~ComScope() {
+        if (SUCCEEDED(hr)) {
+            CoUninitialize();
+        }
+    }
+
+    HRESULT hr;
+};
+
+std::vector<std::uint8_t> LoadInternal(IWICImagingFactory *factory, ComPtr<IWICStream> stream,
                                        const int rowAlignment, int *outputWidth, int *outputHeight) {
     ComPtr<IWICBitmapDecoder> decoder;
     factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
@@ -79,43 +112,49 @@ std::vector<std::uint8_t> LoadInternal(ComPtr<IWICImagingFactory> factory, ComPt
 }
 } // namespace
 
-std::vector<std::uint8_t> LoadImageFromFile(const char *path, const int rowAlignment, int *outputWidth,
-                                            int *outputHeight) {
-    ComPtr<IWICImagingFactory> factory;
-    HRESULT hr =
-        CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
-
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create WIC factory");
-    }
-
-    ComPtr<IWICBitmapDecoder> decoder;
-
-    std::vector<wchar_t> pathWchar(::strlen(path) + 1);
-    mbstowcs(pathWchar.data(), path, pathWchar.size());
+std::vector<std::uint8_t> LoadImageFromMemoryWic(const void *data, const std::size_t size,
+                                                 const int rowAlignment, int *outputWidth,
+                                                 int *outputHeight) {
+    IWICImagingFactory *factory = WicFactory();
 
     ComPtr<IWICStream> stream;
     factory->CreateStream(&stream);
-    stream->InitializeFromFilename(pathWchar.data(), GENERIC_READ);
+
+    // This is fine here as the memory will live on when the stream is long gone
+    stream->InitializeFromMemory(static_cast<BYTE *>(const_cast<void *>(data)), static_cast<DWORD>(size));
 
     return LoadInternal(factory, stream, rowAlignment, outputWidth, outputHeight);
 }
+#endif
+
+std::vector<std::uint8_t> LoadImageFromFile(const char *path, const int rowAlignment, int *outputWidth,
+                                            int *outputHeight) {
+    const std::vector<std::uint8_t> data = ReadFile(path);
+    return LoadImageFromMemory(data.data(), data.size(), rowAlignment, outputWidth, outputHeight);
+}
 
 std::vector<std::uint8_t> LoadImageFromMemory(const void *data, const std::size_t size,
                                               const int rowAlignment, int *outputWidth, int *outputHeight) {
-    ComPtr<IWICImagingFactory> factory;
-    HRESULT hr =
-        CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
-
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create WIC factory");
+    if (IsPng(data, size)) {
+        return DecodePng(data, size, rowAlignment, outputWidth, outputHeight);
     }
 
-    ComPtr<IWICStream> stream;
-    factory->CreateStream(&stream);
-
-    // This is fine here as the memory will live on when the stream is long gone
-    stream->InitializeFromMemory(static_cast<BYTE *>(const_cast<void *>(data)), static_cast<DWORD>(size));
+#ifdef _WIN32
+    return LoadImageFromMemoryWic(data, size, rowAlignment, outputWidth, outputHeight);
+#else
+    throw std::runtime_error("Only PNG images are supported on this platform");
+#endif
+}
 
-    return LoadInternal(factory, stream, rowAlignment, outputWidth, outputHeight);
+std::vector<DecodedImage> LoadImagesFromFiles(const std::vector<std::string> &paths, const int rowAlignment,
+                                              ThreadPool &pool) {
+    std::vector<DecodedImage> images(paths.size());
+    pool.ParallelFor((std::uint32_t)paths.size(), [&](std::uint32_t i) {
+#ifdef _WIN32
+        const ComScope com;
+#endif
+        images[i].pixels =
+            LoadImageFromFile(paths[i].c_str(), rowAlignment, &images[i].width, &images[i].height);
+    });
+    return images;
 }
@@ -0,0 +1,279 @@
+#include "InputLog.h"
+
+#include "Utility.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const char Magic[4] = {'M', 'P', 'I', 'R'};
+const std::uint8_t Version = 1;
+
+// Event header byte: type in the low bits, then the mouse buttons
+const std::uint8_t TypeMask = 0x3;
+const std::uint8_t LeftFlag = 1 << 2;
+const std::uint8_t RightFlag = 1 << 3;
+const std::uint8_t CtrlFlag = 1 << 4;
+
+class LogWriter {
+public:
+    explicit LogWriter(std::vector<std::uint8_t> &out) : m_out(out) {}
+
+    void Byte(std::uint8_t value) { m_out.push_back(value); }
+
+    void Varint(std::uint64_t value) {
+        while (value >= 0x80) {
+            m_out.push_back((std::uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        m_out.push_back((std::uint8_t)value);
+    }
+
+    void Signed(std::int64_t value) { Varint(((std::uint64_t)value << 1) ^ (std::uint64_t)(value >> 63)); }
+
+    void Float(float value) {
+        std::uint8_t bytes[sizeof(float)];
+        memcpy(bytes, &value, sizeof(float));
+        m_out.insert(m_out.end(), bytes, bytes + sizeof(float));
+    }
+
+private:
+    std::vector<std::uint8_t> &m_out;
+};
+
+class LogReader {
+public:
+    explicit LogReader(const std::vector<std::uint8_t> &in) : m_in(in) {}
+
+    std::uint8_t Byte() {
+        if (m_offset >= m_in.size()) {
+            throw std::runtime_error("Truncated input log");
+        }
+        return m_in[m_offset++];
+    }
+
+    std::uint64_t Varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const std::uint8_t byte = Byte();
+            value |= (std::uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Bad varint in input log");
+    }
+
+    std::int64_t Signed() {
+        const std::uint64_t value = Varint();
+        return (std::int64_t)(value >> 1) ^ -(std::int64_t)(value & 1);
+    }
+
+    float Float() {
+        if (m_offset + sizeof(float) > m_in.size()) {
+            throw std::runtime_error("Truncated input log");
+        }
+        float value;
+        memcpy(&value, m_in.data() + m_offset, sizeof(float));
+        m_offset += sizeof(float);
+        return value;
+    }
+
+    bool AtEnd() const { return m_offset == m_in.size(); }
+
+private:
+    const std::vector<std::uint8_t> &m_in;
+    size_t m_offset = 0;
+};
+
+std::int16_t ToInt16(std::int64_t value) {
+    if (value < INT16_MIN || value > INT16_MAX) {
+        throw std::runtime_error("Bad value in input log");
+    }
+    return (std::int16_t)value;
+}
+} // namespace
+
+void InputRecorder::Start(const ViewerSnapshot &snapshot, double time) {
+    m_log = {};
+    m_log.snapshot = snapshot;
+    m_start = time;
+    m_recording = true;
+}
+
+void InputRecorder::Record(const std::vector<InputEvent> &events) {
+    if (!m_recording) {
+        return;
+    }
+    for (InputEvent event : events) {
+        // Came in before the recording started
+        if (event.time < m_start) {
+            continue;
+        }
+        event.time -= m_start;
+        m_log.events.push_back(event);
+    }
+}
+
+InputLog InputRecorder::Stop() {
+    m_recording = false;
+    return std::move(m_log);
+}
+
+void QueueReplay(const InputLog &log, double start, InputQueue &queue) {
+    for (InputEvent event : log.events) {
+        event.time += start;
+        queue.Push(event);
+    }
+}
+
+std::vector<std::uint8_t> SerializeInputLog(const InputLog &log) {
+    std::vector<std::uint8_t> data(Magic, Magic + sizeof(Magic));
+    LogWriter writer(data);
+    writer.Byte(Version);
+
+    const ViewerSnapshot &snapshot = log.snapshot;
+    writer.Varint(snapshot.world);
+    writer.Float(snapshot.iconSize);
+    writer.Byte(ItemTypeCount);
+    for (bool type : snapshot.filter.types) {
+        writer.Byte(type);
+    }
+    writer.Signed(snapshot.filter.firstRoom);
+    writer.Signed(snapshot.filter.lastRoom);
+    writer.Byte(snapshot.filter.hideCollected);
+    writer.Byte(snapshot.portalCulling);
+    writer.Float(snapshot.camera.theta);
+    writer.Float(snapshot.camera.phi);
+    for (float t : snapshot.camera.target) {
+        writer.Float(t);
+    }
+    writer.Float(snapshot.camera.fov);
+
+    writer.Varint(log.events.size());
+    std::int64_t previousTime = 0;
+    std::int16_t previousX = 0, previousY = 0;
+    for (const InputEvent &event : log.events) {
+        std::uint8_t header = (std::uint8_t)event.type;
+        header |= event.left ? LeftFlag : 0;
+        header |= event.right ? RightFlag : 0;
+        header |= event.ctrl ? CtrlFlag : 0;
+        writer.Byte(header);
+
+        // Events are in order, a negative delta can only come from a bad log
+        const std::int64_t time = std::llround(event.time * 1e6);
+        writer.Varint((std::uint64_t)std::max<std::int64_t>(time - previousTime, 0));
+        previousTime = std::max(time, previousTime);
+
+        switch (event.type) {
+        case InputEventType::MouseMove:
+            writer.Signed(event.x - previousX);
+            writer.Signed(event.y - previousY);
+            previousX = event.x;
+            previousY = event.y;
+            break;
+        case InputEventType::MouseWheel:
+            writer.Signed(event.wheel);
+            break;
+        case InputEventType::KeyDown:
+            writer.Byte(event.key);
+            break;
+        }
+    }
+    return data;
+}
+
+InputLog DeserializeInputLog(const std::vector<std::uint8_t> &data) {
+    if (data.size() < sizeof(Magic) || memcmp(data.data(), Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error("Not an input log");
+    }
+    LogReader reader(data);
+    for (size_t i = 0; i < sizeof(Magic); i++) {
+        reader.Byte();
+    }
+    if (reader.Byte() != Version) {
+        throw std::runtime_error("Unsupported input log version");
+    }
+
+    InputLog log;
+    ViewerSnapshot &snapshot = log.snapshot;
+    snapshot.world = (std::uint32_t)reader.Varint();
+    snapshot.iconSize = reader.Float();
+    // Types added later are shown, types no longer known are dropped
+    const int typeCount = reader.Byte();
+    for (int i = 0; i < typeCount; i++) {
+        const bool shown = reader.Byte() != 0;
+        if (i < ItemTypeCount) {
+            snapshot.filter.types[i] = shown;
+        }
+    }
+    snapshot.filter.firstRoom = (int)reader.Signed();
+    snapshot.filter.lastRoom = (int)reader.Signed();
+    snapshot.filter.hideCollected = reader.Byte() != 0;
+    snapshot.portalCulling = reader.Byte() != 0;
+    snapshot.camera.theta = reader.Float();
+    snapshot.camera.phi = reader.Float();
+    for (float &t : snapshot.camera.target) {
+        t = reader.Float();
+    }
+    snapshot.camera.fov = reader.Float();
+
+    const std::uint64_t count = reader.Varint();
+    // Every event takes at least two bytes
+    if (count > data.size()) {
+        throw std::runtime_error("Truncated input log");
+    }
+    log.events.resize((size_t)count);
+    std::uint64_t time = 0;
+    std::int64_t x = 0, y = 0;
+    for (InputEvent &event : log.events) {
+        const std::uint8_t header = reader.Byte();
+        if ((header & TypeMask) > (std::uint8_t)InputEventType::KeyDown) {
+            throw std::runtime_error("Bad event in input log");
+        }
+        event.type = (InputEventType)(header & TypeMask);
+        event.left = (header & LeftFlag) != 0;
+        event.right = (header & RightFlag) != 0;
+        event.ctrl = (header & CtrlFlag) != 0;
+
+        time += reader.Varint();
+        event.time = (double)time * 1e-6;
+
+        switch (event.type) {
+        case InputEventType::MouseMove:
+            x += reader.Signed();
+            y += reader.Signed();
+            event.x = ToInt16(x);
+            event.y = ToInt16(y);
+            break;
+        case InputEventType::MouseWheel:
+            event.wheel = ToInt16(reader.Signed());
+            break;
+        case InputEventType::KeyDown:
+            event.key = reader.Byte();
+            break;
+        }
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Trailing data in input log");
+    }
+    return log;
+}
+
+void SaveInputLog(const std::string &path, const InputLog &log) {
+    const std::vector<std::uint8_t> data = SerializeInputLog(log);
+    FILE *handle = std::fopen(path.c_str(), "wb");
+    if (!handle) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    const size_t written = std::fwrite(data.data(), 1, data.size(), handle);
+    std::fclose(handle);
+    if (written != data.size()) {
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+InputLog LoadInputLog(const std::string &path) { return DeserializeInputLog(ReadFile(path.c_str())); }
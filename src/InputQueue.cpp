@@ -0,0 +1,48 @@
+#include "InputQueue.h"
+
+#include <algorithm>
+
+InputQueue::InputQueue(Clock clock) : m_clock(std::move(clock)) {}
+
+void InputQueue::PushMouseMove(std::int16_t x, std::int16_t y, bool left, bool right, bool ctrl) {
+    InputEvent event;
+    event.type = InputEventType::MouseMove;
+    event.time = m_clock();
+    event.x = x;
+    event.y = y;
+    event.left = left;
+    event.right = right;
+    event.ctrl = ctrl;
+    m_events.push_back(event);
+}
+
+void InputQueue::PushMouseWheel(std::int16_t wheel) {
+    InputEvent event;
+    event.type = InputEventType::MouseWheel;
+    event.time = m_clock();
+    event.wheel = wheel;
+    m_events.push_back(event);
+}
+
+void InputQueue::PushKeyDown(std::uint8_t key) {
+    InputEvent event;
+    event.type = InputEventType::KeyDown;
+    event.time = m_clock();
+    event.key = key;
+    m_events.push_back(event);
+}
+
+void InputQueue::Push(const InputEvent &event) {
+    // Stamped events can come in late, keep the queue in time order
+    auto at = std::upper_bound(m_events.begin(), m_events.end(), event.time,
+                               [](double time, const InputEvent &e) { return time < e.time; });
+    m_events.insert(at, event);
+}
+
+std::vector<InputEvent> InputQueue::Drain(double time) {
+    auto end = std::upper_bound(m_events.begin(), m_events.end(), time,
+                                [](double t, const InputEvent &e) { return t < e.time; });
+    std::vector<InputEvent> drained(m_events.begin(), end);
+    m_events.erase(m_events.begin(), end);
+    return drained;
+}
@@ -0,0 +1,217 @@
+#include "ItemBrowser.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+// Value of an item in a column, every column sorts as a number
+float ColumnValue(const ItemRecord &item, const ItemIndex &index, std::uint32_t id, ItemColumn column) {
+    switch (column) {
+    case ItemColumn_Type:
+        return item.type;
+    case ItemColumn_World:
+        return (float)item.worldIndex;
+    case ItemColumn_Room:
+        return (float)item.roomIndex;
+    case ItemColumn_X:
+        return item.x;
+    case ItemColumn_Y:
+        return item.y;
+    case ItemColumn_Z:
+        return item.z;
+    case ItemColumn_Collected:
+    case ItemColumnCount:
+        break;
+    }
+    return index.IsCollected(id) ? 1.f : 0.f;
+}
+
+// Float bits reordered so unsigned comparisons follow the float order
+std::uint32_t SortableBits(float value) {
+    // -0 and 0 are equal
+    value = value == 0.f ? 0.f : value;
+    std::uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+} // namespace
+
+void SortItemIds(const std::vector<ItemRecord> &items, const ItemIndex &index,
+                 const std::vector<ItemSortKey> &keys, std::vector<std::uint32_t> &ids) {
+    std::sort(ids.begin(), ids.end());
+
+    // One pass per key from the last to the first. Each sorts the key in the
+    // high half of a 64 bit word and the current position in the low half,
+    // so equal keys keep the order of the previous pass. Plain integer sorts
+    // are several times faster than comparing item records.
+    std::vector<std::uint64_t> packed(ids.size());
+    std::vector<std::uint32_t> sorted(ids.size());
+    for (auto key = keys.rbegin(); key != keys.rend(); ++key) {
+        for (std::uint32_t row = 0; row < ids.size(); row++) {
+            const std::uint32_t id = ids[row];
+            const std::uint32_t order = SortableBits(ColumnValue(items[id], index, id, key->column));
+            packed[row] = (std::uint64_t)(key->descending ? ~order : order) << 32 | row;
+        }
+        std::sort(packed.begin(), packed.end());
+        for (size_t row = 0; row < packed.size(); row++) {
+            sorted[row] = ids[(std::uint32_t)packed[row]];
+        }
+        ids.swap(sorted);
+    }
+}
+
+bool ItemBrowser::DependsOnCollected() const {
+    if (m_collected != 0) {
+        return true;
+    }
+    for (const ItemSortKey &key : m_sortKeys) {
+        if (key.column == ItemColumn_Collected) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ItemBrowser::RebuildRows(const std::vector<ItemRecord> &items, const ItemIndex &index) {
+    auto start = std::chrono::steady_clock::now();
+
+    ItemQuery query = ItemQuery::All();
+    if (m_type >= 0) {
+        query = query & ItemQuery::Type((std::uint8_t)m_type);
+    }
+    if (m_world > 0) {
+        query = query & ItemQuery::World((std::uint32_t)m_world);
+    }
+    if (m_collected == 1) {
+        query = query & ItemQuery::Collected();
+    } else if (m_collected == 2) {
+        query = query & !ItemQuery::Collected();
+    }
+    m_rows = query.Evaluate(index).ToVector();
+    SortItemIds(items, index, m_sortKeys, m_rows);
+    m_rowsDirty = false;
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_stats.rebuildMs = std::chrono::duration<double, std::milli>(elapsed).count();
+    m_stats.rebuilds++;
+    m_stats.rows = (std::uint32_t)m_rows.size();
+}
+
+bool ItemBrowser::Draw(const std::vector<ItemRecord> &items, ItemIndex &index, float height) {
+    auto start = std::chrono::steady_clock::now();
+    bool collectedChanged = false;
+
+    // Index ids only cover the items it was built from
+    if (index.Size() != items.size()) {
+        m_rowsDirty = true;
+        m_rows.clear();
+        ImGui::TextUnformatted("Item index out of date");
+        return false;
+    }
+
+    ImGui::PushItemWidth(ImGui::GetFontSize() * 7.f);
+    auto typeLabel = [](int type) { return type < 0 ? "All types" : ItemTypeName((std::uint8_t)type); };
+    if (ImGui::BeginCombo("##type", typeLabel(m_type))) {
+        for (int type = -1; type < ItemTypeCount; type++) {
+            if (ImGui::Selectable(typeLabel(type), type == m_type)) {
+                m_type = type;
+                m_rowsDirty = true;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    ImGui::SameLine();
+    const char *worldFormat = m_world == 0 ? "All worlds" : "World %d";
+    m_rowsDirty |= ImGui::DragInt("##world", &m_world, 0.1f, 0, 99, worldFormat);
+    ImGui::SameLine();
+    m_rowsDirty |= ImGui::Combo("##collected", &m_collected, "All\0Collected\0Missing\0");
+    ImGui::PopItemWidth();
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_SortMulti |
+                                  ImGuiTableFlags_ScrollY | ImGuiTableFlags_RowBg |
+                                  ImGuiTableFlags_BordersOuter | ImGuiTableFlags_BordersV |
+                                  ImGuiTableFlags_Resizable | ImGuiTableFlags_Hideable;
+    if (ImGui::BeginTable("items", ItemColumnCount, flags, ImVec2(0.f, height))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Type", ImGuiTableColumnFlags_DefaultSort, 0.f, ItemColumn_Type);
+        ImGui::TableSetupColumn("World", 0, 0.f, ItemColumn_World);
+        ImGui::TableSetupColumn("Room", 0, 0.f, ItemColumn_Room);
+        ImGui::TableSetupColumn("X", 0, 0.f, ItemColumn_X);
+        ImGui::TableSetupColumn("Y", 0, 0.f, ItemColumn_Y);
+        ImGui::TableSetupColumn("Z", 0, 0.f, ItemColumn_Z);
+        ImGui::TableSetupColumn("Collected", 0, 0.f, ItemColumn_Collected);
+        ImGui::TableHeadersRow();
+
+        if (ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs()) {
+            if (specs->SpecsDirty) {
+                m_sortKeys.clear();
+                for (int i = 0; i < specs->SpecsCount; i++) {
+                    const ImGuiTableColumnSortSpecs &spec = specs->Specs[i];
+                    m_sortKeys.push_back({(ItemColumn)spec.ColumnUserID,
+                                          spec.SortDirection == ImGuiSortDirection_Descending});
+                }
+                specs->SpecsDirty = false;
+                m_rowsDirty = true;
+            }
+        }
+        if (m_rowsDirty) {
+            RebuildRows(items, index);
+        }
+
+        if (m_scrollItem >= 0) {
+            const auto row = std::find(m_rows.begin(), m_rows.end(), (std::uint32_t)m_scrollItem);
+            m_scrollRow = row != m_rows.end() ? (int)(row - m_rows.begin()) : m_scrollRow;
+            m_scrollItem = -1;
+        }
+        if (m_scrollRow >= 0 && m_rowHeight > 0.f) {
+            ImGui::SetScrollY(m_scrollRow * m_rowHeight);
+            m_scrollRow = -1;
+        }
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)m_rows.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                const std::uint32_t id = m_rows[row];
+                const ItemRecord &item = items[id];
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(ItemTypeName(item.type));
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", item.worldIndex);
+                ImGui::TableNextColumn();
+                ImGui::Text("%u", item.roomIndex);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", item.x);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", item.y);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", item.z);
+                ImGui::TableNextColumn();
+                bool collected = index.IsCollected(id);
+                ImGui::PushID((int)id);
+                if (ImGui::Checkbox("##collected", &collected)) {
+                    index.SetCollected(id, collected);
+                    collectedChanged = true;
+                }
+                ImGui::PopID();
+            }
+        }
+        m_rowHeight = clipper.ItemsHeight > 0.f ? clipper.ItemsHeight : m_rowHeight;
+        ImGui::EndTable();
+    }
+
+    // Rows stay where they are while clicking through them unless they
+    // are filtered or sorted by the flag
+    if (collectedChanged && DependsOnCollected()) {
+        m_rowsDirty = true;
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_stats.drawUs = std::chrono::duration<double, std::micro>(elapsed).count();
+    return collectedChanged;
+}
@@ -0,0 +1,59 @@
+#include "ItemData.h"
+
+#include <fstream>
+#include <sstream>
+
+std::vector<ItemRecord> ParseItemsData(const std::string &text) {
+    std::vector<ItemRecord> items;
+    std::stringstream lines(text);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        if (line.empty() || line[0] == '\r') {
+            continue;
+        }
+
+        std::stringstream ss(line);
+        unsigned char itemType = 0;
+        ss >> itemType;
+        itemType -= '0';
+        ss.ignore();
+        std::uint32_t worldIndex = 0;
+        ss >> worldIndex;
+        ss.ignore();
+        std::uint32_t roomIndex = 0;
+        ss >> roomIndex;
+
+        ss.ignore();
+
+        float x, y, z;
+        ss >> x;
+        ss.ignore(2);
+        ss >> y;
+        ss.ignore(2);
+        ss >> z;
+
+        items.push_back({itemType, worldIndex, roomIndex, x, y, z});
+    }
+
+    return items;
+}
+
+std::vector<ItemRecord> LoadItemsData(const char *path) {
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+
+    return ParseItemsData(ss.str());
+}
+
+const char *ItemTypeName(std::uint8_t type) {
+    switch (type) {
+    case ItemType_EnergyTank:
+        return "Energy Tank";
+    case ItemType_Missile:
+        return "Missile Expansion";
+    default:
+        return "Unknown";
+    }
+}
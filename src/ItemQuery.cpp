@@ -0,0 +1,166 @@
+#include "ItemQuery.h"
+
+#include <optional>
+
+namespace {
+const RoaringBitmap EmptyBitmap;
+}
+
+void ItemIndex::Build(const std::vector<ItemRecord> &items) {
+    m_size = (std::uint32_t)items.size();
+    m_types.clear();
+    m_worlds.clear();
+    m_rooms.clear();
+    m_collected.assign((m_size + 63) / 64, 0);
+
+    // Ids are visited in order, every Add below takes the append path
+    for (std::uint32_t id = 0; id < m_size; id++) {
+        const ItemRecord &item = items[id];
+
+        if (item.type >= m_types.size()) {
+            m_types.resize(item.type + 1);
+        }
+        m_types[item.type].Add(id);
+        m_worlds[item.worldIndex].Add(id);
+        m_rooms[RoomKey(item.worldIndex, item.roomIndex)].Add(id);
+    }
+}
+
+const RoaringBitmap &ItemIndex::Type(std::uint8_t type) const {
+    return type < m_types.size() ? m_types[type] : EmptyBitmap;
+}
+
+const RoaringBitmap &ItemIndex::World(std::uint32_t worldIndex) const {
+    auto it = m_worlds.find(worldIndex);
+    return it != m_worlds.end() ? it->second : EmptyBitmap;
+}
+
+const RoaringBitmap &ItemIndex::Room(std::uint32_t worldIndex, std::uint32_t roomIndex) const {
+    auto it = m_rooms.find(RoomKey(worldIndex, roomIndex));
+    return it != m_rooms.end() ? it->second : EmptyBitmap;
+}
+
+RoaringBitmap ItemIndex::Rooms(std::uint32_t worldIndex, std::uint32_t firstRoom,
+                               std::uint32_t lastRoom) const {
+    std::vector<const RoaringBitmap *> rooms;
+    if (firstRoom > lastRoom) {
+        return RoaringBitmap();
+    }
+    if (lastRoom - firstRoom >= m_rooms.size()) {
+        // Wider than the rooms there are, "every room" is up to UINT32_MAX
+        for (const auto &[key, bitmap] : m_rooms) {
+            const std::uint32_t room = (std::uint32_t)key;
+            if ((key >> 32) == worldIndex && room >= firstRoom && room <= lastRoom) {
+                rooms.push_back(&bitmap);
+            }
+        }
+    } else {
+        // A 64 bit counter, lastRoom may be the largest 32 bit index
+        for (std::uint64_t room = firstRoom; room <= lastRoom; room++) {
+            const RoaringBitmap &r = Room(worldIndex, (std::uint32_t)room);
+            if (!r.Empty()) {
+                rooms.push_back(&r);
+            }
+        }
+    }
+    return RoaringBitmap::OrMany(rooms);
+}
+
+void ItemIndex::SetCollected(std::uint32_t id, bool collected) {
+    const std::uint64_t mask = 1ull << (id & 63);
+    if (collected) {
+        m_collected[id >> 6] |= mask;
+    } else {
+        m_collected[id >> 6] &= ~mask;
+    }
+}
+
+void ItemIndex::ClearCollected() { std::fill(m_collected.begin(), m_collected.end(), 0); }
+
+RoaringBitmap ItemIndex::Collected() const {
+    return RoaringBitmap::FromWords(m_collected.data(), m_collected.size());
+}
+
+ItemQuery ItemQuery::All() {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::All, {}, nullptr, nullptr}));
+}
+
+ItemQuery ItemQuery::Type(std::uint8_t type) {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::Type, {type}, nullptr, nullptr}));
+}
+
+ItemQuery ItemQuery::World(std::uint32_t worldIndex) {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::World, {worldIndex}, nullptr, nullptr}));
+}
+
+ItemQuery ItemQuery::Rooms(std::uint32_t worldIndex, std::uint32_t firstRoom, std::uint32_t lastRoom) {
+    return ItemQuery(
+        std::make_shared<const Node>(Node{Op::Rooms, {worldIndex, firstRoom, lastRoom}, nullptr, nullptr}));
+}
+
+ItemQuery ItemQuery::Collected() {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::Collected, {}, nullptr, nullptr}));
+}
+
+ItemQuery ItemQuery::operator&(const ItemQuery &other) const {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::And, {}, m_node, other.m_node}));
+}
+
+ItemQuery ItemQuery::operator|(const ItemQuery &other) const {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::Or, {}, m_node, other.m_node}));
+}
+
+ItemQuery ItemQuery::operator!() const {
+    return ItemQuery(std::make_shared<const Node>(Node{Op::Not, {}, m_node, nullptr}));
+}
+
+RoaringBitmap ItemQuery::Evaluate(const ItemIndex &index) const { return Evaluate(*m_node, index); }
+
+RoaringBitmap ItemQuery::Evaluate(const Node &node, const ItemIndex &index) {
+    switch (node.op) {
+    case Op::All:
+        return index.All();
+    case Op::Type:
+        return index.Type((std::uint8_t)node.args[0]);
+    case Op::World:
+        return index.World(node.args[0]);
+    case Op::Rooms:
+        return index.Rooms(node.args[0], node.args[1], node.args[2]);
+    case Op::Collected:
+        return index.Collected();
+    case Op::And:
+        // a & !b is a single difference, no need to build the complement of b
+        if (node.rhs->op == Op::Not) {
+            return RoaringBitmap::AndNot(Evaluate(*node.lhs, index), Evaluate(*node.rhs->lhs, index));
+        }
+        if (node.lhs->op == Op::Not) {
+            return RoaringBitmap::AndNot(Evaluate(*node.rhs, index), Evaluate(*node.lhs->lhs, index));
+        }
+        return RoaringBitmap::And(Evaluate(*node.lhs, index), Evaluate(*node.rhs, index));
+    case Op::Or:
+        return RoaringBitmap::Or(Evaluate(*node.lhs, index), Evaluate(*node.rhs, index));
+    case Op::Not:
+        return RoaringBitmap::AndNot(index.All(), Evaluate(*node.lhs, index));
+    }
+
+    return RoaringBitmap();
+}
+
+std::vector<std::uint32_t> ApplyItemFilter(const ItemIndex &index, const ItemFilter &filter,
+                                           std::uint32_t worldIndex) {
+    std::optional<ItemQuery> types;
+    for (int i = 0; i < ItemTypeCount; i++) {
+        if (filter.types[i]) {
+            types = types ? (*types | ItemQuery::Type(i)) : ItemQuery::Type(i);
+        }
+    }
+    if (!types) {
+        return {};
+    }
+
+    ItemQuery query = ItemQuery::Rooms(worldIndex, filter.firstRoom, filter.lastRoom) & *types;
+    if (filter.hideCollected) {
+        query = query & !ItemQuery::Collected();
+    }
+    return query.Evaluate(index).ToVector();
+}
@@ -0,0 +1,405 @@
+#include "Json.h"
+
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_SSE2 1
+#endif
+
+namespace {
+[[noreturn]] void Fail(const char *message, std::size_t offset) {
+    throw std::runtime_error(std::string("JSON: ") + message + " at byte " + std::to_string(offset));
+}
+
+// One bit per byte of a 64 byte block
+struct BlockMasks {
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    std::uint64_t op = 0;
+    std::uint64_t space = 0;
+};
+
+#ifdef JSON_SSE2
+std::uint64_t Matches(const __m128i chunks[4], char c) {
+    const __m128i value = _mm_set1_epi8(c);
+    std::uint64_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+        mask |= (std::uint64_t)(std::uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], value)) << (i * 16);
+    }
+    return mask;
+}
+
+BlockMasks Classify(const char *block) {
+    __m128i chunks[4];
+    for (int i = 0; i < 4; i++) {
+        chunks[i] = _mm_loadu_si128((const __m128i *)(block + i * 16));
+    }
+    BlockMasks masks;
+    masks.quote = Matches(chunks, '"');
+    masks.backslash = Matches(chunks, '\\');
+    masks.op = Matches(chunks, '{') | Matches(chunks, '}') | Matches(chunks, '[') | Matches(chunks, ']') |
+               Matches(chunks, ':') | Matches(chunks, ',');
+    masks.space =
+        Matches(chunks, ' ') | Matches(chunks, '\n') | Matches(chunks, '\r') | Matches(chunks, '\t');
+    return masks;
+}
+#else
+BlockMasks Classify(const char *block) {
+    BlockMasks masks;
+    for (int i = 0; i < 64; i++) {
+        const std::uint64_t bit = 1ull << i;
+        switch (block[i]) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks.op |= bit;
+            break;
+        case ' ':
+        case '\n':
+        case '\r':
+        case '\t':
+            masks.space |= bit;
+            break;
+        }
+    }
+    return masks;
+}
+#endif
+
+// Bit i is the xor of bits 0 to i: set from an opening quote up to the byte
+// before the closing one
+std::uint64_t PrefixXor(std::uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+bool IsDelimiter(char c) {
+    switch (c) {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+    case '"':
+    case ' ':
+    case '\n':
+    case '\r':
+    case '\t':
+        return true;
+    default:
+        return false;
+    }
+}
+
+int HexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// The 4 hex digits after a \u, -1 when they aren't
+int ReadHex4(const char *p) {
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        const int digit = HexDigit(p[i]);
+        if (digit < 0) {
+            return -1;
+        }
+        value = value << 4 | digit;
+    }
+    return value;
+}
+
+char *AppendUtf8(char *out, std::uint32_t code) {
+    if (code < 0x80) {
+        *out++ = (char)code;
+    } else if (code < 0x800) {
+        *out++ = (char)(0xC0 | code >> 6);
+        *out++ = (char)(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        *out++ = (char)(0xE0 | code >> 12);
+        *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+        *out++ = (char)(0x80 | (code & 0x3F));
+    } else {
+        *out++ = (char)(0xF0 | code >> 18);
+        *out++ = (char)(0x80 | (code >> 12 & 0x3F));
+        *out++ = (char)(0x80 | (code >> 6 & 0x3F));
+        *out++ = (char)(0x80 | (code & 0x3F));
+    }
+    return out;
+}
+} // namespace
+
+// Structurals are the operators outside strings, opening quotes and the first
+// byte of every scalar. Quotes after an odd run of backslashes don't count,
+// those runs are rare enough to be walked bit by bit.
+void JsonDocument::FindStructurals(const char *text, std::size_t size) {
+    m_structurals.clear();
+    std::uint64_t inStringCarry = 0;
+    std::uint64_t escapeCarry = 0;
+    std::uint64_t scalarCarry = 0;
+    char padded[64];
+    for (std::size_t base = 0; base < size; base += 64) {
+        const char *block = text + base;
+        if (size - base < 64) {
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, size - base);
+            block = padded;
+        }
+        BlockMasks masks = Classify(block);
+
+        std::uint64_t escaped = escapeCarry;
+        escapeCarry = 0;
+        for (std::uint64_t backslashes = masks.backslash; backslashes; backslashes &= backslashes - 1) {
+            const int bit = std::countr_zero(backslashes);
+            if (escaped >> bit & 1) {
+                continue;
+            }
+            if (bit == 63) {
+                escapeCarry = 1;
+            } else {
+                escaped |= 1ull << (bit + 1);
+            }
+        }
+        const std::uint64_t quotes = masks.quote & ~escaped;
+        const std::uint64_t inString = PrefixXor(quotes) ^ inStringCarry;
+        inStringCarry = (std::uint64_t)((std::int64_t)inString >> 63);
+
+        const std::uint64_t scalar = ~(masks.op | masks.space | quotes | inString);
+        const std::uint64_t scalarStart = scalar & ~(scalar << 1 | scalarCarry);
+        scalarCarry = scalar >> 63;
+
+        for (std::uint64_t bits = (masks.op & ~inString) | (quotes & inString) | scalarStart; bits;
+             bits &= bits - 1) {
+            m_structurals.push_back((std::uint32_t)(base + std::countr_zero(bits)));
+        }
+    }
+    if (inStringCarry) {
+        Fail("unterminated string", size);
+    }
+}
+
+// Unescapes the string opening at offset where it is, returns the node
+std::uint32_t JsonDocument::String(std::uint32_t offset) {
+    char *src = m_text + offset + 1;
+    char *out = src;
+    for (;;) {
+        const char c = *src;
+        if (c == '"') {
+            break;
+        }
+        if ((unsigned char)c < 0x20) {
+            Fail("control character in string", src - m_text);
+        }
+        if (c != '\\') {
+            *out++ = *src++;
+            continue;
+        }
+        const char escape = src[1];
+        src += 2;
+        switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = escape;
+            break;
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u': {
+            // The closing quote stops a short escape before the end
+            std::int32_t code = ReadHex4(src);
+            if (code < 0) {
+                Fail("bad \\u escape", src - m_text);
+            }
+            src += 4;
+            if (code >= 0xD800 && code < 0xDC00) {
+                const int low = src[0] == '\\' && src[1] == 'u' ? ReadHex4(src + 2) : -1;
+                if (low < 0xDC00 || low >= 0xE000) {
+                    Fail("unpaired surrogate", src - m_text);
+                }
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                src += 6;
+            } else if (code >= 0xDC00 && code < 0xE000) {
+                Fail("unpaired surrogate", src - m_text);
+            }
+            out = AppendUtf8(out, (std::uint32_t)code);
+            break;
+        }
+        default:
+            Fail("bad escape", src - 1 - m_text);
+        }
+    }
+    const std::uint32_t start = offset + 1;
+    const std::uint32_t index = (std::uint32_t)m_nodes.size();
+    m_nodes.push_back({JsonType::String, start, (std::uint32_t)(out - (m_text + start)), index + 1});
+    return index;
+}
+
+void JsonDocument::Scalar(std::uint32_t offset, std::size_t size) {
+    std::size_t end = offset;
+    while (end < size && !IsDelimiter(m_text[end])) {
+        end++;
+    }
+    const std::string_view text(m_text + offset, end - offset);
+    JsonType type = JsonType::Number;
+    if (text == "true") {
+        type = JsonType::True;
+    } else if (text == "false") {
+        type = JsonType::False;
+    } else if (text == "null") {
+        type = JsonType::Null;
+    } else {
+        // from_chars also takes inf, nan and leading zeros, JSON doesn't
+        const size_t first = text[0] == '-' ? 1 : 0;
+        const bool digit = first < text.size() && std::isdigit((unsigned char)text[first]);
+        const bool leadingZero = first + 1 < text.size() && text[first] == '0' &&
+                                 std::isdigit((unsigned char)text[first + 1]);
+        double value;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (!digit || leadingZero || result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+            Fail("bad value", offset);
+        }
+    }
+    m_nodes.push_back({type, offset, (std::uint32_t)text.size(), (std::uint32_t)m_nodes.size() + 1});
+}
+
+void JsonDocument::Parse(std::string &text) {
+    if (text.size() >= None) {
+        throw std::runtime_error("JSON: text over 4 GB");
+    }
+    m_text = text.data();
+    m_nodes.clear();
+    m_open.clear();
+    FindStructurals(text.data(), text.size());
+
+    enum class Expect { Value, ValueOrClose, Key, KeyOrClose, Colon, CommaOrClose, Nothing };
+    Expect expect = Expect::Value;
+    auto afterValue = [this] { return m_open.empty() ? Expect::Nothing : Expect::CommaOrClose; };
+    for (std::uint32_t offset : m_structurals) {
+        const char c = m_text[offset];
+        const bool inObject = !m_open.empty() && m_nodes[m_open.back()].type == JsonType::Object;
+        switch (expect) {
+        case Expect::Nothing:
+            Fail("trailing characters", offset);
+        case Expect::Colon:
+            if (c != ':') {
+                Fail("expected a colon", offset);
+            }
+            expect = Expect::Value;
+            continue;
+        case Expect::CommaOrClose:
+            if (c == ',') {
+                expect = inObject ? Expect::Key : Expect::Value;
+                continue;
+            }
+            if (c != (inObject ? '}' : ']')) {
+                Fail("expected a comma or the end of the container", offset);
+            }
+            break;
+        case Expect::KeyOrClose:
+        case Expect::ValueOrClose:
+            if (c == (expect == Expect::KeyOrClose ? '}' : ']')) {
+                break;
+            }
+            [[fallthrough]];
+        default:
+            if (expect == Expect::Key || expect == Expect::KeyOrClose) {
+                if (c != '"') {
+                    Fail("expected a key", offset);
+                }
+                String(offset);
+                expect = Expect::Colon;
+                continue;
+            }
+            switch (c) {
+            case '{':
+            case '[':
+                m_open.push_back((std::uint32_t)m_nodes.size());
+                m_nodes.push_back({c == '{' ? JsonType::Object : JsonType::Array, offset, 0, 0});
+                expect = c == '{' ? Expect::KeyOrClose : Expect::ValueOrClose;
+                continue;
+            case '"':
+                String(offset);
+                break;
+            case '}':
+            case ']':
+            case ':':
+            case ',':
+                Fail("expected a value", offset);
+            default:
+                Scalar(offset, text.size());
+                break;
+            }
+            expect = afterValue();
+            continue;
+        }
+
+        // The container at the top closes
+        m_nodes[m_open.back()].end = (std::uint32_t)m_nodes.size();
+        m_open.pop_back();
+        expect = afterValue();
+    }
+    if (expect != Expect::Nothing) {
+        Fail("unexpected end", text.size());
+    }
+}
+
+double JsonDocument::Number(std::uint32_t index) const {
+    if (m_nodes[index].type != JsonType::Number) {
+        return 0.0;
+    }
+    double value = 0.0;
+    const std::string_view text = Text(index);
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+std::uint32_t JsonDocument::Find(std::uint32_t object, std::string_view key) const {
+    std::uint32_t found = None;
+    ForEachMember(object, [&](std::uint32_t name, std::uint32_t value) {
+        if (found == None && Text(name) == key) {
+            found = value;
+        }
+    });
+    return found;
+}
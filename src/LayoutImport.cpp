@@ -0,0 +1,163 @@
+#include "LayoutImport.h"
+
+#include "AssetCache.h"
+
+#include <array>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+// Region names of the worlds in items.data order
+const std::array<const char *, 7> RegionNames{"Frigate Orpheon", "Chozo Ruins",   "Phendrana Drifts",
+                                              "Tallon Overworld", "Phazon Mines", "Magmoor Caverns",
+                                              "Impact Crater"};
+
+// Hash of the lower case letters and digits of a name
+std::uint64_t NameHash(std::string_view name, std::uint64_t seed = HashSeed) {
+    char normalized[256];
+    size_t length = 0;
+    for (char c : name) {
+        if (std::isalnum((unsigned char)c) && length < sizeof(normalized)) {
+            normalized[length++] = (char)std::tolower((unsigned char)c);
+        }
+    }
+    return HashBytes(normalized, length, seed);
+}
+
+// "02_Main_Plaza_MAP.580" to "Main_Plaza"
+std::string_view RoomName(std::string_view object) {
+    const size_t first = object.find('_');
+    if (first == std::string_view::npos) {
+        return object;
+    }
+    object.remove_prefix(first + 1);
+    return object.substr(0, object.rfind("_MAP"));
+}
+} // namespace
+
+const char *LayoutRegionName(std::uint32_t worldIndex) {
+    return worldIndex >= 1 && worldIndex <= RegionNames.size() ? RegionNames[worldIndex - 1] : "";
+}
+
+int PickupItemType(std::string_view pickup) {
+    char prefix[16];
+    size_t length = 0;
+    for (char c : pickup) {
+        if (std::isalnum((unsigned char)c) && length < sizeof(prefix)) {
+            prefix[length++] = (char)std::tolower((unsigned char)c);
+        }
+    }
+    const std::string_view name(prefix, length);
+    if (name.starts_with("energytank")) {
+        return ItemType_EnergyTank;
+    }
+    if (name.starts_with("missile")) {
+        return ItemType_Missile;
+    }
+    return -1;
+}
+
+LayoutImporter::LayoutImporter(const std::vector<ItemRecord> &locations) : m_locations(locations) {
+    for (std::uint32_t i = 0; i < RegionNames.size(); i++) {
+        m_worlds[NameHash(RegionNames[i])] = i + 1;
+    }
+    // Also known as
+    m_worlds[NameHash("Space Pirate Frigate")] = 1;
+}
+
+void LayoutImporter::AddWorld(std::uint32_t worldIndex, const WorldMesh &mesh) {
+    for (const RoomMesh &room : mesh.rooms) {
+        if (room.roomIndex < 0) {
+            continue;
+        }
+        const std::uint64_t key = NameHash(RoomName(room.name), worldIndex);
+        const auto [slot, added] = m_rooms.emplace(key, (std::uint32_t)m_roomLocations.size());
+        if (!added) {
+            continue;
+        }
+        m_roomLocations.emplace_back();
+        for (std::uint32_t i = 0; i < m_locations.size(); i++) {
+            const ItemRecord &location = m_locations[i];
+            if (location.worldIndex == worldIndex && location.roomIndex == (std::uint32_t)room.roomIndex) {
+                m_roomLocations.back().push_back(i);
+            }
+        }
+    }
+}
+
+void LayoutImporter::AddLocation(std::uint32_t worldIndex, std::string_view location, std::string_view pickup,
+                                 LayoutPlacement &placement) const {
+    placement.locations++;
+    const auto room = worldIndex ? m_rooms.find(NameHash(location.substr(0, location.find('/')), worldIndex))
+                                 : m_rooms.end();
+    if (room == m_rooms.end() || placement.used[room->second] >= m_roomLocations[room->second].size()) {
+        placement.unknownLocations++;
+        placement.elsewhere.push_back(pickup);
+        return;
+    }
+    placement.pickups[m_roomLocations[room->second][placement.used[room->second]++]] = pickup;
+}
+
+LayoutItems LayoutImporter::Import(std::string &json, JsonDocument &document) const {
+    LayoutPlacement placement;
+    Place(json, document, placement);
+
+    LayoutItems out;
+    out.locations = placement.locations;
+    out.unknownLocations = placement.unknownLocations;
+    for (std::uint32_t id = 0; id < m_locations.size(); id++) {
+        if (placement.pickups[id].empty()) {
+            continue;
+        }
+        const int type = PickupItemType(placement.pickups[id]);
+        if (type < 0) {
+            out.otherPickups++;
+            continue;
+        }
+        out.items.push_back(m_locations[id]);
+        out.items.back().type = (std::uint8_t)type;
+    }
+    return out;
+}
+
+void LayoutImporter::Place(std::string &json, JsonDocument &document, LayoutPlacement &placement) const {
+    document.Parse(json);
+    std::uint32_t game = 0;
+    const std::uint32_t games = document.Find(0, "game_modifications");
+    if (games != JsonDocument::None && document[games].type == JsonType::Array &&
+        document[games].end > games + 1) {
+        game = games + 1;
+    }
+    const std::uint32_t locations = document.Find(game, "locations");
+    if (locations == JsonDocument::None || document[locations].type != JsonType::Object) {
+        throw std::runtime_error("No locations in the layout");
+    }
+
+    placement.pickups.assign(m_locations.size(), {});
+    placement.locations = 0;
+    placement.unknownLocations = 0;
+    placement.elsewhere.clear();
+    placement.used.assign(m_roomLocations.size(), 0);
+    auto pickupOf = [&document](std::uint32_t value) {
+        return document[value].type == JsonType::String ? document.Text(value) : std::string_view();
+    };
+    document.ForEachMember(locations, [&](std::uint32_t key, std::uint32_t value) {
+        const std::string_view name = document.Text(key);
+        if (document[value].type == JsonType::Object) {
+            const auto world = m_worlds.find(NameHash(name));
+            const std::uint32_t worldIndex = world == m_worlds.end() ? 0 : world->second;
+            document.ForEachMember(value, [&](std::uint32_t location, std::uint32_t pickup) {
+                AddLocation(worldIndex, document.Text(location), pickupOf(pickup), placement);
+            });
+            return;
+        }
+        const size_t slash = name.find('/');
+        if (slash == std::string_view::npos) {
+            AddLocation(0, name, pickupOf(value), placement);
+            return;
+        }
+        const auto world = m_worlds.find(NameHash(name.substr(0, slash)));
+        AddLocation(world == m_worlds.end() ? 0 : world->second, name.substr(slash + 1), pickupOf(value),
+                    placement);
+    });
+}
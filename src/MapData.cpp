@@ -0,0 +1,340 @@
+#include "MapData.h"
+
+#include "ProgressiveMesh.h"
+#include "Utility.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef MP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+const char GeometryMagic[4] = {'M', 'P', 'W', 'G'};
+const char RoomsMagic[4] = {'M', 'P', 'R', 'L'};
+const char ItemsMagic[4] = {'M', 'P', 'I', 'M'};
+const char ProgressiveMagic[4] = {'M', 'P', 'P', 'M'};
+const std::uint32_t FormatVersion = 1;
+const size_t GeometryHeaderSize = 44;
+const size_t VertexSize = 8;
+
+// Same order as the viewer, item worlds count from 1
+const std::array<const char *, 7> WorldNames{"IntroWorld", "RuinsWorld", "IceWorld", "OverWorld",
+                                             "MinesWorld", "LavaWorld",  "CraterWorld"};
+
+void AppendBytes(std::vector<std::uint8_t> &out, const void *data, size_t size) {
+    const size_t offset = out.size();
+    out.resize(offset + size);
+    memcpy(out.data() + offset, data, size);
+}
+
+template <typename T> void Append(std::vector<std::uint8_t> &out, T value) {
+    AppendBytes(out, &value, sizeof(T));
+}
+
+template <typename T> T Read(const std::vector<std::uint8_t> &in, size_t offset) {
+    if (offset + sizeof(T) > in.size()) {
+        throw std::runtime_error("Truncated world geometry");
+    }
+    T value;
+    memcpy(&value, in.data() + offset, sizeof(T));
+    return value;
+}
+
+std::int8_t ToSnorm8(float value) { return (std::int8_t)std::lround(std::clamp(value, -1.f, 1.f) * 127.f); }
+
+float SignOf(float value) { return value < 0.f ? -1.f : 1.f; }
+
+// Octahedral mapping, normals stay within about a degree in two bytes
+void EncodeNormal(const float normal[3], std::int8_t out[2]) {
+    const float sum = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+    if (sum == 0.f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = normal[0] / sum;
+    float y = normal[1] / sum;
+    if (normal[2] < 0.f) {
+        const float folded = (1.f - std::abs(y)) * SignOf(x);
+        y = (1.f - std::abs(x)) * SignOf(y);
+        x = folded;
+    }
+    out[0] = ToSnorm8(x);
+    out[1] = ToSnorm8(y);
+}
+
+void DecodeNormal(const std::int8_t in[2], float normal[3]) {
+    float x = std::max(in[0] / 127.f, -1.f);
+    float y = std::max(in[1] / 127.f, -1.f);
+    const float z = 1.f - std::abs(x) - std::abs(y);
+    if (z < 0.f) {
+        const float folded = (1.f - std::abs(y)) * SignOf(x);
+        y = (1.f - std::abs(x)) * SignOf(y);
+        x = folded;
+    }
+    const float length = std::sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+std::uint64_t KeyOf(const char tag[4], std::uint64_t source, std::uint32_t extra = 0) {
+    std::uint64_t key = HashBytes(tag, 4, source);
+    key = HashBytes(&FormatVersion, sizeof(FormatVersion), key);
+    return HashBytes(&extra, sizeof(extra), key);
+}
+
+bool Exists(const std::string &path) {
+    std::error_code error;
+    return std::filesystem::is_regular_file(path, error);
+}
+
+#ifdef MP_HAVE_ZLIB
+std::vector<std::uint8_t> Gzip(const std::vector<std::uint8_t> &data) {
+    z_stream stream{};
+    // 16 over the window bits asks for a gzip wrapper
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+        throw std::runtime_error("Could not start gzip");
+    }
+    std::vector<std::uint8_t> out(deflateBound(&stream, (uLong)data.size()));
+    stream.next_in = const_cast<Bytef *>(data.data());
+    stream.avail_in = (uInt)data.size();
+    stream.next_out = out.data();
+    stream.avail_out = (uInt)out.size();
+    const int result = deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END) {
+        throw std::runtime_error("Could not gzip map data");
+    }
+    return out;
+}
+#endif
+
+// Stores the file under key unless it is there already, and its gzip variant
+// next to it when that saves enough to be worth a second file
+MapFile Prepare(const AssetCache &cache, std::string path, std::uint64_t key,
+                const std::function<std::vector<std::uint8_t>()> &convert) {
+    MapFile file{std::move(path), cache.PathOf(key), {}, key};
+    std::vector<std::uint8_t> data;
+    if (!Exists(file.file)) {
+        data = convert();
+        cache.Store(key, data);
+    }
+#ifdef MP_HAVE_ZLIB
+    const char gzipTag[4] = {'g', 'z', 'i', 'p'};
+    const std::uint64_t gzipKey = KeyOf(gzipTag, key);
+    if (!Exists(cache.PathOf(gzipKey))) {
+        // Data that doesn't compress is tried again on every start, it is
+        // small next to a world
+        if (data.empty()) {
+            data = ReadFile(file.file.c_str());
+        }
+        const std::vector<std::uint8_t> compressed = Gzip(data);
+        if (compressed.size() < data.size() * 9 / 10) {
+            cache.Store(gzipKey, compressed);
+        }
+    }
+    if (Exists(cache.PathOf(gzipKey))) {
+        file.gzipFile = cache.PathOf(gzipKey);
+    }
+#endif
+    return file;
+}
+} // namespace
+
+std::vector<std::uint8_t> EncodeWorldGeometry(const WorldMesh &mesh) {
+    float boundsMin[3] = {0.f, 0.f, 0.f};
+    float boundsMax[3] = {0.f, 0.f, 0.f};
+    if (!mesh.vertices.empty()) {
+        std::copy_n(mesh.vertices[0].position, 3, boundsMin);
+        std::copy_n(mesh.vertices[0].position, 3, boundsMax);
+    }
+    for (const MeshVertex &vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+        }
+    }
+    const std::uint32_t indexSize = mesh.vertices.size() <= 0x10000 ? 2 : 4;
+
+    std::vector<std::uint8_t> out;
+    out.reserve(GeometryHeaderSize + mesh.vertices.size() * VertexSize + mesh.indices.size() * indexSize + 2);
+    AppendBytes(out, GeometryMagic, 4);
+    Append(out, FormatVersion);
+    Append(out, (std::uint32_t)mesh.vertices.size());
+    Append(out, (std::uint32_t)mesh.indices.size());
+    Append(out, indexSize);
+    AppendBytes(out, boundsMin, sizeof(boundsMin));
+    AppendBytes(out, boundsMax, sizeof(boundsMax));
+
+    for (const MeshVertex &vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            const float extent = boundsMax[axis] - boundsMin[axis];
+            const float t = extent > 0.f ? (vertex.position[axis] - boundsMin[axis]) / extent : 0.f;
+            Append(out, (std::uint16_t)std::lround(std::clamp(t, 0.f, 1.f) * 65535.f));
+        }
+        std::int8_t normal[2];
+        EncodeNormal(vertex.normal, normal);
+        AppendBytes(out, normal, sizeof(normal));
+    }
+
+    // Room indices are relative to their first vertex, the file is one buffer
+    std::vector<std::uint32_t> indices = mesh.indices;
+    for (const RoomMesh &room : mesh.rooms) {
+        for (std::uint32_t i = room.firstIndex; i < room.firstIndex + room.indexCount; i++) {
+            indices[i] += room.firstVertex;
+        }
+    }
+    for (std::uint32_t index : indices) {
+        if (indexSize == 2) {
+            Append(out, (std::uint16_t)index);
+        } else {
+            Append(out, index);
+        }
+    }
+    out.resize(RoundToNextMultiple<size_t>(out.size(), 4));
+    return out;
+}
+
+WorldMesh DecodeWorldGeometry(const std::vector<std::uint8_t> &data) {
+    if (data.size() < GeometryHeaderSize || memcmp(data.data(), GeometryMagic, 4) != 0) {
+        throw std::runtime_error("Not a world geometry file");
+    }
+    if (Read<std::uint32_t>(data, 4) != FormatVersion) {
+        throw std::runtime_error("Unsupported world geometry version");
+    }
+    const std::uint32_t vertexCount = Read<std::uint32_t>(data, 8);
+    const std::uint32_t indexCount = Read<std::uint32_t>(data, 12);
+    const std::uint32_t indexSize = Read<std::uint32_t>(data, 16);
+    if (indexSize != 2 && indexSize != 4) {
+        throw std::runtime_error("Bad index size in world geometry");
+    }
+    float boundsMin[3], boundsMax[3];
+    for (int axis = 0; axis < 3; axis++) {
+        boundsMin[axis] = Read<float>(data, 20 + axis * 4);
+        boundsMax[axis] = Read<float>(data, 32 + axis * 4);
+    }
+    if (GeometryHeaderSize + (std::uint64_t)vertexCount * VertexSize + (std::uint64_t)indexCount * indexSize >
+        data.size()) {
+        throw std::runtime_error("Truncated world geometry");
+    }
+
+    WorldMesh mesh;
+    mesh.vertices.resize(vertexCount);
+    const std::uint8_t *vertices = data.data() + GeometryHeaderSize;
+    for (std::uint32_t i = 0; i < vertexCount; i++) {
+        const std::uint8_t *in = vertices + i * VertexSize;
+        MeshVertex &vertex = mesh.vertices[i];
+        for (int axis = 0; axis < 3; axis++) {
+            std::uint16_t q;
+            memcpy(&q, in + axis * 2, sizeof(q));
+            vertex.position[axis] = boundsMin[axis] + (boundsMax[axis] - boundsMin[axis]) * (q / 65535.f);
+        }
+        std::int8_t normal[2];
+        memcpy(normal, in + 6, sizeof(normal));
+        DecodeNormal(normal, vertex.normal);
+    }
+
+    mesh.indices.resize(indexCount);
+    const size_t indicesOffset = GeometryHeaderSize + (size_t)vertexCount * VertexSize;
+    for (std::uint32_t i = 0; i < indexCount; i++) {
+        const std::uint32_t index = indexSize == 2 ? Read<std::uint16_t>(data, indicesOffset + i * 2)
+                                                   : Read<std::uint32_t>(data, indicesOffset + i * 4);
+        if (index >= vertexCount) {
+            throw std::runtime_error("Index out of range in world geometry");
+        }
+        mesh.indices[i] = index;
+    }
+    return mesh;
+}
+
+std::vector<std::uint8_t> EncodeRoomList(const WorldMesh &mesh) {
+    std::vector<std::uint8_t> out;
+    AppendBytes(out, RoomsMagic, 4);
+    Append(out, FormatVersion);
+    Append(out, (std::uint32_t)mesh.rooms.size());
+    for (const RoomMesh &room : mesh.rooms) {
+        Append(out, (std::int32_t)room.roomIndex);
+        Append(out, room.firstVertex);
+        Append(out, room.vertexCount);
+        Append(out, room.firstIndex);
+        Append(out, room.indexCount);
+        AppendBytes(out, room.boundsMin, sizeof(room.boundsMin));
+        AppendBytes(out, room.boundsMax, sizeof(room.boundsMax));
+        const std::uint8_t length = (std::uint8_t)std::min<size_t>(room.name.size(), 255);
+        Append(out, length);
+        AppendBytes(out, room.name.data(), length);
+    }
+    return out;
+}
+
+std::vector<std::uint8_t> EncodeItemMarkers(const std::vector<ItemRecord> &items, std::uint32_t worldIndex) {
+    std::vector<std::uint8_t> out;
+    AppendBytes(out, ItemsMagic, 4);
+    Append(out, FormatVersion);
+    const size_t countOffset = out.size();
+    Append(out, (std::uint32_t)0);
+
+    std::uint32_t count = 0;
+    for (const ItemRecord &item : items) {
+        if (item.worldIndex != worldIndex) {
+            continue;
+        }
+        Append(out, item.type);
+        Append(out, (std::uint8_t)0);
+        Append(out, (std::uint16_t)item.roomIndex);
+        const float position[3] = {item.x, item.z, item.y};
+        AppendBytes(out, position, sizeof(position));
+        count++;
+    }
+    memcpy(out.data() + countOffset, &count, sizeof(count));
+    return out;
+}
+
+std::vector<MapFile> PrepareMapFiles(const std::string &dataDirectory, const AssetCache &cache) {
+    std::vector<MapFile> files;
+
+    const std::string itemsPath = dataDirectory + "/items.data";
+    const std::vector<std::uint8_t> itemsSource = ReadFile(itemsPath.c_str());
+    const std::uint64_t itemsHash = HashBytes(itemsSource.data(), itemsSource.size());
+    std::vector<ItemRecord> items;
+
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const std::string objPath = dataDirectory + "/" + WorldNames[world] + ".obj";
+        const std::vector<std::uint8_t> source = ReadFile(objPath.c_str());
+        const std::uint64_t hash = HashBytes(source.data(), source.size());
+        const std::string prefix = "/world/" + std::to_string(world + 1);
+
+        // Parsed at most once, and only when something is missing
+        WorldMesh mesh;
+        bool parsed = false;
+        auto parse = [&]() -> const WorldMesh & {
+            if (!parsed) {
+                mesh = ParseWorldObj(std::string(source.begin(), source.end()));
+                parsed = true;
+            }
+            return mesh;
+        };
+        files.push_back(Prepare(cache, prefix + "/geometry", KeyOf(GeometryMagic, hash),
+                                [&] { return EncodeWorldGeometry(parse()); }));
+        files.push_back(Prepare(cache, prefix + "/progressive", KeyOf(ProgressiveMagic, hash),
+                                [&] { return EncodeProgressiveMesh(parse()); }));
+        files.push_back(Prepare(cache, prefix + "/rooms", KeyOf(RoomsMagic, hash),
+                                [&] { return EncodeRoomList(parse()); }));
+        files.push_back(Prepare(cache, prefix + "/items", KeyOf(ItemsMagic, itemsHash, world + 1), [&] {
+            if (items.empty()) {
+                items = ParseItemsData(std::string(itemsSource.begin(), itemsSource.end()));
+            }
+            return EncodeItemMarkers(items, world + 1);
+        }));
+    }
+    return files;
+}
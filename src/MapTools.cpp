@@ -0,0 +1,4478 @@
+#include "AssetCache.h"
+#include "BlockCompression.h"
+#include "CameraController.h"
+#include "CameraPath.h"
+#include "FontAtlasCache.h"
+#include "FileWatcher.h"
+#include "FrameScheduler.h"
+#include "HotReload.h"
+#include "IconAtlas.h"
+#include "IconQuads.h"
+#include "IconSdf.h"
+#include "ImageIO.h"
+#include "InputLog.h"
+#include "ItemBrowser.h"
+#include "ItemQuery.h"
+#include "LayoutImport.h"
+#include "MapData.h"
+#include "MeshBvh.h"
+#include "MipGenerator.h"
+#include "NameSearch.h"
+#include "NavMesh.h"
+#include "Portals.h"
+#include "ProgressiveMesh.h"
+#include "Reachability.h"
+#include "SeedStats.h"
+#include "ThreadPool.h"
+#include "TourSolver.h"
+#include "TrackerState.h"
+#include "UploadPlanner.h"
+#include "Utility.h"
+#include "VoxelMap.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+#ifdef __linux__
+#include "HttpServer.h"
+#include "WebSocket.h"
+
+#include <csignal>
+#include <random>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Command line tools working on the map data. They only use the portable
+// parts of the viewer, so they build and run on every platform.
+
+namespace {
+int Usage() {
+    printf("Usage: MP-MapTools <command> [options]\n"
+           "\n"
+           "Commands:\n"
+           "  decode-bench [--iterations N] <images...>\n"
+           "      Decodes the images N times (default 50) and prints the decoded MB/s,\n"
+           "      next to WIC on Windows\n"
+           "  load-bench [--repeat N] [--threads N] <images...>\n"
+           "      Loads the images, each repeated N times (default 64), one at a time and then\n"
+           "      as a batch on the thread pool, and packs them in a single staging buffer\n"
+           "  load-check [--rounds N] [images...]\n"
+           "      Checks the upload planner against known D3D12 footprints and on N random\n"
+           "      batches (default 200), then ParallelFor and shutdown of pools of 1 to 8\n"
+           "      threads, then decoding the images as a batch against one at a time\n"
+           "  mip-bench [--filter box|kaiser] [--repeat N] [--threads N] <images...>\n"
+           "      Generates full mip chains for the images, each repeated N times (default 16),\n"
+           "      one at a time and then on the thread pool\n"
+           "  mip-check [--golden FILE] [--update] [images...]\n"
+           "      Generates the mip chains of a few made up images and the given ones with\n"
+           "      both filters, in sRGB and linear, and round trips them through a cache.\n"
+           "      Compares every level and cache entry against the hashes in FILE (default\n"
+           "      data/mip_golden.txt), --update writes them instead\n"
+           "  compress [--format bc1|bc3|bc7] [--mips] [--out DIR] <images...>\n"
+           "      Block compresses the images (default BC7), with a full mip chain when\n"
+           "      --mips is given, into sRGB DDS files next to them or in DIR. Prints the\n"
+           "      PSNR of every level, results are cached in cache/\n"
+           "  sdf-bench [--scale N] [--repeat N] [--threads N] <images...>\n"
+           "      Generates distance field icons at N times the source size (default 4), each\n"
+           "      image repeated N times (default 64), one at a time and then on the thread\n"
+           "      pool. Redraws them at the source size and counts the pixels whose coverage\n"
+           "      differs from the source silhouette, then packs them into an atlas with mips\n"
+           "      as the viewer does and prints the BC7 error of its colors and distance\n"
+           "  atlas-check [--icons N] [--runs N] [images...]\n"
+           "      Packs N random icons (default 300) N times (default 20) with different\n"
+           "      gutters and alignments, then the images when given, and checks every icon is\n"
+           "      placed inside the atlas, aligned, apart from the others and copied with its\n"
+           "      gutter\n"
+           "  camera-sim [--rates A,B,...]\n"
+           "      Plays a scripted orbit, pan and zoom through the camera controller on a fake\n"
+           "      clock at each frame rate (default 30,60,144,240). Prints how far the camera\n"
+           "      strays from the first rate at a few check times and the input latency\n"
+           "  scheduler-sim [--seconds N] [--heartbeat S]\n"
+           "      Runs a session of N seconds (default 60) on a virtual clock: a drag, a data\n"
+           "      reload, idle time. Prints the frames the scheduler drew against drawing\n"
+           "      every vsync\n"
+           "  perf-run (--script FILE | --replay FILE) [--fps N] [--data DIR] [--csv FILE]\n"
+           "      Runs the per frame CPU work of the viewer without a window along a camera\n"
+           "      path script or a recorded replay.mpir, at N frames per second of a virtual\n"
+           "      clock (default 60, scripts set their own). Writes the stage timings of\n"
+           "      every frame to FILE and prints their average, 95th percentile and worst.\n"
+           "      data/paths holds orbit_<World>.txt, three turns around a world, and\n"
+           "      zoom_ramp.txt, every world zoomed in and out\n"
+           "  query-bench [--items N] [--types N] [--queries N]\n"
+           "      Indexes N random items (default 1000000) of N types (default 100) and\n"
+           "      evaluates N filter queries (default 1000) of three shapes. Prints the latency\n"
+           "      p50/p99 of each next to a scan of every item, and checks a sample against it\n"
+           "  cull-bench [--data DIR] [--step DEGREES]\n"
+           "      Culls the rooms of every world through their portals from the center of every\n"
+           "      room, turning around in steps (default 10 degrees), like the Culling benchmark\n"
+           "      of the viewer. Prints the cull time p50/p99 and the rooms drawn against the\n"
+           "      rooms in the frustum\n"
+           "  reload-check [--data DIR]\n"
+           "      Diffs edited copies of items.data and every world against the originals, the\n"
+           "      way a hot reload does, and checks each diff. Then saves a file in a watched\n"
+           "      directory and checks it is only reported once written\n"
+           "  browser-bench [--rows N] [--frames N]\n"
+           "      Builds the item table with N random items (default 1000000) in ImGui without\n"
+           "      a renderer for N frames (default 600), scrolling through it and changing the\n"
+           "      sort now and then. Prints the time of frames with and without a resort\n"
+           "  font-bench [--font FILE] [--size N] [--ranges default|cjk] [--repeat N]\n"
+           "      Builds the ImGui font atlas of a TTF/OTF font (the default font when none is\n"
+           "      given) at N pixels (default 13) N times (default 10), then loads it from\n"
+           "      cache/ as often and checks the loaded atlas matches the built one\n"
+           "  progressive [--data DIR] [--chunk N]\n"
+           "      Encodes every world as a progressive mesh and feeds it to the decoder N bytes\n"
+           "      at a time (default 1460). Prints the bytes before the first frame, the\n"
+           "      triangles and error along the stream and checks the end result against the\n"
+           "      plain geometry file\n"
+           "  layout-bench [--logs N] [--threads N] [--dir DIR] [--data DIR]\n"
+           "      Imports N generated randomizer layouts (default 10000, written to DIR,\n"
+           "      default cache/layouts, when missing) one at a time and then on the thread\n"
+           "      pool. Prints logs/s and MB/s and checks every import against the items the\n"
+           "      generator placed\n"
+           "  reach-bench [--data DIR] [--kinds N] [--runs N]\n"
+           "      Generates logic over N upgrades (default 24) and the expansions for the room\n"
+           "      graph and picks up everything in a shuffled order, N times (default 50).\n"
+           "      Prints the time to update what is reachable per pickup against solving from\n"
+           "      the start and checks both agree\n"
+           "  tour-bench [--data DIR] [--stops N] [--runs N] [--restarts N] [--threads N]\n"
+           "      Plans a route over every item, then over N stops (default 100) in random\n"
+           "      rooms N times (default 20), on one thread and on N (default all). Prints the\n"
+           "      solve time p50 and worst of both and checks they give the same route\n"
+           "  seed-stats [--logs N] [--dir DIR] [--data DIR] [--logic FILE | --generated-logic]\n"
+           "             [--threads N] [--out PREFIX] [--scaling]\n"
+           "      Works out the spheres of N layouts (default 10000, generated into DIR like\n"
+           "      layout-bench) under the logic (default logic.txt of the data, or generated over\n"
+           "      the layout pickups) on the thread pool. Writes per location sphere and pickup\n"
+           "      counts to PREFIX.bin, PREFIX_locations.csv and PREFIX_rooms.csv (default\n"
+           "      cache/seed_stats), which the viewer shows as a heatmap. --scaling runs it on\n"
+           "      1, 2, 4... threads, printing seeds/s and checking every run gives the same\n"
+           "      counts\n"
+           "  search-bench [--data DIR] [--names N] [--queries N]\n"
+           "      Indexes the room and item names the viewer searches, then N made up names\n"
+           "      (default 1000000) on top. Searches N names (default 2000) as written and\n"
+           "      with a typo, printing the latency and how often the name was found. Fails when\n"
+           "      an exact name isn't the first hit or the p99 latency is over 1 ms\n"
+           "  snap-items [--data DIR] [--threshold D] [--threads N] [--out FILE] [--queries N]\n"
+           "      Finds the closest world surface of every item on the thread pool and lists\n"
+           "      the items further than D (default 5) from it. --out writes items.data to FILE\n"
+           "      with those pulled in to D from their surface. Then times N closest point\n"
+           "      queries (default 1000000) in the world bounds and next to the geometry, on one\n"
+           "      thread and on the pool, checking a sample against every triangle\n"
+           "  nav-bench [--data DIR] [--threads N] [--queries N] [--cell S] [--climb H]\n"
+           "            [--max-link L]\n"
+           "      Builds the navigation mesh of every world on one thread and on the pool,\n"
+           "      then finds the path between every two items of a world and N paths (default\n"
+           "      20000) between random polygons. Prints the build time per world, the path\n"
+           "      latency p50/p99, how much longer than a straight line the paths are and how\n"
+           "      much of the item paths is across room links (at most L across, default 16)\n"
+           "  voxel-bench [--data DIR] [--threads N] [--queries N] [--sizes S,S...]\n"
+           "      Voxelizes every world at each voxel size (default 4,2,1,0.5) on one thread and\n"
+           "      on the pool, printing the build time and memory. Then times N point and room\n"
+           "      lookups and N rays (default 100000) at random in the world bounds, checks the\n"
+           "      rays against a walk voxel by voxel and a sample against every triangle, and\n"
+           "      looks up the room of every item\n"
+#ifdef __linux__
+           "  serve [--port N] [--bind ADDR] [--data DIR] [--web DIR]\n"
+           "      Converts every world's geometry, room list and items to the compact binary\n"
+           "      forms once (kept in cache/, gzipped next to them) and serves them over HTTP\n"
+           "      on port N (default 8080) with the web client in DIR (default webtest), and\n"
+           "      the race tracker as a WebSocket on /tracker\n"
+           "  http-load [--clients N] [--requests N] [--path P] [--gzip] [--revalidate]\n"
+           "      Starts the server on loopback and has N keep-alive clients (default 256) send\n"
+           "      N requests (default 100000) for all map files or only P, asking for gzip or\n"
+           "      revalidating with the last ETag. Prints requests/s and the latency p50/p99\n"
+           "  tracker-load [--subscribers N] [--bursts N] [--burst-size N] [--interval-ms T]\n"
+           "               [--frame-ms T]\n"
+           "      Joins N loopback WebSocket clients (default 1000) to the tracker, the first\n"
+           "      sending N bursts (default 400) of N toggles (default 4) every T ms (default\n"
+           "      5). Prints the fan-out latency, server CPU per delta and checks every client\n"
+           "      ends up with the runner's state\n"
+#endif
+           );
+    return 1;
+}
+
+struct BenchResult {
+    double seconds = 0.0;
+    std::size_t bytes = 0;
+};
+
+template <typename Decode>
+BenchResult RunDecode(const std::vector<std::vector<std::uint8_t>> &files, int iterations, Decode decode) {
+    BenchResult result;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        for (const std::vector<std::uint8_t> &file : files) {
+            int width, height;
+            decode(file.data(), file.size(), 1, &width, &height);
+            result.bytes += (std::size_t)width * height * 4;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void PrintResult(const char *name, const BenchResult &result) {
+    printf("%-10s %10.1f MB/s  (%.1f ms)\n", name, result.bytes / result.seconds / 1e6, result.seconds * 1e3);
+}
+
+int DecodeBench(int argc, char **argv) {
+    int iterations = 50;
+    std::vector<std::vector<std::uint8_t>> files;
+    std::size_t fileBytes = 0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            files.push_back(ReadFile(argv[i]));
+            fileBytes += files.back().size();
+        }
+    }
+    if (files.empty() || iterations < 1) {
+        return Usage();
+    }
+
+    printf("%zu images, %zu bytes compressed, %d iterations\n", files.size(), fileBytes, iterations);
+    PrintResult("built-in", RunDecode(files, iterations, LoadImageFromMemory));
+#ifdef _WIN32
+    ::CoInitializeEx(nullptr, ::COINIT_APARTMENTTHREADED | ::COINIT_DISABLE_OLE1DDE);
+    PrintResult("WIC", RunDecode(files, iterations, LoadImageFromMemoryWic));
+#endif
+    return 0;
+}
+
+double Milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int LoadBench(int argc, char **argv) {
+    int repeat = 64;
+    int threads = 0;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty() || repeat < 1 || threads < 0) {
+        return Usage();
+    }
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < repeat; i++) {
+        paths.insert(paths.end(), files.begin(), files.end());
+    }
+
+    ThreadPool serial(1);
+    ThreadPool pool(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    LoadImagesFromFiles(paths, 1, serial);
+    const double serialMs = Milliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    const std::vector<DecodedImage> images = LoadImagesFromFiles(paths, 1, pool);
+    const double batchMs = Milliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    std::vector<SubresourceDesc> subresources;
+    for (const DecodedImage &image : images) {
+        subresources.push_back({(std::uint32_t)image.width, (std::uint32_t)image.height});
+    }
+    const UploadPlan plan = PlanUpload(subresources);
+    std::vector<std::uint8_t> staging(plan.totalSize);
+    for (size_t i = 0; i < images.size(); i++) {
+        CopyToStaging(plan.footprints[i], images[i].pixels.data(), images[i].width * 4, staging.data());
+    }
+    const double stageMs = Milliseconds(start);
+
+    std::size_t pixelBytes = 0;
+    for (const DecodedImage &image : images) {
+        pixelBytes += image.pixels.size();
+    }
+
+    printf("%zu images, %zu bytes decoded\n", paths.size(), pixelBytes);
+    printf("one at a time  %8.2f ms\n", serialMs);
+    printf("batch          %8.2f ms on %u threads\n", batchMs, pool.ThreadCount());
+    printf("staging        %8.2f ms, %llu bytes in one buffer\n", stageMs,
+           (unsigned long long)plan.totalSize);
+    return 0;
+}
+
+int LoadCheck(int argc, char **argv) {
+    int rounds = 200;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (rounds < 1) {
+        return Usage();
+    }
+
+    int failures = 0;
+    auto check = [&failures](bool passed, const std::string &name) {
+        printf("  %-56s %s\n", name.c_str(), passed ? "ok" : "FAILED");
+        failures += !passed;
+    };
+
+    // Sizes GetCopyableFootprints gives for the same subresources
+    printf("upload planner\n");
+    {
+        const UploadPlan plan = PlanUpload({{16, 16}, {1, 1}, {16, 16, 4, 16}, {5, 3, 4, 8}, {300, 2}});
+        const std::vector<std::uint64_t> offsets{0, 4096, 4608, 5632, 6144};
+        bool matches = plan.footprints.size() == offsets.size();
+        for (size_t i = 0; matches && i < offsets.size(); i++) {
+            matches = plan.footprints[i].offset == offsets[i];
+        }
+        check(matches && plan.footprints[0].rowPitch == 256 && plan.footprints[0].rowBytes == 64 &&
+                  plan.footprints[2].rowCount == 4 && plan.footprints[2].rowBytes == 64 &&
+                  plan.footprints[3].rowBytes == 16 && plan.footprints[3].rowCount == 1 &&
+                  plan.footprints[4].rowPitch == 1280 && plan.totalSize == 6144 + 1280 + 1200,
+              "footprints of known RGBA8 and BC subresources");
+        check(PlanUpload({}).totalSize == 0, "nothing to upload");
+    }
+
+    // Random batches: in the order given, aligned, apart from each other, and
+    // the buffer no larger than the last subresource needs
+    std::uint32_t state = 99;
+    auto random = [&state](std::uint32_t range) {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) % range;
+    };
+    int ordered = 0, aligned = 0, apart = 0, tight = 0, copied = 0;
+    for (int round = 0; round < rounds; round++) {
+        std::vector<SubresourceDesc> subresources(1 + random(40));
+        for (SubresourceDesc &subresource : subresources) {
+            subresource.width = 1 + random(300);
+            subresource.height = 1 + random(300);
+            if (random(3) == 0) {
+                subresource.blockSize = 4;
+                subresource.bytesPerBlock = random(2) ? 8 : 16;
+            }
+        }
+        UploadPlanDesc desc;
+        if (round % 2) {
+            desc.rowPitchAlignment = 128;
+            desc.placementAlignment = 1024;
+        }
+        const UploadPlan plan = PlanUpload(subresources, desc);
+
+        std::uint64_t end = 0;
+        bool inOrder = true, isAligned = true, isApart = true;
+        for (size_t i = 0; i < subresources.size(); i++) {
+            const SubresourceFootprint &footprint = plan.footprints[i];
+            const std::uint64_t size = (std::uint64_t)footprint.rowPitch * (footprint.rowCount - 1) +
+                                       footprint.rowBytes;
+            inOrder &= i == 0 || footprint.offset > plan.footprints[i - 1].offset;
+            isAligned &= footprint.offset % desc.placementAlignment == 0 &&
+                         footprint.rowPitch % desc.rowPitchAlignment == 0 &&
+                         footprint.rowPitch >= footprint.rowBytes;
+            isApart &= footprint.offset >= end && footprint.offset - end < desc.placementAlignment;
+            end = footprint.offset + size;
+        }
+        ordered += inOrder;
+        aligned += isAligned;
+        apart += isApart;
+        tight += plan.totalSize == end;
+
+        // Every row lands where the footprint says and nothing else is written
+        std::vector<std::uint8_t> staging(plan.totalSize + 64, 0xEE);
+        std::vector<std::vector<std::uint8_t>> sources(subresources.size());
+        for (size_t i = 0; i < subresources.size(); i++) {
+            const SubresourceFootprint &footprint = plan.footprints[i];
+            sources[i].resize((size_t)footprint.rowBytes * footprint.rowCount);
+            for (size_t b = 0; b < sources[i].size(); b++) {
+                sources[i][b] = (std::uint8_t)(i * 31 + b * 7);
+            }
+            CopyToStaging(footprint, sources[i].data(), footprint.rowBytes, staging.data());
+        }
+        bool same = std::all_of(staging.end() - 64, staging.end(), [](std::uint8_t b) { return b == 0xEE; });
+        for (size_t i = 0; same && i < subresources.size(); i++) {
+            const SubresourceFootprint &footprint = plan.footprints[i];
+            for (std::uint32_t row = 0; same && row < footprint.rowCount; row++) {
+                same = memcmp(&staging[footprint.offset + (std::uint64_t)row * footprint.rowPitch],
+                              &sources[i][(size_t)row * footprint.rowBytes], footprint.rowBytes) == 0;
+            }
+        }
+        copied += same;
+    }
+    check(ordered == rounds, "subresources placed in the order given");
+    check(aligned == rounds, "placement and row pitch aligned");
+    check(apart == rounds, "no overlap, no more than alignment padding between");
+    check(tight == rounds, "buffer size ends at the last subresource");
+    check(copied == rounds, "rows copied to their footprint only");
+
+    printf("thread pool\n");
+    for (std::uint32_t threads : {1u, 2u, 4u, 8u}) {
+        const std::string name = std::to_string(threads) + (threads == 1 ? " thread, " : " threads, ");
+        bool once = true, slotsAlone = true, waited = true;
+        for (int round = 0; round < rounds / 10 + 1; round++) {
+            // A new pool every round, it goes away right after its last loop
+            // with workers maybe only now picking up their part of it
+            ThreadPool pool(threads);
+            for (std::uint32_t count : {0u, 1u, 3u, 1000u}) {
+                std::vector<std::atomic<int>> runs(count);
+                std::vector<std::atomic<int>> busy(pool.ThreadCount());
+                std::atomic<std::uint32_t> finished = 0;
+                pool.ParallelFor(count, [&](std::uint32_t i, std::uint32_t slot) {
+                    slotsAlone &= slot < pool.ThreadCount() && busy[slot].exchange(1) == 0;
+                    // Uneven tasks, some threads run out early and steal
+                    if (i % 97 == 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    }
+                    runs[i]++;
+                    busy[slot] = 0;
+                    finished++;
+                });
+                waited &= finished == count;
+                once &= std::all_of(runs.begin(), runs.end(),
+                                    [](const std::atomic<int> &n) { return n == 1; });
+            }
+        }
+        check(once, name + "every index run once");
+        check(slotsAlone, name + "no slot used twice at once");
+        check(waited, name + "ParallelFor returns once every task is done");
+
+        ThreadPool pool(threads);
+        std::atomic<int> ran = 0;
+        bool rethrown = false;
+        try {
+            pool.ParallelFor(100, [&ran](std::uint32_t i) {
+                ran++;
+                if (i == 10) {
+                    throw std::runtime_error("task failed");
+                }
+            });
+        } catch (const std::runtime_error &) {
+            rethrown = true;
+        }
+        check(rethrown && ran == 100, name + "first exception rethrown after all ran");
+
+        std::atomic<int> nested = 0;
+        pool.ParallelFor(8, [&](std::uint32_t) { pool.ParallelFor(8, [&](std::uint32_t) { nested++; }); });
+        check(nested == 64, name + "nested loops finish");
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 20; i++) {
+            ThreadPool idle(threads);
+        }
+        check(Milliseconds(start) < 2000.0, name + "idle pools shut down");
+    }
+
+    if (!files.empty()) {
+        printf("batch decode\n");
+        ThreadPool serial(1), pool;
+        const std::vector<DecodedImage> one = LoadImagesFromFiles(files, 1, serial);
+        const std::vector<DecodedImage> batch = LoadImagesFromFiles(files, 1, pool);
+        bool same = one.size() == batch.size();
+        for (size_t i = 0; same && i < one.size(); i++) {
+            same = one[i].width == batch[i].width && one[i].height == batch[i].height &&
+                   one[i].pixels == batch[i].pixels;
+        }
+        check(same, "batch decodes like one at a time, in order");
+        std::vector<std::string> missing = files;
+        missing.push_back("does-not-exist.png");
+        bool threw = false;
+        try {
+            LoadImagesFromFiles(missing, 1, pool);
+        } catch (const std::exception &) {
+            threw = true;
+        }
+        check(threw, "missing file rethrown");
+    }
+
+    printf("%d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+int MipBench(int argc, char **argv) {
+    MipDesc desc;
+    int repeat = 16;
+    int threads = 0;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            desc.filter = strcmp(argv[++i], "box") == 0 ? MipFilter::Box : MipFilter::Kaiser;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty() || repeat < 1 || threads < 0) {
+        return Usage();
+    }
+
+    ThreadPool pool(threads);
+    const std::vector<DecodedImage> sources = LoadImagesFromFiles(files, 1, pool);
+    std::vector<DecodedImage> images;
+    std::size_t texels = 0;
+    for (int i = 0; i < repeat; i++) {
+        for (const DecodedImage &image : sources) {
+            images.push_back(image);
+            texels += (std::size_t)image.width * image.height;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const DecodedImage &image : images) {
+        GenerateMipChain(image, desc);
+    }
+    const double serialMs = Milliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    GenerateMipChains(images, desc, pool);
+    const double poolMs = Milliseconds(start);
+
+    printf("%zu images, %.2f Mtexels at level 0, %s filter\n", images.size(), texels / 1e6,
+           desc.filter == MipFilter::Box ? "box" : "kaiser");
+    printf("one at a time  %8.2f ms  %8.1f Mtexels/s\n", serialMs, texels / serialMs / 1e3);
+    printf("thread pool    %8.2f ms  %8.1f Mtexels/s on %u threads\n", poolMs, texels / poolMs / 1e3,
+           pool.ThreadCount());
+    return 0;
+}
+
+int Compress(int argc, char **argv) {
+    BlockFormat format = BlockFormat::BC7;
+    bool mips = false;
+    std::string outDirectory;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const std::string name = argv[++i];
+            format = name == "bc1" ? BlockFormat::BC1 : name == "bc3" ? BlockFormat::BC3 : BlockFormat::BC7;
+        } else if (strcmp(argv[i], "--mips") == 0) {
+            mips = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outDirectory = argv[++i];
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        return Usage();
+    }
+
+    ThreadPool pool;
+    const AssetCache cache("cache");
+    const std::vector<DecodedImage> images = LoadImagesFromFiles(files, 1, pool);
+    for (size_t i = 0; i < files.size(); i++) {
+        const auto start = std::chrono::steady_clock::now();
+        MipDesc mipDesc;
+        mipDesc.levelCount = mips ? 0 : 1;
+        const std::vector<DecodedImage> chain = GenerateMipChain(images[i], mipDesc);
+
+        bool cacheHit = false;
+        const std::vector<CompressedImage> compressed =
+            CachedCompression(cache, chain, format, pool, &cacheHit);
+        const double ms = Milliseconds(start);
+
+        std::filesystem::path path = files[i];
+        if (!outDirectory.empty()) {
+            std::filesystem::create_directories(outDirectory);
+            path = std::filesystem::path(outDirectory) / path.filename();
+        }
+        path.replace_extension(".dds");
+        const std::vector<std::uint8_t> dds = EncodeDds(compressed, true);
+        FILE *handle = fopen(path.string().c_str(), "wb");
+        if (!handle || fwrite(dds.data(), 1, dds.size(), handle) != dds.size()) {
+            if (handle) {
+                fclose(handle);
+            }
+            throw std::runtime_error("Could not write " + path.string());
+        }
+        fclose(handle);
+
+        std::size_t rawBytes = 0;
+        for (const DecodedImage &level : chain) {
+            rawBytes += level.pixels.size();
+        }
+        printf("%s -> %s, %s, %zu -> %zu bytes, %.1f ms%s\n", files[i].c_str(), path.string().c_str(),
+               BlockFormatName(format), rawBytes, dds.size(), ms, cacheHit ? " (cached)" : "");
+        for (size_t level = 0; level < chain.size(); level++) {
+            printf("  level %zu %4dx%-4d PSNR %.2f dB\n", level, chain[level].width, chain[level].height,
+                   ComputePsnr(chain[level], DecompressImage(compressed[level])));
+        }
+    }
+    return 0;
+}
+
+int SdfBench(int argc, char **argv) {
+    SdfDesc desc;
+    int repeat = 64;
+    int threads = 0;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            desc.scale = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty() || repeat < 1 || threads < 0 || desc.scale < 1) {
+        return Usage();
+    }
+
+    ThreadPool pool(threads);
+    std::vector<IconImage> sources;
+    for (DecodedImage &image : LoadImagesFromFiles(files, 1, pool)) {
+        sources.push_back({image.width, image.height, std::move(image.pixels)});
+    }
+    std::vector<IconImage> icons;
+    for (int i = 0; i < repeat; i++) {
+        icons.insert(icons.end(), sources.begin(), sources.end());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (const IconImage &icon : icons) {
+        GenerateIconSdf(icon, desc);
+    }
+    const double serialMs = Milliseconds(start);
+
+    start = std::chrono::steady_clock::now();
+    const std::vector<IconImage> sdfs = GenerateIconSdfs(icons, desc, pool);
+    const double poolMs = Milliseconds(start);
+
+    printf("%zu icons at %dx scale\n", icons.size(), desc.scale);
+    printf("one at a time  %8.2f ms  %8.3f ms per icon\n", serialMs, serialMs / icons.size());
+    printf("thread pool    %8.2f ms  %8.3f ms per icon on %u threads\n", poolMs, poolMs / icons.size(),
+           pool.ThreadCount());
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        const IconImage &source = sources[i];
+        const IconImage drawn = RenderIconSdf(sdfs[i], source.width, source.height);
+        int differing = 0;
+        for (size_t p = 3; p < source.pixels.size(); p += 4) {
+            differing += (source.pixels[p] >= desc.threshold) != (drawn.pixels[p] >= 128);
+        }
+        printf("%s: %d of %d pixels differ from the source silhouette\n", files[i].c_str(), differing,
+               source.width * source.height);
+    }
+
+    // The atlas the viewer makes of them, with mips filtering colors apart
+    // from the distance, and the BC7 error of both
+    const IconAtlas atlas =
+        BuildIconAtlas(std::vector<IconImage>(sdfs.begin(), sdfs.begin() + sources.size()));
+    MipDesc mipDesc;
+    mipDesc.filter = MipFilter::Box;
+    mipDesc.levelCount = IconAtlasSafeMipCount(IconAtlasDesc{});
+    mipDesc.premultiply = false;
+    const std::vector<DecodedImage> chain =
+        GenerateMipChain({atlas.width, atlas.height, atlas.pixels}, mipDesc);
+    printf("atlas %dx%d, %zu mips\n", atlas.width, atlas.height, chain.size());
+    for (size_t level = 0; level < chain.size(); level++) {
+        const DecodedImage decoded = DecompressImage(CompressImage(chain[level], BlockFormat::BC7, pool));
+        printf("  level %zu BC7 colors %.2f dB, distance %.2f dB\n", level,
+               ComputeChannelPsnr(chain[level], decoded, 0, 3),
+               ComputeChannelPsnr(chain[level], decoded, 3, 1));
+    }
+    return 0;
+}
+
+// Checks an atlas against its icons: every icon placed inside the atlas on
+// an aligned origin, no two icons or gutters sharing a pixel, and the pixels
+// of the icons and their extruded gutters where the UVs say. Returns the
+// number of problems, printing the first few.
+int CheckIconAtlas(const IconAtlas &atlas, const std::vector<IconImage> &icons, const IconAtlasDesc &desc) {
+    int problems = 0;
+    auto problem = [&problems](const char *format, size_t icon, int a, int b) {
+        if (problems++ < 8) {
+            printf("  icon %zu: ", icon);
+            printf(format, a, b);
+            printf("\n");
+        }
+    };
+    const bool powerOfTwo = atlas.width > 0 && atlas.height > 0 && (atlas.width & (atlas.width - 1)) == 0 &&
+                            (atlas.height & (atlas.height - 1)) == 0;
+    if (!powerOfTwo || atlas.width > desc.maxSize || atlas.height > desc.maxSize ||
+        atlas.pixels.size() != (size_t)atlas.width * atlas.height * 4 || atlas.uvs.size() != icons.size()) {
+        printf("  atlas %dx%d with %zu UVs for %zu icons\n", atlas.width, atlas.height, atlas.uvs.size(),
+               icons.size());
+        return 1;
+    }
+
+    // Icon owning each pixel, gutters included
+    std::vector<std::uint32_t> owner((size_t)atlas.width * atlas.height, 0xFFFFFFFF);
+    for (size_t i = 0; i < icons.size(); i++) {
+        const IconImage &icon = icons[i];
+        const AtlasUV &uv = atlas.uvs[i];
+        const int x0 = (int)std::lround(uv.u0 * atlas.width) - desc.gutter;
+        const int y0 = (int)std::lround(uv.v0 * atlas.height) - desc.gutter;
+        const int w = icon.width + 2 * desc.gutter, h = icon.height + 2 * desc.gutter;
+        if ((int)std::lround(uv.u1 * atlas.width) - (int)std::lround(uv.u0 * atlas.width) != icon.width ||
+            (int)std::lround(uv.v1 * atlas.height) - (int)std::lround(uv.v0 * atlas.height) != icon.height) {
+            problem("UVs do not span the icon, %dx%d", i, icon.width, icon.height);
+            continue;
+        }
+        if (x0 < 0 || y0 < 0 || x0 + w > atlas.width || y0 + h > atlas.height) {
+            problem("outside of the atlas at %d,%d", i, x0, y0);
+            continue;
+        }
+        if (x0 % desc.alignment != 0 || y0 % desc.alignment != 0) {
+            problem("origin %d,%d is not aligned", i, x0, y0);
+        }
+        bool overlaps = false, differs = false;
+        for (int y = 0; y < h; y++) {
+            const int sy = std::clamp(y - desc.gutter, 0, icon.height - 1);
+            for (int x = 0; x < w; x++) {
+                const size_t pixel = (size_t)(y0 + y) * atlas.width + x0 + x;
+                overlaps |= owner[pixel] != 0xFFFFFFFF;
+                owner[pixel] = (std::uint32_t)i;
+                const int sx = std::clamp(x - desc.gutter, 0, icon.width - 1);
+                const std::uint8_t *source = &icon.pixels[((size_t)sy * icon.width + sx) * 4];
+                differs |= memcmp(&atlas.pixels[pixel * 4], source, 4) != 0;
+            }
+        }
+        if (overlaps) {
+            problem("overlaps another icon at %d,%d", i, x0, y0);
+        }
+        if (differs) {
+            problem("pixels differ from the source at %d,%d", i, x0, y0);
+        }
+    }
+    return problems;
+}
+
+int AtlasCheck(int argc, char **argv) {
+    int count = 300;
+    int runs = 20;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--icons") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (count < 1 || runs < 1) {
+        return Usage();
+    }
+
+    std::uint32_t state = 1;
+    auto random = [&state](int range) {
+        state = state * 1664525u + 1013904223u;
+        return (int)((state >> 8) % (std::uint32_t)range);
+    };
+    int failures = 0;
+    double packMs = 0.0;
+    long long usedArea = 0, atlasArea = 0;
+    for (int run = 0; run < runs; run++) {
+        // Mostly icon sized, now and then a long or a one pixel one
+        std::vector<IconImage> icons(count);
+        for (IconImage &icon : icons) {
+            const int kind = random(10);
+            icon.width = kind == 0 ? 1 + random(4) : kind == 1 ? 64 + random(64) : 8 + random(40);
+            icon.height = kind == 0 ? 1 + random(4) : kind == 2 ? 64 + random(64) : 8 + random(40);
+            icon.pixels.resize((size_t)icon.width * icon.height * 4);
+            for (std::uint8_t &value : icon.pixels) {
+                value = (std::uint8_t)random(256);
+            }
+        }
+        IconAtlasDesc desc;
+        desc.gutter = run % 4;
+        desc.alignment = 1 << (run % 4);
+
+        const auto start = std::chrono::steady_clock::now();
+        const IconAtlas atlas = BuildIconAtlas(icons, desc);
+        packMs += Milliseconds(start);
+        for (const IconImage &icon : icons) {
+            usedArea += (long long)icon.width * icon.height;
+        }
+        atlasArea += (long long)atlas.width * atlas.height;
+
+        const int problems = CheckIconAtlas(atlas, icons, desc);
+        if (problems) {
+            printf("run %d, gutter %d, alignment %d: %d problems in a %dx%d atlas\n", run, desc.gutter,
+                   desc.alignment, problems, atlas.width, atlas.height);
+            failures++;
+        }
+    }
+    printf("%d runs of %d random icons, %.2f ms per atlas, icons cover %.1f%% of the atlases\n", runs, count,
+           packMs / runs, atlasArea ? 100.0 * usedArea / atlasArea : 0.0);
+
+    // Icons that can't fit must be refused rather than packed over each other
+    IconAtlasDesc small;
+    small.maxSize = 64;
+    std::vector<IconImage> large(8, IconImage{40, 40, std::vector<std::uint8_t>(40 * 40 * 4)});
+    // One icon larger than the maximum fits the first size tried
+    std::vector<IconImage> single(1, IconImage{100, 100, std::vector<std::uint8_t>(100 * 100 * 4)});
+    for (const auto &[name, oversized] : {std::make_pair("icons", &large), std::make_pair("icon", &single)}) {
+        bool refused = false;
+        try {
+            BuildIconAtlas(*oversized, small);
+        } catch (const std::runtime_error &) {
+            refused = true;
+        }
+        printf("%s too large for the maximum size: %s\n", name, refused ? "refused" : "packed");
+        failures += !refused;
+    }
+
+    if (!files.empty()) {
+        ThreadPool pool;
+        std::vector<IconImage> icons;
+        for (DecodedImage &image : LoadImagesFromFiles(files, 1, pool)) {
+            icons.push_back({image.width, image.height, std::move(image.pixels)});
+        }
+        const IconAtlasDesc desc;
+        const IconAtlas atlas = BuildIconAtlas(icons, desc);
+        const int problems = CheckIconAtlas(atlas, icons, desc);
+        printf("%zu images in a %dx%d atlas, %d problems\n", icons.size(), atlas.width, atlas.height,
+               problems);
+        failures += problems != 0;
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Left drag, right drag, ctrl right drag, then wheel notches, with mouse
+// messages at 500 Hz
+std::vector<InputEvent> CameraScript() {
+    std::vector<InputEvent> events;
+    std::int16_t x = 400, y = 300;
+    for (int i = 0; i < 600; i++) {
+        InputEvent event;
+        event.type = InputEventType::MouseMove;
+        event.time = i * 0.002;
+        event.left = i < 250;
+        event.right = i >= 250;
+        event.ctrl = i >= 450;
+        x = (std::int16_t)(x + (i % 3 == 0 ? 3 : 1));
+        y = (std::int16_t)(y + (i < 300 ? 1 : -1));
+        event.x = x;
+        event.y = y;
+        events.push_back(event);
+    }
+    for (int i = 0; i < 6; i++) {
+        InputEvent event;
+        event.type = InputEventType::MouseWheel;
+        event.time = 1.2 + i * 0.05;
+        event.wheel = i < 4 ? -120 : 120;
+        events.push_back(event);
+    }
+    return events;
+}
+
+int CameraSim(int argc, char **argv) {
+    std::vector<double> rates = {30.0, 60.0, 144.0, 240.0};
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--rates") == 0 && i + 1 < argc) {
+            rates.clear();
+            for (char *rate = strtok(argv[++i], ","); rate; rate = strtok(nullptr, ",")) {
+                rates.push_back(atof(rate));
+            }
+        } else {
+            return Usage();
+        }
+    }
+    if (rates.empty()) {
+        return Usage();
+    }
+
+    // Frames land on the check times at every rate, in between they follow
+    // the rate
+    const double checks[] = {0.3, 0.75, 1.05, 1.3, 2.0};
+    const int checkCount = (int)(sizeof(checks) / sizeof(checks[0]));
+    std::vector<std::vector<CameraState>> results;
+    printf("rate      frames  latency avg/worst ms   max error at checks\n");
+    for (double rate : rates) {
+        double now = 0.0;
+        InputQueue queue([&now] { return now; });
+        for (const InputEvent &event : CameraScript()) {
+            queue.Push(event);
+        }
+        CameraController controller;
+        controller.Reset({}, 0.0);
+
+        std::vector<CameraState> states;
+        int frames = 0;
+        for (int check = 0; check < checkCount; check++) {
+            while (true) {
+                now = std::min((std::floor(now * rate + 1e-9) + 1.0) / rate, checks[check]);
+                controller.Advance(now, queue.Drain(now));
+                const CameraState state = controller.Sample(now);
+                frames++;
+                if (now >= checks[check]) {
+                    states.push_back(state);
+                    break;
+                }
+            }
+        }
+
+        float error = 0.f;
+        if (!results.empty()) {
+            for (int check = 0; check < checkCount; check++) {
+                const CameraState &a = results.front()[check];
+                const CameraState &b = states[check];
+                const float diffs[] = {a.theta - b.theta,         a.phi - b.phi,
+                                       a.target[0] - b.target[0], a.target[1] - b.target[1],
+                                       a.target[2] - b.target[2], a.fov - b.fov};
+                for (float diff : diffs) {
+                    error = std::fmax(error, std::fabs(diff));
+                }
+            }
+        }
+        results.push_back(states);
+
+        const InputLatency &latency = controller.Latency();
+        printf("%6.1f Hz %7d  %8.2f / %-8.2f     %g\n", rate, frames, latency.Average() * 1e3,
+               latency.worst * 1e3, error);
+    }
+
+    const CameraState &last = results.front().back();
+    printf("final theta %.2f phi %.2f target (%.1f, %.1f, %.1f) fov %.2f\n", last.theta, last.phi,
+           last.target[0], last.target[1], last.target[2], last.fov);
+    return 0;
+}
+
+int SchedulerSim(int argc, char **argv) {
+    double seconds = 60.0;
+    FrameSchedulerSettings settings;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--heartbeat") == 0 && i + 1 < argc) {
+            settings.heartbeat = atof(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (seconds <= 0.0) {
+        return Usage();
+    }
+
+    // 60 Hz display, frames take 4 ms of CPU and then wait for vsync
+    const double vsync = 1.0 / 60.0;
+    const double frameCpu = 0.004;
+    const double reloadTime = seconds / 3.0;
+
+    double now = 0.0;
+    const Clock clock = [&now] { return now; };
+    FrameScheduler scheduler(clock, settings);
+    InputQueue input(clock);
+    CameraController camera;
+    camera.Reset({}, 0.0);
+
+    std::vector<InputEvent> script = CameraScript();
+    for (InputEvent &event : script) {
+        event.time += 2.0;
+    }
+    size_t nextEvent = 0;
+    bool reloaded = false;
+    std::uint64_t reasons[5] = {};
+
+    scheduler.MarkDirty(DirtyWindow);
+    while (now < seconds) {
+        // Window messages up to now
+        for (; nextEvent < script.size() && script[nextEvent].time <= now; nextEvent++) {
+            input.Push(script[nextEvent]);
+            scheduler.MarkDirty(DirtyInput, 3);
+        }
+        if (!reloaded && now >= reloadTime) {
+            reloaded = true;
+            scheduler.MarkDirty(DirtyData);
+        }
+
+        scheduler.SetAnimating(DirtyCamera, !camera.IsSettled());
+        const double wait = std::min(scheduler.SecondsUntilFrame(), 0.1);
+        if (wait > 0.0) {
+            // Sleeps until the wait is over or a message comes in
+            double wake = now + wait;
+            if (nextEvent < script.size()) {
+                wake = std::min(wake, script[nextEvent].time);
+            }
+            if (!reloaded) {
+                wake = std::min(wake, reloadTime);
+            }
+            now = std::max(wake, now + 1e-6);
+            continue;
+        }
+
+        scheduler.BeginFrame();
+        for (int i = 0; i < 5; i++) {
+            reasons[i] += scheduler.Stats().lastReasons >> i & 1;
+        }
+        camera.Advance(now, input.Drain(now));
+        camera.Sample(now);
+        now += frameCpu;
+        scheduler.EndFrame();
+        now = (std::floor(now / vsync) + 1.0) * vsync;
+    }
+
+    const FrameStats &stats = scheduler.Stats();
+    const double continuous = seconds / vsync;
+    printf("%.0f s session, heartbeat %.2f s\n", seconds, settings.heartbeat);
+    printf("frames drawn   %8llu (%.1f%% of %.0f at every vsync)\n", (unsigned long long)stats.frames,
+           100.0 * stats.frames / continuous, continuous);
+    printf("heartbeats     %8llu\n", (unsigned long long)stats.heartbeats);
+    printf("frames for     window %llu, input %llu, camera %llu, data %llu, animation %llu\n",
+           (unsigned long long)reasons[0], (unsigned long long)reasons[1], (unsigned long long)reasons[2],
+           (unsigned long long)reasons[3], (unsigned long long)reasons[4]);
+    printf("CPU busy       %8.2f s (%.1f%%), %llu frames over budget\n", stats.totalFrame,
+           100.0 * stats.totalFrame / seconds, (unsigned long long)stats.overBudget);
+    return 0;
+}
+// Same order as the viewer, item worlds count from 1
+const std::array<const char *, 7> WorldNames{"IntroWorld", "RuinsWorld", "IceWorld", "OverWorld",
+                                             "MinesWorld", "LavaWorld",  "CraterWorld"};
+
+const int StageCount = 5;
+const char *const StageNames[StageCount] = {"input", "matrices", "cull", "filter", "icons"};
+
+struct PerfFrame {
+    double time = 0.0;
+    std::uint32_t world = 0;
+    double stageUs[StageCount] = {};
+    std::uint32_t rooms = 0;
+    std::uint32_t items = 0;
+};
+
+double Microseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The per frame work of MapViewer::OnUpdate: camera, matrices, room culling,
+// item filtering on world changes and icon quads
+class HeadlessViewer {
+public:
+    explicit HeadlessViewer(std::string dataDirectory) : m_data(std::move(dataDirectory)) {
+        m_items = LoadItemsData((m_data + "/items.data").c_str());
+        m_index.Build(m_items);
+        // Every icon is the whole atlas, the quads cost the same
+        m_uvs.assign(ItemTypeCount, AtlasUV{0.f, 0.f, 1.f, 1.f});
+    }
+
+    void Apply(const ViewerSnapshot &snapshot) {
+        m_snapshot = snapshot;
+        m_snapshot.world = std::min<std::uint32_t>(snapshot.world, (std::uint32_t)WorldNames.size() - 1);
+        m_filterDirty = true;
+    }
+
+    void HandleKey(std::uint8_t key) {
+        if (key >= '1' && key <= '7') {
+            SetWorld(key - '1');
+        }
+    }
+
+    void SetWorld(std::uint32_t world) {
+        if (world != m_snapshot.world) {
+            m_snapshot.world = world;
+            m_filterDirty = true;
+        }
+    }
+
+    // Everything after the camera update, timed into frame
+    void Frame(const CameraState &camera, PerfFrame &frame) {
+        const std::uint32_t world = m_snapshot.world;
+        frame.world = world;
+        if (!m_loaded[world]) {
+            // Loading is not part of a frame
+            m_meshes[world] = LoadWorldObj((m_data + "/" + WorldNames[world] + ".obj").c_str());
+            m_cullers[world].Build(m_meshes[world], ExtractPortals(m_meshes[world]));
+            m_loaded[world] = true;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const CameraMatrices matrices = ComputeCameraMatrices(camera, 1280.f / 720.f);
+        frame.stageUs[1] = Microseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        if (m_snapshot.portalCulling) {
+            m_cullers[world].Cull(matrices.viewProjection, matrices.eye, m_rooms);
+        } else {
+            m_rooms.resize(m_meshes[world].rooms.size());
+            for (std::uint32_t i = 0; i < m_rooms.size(); i++) {
+                m_rooms[i] = i;
+            }
+        }
+        frame.stageUs[2] = Microseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        if (m_filterDirty) {
+            m_visible = ApplyItemFilter(m_index, m_snapshot.filter, world + 1);
+            m_filterDirty = false;
+        }
+        frame.stageUs[3] = Microseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        BuildIconQuads(m_items, m_visible, m_uvs, matrices.view, m_snapshot.iconSize, m_quads);
+        frame.stageUs[4] = Microseconds(start);
+
+        frame.rooms = (std::uint32_t)m_rooms.size();
+        frame.items = (std::uint32_t)m_visible.size();
+    }
+
+private:
+    std::string m_data;
+    ViewerSnapshot m_snapshot;
+    bool m_filterDirty = true;
+
+    std::array<bool, 7> m_loaded{};
+    std::array<WorldMesh, 7> m_meshes;
+    std::array<PortalCuller, 7> m_cullers;
+    std::vector<ItemRecord> m_items;
+    ItemIndex m_index;
+    std::vector<AtlasUV> m_uvs;
+
+    std::vector<std::uint32_t> m_rooms;
+    std::vector<std::uint32_t> m_visible;
+    std::vector<IconQuad> m_quads;
+};
+
+int PerfRun(int argc, char **argv) {
+    std::string script, replay, csv, data = "data";
+    double fps = 0.0;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+    if (script.empty() == replay.empty() || fps < 0.0) {
+        return Usage();
+    }
+
+    HeadlessViewer viewer(data);
+    std::vector<PerfFrame> frames;
+
+    if (!script.empty()) {
+        std::vector<CameraPathFrame> path = LoadCameraPath(script);
+        if (fps > 0.0 && path.size() > 1) {
+            // Resampled at the given rate, holding the last frame before each time
+            std::vector<CameraPathFrame> resampled;
+            size_t next = 0;
+            for (double time = 0.0; time <= path.back().time + 1e-9; time += 1.0 / fps) {
+                while (next + 1 < path.size() && path[next + 1].time <= time + 1e-9) {
+                    next++;
+                }
+                resampled.push_back(path[next]);
+                resampled.back().time = time;
+            }
+            path = std::move(resampled);
+        }
+
+        for (const CameraPathFrame &step : path) {
+            PerfFrame frame;
+            frame.time = step.time;
+            auto start = std::chrono::steady_clock::now();
+            viewer.SetWorld(std::min<std::uint32_t>(step.world, (std::uint32_t)WorldNames.size() - 1));
+            const CameraState camera = step.camera;
+            frame.stageUs[0] = Microseconds(start);
+            viewer.Frame(camera, frame);
+            frames.push_back(frame);
+        }
+    } else {
+        const InputLog log = LoadInputLog(replay);
+        fps = fps > 0.0 ? fps : 60.0;
+
+        double now = 0.0;
+        InputQueue queue([&now] { return now; });
+        QueueReplay(log, 0.0, queue);
+        CameraController controller;
+        controller.Reset(log.snapshot.camera, 0.0);
+        viewer.Apply(log.snapshot);
+
+        // A second past the last event lets the camera settle
+        const double end = (log.events.empty() ? 0.0 : log.events.back().time) + 1.0;
+        for (int i = 0; now <= end; now = ++i / fps) {
+            PerfFrame frame;
+            frame.time = now;
+            auto start = std::chrono::steady_clock::now();
+            const std::vector<InputEvent> events = queue.Drain(now);
+            for (const InputEvent &event : events) {
+                if (event.type == InputEventType::KeyDown) {
+                    viewer.HandleKey(event.key);
+                }
+            }
+            controller.Advance(now, events);
+            const CameraState camera = controller.Sample(now);
+            frame.stageUs[0] = Microseconds(start);
+            viewer.Frame(camera, frame);
+            frames.push_back(frame);
+        }
+    }
+
+    if (!csv.empty()) {
+        FILE *handle = fopen(csv.c_str(), "w");
+        if (!handle) {
+            printf("[TOOLS][ERROR] Could not write %s\n", csv.c_str());
+            return 1;
+        }
+        fprintf(handle, "frame,time,world");
+        for (const char *name : StageNames) {
+            fprintf(handle, ",%s_us", name);
+        }
+        fprintf(handle, ",total_us,rooms,items\n");
+        for (size_t i = 0; i < frames.size(); i++) {
+            const PerfFrame &frame = frames[i];
+            double total = 0.0;
+            fprintf(handle, "%zu,%.6f,%u", i, frame.time, frame.world + 1);
+            for (double us : frame.stageUs) {
+                fprintf(handle, ",%.3f", us);
+                total += us;
+            }
+            fprintf(handle, ",%.3f,%u,%u\n", total, frame.rooms, frame.items);
+        }
+        fclose(handle);
+    }
+
+    printf("%zu frames over %.2f s\n", frames.size(), frames.empty() ? 0.0 : frames.back().time);
+    printf("stage        avg us    p95 us    max us\n");
+    std::vector<double> totals(frames.size(), 0.0);
+    for (int stage = 0; stage <= StageCount; stage++) {
+        std::vector<double> us;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (stage < StageCount) {
+                us.push_back(frames[i].stageUs[stage]);
+                totals[i] += frames[i].stageUs[stage];
+            } else {
+                us.push_back(totals[i]);
+            }
+        }
+        if (us.empty()) {
+            break;
+        }
+        double sum = 0.0;
+        for (double value : us) {
+            sum += value;
+        }
+        std::sort(us.begin(), us.end());
+        const double p95 = us[std::min(us.size() - 1, (size_t)(us.size() * 0.95))];
+        printf("%-10s %8.2f  %8.2f  %8.2f\n", stage < StageCount ? StageNames[stage] : "total",
+               sum / us.size(), p95, us.back());
+    }
+    return 0;
+}
+int QueryBench(int argc, char **argv) {
+    int itemCount = 1000000;
+    int types = 100;
+    int queries = 1000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            itemCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--types") == 0 && i + 1 < argc) {
+            types = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (itemCount < 1 || types < 1 || types > 256 || queries < 1) {
+        return Usage();
+    }
+
+    // Fixed seed, 7 worlds of 100 rooms like the game's
+    std::vector<ItemRecord> items(itemCount);
+    std::uint32_t state = 12345;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    for (ItemRecord &item : items) {
+        item.type = (std::uint8_t)(random() % types);
+        item.worldIndex = 1 + random() % 7;
+        item.roomIndex = random() % 100;
+        item.x = item.y = item.z = 0.f;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ItemIndex index;
+    index.Build(items);
+    const double buildMs = Milliseconds(start);
+    std::vector<bool> collected(itemCount);
+    for (std::uint32_t id = 0; id < (std::uint32_t)itemCount; id += 3) {
+        index.SetCollected(id, true);
+        collected[id] = true;
+    }
+
+    // The viewer's filter, a few types over a world, and every room of a
+    // world but one type
+    struct Shape {
+        const char *name;
+        std::vector<double> ms = {};
+        double scanMs = 0.0;
+        int scans = 0;
+    };
+    Shape shapes[3] = {{"type & rooms & !collected"}, {"3 types & world"}, {"all rooms & !type"}};
+    int mismatches = 0;
+    std::size_t matched = 0;
+    for (int q = 0; q < queries; q++) {
+        const int shape = q % 3;
+        const std::uint8_t a = (std::uint8_t)(random() % types), b = (std::uint8_t)(random() % types),
+                           c = (std::uint8_t)(random() % types);
+        const std::uint32_t world = 1 + random() % 7, first = random() % 100, last = first + random() % 30;
+        ItemQuery query = ItemQuery::All();
+        std::function<bool(const ItemRecord &, std::uint32_t)> scan;
+        if (shape == 0) {
+            query = ItemQuery::Type(a) & ItemQuery::Rooms(world, first, last) & !ItemQuery::Collected();
+            scan = [&](const ItemRecord &item, std::uint32_t id) {
+                return item.type == a && item.worldIndex == world && item.roomIndex >= first &&
+                       item.roomIndex <= last && !collected[id];
+            };
+        } else if (shape == 1) {
+            query = (ItemQuery::Type(a) | ItemQuery::Type(b) | ItemQuery::Type(c)) & ItemQuery::World(world);
+            scan = [&](const ItemRecord &item, std::uint32_t) {
+                return (item.type == a || item.type == b || item.type == c) && item.worldIndex == world;
+            };
+        } else {
+            query = ItemQuery::Rooms(world, 0, 0xFFFFFFFF) & !ItemQuery::Type(a);
+            scan = [&](const ItemRecord &item, std::uint32_t) {
+                return item.worldIndex == world && item.type != a;
+            };
+        }
+
+        start = std::chrono::steady_clock::now();
+        const RoaringBitmap result = query.Evaluate(index);
+        shapes[shape].ms.push_back(Milliseconds(start));
+        matched += result.Cardinality();
+
+        // A scan over every item as the reference, on a sample
+        if (q < 60) {
+            start = std::chrono::steady_clock::now();
+            std::vector<std::uint32_t> expected;
+            for (std::uint32_t id = 0; id < (std::uint32_t)itemCount; id++) {
+                if (scan(items[id], id)) {
+                    expected.push_back(id);
+                }
+            }
+            shapes[shape].scanMs += Milliseconds(start);
+            shapes[shape].scans++;
+            mismatches += result.ToVector() != expected;
+        }
+    }
+
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    };
+    printf("%d items of %d types, index built in %.1f ms, %zu matches per query on average\n", itemCount,
+           types, buildMs, matched / queries);
+    for (const Shape &shape : shapes) {
+        if (!shape.ms.empty()) {
+            printf("%-26s p50 %7.3f ms, p99 %7.3f ms, worst %7.3f ms, scan %7.3f ms\n", shape.name,
+                   percentile(shape.ms, 0.5), percentile(shape.ms, 0.99), percentile(shape.ms, 1.0),
+                   shape.scans ? shape.scanMs / shape.scans : 0.0);
+        }
+    }
+    printf("%d of %d sampled queries differ from a scan\n", mismatches, std::min(queries, 60));
+    return mismatches == 0 ? 0 : 1;
+}
+
+// View projection of a camera at eye looking along yaw on the horizon, the
+// same as XMMatrixLookToLH times XMMatrixPerspectiveFovLH
+void LookToViewProjection(const float eye[3], float yaw, float fov, float aspect, float result[16]) {
+    const float z[3] = {std::cos(yaw), 0.f, std::sin(yaw)};
+    // up (0, 1, 0) cross z, then z cross x
+    const float x[3] = {z[2], 0.f, -z[0]};
+    const float y[3] = {z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0]};
+    auto dot = [eye](const float *axis) { return axis[0] * eye[0] + axis[1] * eye[1] + axis[2] * eye[2]; };
+    const float view[16] = {x[0], y[0], z[0], 0.f, x[1], y[1], z[1], 0.f,
+                            x[2], y[2], z[2], 0.f, -dot(x), -dot(y), -dot(z), 1.f};
+
+    const float nearPlane = 0.1f, farPlane = 100000.f;
+    const float height = 1.f / std::tan(0.5f * fov), range = farPlane / (farPlane - nearPlane);
+    const float projection[16] = {height / aspect, 0.f, 0.f, 0.f, 0.f, height, 0.f, 0.f,
+                                  0.f, 0.f, range, 1.f, 0.f, 0.f, -range * nearPlane, 0.f};
+    for (int row = 0; row < 4; row++) {
+        for (int column = 0; column < 4; column++) {
+            float sum = 0.f;
+            for (int k = 0; k < 4; k++) {
+                sum += view[row * 4 + k] * projection[k * 4 + column];
+            }
+            result[row * 4 + column] = sum;
+        }
+    }
+}
+
+// Bounds not wholly outside one of the clip planes
+bool BoxInFrustum(const float viewProjection[16], const float boundsMin[3], const float boundsMax[3]) {
+    int outside[6] = {};
+    for (int corner = 0; corner < 8; corner++) {
+        float p[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = corner & (1 << k) ? boundsMax[k] : boundsMin[k];
+        }
+        float clip[4];
+        for (int column = 0; column < 4; column++) {
+            clip[column] = p[0] * viewProjection[column] + p[1] * viewProjection[4 + column] +
+                           p[2] * viewProjection[8 + column] + viewProjection[12 + column];
+        }
+        outside[0] += clip[0] < -clip[3];
+        outside[1] += clip[0] > clip[3];
+        outside[2] += clip[1] < -clip[3];
+        outside[3] += clip[1] > clip[3];
+        outside[4] += clip[2] < 0.f;
+        outside[5] += clip[2] > clip[3];
+    }
+    return std::none_of(outside, outside + 6, [](int count) { return count == 8; });
+}
+
+// The Culling benchmark of the viewer without a window: the camera stands at
+// the center of every room and turns around in steps of a few degrees
+int CullBench(int argc, char **argv) {
+    std::string data = "data";
+    int step = 10;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            step = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (step < 1 || step > 360) {
+        return Usage();
+    }
+
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    };
+    const float fov = 45.f * 3.14159265f / 180.f, aspect = 16.f / 9.f;
+    int failures = 0;
+    std::vector<double> allUs;
+    for (const char *name : WorldNames) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + name + ".obj").c_str());
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Portal> portals = ExtractPortals(mesh);
+        const size_t portalCount = portals.size();
+        PortalCuller culler;
+        culler.Build(mesh, std::move(portals));
+        const double buildMs = Milliseconds(start);
+
+        std::vector<double> us;
+        std::vector<std::uint32_t> visible;
+        std::uint64_t drawn = 0, inFrustum = 0, tested = 0, outside = 0;
+        for (const RoomMesh &room : mesh.rooms) {
+            const float eye[3] = {(room.boundsMin[0] + room.boundsMax[0]) * 0.5f,
+                                  (room.boundsMin[1] + room.boundsMax[1]) * 0.5f,
+                                  (room.boundsMin[2] + room.boundsMax[2]) * 0.5f};
+            for (int angle = 0; angle < 360; angle += step) {
+                float viewProjection[16];
+                LookToViewProjection(eye, angle * 3.14159265f / 180.f, fov, aspect, viewProjection);
+
+                PortalCullStats stats;
+                start = std::chrono::steady_clock::now();
+                culler.Cull(viewProjection, eye, visible, &stats);
+                us.push_back(Microseconds(start));
+
+                drawn += visible.size();
+                tested += stats.portalsTested;
+                outside += stats.cameraRoom < 0;
+                for (const RoomMesh &other : mesh.rooms) {
+                    inFrustum += BoxInFrustum(viewProjection, other.boundsMin, other.boundsMax);
+                }
+                // The camera room is always drawn, and every room once at most
+                const bool sorted = std::adjacent_find(visible.begin(), visible.end(),
+                                                       std::greater_equal<std::uint32_t>()) == visible.end();
+                const bool hasCamera = stats.cameraRoom < 0 ||
+                                       std::binary_search(visible.begin(), visible.end(),
+                                                          (std::uint32_t)stats.cameraRoom);
+                failures += !sorted || !hasCamera;
+            }
+        }
+        allUs.insert(allUs.end(), us.begin(), us.end());
+
+        const double views = (double)us.size();
+        printf("%-12s %3zu rooms, %3zu portals in %5.1f ms, %5zu views, p50 %6.2f us, p99 %6.2f us, "
+               "worst %7.2f us, %5.1f rooms drawn of %5.1f in the frustum, %4.1f portals tested\n",
+               name, mesh.rooms.size(), portalCount, buildMs, us.size(), percentile(us, 0.5),
+               percentile(us, 0.99), percentile(us, 1.0), drawn / views, inFrustum / views, tested / views);
+        if (outside) {
+            printf("             %llu views outside of every room, frustum culled only\n",
+                   (unsigned long long)outside);
+        }
+    }
+    printf("all worlds   %zu views, p50 %.2f us, p99 %.2f us, %d views miss the camera room or repeat one\n",
+           allUs.size(), percentile(allUs, 0.5), percentile(allUs, 0.99), failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// Checks a diff explains reloaded from current: matched items equal, every
+// reloaded item matched or added once, the affected worlds those of the
+// removals and additions
+bool ValidItemsDiff(const std::vector<ItemRecord> &current, const std::vector<ItemRecord> &reloaded,
+                    const ItemsDiff &diff) {
+    if (diff.newIds.size() != current.size()) {
+        return false;
+    }
+    auto same = [](const ItemRecord &a, const ItemRecord &b) {
+        return a.type == b.type && a.worldIndex == b.worldIndex && a.roomIndex == b.roomIndex && a.x == b.x &&
+               a.y == b.y && a.z == b.z;
+    };
+    std::vector<int> uses(reloaded.size(), 0);
+    std::vector<std::uint32_t> worlds;
+    for (size_t id = 0; id < current.size(); id++) {
+        if (diff.newIds[id] == ItemsDiff::Removed) {
+            worlds.push_back(current[id].worldIndex);
+        } else if (diff.newIds[id] >= reloaded.size() || !same(current[id], reloaded[diff.newIds[id]])) {
+            return false;
+        } else {
+            uses[diff.newIds[id]]++;
+        }
+    }
+    for (std::uint32_t id : diff.added) {
+        if (id >= reloaded.size()) {
+            return false;
+        }
+        uses[id]++;
+        worlds.push_back(reloaded[id].worldIndex);
+    }
+    std::sort(worlds.begin(), worlds.end());
+    worlds.erase(std::unique(worlds.begin(), worlds.end()), worlds.end());
+    return std::all_of(uses.begin(), uses.end(), [](int n) { return n == 1; }) &&
+           worlds == diff.affectedWorlds;
+}
+
+int ReloadCheck(int argc, char **argv) {
+    std::string data = "data";
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+
+    int failures = 0;
+    auto check = [&failures](bool passed, const std::string &name) {
+        printf("  %-44s %s\n", name.c_str(), passed ? "ok" : "FAILED");
+        failures += !passed;
+    };
+
+    printf("items.data\n");
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+    if (items.size() < 2) {
+        printf("[TOOLS][ERROR] %s/items.data has fewer than 2 items\n", data.c_str());
+        return 1;
+    }
+    {
+        const ItemsDiff diff = DiffItems(items, items);
+        check(diff.Empty() && diff.added.empty() && ValidItemsDiff(items, items, diff), "unchanged");
+
+        std::vector<ItemRecord> reloaded(items.rbegin(), items.rend());
+        const ItemsDiff reversed = DiffItems(items, reloaded);
+        check(reversed.Empty() && ValidItemsDiff(items, reloaded, reversed), "reordered");
+
+        reloaded = items;
+        reloaded[1].x += 1.f;
+        const ItemsDiff moved = DiffItems(items, reloaded);
+        const std::vector<std::uint32_t> world{items[1].worldIndex};
+        check(moved.added.size() == 1 && moved.affectedWorlds == world &&
+                  ValidItemsDiff(items, reloaded, moved),
+              "one item moved");
+
+        reloaded = items;
+        reloaded.pop_back();
+        reloaded.push_back(items[0]);
+        reloaded.push_back({ItemType_Missile, 3, 7, 1.f, 2.f, 3.f});
+        const ItemsDiff edited = DiffItems(items, reloaded);
+        check(edited.added.size() == 2 && ValidItemsDiff(items, reloaded, edited),
+              "last removed, first duplicated, one added");
+
+        const ItemsDiff cleared = DiffItems(items, {});
+        check(cleared.added.empty() && ValidItemsDiff(items, {}, cleared), "every item removed");
+    }
+
+    for (const char *name : WorldNames) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + name + ".obj").c_str());
+        printf("%s, %zu rooms\n", name, mesh.rooms.size());
+        if (mesh.rooms.size() < 2) {
+            check(false, "at least 2 rooms");
+            continue;
+        }
+        const std::uint32_t middle = (std::uint32_t)mesh.rooms.size() / 2;
+        const RoomMesh &room = mesh.rooms[middle];
+
+        WorldMeshDiff diff = DiffWorldMesh(mesh, mesh);
+        check(diff.Empty(), "unchanged");
+
+        WorldMesh reloaded = mesh;
+        reloaded.vertices[room.firstVertex + room.vertexCount - 1].position[1] += 0.5f;
+        diff = DiffWorldMesh(mesh, reloaded);
+        check(!diff.rebuild && diff.dirtyRooms == std::vector<std::uint32_t>{middle}, "vertex moved");
+
+        reloaded = mesh;
+        std::swap(reloaded.indices[room.firstIndex], reloaded.indices[room.firstIndex + 1]);
+        diff = DiffWorldMesh(mesh, reloaded);
+        check(!diff.rebuild && diff.dirtyRooms == std::vector<std::uint32_t>{middle}, "triangle rewound");
+
+        // Empty rooms at the end start past the last vertex and index
+        WorldMesh current = mesh;
+        RoomMesh empty = mesh.rooms.back();
+        empty.firstVertex = (std::uint32_t)mesh.vertices.size();
+        empty.firstIndex = (std::uint32_t)mesh.indices.size();
+        empty.vertexCount = empty.indexCount = 0;
+        current.rooms.push_back(empty);
+        reloaded = current;
+        reloaded.vertices[room.firstVertex].normal[0] = -reloaded.vertices[room.firstVertex].normal[0] + 1.f;
+        diff = DiffWorldMesh(current, reloaded);
+        check(!diff.rebuild && diff.dirtyRooms == std::vector<std::uint32_t>{middle}, "trailing empty room");
+
+        diff = DiffWorldMesh(mesh, current);
+        check(diff.rebuild, "room added");
+
+        reloaded = mesh;
+        reloaded.rooms[middle].indexCount -= 3;
+        reloaded.indices.erase(reloaded.indices.begin() + room.firstIndex,
+                               reloaded.indices.begin() + room.firstIndex + 3);
+        diff = DiffWorldMesh(mesh, reloaded);
+        check(diff.rebuild, "triangle removed");
+    }
+
+    // A save written in two parts must only be reported once it is closed,
+    // and a save renamed over the file once it lands
+    printf("file watcher\n");
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "mp-reload-check";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    {
+        FileWatcher watcher(directory.string());
+        auto pollFor = [&watcher](double seconds) {
+            std::vector<std::string> names;
+            const auto start = std::chrono::steady_clock::now();
+            do {
+                for (std::string &name : watcher.Poll()) {
+                    names.push_back(std::move(name));
+                }
+                if (!names.empty()) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            } while (Milliseconds(start) < seconds * 1e3);
+            return names;
+        };
+
+        FILE *handle = fopen((directory / "items.data").string().c_str(), "wb");
+        if (!handle) {
+            printf("[TOOLS][ERROR] Could not write to %s\n", directory.string().c_str());
+            return 1;
+        }
+        fputs("1:1:0:1.0, 2.0, 3.0\n", handle);
+        fflush(handle);
+        check(pollFor(0.2).empty(), "nothing while the file is open");
+        fputs("1:1:0:4.0, 5.0, 6.0\n", handle);
+        fclose(handle);
+        check(pollFor(1.0) == std::vector<std::string>{"items.data"}, "reported once closed");
+        check(pollFor(0.2).empty(), "reported once only");
+
+        handle = fopen((directory / "save.tmp").string().c_str(), "wb");
+        fputs("1:1:0:7.0, 8.0, 9.0\n", handle);
+        fclose(handle);
+        pollFor(0.2);
+        std::filesystem::rename(directory / "save.tmp", directory / "items.data");
+        const std::vector<std::string> renamed = pollFor(1.0);
+        check(std::find(renamed.begin(), renamed.end(), "items.data") != renamed.end(), "renamed over");
+    }
+    std::filesystem::remove_all(directory);
+
+    printf("%d checks failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
+
+int BrowserBench(int argc, char **argv) {
+    int rows = 1000000;
+    int frameCount = 600;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+            rows = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frameCount = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (rows < 1 || frameCount < 1) {
+        return Usage();
+    }
+
+    // Fixed seed, every run browses the same layout
+    std::vector<ItemRecord> items(rows);
+    std::uint32_t state = 12345;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    for (ItemRecord &item : items) {
+        item.type = (std::uint8_t)(random() % ItemTypeCount);
+        item.worldIndex = 1 + random() % 7;
+        item.roomIndex = random() % 100;
+        item.x = (float)(random() % 20000) * 0.1f - 1000.f;
+        item.y = (float)(random() % 20000) * 0.1f - 1000.f;
+        item.z = (float)(random() % 2000) * 0.1f - 100.f;
+    }
+    ItemIndex index;
+    index.Build(items);
+    for (std::uint32_t id = 0; id < (std::uint32_t)rows; id += 3) {
+        index.SetCollected(id, true);
+    }
+
+    // ImGui without a backend, draw data is built and dropped
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(1280.f, 720.f);
+    io.DeltaTime = 1.f / 60.f;
+    unsigned char *pixels;
+    int width, height;
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+
+    ItemBrowser browser;
+    std::vector<double> steady, rebuilt;
+    for (int frame = 0; frame < frameCount; frame++) {
+        // Jumps around the table every frame, rebuilds the rows now and then
+        // as after a reload
+        browser.ScrollToRow((std::uint32_t)(((std::uint64_t)frame * 7919) % rows));
+        if (frame % 100 == 50) {
+            browser.Invalidate();
+        }
+
+        const std::uint64_t rebuilds = browser.Stats().rebuilds;
+        auto start = std::chrono::steady_clock::now();
+        ImGui::NewFrame();
+        ImGui::SetNextWindowPos(ImVec2(0.f, 0.f));
+        ImGui::SetNextWindowSize(io.DisplaySize);
+        ImGui::Begin("Items", nullptr, ImGuiWindowFlags_NoDecoration);
+        browser.Draw(items, index, 600.f);
+        ImGui::End();
+        ImGui::Render();
+        const double us = Microseconds(start);
+        (browser.Stats().rebuilds != rebuilds ? rebuilt : steady).push_back(us);
+    }
+
+    std::sort(steady.begin(), steady.end());
+    double total = 0.0;
+    for (double us : steady) {
+        total += us;
+    }
+    printf("%d rows, %d frames\n", rows, frameCount);
+    if (!steady.empty()) {
+        const double p95 = steady[std::min(steady.size() - 1, (size_t)(steady.size() * 0.95))];
+        printf("cached order     %8.1f us avg, %8.1f us p95, %8.1f us worst (%s 200 us)\n",
+               total / steady.size(), p95, steady.back(), p95 < 200.0 ? "under" : "OVER");
+    }
+    for (double us : rebuilt) {
+        printf("rebuilt order    %8.2f ms\n", us * 1e-3);
+    }
+
+    // Every column on its own, as a click on its header
+    static const char *const ColumnNames[ItemColumnCount] = {"type", "world", "room", "x",
+                                                             "y",    "z",     "collected"};
+    const std::vector<std::uint32_t> all = index.All().ToVector();
+    for (std::uint32_t column = 0; column < ItemColumnCount; column++) {
+        std::vector<std::uint32_t> ids = all;
+        auto start = std::chrono::steady_clock::now();
+        SortItemIds(items, index, {{(ItemColumn)column, column % 2 == 1}}, ids);
+        printf("sort by %-9s %8.2f ms\n", ColumnNames[column], Milliseconds(start));
+    }
+
+    ImGui::DestroyContext();
+    return 0;
+}
+// Everything a build produces that the renderer and text layout use
+std::uint64_t FontAtlasChecksum(ImFontAtlas &atlas) {
+    unsigned char *pixels;
+    int width, height;
+    atlas.GetTexDataAsAlpha8(&pixels, &width, &height);
+    std::uint64_t hash = HashBytes(pixels, (size_t)width * height);
+    for (const ImFont *font : atlas.Fonts) {
+        hash = HashBytes(font->Glyphs.Data, sizeof(ImFontGlyph) * font->Glyphs.Size, hash);
+        hash = HashBytes(font->IndexAdvanceX.Data, sizeof(float) * font->IndexAdvanceX.Size, hash);
+        hash = HashBytes(&font->Ascent, sizeof(float), hash);
+    }
+    for (const ImFontAtlasCustomRect &rect : atlas.CustomRects) {
+        hash = HashBytes(&rect.X, sizeof(rect.X), hash);
+        hash = HashBytes(&rect.Y, sizeof(rect.Y), hash);
+    }
+    return hash;
+}
+
+int FontBench(int argc, char **argv) {
+    std::string font;
+    float size = 13.f;
+    bool cjk = false;
+    int repeat = 10;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--font") == 0 && i + 1 < argc) {
+            font = argv[++i];
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--ranges") == 0 && i + 1 < argc) {
+            cjk = strcmp(argv[++i], "cjk") == 0;
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (size <= 0.f || repeat < 1) {
+        return Usage();
+    }
+
+    std::vector<std::uint8_t> fontData;
+    if (!font.empty()) {
+        fontData = ReadFile(font.c_str());
+    }
+    auto addFonts = [&](ImFontAtlas &atlas) {
+        ImFontConfig config;
+        config.SizePixels = size;
+        const ImWchar *ranges =
+            cjk ? atlas.GetGlyphRangesChineseSimplifiedCommon() : atlas.GetGlyphRangesDefault();
+        if (fontData.empty()) {
+            config.GlyphRanges = ranges;
+            atlas.AddFontDefault(&config);
+            return;
+        }
+        // The atlas frees its copy
+        void *copy = IM_ALLOC(fontData.size());
+        memcpy(copy, fontData.data(), fontData.size());
+        atlas.AddFontFromMemoryTTF(copy, (int)fontData.size(), size, &config, ranges);
+    };
+
+    double buildMs = 0.0;
+    std::uint64_t built = 0;
+    for (int i = 0; i < repeat; i++) {
+        ImFontAtlas atlas;
+        addFonts(atlas);
+        auto start = std::chrono::steady_clock::now();
+        atlas.Build();
+        buildMs += Milliseconds(start);
+        built = FontAtlasChecksum(atlas);
+    }
+
+    // Stores the atlas on the first call if it is not cached yet
+    const AssetCache cache("cache");
+    {
+        ImFontAtlas atlas;
+        addFonts(atlas);
+        BuildFontAtlasCached(atlas, cache);
+    }
+
+    double keyMs = 0.0, loadMs = 0.0;
+    int hits = 0, mismatches = 0;
+    for (int i = 0; i < repeat; i++) {
+        ImFontAtlas atlas;
+        addFonts(atlas);
+        auto start = std::chrono::steady_clock::now();
+        FontAtlasKey(atlas);
+        keyMs += Milliseconds(start);
+
+        start = std::chrono::steady_clock::now();
+        hits += BuildFontAtlasCached(atlas, cache);
+        loadMs += Milliseconds(start);
+        mismatches += FontAtlasChecksum(atlas) != built;
+    }
+
+    ImFontAtlas atlas;
+    addFonts(atlas);
+    atlas.Build();
+    int glyphs = 0;
+    for (const ImFont *f : atlas.Fonts) {
+        glyphs += f->Glyphs.Size;
+    }
+    printf("%s at %.0f px, %s ranges: %d glyphs in a %dx%d atlas\n",
+           font.empty() ? "default font" : font.c_str(), size, cjk ? "CJK" : "default", glyphs,
+           atlas.TexWidth, atlas.TexHeight);
+    printf("build          %8.3f ms\n", buildMs / repeat);
+    printf("cache load     %8.3f ms (%.3f ms of it hashing the font), %d/%d hits, %d mismatches\n",
+           loadMs / repeat, keyMs / repeat, hits, repeat, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Corners of a face from the first in coordinate order on, winding kept
+std::array<float, 9> CanonicalFace(const WorldMesh &mesh, size_t firstIndex) {
+    std::array<float, 9> face;
+    int first = 0;
+    for (int corner = 0; corner < 3; corner++) {
+        std::copy_n(mesh.vertices[mesh.indices[firstIndex + corner]].position, 3, &face[corner * 3]);
+        if (std::lexicographical_compare(&face[corner * 3], &face[corner * 3] + 3, &face[first * 3],
+                                         &face[first * 3] + 3)) {
+            first = corner;
+        }
+    }
+    std::rotate(face.begin(), face.begin() + first * 3, face.end());
+    return face;
+}
+
+int Progressive(int argc, char **argv) {
+    std::string data = "data";
+    int chunk = 1460;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) {
+            chunk = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (chunk < 1) {
+        return Usage();
+    }
+
+    const double checkpoints[] = {0.05, 0.1, 0.25, 0.5, 0.75, 1.0};
+    int mismatches = 0;
+    for (const char *name : WorldNames) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + name + ".obj").c_str());
+        const std::vector<std::uint8_t> geometry = EncodeWorldGeometry(mesh);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<float> errors;
+        const std::vector<std::uint8_t> stream = EncodeProgressiveMesh(mesh, &errors);
+        const double encodeMs = Milliseconds(start);
+        // The error left once the first n splits are in
+        std::vector<float> remaining(errors.size() + 1, 0.f);
+        for (size_t i = errors.size(); i-- > 0;) {
+            remaining[i] = std::max(remaining[i + 1], errors[i]);
+        }
+
+        // Fed as it would come off the network
+        ProgressiveMeshDecoder decoder;
+        size_t firstFrame = 0, fed = 0, checkpoint = 0;
+        std::string curve;
+        double decodeMs = 0.0;
+        while (fed < stream.size()) {
+            const size_t size = std::min<size_t>(chunk, stream.size() - fed);
+            start = std::chrono::steady_clock::now();
+            decoder.Feed(stream.data() + fed, size);
+            decodeMs += Milliseconds(start);
+            fed += size;
+            if (!firstFrame && decoder.HasBase()) {
+                firstFrame = fed;
+                printf("%-12s %5u tris, geometry %6.1f KB, stream %6.1f KB, encoded in %6.1f ms\n", name,
+                       (unsigned)(mesh.indices.size() / 3), geometry.size() / 1024.0, stream.size() / 1024.0,
+                       encodeMs);
+                printf("  first frame after %5.1f KB (%4.1f%% of the geometry): %u tris, error %.3f\n",
+                       firstFrame / 1024.0, 100.0 * firstFrame / geometry.size(), decoder.FaceCount(),
+                       remaining[decoder.SplitsApplied()]);
+            }
+            while (checkpoint < std::size(checkpoints) && fed >= checkpoints[checkpoint] * stream.size()) {
+                char point[64];
+                snprintf(point, sizeof(point), "%s%3.0f%%: %3.0f%% tris err %.3f", curve.empty() ? "" : ", ",
+                         checkpoints[checkpoint] * 100.0, 300.0 * decoder.FaceCount() / mesh.indices.size(),
+                         remaining[decoder.SplitsApplied()]);
+                curve += point;
+                checkpoint++;
+            }
+        }
+        printf("  refinement   %s\n", curve.c_str());
+
+        // The whole stream is the world, as far as the plain geometry file
+        // keeps it, with normals facing the same way
+        const WorldMesh plain = DecodeWorldGeometry(geometry);
+        std::map<std::array<float, 9>, std::pair<int, const float *>> faces;
+        for (size_t i = 0; i < plain.indices.size(); i += 3) {
+            const std::array<float, 9> face = CanonicalFace(plain, i);
+            const bool degenerate = std::equal(&face[0], &face[3], &face[3]) ||
+                                    std::equal(&face[3], &face[6], &face[6]) ||
+                                    std::equal(&face[0], &face[3], &face[6]);
+            auto &[count, normal] = faces[face];
+            count += degenerate ? 0 : 1;
+            normal = plain.vertices[plain.indices[i]].normal;
+        }
+        const WorldMesh decoded = decoder.Mesh();
+        int missing = 0, flipped = 0;
+        for (size_t i = 0; i < decoded.indices.size(); i += 3) {
+            const auto found = faces.find(CanonicalFace(decoded, i));
+            if (found == faces.end() || found->second.first == 0) {
+                missing++;
+                continue;
+            }
+            found->second.first--;
+            const float *normal = decoded.vertices[decoded.indices[i]].normal;
+            const float *expected = found->second.second;
+            flipped += normal[0] * expected[0] + normal[1] * expected[1] + normal[2] * expected[2] < 0.f;
+        }
+        for (const auto &[face, entry] : faces) {
+            missing += entry.first;
+        }
+        const bool matches = decoder.Complete() && missing == 0 && flipped == 0;
+        printf("  decoded in %.2f ms in %d byte chunks, %s (%d faces missing or extra, %d flipped)\n",
+               decodeMs, chunk, matches ? "matches the geometry" : "DIFFERS from the geometry", missing,
+               flipped);
+        mismatches += matches ? 0 : 1;
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+// A room of a world and the records items.data has there
+struct LayoutRoom {
+    std::uint32_t worldIndex;
+    std::string name;
+    std::vector<std::uint32_t> records;
+};
+
+// What importing a generated layout has to give
+struct LayoutExpected {
+    std::uint32_t items = 0;
+    std::uint64_t checksum = 0;
+};
+
+std::uint64_t RecordHash(const ItemRecord &item) {
+    float fields[6] = {(float)item.type, (float)item.worldIndex, (float)item.roomIndex, item.x, item.y,
+                       item.z};
+    return HashBytes(fields, sizeof(fields));
+}
+
+void AppendJsonString(std::string &out, std::string_view text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+const char *const LayoutArtifacts[] = {"Truth",     "Strength", "Elder",  "Wild",  "Lifegiver", "Warrior",
+                                       "Chozo",     "Nature",   "Sun",    "World", "Spirit",    "Newborn"};
+const char *const LayoutUpgrades[] = {"Morph Ball",    "Morph Ball Bomb", "Boost Ball",   "Spider Ball",
+                                      "Power Bomb",    "Space Jump Boots", "Grapple Beam", "Varia Suit",
+                                      "Gravity Suit",  "Phazon Suit",     "Wave Beam",    "Ice Beam",
+                                      "Plasma Beam",   "Charge Beam",     "Super Missile", "Wavebuster",
+                                      "Ice Spreader",  "Flamethrower",    "Combat Visor", "Scan Visor",
+                                      "Thermal Visor", "X-Ray Visor",     "Power Bomb Expansion"};
+
+// Rooms of a world with a name, and the records items.data has in each
+void AddLayoutRooms(std::uint32_t worldIndex, const WorldMesh &mesh, const std::vector<ItemRecord> &records,
+                    std::vector<LayoutRoom> &rooms) {
+    for (const RoomMesh &room : mesh.rooms) {
+        if (room.roomIndex < 0) {
+            continue;
+        }
+        const std::string name = RoomDisplayName(room.name);
+        if (std::any_of(rooms.begin(), rooms.end(), [&](const LayoutRoom &r) {
+                return r.worldIndex == worldIndex && r.name == name;
+            })) {
+            continue;
+        }
+        rooms.push_back({worldIndex, name, {}});
+        for (std::uint32_t i = 0; i < records.size(); i++) {
+            if (records[i].worldIndex == worldIndex &&
+                records[i].roomIndex == (std::uint32_t)room.roomIndex) {
+                rooms.back().records.push_back(i);
+            }
+        }
+    }
+}
+
+// Shaped like a Randovania spoiler log: every known location and 37 more in
+// rooms without items, holding the 100 pickups of the game shuffled
+std::string GenerateLayout(std::uint32_t seed, const std::vector<ItemRecord> &records,
+                           const std::vector<LayoutRoom> &rooms, LayoutExpected &expected) {
+    std::uint32_t state = seed * 2654435761u + 1;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+
+    std::vector<std::string> pickups;
+    pickups.insert(pickups.end(), 14, "Energy Tank");
+    pickups.insert(pickups.end(), 49, "Missile Expansion");
+    for (const char *artifact : LayoutArtifacts) {
+        pickups.push_back(std::string("Artifact of ") + artifact);
+    }
+    pickups.insert(pickups.end(), std::begin(LayoutUpgrades), std::end(LayoutUpgrades));
+    pickups.insert(pickups.end(), 2, "Power Bomb Expansion");
+
+    // Locations of every room, the extra ones in rooms items.data has none in
+    std::vector<std::uint32_t> extra(rooms.size(), 0);
+    std::vector<std::uint32_t> empty;
+    for (std::uint32_t i = 0; i < rooms.size(); i++) {
+        if (rooms[i].records.empty()) {
+            empty.push_back(i);
+        }
+    }
+    for (size_t i = records.size(); i < pickups.size() && !empty.empty(); i++) {
+        extra[empty[random() % empty.size()]]++;
+    }
+    for (size_t i = pickups.size(); i-- > 1;) {
+        std::swap(pickups[i], pickups[random() % (i + 1)]);
+    }
+
+    std::string json;
+    char text[512];
+    snprintf(text, sizeof(text),
+             "{\n  \"schema_version\": 22,\n  \"info\": {\n    \"randovania_version\": \"8.%u.0\",\n"
+             "    \"seed\": %u,\n    \"hash\": \"Caf\\u00e9 \\\"%06X\\\" \\ud83d\\ude00\",\n"
+             "    \"has_spoiler\": true,\n    \"presets\": [{\"name\": \"Starter Preset\", "
+             "\"weight\": %.3e, \"tags\": [null, false]}]\n  },\n",
+             seed % 10, seed, random() & 0xFFFFFF, 1.0 + random() % 1000 / 7.0);
+    json += text;
+    json += "  \"game_modifications\": [\n    {\n      \"game\": \"prime1\",\n      \"locations\": {";
+
+    expected = {};
+    std::vector<std::string> order;
+    size_t next = 0;
+    std::uint32_t world = 0;
+    for (std::uint32_t i = 0; i < rooms.size(); i++) {
+        const LayoutRoom &room = rooms[i];
+        const size_t count = room.records.size() + extra[i];
+        if (count == 0) {
+            continue;
+        }
+        if (room.worldIndex != world) {
+            json += world ? "\n        },\n        " : "\n        ";
+            AppendJsonString(json, LayoutRegionName(room.worldIndex));
+            json += ": {";
+            world = room.worldIndex;
+        } else {
+            json += ',';
+        }
+        for (size_t k = 0; k < count && next < pickups.size(); k++, next++) {
+            snprintf(text, sizeof(text), "%s/Pickup (%zu)", room.name.c_str(), k + 1);
+            json += k ? ",\n          " : "\n          ";
+            AppendJsonString(json, text);
+            json += ": ";
+            AppendJsonString(json, pickups[next]);
+            order.push_back(pickups[next] + " at " + LayoutRegionName(room.worldIndex) + "/" + text);
+
+            const int type = pickups[next] == "Energy Tank"         ? ItemType_EnergyTank
+                             : pickups[next] == "Missile Expansion" ? ItemType_Missile
+                                                                    : -1;
+            if (k < room.records.size() && type >= 0) {
+                ItemRecord item = records[room.records[k]];
+                item.type = (std::uint8_t)type;
+                expected.items++;
+                expected.checksum += RecordHash(item);
+            }
+        }
+    }
+    json += world ? "\n        }\n      },\n" : "},\n";
+    json += "      \"hints\": {\"Artifact Temple\": {\"hint_type\": \"location\", \"precision\": -1.5e-2}}\n"
+            "    }\n  ],\n  \"item_order\": [";
+    for (size_t i = 0; i < order.size(); i++) {
+        json += i ? ",\n    " : "\n    ";
+        AppendJsonString(json, order[i]);
+    }
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+// Layouts 0 to count - 1 in dir, the missing ones generated
+std::vector<std::string> LayoutPaths(const std::string &dir, int count,
+                                     const std::vector<ItemRecord> &records,
+                                     const std::vector<LayoutRoom> &rooms,
+                                     std::vector<LayoutExpected> &expected, int &written) {
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> paths(count);
+    expected.resize(count);
+    written = 0;
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "/layout_%05d.json", i);
+        paths[i] = dir + name;
+        const std::string json = GenerateLayout(i, records, rooms, expected[i]);
+        if (!std::filesystem::exists(paths[i])) {
+            std::ofstream(paths[i], std::ios::binary).write(json.data(), json.size());
+            written++;
+        }
+    }
+    return paths;
+}
+
+// Into text, reusing its memory
+bool ReadText(const std::string &path, std::string &text) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    text.resize(size > 0 ? (size_t)size : 0);
+    const bool read = fread(text.data(), 1, text.size(), file) == text.size();
+    fclose(file);
+    return read;
+}
+
+bool MatchesLayout(const LayoutItems &items, const LayoutExpected &expected) {
+    std::uint64_t checksum = 0;
+    for (const ItemRecord &item : items.items) {
+        checksum += RecordHash(item);
+    }
+    return items.items.size() == expected.items && checksum == expected.checksum;
+}
+
+int LayoutBench(int argc, char **argv) {
+    int logs = 10000;
+    int threads = 0;
+    std::string dir = "cache/layouts";
+    std::string data = "data";
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--logs") == 0 && i + 1 < argc) {
+            logs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+    if (logs < 1 || threads < 0) {
+        return Usage();
+    }
+
+    const std::vector<ItemRecord> records = LoadItemsData((data + "/items.data").c_str());
+    LayoutImporter importer(records);
+    std::vector<LayoutRoom> rooms;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        importer.AddWorld(world + 1, mesh);
+        AddLayoutRooms(world + 1, mesh, records, rooms);
+    }
+
+    std::vector<LayoutExpected> expected(logs);
+    int written = 0;
+    const std::vector<std::string> paths = LayoutPaths(dir, logs, records, rooms, expected, written);
+
+    // One at a time, read, parse and the walk to items apart
+    std::string text, copy;
+    JsonDocument document;
+    double readMs = 0.0, parseMs = 0.0, importMs = 0.0;
+    size_t bytes = 0;
+    int mismatches = 0;
+    for (int i = 0; i < logs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!ReadText(paths[i], text)) {
+            throw std::runtime_error("Can't read " + paths[i]);
+        }
+        readMs += Milliseconds(start);
+        bytes += text.size();
+        copy = text;
+        start = std::chrono::steady_clock::now();
+        document.Parse(copy);
+        parseMs += Milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        mismatches += MatchesLayout(importer.Import(text, document), expected[i]) ? 0 : 1;
+        importMs += Milliseconds(start);
+    }
+    const double serialMs = readMs + importMs;
+
+    ThreadPool pool(threads);
+    std::vector<std::uint8_t> matches(logs, 0);
+    const auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor((std::uint32_t)logs, [&](std::uint32_t i) {
+        thread_local std::string json;
+        thread_local JsonDocument parsed;
+        if (ReadText(paths[i], json)) {
+            matches[i] = MatchesLayout(importer.Import(json, parsed), expected[i]);
+        }
+    });
+    const double poolMs = Milliseconds(start);
+    for (std::uint8_t match : matches) {
+        mismatches += match ? 0 : 1;
+    }
+
+    const double megabytes = bytes / (1024.0 * 1024.0);
+    printf("%d layouts in %s (%d written), %.1f MB, %.1f KB each\n", logs, dir.c_str(), written, megabytes,
+           bytes / 1024.0 / logs);
+    printf("one at a time  %8.2f ms, %8.0f logs/s, %7.1f MB/s\n", serialMs, logs * 1000.0 / serialMs,
+           megabytes * 1000.0 / serialMs);
+    printf("  read         %8.2f ms\n", readMs);
+    printf("  parse        %8.2f ms, %7.1f MB/s\n", parseMs, megabytes * 1000.0 / parseMs);
+    printf("  to items     %8.2f ms\n", importMs - parseMs);
+    printf("thread pool    %8.2f ms, %8.0f logs/s, %7.1f MB/s on %u threads, %.1fx\n", poolMs,
+           logs * 1000.0 / poolMs, megabytes * 1000.0 / poolMs, pool.ThreadCount(), serialMs / poolMs);
+    printf("%d of %d imports match the generated items\n", logs * 2 - mismatches, logs * 2);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Requirements on a share of every link, room and item: upgrades alone, or
+// counts of the expansions the runner picks up along the way
+std::string GenerateLogic(const RoomGraph &graph, const std::vector<ItemRecord> &items,
+                          const std::vector<std::string> &upgrades, std::uint32_t seed) {
+    const std::uint32_t kinds = (std::uint32_t)upgrades.size();
+    std::uint32_t state = seed;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    auto requirement = [&] {
+        std::string text;
+        const std::uint32_t clauses = 1 + random() % 2;
+        for (std::uint32_t c = 0; c < clauses; c++) {
+            text += c ? " | (" : "(";
+            const std::uint32_t atoms = 1 + random() % 3;
+            for (std::uint32_t a = 0; a < atoms; a++) {
+                char atom[64];
+                const std::uint32_t pick = random() % (kinds + 4);
+                const std::uint32_t counts[] = {1, 2, 3, 5, 8};
+                if (pick < kinds) {
+                    snprintf(atom, sizeof(atom), "%s%s", a ? " & " : "", upgrades[pick].c_str());
+                } else {
+                    snprintf(atom, sizeof(atom), "%s%s %u", a ? " & " : "",
+                             pick % 2 ? "Energy Tank" : "Missile Expansion", counts[random() % 5]);
+                }
+                text += atom;
+            }
+            text += ")";
+        }
+        return text;
+    };
+
+    const std::vector<RoomNode> &nodes = graph.Nodes();
+    auto room = [&nodes](std::uint32_t node) {
+        char text[16];
+        snprintf(text, sizeof(text), "%u:%02d", nodes[node].worldIndex, nodes[node].roomIndex);
+        return std::string(text);
+    };
+    std::string logic = "start 4:00\n";
+    for (const RoomLink &link : graph.Links()) {
+        if (random() % 100 < 35) {
+            const char *way = random() % 4 ? " - " : " > ";
+            logic += room(link.a) + way + room(link.b) + ": " + requirement() + "\n";
+        }
+    }
+    for (std::uint32_t node = 0; node < nodes.size(); node++) {
+        if (nodes[node].roomIndex >= 0 && random() % 100 < 10) {
+            logic += room(node) + ": " + requirement() + "\n";
+        }
+    }
+    std::map<std::pair<std::uint32_t, std::uint32_t>, int> itemsInRoom;
+    for (const ItemRecord &item : items) {
+        const int n = ++itemsInRoom[{item.worldIndex, item.roomIndex}];
+        if (random() % 100 < 50) {
+            char text[32];
+            snprintf(text, sizeof(text), "%u:%02u.%d: ", item.worldIndex, item.roomIndex, n);
+            logic += text + requirement() + "\n";
+        }
+    }
+    return logic;
+}
+
+int ReachBench(int argc, char **argv) {
+    std::string data = "data";
+    int kinds = 24;
+    int runs = 50;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--kinds") == 0 && i + 1 < argc) {
+            kinds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (kinds < 1 || kinds > 100 || runs < 1) {
+        return Usage();
+    }
+
+    RoomGraph graph;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        graph.AddWorld(world + 1, mesh, ExtractPortals(mesh));
+    }
+    graph.LoadOverrides((data + "/room_links.txt").c_str());
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+
+    std::vector<double> pickupUs, solveUs;
+    std::uint64_t pickupTests = 0, solveTests = 0;
+    int mismatches = 0;
+    std::vector<std::string> upgrades;
+    for (int kind = 0; kind < kinds; kind++) {
+        upgrades.push_back(std::string("Upgrade ") + (char)('A' + kind / 26) + (char)('a' + kind % 26));
+    }
+
+    Reachability reachability;
+    for (int run = 0; run < runs; run++) {
+        reachability.Build(graph, items);
+        reachability.ApplyLogic(GenerateLogic(graph, items, upgrades, 1000 + run));
+        const std::uint32_t startRooms = reachability.ReachableRooms();
+
+        // Every upgrade once and the expansions of the game, shuffled
+        std::vector<std::uint32_t> pickups;
+        for (std::uint32_t kind = 0; kind < reachability.KindCount(); kind++) {
+            const std::string &name = reachability.KindName(kind);
+            pickups.insert(pickups.end(), name == "Energy Tank" ? 14 : name == "Missile Expansion" ? 49 : 1,
+                           kind);
+        }
+        std::uint32_t state = run * 7919u + 1;
+        for (size_t i = pickups.size(); i-- > 1;) {
+            state = state * 1664525u + 1013904223u;
+            std::swap(pickups[i], pickups[(state >> 8) % (i + 1)]);
+        }
+
+        for (std::uint32_t kind : pickups) {
+            auto start = std::chrono::steady_clock::now();
+            reachability.SetCount(kind, reachability.Count(kind) + 1);
+            pickupUs.push_back(Microseconds(start));
+            pickupTests += reachability.LastTests();
+
+            Reachability full = reachability;
+            start = std::chrono::steady_clock::now();
+            full.Solve();
+            solveUs.push_back(Microseconds(start));
+            solveTests += full.LastTests();
+            bool same = full.ReachableRooms() == reachability.ReachableRooms() &&
+                        full.ReachableLocations() == reachability.ReachableLocations();
+            for (std::uint32_t i = 0; i < full.RoomCount() && same; i++) {
+                same = full.RoomReachable(i) == reachability.RoomReachable(i);
+            }
+            for (std::uint32_t i = 0; i < full.LocationCount() && same; i++) {
+                same = full.LocationReachable(i) == reachability.LocationReachable(i);
+            }
+            mismatches += same ? 0 : 1;
+        }
+        if (run == 0) {
+            printf("%u rooms, %zu links, %u items, %u item kinds in the logic, %zu pickups per run\n",
+                   reachability.RoomCount(), graph.Links().size(), reachability.LocationCount(),
+                   reachability.KindCount(), pickups.size());
+            printf("first run      %u rooms reachable at the start, %u with everything, %u/%u items\n",
+                   startRooms, reachability.ReachableRooms(), reachability.ReachableLocations(),
+                   reachability.LocationCount());
+        }
+    }
+
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    };
+    printf("pickup         p50 %6.2f us, p99 %6.2f us, worst %6.2f us, %.1f tests on average\n",
+           percentile(pickupUs, 0.5), percentile(pickupUs, 0.99), percentile(pickupUs, 1.0),
+           (double)pickupTests / pickupUs.size());
+    printf("full solve     p50 %6.2f us, p99 %6.2f us, worst %6.2f us, %.1f tests on average\n",
+           percentile(solveUs, 0.5), percentile(solveUs, 0.99), percentile(solveUs, 1.0),
+           (double)solveTests / solveUs.size());
+    printf("%zu pickups over %d runs, %d differ from a full solve\n", pickupUs.size(), runs, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+int TourBench(int argc, char **argv) {
+    std::string data = "data";
+    int stops = 100;
+    int runs = 20;
+    TourOptions options;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--stops") == 0 && i + 1 < argc) {
+            stops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--restarts") == 0 && i + 1 < argc) {
+            options.restarts = (std::uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = (std::uint32_t)atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (stops < 2 || runs < 1 || options.restarts < 1) {
+        return Usage();
+    }
+    const std::uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+
+    auto start = std::chrono::steady_clock::now();
+    RoomGraph graph;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        graph.AddWorld(world + 1, mesh, ExtractPortals(mesh));
+    }
+    graph.LoadOverrides((data + "/room_links.txt").c_str());
+    graph.ComputeShortestPaths();
+    printf("%zu rooms, %zu links, graph and shortest paths in %.1f ms\n", graph.Nodes().size(),
+           graph.Links().size(), Milliseconds(start));
+
+    // Solved on one thread and on many, the result must not change with the
+    // thread count
+    int mismatches = 0;
+    auto solve = [&](const std::vector<float> &costs, std::uint32_t count, double &serialMs, double &poolMs) {
+        TourOptions serial = options;
+        serial.threads = 1;
+        auto start = std::chrono::steady_clock::now();
+        const Tour one = SolveTour(costs, count, serial);
+        serialMs = Milliseconds(start);
+
+        TourOptions parallel = options;
+        parallel.threads = threads;
+        start = std::chrono::steady_clock::now();
+        const Tour many = SolveTour(costs, count, parallel);
+        poolMs = Milliseconds(start);
+
+        std::vector<std::uint32_t> sorted = one.order;
+        std::sort(sorted.begin(), sorted.end());
+        bool valid = sorted.size() == count;
+        for (std::uint32_t i = 0; valid && i < count; i++) {
+            valid = sorted[i] == i;
+        }
+        mismatches += !valid || one.order != many.order;
+        return one;
+    };
+
+    // Every item of the data file
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+    std::vector<std::uint32_t> ids(items.size());
+    for (std::uint32_t i = 0; i < ids.size(); i++) {
+        ids[i] = i;
+    }
+    double serialMs, poolMs;
+    const Tour all = solve(ItemTravelCosts(graph, items, ids), (std::uint32_t)ids.size(), serialMs, poolMs);
+    printf("%zu items       %8.2f ms on 1 thread, %8.2f ms on %u threads, length %.0f\n", ids.size(),
+           serialMs, poolMs, threads, all.length);
+
+    // Stops scattered over random rooms, positions as items.data writes them
+    std::uint32_t state = 777;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.f;
+    };
+    std::vector<double> serialTimes, poolTimes;
+    double length = 0.0;
+    for (int run = 0; run < runs; run++) {
+        std::vector<ItemRecord> scattered(stops);
+        for (ItemRecord &item : scattered) {
+            const RoomNode &node = graph.Nodes()[(size_t)(random() * graph.Nodes().size())];
+            item.type = ItemType_Missile;
+            item.worldIndex = node.worldIndex;
+            item.roomIndex = (std::uint32_t)node.roomIndex;
+            item.x = node.center[0] + (random() - 0.5f) * 20.f;
+            item.y = node.center[2] + (random() - 0.5f) * 20.f;
+            item.z = node.center[1] + (random() - 0.5f) * 4.f;
+        }
+        std::vector<std::uint32_t> scatteredIds(stops);
+        for (int i = 0; i < stops; i++) {
+            scatteredIds[i] = (std::uint32_t)i;
+        }
+        const std::vector<float> costs = ItemTravelCosts(graph, scattered, scatteredIds);
+        const Tour tour = solve(costs, (std::uint32_t)stops, serialMs, poolMs);
+        serialTimes.push_back(serialMs);
+        poolTimes.push_back(poolMs);
+        length += tour.length;
+    }
+
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    };
+    printf("%d runs of %d stops, %u restarts, %.0f long on average\n", runs, stops, options.restarts,
+           length / runs);
+    printf("1 thread       p50 %8.2f ms, worst %8.2f ms\n", percentile(serialTimes, 0.5),
+           percentile(serialTimes, 1.0));
+    printf("%-2u threads     p50 %8.2f ms, worst %8.2f ms, %.2fx\n", threads, percentile(poolTimes, 0.5),
+           percentile(poolTimes, 1.0), percentile(serialTimes, 0.5) / percentile(poolTimes, 0.5));
+    printf("%d of %d tours differ between 1 and %u threads or miss a stop\n", mismatches, runs + 1, threads);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// One letter replaced, dropped, doubled or swapped with the next
+std::string WithTypo(const std::string &name, std::uint32_t random) {
+    std::string typo = name;
+    if (typo.size() < 2) {
+        return typo;
+    }
+    const size_t at = (random >> 2) % (typo.size() - 1);
+    switch (random % 4) {
+    case 0:
+        typo[at] = typo[at] == 'e' ? 'a' : 'e';
+        break;
+    case 1:
+        typo.erase(at, 1);
+        break;
+    case 2:
+        typo.insert(at, 1, typo[at]);
+        break;
+    default:
+        std::swap(typo[at], typo[at + 1]);
+        break;
+    }
+    return typo;
+}
+
+int SearchBench(int argc, char **argv) {
+    std::string data = "data";
+    int names = 1000000;
+    int queries = 2000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--names") == 0 && i + 1 < argc) {
+            names = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (names < 0 || queries < 1) {
+        return Usage();
+    }
+
+    // What the viewer indexes: named rooms, then items under type and room
+    std::vector<std::string> real;
+    std::vector<WorldMesh> meshes;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        meshes.push_back(LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str()));
+        for (const RoomMesh &room : meshes.back().rooms) {
+            if (room.roomIndex >= 0) {
+                real.push_back(RoomDisplayName(room.name));
+            }
+        }
+    }
+    const size_t roomNames = real.size();
+    for (const ItemRecord &item : LoadItemsData((data + "/items.data").c_str())) {
+        std::string roomName;
+        for (const RoomMesh &room : meshes[std::min<size_t>(item.worldIndex - 1, meshes.size() - 1)].rooms) {
+            roomName = room.roomIndex == (int)item.roomIndex ? RoomDisplayName(room.name) : roomName;
+        }
+        real.push_back(std::string(ItemTypeName(item.type)) + " " + roomName);
+    }
+
+    std::uint32_t state = 12345;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values[(size_t)(p * (values.size() - 1))];
+    };
+
+    // Queries are names of the index, as written and with a typo. A query
+    // finds its name when a hit among the first 10 has the same text.
+    std::vector<NameHit> hits;
+    auto run = [&](NameSearch &search, const std::vector<std::string> &sources, const char *label) {
+        int exactMisses = 0, typoFound = 0;
+        std::vector<double> us;
+        for (int q = 0; q < queries; q++) {
+            const std::string source = NameSearch::Normalize(sources[random() % sources.size()]);
+            for (int typo = 0; typo < 2; typo++) {
+                const std::string query = typo ? WithTypo(source, random()) : source;
+                const auto start = std::chrono::steady_clock::now();
+                search.Search(query, 10, hits);
+                us.push_back(Microseconds(start));
+                const bool found = std::any_of(hits.begin(), hits.end(), [&](const NameHit &hit) {
+                    return search.Name(hit.entry) == source;
+                });
+                if (typo) {
+                    typoFound += found ? 1 : 0;
+                } else {
+                    exactMisses += !hits.empty() && search.Name(hits[0].entry) == source ? 0 : 1;
+                }
+            }
+        }
+        int underMs = 0;
+        for (double time : us) {
+            underMs += time < 1000.0 ? 1 : 0;
+        }
+        printf("%-14s p50 %7.2f us, p99 %7.2f us, worst %7.2f us, %.1f%% under 1 ms\n", label,
+               percentile(us, 0.5), percentile(us, 0.99), percentile(us, 1.0), 100.0 * underMs / us.size());
+        printf("               %d/%d exact names first, %d/%d with a typo in the first 10\n",
+               queries - exactMisses, queries, typoFound, queries);
+        // Searching as you type needs every query well under a frame
+        const bool slow = percentile(us, 0.99) > 1000.0;
+        if (slow) {
+            printf("               p99 over 1 ms\n");
+        }
+        return exactMisses + (slow ? 1 : 0);
+    };
+
+    NameSearch search;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string &name : real) {
+        search.Add(name);
+    }
+    search.Build();
+    printf("%zu rooms and %zu items, %u distinct names, indexed in %.2f ms, %.1f KB\n", roomNames,
+           real.size() - roomNames, search.NameCount(), Milliseconds(start), search.MemoryBytes() / 1024.0);
+    int failures = run(search, real, "map names");
+
+    if (names > 0) {
+        // Made up words of 3 to 9 letters, mostly alternating consonants and
+        // vowels by their frequency in English, two to four per name
+        const char consonants[] = "ttttnnnsssrrrhhhlllddcmmffwyggppbbvkjxqz";
+        const char vowels[] = "eeeeaaaoooiiiuuy";
+        std::vector<std::string> words(20000);
+        for (std::string &word : words) {
+            const std::uint32_t length = 3 + random() % 7;
+            bool vowel = random() % 3 == 0;
+            for (std::uint32_t i = 0; i < length; i++) {
+                word += vowel ? vowels[random() % (sizeof(vowels) - 1)]
+                              : consonants[random() % (sizeof(consonants) - 1)];
+                vowel = random() % 5 == 0 ? vowel : !vowel;
+            }
+        }
+        std::vector<std::string> generated(names);
+        for (std::string &name : generated) {
+            const std::uint32_t count = 2 + random() % 3;
+            for (std::uint32_t i = 0; i < count; i++) {
+                name += (i ? " " : "") + words[random() % words.size()];
+            }
+        }
+
+        NameSearch large;
+        start = std::chrono::steady_clock::now();
+        for (const std::string &name : generated) {
+            large.Add(name);
+        }
+        for (const std::string &name : real) {
+            large.Add(name);
+        }
+        large.Build();
+        printf("%d generated names and the map names, %u distinct, indexed in %.0f ms, %.1f MB\n", names,
+               large.NameCount(), Milliseconds(start), large.MemoryBytes() / (1024.0 * 1024.0));
+        failures += run(large, generated, "generated");
+        failures += run(large, real, "map names");
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+void WriteBytes(const std::string &path, const void *data, size_t size) {
+    FILE *handle = fopen(path.c_str(), "wb");
+    if (!handle || fwrite(data, 1, size, handle) != size) {
+        if (handle) {
+            fclose(handle);
+        }
+        throw std::runtime_error("Could not write " + path);
+    }
+    fclose(handle);
+}
+
+// Small images covering what the mip generator has to get right: smooth
+// ramps, a one texel checker, transparent texels with a color that must not
+// bleed, odd and one texel wide sizes
+std::vector<std::pair<std::string, DecodedImage>> MipTestImages() {
+    std::vector<std::pair<std::string, DecodedImage>> images;
+    auto add = [&images](const char *name, int width, int height, auto texel) {
+        DecodedImage image{width, height, std::vector<std::uint8_t>((size_t)width * height * 4)};
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                texel(x, y, &image.pixels[((size_t)y * width + x) * 4]);
+            }
+        }
+        images.emplace_back(name, std::move(image));
+    };
+    add("gradient", 64, 64, [](int x, int y, std::uint8_t *t) {
+        t[0] = (std::uint8_t)(x * 4), t[1] = (std::uint8_t)(y * 4);
+        t[2] = (std::uint8_t)((x + y) * 2), t[3] = 255;
+    });
+    add("checker", 16, 16, [](int x, int y, std::uint8_t *t) {
+        t[0] = t[1] = t[2] = (x + y) % 2 ? 255 : 0, t[3] = 255;
+    });
+    add("disc", 37, 23, [](int x, int y, std::uint8_t *t) {
+        const float dx = (x - 18.f) / 15.f, dy = (y - 11.f) / 9.f, d = dx * dx + dy * dy;
+        const bool inside = d < 1.f;
+        // Green garbage under alpha 0
+        t[0] = inside ? 200 : 0, t[1] = inside ? 40 : 255, t[2] = 40;
+        t[3] = inside ? (std::uint8_t)std::min(255.f, (1.f - d) * 1024.f) : 0;
+    });
+    add("uniform", 24, 10, [](int, int, std::uint8_t *t) { t[0] = 90, t[1] = 160, t[2] = 220, t[3] = 128; });
+    add("column", 1, 40, [](int, int y, std::uint8_t *t) {
+        t[0] = (std::uint8_t)(y * 6), t[1] = 0;
+        t[2] = (std::uint8_t)(255 - y * 6), t[3] = (std::uint8_t)(y * 6);
+    });
+    return images;
+}
+
+int MipCheck(int argc, char **argv) {
+    std::string golden = "data/mip_golden.txt";
+    bool update = false;
+    std::vector<std::string> files;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            golden = argv[++i];
+        } else if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    std::vector<std::pair<std::string, DecodedImage>> images = MipTestImages();
+    ThreadPool pool;
+    const std::vector<DecodedImage> decoded = LoadImagesFromFiles(files, 1, pool);
+    for (size_t i = 0; i < files.size(); i++) {
+        images.emplace_back(std::filesystem::path(files[i]).filename().string(), decoded[i]);
+    }
+
+    int failures = 0;
+    auto check = [&failures](bool passed, const std::string &name) {
+        if (!passed) {
+            printf("  %s FAILED\n", name.c_str());
+        }
+        failures += !passed;
+    };
+
+    // "<image> <filter> <space> <level>" to "<width>x<height> <hash>", and
+    // "<image> cache" to "<key> <hash>" for the stored entry
+    std::vector<std::pair<std::string, std::string>> lines;
+    auto hex = [](std::uint64_t value) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", (unsigned long long)value);
+        return std::string(text);
+    };
+
+    const std::filesystem::path cacheDirectory = std::filesystem::temp_directory_path() / "mp-mip-check";
+    std::filesystem::remove_all(cacheDirectory);
+    const AssetCache cache(cacheDirectory.string());
+
+    for (const auto &[name, image] : images) {
+        for (MipFilter filter : {MipFilter::Box, MipFilter::Kaiser}) {
+            for (bool srgb : {true, false}) {
+                MipDesc desc;
+                desc.filter = filter;
+                desc.srgb = srgb;
+                const std::vector<DecodedImage> chain = GenerateMipChain(image, desc);
+                const std::string prefix =
+                    name + (filter == MipFilter::Box ? " box" : " kaiser") + (srgb ? " srgb " : " linear ");
+
+                bool halving = (int)chain.size() == FullMipCount(image.width, image.height) &&
+                               chain[0].pixels == image.pixels;
+                for (size_t level = 0; level < chain.size(); level++) {
+                    const DecodedImage &mip = chain[level];
+                    halving &= mip.width == std::max(1, image.width >> level) &&
+                               mip.height == std::max(1, image.height >> level) &&
+                               mip.pixels.size() == (size_t)mip.width * mip.height * 4;
+                    lines.emplace_back(prefix + std::to_string(level),
+                                       std::to_string(mip.width) + "x" + std::to_string(mip.height) + " " +
+                                           hex(HashBytes(mip.pixels.data(), mip.pixels.size())));
+                }
+                check(halving, prefix + "levels halve down to 1x1 from a copy of the source");
+
+                // Exact for a flat color, and transparent texels never tint
+                // visible ones with a box filter
+                bool clean = true;
+                for (const DecodedImage &mip : chain) {
+                    for (size_t t = 0; t < mip.pixels.size(); t += 4) {
+                        const std::uint8_t *texel = &mip.pixels[t];
+                        if (name == "uniform") {
+                            clean &= memcmp(texel, image.pixels.data(), 4) == 0;
+                        } else if (name == "disc" && filter == MipFilter::Box && texel[3] > 0) {
+                            clean &= std::abs(texel[0] - 200) <= 1 && std::abs(texel[1] - 40) <= 1;
+                        }
+                    }
+                }
+                check(clean, prefix + "no color shift or bleeding");
+            }
+        }
+
+        // Straight alpha, as for distance fields: alpha filters the same as
+        // when premultiplied, colors go on where alpha is 0
+        MipDesc straight;
+        straight.filter = MipFilter::Box;
+        straight.premultiply = false;
+        const std::vector<DecodedImage> premultiplied = GenerateMipChain(image, {MipFilter::Box});
+        const std::vector<DecodedImage> chain = GenerateMipChain(image, straight);
+        bool sameAlpha = chain.size() == premultiplied.size();
+        for (size_t level = 0; level < chain.size() && sameAlpha; level++) {
+            const DecodedImage &mip = chain[level];
+            lines.emplace_back(name + " box straight " + std::to_string(level),
+                               std::to_string(mip.width) + "x" + std::to_string(mip.height) + " " +
+                                   hex(HashBytes(mip.pixels.data(), mip.pixels.size())));
+            for (size_t t = 3; t < mip.pixels.size(); t += 4) {
+                sameAlpha &= mip.pixels[t] == premultiplied[level].pixels[t];
+            }
+        }
+        check(sameAlpha, name + " box straight alpha as when premultiplied");
+
+        // Cache round trip: stored on a miss, the same chain back on a hit
+        // and regenerated over a damaged entry
+        bool hit = true;
+        const std::vector<DecodedImage> stored = CachedMipChain(cache, image, {}, &hit);
+        bool missed = !hit;
+        const std::vector<DecodedImage> loaded = CachedMipChain(cache, image, {}, &hit);
+        auto same = [](const std::vector<DecodedImage> &a, const std::vector<DecodedImage> &b) {
+            bool equal = a.size() == b.size();
+            for (size_t i = 0; equal && i < a.size(); i++) {
+                equal = a[i].width == b[i].width && a[i].height == b[i].height && a[i].pixels == b[i].pixels;
+            }
+            return equal;
+        };
+        const std::vector<DecodedImage> generated = GenerateMipChain(image, {});
+        check(missed && hit && same(stored, generated) && same(loaded, generated),
+              name + " cache round trip");
+        check(same(DeserializeMipChain(SerializeMipChain(generated)), generated),
+              name + " serialized round trip");
+        // Empty and negative level sizes are refused, the cache then misses
+        for (const std::uint8_t size : {0x00, 0xFF}) {
+            std::vector<std::uint8_t> bytes = SerializeMipChain(generated);
+            std::fill_n(bytes.begin() + 8, 8, size);
+            bool refused = false;
+            try {
+                DeserializeMipChain(bytes);
+            } catch (const std::runtime_error &) {
+                refused = true;
+            }
+            check(refused, name + (size ? " negative" : " empty") + " level size refused");
+        }
+
+        std::string entry;
+        for (const auto &file : std::filesystem::directory_iterator(cacheDirectory)) {
+            const std::string path = file.path().string();
+            const std::vector<std::uint8_t> bytes = ReadFile(path.c_str());
+            if (bytes == SerializeMipChain(generated)) {
+                entry = file.path().stem().string() + " " + hex(HashBytes(bytes.data(), bytes.size()));
+                std::vector<std::uint8_t> damaged(bytes.begin(), bytes.begin() + bytes.size() / 2);
+                WriteBytes(path, damaged.data(), damaged.size());
+            }
+        }
+        lines.emplace_back(name + " cache", entry);
+        const std::vector<DecodedImage> repaired = CachedMipChain(cache, image, {}, &hit);
+        check(!entry.empty() && !hit && same(repaired, generated), name + " damaged cache entry regenerated");
+    }
+    std::filesystem::remove_all(cacheDirectory);
+
+    if (update) {
+        std::string text = "# Golden hashes of MP-MapTools mip-check, regenerate with --update once the\n"
+                           "# differences are understood, from the images:";
+        for (const std::string &file : files) {
+            text += " " + file;
+        }
+        text += "\n";
+        for (const auto &[key, value] : lines) {
+            text += key + " " + value + "\n";
+        }
+        WriteBytes(golden, text.data(), text.size());
+        printf("wrote %zu hashes to %s, %d checks failed\n", lines.size(), golden.c_str(), failures);
+        return failures == 0 ? 0 : 1;
+    }
+
+    std::string text;
+    if (!ReadText(golden, text)) {
+        printf("[TOOLS][ERROR] Could not read %s, create it with --update\n", golden.c_str());
+        return 1;
+    }
+    std::map<std::string, std::string> expected;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        end = end == std::string::npos ? text.size() : end;
+        const std::string line = text.substr(start, end - start);
+        start = end + 1;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        // Values are the last two words
+        const size_t split = line.rfind(' ', line.rfind(' ') - 1);
+        expected[line.substr(0, split)] = line.substr(split + 1);
+    }
+    int differ = 0, missing = 0;
+    for (const auto &[key, value] : lines) {
+        auto it = expected.find(key);
+        if (it == expected.end()) {
+            missing++;
+        } else if (it->second != value) {
+            if (differ++ < 10) {
+                printf("  %s: %s, golden %s\n", key.c_str(), value.c_str(), it->second.c_str());
+            }
+        }
+    }
+    printf("%zu images, %zu hashes: %d differ from %s, %d missing from it, %d checks failed\n", images.size(),
+           lines.size(), differ, golden.c_str(), missing, failures);
+    return failures == 0 && differ == 0 && missing == 0 ? 0 : 1;
+}
+
+int SeedStatsCommand(int argc, char **argv) {
+    int logs = 10000;
+    int threads = 0;
+    std::string dir = "cache/layouts";
+    std::string data = "data";
+    std::string logicPath;
+    bool generatedLogic = false;
+    std::string out = "cache/seed_stats";
+    bool scaling = false;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--logs") == 0 && i + 1 < argc) {
+            logs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--logic") == 0 && i + 1 < argc) {
+            logicPath = argv[++i];
+        } else if (strcmp(argv[i], "--generated-logic") == 0) {
+            generatedLogic = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else {
+            return Usage();
+        }
+    }
+    if (logs < 1 || threads < 0 || (generatedLogic && !logicPath.empty())) {
+        return Usage();
+    }
+
+    const std::vector<ItemRecord> records = LoadItemsData((data + "/items.data").c_str());
+    LayoutImporter importer(records);
+    std::vector<LayoutRoom> rooms;
+    RoomGraph graph;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        importer.AddWorld(world + 1, mesh);
+        AddLayoutRooms(world + 1, mesh, records, rooms);
+        graph.AddWorld(world + 1, mesh, ExtractPortals(mesh));
+    }
+    graph.LoadOverrides((data + "/room_links.txt").c_str());
+
+    Reachability logic;
+    logic.Build(graph, records);
+    if (generatedLogic) {
+        // Over the pickups layouts hold, so the spheres run deep
+        std::vector<std::string> upgrades;
+        for (const char *artifact : LayoutArtifacts) {
+            upgrades.push_back(std::string("Artifact of ") + artifact);
+        }
+        upgrades.insert(upgrades.end(), std::begin(LayoutUpgrades), std::end(LayoutUpgrades));
+        logic.ApplyLogic(GenerateLogic(graph, records, upgrades, 1));
+    } else {
+        logicPath = logicPath.empty() ? data + "/logic.txt" : logicPath;
+        if (!std::filesystem::exists(logicPath)) {
+            throw std::runtime_error("No logic at " + logicPath);
+        }
+        logic.LoadLogic(logicPath.c_str());
+    }
+
+    // All in memory first, so only the analysis is timed
+    std::vector<LayoutExpected> expected;
+    int written = 0;
+    const std::vector<std::string> paths = LayoutPaths(dir, logs, records, rooms, expected, written);
+    std::vector<std::string> layouts(logs);
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < logs; i++) {
+        if (!ReadText(paths[i], layouts[i])) {
+            throw std::runtime_error("Can't read " + paths[i]);
+        }
+        bytes += layouts[i].size();
+    }
+    printf("%d layouts in %s (%d written), %.1f MB read in %.2f ms\n", logs, dir.c_str(), written,
+           bytes / (1024.0 * 1024.0), Milliseconds(start));
+    printf("%zu locations, %u item kinds in the logic, %u/%u items reachable with nothing\n", records.size(),
+           logic.KindCount(), logic.ReachableLocations(), logic.LocationCount());
+
+    // Every thread fills its own statistics, added up at the end
+    auto analyze = [&](std::uint32_t threadCount, double &ms) {
+        ThreadPool pool(threadCount);
+        std::vector<SeedAnalyzer> analyzers(pool.ThreadCount(), SeedAnalyzer(importer, logic));
+        std::vector<SeedStats> partial(pool.ThreadCount(), SeedStats((std::uint32_t)records.size()));
+        std::vector<std::string> scratch(pool.ThreadCount());
+        const auto start = std::chrono::steady_clock::now();
+        pool.ParallelFor((std::uint32_t)logs, [&](std::uint32_t i, std::uint32_t slot) {
+            scratch[slot] = layouts[i];
+            analyzers[slot].Analyze(scratch[slot], partial[slot]);
+        });
+        SeedStats stats((std::uint32_t)records.size());
+        for (const SeedStats &part : partial) {
+            stats.Add(part);
+        }
+        ms = Milliseconds(start);
+        return std::make_pair(stats, pool.ThreadCount());
+    };
+
+    double ms = 0.0;
+    auto [stats, used] = analyze(threads, ms);
+    int differ = 0;
+    if (scaling) {
+        const std::uint32_t most = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        double serialMs = 0.0;
+        for (std::uint32_t count = 1;; count = std::min(count * 2, most)) {
+            double countMs = 0.0;
+            const auto [result, threadCount] = analyze(count, countMs);
+            serialMs = count == 1 ? countMs : serialMs;
+            differ += result == stats ? 0 : 1;
+            printf("%3u threads    %8.2f ms, %8.0f seeds/s, %5.2fx, %5.1f%% efficiency%s\n", threadCount,
+                   countMs, logs * 1000.0 / countMs, serialMs / countMs,
+                   100.0 * serialMs / countMs / threadCount, result == stats ? "" : ", differs");
+            if (count == most) {
+                break;
+            }
+        }
+    } else {
+        printf("%u threads      %8.2f ms, %8.0f seeds/s\n", used, ms, logs * 1000.0 / ms);
+    }
+
+    std::uint64_t depthSum = 0;
+    std::string depths;
+    for (std::uint32_t depth = 0; depth <= SeedStats::SphereBuckets; depth++) {
+        depthSum += (std::uint64_t)depth * stats.depths[depth];
+        if (stats.depths[depth]) {
+            depths += " " + std::to_string(depth) + (depth == SeedStats::SphereBuckets ? "+" : "") + ":" +
+                      std::to_string(stats.depths[depth]);
+        }
+    }
+    std::uint32_t neverReached = 0;
+    for (std::uint32_t id = 0; id < stats.LocationCount(); id++) {
+        neverReached += stats.AverageSphere(id) < 0.f ? 1 : 0;
+    }
+    printf("depth          %.2f spheres on average,%s\n", (double)depthSum / stats.seeds, depths.c_str());
+    printf("%u of %u locations never reached in any layout\n", neverReached, stats.LocationCount());
+
+    const std::filesystem::path parent = std::filesystem::path(out).parent_path();
+    if (!parent.empty()) {
+        std::filesystem::create_directories(parent);
+    }
+    const std::vector<std::uint8_t> encoded = stats.Encode();
+    const std::string locations = stats.LocationsCsv(records);
+    const std::string roomsCsv = stats.RoomsCsv(records);
+    WriteBytes(out + ".bin", encoded.data(), encoded.size());
+    WriteBytes(out + "_locations.csv", locations.data(), locations.size());
+    WriteBytes(out + "_rooms.csv", roomsCsv.data(), roomsCsv.size());
+    printf("wrote %s.bin, %s_locations.csv and %s_rooms.csv\n", out.c_str(), out.c_str(), out.c_str());
+    return differ == 0 ? 0 : 1;
+}
+
+// Random points in the bounds of a world, and next to its vertices where
+// markers sit
+void BenchPoints(const WorldMesh &mesh, std::uint32_t count, float spread, std::uint32_t &state,
+                 std::vector<std::array<float, 3>> &inBounds,
+                 std::vector<std::array<float, 3>> &nearSurface) {
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / 16777216.f;
+    };
+    float boundsMin[3] = {1e30f, 1e30f, 1e30f}, boundsMax[3] = {-1e30f, -1e30f, -1e30f};
+    for (const RoomMesh &room : mesh.rooms) {
+        for (int k = 0; k < 3; k++) {
+            boundsMin[k] = std::min(boundsMin[k], room.boundsMin[k]);
+            boundsMax[k] = std::max(boundsMax[k], room.boundsMax[k]);
+        }
+    }
+    for (std::uint32_t i = 0; i < count && !mesh.vertices.empty(); i++) {
+        std::array<float, 3> point, near;
+        const float *vertex = mesh.vertices[(size_t)(random() * mesh.vertices.size())].position;
+        for (int k = 0; k < 3; k++) {
+            point[k] = boundsMin[k] + random() * (boundsMax[k] - boundsMin[k]);
+            near[k] = vertex[k] + (random() * 2.f - 1.f) * spread;
+        }
+        inBounds.push_back(point);
+        nearSurface.push_back(near);
+    }
+}
+
+int SnapItems(int argc, char **argv) {
+    std::string data = "data";
+    float threshold = 5.f;
+    int threads = 0;
+    std::string out;
+    int queries = 1000000;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (threshold <= 0.f || threads < 0 || queries < 0) {
+        return Usage();
+    }
+
+    std::vector<WorldMesh> meshes(WorldNames.size());
+    std::vector<MeshBvh> bvhs(WorldNames.size());
+    double buildMs = 0.0;
+    size_t bvhBytes = 0;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        meshes[world] = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        const auto start = std::chrono::steady_clock::now();
+        bvhs[world].Build(meshes[world]);
+        buildMs += Milliseconds(start);
+        bvhBytes += bvhs[world].MemoryBytes();
+        printf("%-12s %6u triangles, %6u nodes, depth %2u\n", WorldNames[world], bvhs[world].TriangleCount(),
+               bvhs[world].NodeCount(), bvhs[world].Depth());
+    }
+    printf("built in %.2f ms, %.1f KB\n", buildMs, bvhBytes / 1024.0);
+
+    // Items are stored with y and z swapped compared to the world meshes
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+    auto worldOf = [&](const ItemRecord &item) { return item.worldIndex - 1; };
+    std::vector<SurfaceHit> hits(items.size());
+    std::vector<std::uint8_t> found(items.size(), 0);
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    pool.ParallelFor((std::uint32_t)items.size(), [&](std::uint32_t i) {
+        const ItemRecord &item = items[i];
+        const float position[3] = {item.x, item.z, item.y};
+        found[i] = worldOf(item) < bvhs.size() && bvhs[worldOf(item)].Closest(position, 1e30f, hits[i]);
+    });
+    printf("%zu items snapped in %.3f ms on %u threads\n", items.size(), Milliseconds(start),
+           pool.ThreadCount());
+
+    int mismatches = 0;
+    std::vector<std::uint32_t> far;
+    std::vector<float> distances;
+    for (std::uint32_t i = 0; i < items.size(); i++) {
+        const ItemRecord &item = items[i];
+        if (!found[i]) {
+            printf("  %u:%02u %-17s has no world geometry\n", item.worldIndex, item.roomIndex,
+                   ItemTypeName(item.type));
+            mismatches++;
+            continue;
+        }
+        const float position[3] = {item.x, item.z, item.y};
+        SurfaceHit check;
+        bvhs[worldOf(item)].ClosestBruteForce(position, 1e30f, check);
+        mismatches += std::abs(check.distance - hits[i].distance) > 1e-4f ? 1 : 0;
+        distances.push_back(hits[i].distance);
+        if (hits[i].distance > threshold) {
+            far.push_back(i);
+        }
+    }
+    std::sort(distances.begin(), distances.end());
+    if (!distances.empty()) {
+        printf("distance to the nearest surface: median %.2f, 90%% %.2f, worst %.2f\n",
+               distances[distances.size() / 2], distances[distances.size() * 9 / 10], distances.back());
+    }
+    std::sort(far.begin(), far.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return hits[a].distance > hits[b].distance;
+    });
+    printf("%zu items further than %.2f:\n", far.size(), threshold);
+    for (std::uint32_t i : far) {
+        const ItemRecord &item = items[i];
+        const RoomMesh &room = meshes[worldOf(item)].rooms[hits[i].room];
+        printf("  %u:%02u %-17s at %9.3f, %9.3f, %9.3f is %6.2f from %s%s\n", item.worldIndex, item.roomIndex,
+               ItemTypeName(item.type), item.x, item.y, item.z, hits[i].distance,
+               RoomDisplayName(room.name).c_str(),
+               room.roomIndex == (int)item.roomIndex ? "" : ", another room");
+    }
+
+    if (!out.empty()) {
+        // Far items are pulled towards their surface until they are just under
+        // threshold away, on the side they were, so a second run passes them.
+        // Other lines are copied as they are.
+        std::string text;
+        if (!ReadText(data + "/items.data", text)) {
+            throw std::runtime_error("Can't read " + data + "/items.data");
+        }
+        std::string written;
+        size_t line = 0;
+        std::uint32_t index = 0;
+        while (line < text.size()) {
+            size_t end = text.find('\n', line);
+            end = end == std::string::npos ? text.size() : end;
+            const std::string_view original = std::string_view(text).substr(line, end - line);
+            line = end + 1;
+            if (original.empty() || original[0] == '\r') {
+                continue;
+            }
+            const std::uint32_t i = index++;
+            if (i >= items.size() || std::find(far.begin(), far.end(), i) == far.end()) {
+                written += original;
+                written += "\n";
+                continue;
+            }
+            const ItemRecord &item = items[i];
+            const float position[3] = {item.x, item.z, item.y};
+            const float keep = threshold * 0.999f / hits[i].distance;
+            float moved[3];
+            for (int k = 0; k < 3; k++) {
+                moved[k] = hits[i].position[k] + (position[k] - hits[i].position[k]) * keep;
+            }
+            char record[96];
+            snprintf(record, sizeof(record), "%u:%u:%02u:%.9g, %.9g, %.9g\n", item.type, item.worldIndex,
+                     item.roomIndex, moved[0], moved[2], moved[1]);
+            written += record;
+        }
+        WriteBytes(out, written.data(), written.size());
+        printf("wrote %s with %zu items moved\n", out.c_str(), far.size());
+    }
+
+    if (queries > 0) {
+        std::uint32_t state = 12345;
+        std::vector<std::array<float, 3>> inBounds, nearSurface;
+        std::vector<std::uint32_t> pointWorld;
+        for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+            const std::uint32_t count = (std::uint32_t)(queries * (world + 1) / WorldNames.size() -
+                                                        queries * world / WorldNames.size());
+            BenchPoints(meshes[world], count, 2.f * threshold, state, inBounds, nearSurface);
+            pointWorld.resize(inBounds.size(), world);
+        }
+
+        for (const auto &[label, points] : {std::make_pair("in bounds", &inBounds),
+                                            std::make_pair("near surface", &nearSurface)}) {
+            // A sample against every triangle first
+            for (size_t i = 0; i < points->size(); i += std::max<size_t>(1, points->size() / 200)) {
+                SurfaceHit hit, check;
+                bvhs[pointWorld[i]].Closest((*points)[i].data(), 1e30f, hit);
+                bvhs[pointWorld[i]].ClosestBruteForce((*points)[i].data(), 1e30f, check);
+                mismatches += std::abs(check.distance - hit.distance) > 1e-4f ? 1 : 0;
+            }
+
+            float sum = 0.f;
+            start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < points->size(); i++) {
+                SurfaceHit hit;
+                bvhs[pointWorld[i]].Closest((*points)[i].data(), 1e30f, hit);
+                sum += hit.distance;
+            }
+            const double serialMs = Milliseconds(start);
+
+            std::vector<float> sums(pool.ThreadCount(), 0.f);
+            const std::uint32_t batches = (std::uint32_t)((points->size() + 1023) / 1024);
+            start = std::chrono::steady_clock::now();
+            pool.ParallelFor(batches, [&](std::uint32_t batch, std::uint32_t slot) {
+                const size_t end = std::min<size_t>(points->size(), (size_t)(batch + 1) * 1024);
+                for (size_t i = (size_t)batch * 1024; i < end; i++) {
+                    SurfaceHit hit;
+                    bvhs[pointWorld[i]].Closest((*points)[i].data(), 1e30f, hit);
+                    sums[slot] += hit.distance;
+                }
+            });
+            const double poolMs = Milliseconds(start);
+            printf("%-13s %zu queries, %10.0f/s on one thread, %10.0f/s on %u (mean distance %.2f)\n", label,
+                   points->size(), points->size() * 1000.0 / serialMs, points->size() * 1000.0 / poolMs,
+                   pool.ThreadCount(), sum / std::max<size_t>(1, points->size()));
+        }
+    }
+    if (mismatches) {
+        printf("%d queries differ from the brute force search\n", mismatches);
+    }
+    return mismatches == 0 ? 0 : 1;
+}
+
+int NavBench(int argc, char **argv) {
+    std::string data = "data";
+    int threads = 0;
+    int queries = 20000;
+    NavMeshConfig config;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cell") == 0 && i + 1 < argc) {
+            config.cellSize = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--climb") == 0 && i + 1 < argc) {
+            config.agentClimb = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-link") == 0 && i + 1 < argc) {
+            config.maxRoomLink = (float)atof(argv[++i]);
+        } else {
+            return Usage();
+        }
+    }
+    if (threads < 0 || queries < 0 || config.cellSize <= 0.f || config.agentClimb < 0.f ||
+        config.maxRoomLink < 0.f) {
+        return Usage();
+    }
+
+    ThreadPool pool(threads);
+    std::vector<NavMesh> meshes(WorldNames.size());
+    double serialTotal = 0.0, poolTotal = 0.0;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        const WorldMesh mesh = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+        const std::vector<Portal> doors = ExtractPortals(mesh);
+        auto start = std::chrono::steady_clock::now();
+        meshes[world].Build(mesh, doors, config);
+        const double serialMs = Milliseconds(start);
+        start = std::chrono::steady_clock::now();
+        meshes[world].Build(mesh, doors, config, &pool);
+        const double poolMs = Milliseconds(start);
+        serialTotal += serialMs;
+        poolTotal += poolMs;
+
+        const NavMeshStats &stats = meshes[world].Stats();
+        printf("%-12s %8.2f ms, %8.2f ms on %u threads, %3u/%4u tiles, %5u polygons, %5u links (%u across "
+               "tiles, %u ledges, %u room pairs), %u doors floored, %6.1f KB%s\n",
+               WorldNames[world], serialMs, poolMs, pool.ThreadCount(), stats.usedTiles, stats.tiles,
+               stats.polygons, stats.links, stats.tileLinks, stats.ledgeLinks, stats.roomLinks,
+               stats.doorBridges, meshes[world].MemoryBytes() / 1024.0,
+               stats.failedOutlines ? " (outlines failed)" : "");
+    }
+    printf("all worlds   %8.2f ms, %8.2f ms on %u threads\n", serialTotal, poolTotal, pool.ThreadCount());
+
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[(size_t)(p * (values.size() - 1))];
+    };
+    auto distance = [](const float *a, const float *b) {
+        const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    };
+    // A path starts and ends where its ends were moved onto the mesh and is
+    // no shorter than the straight line between them
+    int broken = 0;
+    auto check = [&](const NavMesh &mesh, const float *start, const float *end, const float *extents,
+                     const NavPath &path) {
+        float from[3], to[3];
+        mesh.FindNearestPolygon(start, extents, from);
+        mesh.FindNearestPolygon(end, extents, to);
+        const bool ok = !path.points.empty() && distance(path.points.front().data(), from) < 1e-3f &&
+                        distance(path.points.back().data(), to) < 1e-3f &&
+                        path.length >= distance(from, to) - 1e-3f;
+        broken += ok ? 0 : 1;
+    };
+
+    // Items are stored with y and z swapped compared to the world meshes,
+    // and float over the floor they are on
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+    const float itemExtents[3] = {4.f, 8.f, 4.f};
+    std::vector<double> itemUs;
+    std::uint32_t onMesh = 0, pairs = 0, found = 0, linked = 0;
+    double ratioSum = 0.0, walked = 0.0, crossed = 0.0;
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        NavQuery query(meshes[world]);
+        NavPath path;
+        for (const ItemRecord &from : items) {
+            if (from.worldIndex != world + 1) {
+                continue;
+            }
+            const float start[3] = {from.x, from.z, from.y};
+            float nearest[3];
+            onMesh += meshes[world].FindPolygon(start, itemExtents, nearest) != NavMesh::NoPolygon ? 1 : 0;
+            for (const ItemRecord &to : items) {
+                if (to.worldIndex != world + 1 || &to == &from) {
+                    continue;
+                }
+                const float end[3] = {to.x, to.z, to.y};
+                const auto begin = std::chrono::steady_clock::now();
+                const bool ok = query.FindPath(start, end, itemExtents, path);
+                itemUs.push_back(Microseconds(begin));
+                pairs++;
+                if (ok) {
+                    found++;
+                    const float straight = distance(path.points.front().data(), path.points.back().data());
+                    ratioSum += path.length / std::max(straight, 1e-3f);
+                    walked += path.length - path.linkLength;
+                    crossed += path.linkLength;
+                    linked += path.linkLength > 0.f ? 1 : 0;
+                    check(meshes[world], start, end, itemExtents, path);
+                }
+            }
+        }
+    }
+    printf("items        %u of %zu on a mesh, the rest moved onto it, %u of %u pairs in the same world "
+           "have a path, %.2fx as long as a straight line\n",
+           onMesh, items.size(), found, pairs, found ? ratioSum / found : 0.0);
+    // Room links stand in for floor the mesh doesn't have, what is crossed
+    // on them isn't walked
+    printf("             %u of the paths take room links, %.0f walked and %.0f across room links (%.1f%%)\n",
+           linked, walked, crossed, walked + crossed > 0.0 ? crossed * 100.0 / (walked + crossed) : 0.0);
+    printf("item paths   p50 %7.2f us, p99 %7.2f us, worst %7.2f us\n", percentile(itemUs, 0.5),
+           percentile(itemUs, 0.99), percentile(itemUs, 1.0));
+
+    // Random polygon centers of a world, worlds weighted by polygon count
+    std::uint32_t totalPolygons = 0;
+    for (const NavMesh &mesh : meshes) {
+        totalPolygons += (std::uint32_t)mesh.Polygons().size();
+    }
+    std::vector<double> randomUs;
+    std::uint32_t randomFound = 0;
+    std::uint64_t visited = 0;
+    double randomRatio = 0.0;
+    std::uint32_t state = 4242;
+    auto random = [&state] {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    const float polygonExtents[3] = {0.5f, 1.f, 0.5f};
+    for (std::uint32_t world = 0; world < WorldNames.size() && totalPolygons > 0; world++) {
+        const std::vector<NavMesh::Polygon> &polygons = meshes[world].Polygons();
+        const std::uint32_t count = (std::uint32_t)((std::uint64_t)queries * polygons.size() / totalPolygons);
+        NavQuery query(meshes[world]);
+        NavPath path;
+        for (std::uint32_t i = 0; i < count; i++) {
+            const float *start = polygons[random() % polygons.size()].center;
+            const float *end = polygons[random() % polygons.size()].center;
+            const auto begin = std::chrono::steady_clock::now();
+            const bool ok = query.FindPath(start, end, polygonExtents, path);
+            randomUs.push_back(Microseconds(begin));
+            visited += query.NodesVisited();
+            if (ok) {
+                randomFound++;
+                randomRatio += path.length / std::max(distance(start, end), 1e-3f);
+                check(meshes[world], start, end, polygonExtents, path);
+            }
+        }
+    }
+    printf("random paths %zu, %u found, %.2fx as long as a straight line, %.1f polygons visited on average\n",
+           randomUs.size(), randomFound, randomFound ? randomRatio / randomFound : 0.0,
+           randomUs.empty() ? 0.0 : (double)visited / randomUs.size());
+    printf("             p50 %7.2f us, p99 %7.2f us, worst %7.2f us\n", percentile(randomUs, 0.5),
+           percentile(randomUs, 0.99), percentile(randomUs, 1.0));
+    if (broken) {
+        printf("%d paths don't join their ends or are shorter than a straight line\n", broken);
+    }
+    return broken == 0 ? 0 : 1;
+}
+
+int VoxelBench(int argc, char **argv) {
+    std::string data = "data";
+    int threads = 0;
+    int queries = 100000;
+    std::vector<float> sizes = {4.f, 2.f, 1.f, 0.5f};
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (const char *next = argv[++i]; *next;) {
+                char *end;
+                sizes.push_back(strtof(next, &end));
+                next = *end == ',' ? end + 1 : end;
+                if (end == next && *end) {
+                    return Usage();
+                }
+            }
+        } else {
+            return Usage();
+        }
+    }
+    if (threads < 0 || queries < 0 || sizes.empty() ||
+        std::any_of(sizes.begin(), sizes.end(), [](float size) { return !(size > 0.f); })) {
+        return Usage();
+    }
+
+    std::vector<WorldMesh> meshes(WorldNames.size());
+    for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+        meshes[world] = LoadWorldObj((data + "/" + WorldNames[world] + ".obj").c_str());
+    }
+    // Items are stored with y and z swapped compared to the world meshes
+    const std::vector<ItemRecord> items = LoadItemsData((data + "/items.data").c_str());
+
+    // First triangle along a ray, both sides, Moller and Trumbore
+    auto triangleHit = [](const WorldMesh &mesh, const float *origin, const float *direction,
+                          float maxDistance) {
+        float best = maxDistance;
+        bool found = false;
+        for (const RoomMesh &room : mesh.rooms) {
+            for (std::uint32_t i = 0; i + 2 < room.indexCount; i += 3) {
+                const float *p[3];
+                for (int k = 0; k < 3; k++) {
+                    p[k] = mesh.vertices[room.firstVertex + mesh.indices[room.firstIndex + i + k]].position;
+                }
+                const float e1[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+                const float e2[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+                const float q[3] = {direction[1] * e2[2] - direction[2] * e2[1],
+                                    direction[2] * e2[0] - direction[0] * e2[2],
+                                    direction[0] * e2[1] - direction[1] * e2[0]};
+                const float det = e1[0] * q[0] + e1[1] * q[1] + e1[2] * q[2];
+                if (std::abs(det) < 1e-12f) {
+                    continue;
+                }
+                const float s[3] = {origin[0] - p[0][0], origin[1] - p[0][1], origin[2] - p[0][2]};
+                const float u = (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]) / det;
+                const float r[3] = {s[1] * e1[2] - s[2] * e1[1], s[2] * e1[0] - s[0] * e1[2],
+                                    s[0] * e1[1] - s[1] * e1[0]};
+                const float v = (direction[0] * r[0] + direction[1] * r[1] + direction[2] * r[2]) / det;
+                const float t = (e2[0] * r[0] + e2[1] * r[1] + e2[2] * r[2]) / det;
+                if (u >= 0.f && v >= 0.f && u + v <= 1.f && t >= 0.f && t <= best) {
+                    best = t;
+                    found = true;
+                }
+            }
+        }
+        return found ? best : -1.f;
+    };
+    auto percentile = [](std::vector<double> values, double p) {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[(size_t)(p * (values.size() - 1))];
+    };
+
+    ThreadPool pool(threads);
+    const float rayLength = 256.f;
+    const std::uint32_t checkedRays = 200;
+    int failures = 0;
+    for (float size : sizes) {
+        printf("voxel size %.2f\n", size);
+        std::vector<VoxelMap> maps(WorldNames.size());
+        double serialTotal = 0.0, poolTotal = 0.0;
+        size_t bytes = 0;
+        for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+            auto start = std::chrono::steady_clock::now();
+            maps[world].Build(meshes[world], size);
+            const double serialMs = Milliseconds(start);
+            start = std::chrono::steady_clock::now();
+            maps[world].Build(meshes[world], size, &pool);
+            const double poolMs = Milliseconds(start);
+            serialTotal += serialMs;
+            poolTotal += poolMs;
+            bytes += maps[world].MemoryBytes();
+
+            const VoxelMapStats &stats = maps[world].Stats();
+            printf("  %-12s %8.2f ms, %8.2f ms on %u threads, %4u nodes, %6u bricks, %8llu solid voxels, "
+                   "%2u/%2zu rooms with an inside, %8.1f KB\n",
+                   WorldNames[world], serialMs, poolMs, pool.ThreadCount(), stats.nodes, stats.bricks,
+                   (unsigned long long)stats.solidVoxels, stats.filledRooms, meshes[world].rooms.size(),
+                   maps[world].MemoryBytes() / 1024.0);
+        }
+        printf("  all worlds   %8.2f ms, %8.2f ms on %u threads, %.1f KB\n", serialTotal, poolTotal,
+               pool.ThreadCount(), bytes / 1024.0);
+
+        // The same random points and rays at every size, worlds weighted by
+        // the volume of their bounds
+        std::uint32_t state = 4242;
+        auto random = [&state] {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) / 16777216.f;
+        };
+        double volume = 0.0;
+        for (const VoxelMap &map : maps) {
+            const float *low = map.BoundsMin(), *high = map.BoundsMax();
+            volume += (double)(high[0] - low[0]) * (high[1] - low[1]) * (high[2] - low[2]);
+        }
+        std::uint64_t solid = 0, inRoom = 0, points = 0;
+        double solidUs = 0.0, roomUs = 0.0;
+        std::vector<double> rayUs;
+        double voxelsUs = 0.0;
+        std::uint32_t hits = 0, mismatches = 0, checked = 0, missed = 0;
+        for (std::uint32_t world = 0; world < WorldNames.size(); world++) {
+            const VoxelMap &map = maps[world];
+            const float *low = map.BoundsMin(), *high = map.BoundsMax();
+            const double share =
+                (double)(high[0] - low[0]) * (high[1] - low[1]) * (high[2] - low[2]) / volume;
+            const std::uint32_t count = (std::uint32_t)(queries * share);
+            std::vector<std::array<float, 3>> positions(count);
+            for (std::array<float, 3> &position : positions) {
+                for (int k = 0; k < 3; k++) {
+                    position[k] = low[k] + (high[k] - low[k]) * random();
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            for (const std::array<float, 3> &position : positions) {
+                solid += map.Solid(position.data()) ? 1 : 0;
+            }
+            solidUs += Microseconds(start);
+            start = std::chrono::steady_clock::now();
+            for (const std::array<float, 3> &position : positions) {
+                inRoom += map.RoomAt(position.data()) != VoxelMap::NoRoom ? 1 : 0;
+            }
+            roomUs += Microseconds(start);
+            points += count;
+
+            for (std::uint32_t i = 0; i < count; i++) {
+                float direction[3], length = 0.f;
+                do {
+                    for (int k = 0; k < 3; k++) {
+                        direction[k] = random() * 2.f - 1.f;
+                    }
+                    length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                                       direction[2] * direction[2]);
+                } while (length > 1.f || length < 1e-3f);
+                for (int k = 0; k < 3; k++) {
+                    direction[k] /= length;
+                }
+                const float *origin = positions[i].data();
+
+                VoxelHit hit, check;
+                start = std::chrono::steady_clock::now();
+                const bool found = map.Raycast(origin, direction, rayLength, hit);
+                rayUs.push_back(Microseconds(start));
+                start = std::chrono::steady_clock::now();
+                const bool foundVoxels = map.RaycastVoxels(origin, direction, rayLength, check);
+                voxelsUs += Microseconds(start);
+                hits += found ? 1 : 0;
+                // Distances drift apart over long walks, the voxel hit doesn't
+                const bool same = found == foundVoxels && (!found || (hit.voxel[0] == check.voxel[0] &&
+                                                                      hit.voxel[1] == check.voxel[1] &&
+                                                                      hit.voxel[2] == check.voxel[2]));
+                mismatches += same ? 0 : 1;
+
+                // Voxels cover every triangle they touch, so the ray meets
+                // one no later than the triangle
+                if (i < checkedRays) {
+                    const float triangle = triangleHit(meshes[world], origin, direction, rayLength);
+                    checked++;
+                    if (triangle >= 0.f && (!found || hit.distance > triangle + 1e-3f * size)) {
+                        missed++;
+                    }
+                }
+            }
+        }
+        printf("  points       %.1f%% solid, %.1f%% in a room, %.1f ns per point, %.1f ns per room lookup\n",
+               points ? 100.0 * solid / points : 0.0, points ? 100.0 * inRoom / points : 0.0,
+               points ? solidUs * 1000.0 / points : 0.0, points ? roomUs * 1000.0 / points : 0.0);
+        printf("  rays         %zu of length %.0f, %u hit, p50 %.2f us, p99 %.2f us, worst %.2f us, "
+               "%.2f us voxel by voxel\n",
+               rayUs.size(), rayLength, hits, percentile(rayUs, 0.5), percentile(rayUs, 0.99),
+               percentile(rayUs, 1.0), rayUs.empty() ? 0.0 : voxelsUs / rayUs.size());
+
+        std::uint32_t own = 0, other = 0, outside = 0;
+        for (const ItemRecord &item : items) {
+            if (item.worldIndex < 1 || item.worldIndex > WorldNames.size()) {
+                continue;
+            }
+            const float position[3] = {item.x, item.z, item.y};
+            const std::uint32_t room = maps[item.worldIndex - 1].RoomAt(position);
+            if (room == VoxelMap::NoRoom) {
+                outside++;
+            } else if (meshes[item.worldIndex - 1].rooms[room].roomIndex == (int)item.roomIndex) {
+                own++;
+            } else {
+                other++;
+            }
+        }
+        printf("  items        %u in their room, %u in another, %u outside of every room\n", own, other,
+               outside);
+        if (mismatches || missed) {
+            printf("  %u rays disagree with the walk voxel by voxel, "
+                   "%u of %u pass a triangle before a voxel\n",
+                   mismatches, missed, checked);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+#ifdef __linux__
+HttpServer *RunningServer = nullptr;
+
+void StopServer(int) {
+    if (RunningServer) {
+        RunningServer->Stop();
+    }
+}
+
+std::string HexKey(std::uint64_t key) {
+    char text[17];
+    snprintf(text, sizeof(text), "%016llx", (unsigned long long)key);
+    return text;
+}
+
+// Converted map files and the web client, returns the bytes served without
+// compression
+std::uint64_t AddServedFiles(HttpServer &server, const std::vector<MapFile> &files, const std::string &web) {
+    std::uint64_t bytes = 0;
+    for (const MapFile &file : files) {
+        server.Add(file.path, {"application/octet-stream", file.file, file.gzipFile, HexKey(file.key)});
+        bytes += std::filesystem::file_size(file.file);
+    }
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(web, error)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        const std::string path = entry.path().string();
+        const std::string extension = entry.path().extension().string();
+        const std::vector<std::uint8_t> content = ReadFile(path.c_str());
+        const char *type = extension == ".html" ? "text/html; charset=utf-8"
+                           : extension == ".js" ? "text/javascript; charset=utf-8"
+                                                : "application/octet-stream";
+        const HttpFile served{type, path, {}, HexKey(HashBytes(content.data(), content.size()))};
+        server.Add("/" + entry.path().filename().string(), served);
+        if (entry.path().filename() == "index.html") {
+            server.Add("/", served);
+        }
+    }
+    return bytes;
+}
+
+void PrintServerStats(const HttpServerStats &stats) {
+    printf("server         %llu connections, %llu requests, %llu not modified, %llu gzipped, %llu errors\n",
+           (unsigned long long)stats.connections, (unsigned long long)stats.requests,
+           (unsigned long long)stats.notModified, (unsigned long long)stats.gzipped,
+           (unsigned long long)stats.errors);
+}
+
+// Loopback tests hold a client and a server socket per connection
+void RaiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// The race tracker on /tracker: toggles from clients apply at once and go
+// out as one delta per frame
+void AddTracker(HttpServer &server, TrackerState &tracker, double frameSeconds) {
+    server.AddWebSocket("/tracker", {[&tracker] { return tracker.Snapshot(); },
+                                     [&tracker](const std::vector<std::uint8_t> &message) {
+                                         tracker.ApplyToggles(message.data(), message.size());
+                                     }});
+    server.SetTick(frameSeconds, [&server, &tracker] {
+        const std::vector<std::uint8_t> delta = tracker.TakeDelta();
+        if (!delta.empty()) {
+            server.Broadcast("/tracker", delta);
+        }
+    });
+}
+
+int Serve(int argc, char **argv) {
+    std::string address = "0.0.0.0", data = "data", web = "webtest";
+    int port = 8080;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bind") == 0 && i + 1 < argc) {
+            address = argv[++i];
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else if (strcmp(argv[i], "--web") == 0 && i + 1 < argc) {
+            web = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+    if (port < 0 || port > 65535) {
+        return Usage();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<MapFile> files = PrepareMapFiles(data, AssetCache("cache"));
+    HttpServer server;
+    const std::uint64_t bytes = AddServedFiles(server, files, web);
+    TrackerState tracker(LoadItemsData((data + "/items.data").c_str()));
+    AddTracker(server, tracker, 1.0 / 60.0);
+    printf("%zu map files, %.2f MB, ready in %.1f ms\n", files.size(), bytes / 1e6, Milliseconds(start));
+
+    port = server.Listen(address, (std::uint16_t)port);
+    printf("Serving on http://%s:%d/, tracker on ws://%s:%d/tracker, Ctrl+C stops\n", address.c_str(), port,
+           address.c_str(), port);
+    fflush(stdout);
+    RunningServer = &server;
+    signal(SIGINT, StopServer);
+    signal(SIGTERM, StopServer);
+    server.Run();
+    RunningServer = nullptr;
+    PrintServerStats(server.Stats());
+    return 0;
+}
+
+// One keep-alive connection of the load test, a request in flight at a time
+struct LoadClient {
+    int fd = -1;
+    std::string response;
+    // Body bytes still to come, -1 while the head is incomplete
+    long long bodyLeft = -1;
+    size_t path = 0;
+    std::chrono::steady_clock::time_point sent;
+    std::vector<std::string> etags;
+};
+
+int HttpLoad(int argc, char **argv) {
+    int clients = 256;
+    long long requests = 100000;
+    bool gzip = false, revalidate = false;
+    std::string data = "data", onlyPath;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--requests") == 0 && i + 1 < argc) {
+            requests = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            onlyPath = argv[++i];
+        } else if (strcmp(argv[i], "--gzip") == 0) {
+            gzip = true;
+        } else if (strcmp(argv[i], "--revalidate") == 0) {
+            revalidate = true;
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+    if (clients < 1 || requests < clients) {
+        return Usage();
+    }
+
+    RaiseFileLimit();
+
+    const std::vector<MapFile> files = PrepareMapFiles(data, AssetCache("cache"));
+    std::vector<std::string> paths;
+    for (const MapFile &file : files) {
+        if (onlyPath.empty() || file.path == onlyPath) {
+            paths.push_back(file.path);
+        }
+    }
+    if (paths.empty()) {
+        printf("[TOOLS][ERROR] No map file at %s\n", onlyPath.c_str());
+        return 1;
+    }
+
+    HttpServer server;
+    AddServedFiles(server, files, "webtest");
+    const std::uint16_t port = server.Listen("127.0.0.1", 0);
+    std::thread serverThread([&] { server.Run(); });
+
+    const int epoll = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<LoadClient> loadClients(clients);
+    long long issued = 0, completed = 0, failures = 0;
+    std::uint64_t bodyBytes = 0;
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+
+    auto sendRequest = [&](int index) {
+        LoadClient &client = loadClients[index];
+        client.path = (size_t)(issued++ % (long long)paths.size());
+        std::string request = "GET " + paths[client.path] + " HTTP/1.1\r\nHost: localhost\r\n";
+        if (gzip) {
+            request += "Accept-Encoding: gzip, deflate\r\n";
+        }
+        if (revalidate && !client.etags[client.path].empty()) {
+            request += "If-None-Match: " + client.etags[client.path] + "\r\n";
+        }
+        request += "\r\n";
+        client.response.clear();
+        client.bodyLeft = -1;
+        client.sent = std::chrono::steady_clock::now();
+        if (send(client.fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+            throw std::runtime_error("Could not send a request");
+        }
+    };
+
+    double seconds = 0.0;
+    std::exception_ptr failure;
+    try {
+        for (int i = 0; i < clients; i++) {
+            LoadClient &client = loadClients[i];
+            client.etags.resize(paths.size());
+            client.fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            sockaddr_in target{};
+            target.sin_family = AF_INET;
+            target.sin_port = htons(port);
+            target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (client.fd < 0 || connect(client.fd, (sockaddr *)&target, sizeof(target)) != 0) {
+                throw std::runtime_error(std::string("Could not connect client: ") + strerror(errno));
+            }
+            const int on = 1;
+            setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) | O_NONBLOCK);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u32 = (std::uint32_t)i;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, client.fd, &event);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < clients; i++) {
+            sendRequest(i);
+        }
+        std::vector<char> buffer(256 * 1024);
+        epoll_event events[256];
+        while (completed < requests) {
+            const int count = epoll_wait(epoll, events, 256, 10000);
+            if (count <= 0) {
+                throw std::runtime_error("Load test stalled");
+            }
+            for (int e = 0; e < count; e++) {
+                const int index = (int)events[e].data.u32;
+                LoadClient &client = loadClients[index];
+                for (;;) {
+                    const ssize_t received = recv(client.fd, buffer.data(), buffer.size(), 0);
+                    if (received <= 0) {
+                        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                            break;
+                        }
+                        throw std::runtime_error("Server closed a connection");
+                    }
+                    size_t used = 0;
+                    if (client.bodyLeft < 0) {
+                        // Heads are short, only they are kept
+                        client.response.append(buffer.data(), (size_t)received);
+                        const size_t end = client.response.find("\r\n\r\n");
+                        if (end == std::string::npos) {
+                            continue;
+                        }
+                        const std::string head = client.response.substr(0, end + 4);
+                        const int status = atoi(head.c_str() + 9);
+                        failures += status != 200 && status != 304;
+                        const size_t length = head.find("Content-Length: ");
+                        client.bodyLeft = length == std::string::npos ? 0 : atoll(head.c_str() + length + 16);
+                        const size_t etag = head.find("ETag: ");
+                        if (etag != std::string::npos) {
+                            const size_t etagEnd = head.find("\r\n", etag);
+                            client.etags[client.path] = head.substr(etag + 6, etagEnd - etag - 6);
+                        }
+                        used = (size_t)received - (client.response.size() - (end + 4));
+                    }
+                    const long long body =
+                        std::min<long long>(client.bodyLeft, (long long)received - (long long)used);
+                    client.bodyLeft -= body;
+                    bodyBytes += (std::uint64_t)body;
+                    if (client.bodyLeft == 0) {
+                        latencies.push_back(Microseconds(client.sent));
+                        completed++;
+                        if (issued < requests) {
+                            sendRequest(index);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+        seconds = Milliseconds(start) / 1e3;
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    for (const LoadClient &client : loadClients) {
+        if (client.fd >= 0) {
+            close(client.fd);
+        }
+    }
+    close(epoll);
+    server.Stop();
+    serverThread.join();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+    printf("%d clients, %lld requests over %zu paths%s%s\n", clients, requests, paths.size(),
+           gzip ? ", gzip" : "", revalidate ? ", revalidating" : "");
+    printf("throughput     %10.0f requests/s, %.1f MB/s of bodies\n", requests / seconds,
+           bodyBytes / seconds / 1e6);
+    printf("latency        p50 %.0f us, p99 %.0f us, worst %.0f us\n", percentile(0.5), percentile(0.99),
+           latencies.back());
+    PrintServerStats(server.Stats());
+    return failures == 0 ? 0 : 1;
+}
+
+// One loopback WebSocket client of the tracker load test
+struct Subscriber {
+    int fd = -1;
+    std::string input;
+    TrackerMirror mirror;
+};
+
+// Upgrades a blocking loopback connection to the tracker endpoint, what came
+// after the handshake stays in input
+int JoinTracker(std::uint16_t port, std::string &input) {
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in target{};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (sockaddr *)&target, sizeof(target)) != 0) {
+        throw std::runtime_error(std::string("Could not connect a subscriber: ") + strerror(errno));
+    }
+    const int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    const std::string key = "dGhlIHNhbXBsZSBub25jZQ==";
+    const std::string request = "GET /tracker HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\n"
+                                "Connection: Upgrade\r\nSec-WebSocket-Key: " +
+                                key + "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    char buffer[4096];
+    size_t end;
+    while ((end = input.find("\r\n\r\n")) == std::string::npos) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            throw std::runtime_error("Tracker handshake failed");
+        }
+        input.append(buffer, (size_t)received);
+    }
+    if (input.compare(0, 12, "HTTP/1.1 101") != 0 ||
+        input.find("Sec-WebSocket-Accept: " + WebSocketAccept(key)) == std::string::npos) {
+        throw std::runtime_error("Tracker refused the upgrade");
+    }
+    input.erase(0, end + 4);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int TrackerLoad(int argc, char **argv) {
+    int subscribers = 1000, bursts = 400, burstSize = 4;
+    double intervalMs = 5.0, frameMs = 1000.0 / 60.0;
+    std::string data = "data";
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--subscribers") == 0 && i + 1 < argc) {
+            subscribers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bursts") == 0 && i + 1 < argc) {
+            bursts = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst-size") == 0 && i + 1 < argc) {
+            burstSize = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            intervalMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frame-ms") == 0 && i + 1 < argc) {
+            frameMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            data = argv[++i];
+        } else {
+            return Usage();
+        }
+    }
+    if (subscribers < 1 || bursts < 1 || burstSize < 1 || intervalMs < 0.0 || frameMs <= 0.0) {
+        return Usage();
+    }
+    RaiseFileLimit();
+
+    const auto origin = std::chrono::steady_clock::now();
+    auto now = [origin] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+    };
+
+    // Same wiring as AddTracker, timed. Indexed by version - 1, only written
+    // on the server thread and read once it stopped.
+    TrackerState tracker(LoadItemsData((data + "/items.data").c_str()));
+    std::vector<double> firstChange, broadcastAt;
+    double pendingSince = 0.0;
+    HttpServer server;
+    server.AddWebSocket("/tracker", {[&] { return tracker.Snapshot(); },
+                                     [&](const std::vector<std::uint8_t> &message) {
+                                         if (!tracker.HasPendingChanges()) {
+                                             pendingSince = now();
+                                         }
+                                         tracker.ApplyToggles(message.data(), message.size());
+                                     }});
+    server.SetTick(frameMs / 1e3, [&] {
+        const std::vector<std::uint8_t> delta = tracker.TakeDelta();
+        if (!delta.empty()) {
+            firstChange.push_back(pendingSince);
+            broadcastAt.push_back(now());
+            server.Broadcast("/tracker", delta);
+        }
+    });
+    const std::uint16_t port = server.Listen("127.0.0.1", 0);
+    std::thread serverThread([&] { server.Run(); });
+    clockid_t serverClock;
+    pthread_getcpuclockid(serverThread.native_handle(), &serverClock);
+    auto serverCpu = [&] {
+        timespec time;
+        clock_gettime(serverClock, &time);
+        return time.tv_sec + time.tv_nsec / 1e9;
+    };
+
+    const std::uint32_t itemCount = tracker.ItemCount();
+    std::vector<Subscriber> clients(subscribers);
+    // Receipt times of every delta, by version - 1
+    std::vector<std::vector<double>> receipts;
+    std::vector<bool> expected(itemCount, false);
+    int toggles = 0, mismatches = 0;
+    size_t snapshotBytes = 0, deltaBytes = 0, deltas = 0;
+    double joinMs = 0.0, cpuSeconds = 0.0;
+    std::exception_ptr failure;
+    try {
+        const int epoll = epoll_create1(EPOLL_CLOEXEC);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < subscribers; i++) {
+            clients[i].fd = JoinTracker(port, clients[i].input);
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u32 = (std::uint32_t)i;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, clients[i].fd, &event);
+        }
+
+        int joined = 0;
+        // Parses what came in for a client, false when nothing did
+        auto receive = [&](Subscriber &client) {
+            char buffer[16384];
+            bool any = false;
+            for (;;) {
+                const ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+                if (received <= 0) {
+                    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                        break;
+                    }
+                    throw std::runtime_error("Tracker closed a subscriber");
+                }
+                client.input.append(buffer, (size_t)received);
+            }
+            const double time = now();
+            size_t offset = 0, used;
+            WebSocketFrame frame;
+            while ((used = ParseWebSocketFrame(client.input.data() + offset, client.input.size() - offset,
+                                               1 << 20, frame)) > 0) {
+                offset += used;
+                const std::uint8_t *payload = (const std::uint8_t *)frame.payload.data();
+                const bool wasJoined = client.mirror.Joined();
+                client.mirror.Apply(payload, frame.payload.size());
+                if (!wasJoined) {
+                    joined++;
+                    snapshotBytes = frame.payload.size();
+                } else {
+                    const std::uint32_t version = client.mirror.Version();
+                    if (receipts.size() < version) {
+                        receipts.resize(version);
+                    }
+                    receipts[version - 1].push_back(time);
+                    if (&client == &clients[0]) {
+                        deltas++;
+                        deltaBytes += frame.payload.size();
+                    }
+                }
+                any = true;
+            }
+            client.input.erase(0, offset);
+            return any;
+        };
+        auto poll = [&](int timeoutMs) {
+            epoll_event events[256];
+            const int count = epoll_wait(epoll, events, 256, timeoutMs);
+            for (int e = 0; e < count; e++) {
+                receive(clients[events[e].data.u32]);
+            }
+            return count > 0;
+        };
+
+        // Snapshots that came with the handshake
+        for (Subscriber &client : clients) {
+            if (!client.input.empty()) {
+                receive(client);
+            }
+        }
+        while (joined < subscribers) {
+            if (!poll(10000)) {
+                throw std::runtime_error("Subscribers did not get their snapshot");
+            }
+        }
+        joinMs = Milliseconds(start);
+
+        // The first client is the runner's tracker, sending each burst as one
+        // frame per toggle in one write
+        std::mt19937 random(12345);
+        const double cpuStart = serverCpu();
+        double nextBurst = now();
+        int sent = 0;
+        double idleSince = -1.0;
+        for (;;) {
+            if (sent < bursts && now() >= nextBurst) {
+                std::string frames;
+                for (int t = 0; t < burstSize; t++) {
+                    const std::uint32_t id = random() % itemCount;
+                    const bool collected = random() % 2 == 0;
+                    expected[id] = collected;
+                    const std::vector<std::uint8_t> message = EncodeTrackerToggles({{id, collected}});
+                    const std::uint8_t mask[4] = {(std::uint8_t)random(), (std::uint8_t)random(),
+                                                  (std::uint8_t)random(), (std::uint8_t)random()};
+                    AppendWebSocketFrame(frames, WebSocketOpcode::Binary, message.data(), message.size(),
+                                         mask);
+                    toggles++;
+                }
+                send(clients[0].fd, frames.data(), frames.size(), MSG_NOSIGNAL);
+                sent++;
+                nextBurst += intervalMs / 1e3;
+            }
+            if (sent < bursts) {
+                poll(std::max(0, (int)((nextBurst - now()) * 1e3)));
+                continue;
+            }
+            // Done once nothing came in for a few frames
+            if (poll((int)frameMs)) {
+                idleSince = -1.0;
+            } else if (idleSince < 0.0) {
+                idleSince = now();
+            } else if (now() - idleSince > 4 * frameMs / 1e3) {
+                break;
+            }
+        }
+        cpuSeconds = serverCpu() - cpuStart;
+        close(epoll);
+
+        for (const Subscriber &client : clients) {
+            bool match = true;
+            for (std::uint32_t id = 0; id < itemCount; id++) {
+                match = match && client.mirror.IsCollected(id) == expected[id];
+            }
+            mismatches += match ? 0 : 1;
+        }
+    } catch (...) {
+        failure = std::current_exception();
+    }
+
+    for (const Subscriber &client : clients) {
+        if (client.fd >= 0) {
+            close(client.fd);
+        }
+    }
+    server.Stop();
+    serverThread.join();
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    std::vector<double> fanOut, endToEnd;
+    double coalescing = 0.0, worstCoalescing = 0.0;
+    for (size_t v = 0; v < broadcastAt.size() && v < receipts.size(); v++) {
+        for (double receipt : receipts[v]) {
+            fanOut.push_back((receipt - broadcastAt[v]) * 1e3);
+            endToEnd.push_back((receipt - firstChange[v]) * 1e3);
+        }
+        coalescing += broadcastAt[v] - firstChange[v];
+        worstCoalescing = std::max(worstCoalescing, broadcastAt[v] - firstChange[v]);
+    }
+    std::sort(fanOut.begin(), fanOut.end());
+    std::sort(endToEnd.begin(), endToEnd.end());
+    auto percentile = [](const std::vector<double> &values, double p) {
+        return values.empty() ? 0.0 : values[(size_t)(p * (values.size() - 1))];
+    };
+
+    const HttpServerStats &stats = server.Stats();
+    printf("%d subscribers joined in %.1f ms, %zu byte snapshot of %u items\n", subscribers, joinMs,
+           snapshotBytes, itemCount);
+    printf("%d bursts of %d toggles every %.1f ms, %.1f ms frames: %llu deltas of %.1f bytes on average\n",
+           bursts, burstSize, intervalMs, frameMs, (unsigned long long)stats.broadcasts,
+           deltas ? (double)deltaBytes / deltas : 0.0);
+    printf("coalescing     first change to broadcast %.2f ms on average, %.2f ms worst\n",
+           broadcastAt.empty() ? 0.0 : coalescing / broadcastAt.size() * 1e3, worstCoalescing * 1e3);
+    printf("fan-out        broadcast to receipt p50 %.3f ms, p99 %.3f ms, worst %.3f ms\n",
+           percentile(fanOut, 0.5), percentile(fanOut, 0.99), fanOut.empty() ? 0.0 : fanOut.back());
+    printf("end to end     first change to receipt p50 %.3f ms, p99 %.3f ms\n", percentile(endToEnd, 0.5),
+           percentile(endToEnd, 0.99));
+    printf("server CPU     %.1f ms, %.1f us per delta, %.0f ns per delta and subscriber\n", cpuSeconds * 1e3,
+           stats.broadcasts ? cpuSeconds * 1e6 / stats.broadcasts : 0.0,
+           stats.broadcasts ? cpuSeconds * 1e9 / stats.broadcasts / subscribers : 0.0);
+    printf("mirrors        %d of %d match the runner, %llu dropped\n", subscribers - mismatches, subscribers,
+           (unsigned long long)stats.dropped);
+    return mismatches == 0 && stats.dropped == 0 ? 0 : 1;
+}
+#endif
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return Usage();
+    }
+
+    try {
+        const std::string command = argv[1];
+        if (command == "decode-bench") {
+            return DecodeBench(argc - 2, argv + 2);
+        }
+        if (command == "load-bench") {
+            return LoadBench(argc - 2, argv + 2);
+        }
+        if (command == "load-check") {
+            return LoadCheck(argc - 2, argv + 2);
+        }
+        if (command == "mip-bench") {
+            return MipBench(argc - 2, argv + 2);
+        }
+        if (command == "mip-check") {
+            return MipCheck(argc - 2, argv + 2);
+        }
+        if (command == "compress") {
+            return Compress(argc - 2, argv + 2);
+        }
+        if (command == "sdf-bench") {
+            return SdfBench(argc - 2, argv + 2);
+        }
+        if (command == "atlas-check") {
+            return AtlasCheck(argc - 2, argv + 2);
+        }
+        if (command == "camera-sim") {
+            return CameraSim(argc - 2, argv + 2);
+        }
+        if (command == "scheduler-sim") {
+            return SchedulerSim(argc - 2, argv + 2);
+        }
+        if (command == "perf-run") {
+            return PerfRun(argc - 2, argv + 2);
+        }
+        if (command == "query-bench") {
+            return QueryBench(argc - 2, argv + 2);
+        }
+        if (command == "cull-bench") {
+            return CullBench(argc - 2, argv + 2);
+        }
+        if (command == "reload-check") {
+            return ReloadCheck(argc - 2, argv + 2);
+        }
+        if (command == "browser-bench") {
+            return BrowserBench(argc - 2, argv + 2);
+        }
+        if (command == "font-bench") {
+            return FontBench(argc - 2, argv + 2);
+        }
+        if (command == "progressive") {
+            return Progressive(argc - 2, argv + 2);
+        }
+        if (command == "layout-bench") {
+            return LayoutBench(argc - 2, argv + 2);
+        }
+        if (command == "reach-bench") {
+            return ReachBench(argc - 2, argv + 2);
+        }
+        if (command == "tour-bench") {
+            return TourBench(argc - 2, argv + 2);
+        }
+        if (command == "seed-stats") {
+            return SeedStatsCommand(argc - 2, argv + 2);
+        }
+        if (command == "search-bench") {
+            return SearchBench(argc - 2, argv + 2);
+        }
+        if (command == "snap-items") {
+            return SnapItems(argc - 2, argv + 2);
+        }
+        if (command == "nav-bench") {
+            return NavBench(argc - 2, argv + 2);
+        }
+        if (command == "voxel-bench") {
+            return VoxelBench(argc - 2, argv + 2);
+        }
+#ifdef __linux__
+        if (command == "serve") {
+            return Serve(argc - 2, argv + 2);
+        }
+        if (command == "http-load") {
+            return HttpLoad(argc - 2, argv + 2);
+        }
+        if (command == "tracker-load") {
+            return TrackerLoad(argc - 2, argv + 2);
+        }
+#endif
+    } catch (const std::exception &e) {
+        printf("[TOOLS][ERROR] %s\n", e.what());
+        return 1;
+    }
+    return Usage();
+}
@@ -10,24 +10,34 @@
 //*********************************************************
 
 #include "MapViewer.h"
+#include "BlockCompression.h"
 #include "DXSampleHelper.h"
+#include "FontAtlasCache.h"
 #include "ImageIO.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_dx12.h"
 
-#include "assimp/Importer.hpp"
-#include "assimp/mesh.h"
-#include "assimp/postprocess.h"
-#include "assimp/scene.h"
+#include "HotReload.h"
+#include "IconSdf.h"
+#include "LayoutImport.h"
+#include "MipGenerator.h"
+#include "UploadPlanner.h"
+#include "Utility.h"
 #include "stdafx.h"
 #include <DirectXMath.h>
 
 #define _USE_MATH_DEFINES
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <filesystem>
 #include <format>
-#include <fstream>
-#include <sstream>
+#include <optional>
+
+// Indexed by m_mapIndex, items.data counts worlds in the same order from 1
+static const std::array<std::string, 7> WorldNames{"IntroWorld", "RuinsWorld", "IceWorld", "OverWorld",
+                                                   "MinesWorld", "LavaWorld",  "CraterWorld"};
 
 void ShaderCompile(std::wstring path, const char *entry, const char *target, UINT flags,
                    ComPtr<ID3DBlob> &shader) {
@@ -43,6 +53,63 @@ void ShaderCompile(std::wstring path, const char *entry, const char *target, UIN
     ThrowIfFailed(hr);
 }
 
+// Below this the icon atlas stays uncompressed
+static const double MinAtlasPsnr = 40.0;
+
+// Icons out of reach are darker, a touch red and see-through, RGBA8 red in
+// the low byte
+static const std::uint32_t UnreachableTint = 0xA0444466;
+
+static const char *const HeatmapNames[] = {"None", "Average sphere", "Major item share"};
+
+// Blue for 0 to red for 1, opaque
+static std::uint32_t HeatTint(float t) {
+    t = std::clamp(t, 0.f, 1.f);
+    const std::uint32_t red = (std::uint32_t)(255.f * std::min(1.f, 2.f * t));
+    const std::uint32_t blue = (std::uint32_t)(255.f * std::min(1.f, 2.f - 2.f * t));
+    return 0xFF000000u | blue << 16 | 0x40u << 8 | red;
+}
+
+// Channel by channel
+static std::uint32_t MultiplyTints(std::uint32_t a, std::uint32_t b) {
+    std::uint32_t result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        result |= (((a >> shift) & 0xFF) * ((b >> shift) & 0xFF) / 255) << shift;
+    }
+    return result;
+}
+
+// Logic items counted from the collected items instead of set by hand
+static bool IsItemTypeName(const std::string &name) {
+    for (std::uint8_t type = 0; type < ItemTypeCount; type++) {
+        if (name == ItemTypeName(type)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Records the copies of the subresources placed in staging by PlanUpload,
+// subresource i of the plan goes to subresource i of the texture
+static void CopyStagedSubresources(ID3D12GraphicsCommandList *commandList, ID3D12Resource *texture,
+                                   ID3D12Resource *staging, DXGI_FORMAT format,
+                                   const std::vector<SubresourceDesc> &subresources, const UploadPlan &plan) {
+    for (UINT i = 0; i < subresources.size(); i++) {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT placed = {};
+        placed.Offset = plan.footprints[i].offset;
+        placed.Footprint.Format = format;
+        // Block compressed mips smaller than a block still copy a whole one
+        placed.Footprint.Width = RoundToNextMultiple(subresources[i].width, subresources[i].blockSize);
+        placed.Footprint.Height = RoundToNextMultiple(subresources[i].height, subresources[i].blockSize);
+        placed.Footprint.Depth = 1;
+        placed.Footprint.RowPitch = plan.footprints[i].rowPitch;
+
+        const CD3DX12_TEXTURE_COPY_LOCATION destination(texture, i);
+        const CD3DX12_TEXTURE_COPY_LOCATION source(staging, placed);
+        commandList->CopyTextureRegion(&destination, 0, 0, 0, &source, nullptr);
+    }
+}
+
 MapViewer::MapViewer(UINT width, UINT height, std::wstring name)
     : DXSample(width, height, name), m_frameIndex(0), m_width(width), m_height(height),
       m_viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height)),
@@ -144,7 +211,7 @@ void MapViewer::LoadPipeline() {
         m_dsvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
         D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc{};
-        srvHeapDesc.NumDescriptors = 2 + (FrameCount * 2); // Two icon textures + intermediate RTs
+        srvHeapDesc.NumDescriptors = FrameCount * 3; // Icon atlas + intermediate RTs, starting at FrameCount
         srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
         srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvHeap)));
@@ -228,6 +295,14 @@ void MapViewer::LoadPipeline() {
 
     // Setup Dx12 side of ImGui
     {
+        // Built before the backend uploads it, from the cache when the fonts
+        // did not change
+        auto start = std::chrono::steady_clock::now();
+        const bool cached = BuildFontAtlasCached(*ImGui::GetIO().Fonts, m_assetCache);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        printf("[FONTS] Atlas %s in %.2f ms\n", cached ? "loaded" : "built",
+               std::chrono::duration<float, std::milli>(elapsed).count());
+
         ImGui_ImplDX12_Init(m_device.Get(), FrameCount, swapChainDesc.Format, m_imguiHeap.Get(),
                             m_imguiHeap->GetCPUDescriptorHandleForHeapStart(),
                             m_imguiHeap->GetGPUDescriptorHandleForHeapStart());
@@ -283,15 +358,13 @@ void MapViewer::LoadAssets() {
 
         // ---------------------------------------------
         CD3DX12_DESCRIPTOR_RANGE1 srvRange;
-        srvRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 0);
+        srvRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE, 0);
         CD3DX12_ROOT_PARAMETER1 srvIconTable;
         srvIconTable.InitAsDescriptorTable(1, &srvRange, D3D12_SHADER_VISIBILITY_PIXEL);
 
         CD3DX12_ROOT_PARAMETER1 srvIconVertices;
-        srvIconVertices.InitAsShaderResourceView(2, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
+        srvIconVertices.InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE,
                                                  D3D12_SHADER_VISIBILITY_VERTEX);
-        CD3DX12_ROOT_PARAMETER1 srvIconTypes;
-        srvIconTypes.InitAsShaderResourceView(3);
 
         CD3DX12_ROOT_PARAMETER1 cbvConsts;
         cbvConsts.InitAsConstants(4, 0);
@@ -299,10 +372,9 @@ void MapViewer::LoadAssets() {
         CD3DX12_ROOT_PARAMETER1 cbvPerFrame;
         cbvPerFrame.InitAsConstantBufferView(1);
 
-        CD3DX12_ROOT_PARAMETER1 iconParams[]{srvIconTable, srvIconVertices, srvIconTypes, cbvConsts,
-                                             cbvPerFrame};
+        CD3DX12_ROOT_PARAMETER1 iconParams[]{srvIconTable, srvIconVertices, cbvConsts, cbvPerFrame};
         CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC overRootSignatureDesc;
-        overRootSignatureDesc.Init_1_1(5, iconParams, 1, &sampleDesc, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+        overRootSignatureDesc.Init_1_1(4, iconParams, 1, &sampleDesc, D3D12_ROOT_SIGNATURE_FLAG_NONE);
 
         ComPtr<ID3DBlob> overSignature;
         ComPtr<ID3DBlob> overError;
@@ -451,224 +523,169 @@ void MapViewer::LoadAssets() {
 
     // Create the vertex buffer.
     {
-        // Load 3d model maps for each worlds
-        struct Geometry {
-            std::vector<Vertex> vertices;
-            std::vector<unsigned int> indices;
-        };
-        Geometry worldGeo;
-        m_worldDraws = {};
-
-        static const std::array<std::string, WorldCount> worlds{
-            "IntroWorld", "RuinsWorld", "IceWorld", "OverWorld", "MinesWorld", "LavaWorld", "CraterWorld"};
-
-        for (int i = 0; i < WorldCount; i++) {
-            std::string filepath = std::format("data/{}.obj", worlds[i]);
-
-            Assimp::Importer importer;
-            const aiScene *scene = importer.ReadFile(filepath.c_str(), aiProcess_ConvertToLeftHanded);
-
-            for (unsigned int j = 0; j < scene->mNumMeshes; j++) {
-                m_worldDraws[i].indexStarts.emplace_back(worldGeo.indices.size());
-                m_worldDraws[i].vertexStarts.emplace_back(worldGeo.vertices.size());
-
-                aiMesh *mesh = scene->mMeshes[j];
-
-                for (UINT i = 0; i < mesh->mNumVertices; i++) {
-                    aiVector3D vert = mesh->mVertices[i];
-                    aiVector3D norm = mesh->mNormals[i];
-                    worldGeo.vertices.push_back(
-                        {{vert.x, vert.y, vert.z, 1.f}, {norm.x, norm.y, norm.z, 0.f}});
-                }
-                for (UINT i = 0; i < mesh->mNumFaces; i++) {
-                    for (UINT j = 0; j < mesh->mFaces[i].mNumIndices; j++) {
-                        worldGeo.indices.emplace_back(mesh->mFaces[i].mIndices[j]);
-                    }
-                }
-
-                m_worldDraws[i].indexCount.emplace_back(worldGeo.indices.size() -
-                                                        m_worldDraws[i].indexStarts[j]);
-                m_worldDraws[i].drawCount++;
-            }
+        // Load 3d model maps for each worlds, every world gets its own buffers
+        // so a reload only replaces what belongs to the changed file
+        for (UINT i = 0; i < WorldCount; i++) {
+            m_worldMeshes[i] = LoadWorldObj(std::format("data/{}.obj", WorldNames[i]).c_str());
+            CreateWorldBuffers(i);
+            BuildPortals(i);
         }
+        BuildRoomGraph();
+    }
 
-        CD3DX12_RANGE readRange(0, 0); // We do not intend to read from these resources on the CPU.
-
-        const UINT vertexBufferSize = sizeof(Vertex) * (UINT)worldGeo.vertices.size();
-        const UINT indexBufferSize = sizeof(unsigned int) * (UINT)worldGeo.indices.size();
-
-        D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        D3D12_RESOURCE_DESC uploadBufferDesc =
-            CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize + indexBufferSize);
-        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &uploadBufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                        nullptr, IID_PPV_ARGS(&m_uploadBuffer)));
-        NAME_D3D12_OBJECT(m_uploadBuffer);
-
-        // TODO: Look into using placed resources for vertex/index buffers
-        D3D12_HEAP_PROPERTIES defaultHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        D3D12_RESOURCE_DESC vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
-        ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &vertexBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST,
-                                                        nullptr, IID_PPV_ARGS(&m_vertexBuffer)));
-        NAME_D3D12_OBJECT(m_vertexBuffer);
+    // Load map metadata for icons overlay
+    {
+        m_items = LoadItems();
+        m_itemIndex.Build(m_items);
+        UpdateItemFilter();
+        LoadSeedStats();
+        BuildReachability();
+        BuildNameSearch();
+
+        // Sized for every item, filters only ever shrink the visible set
+        CreateIconVertices(m_items.size());
+    }
 
-        m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-        m_vertexBufferView.StrideInBytes = sizeof(Vertex);
-        m_vertexBufferView.SizeInBytes = vertexBufferSize;
+    // Load icons used for items overlay, all of them end up in a single atlas
+    // texture and the overlay pass picks the right one through the icon UVs
+    {
+        // Indexed by item type
+        static const std::array<std::string, 2> iconfiles{"energytankIcon.png", "missileIcon.png"};
 
-        D3D12_RESOURCE_DESC indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
-        ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &indexBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST,
-                                                        nullptr, IID_PPV_ARGS(&m_indexBuffer)));
-        NAME_D3D12_OBJECT(m_indexBuffer);
+        std::vector<std::string> paths;
+        for (const std::string &file : iconfiles) {
+            paths.push_back(std::format("data/{}", file));
+        }
 
-        m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
-        m_indexBufferView.Format = DXGI_FORMAT_R32_UINT;
-        m_indexBufferView.SizeInBytes = indexBufferSize;
+        const auto decodeStart = std::chrono::steady_clock::now();
+        std::vector<DecodedImage> decoded = LoadImagesFromFiles(paths, 1, m_threadPool);
+        const float decodeMs =
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
 
-        unsigned char *pUpload;
-        ThrowIfFailed(m_uploadBuffer->Map(0, &readRange, (void **)&pUpload));
-        memcpy(pUpload, worldGeo.vertices.data(), vertexBufferSize);
-        memcpy(pUpload + vertexBufferSize, worldGeo.indices.data(), indexBufferSize);
-        m_uploadBuffer->Unmap(0, nullptr);
+        std::vector<IconImage> icons(iconfiles.size());
+        for (int i = 0; i < iconfiles.size(); i++) {
+            icons[i].width = decoded[i].width;
+            icons[i].height = decoded[i].height;
+            icons[i].pixels = std::move(decoded[i].pixels);
+            printf("[IMG][%s] (%i, %i) -> %lld\n", iconfiles[i].c_str(), icons[i].width, icons[i].height,
+                   icons[i].pixels.size());
+        }
+        printf("[IMG] %zu icons decoded in %.2f ms on %u threads\n", icons.size(), decodeMs,
+               m_threadPool.ThreadCount());
 
-        m_commandList->CopyBufferRegion(m_vertexBuffer.Get(), 0, m_uploadBuffer.Get(), 0, vertexBufferSize);
-        m_commandList->CopyBufferRegion(m_indexBuffer.Get(), 0, m_uploadBuffer.Get(), vertexBufferSize,
-                                        indexBufferSize);
+        // The icon size slider goes from tiny to full screen markers, distance
+        // fields keep the edges sharp over all of it
+        const auto sdfStart = std::chrono::steady_clock::now();
+        const std::vector<IconImage> sdfs = GenerateIconSdfs(icons, SdfDesc{}, m_threadPool);
+        printf("[IMG] %zu icon distance fields in %.2f ms\n", sdfs.size(),
+               std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - sdfStart).count());
 
-        const CD3DX12_RESOURCE_BARRIER barriers[2] = {
-            CD3DX12_RESOURCE_BARRIER::Transition(m_vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-                                                 D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
-            CD3DX12_RESOURCE_BARRIER::Transition(m_indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
-                                                 D3D12_RESOURCE_STATE_INDEX_BUFFER)};
+        IconAtlas atlas = BuildIconAtlas(sdfs);
+        m_iconUVs = atlas.uvs;
+        printf("[IMG][atlas] (%i, %i) -> %zu icons\n", atlas.width, atlas.height, atlas.uvs.size());
 
-        m_commandList->ResourceBarrier(2, barriers);
-    }
+        static const D3D12_HEAP_PROPERTIES defaultProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        static const D3D12_HEAP_PROPERTIES uploadProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
-    // Load map metadata for icons overlay
-    {
-        std::ifstream f("data/items.data");
-        std::string line;
-
-        while (std::getline(f, line)) {
-            std::stringstream ss(line);
-            unsigned char itemType = 0;
-            ss >> itemType;
-            itemType -= '0';
-            ss.ignore();
-            UINT worldIndex = 0;
-            ss >> worldIndex;
-            ss.ignore();
-            UINT roomIndex = 0;
-            ss >> roomIndex;
-
-            ss.ignore();
-
-            float x, y, z;
-            ss >> x;
-            ss.ignore(2);
-            ss >> y;
-            ss.ignore(2);
-            ss >> z;
-
-            // I am not sure why we would need to swap y & z axis positions
-            m_worldItems[worldIndex - 1].push_back({itemType, worldIndex, roomIndex, {x, z, y}});
-        }
-
-        std::vector<IconGeometry> iconGeometry;
-        std::vector<unsigned int> iconTypes;
-        m_iconDraws = {};
-
-        for (int i = 0; i < WorldCount; i++) {
-            std::vector<ItemMetadata> &icons = m_worldItems[i];
-
-            m_iconDraws[i].instanceCount = icons.size();
-            m_iconDraws[i].instanceStart = iconTypes.size();
-
-            for (int j = 0; j < icons.size(); j++) {
-                iconGeometry.emplace_back();
-                iconTypes.emplace_back(icons[j].type);
+        // Icons are mostly seen minified. Mips stop before icons would bleed
+        // into each other, and box filtering keeps every level inside the
+        // aligned icon blocks. Alpha is a distance, not coverage, so colors
+        // are filtered without it.
+        MipDesc mipDesc;
+        mipDesc.filter = MipFilter::Box;
+        mipDesc.levelCount = IconAtlasSafeMipCount(IconAtlasDesc{});
+        mipDesc.premultiply = false;
+
+        bool cacheHit = false;
+        const auto mipStart = std::chrono::steady_clock::now();
+        const std::vector<DecodedImage> mips = CachedMipChain(
+            m_assetCache, {atlas.width, atlas.height, std::move(atlas.pixels)}, mipDesc, &cacheHit);
+        printf("[IMG][atlas] %zu mips %s in %.2f ms\n", mips.size(), cacheHit ? "loaded" : "generated",
+               std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mipStart).count());
+
+        // BC7 takes a quarter of the memory and bandwidth. It is kept only
+        // when it stays close to the source, even two subset blocks can't
+        // hold the many colors of small pixel art icons.
+        std::vector<CompressedImage> compressed;
+        if (atlas.width % 4 == 0 && atlas.height % 4 == 0) {
+            const auto compressStart = std::chrono::steady_clock::now();
+            compressed = CachedCompression(m_assetCache, mips, BlockFormat::BC7, m_threadPool, &cacheHit);
+            const std::chrono::duration<float, std::milli> compressTime =
+                std::chrono::steady_clock::now() - compressStart;
+            // The distance moves the edges, so it is held to the bar on its own
+            const DecodedImage decoded = DecompressImage(compressed[0]);
+            const double colorPsnr = ComputeChannelPsnr(mips[0], decoded, 0, 3);
+            const double distancePsnr = ComputeChannelPsnr(mips[0], decoded, 3, 1);
+            printf("[IMG][atlas] BC7 %s in %.2f ms, colors %.2f dB, distance %.2f dB\n",
+                   cacheHit ? "loaded" : "compressed", compressTime.count(), colorPsnr, distancePsnr);
+            if (std::min(colorPsnr, distancePsnr) < MinAtlasPsnr) {
+                printf("[IMG][atlas] BC7 under %.0f dB, keeping RGBA8\n", MinAtlasPsnr);
+                compressed.clear();
             }
         }
+        const DXGI_FORMAT atlasFormat =
+            compressed.empty() ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_BC7_UNORM_SRGB;
+
+        auto imgDesc =
+            CD3DX12_RESOURCE_DESC::Tex2D(atlasFormat, atlas.width, atlas.height, 1, (UINT16)mips.size());
+        ThrowIfFailed(m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE, &imgDesc,
+                                                        D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
+                                                        IID_PPV_ARGS(&m_iconAtlas)));
+        NAME_D3D12_OBJECT(m_iconAtlas);
+
+        // Every subresource goes through a single staging buffer
+        std::vector<SubresourceDesc> subresources;
+        for (const DecodedImage &mip : mips) {
+            if (compressed.empty()) {
+                subresources.push_back({(UINT)mip.width, (UINT)mip.height});
+            } else {
+                subresources.push_back({(UINT)mip.width, (UINT)mip.height, 4, BlockBytes(BlockFormat::BC7)});
+            }
+        }
+        const UploadPlan plan = PlanUpload(subresources);
 
-        const UINT geometrySize = sizeof(IconGeometry) * (UINT)iconGeometry.size();
-        const UINT iconTypeSize = sizeof(unsigned int) * (UINT)iconTypes.size();
-
-        D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        D3D12_RESOURCE_DESC iconBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(geometrySize);
-        D3D12_RESOURCE_DESC typesBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(iconTypeSize);
-
-        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &iconBufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                        nullptr, IID_PPV_ARGS(&m_iconVertices)));
-        NAME_D3D12_OBJECT(m_iconVertices);
-        ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE,
-                                                        &typesBufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ,
-                                                        nullptr, IID_PPV_ARGS(&m_iconTypes)));
-        NAME_D3D12_OBJECT(m_iconTypes);
-
-        CD3DX12_RANGE readRange(0, 0); // We do not intend to read from these resources on the CPU.
-        unsigned char *pGeoUpload;
-        ThrowIfFailed(m_iconVertices->Map(0, &readRange, (void **)&pGeoUpload));
-        memcpy(pGeoUpload, iconGeometry.data(), geometrySize);
-        m_iconVertices->Unmap(0, nullptr);
-
-        // TODO: This buffer should not change and could be copied to default heap
-        unsigned char *pTypesUpload;
-        ThrowIfFailed(m_iconTypes->Map(0, &readRange, (void **)&pTypesUpload));
-        memcpy(pTypesUpload, iconTypes.data(), iconTypeSize);
-        m_iconTypes->Unmap(0, nullptr);
-    }
-
-    // Load icons used for items overlay
-    {
-        static const std::array<std::string, 2> iconfiles{"energytankIcon.png", "missileIcon.png"};
-
-        static const D3D12_HEAP_PROPERTIES defaultProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-        static const D3D12_HEAP_PROPERTIES uploadProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        CD3DX12_CPU_DESCRIPTOR_HANDLE srvHandle(m_srvHeap->GetCPUDescriptorHandleForHeapStart());
+        auto uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(plan.totalSize);
+        ThrowIfFailed(m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE, &uploadBufferDesc,
+                                                        D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                        IID_PPV_ARGS(&m_iconAtlasUpload)));
+        NAME_D3D12_OBJECT(m_iconAtlasUpload);
+
+        void *staging;
+        const CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(m_iconAtlasUpload->Map(0, &readRange, &staging));
+        for (size_t i = 0; i < mips.size(); i++) {
+            if (compressed.empty()) {
+                CopyToStaging(plan.footprints[i], mips[i].pixels.data(), mips[i].width * 4, staging);
+            } else {
+                CopyToStaging(plan.footprints[i], compressed[i].blocks.data(), plan.footprints[i].rowBytes,
+                              staging);
+            }
+        }
+        m_iconAtlasUpload->Unmap(0, nullptr);
+
+        CopyStagedSubresources(m_commandList.Get(), m_iconAtlas.Get(), m_iconAtlasUpload.Get(), atlasFormat,
+                               subresources, plan);
+        const auto transition = CD3DX12_RESOURCE_BARRIER::Transition(
+            m_iconAtlas.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_commandList->ResourceBarrier(1, &transition);
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
+        shaderResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+        shaderResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        shaderResourceViewDesc.Format = atlasFormat;
+        shaderResourceViewDesc.Texture2D.MipLevels = (UINT)mips.size();
+        shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+        shaderResourceViewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
+
+        m_device->CreateShaderResourceView(m_iconAtlas.Get(), &shaderResourceViewDesc,
+                                           m_srvHeap->GetCPUDescriptorHandleForHeapStart());
+    }
 
-        for (int i = 0; i < iconfiles.size(); i++) {
-            int width, height = 0;
-            std::vector<uint8_t> texData =
-                LoadImageFromFile(std::format("data/{}", iconfiles[i]).c_str(), 1, &width, &height);
-            printf("[IMG][%s] (%i, %i) -> %lld\n", iconfiles[i].c_str(), width, height, texData.size());
-
-            auto imgDesc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, width, height, 1, 1);
-            m_device->CreateCommittedResource(&defaultProps, D3D12_HEAP_FLAG_NONE, &imgDesc,
-                                              D3D12_RESOURCE_STATE_COPY_DEST, nullptr,
-                                              IID_PPV_ARGS(&m_img[i]));
-
-            auto uploadBufferSize = GetRequiredIntermediateSize(m_img[i].Get(), 0, 1);
-            auto uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-            m_device->CreateCommittedResource(&uploadProps, D3D12_HEAP_FLAG_NONE, &uploadBufferDesc,
-                                              D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                                              IID_PPV_ARGS(&m_imgUploadBuffer[i]));
-
-            D3D12_SUBRESOURCE_DATA srcData;
-            srcData.pData = texData.data();
-            srcData.RowPitch = width * 4;
-            srcData.SlicePitch = width * height * 4;
-
-            UpdateSubresources(m_commandList.Get(), m_img[i].Get(), m_imgUploadBuffer[i].Get(), 0, 0, 1,
-                               &srcData);
-            const auto transition = CD3DX12_RESOURCE_BARRIER::Transition(
-                m_img[i].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-            m_commandList->ResourceBarrier(1, &transition);
-
-            D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc = {};
-            shaderResourceViewDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-            shaderResourceViewDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-            shaderResourceViewDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-            shaderResourceViewDesc.Texture2D.MipLevels = 1;
-            shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
-            shaderResourceViewDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-
-            m_device->CreateShaderResourceView(m_img[i].Get(), &shaderResourceViewDesc, srvHandle);
-            srvHandle.Offset(1, m_srvDescriptorSize);
-        }
-        // TODO: Find a way to upload texture data in one batch
+    // Edits to the data folder are picked up while the viewer runs
+    try {
+        m_dataWatcher = std::make_unique<FileWatcher>("data");
+    } catch (const std::exception &e) {
+        printf("[RELOAD][ERROR] %s\n", e.what());
     }
 
     // Command lists are created in the recording state, but there is nothing
@@ -695,34 +712,39 @@ void MapViewer::LoadAssets() {
         // list in our main loop but for now, we just want to wait for setup to
         // complete before continuing.
         WaitForGpu();
+        // The staging copies of every world are done with
+        m_uploadBuffers.clear();
     }
 }
 
 // Update frame-based values.
 void MapViewer::OnUpdate() {
-    XMVECTOR lookat { 0.f, 0.f, 0.f, 1.f };
-    XMVECTOR updir { 0.f, 1.f, 0.f, 0.f };
-
-    XMVECTOR angles {
-        XMConvertToRadians(m_orbPhi),
-        XMConvertToRadians(m_orbTheta),
-        XMConvertToRadians(0)
-    };
-    XMVECTOR camera { 0.f, 0.f, 600.f, 1.f };
-    XMMATRIX orbit = XMMatrixRotationRollPitchYawFromVector(angles);
-    camera = XMVector3Transform(camera, orbit);
-
-    XMMATRIX view = XMMatrixLookAtLH(camera, lookat, updir);
-
-    float aspect = (float)m_width / m_height;
-    XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(m_fov), aspect, 0.1f, 100000.0f);
-
-    XMMATRIX model = XMMatrixTranslation(m_tx, m_ty, m_tz);
-    //TODO: Deal with movement here
+    m_scheduler.BeginFrame();
+
+    // Input since the last frame, the camera applies it at the times it came in
+    const double now = m_input.Now();
+    const std::vector<InputEvent> events = m_input.Drain(now);
+    for (const InputEvent &event : events) {
+        if (event.type == InputEventType::KeyDown) {
+            HandleKey(event.key);
+        }
+    }
+    m_recorder.Record(events);
+    if (m_replaying && now >= m_replayEnd) {
+        m_replaying = false;
+        m_replayStatus = "done";
+    }
+    m_cameraController.Advance(now, events);
+    m_camera = m_cameraController.Sample(now);
 
-    XMMATRIX mvp = XMMatrixMultiply(model, view);
-    mvp = XMMatrixMultiply(mvp, projection);
+    const CameraMatrices matrices = ComputeCameraMatrices(m_camera, (float)m_width / m_height);
+    XMMATRIX mvp = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4 *>(matrices.viewProjection));
+    XMMATRIX model =
+        XMMatrixTranslationFromVector(XMLoadFloat3(reinterpret_cast<const XMFLOAT3 *>(m_camera.target)));
     XMMATRIX world = XMMatrixTranspose(model);
+    XMStoreFloat4x4(&m_mvp, mvp);
+
+    CullRooms(matrices);
 
     ConstantBuffer cb{ mvp, world };
 
@@ -732,51 +754,15 @@ void MapViewer::OnUpdate() {
     memcpy(p, &cb, sizeof(cb));
     m_constBuffer->Unmap(0, nullptr);
 
-    std::vector<IconGeometry> iconGeometry;
     // -----------------------------------------
     // IDEA: Convert this process to a compute shader
     // Maybe also look into setting up the overlay pass as an indirect draw
-    for (int i = 0; i < WorldCount; i++) {
-        auto &items = m_worldItems[i];
-
-        for (int j = 0; j < items.size(); j++) {
-            auto &item = items[j];
-
-            XMFLOAT4X4 viewMat{};
-            XMStoreFloat4x4(&viewMat, view);
-            float v_11 = viewMat.m[0][0];
-            float v_21 = viewMat.m[1][0];
-            float v_31 = viewMat.m[2][0];
-            XMVECTOR right{v_11, v_21, v_31};
-            right = XMVector3Normalize(right) * m_iconSize * 0.5f;
-
-            float v_12 = viewMat.m[0][1];
-            float v_22 = viewMat.m[1][1];
-            float v_32 = viewMat.m[2][1];
-            XMVECTOR up{v_12, v_22, v_32};
-            up = XMVector3Normalize(up) * m_iconSize * 0.5f;
-
-            IconGeometry geo{};
-            XMStoreFloat3(&geo.pos[0], item.position - right - up);
-            geo.uvs[0] = {0.0f, 1.0f};
-            XMStoreFloat3(&geo.pos[1], item.position - right + up);
-            geo.uvs[1] = {0.0f, 0.0f};
-            XMStoreFloat3(&geo.pos[2], item.position + right - up);
-            geo.uvs[2] = {1.0f, 1.0f};
-            XMStoreFloat3(&geo.pos[3], item.position + right - up);
-            geo.uvs[3] = {1.0f, 1.0f};
-            XMStoreFloat3(&geo.pos[4], item.position - right + up);
-            geo.uvs[4] = {0.0f, 0.0f};
-            XMStoreFloat3(&geo.pos[5], item.position + right + up);
-            geo.uvs[5] = {1.0f, 0.0f};
-
-            iconGeometry.push_back(geo);
-        }
-    }
+    BuildIconQuads(m_items, m_visibleItems, m_iconUVs, matrices.view, m_iconSize, m_iconQuads,
+                   m_iconTints.data());
 
     unsigned char *geoData;
     ThrowIfFailed(m_iconVertices->Map(0, &readRange, (void **)&geoData));
-    memcpy(geoData, iconGeometry.data(), sizeof(IconGeometry) * iconGeometry.size());
+    memcpy(geoData, m_iconQuads.data(), sizeof(IconQuad) * m_iconQuads.size());
     m_iconVertices->Unmap(0, nullptr);
 }
 
@@ -793,9 +779,21 @@ void MapViewer::OnRender() {
     ID3D12CommandList *ppCommandLists[] = {m_commandList.Get()};
     m_commandQueue->ExecuteCommandLists(_countof(ppCommandLists), ppCommandLists);
 
+    // Frame budgets are about CPU time, waiting on vsync is left out
+    m_scheduler.EndFrame();
+
     // Present the frame.
     ThrowIfFailed(m_swapChain->Present(1, 0));
 
+    // Reload latency goes from the file change being noticed to the first
+    // frame presented with the new data
+    if (m_reloadInFlight) {
+        auto elapsed = std::chrono::steady_clock::now() - m_reloadStart;
+        m_reloadLatencyMs = std::chrono::duration<float, std::milli>(elapsed).count();
+        m_reloadInFlight = false;
+        printf("[RELOAD] %s (%.2f ms)\n", m_reloadStatus.c_str(), m_reloadLatencyMs);
+    }
+
     MoveToNextFrame();
 }
 
@@ -808,49 +806,103 @@ void MapViewer::OnDestroy() {
 }
 
 void MapViewer::OnKeyDown(UINT8 key) {
-    if (key >= '1' && key <= '7') {
-        m_mapIndex = key - '0' - 1;
+    if (!m_replaying) {
+        m_input.PushKeyDown(key);
     }
 }
 
 void MapViewer::OnMouseMove(short x, short y, bool LButton, bool RButton, bool ctrl) {
-    // Make sure the mouse is on screen
-    if (x < 0 || y < 0) return;
+    if (!m_replaying) {
+        m_input.PushMouseMove(x, y, LButton, RButton, ctrl);
+    }
+}
 
-    float dx = (float)m_mx - x;
-    float dy = (float)m_my - y;
+void MapViewer::OnMouseWheel(short deltaz) {
+    if (!m_replaying) {
+        m_input.PushMouseWheel(deltaz);
+    }
+}
 
-    if (LButton) {
-        m_orbTheta -= dx;
-        if (m_orbTheta < 0.f) m_orbTheta += 360.f;
-        if (m_orbTheta > 360.f) m_orbTheta -= 360.f;
+void MapViewer::OnInvalidate() {
+    // ImGui lays out windows over a couple of frames after a change
+    m_scheduler.MarkDirty(DirtyInput, 3);
+}
 
-        m_orbPhi += dy;
-        if (m_orbPhi < -89.f) m_orbPhi = -89.f;
-        if (m_orbPhi > 89.f) m_orbPhi = 89.f;
-    }
+double MapViewer::OnIdle() {
+    PollHotReload();
 
-    if (RButton && !ctrl) {
-        //TODO: Move map on xz plane
-        // Based off of the current m_orbTheta
-        float cosT = cos(XMConvertToRadians(m_orbTheta));
-        float sinT = sin(XMConvertToRadians(m_orbTheta));
-        float tx = dx * cosT - dy * sinT;
-        float ty = dx * sinT + dy * cosT;
-        //printf("Theta: %f; Before: (%f, %f); After: (%f, %f\n", m_orbTheta, dx, dy, tx, ty);
-        m_tx += tx;
-        m_tz -= ty;
-    } else if (RButton) {
-        m_ty += dy;
+    m_scheduler.SetAnimating(DirtyCamera, !m_cameraController.IsSettled());
+    m_scheduler.SetAnimating(DirtyAnimation, m_alwaysRedraw || m_replaying);
+
+    // Wakes up now and then to look for changed data files
+    static const double PollInterval = 0.1;
+    return std::min(m_scheduler.SecondsUntilFrame(), PollInterval);
+}
+
+void MapViewer::HandleKey(UINT8 key) {
+    if (key >= '1' && key <= '7') {
+        m_mapIndex = key - '0' - 1;
+        UpdateItemFilter();
     }
+}
 
-    m_mx = x;
-    m_my = y;
+ViewerSnapshot MapViewer::TakeSnapshot() const {
+    ViewerSnapshot snapshot;
+    snapshot.world = m_mapIndex;
+    snapshot.iconSize = m_iconSize;
+    snapshot.filter = m_itemFilter;
+    snapshot.portalCulling = m_portalCulling;
+    snapshot.camera = m_cameraController.Goal();
+    return snapshot;
 }
 
-void MapViewer::OnMouseWheel(short deltaz) {
-    static const short divisor = -60;
-    m_fov += (float)deltaz / divisor;
+void MapViewer::ApplySnapshot(const ViewerSnapshot &snapshot) {
+    m_mapIndex = std::min<UINT>(snapshot.world, WorldCount - 1);
+    m_iconSize = snapshot.iconSize;
+    m_itemFilter = snapshot.filter;
+    m_portalCulling = snapshot.portalCulling;
+    UpdateItemFilter();
+}
+
+// Recordings start from a resting camera with a fresh step clock, the same
+// state a replay starts from.
+void MapViewer::StartRecording() {
+    const double now = m_input.Now();
+    const ViewerSnapshot snapshot = TakeSnapshot();
+    m_cameraController.Reset(snapshot.camera, now);
+    m_recorder.Start(snapshot, now);
+    m_replayStatus = "recording";
+}
+
+void MapViewer::StopRecording() {
+    const InputLog log = m_recorder.Stop();
+    try {
+        SaveInputLog("replay.mpir", log);
+        m_replayStatus = std::format("saved {} events to replay.mpir", log.events.size());
+    } catch (const std::exception &e) {
+        printf("[REPLAY][ERROR] %s\n", e.what());
+        m_replayStatus = "save failed";
+    }
+}
+
+void MapViewer::StartReplay() {
+    InputLog log;
+    try {
+        log = LoadInputLog("replay.mpir");
+    } catch (const std::exception &e) {
+        printf("[REPLAY][ERROR] %s\n", e.what());
+        m_replayStatus = "load failed";
+        return;
+    }
+
+    ApplySnapshot(log.snapshot);
+    const double now = m_input.Now();
+    m_input.Drain(now);
+    m_cameraController.Reset(log.snapshot.camera, now);
+    QueueReplay(log, now, m_input);
+    m_replayEnd = now + (log.events.empty() ? 0.0 : log.events.back().time);
+    m_replaying = true;
+    m_replayStatus = std::format("replaying {} events", log.events.size());
 }
 
 void MapViewer::PopulateCommandList() {
@@ -864,6 +916,16 @@ void MapViewer::PopulateCommandList() {
     // re-recording.
     ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameIndex].Get(), m_pipelineState.Get()));
 
+    // Reloaded world data goes to the GPU before anything is drawn with it
+    for (const PendingUpload &upload : m_pendingUploads) {
+        if (upload.rebuild) {
+            CreateWorldBuffers(upload.world);
+        } else {
+            PatchWorldRooms(upload.world, upload.rooms);
+        }
+    }
+    m_pendingUploads.clear();
+
     // Set necessary state.
     m_commandList->SetPipelineState(m_pipelineState.Get());
     m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
@@ -900,11 +962,11 @@ void MapViewer::PopulateCommandList() {
     m_commandList->ClearRenderTargetView(normalRTV, clearColor, 0, nullptr);
     m_commandList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH, 1.f, 0, 0, nullptr);
     m_commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    m_commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-    m_commandList->IASetIndexBuffer(&m_indexBufferView);
+    m_commandList->IASetVertexBuffers(0, 1, &m_worldBuffers[m_mapIndex].vertexBufferView);
+    m_commandList->IASetIndexBuffer(&m_worldBuffers[m_mapIndex].indexBufferView);
 
     Draws &draw = m_worldDraws[m_mapIndex];
-    for (size_t i = 0; i < draw.drawCount; i++) {
+    for (std::uint32_t i : m_visibleRooms) {
         m_commandList->DrawIndexedInstanced((UINT)draw.indexCount[i], 1, (UINT)draw.indexStarts[i],
                                             (UINT)draw.vertexStarts[i], 0);
     }
@@ -940,21 +1002,275 @@ void MapViewer::PopulateCommandList() {
     m_commandList->SetDescriptorHeaps(1, ppHeap);
     m_commandList->SetGraphicsRootDescriptorTable(0, m_srvHeap->GetGPUDescriptorHandleForHeapStart());
     m_commandList->SetGraphicsRootShaderResourceView(1, m_iconVertices->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootShaderResourceView(2, m_iconTypes->GetGPUVirtualAddress());
-    m_commandList->SetGraphicsRootConstantBufferView(4, m_constBuffer->GetGPUVirtualAddress());
+    m_commandList->SetGraphicsRootConstantBufferView(3, m_constBuffer->GetGPUVirtualAddress());
     m_commandList->IASetVertexBuffers(0, 0, nullptr);
 
-    // TODO: Add loop to draw all icons for current area
-    auto iconDraws = m_iconDraws[m_mapIndex];
-    m_commandList->SetGraphicsRoot32BitConstant(3, (UINT)iconDraws.instanceStart, 0);
-    m_commandList->DrawInstanced(6, (UINT)iconDraws.instanceCount, 0, 0);
+    // Only the items passing the filters of the current area were written
+    m_commandList->SetGraphicsRoot32BitConstant(2, 0, 0);
+    m_commandList->DrawInstanced(6, (UINT)m_visibleItems.size(), 0, 0);
 
     // ImGui Render
     if (ImGui::Begin("Configuration", &m_uiOpen, 0)) {
         // The window is currently open
         ImGui::SliderFloat("Icon Size", &m_iconSize, 0.1f, 45.f, "%.3f", 0);
+
+        if (ImGui::CollapsingHeader("Frames")) {
+            const FrameStats &stats = m_scheduler.Stats();
+            ImGui::Checkbox("Always redraw", &m_alwaysRedraw);
+            float heartbeat = (float)m_scheduler.Settings().heartbeat;
+            if (ImGui::SliderFloat("Idle heartbeat (s)", &heartbeat, 0.f, 5.f, "%.2f")) {
+                m_scheduler.Settings().heartbeat = heartbeat;
+            }
+            ImGui::Text("%llu frames, %llu heartbeats, %.1f s idle", (unsigned long long)stats.frames,
+                        (unsigned long long)stats.heartbeats, stats.idle);
+            ImGui::Text("CPU %.2f ms, %.2f ms avg, %.2f ms worst", stats.lastFrame * 1e3,
+                        stats.AverageFrame() * 1e3, stats.worstFrame * 1e3);
+            ImGui::Text("%llu frames over the %.1f ms budget", (unsigned long long)stats.overBudget,
+                        m_scheduler.Settings().budget * 1e3);
+
+            static const char *SourceNames[] = {"window", "input", "camera", "data", "animation"};
+            std::string reasons;
+            for (int i = 0; i < 5; i++) {
+                if (stats.lastReasons >> i & 1) {
+                    reasons += reasons.empty() ? SourceNames[i] : std::string(", ") + SourceNames[i];
+                }
+            }
+            ImGui::Text("Drawn for: %s", reasons.empty() ? "heartbeat" : reasons.c_str());
+        }
+
+        if (ImGui::CollapsingHeader("Camera")) {
+            const InputLatency &latency = m_cameraController.Latency();
+            ImGui::Text("Input to matrix: %.2f ms, %.2f ms avg, %.2f ms worst", latency.last * 1e3,
+                        latency.Average() * 1e3, latency.worst * 1e3);
+            ImGui::Text("%llu steps of %.1f ms", (unsigned long long)m_cameraController.StepCount(),
+                        m_cameraController.Settings().step * 1e3);
+        }
+
+        if (ImGui::CollapsingHeader("Replay")) {
+            ImGui::BeginDisabled(m_replaying);
+            if (!m_recorder.IsRecording() && ImGui::Button("Record")) {
+                StartRecording();
+            } else if (m_recorder.IsRecording() && ImGui::Button("Stop")) {
+                StopRecording();
+            }
+            ImGui::SameLine();
+            ImGui::BeginDisabled(m_recorder.IsRecording());
+            if (ImGui::Button("Replay")) {
+                StartReplay();
+            }
+            ImGui::EndDisabled();
+            ImGui::EndDisabled();
+            if (m_recorder.IsRecording()) {
+                ImGui::Text("%zu events recorded", m_recorder.EventCount());
+            }
+            ImGui::Text("Last: %s", m_replayStatus.c_str());
+        }
+
+        ImGui::Separator();
+        bool filterChanged = false;
+        for (int i = 0; i < ItemTypeCount; i++) {
+            filterChanged |= ImGui::Checkbox(ItemTypeName(i), &m_itemFilter.types[i]);
+        }
+        filterChanged |=
+            ImGui::DragIntRange2("Rooms", &m_itemFilter.firstRoom, &m_itemFilter.lastRoom, 0.2f, 0, 99);
+        filterChanged |= ImGui::Checkbox("Hide collected", &m_itemFilter.hideCollected);
+
+        if (ImGui::CollapsingHeader("Search")) {
+            if (ImGui::InputTextWithHint("##search", "Room or item name", m_searchText,
+                                         sizeof(m_searchText))) {
+                SearchNames();
+            }
+            const bool enter = ImGui::IsItemFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter);
+            ImGui::SameLine();
+            ImGui::TextDisabled("%.1f us", m_searchTimeUs);
+            for (size_t i = 0; i < m_searchHits.size(); i++) {
+                const SearchTarget &target = m_searchTargets[m_searchHits[i].entry];
+                std::string label;
+                if (target.item != NoTarget) {
+                    label = std::format("{}, ", ItemTypeName(m_items[target.item].type));
+                }
+                const std::vector<RoomMesh> &rooms = m_worldMeshes[target.world].rooms;
+                label += target.room < rooms.size() ? RoomDisplayName(rooms[target.room].name) : "?";
+                label += std::format(" ({})##{}", WorldNames[target.world], i);
+                if (ImGui::Selectable(label.c_str()) || (enter && i == 0)) {
+                    JumpTo(target);
+                }
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Items")) {
+            filterChanged |=
+                m_itemBrowser.Draw(m_items, m_itemIndex, ImGui::GetTextLineHeightWithSpacing() * 16.f);
+            const ItemBrowserStats &stats = m_itemBrowser.Stats();
+            ImGui::Text("%u rows, sorted in %.2f ms, drawn in %.1f us", stats.rows, stats.rebuildMs,
+                        stats.drawUs);
+        }
+
+        if (filterChanged) {
+            UpdateItemFilter();
+            UpdateInventory();
+        }
+        ImGui::Text("%zu items shown (%.1f us)", m_visibleItems.size(), m_filterTimeUs);
+
+        if (ImGui::CollapsingHeader("Culling")) {
+            ImGui::Checkbox("Portal culling", &m_portalCulling);
+
+            const int cameraRoom = m_cullStats.cameraRoom;
+            const char *room =
+                cameraRoom >= 0 ? m_worldMeshes[m_mapIndex].rooms[cameraRoom].name.c_str() : "outside";
+            ImGui::Text("Camera room: %s", room);
+            ImGui::Text("%zu/%u rooms drawn, %u portals tested (%.1f us)", m_visibleRooms.size(),
+                        m_portalCullers[m_mapIndex].RoomCount(), m_cullStats.portalsTested, m_cullTimeUs);
+
+            if (ImGui::Button("Benchmark room sweep")) {
+                BenchmarkCulling();
+            }
+            if (m_cullBenchmark.views > 0) {
+                ImGui::Text("%u views: %.2f us avg, %.2f us worst, %.1f rooms drawn avg",
+                            m_cullBenchmark.views, m_cullBenchmark.averageUs, m_cullBenchmark.worstUs,
+                            m_cullBenchmark.averageRooms);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Route")) {
+            ImGui::Checkbox("All worlds", &m_routeAllWorlds);
+            int restarts = (int)m_routeOptions.restarts;
+            if (ImGui::SliderInt("Restarts", &restarts, 1, 256)) {
+                m_routeOptions.restarts = (std::uint32_t)restarts;
+            }
+            if (ImGui::Button("Plan")) {
+                PlanRoute();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear")) {
+                m_route.clear();
+            }
+
+            ImGui::Text("%zu stops, length %.0f (%.2f ms)", m_route.size(), m_routeLength, m_routeTimeMs);
+            for (size_t i = 0; i < m_route.size(); i++) {
+                const ItemRecord &item = m_items[m_route[i]];
+                ImGui::Text("%3zu. %s %02u - %s", i + 1, WorldNames[item.worldIndex - 1].c_str(),
+                            item.roomIndex, ItemTypeName(item.type));
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Measure")) {
+            // Items of the current world to walk between, picking another
+            // one drops the last measure
+            auto itemCombo = [&](const char *label, std::uint32_t &selected) {
+                if (selected != NoTarget && m_items[selected].worldIndex != m_mapIndex + 1) {
+                    selected = NoTarget;
+                }
+                std::string preview = "none";
+                if (selected != NoTarget) {
+                    const ItemRecord &item = m_items[selected];
+                    preview = std::format("{:02} - {}", item.roomIndex, ItemTypeName(item.type));
+                }
+                if (ImGui::BeginCombo(label, preview.c_str())) {
+                    for (std::uint32_t i = 0; i < m_items.size(); i++) {
+                        const ItemRecord &item = m_items[i];
+                        if (item.worldIndex != m_mapIndex + 1) {
+                            continue;
+                        }
+                        ImGui::PushID((int)i);
+                        const std::string name =
+                            std::format("{:02} - {}", item.roomIndex, ItemTypeName(item.type));
+                        if (ImGui::Selectable(name.c_str(), selected == i) && selected != i) {
+                            selected = i;
+                            m_measurePath = {};
+                            m_measured = m_measureFound = false;
+                        }
+                        ImGui::PopID();
+                    }
+                    ImGui::EndCombo();
+                }
+            };
+            itemCombo("From", m_measureFrom);
+            itemCombo("To", m_measureTo);
+            if (ImGui::Button("Measure")) {
+                MeasurePath();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear##measure")) {
+                m_measurePath = {};
+                m_measured = m_measureFound = false;
+            }
+
+            if (m_measured && m_measureWorld == m_mapIndex) {
+                if (m_measureFound) {
+                    ImGui::Text("Walked %.1f, straight %.1f (%.1f us)", m_measurePath.length,
+                                m_measureStraight, m_measureUs);
+                    if (m_measurePath.linkLength > 0.f) {
+                        ImGui::Text("%.1f of it across room links, not on a floor",
+                                    m_measurePath.linkLength);
+                    }
+                    ImGui::Text("%zu corners over %zu polygons", m_measurePath.points.size(),
+                                m_measurePath.polygons.size());
+                    ImGui::Text("Ends moved %.1f and %.1f onto the floors", m_measureMoved[0],
+                                m_measureMoved[1]);
+                } else {
+                    ImGui::TextDisabled("No path on the floors");
+                }
+            }
+            if (m_navMeshBuilt[m_mapIndex]) {
+                const NavMeshStats &stats = m_navMeshes[m_mapIndex].Stats();
+                ImGui::Text("Nav mesh: %u polygons, %u links, %u room pairs (built in %.1f ms)",
+                            stats.polygons, stats.links, stats.roomLinks, m_navBuildMs[m_mapIndex]);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Logic")) {
+            if (ImGui::Checkbox("Dim unreachable items", &m_dimUnreachable)) {
+                UpdateIconTints();
+            }
+            if (m_seedStats.seeds > 0) {
+                if (ImGui::Combo("Heatmap", &m_heatmap, HeatmapNames, IM_ARRAYSIZE(HeatmapNames))) {
+                    UpdateIconTints();
+                }
+                ImGui::SameLine();
+                ImGui::TextDisabled("%u layouts", m_seedStats.seeds);
+            } else {
+                ImGui::TextDisabled("No seed statistics, run MP-MapTools seed-stats");
+            }
+            if (ImGui::Button("Reload seed statistics")) {
+                LoadSeedStats();
+                UpdateIconTints();
+            }
+            ImGui::Text("%u/%u rooms, %u/%u items reachable (%.1f us)", m_reachability.ReachableRooms(),
+                        m_reachability.RoomCount(), m_reachability.ReachableLocations(),
+                        m_reachability.LocationCount(), m_reachTimeUs);
+
+            // Collected items count themselves, the rest is set by hand
+            for (std::uint32_t kind = 0; kind < m_reachability.KindCount(); kind++) {
+                const std::string &name = m_reachability.KindName(kind);
+                int count = (int)m_reachability.Count(kind);
+                bool changed = false;
+                if (IsItemTypeName(name)) {
+                    ImGui::Text("%s: %d collected", name.c_str(), count);
+                } else if (m_reachability.KindMaximum(kind) <= 1) {
+                    bool held = count > 0;
+                    changed = ImGui::Checkbox(name.c_str(), &held);
+                    count = held ? 1 : 0;
+                } else {
+                    const int maximum = (int)m_reachability.KindMaximum(kind);
+                    changed = ImGui::SliderInt(name.c_str(), &count, 0, maximum);
+                }
+                if (changed) {
+                    auto start = std::chrono::steady_clock::now();
+                    m_reachability.SetCount(kind, (std::uint32_t)count);
+                    auto elapsed = std::chrono::steady_clock::now() - start;
+                    m_reachTimeUs = std::chrono::duration<float, std::micro>(elapsed).count();
+                    UpdateIconTints();
+                }
+            }
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Last reload: %s (%.2f ms)", m_reloadStatus.c_str(), m_reloadLatencyMs);
     }
     ImGui::End();
+    DrawRoute();
+    DrawMeasure();
     ImGui::Render();
 
     ID3D12DescriptorHeap *ppImguiHeap[]{m_imguiHeap.Get()};
@@ -970,6 +1286,740 @@ void MapViewer::PopulateCommandList() {
     ThrowIfFailed(m_commandList->Close());
 }
 
+// Evaluate the UI filters against the items of the current area.
+void MapViewer::UpdateItemFilter() {
+    auto start = std::chrono::steady_clock::now();
+
+    m_visibleItems = ApplyItemFilter(m_itemIndex, m_itemFilter, m_mapIndex + 1);
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_filterTimeUs = std::chrono::duration<float, std::micro>(elapsed).count();
+}
+
+// Create the vertex and index buffers of a world and record their upload.
+void MapViewer::CreateWorldBuffers(UINT world) {
+    const WorldMesh &mesh = m_worldMeshes[world];
+    WorldBuffers &buffers = m_worldBuffers[world];
+
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (const MeshVertex &v : mesh.vertices) {
+        vertices.push_back({{v.position[0], v.position[1], v.position[2], 1.f},
+                            {v.normal[0], v.normal[1], v.normal[2], 0.f}});
+    }
+
+    Draws &draws = m_worldDraws[world];
+    draws = {};
+    for (const RoomMesh &room : mesh.rooms) {
+        draws.indexStarts.emplace_back(room.firstIndex);
+        draws.vertexStarts.emplace_back(room.firstVertex);
+        draws.indexCount.emplace_back(room.indexCount);
+        draws.drawCount++;
+    }
+
+    CD3DX12_RANGE readRange(0, 0); // We do not intend to read from these resources on the CPU.
+
+    const UINT vertexBufferSize = sizeof(Vertex) * (UINT)vertices.size();
+    const UINT indexBufferSize = sizeof(unsigned int) * (UINT)mesh.indices.size();
+
+    ComPtr<ID3D12Resource> uploadBuffer;
+    D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    D3D12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize + indexBufferSize);
+    ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &uploadBufferDesc,
+                                                    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                    IID_PPV_ARGS(&uploadBuffer)));
+    NAME_D3D12_OBJECT(uploadBuffer);
+
+    // TODO: Look into using placed resources for vertex/index buffers
+    D3D12_HEAP_PROPERTIES defaultHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    D3D12_RESOURCE_DESC vertexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(vertexBufferSize);
+    ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE,
+                                                    &vertexBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST,
+                                                    nullptr, IID_PPV_ARGS(&buffers.vertexBuffer)));
+    SetNameIndexed(buffers.vertexBuffer.Get(), L"m_worldVertexBuffer", world);
+
+    buffers.vertexBufferView.BufferLocation = buffers.vertexBuffer->GetGPUVirtualAddress();
+    buffers.vertexBufferView.StrideInBytes = sizeof(Vertex);
+    buffers.vertexBufferView.SizeInBytes = vertexBufferSize;
+
+    D3D12_RESOURCE_DESC indexBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(indexBufferSize);
+    ThrowIfFailed(m_device->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE,
+                                                    &indexBufferDesc, D3D12_RESOURCE_STATE_COPY_DEST,
+                                                    nullptr, IID_PPV_ARGS(&buffers.indexBuffer)));
+    SetNameIndexed(buffers.indexBuffer.Get(), L"m_worldIndexBuffer", world);
+
+    buffers.indexBufferView.BufferLocation = buffers.indexBuffer->GetGPUVirtualAddress();
+    buffers.indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+    buffers.indexBufferView.SizeInBytes = indexBufferSize;
+
+    unsigned char *pUpload;
+    ThrowIfFailed(uploadBuffer->Map(0, &readRange, (void **)&pUpload));
+    memcpy(pUpload, vertices.data(), vertexBufferSize);
+    memcpy(pUpload + vertexBufferSize, mesh.indices.data(), indexBufferSize);
+    uploadBuffer->Unmap(0, nullptr);
+
+    m_commandList->CopyBufferRegion(buffers.vertexBuffer.Get(), 0, uploadBuffer.Get(), 0, vertexBufferSize);
+    m_commandList->CopyBufferRegion(buffers.indexBuffer.Get(), 0, uploadBuffer.Get(), vertexBufferSize,
+                                    indexBufferSize);
+
+    const CD3DX12_RESOURCE_BARRIER barriers[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                             D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                             D3D12_RESOURCE_STATE_INDEX_BUFFER)};
+    m_commandList->ResourceBarrier(2, barriers);
+
+    m_uploadBuffers.push_back(uploadBuffer);
+}
+
+// Record the upload of the given rooms into the existing world buffers, the
+// rooms keep the same ranges so the draws do not change.
+void MapViewer::PatchWorldRooms(UINT world, const std::vector<std::uint32_t> &rooms) {
+    const WorldMesh &mesh = m_worldMeshes[world];
+    WorldBuffers &buffers = m_worldBuffers[world];
+
+    UINT64 uploadSize = 0;
+    for (std::uint32_t i : rooms) {
+        uploadSize += sizeof(Vertex) * mesh.rooms[i].vertexCount;
+        uploadSize += sizeof(unsigned int) * mesh.rooms[i].indexCount;
+    }
+
+    ComPtr<ID3D12Resource> uploadBuffer;
+    D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    D3D12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadSize);
+    ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &uploadBufferDesc,
+                                                    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                    IID_PPV_ARGS(&uploadBuffer)));
+    NAME_D3D12_OBJECT(uploadBuffer);
+
+    const CD3DX12_RESOURCE_BARRIER toCopy[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.vertexBuffer.Get(),
+                                             D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+                                             D3D12_RESOURCE_STATE_COPY_DEST),
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.indexBuffer.Get(), D3D12_RESOURCE_STATE_INDEX_BUFFER,
+                                             D3D12_RESOURCE_STATE_COPY_DEST)};
+    m_commandList->ResourceBarrier(2, toCopy);
+
+    CD3DX12_RANGE readRange(0, 0);
+    unsigned char *pUpload;
+    ThrowIfFailed(uploadBuffer->Map(0, &readRange, (void **)&pUpload));
+
+    UINT64 offset = 0;
+    for (std::uint32_t i : rooms) {
+        const RoomMesh &room = mesh.rooms[i];
+
+        Vertex *dst = reinterpret_cast<Vertex *>(pUpload + offset);
+        for (std::uint32_t v = 0; v < room.vertexCount; v++) {
+            const MeshVertex &src = mesh.vertices[room.firstVertex + v];
+            dst[v] = {{src.position[0], src.position[1], src.position[2], 1.f},
+                      {src.normal[0], src.normal[1], src.normal[2], 0.f}};
+        }
+        const UINT64 vertexSize = sizeof(Vertex) * room.vertexCount;
+        m_commandList->CopyBufferRegion(buffers.vertexBuffer.Get(), sizeof(Vertex) * room.firstVertex,
+                                        uploadBuffer.Get(), offset, vertexSize);
+        offset += vertexSize;
+
+        const UINT64 indexSize = sizeof(unsigned int) * room.indexCount;
+        memcpy(pUpload + offset, &mesh.indices[room.firstIndex], indexSize);
+        m_commandList->CopyBufferRegion(buffers.indexBuffer.Get(), sizeof(unsigned int) * room.firstIndex,
+                                        uploadBuffer.Get(), offset, indexSize);
+        offset += indexSize;
+    }
+    uploadBuffer->Unmap(0, nullptr);
+
+    const CD3DX12_RESOURCE_BARRIER toDraw[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.vertexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                             D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER),
+        CD3DX12_RESOURCE_BARRIER::Transition(buffers.indexBuffer.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                             D3D12_RESOURCE_STATE_INDEX_BUFFER)};
+    m_commandList->ResourceBarrier(2, toDraw);
+
+    m_uploadBuffers.push_back(uploadBuffer);
+}
+
+void MapViewer::CreateIconVertices(size_t capacity) {
+    m_iconCapacity = std::max<size_t>(capacity, 1);
+    const UINT geometrySize = sizeof(IconQuad) * (UINT)m_iconCapacity;
+
+    D3D12_HEAP_PROPERTIES uploadHeapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    D3D12_RESOURCE_DESC iconBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(geometrySize);
+
+    ThrowIfFailed(m_device->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &iconBufferDesc,
+                                                    D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                    IID_PPV_ARGS(&m_iconVertices)));
+    NAME_D3D12_OBJECT(m_iconVertices);
+}
+
+// Apply the changes made to the data folder since the last frame.
+void MapViewer::PollHotReload() {
+    if (!m_dataWatcher) {
+        return;
+    }
+
+    for (const std::string &name : m_dataWatcher->Poll()) {
+        auto start = std::chrono::steady_clock::now();
+
+        bool applied = false;
+        try {
+            if (name == "items.data" || name == "layout.json") {
+                applied = ReloadItems();
+            }
+            if (name == "room_links.txt") {
+                BuildRoomGraph();
+                m_reloadStatus = "room_links.txt";
+                applied = true;
+            }
+            if (name == "logic.txt") {
+                BuildReachability();
+                m_reloadStatus = "logic.txt";
+                applied = true;
+            }
+            for (UINT i = 0; i < WorldCount; i++) {
+                if (name == WorldNames[i] + ".obj") {
+                    applied = ReloadWorld(i);
+                }
+            }
+        } catch (const std::exception &e) {
+            // Keep what is loaded, the next save will be picked up again
+            printf("[RELOAD][ERROR] %s: %s\n", name.c_str(), e.what());
+        }
+
+        if (applied && !m_reloadInFlight) {
+            m_reloadStart = start;
+            m_reloadInFlight = true;
+            m_scheduler.MarkDirty(DirtyData);
+        }
+    }
+}
+
+// items.data, or a randomizer layout saved as data/layout.json placed on its
+// locations. A layout that can't be read leaves the plain items.
+std::vector<ItemRecord> MapViewer::LoadItems() {
+    std::vector<ItemRecord> items = LoadItemsData("data/items.data");
+    std::error_code error;
+    if (!std::filesystem::is_regular_file("data/layout.json", error)) {
+        return items;
+    }
+
+    try {
+        LayoutImporter importer(items);
+        for (UINT i = 0; i < WorldCount; i++) {
+            importer.AddWorld(i + 1, m_worldMeshes[i]);
+        }
+        const std::vector<std::uint8_t> file = ReadFile("data/layout.json");
+        std::string json(file.begin(), file.end());
+        JsonDocument document;
+        LayoutItems layout = importer.Import(json, document);
+        printf("[LAYOUT] %zu items from %u locations, %u unknown, %u other pickups\n", layout.items.size(),
+               layout.locations, layout.unknownLocations, layout.otherPickups);
+        return std::move(layout.items);
+    } catch (const std::exception &e) {
+        printf("[LAYOUT][ERROR] %s\n", e.what());
+        return items;
+    }
+}
+
+// Re-parse items.data or the layout, the index is rebuilt but collected flags
+// follow the items that are still there.
+bool MapViewer::ReloadItems() {
+    std::vector<ItemRecord> reloaded = LoadItems();
+    ItemsDiff diff = DiffItems(m_items, reloaded);
+    if (diff.Empty()) {
+        return false;
+    }
+
+    ItemIndex index;
+    index.Build(reloaded);
+    size_t removed = 0;
+    for (std::uint32_t id = 0; id < diff.newIds.size(); id++) {
+        if (diff.newIds[id] == ItemsDiff::Removed) {
+            removed++;
+        } else if (m_itemIndex.IsCollected(id)) {
+            index.SetCollected(diff.newIds[id], true);
+        }
+    }
+
+    if (reloaded.size() > m_iconCapacity) {
+        // The icon buffer may still be read by frames in flight
+        WaitForGpu();
+        CreateIconVertices(reloaded.size());
+    }
+
+    m_items = std::move(reloaded);
+    m_itemIndex = std::move(index);
+    m_itemBrowser.Invalidate();
+    m_route.clear();
+    m_measureFrom = m_measureTo = NoTarget;
+    m_measurePath = {};
+    m_measured = m_measureFound = false;
+    UpdateItemFilter();
+    LoadSeedStats();
+    BuildReachability();
+    BuildNameSearch();
+
+    m_reloadStatus = std::format("items, {} added, {} removed", diff.added.size(), removed);
+    return true;
+}
+
+// Re-parse a world OBJ, only rooms that changed are uploaded again unless the
+// room layout changed.
+bool MapViewer::ReloadWorld(UINT world) {
+    const std::string name = WorldNames[world] + ".obj";
+
+    WorldMesh reloaded = LoadWorldObj(std::format("data/{}", name).c_str());
+    if (reloaded.rooms.empty()) {
+        // Most likely caught in the middle of a write
+        return false;
+    }
+
+    WorldMeshDiff diff = DiffWorldMesh(m_worldMeshes[world], reloaded);
+    if (diff.Empty()) {
+        return false;
+    }
+
+    // Nothing in flight may use the buffers or the staging memory being replaced
+    WaitForGpu();
+    m_uploadBuffers.clear();
+
+    // A rebuild supersedes the earlier uploads of the same frame, and uploads
+    // the latest mesh anyway
+    auto pending = std::find_if(m_pendingUploads.begin(), m_pendingUploads.end(),
+                                [&](const PendingUpload &u) { return u.world == world && u.rebuild; });
+    if (diff.rebuild) {
+        std::erase_if(m_pendingUploads, [&](const PendingUpload &u) { return u.world == world; });
+    }
+    if (diff.rebuild || pending == m_pendingUploads.end()) {
+        m_pendingUploads.push_back({world, diff.rebuild, diff.dirtyRooms});
+    }
+    m_worldMeshes[world] = std::move(reloaded);
+    BuildPortals(world);
+    // Built again when next measured
+    m_navMeshBuilt[world] = false;
+    if (m_measureWorld == world) {
+        m_measurePath = {};
+        m_measured = m_measureFound = false;
+    }
+    BuildRoomGraph();
+    BuildNameSearch();
+
+    if (diff.rebuild) {
+        m_reloadStatus = std::format("{}, rebuilt", name);
+    } else {
+        m_reloadStatus = std::format("{}, {} rooms patched", name, diff.dirtyRooms.size());
+    }
+    return true;
+}
+
+// Orbit camera around the origin, the map itself is moved by the model matrix.
+// Portals are extracted once per world load, they only depend on the mesh.
+void MapViewer::BuildPortals(UINT world) {
+    m_worldPortals[world] = ExtractPortals(m_worldMeshes[world]);
+    m_portalCullers[world].Build(m_worldMeshes[world], m_worldPortals[world]);
+}
+
+// Select the rooms of the current world to draw from the camera.
+void MapViewer::CullRooms(const CameraMatrices &matrices) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (m_portalCulling) {
+        m_portalCullers[m_mapIndex].Cull(matrices.viewProjection, matrices.eye, m_visibleRooms, &m_cullStats);
+    } else {
+        m_visibleRooms.resize(m_worldMeshes[m_mapIndex].rooms.size());
+        for (std::uint32_t i = 0; i < m_visibleRooms.size(); i++) {
+            m_visibleRooms[i] = i;
+        }
+        m_cullStats = {};
+        m_cullStats.roomsVisible = (std::uint32_t)m_visibleRooms.size();
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_cullTimeUs = std::chrono::duration<float, std::micro>(elapsed).count();
+}
+
+// Time the culling along a scripted path through the current world: the
+// camera stands at the center of every room and turns around in 10 degree
+// steps.
+void MapViewer::BenchmarkCulling() {
+    const WorldMesh &mesh = m_worldMeshes[m_mapIndex];
+    PortalCuller &culler = m_portalCullers[m_mapIndex];
+
+    float aspect = (float)m_width / m_height;
+    XMMATRIX projection =
+        XMMatrixPerspectiveFovLH(XMConvertToRadians(m_camera.fov), aspect, 0.1f, 100000.0f);
+
+    CullBenchmark result{};
+    double totalUs = 0.0;
+    size_t totalRooms = 0;
+    std::vector<std::uint32_t> visible;
+
+    for (const RoomMesh &room : mesh.rooms) {
+        XMFLOAT3 eye{(room.boundsMin[0] + room.boundsMax[0]) * 0.5f,
+                     (room.boundsMin[1] + room.boundsMax[1]) * 0.5f,
+                     (room.boundsMin[2] + room.boundsMax[2]) * 0.5f};
+
+        for (int angle = 0; angle < 360; angle += 10) {
+            const float yaw = XMConvertToRadians((float)angle);
+            XMVECTOR position = XMLoadFloat3(&eye);
+            XMVECTOR direction{std::cos(yaw), 0.f, std::sin(yaw), 0.f};
+            XMMATRIX view = XMMatrixLookToLH(position, direction, XMVECTOR{0.f, 1.f, 0.f, 0.f});
+
+            XMFLOAT4X4 viewProjection;
+            XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+
+            auto start = std::chrono::steady_clock::now();
+            culler.Cull(&viewProjection.m[0][0], &eye.x, visible);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            const float us = std::chrono::duration<float, std::micro>(elapsed).count();
+            totalUs += us;
+            result.worstUs = std::max(result.worstUs, us);
+            totalRooms += visible.size();
+            result.views++;
+        }
+    }
+
+    if (result.views > 0) {
+        result.averageUs = (float)(totalUs / result.views);
+        result.averageRooms = (float)totalRooms / result.views;
+    }
+    m_cullBenchmark = result;
+
+    printf("[CULL][%s] %u views, %.2f us avg, %.2f us worst, %.1f/%zu rooms drawn avg\n",
+           WorldNames[m_mapIndex].c_str(), result.views, result.averageUs, result.worstUs,
+           result.averageRooms, mesh.rooms.size());
+}
+
+// Link the rooms of every world, the room graph is rebuilt as a whole as it
+// only takes a few milliseconds.
+void MapViewer::BuildRoomGraph() {
+    m_roomGraph = {};
+    for (UINT i = 0; i < WorldCount; i++) {
+        m_roomGraph.AddWorld(i + 1, m_worldMeshes[i], m_worldPortals[i]);
+    }
+
+    try {
+        m_roomGraph.LoadOverrides("data/room_links.txt");
+    } catch (const std::exception &e) {
+        printf("[ROUTE][ERROR] %s\n", e.what());
+    }
+    m_roomGraph.ComputeShortestPaths();
+
+    printf("[ROUTE] %zu rooms, %zu links\n", m_roomGraph.Nodes().size(), m_roomGraph.Links().size());
+    BuildReachability();
+}
+
+// Requirements from data/logic.txt over the room graph and the items, the
+// upgrades set by hand are kept by name.
+void MapViewer::BuildReachability() {
+    std::vector<std::pair<std::string, std::uint32_t>> held;
+    for (std::uint32_t kind = 0; kind < m_reachability.KindCount(); kind++) {
+        held.emplace_back(m_reachability.KindName(kind), m_reachability.Count(kind));
+    }
+
+    m_reachability.Build(m_roomGraph, m_items);
+    std::error_code error;
+    if (std::filesystem::is_regular_file("data/logic.txt", error)) {
+        try {
+            m_reachability.LoadLogic("data/logic.txt");
+        } catch (const std::exception &e) {
+            printf("[LOGIC][ERROR] %s\n", e.what());
+            m_reachability.Build(m_roomGraph, m_items);
+        }
+    }
+    for (const auto &[name, count] : held) {
+        const int kind = m_reachability.Kind(name);
+        if (kind >= 0) {
+            m_reachability.SetCount(kind, count);
+        }
+    }
+    UpdateInventory();
+
+    printf("[LOGIC] %u item kinds, %u/%u rooms reachable\n", m_reachability.KindCount(),
+           m_reachability.ReachableRooms(), m_reachability.RoomCount());
+}
+
+// Collected items go in the inventory, only a change in their counts is
+// solved again.
+void MapViewer::UpdateInventory() {
+    std::uint32_t collected[ItemTypeCount] = {};
+    for (std::uint32_t id = 0; id < m_items.size(); id++) {
+        if (m_itemIndex.IsCollected(id) && m_items[id].type < ItemTypeCount) {
+            collected[m_items[id].type]++;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool changed = false;
+    for (std::uint8_t type = 0; type < ItemTypeCount; type++) {
+        const int kind = m_reachability.Kind(ItemTypeName(type));
+        if (kind >= 0 && m_reachability.Count(kind) != collected[type]) {
+            m_reachability.SetCount(kind, collected[type]);
+            changed = true;
+        }
+    }
+    if (changed) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        m_reachTimeUs = std::chrono::duration<float, std::micro>(elapsed).count();
+    }
+    UpdateIconTints();
+}
+
+void MapViewer::UpdateIconTints() {
+    // Scaled to the highest value over the items, never reached counts as
+    // the deepest sphere
+    const bool heatmap = m_heatmap != 0 && m_seedStats.seeds > 0;
+    std::vector<float> heat(heatmap ? m_items.size() : 0);
+    float highest = 0.f;
+    for (std::uint32_t id = 0; id < heat.size(); id++) {
+        heat[id] = m_heatmap == 1 ? m_seedStats.AverageSphere(id) : m_seedStats.MajorShare(id);
+        highest = std::max(highest, heat[id]);
+    }
+
+    m_iconTints.resize(m_items.size());
+    for (std::uint32_t id = 0; id < m_items.size(); id++) {
+        std::uint32_t tint = 0xFFFFFFFFu;
+        if (heatmap) {
+            tint = HeatTint(heat[id] < 0.f ? 1.f : highest > 0.f ? heat[id] / highest : 0.f);
+        }
+        if (m_dimUnreachable && !m_reachability.LocationReachable(id)) {
+            tint = MultiplyTints(tint, UnreachableTint);
+        }
+        m_iconTints[id] = tint;
+    }
+    m_scheduler.MarkDirty(DirtyData);
+}
+
+// Every named room of every world, then every item under its type and room
+// name. Searched again so the hits point at the new entries.
+void MapViewer::BuildNameSearch() {
+    auto start = std::chrono::steady_clock::now();
+    m_nameSearch.Clear();
+    m_searchTargets.clear();
+    for (UINT world = 0; world < WorldCount; world++) {
+        const std::vector<RoomMesh> &rooms = m_worldMeshes[world].rooms;
+        for (std::uint32_t room = 0; room < rooms.size(); room++) {
+            if (rooms[room].roomIndex >= 0) {
+                m_nameSearch.Add(RoomDisplayName(rooms[room].name));
+                m_searchTargets.push_back({world, room, NoTarget});
+            }
+        }
+    }
+    for (std::uint32_t id = 0; id < m_items.size(); id++) {
+        const ItemRecord &item = m_items[id];
+        const UINT world = std::min<UINT>(item.worldIndex - 1, WorldCount - 1);
+        const std::vector<RoomMesh> &rooms = m_worldMeshes[world].rooms;
+        std::uint32_t room = 0;
+        while (room < rooms.size() && rooms[room].roomIndex != (int)item.roomIndex) {
+            room++;
+        }
+        const std::string roomName = room < rooms.size() ? RoomDisplayName(rooms[room].name) : "";
+        m_nameSearch.Add(std::format("{} {}", ItemTypeName(item.type), roomName));
+        m_searchTargets.push_back({world, room < rooms.size() ? room : NoTarget, id});
+    }
+    m_nameSearch.Build();
+    SearchNames();
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    printf("[SEARCH] %u names, %u distinct, %.2f ms\n", m_nameSearch.EntryCount(), m_nameSearch.NameCount(),
+           std::chrono::duration<float, std::milli>(elapsed).count());
+}
+
+void MapViewer::SearchNames() {
+    auto start = std::chrono::steady_clock::now();
+    m_nameSearch.Search(m_searchText, 12, m_searchHits);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_searchTimeUs = std::chrono::duration<float, std::micro>(elapsed).count();
+}
+
+// Shows the world of the target and eases the camera onto the room or item,
+// the item's row is brought up in the table
+void MapViewer::JumpTo(const SearchTarget &target) {
+    if (m_mapIndex != target.world) {
+        m_mapIndex = target.world;
+        UpdateItemFilter();
+    }
+    const std::vector<RoomMesh> &rooms = m_worldMeshes[target.world].rooms;
+    if (target.item != NoTarget) {
+        const ItemRecord &item = m_items[target.item];
+        const float position[3] = {item.x, item.z, item.y};
+        m_cameraController.Focus(position, 40.f);
+        m_itemBrowser.ScrollToItem(target.item);
+    } else if (target.room < rooms.size()) {
+        const RoomMesh &room = rooms[target.room];
+        float center[3];
+        float radius = 0.f;
+        for (int i = 0; i < 3; i++) {
+            center[i] = 0.5f * (room.boundsMin[i] + room.boundsMax[i]);
+            radius = std::max(radius, 0.5f * (room.boundsMax[i] - room.boundsMin[i]));
+        }
+        m_cameraController.Focus(center, radius);
+    }
+    m_scheduler.MarkDirty(DirtyCamera);
+}
+
+// Written by MP-MapTools seed-stats for the items in data/
+void MapViewer::LoadSeedStats() {
+    m_seedStats = SeedStats();
+    std::error_code error;
+    if (!std::filesystem::is_regular_file("cache/seed_stats.bin", error)) {
+        return;
+    }
+    try {
+        SeedStats stats = SeedStats::Decode(ReadFile("cache/seed_stats.bin"));
+        if (stats.LocationCount() != m_items.size()) {
+            printf("[SEEDS] Statistics for %u items, %zu loaded, ignored\n", stats.LocationCount(),
+                   m_items.size());
+            return;
+        }
+        m_seedStats = std::move(stats);
+        printf("[SEEDS] Statistics of %u layouts\n", m_seedStats.seeds);
+    } catch (const std::exception &e) {
+        printf("[SEEDS][ERROR] %s\n", e.what());
+    }
+}
+
+// Order the items passing the type and collected filters, in the current
+// world or in all of them.
+void MapViewer::PlanRoute() {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::uint32_t> ids;
+    if (m_routeAllWorlds) {
+        std::optional<ItemQuery> query;
+        for (int i = 0; i < ItemTypeCount; i++) {
+            if (m_itemFilter.types[i]) {
+                query = query ? (*query | ItemQuery::Type(i)) : ItemQuery::Type(i);
+            }
+        }
+        if (query && m_itemFilter.hideCollected) {
+            query = *query & !ItemQuery::Collected();
+        }
+        if (query) {
+            ids = query->Evaluate(m_itemIndex).ToVector();
+        }
+    } else {
+        ids = m_visibleItems;
+    }
+
+    const std::vector<float> costs = ItemTravelCosts(m_roomGraph, m_items, ids);
+    const Tour tour = SolveTour(costs, (std::uint32_t)ids.size(), m_routeOptions);
+
+    m_route.clear();
+    for (std::uint32_t stop : tour.order) {
+        m_route.push_back(ids[stop]);
+    }
+    m_routeLength = tour.length;
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    m_routeTimeMs = std::chrono::duration<float, std::milli>(elapsed).count();
+}
+
+// Draw the legs of the route inside the current world over the scene.
+void MapViewer::DrawRoute() {
+    const XMMATRIX mvp = XMLoadFloat4x4(&m_mvp);
+    ImDrawList *drawList = ImGui::GetBackgroundDrawList();
+
+    auto project = [&](const ItemRecord &item, ImVec2 &screen) {
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(XMVECTOR{item.x, item.z, item.y, 1.f}, mvp));
+        if (clip.w <= 0.f) {
+            return false;
+        }
+        screen.x = (clip.x / clip.w * 0.5f + 0.5f) * m_width;
+        screen.y = (0.5f - clip.y / clip.w * 0.5f) * m_height;
+        return true;
+    };
+
+    for (size_t i = 1; i < m_route.size(); i++) {
+        const ItemRecord &from = m_items[m_route[i - 1]];
+        const ItemRecord &to = m_items[m_route[i]];
+        if (from.worldIndex != m_mapIndex + 1 || to.worldIndex != m_mapIndex + 1) {
+            continue;
+        }
+
+        ImVec2 a, b;
+        if (project(from, a) && project(to, b)) {
+            drawList->AddLine(a, b, IM_COL32(255, 200, 40, 255), 2.f);
+        }
+    }
+}
+
+// Walk between the two measured items over the floors of their world. Items
+// float over the floor they are on, so they are looked for in a tall box.
+void MapViewer::MeasurePath() {
+    m_measurePath = {};
+    m_measured = m_measureFound = false;
+    if (m_measureFrom == NoTarget || m_measureTo == NoTarget) {
+        return;
+    }
+    const ItemRecord &from = m_items[m_measureFrom];
+    const ItemRecord &to = m_items[m_measureTo];
+    if (from.worldIndex != to.worldIndex || from.worldIndex == 0) {
+        return;
+    }
+    const UINT world = from.worldIndex - 1;
+
+    if (!m_navMeshBuilt[world]) {
+        auto start = std::chrono::steady_clock::now();
+        m_navMeshes[world].Build(m_worldMeshes[world], m_worldPortals[world], NavMeshConfig{}, &m_threadPool);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        m_navBuildMs[world] = std::chrono::duration<float, std::milli>(elapsed).count();
+        m_navMeshBuilt[world] = true;
+    }
+
+    const float start[3] = {from.x, from.z, from.y};
+    const float end[3] = {to.x, to.z, to.y};
+    const float extents[3] = {4.f, 8.f, 4.f};
+    NavQuery query(m_navMeshes[world]);
+    auto begin = std::chrono::steady_clock::now();
+    m_measureFound = query.FindPath(start, end, extents, m_measurePath);
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    m_measureUs = std::chrono::duration<float, std::micro>(elapsed).count();
+    m_measureWorld = world;
+    m_measured = true;
+    if (!m_measureFound) {
+        return;
+    }
+
+    // Items float over the floor or off it, the path runs between where they
+    // were moved onto it
+    auto distance = [](const float *a, const float *b) {
+        const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    };
+    const float *first = m_measurePath.points.front().data();
+    const float *last = m_measurePath.points.back().data();
+    m_measureStraight = distance(first, last);
+    m_measureMoved[0] = distance(start, first);
+    m_measureMoved[1] = distance(end, last);
+}
+
+void MapViewer::DrawMeasure() {
+    if (!m_measureFound || m_measureWorld != m_mapIndex) {
+        return;
+    }
+    const XMMATRIX mvp = XMLoadFloat4x4(&m_mvp);
+    ImDrawList *drawList = ImGui::GetBackgroundDrawList();
+
+    auto project = [&](const std::array<float, 3> &point, ImVec2 &screen) {
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector4Transform(XMVECTOR{point[0], point[1], point[2], 1.f}, mvp));
+        if (clip.w <= 0.f) {
+            return false;
+        }
+        screen.x = (clip.x / clip.w * 0.5f + 0.5f) * m_width;
+        screen.y = (0.5f - clip.y / clip.w * 0.5f) * m_height;
+        return true;
+    };
+
+    for (size_t i = 1; i < m_measurePath.points.size(); i++) {
+        ImVec2 a, b;
+        if (project(m_measurePath.points[i - 1], a) && project(m_measurePath.points[i], b)) {
+            drawList->AddLine(a, b, IM_COL32(80, 220, 255, 255), 2.f);
+        }
+    }
+}
+
 // Wait for pending GPU work to complete.
 void MapViewer::WaitForGpu() {
     // Schedule a Signal command in the queue.
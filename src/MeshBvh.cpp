@@ -0,0 +1,369 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+const std::uint32_t Bins = 12;
+
+float Dot(const float *a, const float *b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+void Sub(const float *a, const float *b, float *out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+void Cross(const float *a, const float *b, float *out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+struct Box {
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+    void Grow(const float *point) {
+        for (int k = 0; k < 3; k++) {
+            min[k] = std::min(min[k], point[k]);
+            max[k] = std::max(max[k], point[k]);
+        }
+    }
+    void Grow(const Box &box) {
+        if (box.min[0] > box.max[0]) {
+            return;
+        }
+        Grow(box.min);
+        Grow(box.max);
+    }
+    float HalfArea() const {
+        if (min[0] > max[0]) {
+            return 0.f;
+        }
+        const float x = max[0] - min[0], y = max[1] - min[1], z = max[2] - min[2];
+        return x * y + y * z + z * x;
+    }
+};
+
+// Squared distance from point to the box, 0 inside
+float BoxDistanceSquared(const float *boundsMin, const float *boundsMax, const float *point) {
+    float sum = 0.f;
+    for (int k = 0; k < 3; k++) {
+        const float d = std::max({boundsMin[k] - point[k], 0.f, point[k] - boundsMax[k]});
+        sum += d * d;
+    }
+    return sum;
+}
+
+// Real-Time Collision Detection 5.1.5, by the Voronoi region of the point
+void ClosestOnTriangle(const float *a, const float *b, const float *c, const float *p, float *out) {
+    float ab[3], ac[3], ap[3];
+    Sub(b, a, ab);
+    Sub(c, a, ac);
+    Sub(p, a, ap);
+    const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+    if (d1 <= 0.f && d2 <= 0.f) {
+        std::copy(a, a + 3, out);
+        return;
+    }
+    float bp[3];
+    Sub(p, b, bp);
+    const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+    if (d3 >= 0.f && d4 <= d3) {
+        std::copy(b, b + 3, out);
+        return;
+    }
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+        const float v = d1 / (d1 - d3);
+        for (int k = 0; k < 3; k++) {
+            out[k] = a[k] + v * ab[k];
+        }
+        return;
+    }
+    float cp[3];
+    Sub(p, c, cp);
+    const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+    if (d6 >= 0.f && d5 <= d6) {
+        std::copy(c, c + 3, out);
+        return;
+    }
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+        const float w = d2 / (d2 - d6);
+        for (int k = 0; k < 3; k++) {
+            out[k] = a[k] + w * ac[k];
+        }
+        return;
+    }
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) {
+        const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        for (int k = 0; k < 3; k++) {
+            out[k] = b[k] + w * (c[k] - b[k]);
+        }
+        return;
+    }
+    const float denom = 1.f / (va + vb + vc);
+    const float v = vb * denom, w = vc * denom;
+    for (int k = 0; k < 3; k++) {
+        out[k] = a[k] + ab[k] * v + ac[k] * w;
+    }
+}
+
+float DistanceSquared(const float *a, const float *b) {
+    float d[3];
+    Sub(a, b, d);
+    return Dot(d, d);
+}
+} // namespace
+
+void MeshBvh::Build(const WorldMesh &mesh) {
+    m_nodes.clear();
+    m_triangles.clear();
+    m_depth = 0;
+    for (std::uint32_t room = 0; room < mesh.rooms.size(); room++) {
+        const RoomMesh &roomMesh = mesh.rooms[room];
+        for (std::uint32_t i = 0; i + 2 < roomMesh.indexCount; i += 3) {
+            const std::uint32_t *index = &mesh.indices[roomMesh.firstIndex + i];
+            Triangle triangle;
+            std::copy_n(mesh.vertices[roomMesh.firstVertex + index[0]].position, 3, triangle.a);
+            std::copy_n(mesh.vertices[roomMesh.firstVertex + index[1]].position, 3, triangle.b);
+            std::copy_n(mesh.vertices[roomMesh.firstVertex + index[2]].position, 3, triangle.c);
+            float ab[3], ac[3], normal[3];
+            Sub(triangle.b, triangle.a, ab);
+            Sub(triangle.c, triangle.a, ac);
+            Cross(ab, ac, normal);
+            if (Dot(normal, normal) <= 0.f) {
+                continue;
+            }
+            triangle.triangle = (roomMesh.firstIndex + i) / 3;
+            triangle.room = room;
+            m_triangles.push_back(triangle);
+        }
+    }
+    if (m_triangles.empty()) {
+        return;
+    }
+
+    std::vector<float> centroids(m_triangles.size() * 3);
+    for (size_t t = 0; t < m_triangles.size(); t++) {
+        for (int k = 0; k < 3; k++) {
+            centroids[t * 3 + k] = (m_triangles[t].a[k] + m_triangles[t].b[k] + m_triangles[t].c[k]) / 3.f;
+        }
+    }
+    // Triangles are sorted through an order, centroids stay where they are
+    std::vector<std::uint32_t> order(m_triangles.size());
+    for (std::uint32_t t = 0; t < order.size(); t++) {
+        order[t] = t;
+    }
+
+    struct Task {
+        std::uint32_t node;
+        std::uint32_t first;
+        std::uint32_t count;
+        std::uint32_t depth;
+    };
+    std::vector<Task> tasks = {{0, 0, (std::uint32_t)m_triangles.size(), 0}};
+    m_nodes.reserve(m_triangles.size() / LeafSize * 2 + 1);
+    m_nodes.push_back({});
+    while (!tasks.empty()) {
+        const Task task = tasks.back();
+        tasks.pop_back();
+        m_depth = std::max(m_depth, task.depth);
+
+        Box bounds, centers;
+        for (std::uint32_t i = task.first; i < task.first + task.count; i++) {
+            const Triangle &triangle = m_triangles[order[i]];
+            bounds.Grow(triangle.a);
+            bounds.Grow(triangle.b);
+            bounds.Grow(triangle.c);
+            centers.Grow(&centroids[order[i] * 3]);
+        }
+        Node &node = m_nodes[task.node];
+        std::copy_n(bounds.min, 3, node.boundsMin);
+        std::copy_n(bounds.max, 3, node.boundsMax);
+        node.first = task.first;
+        node.count = task.count;
+        if (task.count <= LeafSize || task.depth >= MaxDepth) {
+            continue;
+        }
+
+        // Cheapest of the bin boundaries on every axis
+        int bestAxis = -1;
+        std::uint32_t bestSplit = 0;
+        float bestCost = FLT_MAX;
+        for (int axis = 0; axis < 3; axis++) {
+            const float extent = centers.max[axis] - centers.min[axis];
+            if (extent <= 0.f) {
+                continue;
+            }
+            Box binBounds[Bins];
+            std::uint32_t binCounts[Bins] = {};
+            for (std::uint32_t i = task.first; i < task.first + task.count; i++) {
+                const float center = centroids[order[i] * 3 + axis];
+                const std::uint32_t bin =
+                    std::min(Bins - 1, (std::uint32_t)((center - centers.min[axis]) * Bins / extent));
+                const Triangle &triangle = m_triangles[order[i]];
+                binBounds[bin].Grow(triangle.a);
+                binBounds[bin].Grow(triangle.b);
+                binBounds[bin].Grow(triangle.c);
+                binCounts[bin]++;
+            }
+            float rightCost[Bins] = {};
+            Box right;
+            std::uint32_t rightCount = 0;
+            for (std::uint32_t bin = Bins - 1; bin > 0; bin--) {
+                right.Grow(binBounds[bin]);
+                rightCount += binCounts[bin];
+                rightCost[bin] = rightCount ? right.HalfArea() * rightCount : 0.f;
+            }
+            Box left;
+            std::uint32_t leftCount = 0;
+            for (std::uint32_t split = 1; split < Bins; split++) {
+                left.Grow(binBounds[split - 1]);
+                leftCount += binCounts[split - 1];
+                const float cost = (leftCount ? left.HalfArea() * leftCount : 0.f) + rightCost[split];
+                if (leftCount && leftCount < task.count && cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        std::uint32_t *begin = order.data() + task.first;
+        std::uint32_t *end = begin + task.count;
+        std::uint32_t *middle;
+        if (bestAxis >= 0) {
+            const float extent = centers.max[bestAxis] - centers.min[bestAxis];
+            middle = std::partition(begin, end, [&](std::uint32_t t) {
+                const float center = centroids[t * 3 + bestAxis];
+                return std::min(Bins - 1, (std::uint32_t)((center - centers.min[bestAxis]) * Bins / extent)) <
+                       bestSplit;
+            });
+        } else {
+            // Every centroid in one point, any halves will do
+            middle = begin + task.count / 2;
+        }
+
+        const std::uint32_t children = (std::uint32_t)m_nodes.size();
+        const std::uint32_t leftCount = (std::uint32_t)(middle - begin);
+        m_nodes[task.node].first = children;
+        m_nodes[task.node].count = 0;
+        m_nodes.push_back({});
+        m_nodes.push_back({});
+        tasks.push_back({children, task.first, leftCount, task.depth + 1});
+        tasks.push_back({children + 1, task.first + leftCount, task.count - leftCount, task.depth + 1});
+    }
+
+    std::vector<Triangle> sorted(m_triangles.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = m_triangles[order[i]];
+    }
+    m_triangles.swap(sorted);
+}
+
+void MeshBvh::Fill(const Triangle &triangle, const float position[3], float distanceSquared,
+                   SurfaceHit &hit) {
+    std::copy_n(position, 3, hit.position);
+    float ab[3], ac[3];
+    Sub(triangle.b, triangle.a, ab);
+    Sub(triangle.c, triangle.a, ac);
+    Cross(ab, ac, hit.normal);
+    const float length = std::sqrt(Dot(hit.normal, hit.normal));
+    for (int k = 0; k < 3; k++) {
+        hit.normal[k] /= length;
+    }
+    hit.distance = std::sqrt(distanceSquared);
+    hit.triangle = triangle.triangle;
+    hit.room = triangle.room;
+}
+
+bool MeshBvh::Closest(const float point[3], float maxDistance, SurfaceHit &hit) const {
+    if (m_nodes.empty()) {
+        return false;
+    }
+
+    float bestSquared = maxDistance * maxDistance;
+    const Triangle *best = nullptr;
+    float bestPosition[3];
+
+    // Nearer child on top, a node is only opened while it may hold something
+    // closer than the best so far
+    struct Entry {
+        std::uint32_t node;
+        float distanceSquared;
+    };
+    Entry stack[MaxDepth + 2];
+    std::uint32_t size = 0;
+    stack[size++] = {0, BoxDistanceSquared(m_nodes[0].boundsMin, m_nodes[0].boundsMax, point)};
+    while (size) {
+        const Entry entry = stack[--size];
+        if (entry.distanceSquared > bestSquared) {
+            continue;
+        }
+        const Node &node = m_nodes[entry.node];
+        if (node.count) {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++) {
+                const Triangle &triangle = m_triangles[i];
+                float position[3];
+                ClosestOnTriangle(triangle.a, triangle.b, triangle.c, point, position);
+                const float distanceSquared = DistanceSquared(position, point);
+                if (distanceSquared <= bestSquared) {
+                    bestSquared = distanceSquared;
+                    best = &triangle;
+                    std::copy_n(position, 3, bestPosition);
+                }
+            }
+            continue;
+        }
+
+        const Node &left = m_nodes[node.first];
+        const Node &right = m_nodes[node.first + 1];
+        const float toLeft = BoxDistanceSquared(left.boundsMin, left.boundsMax, point);
+        const float toRight = BoxDistanceSquared(right.boundsMin, right.boundsMax, point);
+        const bool leftFirst = toLeft <= toRight;
+        const Entry nearer = leftFirst ? Entry{node.first, toLeft} : Entry{node.first + 1, toRight};
+        const Entry farther = leftFirst ? Entry{node.first + 1, toRight} : Entry{node.first, toLeft};
+        if (farther.distanceSquared <= bestSquared) {
+            stack[size++] = farther;
+        }
+        if (nearer.distanceSquared <= bestSquared) {
+            stack[size++] = nearer;
+        }
+    }
+
+    if (!best) {
+        return false;
+    }
+    Fill(*best, bestPosition, bestSquared, hit);
+    return true;
+}
+
+bool MeshBvh::ClosestBruteForce(const float point[3], float maxDistance, SurfaceHit &hit) const {
+    float bestSquared = maxDistance * maxDistance;
+    const Triangle *best = nullptr;
+    float bestPosition[3];
+    for (const Triangle &triangle : m_triangles) {
+        float position[3];
+        ClosestOnTriangle(triangle.a, triangle.b, triangle.c, point, position);
+        const float distanceSquared = DistanceSquared(position, point);
+        if (distanceSquared <= bestSquared) {
+            bestSquared = distanceSquared;
+            best = &triangle;
+            std::copy_n(position, 3, bestPosition);
+        }
+    }
+    if (!best) {
+        return false;
+    }
+    Fill(*best, bestPosition, bestSquared, hit);
+    return true;
+}
+
+size_t MeshBvh::MemoryBytes() const {
+    return m_nodes.capacity() * sizeof(Node) + m_triangles.capacity() * sizeof(Triangle);
+}
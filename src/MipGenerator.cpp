@@ -0,0 +1,337 @@
+#include "MipGenerator.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIP_SSE 1
+#endif
+
+namespace {
+const double Pi = 3.14159265358979323846;
+
+// One RGBA texel, the filters work on whole texels at a time
+#ifdef MIP_SSE
+using Float4 = __m128;
+
+Float4 Load4(const float *p) { return _mm_loadu_ps(p); }
+void Store4(float *p, Float4 v) { _mm_storeu_ps(p, v); }
+Float4 Zero4() { return _mm_setzero_ps(); }
+Float4 MulAdd4(Float4 acc, Float4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+#else
+struct Float4 {
+    float v[4];
+};
+
+Float4 Load4(const float *p) { return {p[0], p[1], p[2], p[3]}; }
+void Store4(float *p, Float4 v) { memcpy(p, v.v, sizeof(v.v)); }
+Float4 Zero4() { return {}; }
+Float4 MulAdd4(Float4 acc, Float4 v, float w) {
+    for (int i = 0; i < 4; i++) {
+        acc.v[i] += v.v[i] * w;
+    }
+    return acc;
+}
+#endif
+
+float SrgbToLinear(float v) { return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f); }
+
+struct SrgbTables {
+    static const int Buckets = 4096;
+
+    float toLinear[256];
+    // Linear value halfway between two codes, in sRGB space
+    float thresholds[256];
+    // Code at the start of each linear bucket
+    std::uint8_t bucketCode[Buckets + 1];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            toLinear[i] = SrgbToLinear(i / 255.f);
+            thresholds[i] = i < 255 ? SrgbToLinear((i + 0.5f) / 255.f) : 2.f;
+        }
+        int code = 0;
+        for (int i = 0; i <= Buckets; i++) {
+            while (i / (float)Buckets >= thresholds[code]) {
+                code++;
+            }
+            bucketCode[i] = (std::uint8_t)code;
+        }
+    }
+
+    // Exact rounding in sRGB space, the bucket gets close and the thresholds
+    // settle it. linear is in [0, 1].
+    std::uint8_t Encode(float linear) const {
+        int code = bucketCode[(int)(linear * Buckets)];
+        while (linear >= thresholds[code]) {
+            code++;
+        }
+        return (std::uint8_t)code;
+    }
+};
+
+const SrgbTables &Tables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// Linear RGBA, colors premultiplied unless the chain is made without
+struct Plane {
+    int width;
+    int height;
+    std::vector<float> texels;
+};
+
+Plane ToLinear(const DecodedImage &image, const MipDesc &desc) {
+    const SrgbTables &tables = Tables();
+    Plane plane{image.width, image.height, std::vector<float>((size_t)image.width * image.height * 4)};
+    for (size_t i = 0; i < plane.texels.size(); i += 4) {
+        const float alpha = image.pixels[i + 3] / 255.f;
+        const float weight = desc.premultiply ? alpha : 1.f;
+        for (int c = 0; c < 3; c++) {
+            const std::uint8_t v = image.pixels[i + c];
+            plane.texels[i + c] = (desc.srgb ? tables.toLinear[v] : v / 255.f) * weight;
+        }
+        plane.texels[i + 3] = alpha;
+    }
+    return plane;
+}
+
+DecodedImage ToImage(const Plane &plane, const MipDesc &desc) {
+    const SrgbTables &tables = Tables();
+    DecodedImage image{plane.width, plane.height, std::vector<std::uint8_t>(plane.texels.size())};
+    for (size_t i = 0; i < plane.texels.size(); i += 4) {
+        // Negative lobes of the filter can leave values out of range
+        const float alpha = std::clamp(plane.texels[i + 3], 0.f, 1.f);
+        const float unpremultiply = !desc.premultiply ? 1.f : alpha > 0.f ? 1.f / alpha : 0.f;
+        for (int c = 0; c < 3; c++) {
+            const float v = std::clamp(plane.texels[i + c] * unpremultiply, 0.f, 1.f);
+            image.pixels[i + c] = desc.srgb ? tables.Encode(v) : (std::uint8_t)(v * 255.f + 0.5f);
+        }
+        image.pixels[i + 3] = (std::uint8_t)(alpha * 255.f + 0.5f);
+    }
+    return image;
+}
+
+double BesselI0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Taps of every child texel along one axis, edges are clamped
+struct Taps {
+    std::vector<std::uint32_t> first;
+    std::vector<std::uint32_t> indices;
+    std::vector<float> weights;
+};
+
+Taps BuildTaps(int parentSize, int childSize, MipFilter filter) {
+    const double scale = (double)parentSize / childSize;
+    // In child texels
+    const double radius = filter == MipFilter::Box ? 0.5 : 2.0;
+    const double beta = 4.0;
+
+    Taps taps;
+    for (int x = 0; x < childSize; x++) {
+        taps.first.push_back((std::uint32_t)taps.indices.size());
+
+        const double center = (x + 0.5) * scale;
+        const int begin = (int)std::floor(center - radius * scale);
+        const int end = (int)std::ceil(center + radius * scale);
+        double total = 0.0;
+        const size_t start = taps.weights.size();
+        for (int i = begin; i < end; i++) {
+            double weight;
+            if (filter == MipFilter::Box) {
+                // Coverage of texel i by the child texel
+                const double overlap = std::min(i + 1.0, center + 0.5 * scale) -
+                                       std::max((double)i, center - 0.5 * scale);
+                weight = std::max(0.0, overlap);
+            } else {
+                const double t = (i + 0.5 - center) / scale;
+                const double r = t / radius;
+                if (std::abs(r) >= 1.0) {
+                    continue;
+                }
+                const double sinc = t == 0.0 ? 1.0 : std::sin(Pi * t) / (Pi * t);
+                weight = sinc * BesselI0(beta * std::sqrt(1.0 - r * r)) / BesselI0(beta);
+            }
+            if (weight == 0.0) {
+                continue;
+            }
+            taps.indices.push_back((std::uint32_t)std::clamp(i, 0, parentSize - 1));
+            taps.weights.push_back((float)weight);
+            total += weight;
+        }
+        for (size_t i = start; i < taps.weights.size(); i++) {
+            taps.weights[i] = (float)(taps.weights[i] / total);
+        }
+    }
+    taps.first.push_back((std::uint32_t)taps.indices.size());
+    return taps;
+}
+
+// Separable, rows first then columns
+Plane Downsample(const Plane &parent, MipFilter filter) {
+    const int width = std::max(1, parent.width / 2);
+    const int height = std::max(1, parent.height / 2);
+    const Taps tapsX = BuildTaps(parent.width, width, filter);
+    const Taps tapsY = BuildTaps(parent.height, height, filter);
+
+    std::vector<float> rows((size_t)width * parent.height * 4);
+    for (int y = 0; y < parent.height; y++) {
+        const float *src = &parent.texels[(size_t)y * parent.width * 4];
+        float *dst = &rows[(size_t)y * width * 4];
+        for (int x = 0; x < width; x++) {
+            Float4 acc = Zero4();
+            for (std::uint32_t t = tapsX.first[x]; t < tapsX.first[x + 1]; t++) {
+                acc = MulAdd4(acc, Load4(src + tapsX.indices[t] * 4), tapsX.weights[t]);
+            }
+            Store4(dst + x * 4, acc);
+        }
+    }
+
+    Plane child{width, height, std::vector<float>((size_t)width * height * 4)};
+    for (int y = 0; y < height; y++) {
+        float *dst = &child.texels[(size_t)y * width * 4];
+        for (std::uint32_t t = tapsY.first[y]; t < tapsY.first[y + 1]; t++) {
+            const float *src = &rows[(size_t)tapsY.indices[t] * width * 4];
+            const float weight = tapsY.weights[t];
+            for (int x = 0; x < width; x++) {
+                Store4(dst + x * 4, MulAdd4(Load4(dst + x * 4), Load4(src + x * 4), weight));
+            }
+        }
+    }
+    return child;
+}
+
+const std::uint32_t ChainMagic = 0x5350494D; // "MIPS"
+// Bump when the filters change, older cache entries are then ignored
+const std::uint32_t ChainVersion = 1;
+
+void Write32(std::vector<std::uint8_t> &out, std::uint32_t v) {
+    const std::uint8_t bytes[4] = {(std::uint8_t)v, (std::uint8_t)(v >> 8), (std::uint8_t)(v >> 16),
+                                   (std::uint8_t)(v >> 24)};
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+std::uint32_t Read32(const std::vector<std::uint8_t> &data, size_t &offset) {
+    if (offset + 4 > data.size()) {
+        throw std::runtime_error("Truncated mip chain");
+    }
+    const std::uint8_t *p = &data[offset];
+    offset += 4;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((std::uint32_t)p[3] << 24);
+}
+} // namespace
+
+int FullMipCount(int width, int height) {
+    int count = 1;
+    for (int size = std::max(width, height); size > 1; size >>= 1) {
+        count++;
+    }
+    return count;
+}
+
+std::vector<DecodedImage> GenerateMipChain(const DecodedImage &image, const MipDesc &desc) {
+    const int fullCount = FullMipCount(image.width, image.height);
+    const int levelCount = desc.levelCount > 0 ? std::min(desc.levelCount, fullCount) : fullCount;
+
+    std::vector<DecodedImage> chain{image};
+    Plane plane = ToLinear(image, desc);
+    for (int level = 1; level < levelCount; level++) {
+        plane = Downsample(plane, desc.filter);
+        chain.push_back(ToImage(plane, desc));
+    }
+    return chain;
+}
+
+std::vector<std::vector<DecodedImage>> GenerateMipChains(const std::vector<DecodedImage> &images,
+                                                         const MipDesc &desc, ThreadPool &pool) {
+    std::vector<std::vector<DecodedImage>> chains(images.size());
+    pool.ParallelFor((std::uint32_t)images.size(),
+                     [&](std::uint32_t i) { chains[i] = GenerateMipChain(images[i], desc); });
+    return chains;
+}
+
+std::vector<std::uint8_t> SerializeMipChain(const std::vector<DecodedImage> &chain) {
+    std::vector<std::uint8_t> data;
+    Write32(data, ChainMagic);
+    Write32(data, (std::uint32_t)chain.size());
+    for (const DecodedImage &level : chain) {
+        Write32(data, (std::uint32_t)level.width);
+        Write32(data, (std::uint32_t)level.height);
+        data.insert(data.end(), level.pixels.begin(), level.pixels.end());
+    }
+    return data;
+}
+
+std::vector<DecodedImage> DeserializeMipChain(const std::vector<std::uint8_t> &data) {
+    size_t offset = 0;
+    if (Read32(data, offset) != ChainMagic) {
+        throw std::runtime_error("Not a mip chain");
+    }
+
+    const std::uint32_t count = Read32(data, offset);
+    if (count > 32) {
+        throw std::runtime_error("Bad mip chain level count");
+    }
+
+    std::vector<DecodedImage> chain(count);
+    for (DecodedImage &level : chain) {
+        level.width = (int)Read32(data, offset);
+        level.height = (int)Read32(data, offset);
+        // Sizes are checked before they are multiplied, a damaged -1 by -1
+        // would wrap around to 4 bytes
+        if (level.width <= 0 || level.height <= 0 || level.width > 1 << 15 || level.height > 1 << 15) {
+            throw std::runtime_error("Bad mip chain level size");
+        }
+        const size_t size = (size_t)level.width * level.height * 4;
+        if (offset + size > data.size()) {
+            throw std::runtime_error("Truncated mip chain");
+        }
+        level.pixels.assign(data.begin() + offset, data.begin() + offset + size);
+        offset += size;
+    }
+    return chain;
+}
+
+std::vector<DecodedImage> CachedMipChain(const AssetCache &cache, const DecodedImage &image,
+                                         const MipDesc &desc, bool *cacheHit) {
+    const std::uint32_t settings[] = {ChainVersion, (std::uint32_t)image.width, (std::uint32_t)image.height,
+                                      (std::uint32_t)desc.filter, (std::uint32_t)desc.levelCount,
+                                      (std::uint32_t)desc.srgb, (std::uint32_t)desc.premultiply};
+    const std::uint64_t key =
+        HashBytes(image.pixels.data(), image.pixels.size(), HashBytes(settings, sizeof(settings)));
+
+    if (std::optional<std::vector<std::uint8_t>> data = cache.Load(key)) {
+        try {
+            std::vector<DecodedImage> chain = DeserializeMipChain(*data);
+            if (cacheHit) {
+                *cacheHit = true;
+            }
+            return chain;
+        } catch (const std::runtime_error &) {
+            // Damaged entry, overwritten below
+        }
+    }
+
+    std::vector<DecodedImage> chain = GenerateMipChain(image, desc);
+    try {
+        cache.Store(key, SerializeMipChain(chain));
+    } catch (const std::runtime_error &) {
+    }
+    if (cacheHit) {
+        *cacheHit = false;
+    }
+    return chain;
+}
@@ -0,0 +1,284 @@
+#include "NameSearch.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// Space, a to z, 0 to 9
+const std::uint32_t Symbols = 37;
+const std::uint32_t TrigramSpace = Symbols * Symbols * Symbols;
+
+std::uint32_t Symbol(char c) {
+    if (c >= 'a' && c <= 'z') {
+        return 1 + (c - 'a');
+    }
+    if (c >= '0' && c <= '9') {
+        return 27 + (c - '0');
+    }
+    return 0;
+}
+
+// Sorted and unique into out
+void Trigrams(std::string_view normalized, std::vector<std::uint32_t> &out) {
+    out.clear();
+    size_t start = 0;
+    while (start < normalized.size()) {
+        size_t end = normalized.find(' ', start);
+        end = end == std::string_view::npos ? normalized.size() : end;
+        // "  word " without building it
+        std::uint32_t window = 0;
+        for (size_t i = start; i <= end; i++) {
+            window = (window * Symbols + (i < end ? Symbol(normalized[i]) : 0)) % TrigramSpace;
+            out.push_back(window);
+        }
+        start = end + 1;
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// Whether the ascending list holds name, galloping from at, which is left on
+// the first entry not below name. Names are looked for in ascending order.
+bool Gallop(const std::uint32_t *&at, const std::uint32_t *end, std::uint32_t name) {
+    size_t step = 1;
+    while (step < (size_t)(end - at) && at[step] < name) {
+        at += step;
+        step *= 2;
+    }
+    at = std::lower_bound(at, at + std::min(step + 1, (size_t)(end - at)), name);
+    return at != end && *at == name;
+}
+} // namespace
+
+std::string NameSearch::Normalize(std::string_view name) {
+    std::string normalized;
+    normalized.reserve(name.size());
+    for (char c : name) {
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            normalized += c;
+        } else if (!normalized.empty() && normalized.back() != ' ') {
+            normalized += ' ';
+        }
+    }
+    if (!normalized.empty() && normalized.back() == ' ') {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+std::uint32_t NameSearch::Intern(const std::string &normalized) {
+    const std::uint64_t hash = std::hash<std::string>()(normalized);
+    const auto found = m_nameOf.find(hash);
+    if (found != m_nameOf.end() &&
+        std::string_view(m_pool).substr(m_names[found->second].offset, m_names[found->second].length) ==
+            normalized) {
+        return found->second;
+    }
+
+    const std::uint32_t id = (std::uint32_t)m_names.size();
+    m_names.push_back({(std::uint32_t)m_pool.size(), (std::uint32_t)normalized.size()});
+    m_pool += normalized;
+    // A colliding name is stored again, only the first one is shared
+    m_nameOf.emplace(hash, id);
+    return id;
+}
+
+std::uint32_t NameSearch::Add(std::string_view name) {
+    m_entryName.push_back(Intern(Normalize(name)));
+    return (std::uint32_t)m_entryName.size() - 1;
+}
+
+void NameSearch::Build() {
+    std::vector<std::uint32_t> trigrams;
+    m_postingStart.assign(TrigramSpace + 1, 0);
+    m_tally.assign(m_names.size(), {});
+    for (std::uint32_t id = 0; id < m_names.size(); id++) {
+        Trigrams(std::string_view(m_pool).substr(m_names[id].offset, m_names[id].length), trigrams);
+        m_tally[id].trigrams = (std::uint8_t)std::min<size_t>(trigrams.size(), 0xFF);
+        for (std::uint32_t trigram : trigrams) {
+            m_postingStart[trigram + 1]++;
+        }
+    }
+    for (std::uint32_t t = 0; t < TrigramSpace; t++) {
+        m_postingStart[t + 1] += m_postingStart[t];
+    }
+    m_postings.resize(m_postingStart[TrigramSpace]);
+    std::vector<std::uint32_t> fill(m_postingStart.begin(), m_postingStart.end() - 1);
+    for (std::uint32_t id = 0; id < m_names.size(); id++) {
+        Trigrams(std::string_view(m_pool).substr(m_names[id].offset, m_names[id].length), trigrams);
+        for (std::uint32_t trigram : trigrams) {
+            m_postings[fill[trigram]++] = id;
+        }
+    }
+
+    m_entryStart.assign(m_names.size() + 1, 0);
+    for (std::uint32_t name : m_entryName) {
+        m_entryStart[name + 1]++;
+    }
+    for (size_t i = 0; i < m_names.size(); i++) {
+        m_entryStart[i + 1] += m_entryStart[i];
+    }
+    m_entries.resize(m_entryName.size());
+    fill.assign(m_entryStart.begin(), m_entryStart.end() - 1);
+    for (std::uint32_t entry = 0; entry < m_entryName.size(); entry++) {
+        m_entries[fill[m_entryName[entry]]++] = entry;
+    }
+}
+
+void NameSearch::Clear() { *this = NameSearch(); }
+
+std::string_view NameSearch::Name(std::uint32_t entry) const {
+    const Span &span = m_names[m_entryName[entry]];
+    return std::string_view(m_pool).substr(span.offset, span.length);
+}
+
+size_t NameSearch::MemoryBytes() const {
+    return m_pool.capacity() + m_names.capacity() * sizeof(Span) + m_entryName.capacity() * 4 +
+           m_nameOf.size() * 32 + m_postingStart.capacity() * 4 + m_postings.capacity() * 4 +
+           m_tally.capacity() * sizeof(Tally) + m_entryStart.capacity() * 4 + m_entries.capacity() * 4;
+}
+
+void NameSearch::Search(std::string_view query, std::uint32_t maxHits, std::vector<NameHit> &hits) {
+    hits.clear();
+    Trigrams(Normalize(query.substr(0, MaxQueryLength)), m_query);
+    if (m_query.empty() || m_postingStart.empty() || maxHits == 0) {
+        return;
+    }
+
+    auto length = [this](std::uint32_t trigram) {
+        return m_postingStart[trigram + 1] - m_postingStart[trigram];
+    };
+    std::sort(m_query.begin(), m_query.end(),
+              [&](std::uint32_t a, std::uint32_t b) { return length(a) < length(b); });
+    const std::uint32_t total = (std::uint32_t)m_query.size();
+    const std::uint32_t needed = std::max(
+        {1u, (std::uint32_t)(total * MinShared + 0.999f), total > MaxMissing ? total - MaxMissing : 0});
+
+    auto score = [total](std::uint32_t shared, const Tally &tally) {
+        return 0.5f * ((float)shared / total + (float)shared / std::max<std::uint32_t>(tally.trigrams, 1));
+    };
+
+    // A hit holds at least one of the total - needed + 1 rarest trigrams.
+    // Past those, candidates are dropped when they can't make needed with the
+    // lists left, or can't beat maxHits names that already are hits (the bar
+    // from the previous pass, the counts only grow). The longest lists are
+    // then only searched for the few left.
+    //
+    // The work is bounded by taking no more than MaxCandidates names: once
+    // that many are in, the rest of the rare lists only count. Only the
+    // MaxCounted with the best score they could still reach go on, sorted so
+    // every list after is intersected with them by a search that only moves
+    // forward.
+    //
+    // A query so common its rarest list holds more than MaxCandidates names
+    // starts from the names holding every one of its rarest lists instead,
+    // as many as it takes to get under.
+    m_candidates.clear();
+    std::uint32_t seeded = 0;
+    if (length(m_query[0]) > MaxCandidates) {
+        const std::uint32_t *first = m_postings.data() + m_postingStart[m_query[0]];
+        m_candidates.assign(first, first + length(m_query[0]));
+        for (seeded = 1; seeded < total && m_candidates.size() > MaxCandidates; seeded++) {
+            const std::uint32_t *at = m_postings.data() + m_postingStart[m_query[seeded]];
+            const std::uint32_t *end = at + length(m_query[seeded]);
+            std::erase_if(m_candidates, [&](std::uint32_t name) { return !Gallop(at, end, name); });
+        }
+        m_candidates.resize(std::min<size_t>(m_candidates.size(), MaxCandidates));
+        for (std::uint32_t name : m_candidates) {
+            m_tally[name].shared = (std::uint8_t)seeded;
+        }
+    }
+    float bar = 0.f;
+    bool sorted = false;
+    for (std::uint32_t i = seeded; i < total; i++) {
+        const std::uint32_t *begin = m_postings.data() + m_postingStart[m_query[i]];
+        const std::uint32_t *end = begin + length(m_query[i]);
+        if (i <= total - needed && m_candidates.size() < MaxCandidates) {
+            for (const std::uint32_t *name = begin; name < end; name++) {
+                Tally &tally = m_tally[*name];
+                if (tally.shared) {
+                    tally.shared++;
+                } else if (m_candidates.size() < MaxCandidates) {
+                    tally.shared = 1;
+                    m_candidates.push_back(*name);
+                }
+            }
+            continue;
+        }
+        if (!sorted) {
+            auto bound = [&](std::uint32_t name) {
+                const Tally &tally = m_tally[name];
+                const std::uint32_t most = std::max<std::uint32_t>(tally.trigrams, 1);
+                return score(std::min(tally.shared + total - i, most), tally);
+            };
+            if (m_candidates.size() > MaxCounted) {
+                std::nth_element(m_candidates.begin(), m_candidates.begin() + MaxCounted, m_candidates.end(),
+                                 [&](std::uint32_t a, std::uint32_t b) { return bound(a) > bound(b); });
+                for (size_t c = MaxCounted; c < m_candidates.size(); c++) {
+                    m_tally[m_candidates[c]].shared = 0;
+                }
+                m_candidates.resize(MaxCounted);
+            }
+            std::sort(m_candidates.begin(), m_candidates.end());
+            sorted = true;
+        }
+
+        // Nothing can be dropped on the first of these
+        const std::uint32_t left = total - i;
+        if (i > total - needed + 1) {
+            m_bounds.clear();
+            std::erase_if(m_candidates, [&](std::uint32_t name) {
+                Tally &tally = m_tally[name];
+                if (tally.shared + left < needed || score(tally.shared + left, tally) < bar) {
+                    tally.shared = 0;
+                    return true;
+                }
+                if (tally.shared >= needed) {
+                    m_bounds.push_back(score(tally.shared, tally));
+                }
+                return false;
+            });
+            if (m_bounds.size() >= maxHits) {
+                std::nth_element(m_bounds.begin(), m_bounds.begin() + (maxHits - 1), m_bounds.end(),
+                                 std::greater<float>());
+                bar = std::max(bar, m_bounds[maxHits - 1]);
+            }
+        }
+
+        if (m_candidates.size() * 16 < (size_t)(end - begin)) {
+            const std::uint32_t *at = begin;
+            for (std::uint32_t name : m_candidates) {
+                m_tally[name].shared += Gallop(at, end, name) ? 1 : 0;
+            }
+        } else {
+            for (const std::uint32_t *name = begin; name < end; name++) {
+                m_tally[*name].shared += m_tally[*name].shared ? 1 : 0;
+            }
+        }
+    }
+
+    m_scored.clear();
+    for (std::uint32_t name : m_candidates) {
+        Tally &tally = m_tally[name];
+        if (tally.shared >= needed) {
+            m_scored.push_back({name, score(tally.shared, tally)});
+        }
+        tally.shared = 0;
+    }
+    auto better = [](const NameHit &a, const NameHit &b) {
+        return a.score != b.score ? a.score > b.score : a.entry < b.entry;
+    };
+    const size_t kept = std::min<size_t>(maxHits, m_scored.size());
+    std::partial_sort(m_scored.begin(), m_scored.begin() + kept, m_scored.end(), better);
+
+    // Names were interned in the order of their first entry
+    for (size_t i = 0; i < kept && hits.size() < maxHits; i++) {
+        const std::uint32_t name = m_scored[i].entry;
+        for (std::uint32_t e = m_entryStart[name]; e < m_entryStart[name + 1] && hits.size() < maxHits; e++) {
+            hits.push_back({m_entries[e], m_scored[i].score});
+        }
+    }
+}
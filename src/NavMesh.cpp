@@ -0,0 +1,1862 @@
+#include "NavMesh.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+const std::uint32_t NoSpan = 0xFFFFFFFF;
+const std::uint8_t NoConnection = 0xFF;
+// Regions of the border a tile voxelizes around itself
+const std::uint16_t BorderRegion = 0x8000;
+const std::uint16_t MixedNeighbors = 0xFFFF;
+const int MaxSpanHeight = 0xFFFF;
+// Neighbor columns in the order -x, +z, +x, -z, so (dir + 1) & 3 turns clockwise
+const int DirX[4] = {-1, 0, 1, 0};
+const int DirZ[4] = {0, 1, 0, -1};
+// Below 1 keeps the estimate from overshooting, positions are portal midpoints
+const float HeuristicScale = 0.999f;
+
+// Solid space of a column, in cells up from the bottom of the world
+struct SolidSpan {
+    std::uint16_t bottom;
+    std::uint16_t top;
+    bool walkable;
+    std::uint32_t next;
+};
+
+// Open space over the top of a solid span
+struct FloorSpan {
+    std::uint16_t y;
+    std::uint16_t height;
+    std::uint16_t region;
+    bool walkable;
+    // Index among the floor spans of the neighbor column
+    std::uint8_t connections[4];
+};
+
+struct TileResult {
+    // x, y, z in cells, x and z from the corner of the tile
+    std::vector<int> vertices;
+    std::vector<std::array<std::uint32_t, NavMesh::MaxVertices>> polygons;
+    std::vector<std::uint32_t> counts;
+    std::uint64_t floorCells = 0;
+    std::uint32_t regions = 0;
+    std::uint32_t failedOutlines = 0;
+};
+
+// Twice the signed area of abc in the x-z plane, negative when c is right of ab
+int Area2(const int *a, const int *b, const int *c) {
+    return (b[0] - a[0]) * (c[2] - a[2]) - (c[0] - a[0]) * (b[2] - a[2]);
+}
+
+bool Left(const int *a, const int *b, const int *c) { return Area2(a, b, c) < 0; }
+bool LeftOn(const int *a, const int *b, const int *c) { return Area2(a, b, c) <= 0; }
+bool Collinear(const int *a, const int *b, const int *c) { return Area2(a, b, c) == 0; }
+bool SameXZ(const int *a, const int *b) { return a[0] == b[0] && a[2] == b[2]; }
+
+bool IntersectProper(const int *a, const int *b, const int *c, const int *d) {
+    if (Collinear(a, b, c) || Collinear(a, b, d) || Collinear(c, d, a) || Collinear(c, d, b)) {
+        return false;
+    }
+    return (Left(a, b, c) != Left(a, b, d)) && (Left(c, d, a) != Left(c, d, b));
+}
+
+// c on the segment ab
+bool Between(const int *a, const int *b, const int *c) {
+    if (!Collinear(a, b, c)) {
+        return false;
+    }
+    if (a[0] != b[0]) {
+        return (a[0] <= c[0] && c[0] <= b[0]) || (a[0] >= c[0] && c[0] >= b[0]);
+    }
+    return (a[2] <= c[2] && c[2] <= b[2]) || (a[2] >= c[2] && c[2] >= b[2]);
+}
+
+bool Intersect(const int *a, const int *b, const int *c, const int *d) {
+    return IntersectProper(a, b, c, d) || Between(a, b, c) || Between(a, b, d) || Between(c, d, a) ||
+           Between(c, d, b);
+}
+
+// Ear clipping of a clockwise outline with x, y, z, _ vertices, always cutting
+// the shortest diagonal. Returns false when it got stuck, tris then holds the
+// triangles cut so far.
+class Triangulator {
+public:
+    bool Run(const std::vector<int> &vertices, std::vector<std::uint32_t> &tris) {
+        m_vertices = vertices.data();
+        const std::uint32_t count = (std::uint32_t)vertices.size() / 4;
+        m_indices.resize(count);
+        std::iota(m_indices.begin(), m_indices.end(), 0u);
+        m_ear.assign(count, false);
+        tris.clear();
+
+        std::uint32_t n = count;
+        for (std::uint32_t i = 0; i < n; i++) {
+            m_ear[(i + 1) % n] = Diagonal(i, (i + 2) % n, n);
+        }
+        while (n > 3) {
+            int shortest = -1;
+            int shortestLength = 0;
+            for (std::uint32_t i = 0; i < n; i++) {
+                const std::uint32_t i1 = (i + 1) % n;
+                if (m_ear[i1]) {
+                    const int *p0 = At(i), *p2 = At((i1 + 1) % n);
+                    const int dx = p2[0] - p0[0], dz = p2[2] - p0[2];
+                    const int length = dx * dx + dz * dz;
+                    if (shortest < 0 || length < shortestLength) {
+                        shortest = (int)i;
+                        shortestLength = length;
+                    }
+                }
+            }
+            if (shortest < 0) {
+                return false;
+            }
+
+            std::uint32_t i = (std::uint32_t)shortest;
+            std::uint32_t i1 = (i + 1) % n;
+            tris.insert(tris.end(), {m_indices[i], m_indices[i1], m_indices[(i1 + 1) % n]});
+            m_indices.erase(m_indices.begin() + i1);
+            m_ear.erase(m_ear.begin() + i1);
+            n--;
+            if (i1 >= n) {
+                i1 = 0;
+                i = n - 1;
+            }
+            m_ear[i] = Diagonal((i + n - 1) % n, i1, n);
+            m_ear[i1] = Diagonal(i, (i1 + 1) % n, n);
+        }
+        tris.insert(tris.end(), {m_indices[0], m_indices[1], m_indices[2]});
+        return true;
+    }
+
+private:
+    const int *At(std::uint32_t i) const { return &m_vertices[m_indices[i] * 4]; }
+
+    // ij doesn't cross an edge of the outline
+    bool Clear(std::uint32_t i, std::uint32_t j, std::uint32_t n) const {
+        const int *d0 = At(i), *d1 = At(j);
+        for (std::uint32_t k = 0; k < n; k++) {
+            const std::uint32_t k1 = (k + 1) % n;
+            if (k == i || k1 == i || k == j || k1 == j) {
+                continue;
+            }
+            const int *p0 = At(k), *p1 = At(k1);
+            if (SameXZ(d0, p0) || SameXZ(d1, p0) || SameXZ(d0, p1) || SameXZ(d1, p1)) {
+                continue;
+            }
+            if (Intersect(d0, d1, p0, p1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // ij starts into the inside of the outline at i
+    bool InCone(std::uint32_t i, std::uint32_t j, std::uint32_t n) const {
+        const int *pi = At(i), *pj = At(j), *next = At((i + 1) % n), *previous = At((i + n - 1) % n);
+        if (LeftOn(previous, pi, next)) {
+            return Left(pi, pj, previous) && Left(pj, pi, next);
+        }
+        return !(LeftOn(pi, pj, next) && LeftOn(pj, pi, previous));
+    }
+
+    bool Diagonal(std::uint32_t i, std::uint32_t j, std::uint32_t n) const {
+        return InCone(i, j, n) && Clear(i, j, n);
+    }
+
+    const int *m_vertices = nullptr;
+    std::vector<std::uint32_t> m_indices;
+    std::vector<bool> m_ear;
+};
+
+// Splits a convex polygon where coordinate axis equals at, the part below
+// into below and the rest into above
+void DividePolygon(const float *in, int count, float *below, int &belowCount, float *above, int &aboveCount,
+                   float at, int axis) {
+    float d[12];
+    for (int i = 0; i < count; i++) {
+        d[i] = at - in[i * 3 + axis];
+    }
+    belowCount = aboveCount = 0;
+    for (int i = 0, j = count - 1; i < count; j = i, i++) {
+        const bool inJ = d[j] >= 0.f, inI = d[i] >= 0.f;
+        if (inJ != inI) {
+            const float s = d[j] / (d[j] - d[i]);
+            for (int k = 0; k < 3; k++) {
+                const float v = in[j * 3 + k] + (in[i * 3 + k] - in[j * 3 + k]) * s;
+                below[belowCount * 3 + k] = above[aboveCount * 3 + k] = v;
+            }
+            belowCount++;
+            aboveCount++;
+            if (d[i] > 0.f) {
+                std::copy_n(&in[i * 3], 3, &below[belowCount++ * 3]);
+            } else if (d[i] < 0.f) {
+                std::copy_n(&in[i * 3], 3, &above[aboveCount++ * 3]);
+            }
+        } else {
+            if (d[i] >= 0.f) {
+                std::copy_n(&in[i * 3], 3, &below[belowCount++ * 3]);
+                if (d[i] != 0.f) {
+                    continue;
+                }
+            }
+            std::copy_n(&in[i * 3], 3, &above[aboveCount++ * 3]);
+        }
+    }
+}
+
+float DistanceToSegmentSquared(int x, int z, int ax, int az, int bx, int bz) {
+    const float px = (float)(bx - ax), pz = (float)(bz - az);
+    const float dx = (float)(x - ax), dz = (float)(z - az);
+    const float lengthSquared = px * px + pz * pz;
+    float t = lengthSquared > 0.f ? (px * dx + pz * dz) / lengthSquared : 0.f;
+    t = std::clamp(t, 0.f, 1.f);
+    const float ex = ax + t * px - x, ez = az + t * pz - z;
+    return ex * ex + ez * ez;
+}
+
+// Polygons a and b of the same outline merged over their longest shared
+// edge, when the result is convex and small enough. Returns the squared
+// length of that edge, -1 when they can't be merged.
+int MergeValue(const std::array<std::uint32_t, NavMesh::MaxVertices> &a, std::uint32_t countA,
+               const std::array<std::uint32_t, NavMesh::MaxVertices> &b, std::uint32_t countB,
+               const std::vector<int> &vertices, std::uint32_t &edgeA, std::uint32_t &edgeB) {
+    if (countA + countB - 2 > NavMesh::MaxVertices) {
+        return -1;
+    }
+    edgeA = edgeB = NavMesh::MaxVertices;
+    for (std::uint32_t i = 0; i < countA && edgeA == NavMesh::MaxVertices; i++) {
+        const std::uint32_t nextA = a[(i + 1) % countA];
+        const std::uint32_t a0 = std::min(a[i], nextA), a1 = std::max(a[i], nextA);
+        for (std::uint32_t j = 0; j < countB; j++) {
+            const std::uint32_t nextB = b[(j + 1) % countB];
+            const std::uint32_t b0 = std::min(b[j], nextB), b1 = std::max(b[j], nextB);
+            if (a0 == b0 && a1 == b1) {
+                edgeA = i;
+                edgeB = j;
+                break;
+            }
+        }
+    }
+    if (edgeA == NavMesh::MaxVertices) {
+        return -1;
+    }
+
+    auto vertex = [&](std::uint32_t index) { return &vertices[index * 3]; };
+    if (!Left(vertex(a[(edgeA + countA - 1) % countA]), vertex(a[edgeA]), vertex(b[(edgeB + 2) % countB])) ||
+        !Left(vertex(b[(edgeB + countB - 1) % countB]), vertex(b[edgeB]), vertex(a[(edgeA + 2) % countA]))) {
+        return -1;
+    }
+    const int *p0 = vertex(a[edgeA]), *p1 = vertex(a[(edgeA + 1) % countA]);
+    const int dx = p0[0] - p1[0], dz = p0[2] - p1[2];
+    return dx * dx + dz * dz;
+}
+
+// One tile from triangles to polygons. Keeps its scratch between tiles, one
+// per thread.
+class TileBuilder {
+public:
+    void Build(const NavMeshConfig &config, const float origin[3], std::uint32_t tileX, std::uint32_t tileZ,
+               const std::vector<float> &triangles, const std::vector<std::uint8_t> &walkable,
+               const std::vector<std::uint32_t> &list, TileResult &result) {
+        m_cellSize = config.cellSize;
+        m_cellHeight = config.cellHeight;
+        m_walkableHeight = (int)std::ceil(config.agentHeight / config.cellHeight);
+        m_walkableClimb = (int)std::floor(config.agentClimb / config.cellHeight);
+        m_radius = (int)std::ceil(config.agentRadius / config.cellSize);
+        m_tileSize = (int)config.tileSize;
+        m_border = m_radius + 3;
+        m_width = m_tileSize + 2 * m_border;
+        m_origin[0] = origin[0] + ((int)tileX * m_tileSize - m_border) * m_cellSize;
+        m_origin[1] = origin[1];
+        m_origin[2] = origin[2] + ((int)tileZ * m_tileSize - m_border) * m_cellSize;
+
+        m_columns.assign((size_t)m_width * m_width, NoSpan);
+        m_solids.clear();
+        m_freeSolid = NoSpan;
+        for (std::uint32_t t : list) {
+            Rasterize(&triangles[t * 9], &triangles[t * 9 + 3], &triangles[t * 9 + 6], walkable[t] != 0);
+        }
+        FilterSpans();
+        BuildFloor();
+        if (m_radius > 0) {
+            Erode();
+        }
+        BuildRegions();
+        FilterRegions(config.minRegionCells);
+        for (int z = m_border; z < m_width - m_border; z++) {
+            for (int x = m_border; x < m_width - m_border; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    result.floorCells += m_floors[i].walkable ? 1 : 0;
+                }
+            }
+        }
+        BuildContours(config.maxEdgeError / config.cellSize, result);
+        BuildPolygons(result);
+    }
+
+private:
+    void Rasterize(const float *v0, const float *v1, const float *v2, bool walkable) {
+        const float extent = m_width * m_cellSize;
+        float low[3], high[3];
+        for (int k = 0; k < 3; k++) {
+            low[k] = std::min({v0[k], v1[k], v2[k]});
+            high[k] = std::max({v0[k], v1[k], v2[k]});
+        }
+        if (high[0] < m_origin[0] || low[0] > m_origin[0] + extent || high[2] < m_origin[2] ||
+            low[2] > m_origin[2] + extent) {
+            return;
+        }
+
+        float buffer[4 * 36];
+        float *in = buffer, *row = buffer + 36, *cell = buffer + 72, *rest = buffer + 108;
+        std::copy_n(v0, 3, in);
+        std::copy_n(v1, 3, in + 3);
+        std::copy_n(v2, 3, in + 6);
+        int inCount = 3;
+        const int z0 = std::clamp((int)std::floor((low[2] - m_origin[2]) / m_cellSize), -1, m_width - 1);
+        const int z1 = std::clamp((int)std::floor((high[2] - m_origin[2]) / m_cellSize), 0, m_width - 1);
+        for (int z = z0; z <= z1; z++) {
+            int rowCount, restCount;
+            DividePolygon(in, inCount, row, rowCount, cell, restCount, m_origin[2] + (z + 1) * m_cellSize, 2);
+            std::swap(in, cell);
+            inCount = restCount;
+            if (rowCount < 3 || z < 0) {
+                continue;
+            }
+
+            float minX = row[0], maxX = row[0];
+            for (int i = 1; i < rowCount; i++) {
+                minX = std::min(minX, row[i * 3]);
+                maxX = std::max(maxX, row[i * 3]);
+            }
+            int x0 = (int)std::floor((minX - m_origin[0]) / m_cellSize);
+            int x1 = (int)std::floor((maxX - m_origin[0]) / m_cellSize);
+            if (x1 < 0 || x0 >= m_width) {
+                continue;
+            }
+            x0 = std::clamp(x0, -1, m_width - 1);
+            x1 = std::clamp(x1, 0, m_width - 1);
+            for (int x = x0; x <= x1; x++) {
+                int cellCount, rowRest;
+                const float right = m_origin[0] + (x + 1) * m_cellSize;
+                DividePolygon(row, rowCount, cell, cellCount, rest, rowRest, right, 0);
+                std::swap(row, rest);
+                rowCount = rowRest;
+                if (cellCount < 3 || x < 0) {
+                    continue;
+                }
+
+                float bottom = cell[1], top = cell[1];
+                for (int i = 1; i < cellCount; i++) {
+                    bottom = std::min(bottom, cell[i * 3 + 1]);
+                    top = std::max(top, cell[i * 3 + 1]);
+                }
+                bottom -= m_origin[1];
+                top -= m_origin[1];
+                if (top < 0.f || bottom > MaxSpanHeight * m_cellHeight) {
+                    continue;
+                }
+                const int spanBottom =
+                    std::clamp((int)std::floor(bottom / m_cellHeight), 0, MaxSpanHeight - 1);
+                const int spanTop =
+                    std::clamp((int)std::ceil(top / m_cellHeight), spanBottom + 1, MaxSpanHeight);
+                AddSpan(x, z, spanBottom, spanTop, walkable);
+            }
+        }
+    }
+
+    // Merges the new span with the ones it touches, keeping the column sorted
+    void AddSpan(int x, int z, int bottom, int top, bool walkable) {
+        std::uint32_t &head = m_columns[x + z * m_width];
+        SolidSpan span{(std::uint16_t)bottom, (std::uint16_t)top, walkable, NoSpan};
+        std::uint32_t previous = NoSpan, current = head;
+        while (current != NoSpan) {
+            SolidSpan &other = m_solids[current];
+            if (other.bottom > span.top) {
+                break;
+            }
+            if (other.top < span.bottom) {
+                previous = current;
+                current = other.next;
+                continue;
+            }
+            span.bottom = std::min(span.bottom, other.bottom);
+            span.top = std::max(span.top, other.top);
+            // Surfaces closer than a step count as one
+            if (std::abs((int)span.top - (int)other.top) <= m_walkableClimb) {
+                span.walkable |= other.walkable;
+            }
+            const std::uint32_t next = other.next;
+            other.next = m_freeSolid;
+            m_freeSolid = current;
+            if (previous != NoSpan) {
+                m_solids[previous].next = next;
+            } else {
+                head = next;
+            }
+            current = next;
+        }
+
+        std::uint32_t index = m_freeSolid;
+        if (index != NoSpan) {
+            m_freeSolid = m_solids[index].next;
+        } else {
+            index = (std::uint32_t)m_solids.size();
+            m_solids.emplace_back();
+        }
+        span.next = current;
+        m_solids[index] = span;
+        if (previous != NoSpan) {
+            m_solids[previous].next = index;
+        } else {
+            head = index;
+        }
+    }
+
+    // Ledges lower than a step can be walked over, floors without head room
+    // can't be walked on
+    void FilterSpans() {
+        for (std::uint32_t head : m_columns) {
+            bool previousWalkable = false, previousFlag = false;
+            int previousTop = 0;
+            for (std::uint32_t s = head; s != NoSpan; s = m_solids[s].next) {
+                SolidSpan &span = m_solids[s];
+                const bool walkable = span.walkable;
+                if (!walkable && previousWalkable &&
+                    std::abs((int)span.top - previousTop) <= m_walkableClimb) {
+                    span.walkable = previousFlag;
+                }
+                previousWalkable = walkable;
+                previousFlag = span.walkable;
+                previousTop = span.top;
+            }
+        }
+        for (std::uint32_t head : m_columns) {
+            for (std::uint32_t s = head; s != NoSpan; s = m_solids[s].next) {
+                SolidSpan &span = m_solids[s];
+                const int ceiling = span.next != NoSpan ? m_solids[span.next].bottom : MaxSpanHeight;
+                if (ceiling - span.top < m_walkableHeight) {
+                    span.walkable = false;
+                }
+            }
+        }
+    }
+
+    void BuildFloor() {
+        const size_t cells = (size_t)m_width * m_width;
+        m_cellStart.assign(cells + 1, 0);
+        m_floors.clear();
+        for (size_t c = 0; c < cells; c++) {
+            m_cellStart[c] = (std::uint32_t)m_floors.size();
+            for (std::uint32_t s = m_columns[c]; s != NoSpan; s = m_solids[s].next) {
+                const SolidSpan &span = m_solids[s];
+                if (!span.walkable) {
+                    continue;
+                }
+                const int ceiling = span.next != NoSpan ? m_solids[span.next].bottom : MaxSpanHeight;
+                FloorSpan floor{span.top, (std::uint16_t)std::min(ceiling - span.top, 0xFFFF), 0, true, {}};
+                std::fill_n(floor.connections, 4, NoConnection);
+                m_floors.push_back(floor);
+            }
+        }
+        m_cellStart[cells] = (std::uint32_t)m_floors.size();
+
+        // Neighbors with enough head room in common, a step apart at most
+        for (int z = 0; z < m_width; z++) {
+            for (int x = 0; x < m_width; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    FloorSpan &floor = m_floors[i];
+                    for (int dir = 0; dir < 4; dir++) {
+                        const int nx = x + DirX[dir], nz = z + DirZ[dir];
+                        if (nx < 0 || nz < 0 || nx >= m_width || nz >= m_width) {
+                            continue;
+                        }
+                        const std::uint32_t first = FirstFloor(nx, nz);
+                        for (std::uint32_t k = first; k < EndFloor(nx, nz); k++) {
+                            const FloorSpan &other = m_floors[k];
+                            const int bottom = std::max(floor.y, other.y);
+                            const int top = std::min(floor.y + floor.height, other.y + other.height);
+                            if (top - bottom >= m_walkableHeight &&
+                                std::abs(other.y - floor.y) <= m_walkableClimb) {
+                                if (k - first < NoConnection) {
+                                    floor.connections[dir] = (std::uint8_t)(k - first);
+                                }
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Floor spans of column x, z are FirstFloor up to EndFloor
+    std::uint32_t FirstFloor(int x, int z) const { return m_cellStart[x + z * m_width]; }
+    std::uint32_t EndFloor(int x, int z) const { return m_cellStart[x + z * m_width + 1]; }
+
+    std::uint32_t Neighbor(int x, int z, const FloorSpan &floor, int dir) const {
+        return FirstFloor(x + DirX[dir], z + DirZ[dir]) + floor.connections[dir];
+    }
+
+    // Chamfer distance to the edge of the floor, 2 per cell and 3 per
+    // diagonal, floor closer than the radius is dropped
+    void Erode() {
+        m_distance.assign(m_floors.size(), 0xFF);
+        for (size_t i = 0; i < m_floors.size(); i++) {
+            int connected = 0;
+            for (int dir = 0; dir < 4; dir++) {
+                connected += m_floors[i].connections[dir] != NoConnection ? 1 : 0;
+            }
+            if (connected != 4) {
+                m_distance[i] = 0;
+            }
+        }
+
+        auto relax = [&](std::uint32_t i, std::uint32_t from, int step) {
+            m_distance[i] = (std::uint8_t)std::min<int>(m_distance[i],
+                                                        std::min(m_distance[from] + step, 0xFF));
+        };
+        // Passes from the -x -z corner and back, each with its two diagonals
+        auto pass = [&](int x, int z, int straightA, int diagonalA, int straightB, int diagonalB) {
+            for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                const FloorSpan &floor = m_floors[i];
+                for (const auto &[straight, diagonal] : {std::make_pair(straightA, diagonalA),
+                                                         std::make_pair(straightB, diagonalB)}) {
+                    if (floor.connections[straight] == NoConnection) {
+                        continue;
+                    }
+                    const std::uint32_t a = Neighbor(x, z, floor, straight);
+                    relax(i, a, 2);
+                    if (m_floors[a].connections[diagonal] != NoConnection) {
+                        relax(i, Neighbor(x + DirX[straight], z + DirZ[straight], m_floors[a], diagonal), 3);
+                    }
+                }
+            }
+        };
+        for (int z = 0; z < m_width; z++) {
+            for (int x = 0; x < m_width; x++) {
+                pass(x, z, 0, 3, 3, 2);
+            }
+        }
+        for (int z = m_width - 1; z >= 0; z--) {
+            for (int x = m_width - 1; x >= 0; x--) {
+                pass(x, z, 2, 1, 1, 0);
+            }
+        }
+        for (size_t i = 0; i < m_floors.size(); i++) {
+            if (m_distance[i] < m_radius * 2) {
+                m_floors[i].walkable = false;
+            }
+        }
+    }
+
+    // Monotone partitioning: every row is swept into runs, a run continues
+    // the region above it when it is the only run touching that region
+    void BuildRegions() {
+        std::uint16_t id = 1;
+        auto paint = [&](int x0, int x1, int z0, int z1) {
+            for (int z = z0; z < z1; z++) {
+                for (int x = x0; x < x1; x++) {
+                    for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                        m_floors[i].region = m_floors[i].walkable ? (std::uint16_t)(id | BorderRegion) : 0;
+                    }
+                }
+            }
+            id++;
+        };
+        for (FloorSpan &floor : m_floors) {
+            floor.region = 0;
+        }
+        paint(0, m_border, 0, m_width);
+        paint(m_width - m_border, m_width, 0, m_width);
+        paint(0, m_width, 0, m_border);
+        paint(0, m_width, m_width - m_border, m_width);
+
+        for (int z = m_border; z < m_width - m_border; z++) {
+            m_regionRuns.assign(id + 1, 0);
+            m_sweeps.assign(1, {});
+            for (int x = m_border; x < m_width - m_border; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    FloorSpan &floor = m_floors[i];
+                    if (!floor.walkable) {
+                        continue;
+                    }
+                    std::uint16_t sweep = 0;
+                    if (floor.connections[0] != NoConnection) {
+                        const FloorSpan &left = m_floors[Neighbor(x, z, floor, 0)];
+                        if (left.walkable && !(left.region & BorderRegion)) {
+                            sweep = left.region;
+                        }
+                    }
+                    if (!sweep) {
+                        if (m_sweeps.size() >= BorderRegion) {
+                            throw std::runtime_error("Too many runs in a row of a navigation tile");
+                        }
+                        sweep = (std::uint16_t)m_sweeps.size();
+                        m_sweeps.push_back({0, 0, 0});
+                    }
+                    if (floor.connections[3] != NoConnection) {
+                        const FloorSpan &above = m_floors[Neighbor(x, z, floor, 3)];
+                        if (above.region && !(above.region & BorderRegion) && above.walkable) {
+                            SweepRun &run = m_sweeps[sweep];
+                            if (!run.neighbor || run.neighbor == above.region) {
+                                run.neighbor = above.region;
+                                run.samples++;
+                                m_regionRuns[above.region]++;
+                            } else {
+                                run.neighbor = MixedNeighbors;
+                            }
+                        }
+                    }
+                    floor.region = sweep;
+                }
+            }
+
+            for (size_t s = 1; s < m_sweeps.size(); s++) {
+                SweepRun &run = m_sweeps[s];
+                if (run.neighbor != MixedNeighbors && run.neighbor &&
+                    m_regionRuns[run.neighbor] == run.samples) {
+                    run.id = run.neighbor;
+                } else {
+                    if (id >= BorderRegion - 1) {
+                        throw std::runtime_error("Too many regions in a navigation tile");
+                    }
+                    run.id = id++;
+                }
+            }
+            for (int x = m_border; x < m_width - m_border; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    FloorSpan &floor = m_floors[i];
+                    if (floor.walkable && floor.region && !(floor.region & BorderRegion)) {
+                        floor.region = m_sweeps[floor.region].id;
+                    }
+                }
+            }
+        }
+        m_regionCount = id;
+    }
+
+    // Connected regions of too few cells go, unless they reach the border
+    void FilterRegions(std::uint32_t minCells) {
+        std::vector<std::uint32_t> parent(m_regionCount), cells(m_regionCount, 0);
+        std::vector<bool> border(m_regionCount, false);
+        std::iota(parent.begin(), parent.end(), 0u);
+        auto root = [&](std::uint32_t r) {
+            while (parent[r] != r) {
+                r = parent[r] = parent[parent[r]];
+            }
+            return r;
+        };
+        for (int z = 0; z < m_width; z++) {
+            for (int x = 0; x < m_width; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    const FloorSpan &floor = m_floors[i];
+                    if (!floor.region || (floor.region & BorderRegion)) {
+                        continue;
+                    }
+                    cells[floor.region]++;
+                    for (int dir = 0; dir < 4; dir++) {
+                        if (floor.connections[dir] == NoConnection) {
+                            continue;
+                        }
+                        const std::uint16_t other = m_floors[Neighbor(x, z, floor, dir)].region;
+                        if (other & BorderRegion) {
+                            border[floor.region] = true;
+                        } else if (other && other != floor.region) {
+                            parent[root(other)] = root(floor.region);
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<std::uint32_t> groupCells(m_regionCount, 0);
+        std::vector<bool> groupBorder(m_regionCount, false);
+        for (std::uint32_t r = 1; r < m_regionCount; r++) {
+            groupCells[root(r)] += cells[r];
+            groupBorder[root(r)] = groupBorder[root(r)] || border[r];
+        }
+        m_keptRegions = 0;
+        m_keep.assign(m_regionCount, false);
+        for (std::uint32_t r = 1; r < m_regionCount; r++) {
+            m_keep[r] = cells[r] > 0 && (groupCells[root(r)] >= minCells || groupBorder[root(r)]);
+            m_keptRegions += m_keep[r] ? 1 : 0;
+        }
+        for (FloorSpan &floor : m_floors) {
+            if (floor.region && !(floor.region & BorderRegion) && !m_keep[floor.region]) {
+                floor.region = 0;
+            }
+        }
+    }
+
+    // Highest floor around the corner clockwise of edge dir
+    int CornerHeight(int x, int z, std::uint32_t i, int dir) const {
+        const FloorSpan &floor = m_floors[i];
+        const int next = (dir + 1) & 3;
+        int height = floor.y;
+        for (const auto &[first, second] : {std::make_pair(dir, next), std::make_pair(next, dir)}) {
+            if (floor.connections[first] == NoConnection) {
+                continue;
+            }
+            const std::uint32_t a = Neighbor(x, z, floor, first);
+            height = std::max<int>(height, m_floors[a].y);
+            if (m_floors[a].connections[second] != NoConnection) {
+                const std::uint32_t b = Neighbor(x + DirX[first], z + DirZ[first], m_floors[a], second);
+                height = std::max<int>(height, m_floors[b].y);
+            }
+        }
+        return height;
+    }
+
+    // Follows the outline of a region clockwise from span i, one vertex per
+    // cell corner with the region on the other side of the edge after it
+    void WalkContour(int x, int z, std::uint32_t i, std::vector<int> &points) {
+        int dir = 0;
+        while (!(m_flags[i] & (1 << dir))) {
+            dir++;
+        }
+        const int startDir = dir;
+        const std::uint32_t start = i;
+        for (int iteration = 0; iteration < 40000; iteration++) {
+            const FloorSpan &floor = m_floors[i];
+            if (m_flags[i] & (1 << dir)) {
+                int px = x, pz = z;
+                const int py = CornerHeight(x, z, i, dir);
+                if (dir == 0) {
+                    pz++;
+                } else if (dir == 1) {
+                    px++;
+                    pz++;
+                } else if (dir == 2) {
+                    px++;
+                }
+                const bool connected = floor.connections[dir] != NoConnection;
+                const int other = connected ? m_floors[Neighbor(x, z, floor, dir)].region : 0;
+                points.insert(points.end(), {px, py, pz, other});
+                m_flags[i] &= (std::uint8_t) ~(1 << dir);
+                dir = (dir + 1) & 3;
+            } else {
+                if (floor.connections[dir] == NoConnection) {
+                    return;
+                }
+                i = Neighbor(x, z, floor, dir);
+                x += DirX[dir];
+                z += DirZ[dir];
+                dir = (dir + 3) & 3;
+            }
+            if (i == start && dir == startDir) {
+                break;
+            }
+        }
+    }
+
+    // Keeps the vertices where the region on the other side changes and adds
+    // back the raw ones straying more than maxError from walls. Edges between
+    // regions stay straight, so both sides end up with the same ones.
+    void Simplify(const std::vector<int> &points, std::vector<int> &simplified, float maxError) {
+        const int count = (int)points.size() / 4;
+        simplified.clear();
+        for (int i = 0; i < count; i++) {
+            if (points[i * 4 + 3] != points[((i + 1) % count) * 4 + 3]) {
+                simplified.insert(simplified.end(), {points[i * 4], points[i * 4 + 1], points[i * 4 + 2], i});
+            }
+        }
+        if (simplified.empty()) {
+            // Lower left and upper right corners
+            int lowest = 0, highest = 0;
+            for (int i = 1; i < count; i++) {
+                const int *p = &points[i * 4], *l = &points[lowest * 4], *h = &points[highest * 4];
+                if (p[0] < l[0] || (p[0] == l[0] && p[2] < l[2])) {
+                    lowest = i;
+                }
+                if (p[0] > h[0] || (p[0] == h[0] && p[2] > h[2])) {
+                    highest = i;
+                }
+            }
+            simplified.insert(simplified.end(),
+                              {points[lowest * 4], points[lowest * 4 + 1], points[lowest * 4 + 2], lowest});
+            simplified.insert(simplified.end(),
+                              {points[highest * 4], points[highest * 4 + 1], points[highest * 4 + 2],
+                               highest});
+        }
+
+        const float maxErrorSquared = maxError * maxError;
+        for (size_t i = 0; i < simplified.size() / 4;) {
+            const size_t next = (i + 1) % (simplified.size() / 4);
+            int ax = simplified[i * 4], az = simplified[i * 4 + 2], ai = simplified[i * 4 + 3];
+            int bx = simplified[next * 4], bz = simplified[next * 4 + 2], bi = simplified[next * 4 + 3];
+
+            // Always from the lower vertex, so a segment splits the same both ways
+            int step, c, end;
+            if (bx > ax || (bx == ax && bz > az)) {
+                step = 1;
+                c = (ai + step) % count;
+                end = bi;
+            } else {
+                step = count - 1;
+                c = (bi + step) % count;
+                end = ai;
+                std::swap(ax, bx);
+                std::swap(az, bz);
+            }
+            float farthest = 0.f;
+            int farthestIndex = -1;
+            if (points[c * 4 + 3] == 0) {
+                for (; c != end; c = (c + step) % count) {
+                    const float d =
+                        DistanceToSegmentSquared(points[c * 4], points[c * 4 + 2], ax, az, bx, bz);
+                    if (d > farthest) {
+                        farthest = d;
+                        farthestIndex = c;
+                    }
+                }
+            }
+            if (farthestIndex >= 0 && farthest > maxErrorSquared) {
+                const int *p = &points[farthestIndex * 4];
+                simplified.insert(simplified.begin() + (i + 1) * 4, {p[0], p[1], p[2], farthestIndex});
+            } else {
+                i++;
+            }
+        }
+
+        // Neighbors on the same x-z spot would confuse the triangulation
+        for (size_t i = 0; i < simplified.size() / 4 && simplified.size() / 4 > 1;) {
+            const size_t next = (i + 1) % (simplified.size() / 4);
+            if (SameXZ(&simplified[i * 4], &simplified[next * 4])) {
+                simplified.erase(simplified.begin() + next * 4, simplified.begin() + next * 4 + 4);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void BuildContours(float maxError, TileResult &result) {
+        m_flags.assign(m_floors.size(), 0);
+        for (int z = 0; z < m_width; z++) {
+            for (int x = 0; x < m_width; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    const FloorSpan &floor = m_floors[i];
+                    if (!floor.region || (floor.region & BorderRegion)) {
+                        continue;
+                    }
+                    std::uint8_t same = 0;
+                    for (int dir = 0; dir < 4; dir++) {
+                        if (floor.connections[dir] != NoConnection &&
+                            m_floors[Neighbor(x, z, floor, dir)].region == floor.region) {
+                            same |= (std::uint8_t)(1 << dir);
+                        }
+                    }
+                    // Edges towards other regions or no floor
+                    m_flags[i] = same ^ 0xF;
+                }
+            }
+        }
+
+        m_contours.clear();
+        m_contourStart.assign(1, 0);
+        for (int z = 0; z < m_width; z++) {
+            for (int x = 0; x < m_width; x++) {
+                for (std::uint32_t i = FirstFloor(x, z); i < EndFloor(x, z); i++) {
+                    if (m_flags[i] == 0 || m_flags[i] == 0xF) {
+                        m_flags[i] = 0;
+                        continue;
+                    }
+                    m_points.clear();
+                    WalkContour(x, z, i, m_points);
+                    Simplify(m_points, m_simplified, maxError);
+                    if (m_simplified.size() < 12) {
+                        continue;
+                    }
+                    // Outlines run clockwise, a counter clockwise one is a hole
+                    // which monotone regions don't have
+                    std::int64_t area = 0;
+                    const size_t count = m_simplified.size() / 4;
+                    for (size_t a = 0, b = count - 1; a < count; b = a, a++) {
+                        area += (std::int64_t)m_simplified[a * 4] * m_simplified[b * 4 + 2] -
+                                (std::int64_t)m_simplified[b * 4] * m_simplified[a * 4 + 2];
+                    }
+                    if (area < 0) {
+                        result.failedOutlines++;
+                        continue;
+                    }
+                    for (size_t v = 0; v < count; v++) {
+                        m_simplified[v * 4] -= m_border;
+                        m_simplified[v * 4 + 2] -= m_border;
+                    }
+                    m_contours.insert(m_contours.end(), m_simplified.begin(), m_simplified.end());
+                    m_contourStart.push_back((std::uint32_t)m_contours.size());
+                }
+            }
+        }
+        result.regions = m_keptRegions;
+    }
+
+    // Welds vertices on the same corner less than two cells apart in height
+    std::uint32_t AddVertex(const int *p, TileResult &result) {
+        const std::uint64_t key = ((std::uint64_t)(std::uint32_t)p[0] << 32) | (std::uint32_t)p[2];
+        const std::uint32_t bucket = (std::uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 52);
+        for (std::uint32_t v = m_vertexBucket[bucket]; v != NoSpan; v = m_vertexNext[v]) {
+            const int *q = &result.vertices[v * 3];
+            if (q[0] == p[0] && q[2] == p[2] && std::abs(q[1] - p[1]) <= 2) {
+                return v;
+            }
+        }
+        const std::uint32_t v = (std::uint32_t)result.vertices.size() / 3;
+        result.vertices.insert(result.vertices.end(), {p[0], p[1], p[2]});
+        m_vertexNext.push_back(m_vertexBucket[bucket]);
+        m_vertexBucket[bucket] = v;
+        return v;
+    }
+
+    void BuildPolygons(TileResult &result) {
+        m_vertexBucket.assign(4096, NoSpan);
+        m_vertexNext.clear();
+        for (size_t c = 0; c + 1 < m_contourStart.size(); c++) {
+            m_outline.assign(m_contours.begin() + m_contourStart[c],
+                             m_contours.begin() + m_contourStart[c + 1]);
+            if (!m_triangulator.Run(m_outline, m_tris)) {
+                result.failedOutlines++;
+            }
+            m_welded.clear();
+            for (size_t v = 0; v < m_outline.size() / 4; v++) {
+                m_welded.push_back(AddVertex(&m_outline[v * 4], result));
+            }
+
+            m_polygons.clear();
+            m_counts.clear();
+            for (size_t t = 0; t + 2 < m_tris.size(); t += 3) {
+                const std::uint32_t a = m_welded[m_tris[t]], b = m_welded[m_tris[t + 1]];
+                const std::uint32_t c2 = m_welded[m_tris[t + 2]];
+                if (a != b && a != c2 && b != c2) {
+                    std::array<std::uint32_t, NavMesh::MaxVertices> polygon{};
+                    polygon[0] = a;
+                    polygon[1] = b;
+                    polygon[2] = c2;
+                    m_polygons.push_back(polygon);
+                    m_counts.push_back(3);
+                }
+            }
+
+            // Merge over the longest shared edge first
+            for (;;) {
+                int best = 0;
+                size_t bestA = 0, bestB = 0;
+                std::uint32_t bestEdgeA = 0, bestEdgeB = 0;
+                for (size_t a = 0; a < m_polygons.size(); a++) {
+                    for (size_t b = a + 1; b < m_polygons.size(); b++) {
+                        std::uint32_t edgeA, edgeB;
+                        const int value = MergeValue(m_polygons[a], m_counts[a], m_polygons[b], m_counts[b],
+                                                     result.vertices, edgeA, edgeB);
+                        if (value > best) {
+                            best = value;
+                            bestA = a;
+                            bestB = b;
+                            bestEdgeA = edgeA;
+                            bestEdgeB = edgeB;
+                        }
+                    }
+                }
+                if (best <= 0) {
+                    break;
+                }
+                const std::array<std::uint32_t, NavMesh::MaxVertices> a = m_polygons[bestA];
+                const std::array<std::uint32_t, NavMesh::MaxVertices> b = m_polygons[bestB];
+                const std::uint32_t countA = m_counts[bestA], countB = m_counts[bestB];
+                std::array<std::uint32_t, NavMesh::MaxVertices> merged{};
+                std::uint32_t n = 0;
+                for (std::uint32_t i = 0; i + 1 < countA; i++) {
+                    merged[n++] = a[(bestEdgeA + 1 + i) % countA];
+                }
+                for (std::uint32_t i = 0; i + 1 < countB; i++) {
+                    merged[n++] = b[(bestEdgeB + 1 + i) % countB];
+                }
+                m_polygons[bestA] = merged;
+                m_counts[bestA] = n;
+                m_polygons[bestB] = m_polygons.back();
+                m_counts[bestB] = m_counts.back();
+                m_polygons.pop_back();
+                m_counts.pop_back();
+            }
+            result.polygons.insert(result.polygons.end(), m_polygons.begin(), m_polygons.end());
+            result.counts.insert(result.counts.end(), m_counts.begin(), m_counts.end());
+        }
+    }
+
+    float m_cellSize = 0.f;
+    float m_cellHeight = 0.f;
+    int m_walkableHeight = 0;
+    int m_walkableClimb = 0;
+    int m_radius = 0;
+    int m_tileSize = 0;
+    int m_border = 0;
+    int m_width = 0;
+    float m_origin[3] = {};
+
+    std::vector<std::uint32_t> m_columns;
+    std::vector<SolidSpan> m_solids;
+    std::uint32_t m_freeSolid = NoSpan;
+    std::vector<std::uint32_t> m_cellStart;
+    std::vector<FloorSpan> m_floors;
+    std::vector<std::uint8_t> m_distance;
+
+    // Runs of the row being swept, by their id within the row
+    struct SweepRun {
+        std::uint16_t id;
+        std::uint16_t samples;
+        std::uint16_t neighbor;
+    };
+    std::vector<SweepRun> m_sweeps;
+    std::vector<std::uint16_t> m_regionRuns;
+    std::uint32_t m_regionCount = 0;
+    std::uint32_t m_keptRegions = 0;
+    std::vector<bool> m_keep;
+
+    std::vector<std::uint8_t> m_flags;
+    std::vector<int> m_points;
+    std::vector<int> m_simplified;
+    std::vector<int> m_contours;
+    std::vector<std::uint32_t> m_contourStart;
+
+    Triangulator m_triangulator;
+    std::vector<int> m_outline;
+    std::vector<std::uint32_t> m_tris;
+    std::vector<std::uint32_t> m_welded;
+    std::vector<std::uint32_t> m_vertexBucket;
+    std::vector<std::uint32_t> m_vertexNext;
+    std::vector<std::array<std::uint32_t, NavMesh::MaxVertices>> m_polygons;
+    std::vector<std::uint32_t> m_counts;
+};
+
+// Vertex after the e-th going around polygon
+std::uint32_t NextVertex(const NavMesh::Polygon &polygon, std::uint32_t e) {
+    return polygon.vertices[(e + 1) % polygon.vertexCount];
+}
+
+float Distance(const float *a, const float *b) {
+    const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+// Positive when c is left of ab looking down, x right and z up
+float Cross(const float *a, const float *b, const float *c) {
+    return (b[0] - a[0]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[0] - a[0]);
+}
+
+bool SamePoint(const float *a, const float *b) {
+    const float dx = a[0] - b[0], dz = a[2] - b[2];
+    return dx * dx + dz * dz < 1e-12f;
+}
+
+bool SamePosition(const float *a, const float *b) { return SamePoint(a, b) && std::abs(a[1] - b[1]) < 1e-6f; }
+} // namespace
+
+void NavMesh::Build(const WorldMesh &mesh, const std::vector<Portal> &doors, const NavMeshConfig &config,
+                    ThreadPool *pool) {
+    *this = NavMesh();
+    m_config = config;
+
+    // Triangles in world space, walkable by the slope of their wound normal
+    const float minNormalY = std::cos(config.maxSlope * 3.14159265f / 180.f);
+    std::vector<float> triangles;
+    std::vector<std::uint8_t> walkable;
+    float low[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, high[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    // Floor corners inside every door, per side
+    std::vector<std::array<std::vector<std::array<float, 3>>, 2>> doorFloors(doors.size());
+    // Triangles of a room are roomTriangles[r] up to roomTriangles[r + 1]
+    std::vector<std::uint32_t> roomTriangles(mesh.rooms.size() + 1, 0);
+    for (std::uint32_t r = 0; r < mesh.rooms.size(); r++) {
+        const RoomMesh &room = mesh.rooms[r];
+        roomTriangles[r] = (std::uint32_t)walkable.size();
+        for (std::uint32_t i = 0; i + 2 < room.indexCount; i += 3) {
+            const float *p[3];
+            for (int k = 0; k < 3; k++) {
+                p[k] = mesh.vertices[room.firstVertex + mesh.indices[room.firstIndex + i + k]].position;
+            }
+            const float ab[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+            const float ac[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+            const float normal[3] = {ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2],
+                                     ab[0] * ac[1] - ab[1] * ac[0]};
+            const float length =
+                std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            const bool floor = length > 0.f && normal[1] / length >= minNormalY;
+            for (size_t d = 0; d < doors.size() && floor; d++) {
+                if (doors[d].roomA != r && doors[d].roomB != r) {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++) {
+                    bool inside = true;
+                    for (int axis = 0; axis < 3; axis++) {
+                        inside = inside && p[k][axis] >= doors[d].boundsMin[axis] &&
+                                 p[k][axis] <= doors[d].boundsMax[axis];
+                    }
+                    if (inside) {
+                        doorFloors[d][doors[d].roomA == r ? 0 : 1].push_back({p[k][0], p[k][1], p[k][2]});
+                    }
+                }
+            }
+            // Walls inside a door are where the shells of both rooms close it
+            bool door = false;
+            for (size_t d = 0; d < doors.size() && !floor && !door; d++) {
+                door = true;
+                for (int k = 0; k < 3 && door; k++) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        door = door && p[k][axis] >= doors[d].boundsMin[axis] - config.doorTolerance &&
+                               p[k][axis] <= doors[d].boundsMax[axis] + config.doorTolerance;
+                    }
+                }
+            }
+            if (door) {
+                m_stats.doorTriangles++;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                triangles.insert(triangles.end(), p[k], p[k] + 3);
+                for (int axis = 0; axis < 3; axis++) {
+                    low[axis] = std::min(low[axis], p[k][axis]);
+                    high[axis] = std::max(high[axis], p[k][axis]);
+                }
+            }
+            walkable.push_back(floor ? 1 : 0);
+        }
+    }
+    roomTriangles[mesh.rooms.size()] = (std::uint32_t)walkable.size();
+    // The shells of two rooms end a little apart in a door, leaving a gap
+    // no voxel is set in. A floor level across the door at the height both
+    // rooms' floors reach it bridges the gap.
+    for (size_t d = 0; d < doors.size(); d++) {
+        if (doorFloors[d][0].empty() || doorFloors[d][1].empty()) {
+            continue;
+        }
+        float floorY[2] = {FLT_MAX, FLT_MAX};
+        for (int side = 0; side < 2; side++) {
+            for (const auto &corner : doorFloors[d][side]) {
+                floorY[side] = std::min(floorY[side], corner[1]);
+            }
+        }
+        if (std::abs(floorY[0] - floorY[1]) > config.agentClimb) {
+            continue;
+        }
+        const float y = std::max(floorY[0], floorY[1]);
+        float x0 = FLT_MAX, x1 = -FLT_MAX, z0 = FLT_MAX, z1 = -FLT_MAX;
+        for (const auto &side : doorFloors[d]) {
+            for (const auto &corner : side) {
+                if (corner[1] <= y + config.agentClimb) {
+                    x0 = std::min(x0, corner[0]);
+                    x1 = std::max(x1, corner[0]);
+                    z0 = std::min(z0, corner[2]);
+                    z1 = std::max(z1, corner[2]);
+                }
+            }
+        }
+        const float corners[4][3] = {{x0, y, z0}, {x0, y, z1}, {x1, y, z1}, {x1, y, z0}};
+        for (int first : {1, 2}) {
+            for (const float *corner : {corners[0], corners[first], corners[first + 1]}) {
+                triangles.insert(triangles.end(), corner, corner + 3);
+            }
+            walkable.push_back(1);
+        }
+        m_stats.doorBridges++;
+    }
+    if (walkable.empty()) {
+        return;
+    }
+
+    const float tileWorld = config.tileSize * config.cellSize;
+    const int border = (int)std::ceil(config.agentRadius / config.cellSize) + 3;
+    m_origin[0] = low[0];
+    m_origin[1] = low[1] - config.cellHeight;
+    m_origin[2] = low[2];
+    m_tilesX = std::max(1u, (std::uint32_t)std::ceil((high[0] - low[0]) / tileWorld));
+    m_tilesZ = std::max(1u, (std::uint32_t)std::ceil((high[2] - low[2]) / tileWorld));
+    const std::uint32_t tileCount = m_tilesX * m_tilesZ;
+
+    // Triangles touching every tile with its border
+    std::vector<std::vector<std::uint32_t>> lists(tileCount);
+    const float reach = border * config.cellSize;
+    for (std::uint32_t t = 0; t < walkable.size(); t++) {
+        const float *p = &triangles[t * 9];
+        const float x0 = std::min({p[0], p[3], p[6]}) - reach, x1 = std::max({p[0], p[3], p[6]}) + reach;
+        const float z0 = std::min({p[2], p[5], p[8]}) - reach, z1 = std::max({p[2], p[5], p[8]}) + reach;
+        const int tx0 = std::max(0, (int)std::floor((x0 - m_origin[0]) / tileWorld));
+        const int tx1 = std::min((int)m_tilesX - 1, (int)std::floor((x1 - m_origin[0]) / tileWorld));
+        const int tz0 = std::max(0, (int)std::floor((z0 - m_origin[2]) / tileWorld));
+        const int tz1 = std::min((int)m_tilesZ - 1, (int)std::floor((z1 - m_origin[2]) / tileWorld));
+        for (int tz = tz0; tz <= tz1; tz++) {
+            for (int tx = tx0; tx <= tx1; tx++) {
+                lists[tx + tz * m_tilesX].push_back(t);
+            }
+        }
+    }
+
+    std::vector<TileResult> tiles(tileCount);
+    std::vector<TileBuilder> builders(pool ? pool->ThreadCount() : 1);
+    auto buildTile = [&](std::uint32_t tile, std::uint32_t slot) {
+        if (!lists[tile].empty()) {
+            builders[slot].Build(config, m_origin, tile % m_tilesX, tile / m_tilesX, triangles, walkable,
+                                 lists[tile], tiles[tile]);
+        }
+    };
+    if (pool) {
+        pool->ParallelFor(tileCount, buildTile);
+    } else {
+        for (std::uint32_t tile = 0; tile < tileCount; tile++) {
+            buildTile(tile, 0);
+        }
+    }
+
+    // Tiles one after the other in world space
+    std::vector<std::uint32_t> firstVertex(tileCount + 1, 0);
+    m_tileStart.assign(tileCount + 1, 0);
+    m_stats.tiles = tileCount;
+    for (std::uint32_t tile = 0; tile < tileCount; tile++) {
+        const TileResult &result = tiles[tile];
+        const float cornerX = m_origin[0] + (tile % m_tilesX) * tileWorld;
+        const float cornerZ = m_origin[2] + (tile / m_tilesX) * tileWorld;
+        firstVertex[tile] = (std::uint32_t)m_vertices.size() / 3;
+        for (size_t v = 0; v < result.vertices.size(); v += 3) {
+            m_vertices.push_back(cornerX + result.vertices[v] * config.cellSize);
+            m_vertices.push_back(m_origin[1] + result.vertices[v + 1] * config.cellHeight);
+            m_vertices.push_back(cornerZ + result.vertices[v + 2] * config.cellSize);
+        }
+        m_tileStart[tile] = (std::uint32_t)m_polygons.size();
+        for (size_t p = 0; p < result.polygons.size(); p++) {
+            Polygon polygon{};
+            polygon.vertexCount = result.counts[p];
+            for (std::uint32_t v = 0; v < polygon.vertexCount; v++) {
+                polygon.vertices[v] = firstVertex[tile] + result.polygons[p][v];
+                for (int k = 0; k < 3; k++) {
+                    polygon.center[k] += Vertex(polygon.vertices[v])[k] / polygon.vertexCount;
+                }
+            }
+            m_polygons.push_back(polygon);
+        }
+        m_stats.usedTiles += result.polygons.empty() ? 0 : 1;
+        m_stats.floorCells += result.floorCells;
+        m_stats.regions += result.regions;
+        m_stats.failedOutlines += result.failedOutlines;
+    }
+    m_tileStart[tileCount] = (std::uint32_t)m_polygons.size();
+
+    // Polygons of a tile share the vertices of their edges, across tiles
+    // edges on the common side are linked where they overlap
+    std::vector<std::pair<std::uint32_t, Link>> links;
+    std::vector<std::array<std::uint32_t, 4>> edges;
+    // Bit per edge of every polygon, set for the ones linked so far
+    std::vector<std::uint8_t> linkedEdges(m_polygons.size(), 0);
+    for (std::uint32_t tile = 0; tile < tileCount; tile++) {
+        edges.clear();
+        for (std::uint32_t p = m_tileStart[tile]; p < m_tileStart[tile + 1]; p++) {
+            const Polygon &polygon = m_polygons[p];
+            for (std::uint32_t e = 0; e < polygon.vertexCount; e++) {
+                const std::uint32_t a = polygon.vertices[e], b = NextVertex(polygon, e);
+                edges.push_back({std::min(a, b), std::max(a, b), p, e});
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        for (size_t i = 0; i + 1 < edges.size(); i++) {
+            if (edges[i][0] != edges[i + 1][0] || edges[i][1] != edges[i + 1][1]) {
+                continue;
+            }
+            for (const auto &[from, to] :
+                 {std::make_pair(edges[i], edges[i + 1]), std::make_pair(edges[i + 1], edges[i])}) {
+                const Polygon &polygon = m_polygons[from[2]];
+                Link link{to[2], {}, {}};
+                std::copy_n(Vertex(polygon.vertices[from[3]]), 3, link.a);
+                std::copy_n(Vertex(polygon.vertices[(from[3] + 1) % polygon.vertexCount]), 3, link.b);
+                links.emplace_back(from[2], link);
+                linkedEdges[from[2]] |= (std::uint8_t)(1 << from[3]);
+            }
+            i++;
+        }
+    }
+
+    const int side = (int)config.tileSize;
+    auto onSide = [&](std::uint32_t tile, std::uint32_t p, std::uint32_t e, int dir) {
+        const Polygon &polygon = m_polygons[p];
+        const int *a = &tiles[tile].vertices[(polygon.vertices[e] - firstVertex[tile]) * 3];
+        const int *b = &tiles[tile].vertices[(NextVertex(polygon, e) - firstVertex[tile]) * 3];
+        const int axis = DirX[dir] ? 0 : 2;
+        const int at = (DirX[dir] + DirZ[dir]) > 0 ? side : 0;
+        return a[axis] == at && b[axis] == at;
+    };
+    for (std::uint32_t tile = 0; tile < tileCount; tile++) {
+        const int tx = (int)(tile % m_tilesX), tz = (int)(tile / m_tilesX);
+        for (int dir = 0; dir < 4; dir++) {
+            const int nx = tx + DirX[dir], nz = tz + DirZ[dir];
+            if (nx < 0 || nz < 0 || nx >= (int)m_tilesX || nz >= (int)m_tilesZ) {
+                continue;
+            }
+            const std::uint32_t other = nx + nz * m_tilesX;
+            const int along = DirX[dir] ? 2 : 0;
+            for (std::uint32_t p = m_tileStart[tile]; p < m_tileStart[tile + 1]; p++) {
+                const Polygon &polygon = m_polygons[p];
+                for (std::uint32_t e = 0; e < polygon.vertexCount; e++) {
+                    if (!onSide(tile, p, e, dir)) {
+                        continue;
+                    }
+                    const float *a = Vertex(polygon.vertices[e]);
+                    const float *b = Vertex(NextVertex(polygon, e));
+                    for (std::uint32_t q = m_tileStart[other]; q < m_tileStart[other + 1]; q++) {
+                        const Polygon &facing = m_polygons[q];
+                        for (std::uint32_t f = 0; f < facing.vertexCount; f++) {
+                            if (!onSide(other, q, f, (dir + 2) & 3)) {
+                                continue;
+                            }
+                            const float *c = Vertex(facing.vertices[f]);
+                            const float *d = Vertex(facing.vertices[(f + 1) % facing.vertexCount]);
+                            const float from = std::max(std::min(a[along], b[along]),
+                                                        std::min(c[along], d[along]));
+                            const float to = std::min(std::max(a[along], b[along]),
+                                                      std::max(c[along], d[along]));
+                            if (to - from < config.cellSize * 0.5f) {
+                                continue;
+                            }
+                            // Heights of both edges where the overlap starts and ends
+                            auto pointAt = [&](const float *p0, const float *p1, float t, float *out) {
+                                const float span = p1[along] - p0[along];
+                                const float s = span != 0.f ? (t - p0[along]) / span : 0.f;
+                                for (int k = 0; k < 3; k++) {
+                                    out[k] = p0[k] + (p1[k] - p0[k]) * s;
+                                }
+                            };
+                            float start[3], end[3], facingStart[3], facingEnd[3];
+                            const bool forward = b[along] > a[along];
+                            pointAt(a, b, forward ? from : to, start);
+                            pointAt(a, b, forward ? to : from, end);
+                            pointAt(c, d, forward ? from : to, facingStart);
+                            pointAt(c, d, forward ? to : from, facingEnd);
+                            if (std::abs(start[1] - facingStart[1]) > config.agentClimb ||
+                                std::abs(end[1] - facingEnd[1]) > config.agentClimb) {
+                                continue;
+                            }
+                            Link link{q, {}, {}};
+                            std::copy_n(start, 3, link.a);
+                            std::copy_n(end, 3, link.b);
+                            links.emplace_back(p, link);
+                            linkedEdges[p] |= (std::uint8_t)(1 << e);
+                            m_stats.tileLinks++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Along open edges, floor a jump across and a ledge up or down is linked
+    // one way from a point on the edge. Floor at the same height beyond an
+    // edge is behind a wall.
+    const size_t walkLinks = links.size();
+    const float probeHeight = (config.jumpHeight + config.dropHeight) * 0.5f;
+    for (std::uint32_t p = 0; p < m_polygons.size(); p++) {
+        const Polygon &polygon = m_polygons[p];
+        for (std::uint32_t e = 0; e < polygon.vertexCount; e++) {
+            if (linkedEdges[p] & (1 << e)) {
+                continue;
+            }
+            const float *a = Vertex(polygon.vertices[e]), *b = Vertex(NextVertex(polygon, e));
+            const float dx = b[0] - a[0], dz = b[2] - a[2];
+            const float length = std::sqrt(dx * dx + dz * dz);
+            if (length < config.cellSize) {
+                continue;
+            }
+            float out[2] = {-dz / length, dx / length};
+            if (out[0] * (a[0] - polygon.center[0]) + out[1] * (a[2] - polygon.center[2]) < 0.f) {
+                out[0] = -out[0];
+                out[1] = -out[1];
+            }
+            const std::uint32_t samples = std::min(8u,
+                                                   (std::uint32_t)std::ceil(length / config.jumpDistance));
+            std::uint32_t previous = NoPolygon;
+            for (std::uint32_t i = 0; i < samples; i++) {
+                const float t = (i + 0.5f) / samples;
+                const float edge[3] = {a[0] + dx * t, a[1] + (b[1] - a[1]) * t, a[2] + dz * t};
+                const float probe[3] = {edge[0] + out[0] * config.jumpDistance * 0.5f,
+                                        edge[1] + (config.jumpHeight - config.dropHeight) * 0.5f,
+                                        edge[2] + out[1] * config.jumpDistance * 0.5f};
+                // Simplified outlines may have strayed from the voxels on either side
+                const float across = config.jumpDistance * 0.5f + config.maxEdgeError;
+                const float extents[3] = {across, probeHeight, across};
+                const std::uint32_t q = FindLedge(probe, extents, edge);
+                if (q == NoPolygon || q == p || q == previous) {
+                    continue;
+                }
+                previous = q;
+                Link link{q, {edge[0], edge[1], edge[2]}, {edge[0], edge[1], edge[2]}};
+                links.emplace_back(p, link);
+                m_stats.ledgeLinks++;
+            }
+        }
+    }
+
+    // The map geometry leaves out platforms and lifts, so floor of a room
+    // not walked to from the rest of it is linked both ways where pieces come
+    // closest, then rooms are linked at their doors. Ledges only lead one
+    // way and don't count. A polygon is in the rooms whose floor triangles
+    // are under or over its center, and no link reaches further across than
+    // maxRoomLink, so one doesn't go into the room behind a wall.
+    if (config.linkRooms) {
+        std::vector<std::uint32_t> parent(m_polygons.size());
+        std::iota(parent.begin(), parent.end(), 0u);
+        auto root = [&](std::uint32_t p) {
+            while (parent[p] != p) {
+                p = parent[p] = parent[parent[p]];
+            }
+            return p;
+        };
+        for (size_t i = 0; i < walkLinks; i++) {
+            parent[root(links[i].second.polygon)] = root(links[i].first);
+        }
+        // Link points on both, false when they are too far apart
+        auto linkPoints = [&](std::uint32_t p, std::uint32_t q, float a[3], float b[3]) {
+            ClosestOnPolygon(m_polygons[p], m_polygons[q].center, a);
+            ClosestOnPolygon(m_polygons[q], m_polygons[p].center, b);
+            const float dx = b[0] - a[0], dz = b[2] - a[2];
+            return dx * dx + dz * dz <= config.maxRoomLink * config.maxRoomLink &&
+                   std::abs(b[1] - a[1]) <= config.maxRoomLift;
+        };
+        auto linkBoth = [&](std::uint32_t p, std::uint32_t q, const float a[3], const float b[3]) {
+            const float gap = Distance(a, b);
+            links.emplace_back(p, Link{q, {a[0], a[1], a[2]}, {a[0], a[1], a[2]}, gap});
+            links.emplace_back(q, Link{p, {b[0], b[1], b[2]}, {b[0], b[1], b[2]}, gap});
+            parent[root(q)] = root(p);
+            m_stats.roomLinks++;
+        };
+        auto onFloor = [&](std::uint32_t p, std::uint32_t r) {
+            const float *c = m_polygons[p].center;
+            for (std::uint32_t t = roomTriangles[r]; t < roomTriangles[r + 1]; t++) {
+                const float *v = &triangles[t * 9];
+                const float area = Cross(v, v + 3, v + 6);
+                if (!walkable[t] || area == 0.f) {
+                    continue;
+                }
+                const float u = Cross(v + 3, v + 6, c) / area, w = Cross(v, v + 3, c) / area;
+                if (u >= 0.f && w >= 0.f && u + w <= 1.f) {
+                    const float y = v[1] * u + v[4] * (1.f - u - w) + v[7] * w;
+                    if (std::abs(y - c[1]) <= config.agentClimb) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        std::vector<std::vector<std::uint32_t>> roomPolygons(mesh.rooms.size());
+        for (std::uint32_t p = 0; p < m_polygons.size(); p++) {
+            for (std::uint32_t r = 0; r < mesh.rooms.size(); r++) {
+                bool inside = true;
+                for (int k = 0; k < 3 && inside; k++) {
+                    inside = m_polygons[p].center[k] >= mesh.rooms[r].boundsMin[k] - config.agentClimb &&
+                             m_polygons[p].center[k] <= mesh.rooms[r].boundsMax[k] + config.agentClimb;
+                }
+                if (inside && onFloor(p, r)) {
+                    roomPolygons[r].push_back(p);
+                }
+            }
+        }
+        // Pieces of a room join shortest link first, the way Kruskal's
+        // spanning tree does
+        std::vector<std::pair<float, std::pair<std::uint32_t, std::uint32_t>>> pairs;
+        for (const std::vector<std::uint32_t> &polygons : roomPolygons) {
+            pairs.clear();
+            for (size_t i = 0; i < polygons.size(); i++) {
+                for (size_t j = i + 1; j < polygons.size(); j++) {
+                    const std::uint32_t p = polygons[i], q = polygons[j];
+                    float a[3], b[3];
+                    if (root(p) != root(q) && linkPoints(p, q, a, b)) {
+                        pairs.push_back({Distance(a, b), {p, q}});
+                    }
+                }
+            }
+            std::sort(pairs.begin(), pairs.end());
+            for (const auto &[gap, pair] : pairs) {
+                float a[3], b[3];
+                if (root(pair.first) != root(pair.second)) {
+                    linkPoints(pair.first, pair.second, a, b);
+                    linkBoth(pair.first, pair.second, a, b);
+                }
+            }
+        }
+        // Doors join the polygons of both rooms closest to their middle
+        for (const Portal &door : doors) {
+            float middle[3];
+            for (int k = 0; k < 3; k++) {
+                middle[k] = (door.boundsMin[k] + door.boundsMax[k]) * 0.5f;
+            }
+            std::uint32_t closest[2] = {NoPolygon, NoPolygon};
+            for (int side = 0; side < 2; side++) {
+                float best = FLT_MAX;
+                for (const std::uint32_t p : roomPolygons[side ? door.roomB : door.roomA]) {
+                    float point[3];
+                    ClosestOnPolygon(m_polygons[p], middle, point);
+                    if (Distance(point, middle) < best) {
+                        best = Distance(point, middle);
+                        closest[side] = p;
+                    }
+                }
+            }
+            float a[3], b[3];
+            if (closest[0] != NoPolygon && closest[1] != NoPolygon && root(closest[0]) != root(closest[1]) &&
+                linkPoints(closest[0], closest[1], a, b)) {
+                linkBoth(closest[0], closest[1], a, b);
+            }
+        }
+    }
+
+    std::stable_sort(links.begin(), links.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    m_links.reserve(links.size());
+    for (const auto &[polygon, link] : links) {
+        if (m_polygons[polygon].linkCount == 0) {
+            m_polygons[polygon].firstLink = (std::uint32_t)m_links.size();
+        }
+        m_polygons[polygon].linkCount++;
+        m_links.push_back(link);
+    }
+    m_stats.polygons = (std::uint32_t)m_polygons.size();
+    m_stats.vertices = (std::uint32_t)m_vertices.size() / 3;
+    m_stats.links = (std::uint32_t)m_links.size();
+}
+
+void NavMesh::ClosestOnPolygon(const Polygon &polygon, const float point[3], float closest[3]) const {
+    // Inside in x-z, the height of the fan triangle below
+    bool inside = true;
+    float sign = 0.f;
+    for (std::uint32_t e = 0; e < polygon.vertexCount && inside; e++) {
+        const float cross =
+            Cross(Vertex(polygon.vertices[e]), Vertex(NextVertex(polygon, e)), point);
+        if (cross != 0.f) {
+            inside = sign == 0.f || (cross > 0.f) == (sign > 0.f);
+            sign = cross;
+        }
+    }
+    if (inside) {
+        const float *a = Vertex(polygon.vertices[0]);
+        for (std::uint32_t v = 1; v + 1 < polygon.vertexCount; v++) {
+            const float *b = Vertex(polygon.vertices[v]), *c = Vertex(polygon.vertices[v + 1]);
+            const float area = Cross(a, b, c);
+            if (area == 0.f) {
+                continue;
+            }
+            const float u = Cross(b, c, point) / area, w = Cross(a, b, point) / area;
+            if (u >= -1e-4f && w >= -1e-4f && u + w <= 1.f + 1e-4f) {
+                closest[0] = point[0];
+                closest[1] = u * a[1] + (1.f - u - w) * b[1] + w * c[1];
+                closest[2] = point[2];
+                return;
+            }
+        }
+    }
+
+    // Closest point of the outline in x-z
+    float best = FLT_MAX;
+    for (std::uint32_t e = 0; e < polygon.vertexCount; e++) {
+        const float *a = Vertex(polygon.vertices[e]), *b = Vertex(NextVertex(polygon, e));
+        const float dx = b[0] - a[0], dz = b[2] - a[2];
+        const float lengthSquared = dx * dx + dz * dz;
+        const float along = (point[0] - a[0]) * dx + (point[2] - a[2]) * dz;
+        float t = lengthSquared > 0.f ? along / lengthSquared : 0.f;
+        t = std::clamp(t, 0.f, 1.f);
+        const float x = a[0] + dx * t, z = a[2] + dz * t;
+        const float d = (x - point[0]) * (x - point[0]) + (z - point[2]) * (z - point[2]);
+        if (d < best) {
+            best = d;
+            closest[0] = x;
+            closest[1] = a[1] + (b[1] - a[1]) * t;
+            closest[2] = z;
+        }
+    }
+}
+
+std::uint32_t NavMesh::FindLedge(const float probe[3], const float extents[3], const float edge[3]) const {
+    const float tileWorld = m_config.tileSize * m_config.cellSize;
+    const int tx0 = std::max(0, (int)std::floor((probe[0] - extents[0] - m_origin[0]) / tileWorld));
+    const int tx1 = std::min((int)m_tilesX - 1,
+                             (int)std::floor((probe[0] + extents[0] - m_origin[0]) / tileWorld));
+    const int tz0 = std::max(0, (int)std::floor((probe[2] - extents[2] - m_origin[2]) / tileWorld));
+    const int tz1 = std::min((int)m_tilesZ - 1,
+                             (int)std::floor((probe[2] + extents[2] - m_origin[2]) / tileWorld));
+
+    // The closest ledge in height, past a step and within the jump or drop
+    std::uint32_t found = NoPolygon;
+    float best = FLT_MAX;
+    for (int tz = tz0; tz <= tz1; tz++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            const std::uint32_t tile = tx + tz * m_tilesX;
+            for (std::uint32_t p = m_tileStart[tile]; p < m_tileStart[tile + 1]; p++) {
+                float closest[3];
+                ClosestOnPolygon(m_polygons[p], probe, closest);
+                const float rise = closest[1] - edge[1];
+                if (std::abs(closest[0] - probe[0]) > extents[0] ||
+                    std::abs(closest[2] - probe[2]) > extents[2] ||
+                    rise > m_config.jumpHeight || rise < -m_config.dropHeight ||
+                    std::abs(rise) <= m_config.agentClimb) {
+                    continue;
+                }
+                if (std::abs(rise) < best) {
+                    best = std::abs(rise);
+                    found = p;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+std::uint32_t NavMesh::FindPolygon(const float point[3], const float extents[3], float nearest[3]) const {
+    if (m_polygons.empty()) {
+        return NoPolygon;
+    }
+    const float tileWorld = m_config.tileSize * m_config.cellSize;
+    const int tx0 = std::max(0, (int)std::floor((point[0] - extents[0] - m_origin[0]) / tileWorld));
+    const int tx1 = std::min((int)m_tilesX - 1,
+                             (int)std::floor((point[0] + extents[0] - m_origin[0]) / tileWorld));
+    const int tz0 = std::max(0, (int)std::floor((point[2] - extents[2] - m_origin[2]) / tileWorld));
+    const int tz1 = std::min((int)m_tilesZ - 1,
+                             (int)std::floor((point[2] + extents[2] - m_origin[2]) / tileWorld));
+
+    std::uint32_t found = NoPolygon;
+    float best = FLT_MAX;
+    for (int tz = tz0; tz <= tz1; tz++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            const std::uint32_t tile = tx + tz * m_tilesX;
+            for (std::uint32_t p = m_tileStart[tile]; p < m_tileStart[tile + 1]; p++) {
+                const Polygon &polygon = m_polygons[p];
+                bool overlaps = true;
+                for (int k = 0; k < 3 && overlaps; k++) {
+                    float low = FLT_MAX, high = -FLT_MAX;
+                    for (std::uint32_t v = 0; v < polygon.vertexCount; v++) {
+                        low = std::min(low, Vertex(polygon.vertices[v])[k]);
+                        high = std::max(high, Vertex(polygon.vertices[v])[k]);
+                    }
+                    overlaps = low <= point[k] + extents[k] && high >= point[k] - extents[k];
+                }
+                if (!overlaps) {
+                    continue;
+                }
+                float closest[3];
+                ClosestOnPolygon(polygon, point, closest);
+                const float d = Distance(closest, point);
+                if (d < best && std::abs(closest[0] - point[0]) <= extents[0] &&
+                    std::abs(closest[1] - point[1]) <= extents[1] &&
+                    std::abs(closest[2] - point[2]) <= extents[2]) {
+                    best = d;
+                    found = p;
+                    std::copy_n(closest, 3, nearest);
+                }
+            }
+        }
+    }
+    return found;
+}
+
+std::uint32_t NavMesh::FindNearestPolygon(const float point[3], const float extents[3],
+                                          float nearest[3]) const {
+    float box[3] = {extents[0], extents[1], extents[2]};
+    std::uint32_t found = FindPolygon(point, box, nearest);
+    for (int i = 0; i < 32 && found == NoPolygon && !m_polygons.empty(); i++) {
+        for (float &e : box) {
+            e = std::max(e * 2.f, m_config.cellSize);
+        }
+        found = FindPolygon(point, box, nearest);
+    }
+    return found;
+}
+
+size_t NavMesh::MemoryBytes() const {
+    return m_tileStart.capacity() * 4 + m_vertices.capacity() * 4 + m_polygons.capacity() * sizeof(Polygon) +
+           m_links.capacity() * sizeof(Link);
+}
+
+NavQuery::NavQuery(const NavMesh &mesh) : m_mesh(mesh) {}
+
+bool NavQuery::FindPath(const float start[3], const float end[3], const float extents[3], NavPath &path) {
+    path.points.clear();
+    path.polygons.clear();
+    path.length = 0.f;
+    path.linkLength = 0.f;
+    m_visited = 0;
+
+    float from[3], to[3];
+    const std::uint32_t first = m_mesh.FindNearestPolygon(start, extents, from);
+    const std::uint32_t last = m_mesh.FindNearestPolygon(end, extents, to);
+    if (first == NavMesh::NoPolygon || last == NavMesh::NoPolygon) {
+        return false;
+    }
+
+    const std::vector<NavMesh::Polygon> &polygons = m_mesh.Polygons();
+    const std::vector<NavMesh::Link> &links = m_mesh.Links();
+    if (m_nodes.size() != polygons.size()) {
+        m_nodes.assign(polygons.size(), {});
+        m_stamp = 0;
+    }
+    if (++m_stamp == 0) {
+        for (Node &node : m_nodes) {
+            node.stamp = 0;
+        }
+        m_stamp = 1;
+    }
+    auto node = [&](std::uint32_t polygon) -> Node & {
+        Node &n = m_nodes[polygon];
+        if (n.stamp != m_stamp) {
+            n = {FLT_MAX, FLT_MAX, {}, NavMesh::NoPolygon, m_stamp, false};
+        }
+        return n;
+    };
+
+    // Polygons are reached at the middle of the portal they are entered by,
+    // and opened again when a cheaper way in turns up
+    Node &startNode = node(first);
+    startNode.cost = 0.f;
+    startNode.total = Distance(from, to) * HeuristicScale;
+    std::copy_n(from, 3, startNode.position);
+    m_open.assign(1, {startNode.total, first});
+    auto later = [](const std::pair<float, std::uint32_t> &a, const std::pair<float, std::uint32_t> &b) {
+        return a.first > b.first;
+    };
+    bool found = false;
+    while (!m_open.empty()) {
+        std::pop_heap(m_open.begin(), m_open.end(), later);
+        const auto [total, polygon] = m_open.back();
+        m_open.pop_back();
+        Node &current = m_nodes[polygon];
+        if (current.closed || total > current.total) {
+            continue;
+        }
+        current.closed = true;
+        m_visited++;
+        if (polygon == last) {
+            found = true;
+            break;
+        }
+
+        const NavMesh::Polygon &p = polygons[polygon];
+        for (std::uint32_t l = p.firstLink; l < p.firstLink + p.linkCount; l++) {
+            const NavMesh::Link &link = links[l];
+            const float middle[3] = {(link.a[0] + link.b[0]) * 0.5f, (link.a[1] + link.b[1]) * 0.5f,
+                                     (link.a[2] + link.b[2]) * 0.5f};
+            float cost = current.cost + Distance(current.position, middle);
+            if (link.polygon == last) {
+                cost += Distance(middle, to);
+            }
+            Node &next = node(link.polygon);
+            if (cost >= next.cost) {
+                continue;
+            }
+            next.cost = cost;
+            next.total = link.polygon == last ? cost : cost + Distance(middle, to) * HeuristicScale;
+            next.parent = polygon;
+            next.closed = false;
+            std::copy_n(middle, 3, next.position);
+            m_open.push_back({next.total, link.polygon});
+            std::push_heap(m_open.begin(), m_open.end(), later);
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    for (std::uint32_t polygon = last; polygon != NavMesh::NoPolygon; polygon = m_nodes[polygon].parent) {
+        path.polygons.push_back(polygon);
+    }
+    std::reverse(path.polygons.begin(), path.polygons.end());
+    Funnel(from, to, path);
+    return true;
+}
+
+// Shortest line through the portals of the corridor, pulled taut around
+// their ends, then cut where it crosses every portal so heights follow the
+// polygons
+void NavQuery::Funnel(const float start[3], const float end[3], NavPath &path) {
+    const std::vector<NavMesh::Polygon> &polygons = m_mesh.Polygons();
+    const std::vector<NavMesh::Link> &links = m_mesh.Links();
+    m_left.assign(1, {start[0], start[1], start[2]});
+    m_right.assign(1, {start[0], start[1], start[2]});
+    for (size_t i = 0; i + 1 < path.polygons.size(); i++) {
+        const NavMesh::Polygon &polygon = polygons[path.polygons[i]];
+        const NavMesh::Link *link = nullptr;
+        for (std::uint32_t l = polygon.firstLink; l < polygon.firstLink + polygon.linkCount && !link; l++) {
+            link = links[l].polygon == path.polygons[i + 1] ? &links[l] : nullptr;
+        }
+        path.linkLength += link->gap;
+        const float middle[3] = {(link->a[0] + link->b[0]) * 0.5f, 0.f, (link->a[2] + link->b[2]) * 0.5f};
+        const bool aLeft = Cross(polygon.center, middle, link->a) > 0.f;
+        const float *left = aLeft ? link->a : link->b, *right = aLeft ? link->b : link->a;
+        m_left.push_back({left[0], left[1], left[2]});
+        m_right.push_back({right[0], right[1], right[2]});
+    }
+    m_left.push_back({end[0], end[1], end[2]});
+    m_right.push_back({end[0], end[1], end[2]});
+
+    // Corners with the portal they lie on
+    std::vector<std::pair<std::array<float, 3>, size_t>> corners = {{m_left[0], 0}};
+    std::array<float, 3> apex = m_left[0], left = m_left[0], right = m_right[0];
+    size_t apexIndex = 0, leftIndex = 0, rightIndex = 0;
+    for (size_t i = 1; i < m_left.size(); i++) {
+        const std::array<float, 3> &l = m_left[i], &r = m_right[i];
+        if (Cross(apex.data(), right.data(), r.data()) >= 0.f) {
+            if (SamePoint(apex.data(), right.data()) || Cross(apex.data(), left.data(), r.data()) < 0.f) {
+                right = r;
+                rightIndex = i;
+            } else {
+                apex = left;
+                apexIndex = leftIndex;
+                corners.push_back({apex, apexIndex});
+                left = right = apex;
+                leftIndex = rightIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+        if (Cross(apex.data(), left.data(), l.data()) <= 0.f) {
+            if (SamePoint(apex.data(), left.data()) || Cross(apex.data(), right.data(), l.data()) > 0.f) {
+                left = l;
+                leftIndex = i;
+            } else {
+                apex = right;
+                apexIndex = rightIndex;
+                corners.push_back({apex, apexIndex});
+                left = right = apex;
+                leftIndex = rightIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+    }
+    if (!SamePosition(corners.back().first.data(), end) || corners.size() == 1) {
+        corners.push_back({m_left.back(), m_left.size() - 1});
+    }
+
+    path.points.push_back(corners[0].first);
+    for (size_t c = 1; c < corners.size(); c++) {
+        const float *a = corners[c - 1].first.data(), *b = corners[c].first.data();
+        for (size_t portal = corners[c - 1].second + 1; portal < corners[c].second; portal++) {
+            // Where ab crosses the portal, at the portal's height there
+            const float *p = m_left[portal].data(), *q = m_right[portal].data();
+            const float ex = b[0] - a[0], ez = b[2] - a[2], fx = q[0] - p[0], fz = q[2] - p[2];
+            const float denominator = ex * fz - ez * fx;
+            if (std::abs(denominator) < 1e-9f) {
+                continue;
+            }
+            const float t = std::clamp(((p[0] - a[0]) * fz - (p[2] - a[2]) * fx) / denominator, 0.f, 1.f);
+            const float u = std::clamp(((p[0] - a[0]) * ez - (p[2] - a[2]) * ex) / denominator, 0.f, 1.f);
+            const std::array<float, 3> crossing = {a[0] + ex * t, p[1] + (q[1] - p[1]) * u, a[2] + ez * t};
+            if (!SamePosition(crossing.data(), path.points.back().data())) {
+                path.points.push_back(crossing);
+            }
+        }
+        if (!SamePosition(corners[c].first.data(), path.points.back().data())) {
+            path.points.push_back(corners[c].first);
+        }
+    }
+    for (size_t i = 1; i < path.points.size(); i++) {
+        path.length += Distance(path.points[i - 1].data(), path.points[i].data());
+    }
+    path.linkLength = std::min(path.linkLength, path.length);
+}
@@ -0,0 +1,899 @@
+#include "PngDecoder.h"
+
+#include "Utility.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PNG_SSE2 1
+#endif
+
+// Only in builds for AVX2 machines, -mavx2 or /arch:AVX2
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PNG_AVX2 1
+#endif
+
+namespace {
+[[noreturn]] void Fail(const char *message) { throw std::runtime_error(std::string("PNG: ") + message); }
+
+std::uint32_t ReadBE32(const std::uint8_t *p) {
+    return ((std::uint32_t)p[0] << 24) | ((std::uint32_t)p[1] << 16) | ((std::uint32_t)p[2] << 8) | p[3];
+}
+
+// Largest width or height accepted, the largest texture D3D12 can create
+const std::uint32_t MaxDimension = 16384;
+// Deflate expands 2 bits to at most 258 bytes, image data asking for more
+// than this many times its compressed size is corrupt
+const size_t MaxInflateRatio = 1032;
+
+// CRC-32 of a chunk, over its type and data
+std::uint32_t ChunkCrc(const std::uint8_t *data, size_t size) {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> t{};
+        for (std::uint32_t n = 0; n < 256; n++) {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+    std::uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Inflate
+
+class BitReader {
+public:
+    BitReader(const std::uint8_t *data, size_t size) : m_p(data), m_end(data + size) {}
+
+    // Keeps at least 57 bits buffered, bytes past the end read as zeros and
+    // are checked for once a block is done
+    void Refill() {
+        while (m_count <= 56) {
+            std::uint64_t byte = 0;
+            if (m_p < m_end) {
+                byte = *m_p++;
+            } else {
+                m_overrun++;
+            }
+            m_bits |= byte << m_count;
+            m_count += 8;
+        }
+    }
+
+    std::uint32_t Peek(int count) const { return (std::uint32_t)(m_bits & ((1ull << count) - 1)); }
+    void Consume(int count) {
+        m_bits >>= count;
+        m_count -= count;
+    }
+
+    std::uint32_t Bits(int count) {
+        if (m_count < count) {
+            Refill();
+        }
+        const std::uint32_t value = Peek(count);
+        Consume(count);
+        return value;
+    }
+
+    void AlignToByte() { Consume(m_count & 7); }
+
+    // Whole bytes, only valid once aligned
+    void Copy(std::uint8_t *dst, size_t size) {
+        while (size > 0 && m_count > 0) {
+            *dst++ = (std::uint8_t)Bits(8);
+            size--;
+        }
+        if (size > (size_t)(m_end - m_p)) {
+            Fail("truncated stored block");
+        }
+        memcpy(dst, m_p, size);
+        m_p += size;
+    }
+
+    bool Overrun() const {
+        // Bytes still buffered were not consumed yet
+        return m_overrun > (size_t)m_count / 8;
+    }
+
+private:
+    const std::uint8_t *m_p;
+    const std::uint8_t *m_end;
+    std::uint64_t m_bits = 0;
+    int m_count = 0;
+    size_t m_overrun = 0;
+};
+
+std::uint32_t ReverseBits(std::uint32_t v, int count) {
+    v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+    v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+    v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+    v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+    return v >> (16 - count);
+}
+
+// Canonical Huffman decoding. Codes up to FastBits long resolve with one
+// table lookup, longer ones (rare in practice) walk the code lengths.
+class Huffman {
+public:
+    static const int FastBits = 10;
+
+    void Build(const std::uint8_t *lengths, int count) {
+        int sizes[17] = {};
+        for (int i = 0; i < count; i++) {
+            sizes[lengths[i]]++;
+        }
+        sizes[0] = 0;
+
+        std::fill_n(m_fast, 1 << FastBits, 0);
+        std::fill_n(m_size, 288, 0);
+        int nextCode[16] = {};
+        int code = 0;
+        int symbol = 0;
+        for (int i = 1; i < 16; i++) {
+            nextCode[i] = code;
+            m_firstCode[i] = (std::uint16_t)code;
+            m_firstSymbol[i] = (std::uint16_t)symbol;
+            code += sizes[i];
+            if (sizes[i] && code - 1 >= (1 << i)) {
+                Fail("bad code lengths");
+            }
+            m_maxCode[i] = code << (16 - i);
+            code <<= 1;
+            symbol += sizes[i];
+        }
+        m_maxCode[16] = 0x10000;
+
+        for (int i = 0; i < count; i++) {
+            const int length = lengths[i];
+            if (length == 0) {
+                continue;
+            }
+
+            const int c = nextCode[length] - m_firstCode[length] + m_firstSymbol[length];
+            m_size[c] = (std::uint8_t)length;
+            m_value[c] = (std::uint16_t)i;
+            if (length <= FastBits) {
+                const std::uint16_t entry = (std::uint16_t)((length << 9) | i);
+                for (std::uint32_t j = ReverseBits(nextCode[length], length); j < (1u << FastBits);
+                     j += 1 << length) {
+                    m_fast[j] = entry;
+                }
+            }
+            nextCode[length]++;
+        }
+    }
+
+    int Decode(BitReader &bits) const {
+        bits.Refill();
+        const std::uint16_t entry = m_fast[bits.Peek(FastBits)];
+        if (entry) {
+            bits.Consume(entry >> 9);
+            return entry & 511;
+        }
+
+        const std::uint32_t k = ReverseBits(bits.Peek(16), 16);
+        int length = FastBits + 1;
+        while (k >= (std::uint32_t)m_maxCode[length]) {
+            length++;
+        }
+        if (length >= 16) {
+            Fail("bad Huffman code");
+        }
+
+        const int c = (k >> (16 - length)) - m_firstCode[length] + m_firstSymbol[length];
+        if (c >= 288 || m_size[c] != length) {
+            Fail("bad Huffman code");
+        }
+        bits.Consume(length);
+        return m_value[c];
+    }
+
+private:
+    std::uint16_t m_fast[1 << FastBits];
+    std::uint16_t m_firstCode[16];
+    std::uint16_t m_firstSymbol[16];
+    int m_maxCode[17];
+    std::uint8_t m_size[288];
+    std::uint16_t m_value[288];
+};
+
+const std::uint16_t LengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const std::uint8_t LengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const std::uint16_t DistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                    1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+const std::uint8_t DistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct FixedTables {
+    Huffman lengths;
+    Huffman distances;
+
+    FixedTables() {
+        std::uint8_t sizes[288];
+        std::fill_n(sizes, 144, 8);
+        std::fill_n(sizes + 144, 112, 9);
+        std::fill_n(sizes + 256, 24, 7);
+        std::fill_n(sizes + 280, 8, 8);
+        lengths.Build(sizes, 288);
+
+        std::fill_n(sizes, 30, 5);
+        distances.Build(sizes, 30);
+    }
+};
+
+void InflateBlock(BitReader &bits, const Huffman &lengths, const Huffman &distances, std::uint8_t *out,
+                  size_t &pos, size_t outSize) {
+    for (;;) {
+        const int symbol = lengths.Decode(bits);
+        if (symbol < 256) {
+            if (pos >= outSize) {
+                Fail("too much image data");
+            }
+            out[pos++] = (std::uint8_t)symbol;
+            continue;
+        }
+        if (symbol == 256) {
+            return;
+        }
+        if (symbol > 285) {
+            Fail("bad length symbol");
+        }
+
+        const int l = symbol - 257;
+        const size_t length = LengthBase[l] + bits.Bits(LengthExtra[l]);
+        const int d = distances.Decode(bits);
+        if (d >= 30) {
+            Fail("bad distance symbol");
+        }
+        const size_t distance = DistBase[d] + bits.Bits(DistExtra[d]);
+        if (distance > pos || length > outSize - pos) {
+            Fail("bad back reference");
+        }
+
+        std::uint8_t *dst = out + pos;
+        const std::uint8_t *src = dst - distance;
+        if (distance >= length) {
+            memcpy(dst, src, length);
+        } else {
+            // Overlapping copies repeat the last bytes
+            for (size_t i = 0; i < length; i++) {
+                dst[i] = src[i];
+            }
+        }
+        pos += length;
+    }
+}
+
+// zlib stream into a buffer of the exact expected size
+void Inflate(const std::uint8_t *data, size_t size, std::uint8_t *out, size_t outSize) {
+    if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32)) {
+        Fail("bad zlib header");
+    }
+    BitReader bits(data + 2, size - 2);
+
+    static const FixedTables fixed;
+
+    size_t pos = 0;
+    bool last = false;
+    while (!last) {
+        last = bits.Bits(1);
+        const std::uint32_t type = bits.Bits(2);
+
+        if (type == 0) {
+            bits.AlignToByte();
+            const std::uint32_t length = bits.Bits(16);
+            const std::uint32_t inverse = bits.Bits(16);
+            if ((length ^ 0xFFFF) != inverse || length > outSize - pos) {
+                Fail("bad stored block");
+            }
+            bits.Copy(out + pos, length);
+            pos += length;
+        } else if (type == 1) {
+            InflateBlock(bits, fixed.lengths, fixed.distances, out, pos, outSize);
+        } else if (type == 2) {
+            const int literalCount = bits.Bits(5) + 257;
+            const int distanceCount = bits.Bits(5) + 1;
+            const int codeLengthCount = bits.Bits(4) + 4;
+
+            static const std::uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+                                                   11, 4,  12, 3, 13, 2, 14, 1, 15};
+            std::uint8_t codeLengths[19] = {};
+            for (int i = 0; i < codeLengthCount; i++) {
+                codeLengths[order[i]] = (std::uint8_t)bits.Bits(3);
+            }
+            Huffman codeLengthTable;
+            codeLengthTable.Build(codeLengths, 19);
+
+            std::uint8_t lengths[286 + 30] = {};
+            int n = 0;
+            while (n < literalCount + distanceCount) {
+                const int symbol = codeLengthTable.Decode(bits);
+                if (symbol < 16) {
+                    lengths[n++] = (std::uint8_t)symbol;
+                    continue;
+                }
+
+                int repeat = 0;
+                std::uint8_t value = 0;
+                if (symbol == 16) {
+                    if (n == 0) {
+                        Fail("bad code lengths");
+                    }
+                    repeat = 3 + bits.Bits(2);
+                    value = lengths[n - 1];
+                } else if (symbol == 17) {
+                    repeat = 3 + bits.Bits(3);
+                } else {
+                    repeat = 11 + bits.Bits(7);
+                }
+                if (n + repeat > literalCount + distanceCount) {
+                    Fail("bad code lengths");
+                }
+                std::fill_n(lengths + n, repeat, value);
+                n += repeat;
+            }
+
+            Huffman literalTable, distanceTable;
+            literalTable.Build(lengths, literalCount);
+            distanceTable.Build(lengths + literalCount, distanceCount);
+            InflateBlock(bits, literalTable, distanceTable, out, pos, outSize);
+        } else {
+            Fail("bad block type");
+        }
+
+        if (bits.Overrun()) {
+            Fail("truncated image data");
+        }
+    }
+
+    if (pos != outSize) {
+        Fail("not enough image data");
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Unfiltering, rows are undone in place with the previous unfiltered row
+
+enum Filter { Filter_None, Filter_Sub, Filter_Up, Filter_Average, Filter_Paeth };
+
+std::uint8_t Paeth(int a, int b, int c) {
+    const int pa = std::abs(b - c);
+    const int pb = std::abs(a - c);
+    const int pc = std::abs(a + b - 2 * c);
+    if (pa <= pb && pa <= pc) {
+        return (std::uint8_t)a;
+    }
+    return (std::uint8_t)(pb <= pc ? b : c);
+}
+
+void UnfilterScalar(int filter, std::uint8_t *row, const std::uint8_t *prev, size_t size, int bpp) {
+    switch (filter) {
+    case Filter_Sub:
+        for (size_t i = bpp; i < size; i++) {
+            row[i] += row[i - bpp];
+        }
+        break;
+    case Filter_Up:
+        for (size_t i = 0; i < size; i++) {
+            row[i] += prev[i];
+        }
+        break;
+    case Filter_Average:
+        for (size_t i = 0; i < size; i++) {
+            const int left = i >= (size_t)bpp ? row[i - bpp] : 0;
+            row[i] += (std::uint8_t)((left + prev[i]) >> 1);
+        }
+        break;
+    case Filter_Paeth:
+        for (size_t i = 0; i < size; i++) {
+            const int left = i >= (size_t)bpp ? row[i - bpp] : 0;
+            const int upLeft = i >= (size_t)bpp ? prev[i - bpp] : 0;
+            row[i] += Paeth(left, prev[i], upLeft);
+        }
+        break;
+    }
+}
+
+#ifdef PNG_SSE2
+// Sub, Average and Paeth depend on the pixel on the left, so only the bytes of
+// one pixel are done at once. Up has no such dependency and runs 16 bytes at
+// a time. Same approach as libpng's SSE2 filters.
+
+__m128i LoadPixel(const std::uint8_t *p, int bpp) {
+    std::uint32_t v = 0;
+    memcpy(&v, p, bpp);
+    return _mm_cvtsi32_si128((int)v);
+}
+
+void StorePixel(std::uint8_t *p, __m128i v, int bpp) {
+    const std::uint32_t value = (std::uint32_t)_mm_cvtsi128_si32(v);
+    memcpy(p, &value, bpp);
+}
+
+__m128i Abs16(__m128i v) { return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v)); }
+
+// Any filter but None, bpp is 3 or 4 unless filter is Up
+void UnfilterSse2(int filter, std::uint8_t *row, const std::uint8_t *prev, size_t size, int bpp) {
+    const __m128i zero = _mm_setzero_si128();
+
+    if (filter == Filter_Up) {
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            const __m128i r = _mm_loadu_si128((const __m128i *)(row + i));
+            const __m128i p = _mm_loadu_si128((const __m128i *)(prev + i));
+            _mm_storeu_si128((__m128i *)(row + i), _mm_add_epi8(r, p));
+        }
+        for (; i < size; i++) {
+            row[i] += prev[i];
+        }
+        return;
+    }
+
+    __m128i a = zero; // Left
+    __m128i c = zero; // Up left
+    for (size_t i = 0; i < size; i += bpp) {
+        __m128i x = LoadPixel(row + i, bpp);
+        const __m128i b = LoadPixel(prev + i, bpp);
+
+        if (filter == Filter_Sub) {
+            x = _mm_add_epi8(x, a);
+        } else if (filter == Filter_Average) {
+            // avg_epu8 rounds up, the filter rounds down
+            __m128i average = _mm_avg_epu8(a, b);
+            average = _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            x = _mm_add_epi8(x, average);
+        } else {
+            const __m128i a16 = _mm_unpacklo_epi8(a, zero);
+            const __m128i b16 = _mm_unpacklo_epi8(b, zero);
+            const __m128i c16 = _mm_unpacklo_epi8(c, zero);
+
+            const __m128i pa = Abs16(_mm_sub_epi16(b16, c16));
+            const __m128i pb = Abs16(_mm_sub_epi16(a16, c16));
+            const __m128i pc = Abs16(_mm_add_epi16(_mm_sub_epi16(b16, c16), _mm_sub_epi16(a16, c16)));
+
+            // a when pa <= pb and pa <= pc, else b when pb <= pc, else c
+            const __m128i all = _mm_set1_epi16(-1);
+            const __m128i aLoses = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+            const __m128i useA = _mm_andnot_si128(aLoses, all);
+            const __m128i useB = _mm_andnot_si128(_mm_cmpgt_epi16(pb, pc), all);
+            __m128i predictor = _mm_or_si128(_mm_and_si128(useB, b16), _mm_andnot_si128(useB, c16));
+            predictor = _mm_or_si128(_mm_and_si128(useA, a16), _mm_andnot_si128(useA, predictor));
+
+            x = _mm_add_epi8(x, _mm_packus_epi16(predictor, predictor));
+            c = b;
+        }
+
+        StorePixel(row + i, x, bpp);
+        a = x;
+    }
+}
+#endif
+
+#ifdef PNG_AVX2
+// Up runs 32 bytes at a time. Sub is a running sum, so the whole pixels in
+// 16 bytes are summed in a few shifted adds and carried on from the pixel
+// before them. Paeth still needs the unfiltered left pixel, but the terms of
+// the previous row are worked out for 16 bytes at once, leaving a pixel
+// fewer steps. Average rounds every sum down, which doesn't carry over like
+// Sub, and stays on the SSE2 loop.
+
+void UpAvx2(std::uint8_t *row, const std::uint8_t *prev, size_t size) {
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i r = _mm256_loadu_si256((const __m256i *)(row + i));
+        const __m256i p = _mm256_loadu_si256((const __m256i *)(prev + i));
+        _mm256_storeu_si256((__m256i *)(row + i), _mm256_add_epi8(r, p));
+    }
+    for (; i < size; i++) {
+        row[i] += prev[i];
+    }
+}
+
+// Whole pixels of Bpp bytes in 16
+template <int Bpp> constexpr size_t PixelBytes = 16 / Bpp * Bpp;
+
+template <int Bpp> void SubAvx2(std::uint8_t *row, size_t size) {
+    // The last pixel of the previous 16 bytes over all of them, and the bytes
+    // past the whole pixels left as they were
+    const __m128i repeat = Bpp == 4 ? _mm_setr_epi8(0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3)
+                                    : _mm_setr_epi8(0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, -1);
+    const __m128i whole = _mm_srli_si128(_mm_set1_epi8(-1), 16 - (int)PixelBytes<Bpp>);
+    __m128i left = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += PixelBytes<Bpp>) {
+        const __m128i raw = _mm_loadu_si128((const __m128i *)(row + i));
+        __m128i x = _mm_add_epi8(raw, _mm_slli_si128(raw, Bpp));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 2 * Bpp));
+        if constexpr (Bpp == 3) {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4 * Bpp));
+        }
+        x = _mm_add_epi8(x, _mm_shuffle_epi8(left, repeat));
+        x = _mm_blendv_epi8(raw, x, whole);
+        _mm_storeu_si128((__m128i *)(row + i), x);
+        left = _mm_srli_si128(x, (int)PixelBytes<Bpp> - Bpp);
+    }
+    for (i = std::max(i, (size_t)Bpp); i < size; i++) {
+        row[i] += row[i - Bpp];
+    }
+}
+
+template <int Bpp> void PaethAvx2(std::uint8_t *row, const std::uint8_t *prev, size_t size) {
+    // b, c, b - c and |b - c| of 16 bytes, as 16 bit lanes
+    alignas(32) std::int16_t terms[4][16];
+    __m128i a = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= size; i += PixelBytes<Bpp>) {
+        const __m128i up = _mm_loadu_si128((const __m128i *)(prev + i));
+        const __m128i upLeft =
+            i ? _mm_loadu_si128((const __m128i *)(prev + i - Bpp)) : _mm_slli_si128(up, Bpp);
+        const __m256i b = _mm256_cvtepu8_epi16(up);
+        const __m256i c = _mm256_cvtepu8_epi16(upLeft);
+        const __m256i bc = _mm256_sub_epi16(b, c);
+        _mm256_store_si256((__m256i *)terms[0], b);
+        _mm256_store_si256((__m256i *)terms[1], c);
+        _mm256_store_si256((__m256i *)terms[2], bc);
+        _mm256_store_si256((__m256i *)terms[3], _mm256_abs_epi16(bc));
+
+        for (int lane = 0; lane < (int)PixelBytes<Bpp>; lane += Bpp) {
+            const __m128i b16 = _mm_loadl_epi64((const __m128i *)(terms[0] + lane));
+            const __m128i c16 = _mm_loadl_epi64((const __m128i *)(terms[1] + lane));
+            const __m128i bc16 = _mm_loadl_epi64((const __m128i *)(terms[2] + lane));
+            const __m128i pa = _mm_loadl_epi64((const __m128i *)(terms[3] + lane));
+            const __m128i ac = _mm_sub_epi16(a, c16);
+            const __m128i pb = _mm_abs_epi16(ac);
+            const __m128i pc = _mm_abs_epi16(_mm_add_epi16(ac, bc16));
+
+            // a when pa <= pb and pa <= pc, else b when pb <= pc, else c
+            const __m128i aLoses = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+            const __m128i predictor = _mm_blendv_epi8(a, _mm_blendv_epi8(b16, c16, _mm_cmpgt_epi16(pb, pc)),
+                                                      aLoses);
+            std::uint8_t *pixel = row + i + lane;
+            const __m128i x = _mm_add_epi8(LoadPixel(pixel, Bpp), _mm_packus_epi16(predictor, predictor));
+            StorePixel(pixel, x, Bpp);
+            a = _mm_cvtepu8_epi16(x);
+        }
+    }
+    for (; i < size; i++) {
+        const int left = i >= (size_t)Bpp ? row[i - Bpp] : 0;
+        const int upLeft = i >= (size_t)Bpp ? prev[i - Bpp] : 0;
+        row[i] += Paeth(left, prev[i], upLeft);
+    }
+}
+
+// Up, or Sub and Paeth with bpp 3 or 4
+void UnfilterAvx2(int filter, std::uint8_t *row, const std::uint8_t *prev, size_t size, int bpp) {
+    if (filter == Filter_Up) {
+        UpAvx2(row, prev, size);
+    } else if (filter == Filter_Sub) {
+        bpp == 4 ? SubAvx2<4>(row, size) : SubAvx2<3>(row, size);
+    } else {
+        bpp == 4 ? PaethAvx2<4>(row, prev, size) : PaethAvx2<3>(row, prev, size);
+    }
+}
+#endif
+
+void Unfilter(int filter, std::uint8_t *row, const std::uint8_t *prev, size_t size, int bpp) {
+    if (filter > Filter_Paeth) {
+        Fail("bad filter type");
+    }
+    if (filter == Filter_None) {
+        return;
+    }
+#ifdef PNG_AVX2
+    if (((bpp == 3 || bpp == 4) && filter != Filter_Average) || filter == Filter_Up) {
+        UnfilterAvx2(filter, row, prev, size, bpp);
+        return;
+    }
+#endif
+#ifdef PNG_SSE2
+    if (bpp == 3 || bpp == 4 || filter == Filter_Up) {
+        UnfilterSse2(filter, row, prev, size, bpp);
+        return;
+    }
+#endif
+    UnfilterScalar(filter, row, prev, size, bpp);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Conversion of unfiltered rows to RGBA
+
+enum ColorType {
+    ColorType_Gray = 0,
+    ColorType_Rgb = 2,
+    ColorType_Palette = 3,
+    ColorType_GrayAlpha = 4,
+    ColorType_Rgba = 6,
+};
+
+struct Header {
+    std::uint32_t width;
+    std::uint32_t height;
+    int depth;
+    int colorType;
+    bool interlaced;
+    int channels;
+
+    std::uint8_t palette[256][4];
+    int paletteSize = 0;
+    // Color key from tRNS for gray and RGB images, in sample values
+    bool hasKey = false;
+    std::uint16_t key[3] = {};
+
+    size_t RowBytes(std::uint32_t pixels) const { return ((size_t)pixels * channels * depth + 7) / 8; }
+    int FilterBpp() const { return std::max(1, channels * depth / 8); }
+};
+
+std::uint16_t Sample(const std::uint8_t *row, std::uint32_t index, int depth) {
+    switch (depth) {
+    case 16:
+        return (std::uint16_t)((row[index * 2] << 8) | row[index * 2 + 1]);
+    case 8:
+        return row[index];
+    default: {
+        const std::uint32_t bit = index * depth;
+        return (std::uint16_t)((row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1));
+    }
+    }
+}
+
+void ConvertRow(const Header &h, const std::uint8_t *row, std::uint32_t width, std::uint8_t *out) {
+    if (h.colorType == ColorType_Rgba && h.depth == 8) {
+        memcpy(out, row, (size_t)width * 4);
+        return;
+    }
+    if (h.colorType == ColorType_Rgb && h.depth == 8 && !h.hasKey) {
+        for (std::uint32_t x = 0; x < width; x++) {
+            out[x * 4 + 0] = row[x * 3 + 0];
+            out[x * 4 + 1] = row[x * 3 + 1];
+            out[x * 4 + 2] = row[x * 3 + 2];
+            out[x * 4 + 3] = 255;
+        }
+        return;
+    }
+
+    // Samples are scaled to 8 bits, 16 bit ones keep their high byte
+    const int scale = h.depth < 8 ? 255 / ((1 << h.depth) - 1) : 1;
+    auto to8 = [&](std::uint16_t v) { return (std::uint8_t)(h.depth == 16 ? v >> 8 : v * scale); };
+
+    for (std::uint32_t x = 0; x < width; x++) {
+        std::uint8_t *px = out + x * 4;
+        switch (h.colorType) {
+        case ColorType_Gray: {
+            const std::uint16_t v = Sample(row, x, h.depth);
+            px[0] = px[1] = px[2] = to8(v);
+            px[3] = h.hasKey && v == h.key[0] ? 0 : 255;
+            break;
+        }
+        case ColorType_Rgb: {
+            const std::uint16_t r = Sample(row, x * 3, h.depth);
+            const std::uint16_t g = Sample(row, x * 3 + 1, h.depth);
+            const std::uint16_t b = Sample(row, x * 3 + 2, h.depth);
+            px[0] = to8(r);
+            px[1] = to8(g);
+            px[2] = to8(b);
+            px[3] = h.hasKey && r == h.key[0] && g == h.key[1] && b == h.key[2] ? 0 : 255;
+            break;
+        }
+        case ColorType_Palette: {
+            const std::uint16_t index = Sample(row, x, h.depth);
+            if (index >= h.paletteSize) {
+                Fail("palette index out of range");
+            }
+            memcpy(px, h.palette[index], 4);
+            break;
+        }
+        case ColorType_GrayAlpha:
+            px[0] = px[1] = px[2] = to8(Sample(row, x * 2, h.depth));
+            px[3] = to8(Sample(row, x * 2 + 1, h.depth));
+            break;
+        case ColorType_Rgba:
+            for (int c = 0; c < 4; c++) {
+                px[c] = to8(Sample(row, x * 4 + c, h.depth));
+            }
+            break;
+        }
+    }
+}
+
+Header ReadHeader(const std::uint8_t *p, std::uint32_t length) {
+    if (length != 13) {
+        Fail("bad IHDR");
+    }
+
+    Header h{};
+    h.width = ReadBE32(p);
+    h.height = ReadBE32(p + 4);
+    h.depth = p[8];
+    h.colorType = p[9];
+    h.interlaced = p[12] == 1;
+    if (h.width == 0 || h.height == 0 || h.width > MaxDimension || h.height > MaxDimension) {
+        Fail("bad image size");
+    }
+    if (p[10] != 0 || p[11] != 0 || p[12] > 1) {
+        Fail("unsupported compression, filter or interlace method");
+    }
+
+    static const int channels[7] = {1, 0, 3, 1, 2, 0, 4};
+    h.channels = h.colorType <= 6 ? channels[h.colorType] : 0;
+    const bool validDepth = (h.depth == 8 || h.depth == 16) ||
+                            ((h.colorType == ColorType_Gray || h.colorType == ColorType_Palette) &&
+                             (h.depth == 1 || h.depth == 2 || h.depth == 4));
+    if (h.channels == 0 || !validDepth || (h.colorType == ColorType_Palette && h.depth == 16)) {
+        Fail("bad color type or bit depth");
+    }
+    return h;
+}
+
+struct Pass {
+    std::uint32_t x0, y0, dx, dy;
+};
+} // namespace
+
+bool IsPng(const void *data, std::size_t size) {
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    return size >= 8 && memcmp(data, signature, 8) == 0;
+}
+
+std::vector<std::uint8_t> DecodePng(const void *data, std::size_t size, int rowAlignment, int *outputWidth,
+                                    int *outputHeight) {
+    if (!IsPng(data, size)) {
+        Fail("not a PNG file");
+    }
+    const std::uint8_t *p = static_cast<const std::uint8_t *>(data) + 8;
+    const std::uint8_t *end = static_cast<const std::uint8_t *>(data) + size;
+
+    Header h{};
+    bool hasHeader = false;
+    std::vector<std::uint8_t> compressed;
+
+    while (end - p >= 12) {
+        const std::uint32_t length = ReadBE32(p);
+        const std::uint8_t *type = p + 4;
+        const std::uint8_t *chunk = p + 8;
+        if (length > (size_t)(end - chunk) - 4) {
+            Fail("truncated chunk");
+        }
+        p = chunk + length + 4;
+
+        // One flipped bit in IHDR turns a small icon into gigabytes. Image
+        // data is left to the checks of the inflater, its CRC would cost more
+        // than the rest of the decode.
+        if (memcmp(type, "IDAT", 4) != 0 && ChunkCrc(type, length + 4) != ReadBE32(chunk + length)) {
+            Fail("bad chunk CRC");
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            h = ReadHeader(chunk, length);
+            hasHeader = true;
+        } else if (!hasHeader) {
+            Fail("missing IHDR");
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length / 3 > 256) {
+                Fail("bad PLTE");
+            }
+            h.paletteSize = (int)(length / 3);
+            for (int i = 0; i < h.paletteSize; i++) {
+                h.palette[i][0] = chunk[i * 3];
+                h.palette[i][1] = chunk[i * 3 + 1];
+                h.palette[i][2] = chunk[i * 3 + 2];
+                h.palette[i][3] = 255;
+            }
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            if (h.colorType == ColorType_Palette) {
+                for (std::uint32_t i = 0; i < length && i < 256; i++) {
+                    h.palette[i][3] = chunk[i];
+                }
+            } else if (h.colorType == ColorType_Gray && length >= 2) {
+                h.hasKey = true;
+                h.key[0] = (std::uint16_t)((chunk[0] << 8) | chunk[1]);
+            } else if (h.colorType == ColorType_Rgb && length >= 6) {
+                h.hasKey = true;
+                for (int c = 0; c < 3; c++) {
+                    h.key[c] = (std::uint16_t)((chunk[c * 2] << 8) | chunk[c * 2 + 1]);
+                }
+            }
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 32)) {
+            Fail("unknown critical chunk");
+        }
+    }
+    if (!hasHeader || compressed.empty()) {
+        Fail("missing image data");
+    }
+    if (h.colorType == ColorType_Palette && h.paletteSize == 0) {
+        Fail("missing PLTE");
+    }
+
+    static const Pass adam7[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4},
+                                  {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2}};
+    static const Pass single[1] = {{0, 0, 1, 1}};
+    const Pass *passes = h.interlaced ? adam7 : single;
+    const int passCount = h.interlaced ? 7 : 1;
+
+    auto passSize = [&](const Pass &pass, std::uint32_t &w, std::uint32_t &hgt) {
+        w = h.width > pass.x0 ? (h.width - pass.x0 + pass.dx - 1) / pass.dx : 0;
+        hgt = h.height > pass.y0 ? (h.height - pass.y0 + pass.dy - 1) / pass.dy : 0;
+    };
+
+    size_t rawSize = 0;
+    for (int i = 0; i < passCount; i++) {
+        std::uint32_t w, hgt;
+        passSize(passes[i], w, hgt);
+        if (w > 0 && hgt > 0) {
+            rawSize += (size_t)hgt * (h.RowBytes(w) + 1);
+        }
+    }
+
+    if (rawSize / MaxInflateRatio > compressed.size()) {
+        Fail("image data too short for the image size");
+    }
+    std::vector<std::uint8_t> raw(rawSize);
+    Inflate(compressed.data(), compressed.size(), raw.data(), raw.size());
+
+    const size_t pitch = (size_t)RoundToNextMultiple(h.width, (std::uint32_t)rowAlignment) * 4;
+    std::vector<std::uint8_t> result(pitch * h.height);
+
+    const int bpp = h.FilterBpp();
+    std::vector<std::uint8_t> zeros(h.RowBytes(h.width));
+    std::vector<std::uint8_t> scattered;
+
+    std::uint8_t *src = raw.data();
+    for (int i = 0; i < passCount; i++) {
+        const Pass &pass = passes[i];
+        std::uint32_t w, hgt;
+        passSize(pass, w, hgt);
+        if (w == 0 || hgt == 0) {
+            continue;
+        }
+
+        const size_t rowBytes = h.RowBytes(w);
+        const std::uint8_t *prev = zeros.data();
+        scattered.resize((size_t)w * 4);
+
+        for (std::uint32_t y = 0; y < hgt; y++) {
+            std::uint8_t *row = src + 1;
+            Unfilter(src[0], row, prev, rowBytes, bpp);
+
+            std::uint8_t *out = result.data() + (pass.y0 + y * pass.dy) * pitch;
+            if (!h.interlaced) {
+                ConvertRow(h, row, w, out);
+            } else {
+                ConvertRow(h, row, w, scattered.data());
+                for (std::uint32_t x = 0; x < w; x++) {
+                    memcpy(out + (pass.x0 + x * pass.dx) * 4, &scattered[x * 4], 4);
+                }
+            }
+
+            prev = row;
+            src += rowBytes + 1;
+        }
+    }
+
+    if (outputWidth) {
+        *outputWidth = (int)h.width;
+    }
+    if (outputHeight) {
+        *outputHeight = (int)h.height;
+    }
+    return result;
+}
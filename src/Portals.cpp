@@ -0,0 +1,256 @@
+#include "Portals.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+
+namespace {
+// Deep enough for any chain of doors in the worlds, keeps the cost bounded
+// when many portals stay visible
+const std::uint32_t MaxDepth = 64;
+
+std::uint64_t CellKey(long x, long y, long z) {
+    const long offset = 1 << 20;
+    return ((std::uint64_t)(x + offset) << 42) | ((std::uint64_t)(y + offset) << 21) |
+           (std::uint64_t)(z + offset);
+}
+
+void Extend(Portal &portal, const float *p) {
+    for (int i = 0; i < 3; i++) {
+        portal.boundsMin[i] = std::min(portal.boundsMin[i], p[i]);
+        portal.boundsMax[i] = std::max(portal.boundsMax[i], p[i]);
+    }
+}
+
+enum class Projection { Outside, Inside, Straddles };
+
+// Screen rect (in NDC) covered by a box, boxes crossing the camera plane
+// cover the whole screen
+Projection ProjectBox(const float *m, const float *boundsMin, const float *boundsMax, float rect[4]) {
+    float clip[8][4];
+    int behind = 0;
+    for (int c = 0; c < 8; c++) {
+        const float v[3] = {c & 1 ? boundsMax[0] : boundsMin[0], c & 2 ? boundsMax[1] : boundsMin[1],
+                            c & 4 ? boundsMax[2] : boundsMin[2]};
+        for (int j = 0; j < 4; j++) {
+            clip[c][j] = v[0] * m[j] + v[1] * m[4 + j] + v[2] * m[8 + j] + m[12 + j];
+        }
+        behind += clip[c][3] <= 1e-3f;
+    }
+    if (behind == 8) {
+        return Projection::Outside;
+    }
+
+    // All corners on the outer side of one frustum plane
+    for (int axis = 0; axis < 2; axis++) {
+        bool allBelow = true, allAbove = true;
+        for (int c = 0; c < 8; c++) {
+            allBelow &= clip[c][axis] < -clip[c][3];
+            allAbove &= clip[c][axis] > clip[c][3];
+        }
+        if (allBelow || allAbove) {
+            return Projection::Outside;
+        }
+    }
+
+    if (behind > 0) {
+        rect[0] = rect[1] = -1.f;
+        rect[2] = rect[3] = 1.f;
+        return Projection::Straddles;
+    }
+
+    rect[0] = rect[1] = INFINITY;
+    rect[2] = rect[3] = -INFINITY;
+    for (int c = 0; c < 8; c++) {
+        const float x = clip[c][0] / clip[c][3];
+        const float y = clip[c][1] / clip[c][3];
+        rect[0] = std::min(rect[0], x);
+        rect[1] = std::min(rect[1], y);
+        rect[2] = std::max(rect[2], x);
+        rect[3] = std::max(rect[3], y);
+    }
+    return Projection::Inside;
+}
+} // namespace
+
+std::vector<Portal> ExtractPortals(const WorldMesh &mesh, const PortalDesc &desc) {
+    std::vector<std::uint32_t> roomOf(mesh.vertices.size());
+    for (std::uint32_t r = 0; r < mesh.rooms.size(); r++) {
+        std::fill_n(roomOf.begin() + mesh.rooms[r].firstVertex, mesh.rooms[r].vertexCount, r);
+    }
+
+    // Cells are as large as the tolerance, close vertices are then at most
+    // one cell apart on each axis
+    const float scale = 1.f / desc.tolerance;
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> cells;
+    for (std::uint32_t v = 0; v < mesh.vertices.size(); v++) {
+        const float *p = mesh.vertices[v].position;
+        cells[CellKey(std::lround(p[0] * scale), std::lround(p[1] * scale), std::lround(p[2] * scale))]
+            .push_back(v);
+    }
+
+    struct Touching {
+        Portal portal;
+        std::uint32_t count;
+    };
+    std::map<std::pair<std::uint32_t, std::uint32_t>, Touching> touching;
+    std::vector<std::uint32_t> near;
+
+    const float toleranceSq = desc.tolerance * desc.tolerance;
+    for (std::uint32_t v = 0; v < mesh.vertices.size(); v++) {
+        const float *p = mesh.vertices[v].position;
+        const long cx = std::lround(p[0] * scale);
+        const long cy = std::lround(p[1] * scale);
+        const long cz = std::lround(p[2] * scale);
+
+        // Rooms with a vertex close to this one, counted once per vertex
+        near.clear();
+        for (long x = cx - 1; x <= cx + 1; x++) {
+            for (long y = cy - 1; y <= cy + 1; y++) {
+                for (long z = cz - 1; z <= cz + 1; z++) {
+                    auto it = cells.find(CellKey(x, y, z));
+                    if (it == cells.end()) {
+                        continue;
+                    }
+                    for (std::uint32_t o : it->second) {
+                        if (roomOf[o] <= roomOf[v]) {
+                            continue;
+                        }
+                        const float *q = mesh.vertices[o].position;
+                        const float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+                        if (dx * dx + dy * dy + dz * dz > toleranceSq) {
+                            continue;
+                        }
+
+                        auto [entry, inserted] = touching.try_emplace({roomOf[v], roomOf[o]});
+                        Touching &t = entry->second;
+                        if (inserted) {
+                            t.portal = {roomOf[v], roomOf[o], {p[0], p[1], p[2]}, {p[0], p[1], p[2]}};
+                            t.count = 0;
+                        }
+                        Extend(t.portal, p);
+                        Extend(t.portal, q);
+                        if (std::find(near.begin(), near.end(), roomOf[o]) == near.end()) {
+                            near.push_back(roomOf[o]);
+                            t.count++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Door frames can be a single edge, padding keeps their screen rect from
+    // collapsing to a line
+    std::vector<Portal> portals;
+    for (const auto &[rooms, entry] : touching) {
+        if (entry.count >= desc.minVertices) {
+            Portal portal = entry.portal;
+            for (int i = 0; i < 3; i++) {
+                portal.boundsMin[i] -= desc.tolerance * 0.5f;
+                portal.boundsMax[i] += desc.tolerance * 0.5f;
+            }
+            portals.push_back(portal);
+        }
+    }
+    return portals;
+}
+
+void PortalCuller::Build(const WorldMesh &mesh, std::vector<Portal> portals) {
+    m_portals = std::move(portals);
+    m_rooms.assign(mesh.rooms.size(), {});
+
+    for (size_t i = 0; i < mesh.rooms.size(); i++) {
+        std::copy_n(mesh.rooms[i].boundsMin, 3, m_rooms[i].boundsMin);
+        std::copy_n(mesh.rooms[i].boundsMax, 3, m_rooms[i].boundsMax);
+    }
+    for (std::uint32_t i = 0; i < m_portals.size(); i++) {
+        m_rooms[m_portals[i].roomA].portals.push_back(i);
+        m_rooms[m_portals[i].roomB].portals.push_back(i);
+    }
+}
+
+void PortalCuller::Cull(const float *viewProjection, const float *eye,
+                        std::vector<std::uint32_t> &visibleRooms, PortalCullStats *stats) {
+    m_viewProjection = viewProjection;
+    m_onPath.assign(m_rooms.size(), false);
+    m_visible.assign(m_rooms.size(), false);
+    m_portalsTested = 0;
+
+    const int cameraRoom = FindRoom(eye);
+    if (cameraRoom >= 0) {
+        Visit(cameraRoom, {-1.f, -1.f, 1.f, 1.f}, 0);
+    } else {
+        // Looking at the map from outside, portals do not hide anything
+        for (std::uint32_t i = 0; i < m_rooms.size(); i++) {
+            float rect[4];
+            m_visible[i] = ProjectBox(viewProjection, m_rooms[i].boundsMin, m_rooms[i].boundsMax, rect) !=
+                           Projection::Outside;
+        }
+    }
+
+    visibleRooms.clear();
+    for (std::uint32_t i = 0; i < m_rooms.size(); i++) {
+        if (m_visible[i]) {
+            visibleRooms.push_back(i);
+        }
+    }
+
+    if (stats) {
+        stats->cameraRoom = cameraRoom;
+        stats->portalsTested = m_portalsTested;
+        stats->roomsVisible = (std::uint32_t)visibleRooms.size();
+    }
+}
+
+// Rooms bounds overlap, the smallest one holding the eye is the most likely
+int PortalCuller::FindRoom(const float *eye) const {
+    int best = -1;
+    float bestVolume = INFINITY;
+    for (std::uint32_t i = 0; i < m_rooms.size(); i++) {
+        const Room &room = m_rooms[i];
+        bool inside = true;
+        float volume = 1.f;
+        for (int j = 0; j < 3; j++) {
+            inside &= eye[j] >= room.boundsMin[j] && eye[j] <= room.boundsMax[j];
+            volume *= room.boundsMax[j] - room.boundsMin[j];
+        }
+        if (inside && volume < bestVolume) {
+            best = (int)i;
+            bestVolume = volume;
+        }
+    }
+    return best;
+}
+
+void PortalCuller::Visit(std::uint32_t room, const Rect &rect, std::uint32_t depth) {
+    m_visible[room] = true;
+    if (depth >= MaxDepth) {
+        return;
+    }
+
+    // Rooms already on the path are not entered again, other paths to the
+    // same room can still widen what is seen of it
+    m_onPath[room] = true;
+    for (std::uint32_t i : m_rooms[room].portals) {
+        const Portal &portal = m_portals[i];
+        const std::uint32_t next = portal.roomA == room ? portal.roomB : portal.roomA;
+        if (m_onPath[next]) {
+            continue;
+        }
+
+        m_portalsTested++;
+        float bounds[4];
+        if (ProjectBox(m_viewProjection, portal.boundsMin, portal.boundsMax, bounds) == Projection::Outside) {
+            continue;
+        }
+
+        const Rect clipped{std::max(rect.x0, bounds[0]), std::max(rect.y0, bounds[1]),
+                           std::min(rect.x1, bounds[2]), std::min(rect.y1, bounds[3])};
+        if (clipped.x0 < clipped.x1 && clipped.y0 < clipped.y1) {
+            Visit(next, clipped, depth + 1);
+        }
+    }
+    m_onPath[room] = false;
+}
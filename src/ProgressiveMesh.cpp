@@ -0,0 +1,722 @@
+#include "ProgressiveMesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+const char Magic[4] = {'M', 'P', 'P', 'M'};
+const std::uint32_t FormatVersion = 1;
+const size_t HeaderSize = 52;
+// Open edges are holes and outlines, they go last
+const double BoundaryWeight = 100.0;
+// Collapses that turn a face further than this (cosine) are not made
+const double MinFaceTurn = 0.2;
+// The base keeps this share of the faces, enough to make out the rooms
+const std::uint32_t BaseFaceDivisor = 32;
+
+void AppendBytes(std::vector<std::uint8_t> &out, const void *data, size_t size) {
+    const size_t offset = out.size();
+    out.resize(offset + size);
+    memcpy(out.data() + offset, data, size);
+}
+
+template <typename T> void Append(std::vector<std::uint8_t> &out, T value) {
+    AppendBytes(out, &value, sizeof(T));
+}
+
+void AppendVarint(std::vector<std::uint8_t> &out, std::uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((std::uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((std::uint8_t)value);
+}
+
+std::uint32_t ZigZag(std::int32_t value) {
+    return ((std::uint32_t)value << 1) ^ (std::uint32_t)(value >> 31);
+}
+
+std::int32_t UnZigZag(std::uint32_t value) { return (std::int32_t)(value >> 1) ^ -(std::int32_t)(value & 1); }
+
+// Reads what has arrived so far, running out of bytes is not an error
+class StreamReader {
+public:
+    StreamReader(const std::uint8_t *data, size_t size) : m_data(data), m_size(size) {}
+
+    std::uint8_t Byte() {
+        if (m_offset >= m_size) {
+            m_short = true;
+            return 0;
+        }
+        return m_data[m_offset++];
+    }
+
+    std::uint32_t Varint() {
+        std::uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            const std::uint8_t byte = Byte();
+            value |= (std::uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Bad varint in progressive mesh");
+    }
+
+    template <typename T> T Read() {
+        T value{};
+        if (m_offset + sizeof(T) > m_size) {
+            m_short = true;
+            m_offset = m_size;
+            return value;
+        }
+        memcpy(&value, m_data + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return value;
+    }
+
+    bool Short() const { return m_short; }
+    size_t Offset() const { return m_offset; }
+
+private:
+    const std::uint8_t *m_data;
+    size_t m_size;
+    size_t m_offset = 0;
+    bool m_short = false;
+};
+
+struct Vector3 {
+    double x, y, z;
+};
+
+Vector3 Subtract(const Vector3 &a, const Vector3 &b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+
+Vector3 Cross(const Vector3 &a, const Vector3 &b) {
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+double Dot(const Vector3 &a, const Vector3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+double Length(const Vector3 &a) { return std::sqrt(Dot(a, a)); }
+
+// Sum of squared distances to a set of planes (Garland and Heckbert)
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    void AddPlane(const Vector3 &n, double d, double weight) {
+        a2 += weight * n.x * n.x;
+        ab += weight * n.x * n.y;
+        ac += weight * n.x * n.z;
+        ad += weight * n.x * d;
+        b2 += weight * n.y * n.y;
+        bc += weight * n.y * n.z;
+        bd += weight * n.y * d;
+        c2 += weight * n.z * n.z;
+        cd += weight * n.z * d;
+        d2 += weight * d * d;
+    }
+
+    void Add(const Quadric &q) {
+        a2 += q.a2, ab += q.ab, ac += q.ac, ad += q.ad, b2 += q.b2;
+        bc += q.bc, bd += q.bd, c2 += q.c2, cd += q.cd, d2 += q.d2;
+    }
+
+    double Evaluate(const Vector3 &p) const {
+        const double value = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x +
+                             b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y + c2 * p.z * p.z +
+                             2 * cd * p.z + d2;
+        return std::max(value, 0.0);
+    }
+};
+
+// The same on both sides so the face order of every vertex, which the split
+// bits refer to, stays in step: the picked faces of u move to v in order,
+// added faces go to the end.
+void ApplySplit(std::vector<std::uint32_t> &faces, std::vector<std::vector<std::uint32_t>> &facesOf,
+                std::uint32_t u, std::uint32_t v, const std::uint8_t *moved,
+                const std::vector<std::pair<std::uint32_t, bool>> &added) {
+    std::vector<std::uint32_t> &ofU = facesOf[u];
+    std::vector<std::uint32_t> &ofV = facesOf[v];
+    size_t kept = 0;
+    for (size_t i = 0; i < ofU.size(); i++) {
+        const std::uint32_t face = ofU[i];
+        if (moved[i / 8] & (1 << (i % 8))) {
+            for (int corner = 0; corner < 3; corner++) {
+                if (faces[face * 3 + corner] == u) {
+                    faces[face * 3 + corner] = v;
+                }
+            }
+            ofV.push_back(face);
+        } else {
+            ofU[kept++] = face;
+        }
+    }
+    ofU.resize(kept);
+    for (const auto &[w, order] : added) {
+        const std::uint32_t face = (std::uint32_t)faces.size() / 3;
+        faces.push_back(u);
+        faces.push_back(order ? w : v);
+        faces.push_back(order ? v : w);
+        ofU.push_back(face);
+        ofV.push_back(face);
+        facesOf[w].push_back(face);
+    }
+}
+
+// Removing vertex x by moving it onto y, for the encoder
+struct Collapse {
+    std::uint32_t x, y;
+    // Faces that kept x, now on y
+    std::vector<std::uint32_t> moved;
+    // Faces with both, gone, and their corners before
+    std::vector<std::uint32_t> removed;
+    std::vector<std::array<std::uint32_t, 3>> removedCorners;
+    double cost;
+};
+
+struct Candidate {
+    double cost;
+    std::uint32_t x, y;
+    std::uint32_t stampX, stampY;
+
+    bool operator>(const Candidate &other) const { return cost > other.cost; }
+};
+
+class Simplifier {
+public:
+    Simplifier(std::vector<Vector3> positions, std::vector<std::uint32_t> faces)
+        : m_positions(std::move(positions)), m_faces(std::move(faces)) {
+        const std::uint32_t vertexCount = (std::uint32_t)m_positions.size();
+        const std::uint32_t faceCount = (std::uint32_t)m_faces.size() / 3;
+        m_facesOf.resize(vertexCount);
+        m_quadrics.resize(vertexCount);
+        m_stamps.assign(vertexCount, 0);
+        m_vertexAlive.assign(vertexCount, true);
+        m_faceAlive.assign(faceCount, true);
+        m_facesAlive = faceCount;
+
+        std::unordered_map<std::uint64_t, std::uint32_t> edgeUse;
+        for (std::uint32_t face = 0; face < faceCount; face++) {
+            const std::uint32_t *corners = &m_faces[face * 3];
+            Vector3 normal = FaceNormal(corners[0], corners[1], corners[2]);
+            const double length = Length(normal);
+            if (length > 0.0) {
+                normal = {normal.x / length, normal.y / length, normal.z / length};
+                const double d = -Dot(normal, m_positions[corners[0]]);
+                for (int corner = 0; corner < 3; corner++) {
+                    m_quadrics[corners[corner]].AddPlane(normal, d, 1.0);
+                }
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                m_facesOf[corners[corner]].push_back(face);
+                edgeUse[EdgeKey(corners[corner], corners[(corner + 1) % 3])]++;
+            }
+        }
+
+        // A plane through every open edge, upright on its face
+        for (std::uint32_t face = 0; face < faceCount; face++) {
+            const std::uint32_t *corners = &m_faces[face * 3];
+            const Vector3 normal = FaceNormal(corners[0], corners[1], corners[2]);
+            for (int corner = 0; corner < 3; corner++) {
+                const std::uint32_t a = corners[corner], b = corners[(corner + 1) % 3];
+                if (edgeUse[EdgeKey(a, b)] != 1) {
+                    continue;
+                }
+                Vector3 side = Cross(Subtract(m_positions[b], m_positions[a]), normal);
+                const double length = Length(side);
+                if (length == 0.0) {
+                    continue;
+                }
+                side = {side.x / length, side.y / length, side.z / length};
+                const double d = -Dot(side, m_positions[a]);
+                m_quadrics[a].AddPlane(side, d, BoundaryWeight);
+                m_quadrics[b].AddPlane(side, d, BoundaryWeight);
+            }
+        }
+    }
+
+    // Collapses cheapest first until faceCount faces are left or nothing can go
+    std::vector<Collapse> Run(std::uint32_t faceCount) {
+        for (std::uint32_t x = 0; x < m_positions.size(); x++) {
+            PushCandidates(x);
+        }
+        std::vector<Collapse> collapses;
+        while (!m_heap.empty() && m_facesAlive > faceCount) {
+            const Candidate candidate = m_heap.top();
+            m_heap.pop();
+            if (!m_vertexAlive[candidate.x] || !m_vertexAlive[candidate.y] ||
+                candidate.stampX != m_stamps[candidate.x] || candidate.stampY != m_stamps[candidate.y]) {
+                continue;
+            }
+            Apply(candidate.x, candidate.y, candidate.cost, collapses);
+        }
+        return collapses;
+    }
+
+    bool VertexAlive(std::uint32_t vertex) const { return m_vertexAlive[vertex]; }
+    bool FaceAlive(std::uint32_t face) const { return m_faceAlive[face]; }
+    const std::uint32_t *Corners(std::uint32_t face) const { return &m_faces[face * 3]; }
+
+private:
+    static std::uint64_t EdgeKey(std::uint32_t a, std::uint32_t b) {
+        return (std::uint64_t)std::min(a, b) << 32 | std::max(a, b);
+    }
+
+    Vector3 FaceNormal(std::uint32_t a, std::uint32_t b, std::uint32_t c) const {
+        return Cross(Subtract(m_positions[b], m_positions[a]), Subtract(m_positions[c], m_positions[a]));
+    }
+
+    // Infinite when moving x onto y folds or squashes a face that stays
+    double Cost(std::uint32_t x, std::uint32_t y) const {
+        for (std::uint32_t face : m_facesOf[x]) {
+            const std::uint32_t *corners = &m_faces[face * 3];
+            if (corners[0] == y || corners[1] == y || corners[2] == y) {
+                continue;
+            }
+            std::uint32_t moved[3] = {corners[0], corners[1], corners[2]};
+            std::replace(moved, moved + 3, x, y);
+            const Vector3 before = FaceNormal(corners[0], corners[1], corners[2]);
+            const Vector3 after = FaceNormal(moved[0], moved[1], moved[2]);
+            const double lengths = Length(before) * Length(after);
+            if (lengths == 0.0 || Dot(before, after) < MinFaceTurn * lengths) {
+                return std::numeric_limits<double>::infinity();
+            }
+        }
+        Quadric quadric = m_quadrics[x];
+        quadric.Add(m_quadrics[y]);
+        return quadric.Evaluate(m_positions[y]);
+    }
+
+    void PushCandidates(std::uint32_t x) {
+        for (std::uint32_t face : m_facesOf[x]) {
+            for (int corner = 0; corner < 3; corner++) {
+                const std::uint32_t y = m_faces[face * 3 + corner];
+                if (y == x) {
+                    continue;
+                }
+                const double cost = Cost(x, y);
+                if (cost != std::numeric_limits<double>::infinity()) {
+                    m_heap.push({cost, x, y, m_stamps[x], m_stamps[y]});
+                }
+            }
+        }
+    }
+
+    void Apply(std::uint32_t x, std::uint32_t y, double cost, std::vector<Collapse> &collapses) {
+        Collapse collapse{x, y, {}, {}, {}, cost};
+        for (std::uint32_t face : m_facesOf[x]) {
+            std::uint32_t *corners = &m_faces[face * 3];
+            if (corners[0] == y || corners[1] == y || corners[2] == y) {
+                collapse.removed.push_back(face);
+                collapse.removedCorners.push_back({corners[0], corners[1], corners[2]});
+                m_faceAlive[face] = false;
+                m_facesAlive--;
+                for (int corner = 0; corner < 3; corner++) {
+                    if (corners[corner] != x) {
+                        std::vector<std::uint32_t> &of = m_facesOf[corners[corner]];
+                        of.erase(std::find(of.begin(), of.end(), face));
+                    }
+                }
+            } else {
+                collapse.moved.push_back(face);
+                std::replace(corners, corners + 3, x, y);
+                m_facesOf[y].push_back(face);
+            }
+        }
+        m_facesOf[x].clear();
+        m_vertexAlive[x] = false;
+        m_quadrics[y].Add(m_quadrics[x]);
+
+        // Corners left without faces go right after, their split then comes
+        // just before the one that needs them instead of in the base
+        std::vector<std::uint32_t> orphans;
+        for (const std::array<std::uint32_t, 3> &corners : collapse.removedCorners) {
+            for (std::uint32_t w : corners) {
+                if (w != x && w != y && m_vertexAlive[w] && m_facesOf[w].empty()) {
+                    m_vertexAlive[w] = false;
+                    orphans.push_back(w);
+                }
+            }
+        }
+        collapses.push_back(std::move(collapse));
+        for (std::uint32_t w : orphans) {
+            collapses.push_back({w, y, {}, {}, {}, cost});
+        }
+
+        // Everything around y sees changed faces or a changed quadric
+        std::vector<std::uint32_t> around{y};
+        for (std::uint32_t face : m_facesOf[y]) {
+            for (int corner = 0; corner < 3; corner++) {
+                around.push_back(m_faces[face * 3 + corner]);
+            }
+        }
+        std::sort(around.begin(), around.end());
+        around.erase(std::unique(around.begin(), around.end()), around.end());
+        for (std::uint32_t vertex : around) {
+            m_stamps[vertex]++;
+        }
+        for (std::uint32_t vertex : around) {
+            PushCandidates(vertex);
+        }
+    }
+
+    std::vector<Vector3> m_positions;
+    std::vector<std::uint32_t> m_faces;
+    std::vector<std::vector<std::uint32_t>> m_facesOf;
+    std::vector<Quadric> m_quadrics;
+    std::vector<std::uint32_t> m_stamps;
+    std::vector<bool> m_vertexAlive;
+    std::vector<bool> m_faceAlive;
+    std::uint32_t m_facesAlive;
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> m_heap;
+};
+
+float Dequantize(std::uint16_t value, float boundsMin, float boundsMax) {
+    return boundsMin + (boundsMax - boundsMin) * (value / 65535.f);
+}
+} // namespace
+
+std::vector<std::uint8_t> EncodeProgressiveMesh(const WorldMesh &mesh, std::vector<float> *splitErrors) {
+    // Same bounds and quantization as the plain geometry file
+    float boundsMin[3] = {0.f, 0.f, 0.f};
+    float boundsMax[3] = {0.f, 0.f, 0.f};
+    if (!mesh.vertices.empty()) {
+        std::copy_n(mesh.vertices[0].position, 3, boundsMin);
+        std::copy_n(mesh.vertices[0].position, 3, boundsMax);
+    }
+    for (const MeshVertex &vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+        }
+    }
+
+    std::unordered_map<std::uint64_t, std::uint32_t> welded;
+    std::vector<std::array<std::uint16_t, 3>> quantized;
+    std::vector<std::uint32_t> vertexOf(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        std::array<std::uint16_t, 3> q;
+        for (int axis = 0; axis < 3; axis++) {
+            const float extent = boundsMax[axis] - boundsMin[axis];
+            const float t = extent > 0.f ? (mesh.vertices[i].position[axis] - boundsMin[axis]) / extent : 0.f;
+            q[axis] = (std::uint16_t)std::lround(std::clamp(t, 0.f, 1.f) * 65535.f);
+        }
+        const std::uint64_t key = (std::uint64_t)q[0] << 32 | (std::uint64_t)q[1] << 16 | q[2];
+        const auto [it, added] = welded.emplace(key, (std::uint32_t)quantized.size());
+        if (added) {
+            quantized.push_back(q);
+        }
+        vertexOf[i] = it->second;
+    }
+
+    // Room indices are relative to their first vertex, a mesh without rooms
+    // has them absolute
+    std::vector<std::uint32_t> absolute = mesh.indices;
+    for (const RoomMesh &room : mesh.rooms) {
+        for (std::uint32_t i = room.firstIndex; i < room.firstIndex + room.indexCount; i++) {
+            absolute[i] += room.firstVertex;
+        }
+    }
+    std::vector<std::uint32_t> faces;
+    for (size_t i = 0; i + 2 < absolute.size(); i += 3) {
+        const std::uint32_t a = vertexOf[absolute[i]];
+        const std::uint32_t b = vertexOf[absolute[i + 1]];
+        const std::uint32_t c = vertexOf[absolute[i + 2]];
+        if (a != b && b != c && a != c) {
+            faces.insert(faces.end(), {a, b, c});
+        }
+    }
+
+    // Vertices only degenerate faces used are left out
+    std::vector<std::uint32_t> compacted(quantized.size(), 0);
+    for (std::uint32_t vertex : faces) {
+        compacted[vertex] = 1;
+    }
+    std::uint32_t used = 0;
+    for (std::uint32_t vertex = 0; vertex < quantized.size(); vertex++) {
+        if (compacted[vertex]) {
+            quantized[used] = quantized[vertex];
+            compacted[vertex] = used++;
+        }
+    }
+    quantized.resize(used);
+    for (std::uint32_t &vertex : faces) {
+        vertex = compacted[vertex];
+    }
+
+    std::vector<Vector3> positions(quantized.size());
+    for (size_t i = 0; i < quantized.size(); i++) {
+        positions[i] = {Dequantize(quantized[i][0], boundsMin[0], boundsMax[0]),
+                        Dequantize(quantized[i][1], boundsMin[1], boundsMax[1]),
+                        Dequantize(quantized[i][2], boundsMin[2], boundsMax[2])};
+    }
+    Simplifier simplifier(positions, faces);
+    const std::uint32_t faceCount = (std::uint32_t)(faces.size() / 3);
+    const std::vector<Collapse> collapses = simplifier.Run(faceCount / BaseFaceDivisor);
+
+    // Numbered in order of appearance: the base, then the splits, which undo
+    // the collapses last to first
+    const std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+    std::vector<std::uint32_t> newVertex(quantized.size(), none);
+    std::vector<std::uint32_t> newFace(faceCount, none);
+    std::vector<std::uint32_t> baseVertices, baseFaces;
+    for (std::uint32_t vertex = 0; vertex < quantized.size(); vertex++) {
+        if (simplifier.VertexAlive(vertex)) {
+            newVertex[vertex] = (std::uint32_t)baseVertices.size();
+            baseVertices.push_back(vertex);
+        }
+    }
+    for (std::uint32_t face = 0; face < faceCount; face++) {
+        if (simplifier.FaceAlive(face)) {
+            newFace[face] = (std::uint32_t)baseFaces.size();
+            baseFaces.push_back(face);
+        }
+    }
+
+    std::vector<std::uint8_t> out;
+    AppendBytes(out, Magic, 4);
+    Append(out, FormatVersion);
+    Append(out, (std::uint32_t)baseVertices.size());
+    Append(out, (std::uint32_t)baseFaces.size());
+    Append(out, (std::uint32_t)collapses.size());
+    Append(out, (std::uint32_t)quantized.size());
+    Append(out, faceCount);
+    AppendBytes(out, boundsMin, sizeof(boundsMin));
+    AppendBytes(out, boundsMax, sizeof(boundsMax));
+
+    for (std::uint32_t vertex : baseVertices) {
+        AppendBytes(out, quantized[vertex].data(), 6);
+    }
+    // What the decoder will hold, to know the face order of every vertex
+    std::vector<std::uint32_t> decoded;
+    std::vector<std::vector<std::uint32_t>> facesOf(quantized.size());
+    for (std::uint32_t face : baseFaces) {
+        const std::uint32_t *corners = simplifier.Corners(face);
+        for (int corner = 0; corner < 3; corner++) {
+            AppendVarint(out, newVertex[corners[corner]]);
+            facesOf[newVertex[corners[corner]]].push_back((std::uint32_t)decoded.size() / 3);
+            decoded.push_back(newVertex[corners[corner]]);
+        }
+    }
+
+    if (splitErrors) {
+        splitErrors->clear();
+    }
+    std::uint32_t vertexCount = (std::uint32_t)baseVertices.size();
+    for (auto collapse = collapses.rbegin(); collapse != collapses.rend(); ++collapse) {
+        const std::uint32_t u = newVertex[collapse->y];
+        const std::uint32_t v = vertexCount++;
+        newVertex[collapse->x] = v;
+        AppendVarint(out, u);
+        for (int axis = 0; axis < 3; axis++) {
+            AppendVarint(out, ZigZag(quantized[collapse->x][axis] - quantized[collapse->y][axis]));
+        }
+        AppendVarint(out, (std::uint32_t)collapse->removed.size());
+
+        std::vector<std::uint8_t> moved((facesOf[u].size() + 7) / 8, 0);
+        for (size_t i = 0; i < facesOf[u].size(); i++) {
+            for (std::uint32_t face : collapse->moved) {
+                if (newFace[face] == facesOf[u][i]) {
+                    moved[i / 8] |= (std::uint8_t)(1 << (i % 8));
+                }
+            }
+        }
+        AppendBytes(out, moved.data(), moved.size());
+
+        std::vector<std::pair<std::uint32_t, bool>> added;
+        for (size_t i = 0; i < collapse->removed.size(); i++) {
+            const std::array<std::uint32_t, 3> &corners = collapse->removedCorners[i];
+            const int first = (int)(std::find(corners.begin(), corners.end(), collapse->y) - corners.begin());
+            const bool order = corners[(first + 1) % 3] != collapse->x;
+            const std::uint32_t w = newVertex[corners[(first + (order ? 1 : 2)) % 3]];
+            AppendVarint(out, w << 1 | (order ? 1 : 0));
+            added.emplace_back(w, order);
+            newFace[collapse->removed[i]] = (std::uint32_t)decoded.size() / 3 + (std::uint32_t)i;
+        }
+        ApplySplit(decoded, facesOf, u, v, moved.data(), added);
+        if (splitErrors) {
+            splitErrors->push_back((float)std::sqrt(collapse->cost));
+        }
+    }
+    return out;
+}
+
+bool ProgressiveMeshDecoder::ReadHeader(const std::uint8_t *data, std::size_t size, std::size_t &used) {
+    if (size < HeaderSize) {
+        return false;
+    }
+    if (memcmp(data, Magic, 4) != 0) {
+        throw std::runtime_error("Not a progressive mesh");
+    }
+    StreamReader reader(data + 4, HeaderSize - 4);
+    if (reader.Read<std::uint32_t>() != FormatVersion) {
+        throw std::runtime_error("Unsupported progressive mesh version");
+    }
+    m_baseVertices = reader.Read<std::uint32_t>();
+    m_baseFaces = reader.Read<std::uint32_t>();
+    m_splitCount = reader.Read<std::uint32_t>();
+    m_finalVertices = reader.Read<std::uint32_t>();
+    m_finalFaces = reader.Read<std::uint32_t>();
+    for (int axis = 0; axis < 3; axis++) {
+        m_boundsMin[axis] = reader.Read<float>();
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        m_boundsMax[axis] = reader.Read<float>();
+    }
+    if (m_baseVertices > m_finalVertices || m_baseFaces > m_finalFaces ||
+        (std::uint64_t)m_baseVertices + m_splitCount != m_finalVertices) {
+        throw std::runtime_error("Bad progressive mesh header");
+    }
+    used = HeaderSize;
+    m_hasHeader = true;
+    return true;
+}
+
+bool ProgressiveMeshDecoder::ReadBase(const std::uint8_t *data, std::size_t size, std::size_t &used) {
+    // At least a byte per index, nothing is allocated before that came
+    if (size < (std::uint64_t)m_baseVertices * 6 + (std::uint64_t)m_baseFaces * 3) {
+        return false;
+    }
+    StreamReader reader(data, size);
+    std::vector<std::uint16_t> quantized((size_t)m_baseVertices * 3);
+    for (std::uint16_t &value : quantized) {
+        value = reader.Read<std::uint16_t>();
+    }
+    std::vector<std::uint32_t> faces((size_t)m_baseFaces * 3);
+    for (std::uint32_t &vertex : faces) {
+        vertex = reader.Varint();
+        if (reader.Short()) {
+            return false;
+        }
+        if (vertex >= m_baseVertices) {
+            throw std::runtime_error("Vertex out of range in progressive mesh");
+        }
+    }
+    if (reader.Short()) {
+        return false;
+    }
+
+    m_quantized = std::move(quantized);
+    m_facesOf.resize(m_baseVertices);
+    for (std::uint32_t vertex = 0; vertex < m_baseVertices; vertex++) {
+        for (int axis = 0; axis < 3; axis++) {
+            const std::uint16_t value = m_quantized[vertex * 3 + axis];
+            m_positions.push_back(Dequantize(value, m_boundsMin[axis], m_boundsMax[axis]));
+        }
+    }
+    m_faces = std::move(faces);
+    for (std::uint32_t i = 0; i < m_faces.size(); i++) {
+        m_facesOf[m_faces[i]].push_back(i / 3);
+    }
+    used = reader.Offset();
+    m_hasBase = true;
+    return true;
+}
+
+bool ProgressiveMeshDecoder::ReadSplit(const std::uint8_t *data, std::size_t size, std::size_t &used) {
+    StreamReader reader(data, size);
+    const std::uint32_t u = reader.Varint();
+    std::int32_t offset[3];
+    for (std::int32_t &value : offset) {
+        value = UnZigZag(reader.Varint());
+    }
+    const std::uint32_t addedCount = reader.Varint();
+    if (reader.Short()) {
+        return false;
+    }
+    const std::uint32_t v = VertexCount();
+    if (u >= v) {
+        throw std::runtime_error("Vertex out of range in progressive mesh");
+    }
+    if (addedCount > m_finalFaces - FaceCount()) {
+        throw std::runtime_error("Too many faces in progressive mesh");
+    }
+    std::vector<std::uint8_t> moved((m_facesOf[u].size() + 7) / 8);
+    for (std::uint8_t &byte : moved) {
+        byte = reader.Byte();
+    }
+    std::vector<std::pair<std::uint32_t, bool>> added(addedCount);
+    for (auto &[w, order] : added) {
+        const std::uint32_t value = reader.Varint();
+        w = value >> 1;
+        order = value & 1;
+        if (w >= v && !reader.Short()) {
+            throw std::runtime_error("Vertex out of range in progressive mesh");
+        }
+    }
+    if (reader.Short()) {
+        return false;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        const std::int32_t value = m_quantized[u * 3 + axis] + offset[axis];
+        if (value < 0 || value > 0xFFFF) {
+            throw std::runtime_error("Vertex outside the bounds of the progressive mesh");
+        }
+        m_quantized.push_back((std::uint16_t)value);
+        m_positions.push_back(Dequantize((std::uint16_t)value, m_boundsMin[axis], m_boundsMax[axis]));
+    }
+    m_facesOf.emplace_back();
+    ApplySplit(m_faces, m_facesOf, u, v, moved.data(), added);
+    used = reader.Offset();
+    m_splitsApplied++;
+    return true;
+}
+
+std::size_t ProgressiveMeshDecoder::Feed(const std::uint8_t *data, std::size_t size) {
+    const size_t pending = m_pending.size();
+    m_pending.resize(pending + size);
+    memcpy(m_pending.data() + pending, data, size);
+
+    const std::uint32_t splitsBefore = m_splitsApplied;
+    size_t offset = 0;
+    for (;;) {
+        const std::uint8_t *next = m_pending.data() + offset;
+        const size_t left = m_pending.size() - offset;
+        size_t used = 0;
+        const bool read = !m_hasHeader  ? ReadHeader(next, left, used)
+                          : !m_hasBase  ? ReadBase(next, left, used)
+                          : !Complete() ? ReadSplit(next, left, used)
+                                        : false;
+        if (!read) {
+            break;
+        }
+        offset += used;
+    }
+    if (Complete() && offset < m_pending.size()) {
+        throw std::runtime_error("Trailing bytes after the progressive mesh");
+    }
+    m_pending.erase(m_pending.begin(), m_pending.begin() + offset);
+    return m_splitsApplied - splitsBefore;
+}
+
+WorldMesh ProgressiveMeshDecoder::Mesh() const {
+    WorldMesh mesh;
+    mesh.vertices.reserve(m_faces.size());
+    mesh.indices.reserve(m_faces.size());
+    for (size_t face = 0; face < m_faces.size(); face += 3) {
+        Vector3 corners[3];
+        for (int corner = 0; corner < 3; corner++) {
+            const float *p = &m_positions[m_faces[face + corner] * 3];
+            corners[corner] = {p[0], p[1], p[2]};
+        }
+        Vector3 normal = Cross(Subtract(corners[1], corners[0]), Subtract(corners[2], corners[0]));
+        const double length = Length(normal);
+        if (length > 0.0) {
+            normal = {normal.x / length, normal.y / length, normal.z / length};
+        }
+        for (int corner = 0; corner < 3; corner++) {
+            const float *p = &m_positions[m_faces[face + corner] * 3];
+            mesh.indices.push_back((std::uint32_t)mesh.vertices.size());
+            const MeshVertex vertex{{p[0], p[1], p[2]}, {(float)normal.x, (float)normal.y, (float)normal.z}};
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    return mesh;
+}
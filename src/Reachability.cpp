@@ -0,0 +1,508 @@
+#include "Reachability.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+constexpr std::uint32_t LocationWatcher = 0x80000000u;
+// Past this a requirement is better written as several lines
+constexpr size_t MaxClauses = 64;
+
+std::string_view Trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool Take(std::string_view &text, char c) {
+    text = Trim(text);
+    if (text.empty() || text.front() != c) {
+        return false;
+    }
+    text.remove_prefix(1);
+    return true;
+}
+
+bool ReadNumber(std::string_view &text, std::uint32_t &value) {
+    text = Trim(text);
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc()) {
+        return false;
+    }
+    text.remove_prefix(end - text.data());
+    return true;
+}
+} // namespace
+
+void Reachability::Build(const RoomGraph &graph, const std::vector<ItemRecord> &items) {
+    *this = Reachability();
+    m_nodes = graph.Nodes();
+    const std::uint32_t nodeCount = (std::uint32_t)m_nodes.size();
+    m_clauses.emplace_back(); // Requirement{} holds with nothing
+
+    // Both ways of every link, counting sorted by the room they leave
+    const std::vector<RoomLink> &links = graph.Links();
+    m_edgeStart.assign(nodeCount + 1, 0);
+    for (const RoomLink &link : links) {
+        m_edgeStart[link.a + 1]++;
+        m_edgeStart[link.b + 1]++;
+    }
+    for (std::uint32_t i = 0; i < nodeCount; i++) {
+        m_edgeStart[i + 1] += m_edgeStart[i];
+    }
+    m_edges.resize(links.size() * 2);
+    std::vector<std::uint32_t> cursor(m_edgeStart.begin(), m_edgeStart.end() - 1);
+    for (const RoomLink &link : links) {
+        m_edges[cursor[link.a]++] = {link.a, link.b, {}};
+        m_edges[cursor[link.b]++] = {link.b, link.a, {}};
+    }
+    m_roomRequirements.assign(nodeCount, {});
+
+    m_locationNode.resize(items.size());
+    m_locationStart.assign(nodeCount + 1, 0);
+    for (std::uint32_t id = 0; id < items.size(); id++) {
+        m_locationNode[id] = Node(items[id].worldIndex, (int)items[id].roomIndex);
+        if (m_locationNode[id] != NoNode) {
+            m_locationStart[m_locationNode[id] + 1]++;
+        }
+    }
+    for (std::uint32_t i = 0; i < nodeCount; i++) {
+        m_locationStart[i + 1] += m_locationStart[i];
+    }
+    m_locations.resize(m_locationStart.back());
+    cursor.assign(m_locationStart.begin(), m_locationStart.end() - 1);
+    for (std::uint32_t id = 0; id < items.size(); id++) {
+        if (m_locationNode[id] != NoNode) {
+            m_locations[cursor[m_locationNode[id]]++] = id;
+        }
+    }
+    m_locationRequirements.assign(items.size(), {});
+
+    Solve();
+}
+
+void Reachability::ApplyLogic(const std::string &text) {
+    std::stringstream lines(text);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+        std::string_view rest = Trim(line);
+        if (rest.empty()) {
+            continue;
+        }
+
+        try {
+            auto readRoom = [this](std::string_view &text) {
+                std::uint32_t world = 0, room = 0;
+                if (!ReadNumber(text, world) || !Take(text, ':') || !ReadNumber(text, room)) {
+                    throw std::runtime_error("Expected a room as world:room");
+                }
+                const std::uint32_t node = Node(world, (int)room);
+                if (node == NoNode) {
+                    throw std::runtime_error("Unknown room");
+                }
+                return node;
+            };
+
+            if (rest.starts_with("start")) {
+                rest.remove_prefix(5);
+                m_start = readRoom(rest);
+                if (!Trim(rest).empty()) {
+                    throw std::runtime_error("Expected the end of the line");
+                }
+                continue;
+            }
+
+            const std::uint32_t a = readRoom(rest);
+            if (Take(rest, '.')) {
+                std::uint32_t n = 0;
+                if (!ReadNumber(rest, n) || !Take(rest, ':')) {
+                    throw std::runtime_error("Expected an item as world:room.n:");
+                }
+                if (n < 1 || n > m_locationStart[a + 1] - m_locationStart[a]) {
+                    throw std::runtime_error("No such item in the room");
+                }
+                const std::uint32_t id = m_locations[m_locationStart[a] + n - 1];
+                Restrict(m_locationRequirements[id], ParseRequirement(rest));
+            } else if (rest = Trim(rest); rest.starts_with('-') || rest.starts_with('>')) {
+                const bool bothWays = rest.front() == '-';
+                rest.remove_prefix(1);
+                const std::uint32_t b = readRoom(rest);
+                if (!Take(rest, ':')) {
+                    throw std::runtime_error("Expected a : after the link");
+                }
+                const std::uint32_t forward = FindEdge(a, b);
+                if (forward == NoNode) {
+                    throw std::runtime_error("Unknown link");
+                }
+                const std::vector<Conditions> clauses = ParseRequirement(rest);
+                Restrict(m_edges[forward].requirement, clauses);
+                if (bothWays) {
+                    Restrict(m_edges[FindEdge(b, a)].requirement, clauses);
+                }
+            } else if (Take(rest, ':')) {
+                Restrict(m_roomRequirements[a], ParseRequirement(rest));
+            } else {
+                throw std::runtime_error("Expected a : after the room");
+            }
+        } catch (const std::runtime_error &e) {
+            throw std::runtime_error(std::string(e.what()) + ": " + line);
+        }
+    }
+
+    m_compiled = false;
+    Solve();
+}
+
+void Reachability::LoadLogic(const char *path) {
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+
+    ApplyLogic(ss.str());
+}
+
+int Reachability::Kind(std::string_view name) const {
+    const auto it = m_kindOf.find(name);
+    return it == m_kindOf.end() ? -1 : (int)it->second;
+}
+
+void Reachability::SetCount(std::uint32_t kind, std::uint32_t count) {
+    const Conditions before = m_held;
+    m_kinds[kind].count = count;
+    for (const auto &[threshold, bit] : m_kinds[kind].thresholds) {
+        if (count >= threshold) {
+            m_held.bits[bit >> 6] |= 1ull << (bit & 63);
+        } else {
+            m_held.bits[bit >> 6] &= ~(1ull << (bit & 63));
+        }
+    }
+
+    bool lost = false;
+    for (size_t w = 0; w < std::size(m_held.bits); w++) {
+        lost |= (before.bits[w] & ~m_held.bits[w]) != 0;
+    }
+    if (lost || !m_compiled) {
+        Solve();
+        return;
+    }
+
+    // Only what watches a newly met condition can pass now, and only from a
+    // room already reached
+    m_tests = 0;
+    for (size_t w = 0; w < std::size(m_held.bits); w++) {
+        for (std::uint64_t gained = m_held.bits[w] & ~before.bits[w]; gained; gained &= gained - 1) {
+            const std::uint32_t bit = (std::uint32_t)(w * 64 + std::countr_zero(gained));
+            for (std::uint32_t i = m_watchStart[bit]; i < m_watchStart[bit + 1]; i++) {
+                const std::uint32_t watcher = m_watchers[i];
+                if (watcher & LocationWatcher) {
+                    const std::uint32_t id = watcher & ~LocationWatcher;
+                    const std::uint32_t node = m_locationNode[id];
+                    if (m_roomReachable[node] && !m_locationReachable[id] &&
+                        Passes(m_locationRequirements[id])) {
+                        m_locationReachable[id] = 1;
+                        m_reachableLocations++;
+                    }
+                    continue;
+                }
+                const Edge &edge = m_edges[watcher];
+                if (m_roomReachable[edge.from] && !m_roomReachable[edge.to] && Passes(m_edgeTests[watcher])) {
+                    Reach(edge.to);
+                }
+            }
+        }
+    }
+    Propagate();
+}
+
+void Reachability::ClearInventory() {
+    for (ItemKind &kind : m_kinds) {
+        kind.count = 0;
+    }
+    m_held = {};
+    Solve();
+}
+
+void Reachability::Solve() {
+    if (!m_compiled) {
+        Compile();
+    }
+    m_roomReachable.assign(m_nodes.size(), 0);
+    m_locationReachable.assign(m_locationNode.size(), 0);
+    m_reachableRooms = 0;
+    m_reachableLocations = 0;
+    m_tests = 0;
+    if (m_start < m_nodes.size()) {
+        Reach(m_start);
+        Propagate();
+    }
+}
+
+std::vector<Reachability::Conditions> Reachability::ParseRequirement(std::string_view text) {
+    std::vector<Conditions> clauses = ParseOr(text);
+    if (!Trim(text).empty()) {
+        throw std::runtime_error("Unexpected " + std::string(Trim(text)));
+    }
+    return clauses;
+}
+
+namespace {
+template <typename C> bool Contains(const C &set, const C &subset) {
+    for (size_t w = 0; w < std::size(set.bits); w++) {
+        if ((set.bits[w] & subset.bits[w]) != subset.bits[w]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Drops the clauses another one already covers
+template <typename C> void Absorb(std::vector<C> &clauses) {
+    for (size_t i = 0; i < clauses.size();) {
+        bool covered = false;
+        for (size_t j = 0; j < clauses.size() && !covered; j++) {
+            // Of equal clauses the first stays
+            covered = j != i && Contains(clauses[i], clauses[j]) &&
+                      (!Contains(clauses[j], clauses[i]) || j < i);
+        }
+        if (covered) {
+            clauses.erase(clauses.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    if (clauses.size() > MaxClauses) {
+        throw std::runtime_error("Requirement too complex");
+    }
+}
+
+template <typename C> std::vector<C> Both(const std::vector<C> &a, const std::vector<C> &b) {
+    std::vector<C> clauses;
+    for (const C &x : a) {
+        for (const C &y : b) {
+            C both = x;
+            for (size_t w = 0; w < std::size(both.bits); w++) {
+                both.bits[w] |= y.bits[w];
+            }
+            clauses.push_back(both);
+        }
+    }
+    Absorb(clauses);
+    return clauses;
+}
+} // namespace
+
+std::vector<Reachability::Conditions> Reachability::ParseOr(std::string_view &text) {
+    std::vector<Conditions> clauses = ParseAnd(text);
+    while (Take(text, '|')) {
+        const std::vector<Conditions> other = ParseAnd(text);
+        clauses.insert(clauses.end(), other.begin(), other.end());
+        Absorb(clauses);
+    }
+    return clauses;
+}
+
+std::vector<Reachability::Conditions> Reachability::ParseAnd(std::string_view &text) {
+    std::vector<Conditions> clauses = ParseAtom(text);
+    while (Take(text, '&')) {
+        clauses = Both(clauses, ParseAtom(text));
+    }
+    return clauses;
+}
+
+std::vector<Reachability::Conditions> Reachability::ParseAtom(std::string_view &text) {
+    if (Take(text, '(')) {
+        std::vector<Conditions> clauses = ParseOr(text);
+        if (!Take(text, ')')) {
+            throw std::runtime_error("Expected a )");
+        }
+        return clauses;
+    }
+
+    const size_t end = std::min(text.find_first_of("&|()"), text.size());
+    std::string_view name = Trim(text.substr(0, end));
+    text.remove_prefix(end);
+    if (name.empty()) {
+        throw std::runtime_error("Expected an item");
+    }
+
+    // A trailing number is the count
+    std::uint32_t count = 1;
+    const size_t space = name.find_last_of(" \t");
+    if (space != std::string_view::npos) {
+        std::string_view last = name.substr(space + 1);
+        std::uint32_t value = 0;
+        if (ReadNumber(last, value) && last.empty()) {
+            count = value;
+            name = Trim(name.substr(0, space));
+        }
+    }
+
+    Conditions clause;
+    if (count > 0) {
+        const std::uint32_t bit = Condition(name, count);
+        clause.bits[bit >> 6] |= 1ull << (bit & 63);
+    }
+    return {clause};
+}
+
+std::uint32_t Reachability::Condition(std::string_view name, std::uint32_t count) {
+    const auto [it, added] = m_kindOf.emplace(std::string(name), (std::uint32_t)m_kinds.size());
+    if (added) {
+        m_kinds.push_back({std::string(name), 0, 0, {}});
+    }
+    ItemKind &kind = m_kinds[it->second];
+    for (const auto &[threshold, bit] : kind.thresholds) {
+        if (threshold == count) {
+            return bit;
+        }
+    }
+
+    if (m_conditionCount == MaxConditions) {
+        throw std::runtime_error("More than 128 item and count pairs");
+    }
+    const std::uint32_t bit = m_conditionCount++;
+    kind.thresholds.insert(std::lower_bound(kind.thresholds.begin(), kind.thresholds.end(),
+                                            std::make_pair(count, bit)),
+                           {count, bit});
+    kind.maximum = std::max(kind.maximum, count);
+    if (kind.count >= count) {
+        m_held.bits[bit >> 6] |= 1ull << (bit & 63);
+    }
+    return bit;
+}
+
+Reachability::Requirement Reachability::Store(const std::vector<Conditions> &clauses) {
+    const Requirement requirement{(std::uint32_t)m_clauses.size(), (std::uint32_t)clauses.size()};
+    m_clauses.insert(m_clauses.end(), clauses.begin(), clauses.end());
+    return requirement;
+}
+
+std::vector<Reachability::Conditions> Reachability::Load(Requirement requirement) const {
+    return {m_clauses.begin() + requirement.first, m_clauses.begin() + requirement.first + requirement.count};
+}
+
+void Reachability::Restrict(Requirement &requirement, const std::vector<Conditions> &clauses) {
+    requirement = Store(Both(Load(requirement), clauses));
+}
+
+std::uint32_t Reachability::Node(std::uint32_t worldIndex, int roomIndex) const {
+    for (std::uint32_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].worldIndex == worldIndex && m_nodes[i].roomIndex == roomIndex) {
+            return i;
+        }
+    }
+    return NoNode;
+}
+
+std::uint32_t Reachability::FindEdge(std::uint32_t from, std::uint32_t to) const {
+    for (std::uint32_t e = m_edgeStart[from]; e < m_edgeStart[from + 1]; e++) {
+        if (m_edges[e].to == to) {
+            return e;
+        }
+    }
+    return NoNode;
+}
+
+// Folds the requirement of entering a room into the links to it and lists
+// what every condition can open
+void Reachability::Compile() {
+    m_edgeTests.resize(m_edges.size());
+    for (std::uint32_t e = 0; e < m_edges.size(); e++) {
+        const Requirement link = m_edges[e].requirement;
+        const Requirement room = m_roomRequirements[m_edges[e].to];
+        if (room.first == 0) {
+            m_edgeTests[e] = link;
+        } else if (link.first == 0) {
+            m_edgeTests[e] = room;
+        } else {
+            m_edgeTests[e] = Store(Both(Load(link), Load(room)));
+        }
+    }
+
+    auto named = [this](Requirement requirement) {
+        Conditions all;
+        for (std::uint32_t c = requirement.first; c < requirement.first + requirement.count; c++) {
+            for (size_t w = 0; w < std::size(all.bits); w++) {
+                all.bits[w] |= m_clauses[c].bits[w];
+            }
+        }
+        return all;
+    };
+    auto forEachWatcher = [&](auto f) {
+        for (std::uint32_t e = 0; e < m_edges.size(); e++) {
+            f(named(m_edgeTests[e]), e);
+        }
+        for (std::uint32_t id = 0; id < m_locationNode.size(); id++) {
+            if (m_locationNode[id] != NoNode) {
+                f(named(m_locationRequirements[id]), id | LocationWatcher);
+            }
+        }
+    };
+    auto forEachBit = [](const Conditions &conditions, auto f) {
+        for (size_t w = 0; w < std::size(conditions.bits); w++) {
+            for (std::uint64_t bits = conditions.bits[w]; bits; bits &= bits - 1) {
+                f((std::uint32_t)(w * 64 + std::countr_zero(bits)));
+            }
+        }
+    };
+
+    m_watchStart.assign(m_conditionCount + 1, 0);
+    forEachWatcher([&](const Conditions &conditions, std::uint32_t) {
+        forEachBit(conditions, [&](std::uint32_t bit) { m_watchStart[bit + 1]++; });
+    });
+    for (std::uint32_t i = 0; i < m_conditionCount; i++) {
+        m_watchStart[i + 1] += m_watchStart[i];
+    }
+    m_watchers.resize(m_watchStart.back());
+    std::vector<std::uint32_t> cursor(m_watchStart.begin(), m_watchStart.end() - 1);
+    forEachWatcher([&](const Conditions &conditions, std::uint32_t watcher) {
+        forEachBit(conditions, [&](std::uint32_t bit) { m_watchers[cursor[bit]++] = watcher; });
+    });
+    m_compiled = true;
+}
+
+bool Reachability::Passes(Requirement requirement) {
+    m_tests++;
+    for (std::uint32_t c = requirement.first; c < requirement.first + requirement.count; c++) {
+        if (Contains(m_held, m_clauses[c])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Reachability::Reach(std::uint32_t node) {
+    m_roomReachable[node] = 1;
+    m_reachableRooms++;
+    m_worklist.push_back(node);
+    for (std::uint32_t i = m_locationStart[node]; i < m_locationStart[node + 1]; i++) {
+        const std::uint32_t id = m_locations[i];
+        if (!m_locationReachable[id] && Passes(m_locationRequirements[id])) {
+            m_locationReachable[id] = 1;
+            m_reachableLocations++;
+        }
+    }
+}
+
+void Reachability::Propagate() {
+    while (!m_worklist.empty()) {
+        const std::uint32_t node = m_worklist.back();
+        m_worklist.pop_back();
+        for (std::uint32_t e = m_edgeStart[node]; e < m_edgeStart[node + 1]; e++) {
+            const std::uint32_t to = m_edges[e].to;
+            if (!m_roomReachable[to] && Passes(m_edgeTests[e])) {
+                Reach(to);
+            }
+        }
+    }
+}
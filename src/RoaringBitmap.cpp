@@ -0,0 +1,362 @@
+#include "RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+bool RoaringBitmap::Container::Contains(std::uint16_t low) const {
+    if (IsBitmap()) {
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::Add(std::uint16_t low) {
+    if (IsBitmap()) {
+        std::uint64_t &word = bits[low >> 6];
+        const std::uint64_t mask = 1ull << (low & 63);
+        cardinality += (word & mask) == 0;
+        word |= mask;
+        return;
+    }
+
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (*it == low) {
+            return;
+        }
+        array.insert(it, low);
+    }
+
+    cardinality++;
+    if (cardinality > ArrayMaxSize) {
+        ToBitmap();
+    }
+}
+
+void RoaringBitmap::Container::ToBitmap() {
+    if (IsBitmap()) {
+        return;
+    }
+
+    bits.assign(BitmapWords, 0);
+    for (std::uint16_t low : array) {
+        bits[low >> 6] |= 1ull << (low & 63);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::Optimize() {
+    if (!IsBitmap() || cardinality > ArrayMaxSize) {
+        return;
+    }
+
+    array.clear();
+    array.reserve(cardinality);
+    for (std::uint32_t w = 0; w < BitmapWords; w++) {
+        std::uint64_t word = bits[w];
+        while (word) {
+            array.push_back((std::uint16_t)(w * 64 + std::countr_zero(word)));
+            word &= word - 1;
+        }
+    }
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+void RoaringBitmap::Add(std::uint32_t value) {
+    const std::uint16_t key = (std::uint16_t)(value >> 16);
+
+    if (m_containers.empty() || m_containers.back().key < key) {
+        m_containers.emplace_back().key = key;
+        m_containers.back().Add((std::uint16_t)value);
+        return;
+    }
+
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const Container &c, std::uint16_t k) { return c.key < k; });
+    if (it->key != key) {
+        it = m_containers.insert(it, Container{});
+        it->key = key;
+    }
+    it->Add((std::uint16_t)value);
+}
+
+bool RoaringBitmap::Contains(std::uint32_t value) const {
+    const std::uint16_t key = (std::uint16_t)(value >> 16);
+    auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                               [](const Container &c, std::uint16_t k) { return c.key < k; });
+    return it != m_containers.end() && it->key == key && it->Contains((std::uint16_t)value);
+}
+
+std::size_t RoaringBitmap::Cardinality() const {
+    std::size_t count = 0;
+    for (const Container &c : m_containers) {
+        count += c.cardinality;
+    }
+    return count;
+}
+
+RoaringBitmap RoaringBitmap::Range(std::uint32_t begin, std::uint32_t end) {
+    RoaringBitmap result;
+    if (begin >= end) {
+        return result;
+    }
+
+    for (std::uint64_t chunk = begin >> 16; chunk <= (std::uint64_t)(end - 1) >> 16; chunk++) {
+        const std::uint32_t first = std::max<std::uint64_t>(begin, chunk << 16) & 0xFFFF;
+        const std::uint32_t last = std::min<std::uint64_t>(end - 1, (chunk << 16) | 0xFFFF) & 0xFFFF;
+
+        Container &c = result.m_containers.emplace_back();
+        c.key = (std::uint16_t)chunk;
+        c.cardinality = last - first + 1;
+
+        if (c.cardinality > ArrayMaxSize) {
+            c.bits.assign(BitmapWords, 0);
+            for (std::uint32_t v = first; v <= last; v++) {
+                c.bits[v >> 6] |= 1ull << (v & 63);
+            }
+        } else {
+            c.array.resize(c.cardinality);
+            for (std::uint32_t i = 0; i < c.cardinality; i++) {
+                c.array[i] = (std::uint16_t)(first + i);
+            }
+        }
+    }
+
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::FromWords(const std::uint64_t *words, std::size_t wordCount) {
+    RoaringBitmap result;
+
+    for (std::size_t base = 0; base < wordCount; base += BitmapWords) {
+        const std::size_t count = std::min<std::size_t>(BitmapWords, wordCount - base);
+
+        Container c;
+        c.key = (std::uint16_t)(base / BitmapWords);
+        c.bits.assign(BitmapWords, 0);
+        for (std::size_t w = 0; w < count; w++) {
+            c.bits[w] = words[base + w];
+            c.cardinality += std::popcount(words[base + w]);
+        }
+
+        if (c.cardinality) {
+            c.Optimize();
+            result.m_containers.push_back(std::move(c));
+        }
+    }
+
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::AndContainers(const Container &a, const Container &b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.IsBitmap() && b.IsBitmap()) {
+        result.bits.resize(BitmapWords);
+        for (std::uint32_t w = 0; w < BitmapWords; w++) {
+            result.bits[w] = a.bits[w] & b.bits[w];
+            result.cardinality += std::popcount(result.bits[w]);
+        }
+        result.Optimize();
+    } else if (a.IsBitmap() || b.IsBitmap()) {
+        const Container &arr = a.IsBitmap() ? b : a;
+        const Container &bmp = a.IsBitmap() ? a : b;
+        for (std::uint16_t low : arr.array) {
+            if (bmp.Contains(low)) {
+                result.array.push_back(low);
+            }
+        }
+        result.cardinality = (std::uint32_t)result.array.size();
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+        result.cardinality = (std::uint32_t)result.array.size();
+    }
+
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::OrContainers(const Container &a, const Container &b) {
+    Container result;
+    result.key = a.key;
+
+    if (!a.IsBitmap() && !b.IsBitmap() && a.cardinality + b.cardinality <= ArrayMaxSize) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(result.array));
+        result.cardinality = (std::uint32_t)result.array.size();
+        return result;
+    }
+
+    result.bits.assign(BitmapWords, 0);
+    for (const Container *c : {&a, &b}) {
+        if (c->IsBitmap()) {
+            for (std::uint32_t w = 0; w < BitmapWords; w++) {
+                result.bits[w] |= c->bits[w];
+            }
+        } else {
+            for (std::uint16_t low : c->array) {
+                result.bits[low >> 6] |= 1ull << (low & 63);
+            }
+        }
+    }
+    for (std::uint32_t w = 0; w < BitmapWords; w++) {
+        result.cardinality += std::popcount(result.bits[w]);
+    }
+    result.Optimize();
+
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::AndNotContainers(const Container &a, const Container &b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.IsBitmap()) {
+        result.bits = a.bits;
+        if (b.IsBitmap()) {
+            for (std::uint32_t w = 0; w < BitmapWords; w++) {
+                result.bits[w] &= ~b.bits[w];
+            }
+        } else {
+            for (std::uint16_t low : b.array) {
+                result.bits[low >> 6] &= ~(1ull << (low & 63));
+            }
+        }
+        for (std::uint32_t w = 0; w < BitmapWords; w++) {
+            result.cardinality += std::popcount(result.bits[w]);
+        }
+        result.Optimize();
+    } else if (b.IsBitmap()) {
+        for (std::uint16_t low : a.array) {
+            if (!b.Contains(low)) {
+                result.array.push_back(low);
+            }
+        }
+        result.cardinality = (std::uint32_t)result.array.size();
+    } else {
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                            std::back_inserter(result.array));
+        result.cardinality = (std::uint32_t)result.array.size();
+    }
+
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::And(const RoaringBitmap &a, const RoaringBitmap &b) {
+    RoaringBitmap result;
+    auto ia = a.m_containers.begin();
+    auto ib = b.m_containers.begin();
+
+    while (ia != a.m_containers.end() && ib != b.m_containers.end()) {
+        if (ia->key < ib->key) {
+            ++ia;
+        } else if (ib->key < ia->key) {
+            ++ib;
+        } else {
+            Container c = AndContainers(*ia++, *ib++);
+            if (c.cardinality) {
+                result.m_containers.push_back(std::move(c));
+            }
+        }
+    }
+
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::Or(const RoaringBitmap &a, const RoaringBitmap &b) {
+    RoaringBitmap result;
+    auto ia = a.m_containers.begin();
+    auto ib = b.m_containers.begin();
+
+    while (ia != a.m_containers.end() || ib != b.m_containers.end()) {
+        if (ib == b.m_containers.end() || (ia != a.m_containers.end() && ia->key < ib->key)) {
+            result.m_containers.push_back(*ia++);
+        } else if (ia == a.m_containers.end() || ib->key < ia->key) {
+            result.m_containers.push_back(*ib++);
+        } else {
+            result.m_containers.push_back(OrContainers(*ia++, *ib++));
+        }
+    }
+
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::OrMany(const std::vector<const RoaringBitmap *> &sets) {
+    std::vector<const Container *> containers;
+    for (const RoaringBitmap *set : sets) {
+        for (const Container &c : set->m_containers) {
+            containers.push_back(&c);
+        }
+    }
+    std::stable_sort(containers.begin(), containers.end(),
+                     [](const Container *a, const Container *b) { return a->key < b->key; });
+
+    RoaringBitmap result;
+    for (size_t first = 0; first < containers.size();) {
+        size_t last = first;
+        while (last < containers.size() && containers[last]->key == containers[first]->key) {
+            last++;
+        }
+
+        // Accumulating in a bitmap and converting back is linear in the input,
+        // merging sorted arrays pairwise is not
+        Container &c = result.m_containers.emplace_back();
+        c.key = containers[first]->key;
+        c.bits.assign(BitmapWords, 0);
+        for (size_t i = first; i < last; i++) {
+            const Container *src = containers[i];
+            if (src->IsBitmap()) {
+                for (std::uint32_t w = 0; w < BitmapWords; w++) {
+                    c.bits[w] |= src->bits[w];
+                }
+            } else {
+                for (std::uint16_t low : src->array) {
+                    c.bits[low >> 6] |= 1ull << (low & 63);
+                }
+            }
+        }
+        for (std::uint32_t w = 0; w < BitmapWords; w++) {
+            c.cardinality += std::popcount(c.bits[w]);
+        }
+        c.Optimize();
+
+        first = last;
+    }
+
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::AndNot(const RoaringBitmap &a, const RoaringBitmap &b) {
+    RoaringBitmap result;
+    auto ib = b.m_containers.begin();
+
+    for (const Container &ca : a.m_containers) {
+        while (ib != b.m_containers.end() && ib->key < ca.key) {
+            ++ib;
+        }
+
+        if (ib == b.m_containers.end() || ib->key != ca.key) {
+            result.m_containers.push_back(ca);
+            continue;
+        }
+
+        Container c = AndNotContainers(ca, *ib);
+        if (c.cardinality) {
+            result.m_containers.push_back(std::move(c));
+        }
+    }
+
+    return result;
+}
+
+std::vector<std::uint32_t> RoaringBitmap::ToVector() const {
+    std::vector<std::uint32_t> result;
+    result.reserve(Cardinality());
+    ForEach([&](std::uint32_t v) { result.push_back(v); });
+    return result;
+}
@@ -0,0 +1,153 @@
+#include "RoomGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+float CenterDistance(const RoomNode &a, const RoomNode &b) {
+    const float dx = a.center[0] - b.center[0];
+    const float dy = a.center[1] - b.center[1];
+    const float dz = a.center[2] - b.center[2];
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+} // namespace
+
+void RoomGraph::AddWorld(std::uint32_t worldIndex, const WorldMesh &mesh,
+                         const std::vector<Portal> &portals) {
+    const std::uint32_t base = (std::uint32_t)m_nodes.size();
+
+    for (const RoomMesh &room : mesh.rooms) {
+        RoomNode node{worldIndex, room.roomIndex, {}};
+        for (int i = 0; i < 3; i++) {
+            node.center[i] = (room.boundsMin[i] + room.boundsMax[i]) * 0.5f;
+        }
+        m_nodes.push_back(node);
+    }
+
+    for (const Portal &portal : portals) {
+        const std::uint32_t a = base + portal.roomA;
+        const std::uint32_t b = base + portal.roomB;
+        Link(a, b, CenterDistance(m_nodes[a], m_nodes[b]));
+    }
+}
+
+void RoomGraph::ApplyOverrides(const std::string &text) {
+    std::stringstream lines(text);
+    std::string line;
+
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+
+        char op = 0;
+        std::uint32_t worlds[2] = {};
+        int rooms[2] = {};
+        float cost = -1.f;
+        const int fields = sscanf(line.c_str(), " %c %u:%d %u:%d %f", &op, &worlds[0], &rooms[0], &worlds[1],
+                                  &rooms[1], &cost);
+        if (fields <= 0) {
+            continue;
+        }
+        if (fields < 5 || (op != '+' && op != '-')) {
+            throw std::runtime_error("Invalid room link: " + line);
+        }
+
+        const int a = Node(worlds[0], rooms[0]);
+        const int b = Node(worlds[1], rooms[1]);
+        if (a < 0 || b < 0) {
+            throw std::runtime_error("Unknown room in room link: " + line);
+        }
+
+        if (op == '+') {
+            if (cost < 0.f) {
+                cost = worlds[0] == worlds[1] ? CenterDistance(m_nodes[a], m_nodes[b]) : 0.f;
+            }
+            Link(a, b, cost);
+        } else {
+            Unlink(a, b);
+        }
+    }
+}
+
+void RoomGraph::LoadOverrides(const char *path) {
+    std::ifstream f(path);
+    std::stringstream ss;
+    ss << f.rdbuf();
+
+    ApplyOverrides(ss.str());
+}
+
+void RoomGraph::ComputeShortestPaths() {
+    const size_t n = m_nodes.size();
+    m_distances.assign(n * n, Unreachable);
+    m_next.assign(n * n, 0);
+
+    for (std::uint32_t i = 0; i < n; i++) {
+        m_distances[i * n + i] = 0.f;
+        m_next[i * n + i] = i;
+    }
+    for (const RoomLink &link : m_links) {
+        if (link.cost < m_distances[link.a * n + link.b]) {
+            m_distances[link.a * n + link.b] = m_distances[link.b * n + link.a] = link.cost;
+            m_next[link.a * n + link.b] = link.b;
+            m_next[link.b * n + link.a] = link.a;
+        }
+    }
+
+    // Floyd-Warshall, the graph is a few hundred rooms
+    for (size_t k = 0; k < n; k++) {
+        const float *rowK = &m_distances[k * n];
+        for (size_t i = 0; i < n; i++) {
+            const float ik = m_distances[i * n + k];
+            if (ik >= Unreachable) {
+                continue;
+            }
+
+            float *rowI = &m_distances[i * n];
+            std::uint32_t *nextI = &m_next[i * n];
+            for (size_t j = 0; j < n; j++) {
+                if (ik + rowK[j] < rowI[j]) {
+                    rowI[j] = ik + rowK[j];
+                    nextI[j] = nextI[k];
+                }
+            }
+        }
+    }
+}
+
+int RoomGraph::Node(std::uint32_t worldIndex, int roomIndex) const {
+    for (std::uint32_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].worldIndex == worldIndex && m_nodes[i].roomIndex == roomIndex) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+std::vector<std::uint32_t> RoomGraph::Path(std::uint32_t a, std::uint32_t b) const {
+    std::vector<std::uint32_t> path;
+    if (Distance(a, b) >= Unreachable) {
+        return path;
+    }
+
+    path.push_back(a);
+    while (a != b) {
+        a = m_next[a * m_nodes.size() + b];
+        path.push_back(a);
+    }
+    return path;
+}
+
+void RoomGraph::Link(std::uint32_t a, std::uint32_t b, float cost) {
+    Unlink(a, b);
+    m_links.push_back({std::min(a, b), std::max(a, b), cost});
+}
+
+void RoomGraph::Unlink(std::uint32_t a, std::uint32_t b) {
+    std::erase_if(m_links, [&](const RoomLink &link) {
+        return link.a == std::min(a, b) && link.b == std::max(a, b);
+    });
+}
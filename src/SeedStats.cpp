@@ -0,0 +1,241 @@
+#include "SeedStats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace {
+const std::uint32_t Magic = 0x5353504D; // "MPSS"
+const std::uint32_t FormatVersion = 1;
+const size_t HeaderSize = 24;
+
+void AppendBytes(std::vector<std::uint8_t> &out, const void *data, size_t size) {
+    const size_t offset = out.size();
+    out.resize(offset + size);
+    memcpy(out.data() + offset, data, size);
+}
+
+std::uint32_t ReadU32(const std::vector<std::uint8_t> &in, size_t offset) {
+    if (offset + 4 > in.size()) {
+        throw std::runtime_error("Truncated seed statistics");
+    }
+    std::uint32_t value;
+    memcpy(&value, in.data() + offset, 4);
+    return value;
+}
+
+PickupClass ClassOf(std::string_view pickup) {
+    if (pickup.empty()) {
+        return PickupClass_Nothing;
+    }
+    switch (PickupItemType(pickup)) {
+    case ItemType_EnergyTank:
+        return PickupClass_EnergyTank;
+    case ItemType_Missile:
+        return PickupClass_Missile;
+    default:
+        break;
+    }
+    const std::string_view artifact = "artifact";
+    const bool isArtifact = pickup.size() >= artifact.size() &&
+                            std::equal(artifact.begin(), artifact.end(), pickup.begin(),
+                                       [](char a, char b) { return a == std::tolower((unsigned char)b); });
+    return isArtifact ? PickupClass_Artifact : PickupClass_Upgrade;
+}
+} // namespace
+
+const char *PickupClassName(std::uint8_t pickupClass) {
+    switch (pickupClass) {
+    case PickupClass_EnergyTank:
+        return "Energy Tank";
+    case PickupClass_Missile:
+        return "Missile Expansion";
+    case PickupClass_Artifact:
+        return "Artifact";
+    case PickupClass_Upgrade:
+        return "Upgrade";
+    case PickupClass_Nothing:
+        return "Nothing";
+    default:
+        return "Unknown";
+    }
+}
+
+SeedStats::SeedStats(std::uint32_t locationCount)
+    : spheres((size_t)locationCount * (SphereBuckets + 1), 0),
+      pickups((size_t)locationCount * PickupClassCount, 0), depths(SphereBuckets + 1, 0),
+      m_locationCount(locationCount) {}
+
+void SeedStats::Add(const SeedStats &other) {
+    if (other.m_locationCount != m_locationCount) {
+        throw std::runtime_error("Seed statistics of different locations");
+    }
+    seeds += other.seeds;
+    for (size_t i = 0; i < spheres.size(); i++) {
+        spheres[i] += other.spheres[i];
+    }
+    for (size_t i = 0; i < pickups.size(); i++) {
+        pickups[i] += other.pickups[i];
+    }
+    for (size_t i = 0; i < depths.size(); i++) {
+        depths[i] += other.depths[i];
+    }
+}
+
+float SeedStats::AverageSphere(std::uint32_t id) const {
+    const std::uint32_t *counts = &spheres[(size_t)id * (SphereBuckets + 1)];
+    std::uint64_t reached = 0, sum = 0;
+    for (std::uint32_t sphere = 0; sphere < SphereBuckets; sphere++) {
+        reached += counts[sphere];
+        sum += (std::uint64_t)counts[sphere] * sphere;
+    }
+    return reached ? (float)((double)sum / reached) : -1.f;
+}
+
+float SeedStats::MajorShare(std::uint32_t id) const {
+    const std::uint32_t *counts = &pickups[(size_t)id * PickupClassCount];
+    return seeds ? (float)(counts[PickupClass_Artifact] + counts[PickupClass_Upgrade]) / seeds : 0.f;
+}
+
+std::vector<std::uint8_t> SeedStats::Encode() const {
+    std::vector<std::uint8_t> out;
+    const std::uint32_t header[] = {Magic,         FormatVersion,   seeds, m_locationCount,
+                                    SphereBuckets, PickupClassCount};
+    AppendBytes(out, header, sizeof(header));
+    AppendBytes(out, spheres.data(), spheres.size() * 4);
+    AppendBytes(out, pickups.data(), pickups.size() * 4);
+    AppendBytes(out, depths.data(), depths.size() * 4);
+    return out;
+}
+
+SeedStats SeedStats::Decode(const std::vector<std::uint8_t> &data) {
+    if (ReadU32(data, 0) != Magic || ReadU32(data, 4) != FormatVersion) {
+        throw std::runtime_error("Not seed statistics of this version");
+    }
+    if (ReadU32(data, 16) != SphereBuckets || ReadU32(data, 20) != PickupClassCount) {
+        throw std::runtime_error("Seed statistics with other buckets");
+    }
+    const std::uint32_t locationCount = ReadU32(data, 12);
+    const size_t counts = (size_t)locationCount * (SphereBuckets + 1 + PickupClassCount) + SphereBuckets + 1;
+    if (data.size() != HeaderSize + counts * 4) {
+        throw std::runtime_error("Seed statistics of the wrong size");
+    }
+
+    SeedStats stats(locationCount);
+    stats.seeds = ReadU32(data, 8);
+    size_t offset = HeaderSize;
+    for (std::vector<std::uint32_t> *part : {&stats.spheres, &stats.pickups, &stats.depths}) {
+        memcpy(part->data(), data.data() + offset, part->size() * 4);
+        offset += part->size() * 4;
+    }
+    return stats;
+}
+
+std::string SeedStats::LocationsCsv(const std::vector<ItemRecord> &items) const {
+    std::string csv = "id,world,room,x,y,z,average_sphere,major_share";
+    for (std::uint32_t c = 0; c < PickupClassCount; c++) {
+        csv += ",";
+        csv += PickupClassName(c);
+    }
+    for (std::uint32_t sphere = 0; sphere < SphereBuckets; sphere++) {
+        csv += ",sphere_" + std::to_string(sphere);
+    }
+    csv += ",never\n";
+
+    char field[96];
+    for (std::uint32_t id = 0; id < m_locationCount && id < items.size(); id++) {
+        const ItemRecord &item = items[id];
+        snprintf(field, sizeof(field), "%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.4f", id, item.worldIndex,
+                 item.roomIndex, item.x, item.y, item.z, AverageSphere(id), MajorShare(id));
+        csv += field;
+        for (std::uint32_t c = 0; c < PickupClassCount; c++) {
+            csv += "," + std::to_string(pickups[(size_t)id * PickupClassCount + c]);
+        }
+        for (std::uint32_t sphere = 0; sphere <= SphereBuckets; sphere++) {
+            csv += "," + std::to_string(spheres[(size_t)id * (SphereBuckets + 1) + sphere]);
+        }
+        csv += "\n";
+    }
+    return csv;
+}
+
+std::string SeedStats::RoomsCsv(const std::vector<ItemRecord> &items) const {
+    std::map<std::pair<std::uint32_t, std::uint32_t>, std::vector<std::uint64_t>> rooms;
+    for (std::uint32_t id = 0; id < m_locationCount && id < items.size(); id++) {
+        std::vector<std::uint64_t> &room = rooms[{items[id].worldIndex, items[id].roomIndex}];
+        room.resize(PickupClassCount + 1, 0);
+        room[0]++;
+        for (std::uint32_t c = 0; c < PickupClassCount; c++) {
+            room[c + 1] += pickups[(size_t)id * PickupClassCount + c];
+        }
+    }
+
+    std::string csv = "world,room,locations";
+    for (std::uint32_t c = 0; c < PickupClassCount; c++) {
+        csv += ",";
+        csv += PickupClassName(c);
+    }
+    csv += "\n";
+    for (const auto &[key, counts] : rooms) {
+        csv += std::to_string(key.first) + "," + std::to_string(key.second);
+        for (std::uint64_t count : counts) {
+            csv += "," + std::to_string(count);
+        }
+        csv += "\n";
+    }
+    return csv;
+}
+
+SeedAnalyzer::SeedAnalyzer(const LayoutImporter &importer, const Reachability &logic)
+    : m_importer(importer), m_solver(logic) {}
+
+std::uint32_t SeedAnalyzer::Analyze(std::string &json, SeedStats &stats) {
+    m_importer.Place(json, m_document, m_placement);
+    const std::uint32_t count = std::min(stats.LocationCount(), (std::uint32_t)m_placement.pickups.size());
+    for (std::uint32_t id = 0; id < count; id++) {
+        stats.pickups[(size_t)id * PickupClassCount + ClassOf(m_placement.pickups[id])]++;
+    }
+
+    m_solver.ClearInventory();
+    for (std::string_view pickup : m_placement.elsewhere) {
+        const int kind = m_solver.Kind(pickup);
+        if (kind >= 0) {
+            m_solver.SetCount(kind, m_solver.Count(kind) + 1);
+        }
+    }
+
+    // Everything reachable is picked up at once, sphere after sphere
+    m_sphere.assign(count, SeedStats::Never);
+    std::uint32_t depth = 0;
+    for (;;) {
+        m_opened.clear();
+        for (std::uint32_t id = 0; id < count; id++) {
+            if (m_sphere[id] == SeedStats::Never && m_solver.LocationReachable(id)) {
+                m_sphere[id] = depth;
+                m_opened.push_back(id);
+            }
+        }
+        if (m_opened.empty()) {
+            break;
+        }
+        for (std::uint32_t id : m_opened) {
+            const int kind = m_solver.Kind(m_placement.pickups[id]);
+            if (kind >= 0) {
+                m_solver.SetCount(kind, m_solver.Count(kind) + 1);
+            }
+        }
+        depth++;
+    }
+
+    for (std::uint32_t id = 0; id < count; id++) {
+        const std::uint32_t bucket = std::min(m_sphere[id], SeedStats::SphereBuckets - 1);
+        stats.spheres[(size_t)id * (SeedStats::SphereBuckets + 1) +
+                      (m_sphere[id] == SeedStats::Never ? SeedStats::Never : bucket)]++;
+    }
+    stats.depths[std::min(depth, SeedStats::SphereBuckets)]++;
+    stats.seeds++;
+    return depth;
+}
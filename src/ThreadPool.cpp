@@ -0,0 +1,156 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(std::uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (std::uint32_t i = 1; i < threadCount; i++) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        job();
+    }
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)> &task) {
+    ParallelFor(count, [&task](std::uint32_t i, std::uint32_t) { task(i); });
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count,
+                             const std::function<void(std::uint32_t, std::uint32_t)> &task) {
+    if (count == 0) {
+        return;
+    }
+    const std::uint32_t slots = std::min((std::uint32_t)m_workers.size(), count - 1) + 1;
+
+    // Indices left to a slot, begin in the low and end in the high half. The
+    // owner takes from the front, thieves take the back half.
+    struct alignas(64) Share {
+        std::atomic<std::uint64_t> bounds;
+    };
+    // Workers may only pick their job up once the loop is over, the state is
+    // shared so they then find nothing left and leave without touching task
+    struct Loop {
+        const std::function<void(std::uint32_t, std::uint32_t)> *task;
+        std::uint32_t count;
+        std::uint32_t slots;
+        std::unique_ptr<Share[]> shares;
+        std::atomic<std::uint32_t> nextSlot = 0;
+        std::atomic<std::uint32_t> done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto loop = std::make_shared<Loop>();
+    loop->task = &task;
+    loop->count = count;
+    loop->slots = slots;
+    loop->shares = std::make_unique<Share[]>(slots);
+    for (std::uint32_t i = 0; i < slots; i++) {
+        const std::uint64_t begin = (std::uint64_t)count * i / slots;
+        const std::uint64_t end = (std::uint64_t)count * (i + 1) / slots;
+        loop->shares[i].bounds = begin | end << 32;
+    }
+
+    auto work = [loop]() {
+        const std::uint32_t slot = loop->nextSlot++;
+        std::atomic<std::uint64_t> &own = loop->shares[slot].bounds;
+
+        auto take = [&own](std::uint32_t &index) {
+            std::uint64_t bounds = own.load();
+            while ((std::uint32_t)bounds < (std::uint32_t)(bounds >> 32)) {
+                if (own.compare_exchange_weak(bounds, bounds + 1)) {
+                    index = (std::uint32_t)bounds;
+                    return true;
+                }
+            }
+            return false;
+        };
+        // The back half of the fullest looking share, the first index of it
+        // is returned and the rest becomes the own share
+        auto steal = [&](std::uint32_t &index) {
+            for (std::uint32_t attempt = 1; attempt < loop->slots; attempt++) {
+                std::atomic<std::uint64_t> &victim = loop->shares[(slot + attempt) % loop->slots].bounds;
+                std::uint64_t bounds = victim.load();
+                for (;;) {
+                    const std::uint32_t begin = (std::uint32_t)bounds, end = (std::uint32_t)(bounds >> 32);
+                    if (begin >= end) {
+                        break;
+                    }
+                    const std::uint32_t middle = begin + (end - begin) / 2;
+                    if (victim.compare_exchange_weak(bounds, begin | (std::uint64_t)middle << 32)) {
+                        index = middle;
+                        own.store((std::uint64_t)(middle + 1) | (std::uint64_t)end << 32);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        std::uint32_t ran = 0;
+        std::uint32_t i = 0;
+        while (take(i) || steal(i)) {
+            try {
+                (*loop->task)(i, slot);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(loop->mutex);
+                if (!loop->error) {
+                    loop->error = std::current_exception();
+                }
+            }
+            ran++;
+        }
+
+        if (ran > 0 && loop->done.fetch_add(ran) + ran == loop->count) {
+            std::lock_guard<std::mutex> lock(loop->mutex);
+            loop->finished.notify_all();
+        }
+    };
+
+    if (slots > 1) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (std::uint32_t i = 1; i < slots; i++) {
+                m_queue.push_back(work);
+            }
+        }
+        m_wake.notify_all();
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&]() { return loop->done == loop->count; });
+    if (loop->error) {
+        std::rethrow_exception(loop->error);
+    }
+}
@@ -0,0 +1,239 @@
+#include "TourSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+// The open path is solved as a cycle through one extra stop that costs
+// nothing to reach, cutting the cycle there gives the path back. A fixed
+// start is made the cheapest neighbour of that extra stop, costs are doubles
+// so that bias does not eat the precision of the other costs.
+class CycleSolver {
+public:
+    CycleSolver(const std::vector<float> &costs, std::uint32_t count, int start) : m_n(count + 1) {
+        m_costs.resize((size_t)m_n * m_n);
+        for (std::uint32_t i = 0; i < count; i++) {
+            for (std::uint32_t j = 0; j < count; j++) {
+                m_costs[i * m_n + j] = costs[i * count + j];
+            }
+        }
+
+        const std::uint32_t extra = count;
+        for (std::uint32_t i = 0; i < m_n; i++) {
+            const double cost = (int)i == start ? -1e9 : 0.0;
+            m_costs[extra * m_n + i] = m_costs[i * m_n + extra] = cost;
+        }
+    }
+
+    double Cost(std::uint32_t a, std::uint32_t b) const { return m_costs[a * m_n + b]; }
+
+    double Length(const std::vector<std::uint32_t> &tour) const {
+        double length = 0.0;
+        for (std::uint32_t i = 0; i < m_n; i++) {
+            length += Cost(tour[i], tour[(i + 1) % m_n]);
+        }
+        return length;
+    }
+
+    std::vector<std::uint32_t> NearestNeighbour(std::uint32_t first) const {
+        std::vector<std::uint32_t> tour{first};
+        std::vector<bool> visited(m_n, false);
+        visited[first] = true;
+
+        for (std::uint32_t step = 1; step < m_n; step++) {
+            const std::uint32_t from = tour.back();
+            std::uint32_t best = 0;
+            double bestCost = INFINITY;
+            for (std::uint32_t i = 0; i < m_n; i++) {
+                if (!visited[i] && Cost(from, i) < bestCost) {
+                    best = i;
+                    bestCost = Cost(from, i);
+                }
+            }
+            visited[best] = true;
+            tour.push_back(best);
+        }
+        return tour;
+    }
+
+    // Alternate both neighbourhoods until neither improves the tour
+    void Improve(std::vector<std::uint32_t> &tour) const {
+        while (TwoOpt(tour) | OrOpt(tour)) {
+        }
+    }
+
+private:
+    static constexpr double Epsilon = 1e-4;
+
+    bool TwoOpt(std::vector<std::uint32_t> &tour) const {
+        bool improved = false;
+        for (bool again = true; again;) {
+            again = false;
+            for (std::uint32_t i = 0; i + 2 < m_n; i++) {
+                const std::uint32_t a = tour[i], b = tour[i + 1];
+                const double ab = Cost(a, b);
+                for (std::uint32_t j = i + 2; j < m_n; j++) {
+                    const std::uint32_t c = tour[j], d = tour[(j + 1) % m_n];
+                    if (d == a) {
+                        continue;
+                    }
+                    const double delta = Cost(a, c) + Cost(b, d) - ab - Cost(c, d);
+                    if (delta < -Epsilon) {
+                        std::reverse(tour.begin() + i + 1, tour.begin() + j + 1);
+                        again = improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+        return improved;
+    }
+
+    // Move segments of up to three stops elsewhere in the tour, reversed or
+    // not. The tour is a cycle, it is rotated one stop at a time so the tried
+    // segment always starts at 1.
+    bool OrOpt(std::vector<std::uint32_t> &tour) const {
+        bool improved = false;
+        for (std::uint32_t length = 1; length <= 3 && length + 2 < m_n; length++) {
+            for (std::uint32_t i = 0; i < m_n; i++) {
+                improved |= MoveSegment(tour, length);
+                std::rotate(tour.begin(), tour.begin() + 1, tour.end());
+            }
+        }
+        return improved;
+    }
+
+    bool MoveSegment(std::vector<std::uint32_t> &tour, std::uint32_t length) const {
+        const std::uint32_t p = tour[0];
+        const std::uint32_t s0 = tour[1];
+        const std::uint32_t s1 = tour[length];
+        const std::uint32_t n = tour[(length + 1) % m_n];
+        const double removeGain = Cost(p, s0) + Cost(s1, n) - Cost(p, n);
+
+        for (std::uint32_t j = length + 1; j < m_n; j++) {
+            const std::uint32_t c = tour[j];
+            const std::uint32_t e = tour[(j + 1) % m_n];
+            const double forward = Cost(c, s0) + Cost(s1, e) - Cost(c, e);
+            const double reversed = Cost(c, s1) + Cost(s0, e) - Cost(c, e);
+
+            if (std::min(forward, reversed) - removeGain < -Epsilon) {
+                std::vector<std::uint32_t> segment(tour.begin() + 1, tour.begin() + 1 + length);
+                if (reversed < forward) {
+                    std::reverse(segment.begin(), segment.end());
+                }
+                tour.erase(tour.begin() + 1, tour.begin() + 1 + length);
+                tour.insert(tour.begin() + (j - length) + 1, segment.begin(), segment.end());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::uint32_t m_n;
+    std::vector<double> m_costs;
+};
+} // namespace
+
+Tour SolveTour(const std::vector<float> &costs, std::uint32_t count, const TourOptions &options) {
+    Tour result;
+    if (count == 0) {
+        return result;
+    }
+
+    const CycleSolver solver(costs, count, options.start);
+    const std::uint32_t restarts = std::max(options.restarts, 1u);
+    std::vector<std::vector<std::uint32_t>> tours(restarts);
+    std::vector<double> lengths(restarts);
+
+    // Every restart only depends on its own index, results do not change with
+    // the number of threads
+    std::atomic<std::uint32_t> next = 0;
+    auto worker = [&]() {
+        for (std::uint32_t r = next++; r < restarts; r = next++) {
+            std::mt19937 rng(options.seed + r);
+            const std::uint32_t first = r == 0 ? count : rng() % (count + 1);
+
+            tours[r] = solver.NearestNeighbour(first);
+            solver.Improve(tours[r]);
+            lengths[r] = solver.Length(tours[r]);
+        }
+    };
+
+    std::uint32_t threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = std::clamp(threads, 1u, restarts);
+    std::vector<std::thread> pool;
+    for (std::uint32_t i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &t : pool) {
+        t.join();
+    }
+
+    const size_t best = std::min_element(lengths.begin(), lengths.end()) - lengths.begin();
+    std::vector<std::uint32_t> &tour = tours[best];
+
+    // Cut the cycle at the extra stop
+    std::rotate(tour.begin(), std::find(tour.begin(), tour.end(), count), tour.end());
+    result.order.assign(tour.begin() + 1, tour.end());
+    if (options.start >= 0 && result.order.front() != (std::uint32_t)options.start) {
+        std::reverse(result.order.begin(), result.order.end());
+    }
+
+    for (size_t i = 1; i < result.order.size(); i++) {
+        result.length += costs[result.order[i - 1] * count + result.order[i]];
+    }
+    return result;
+}
+
+std::vector<float> ItemTravelCosts(const RoomGraph &graph, const std::vector<ItemRecord> &items,
+                                   const std::vector<std::uint32_t> &ids) {
+    const size_t count = ids.size();
+
+    // Items are stored with y and z swapped compared to the world meshes
+    struct Stop {
+        int node;
+        float position[3];
+        float toCenter;
+    };
+    std::vector<Stop> stops(count);
+    for (size_t i = 0; i < count; i++) {
+        const ItemRecord &item = items[ids[i]];
+        Stop &stop = stops[i];
+        stop.node = graph.Node(item.worldIndex, (int)item.roomIndex);
+        stop.position[0] = item.x;
+        stop.position[1] = item.z;
+        stop.position[2] = item.y;
+        stop.toCenter = 0.f;
+        if (stop.node >= 0) {
+            const float *center = graph.Nodes()[stop.node].center;
+            stop.toCenter = std::hypot(stop.position[0] - center[0], stop.position[1] - center[1],
+                                       stop.position[2] - center[2]);
+        }
+    }
+
+    std::vector<float> costs(count * count, 0.f);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            const Stop &a = stops[i];
+            const Stop &b = stops[j];
+            const ItemRecord &itemA = items[ids[i]];
+            const ItemRecord &itemB = items[ids[j]];
+
+            float cost = RoomGraph::Unreachable;
+            // Rooms missing from the graph fall back on a straight line
+            const bool sameRoom = itemA.roomIndex == itemB.roomIndex || a.node < 0 || b.node < 0;
+            if (itemA.worldIndex == itemB.worldIndex && sameRoom) {
+                cost = std::hypot(a.position[0] - b.position[0], a.position[1] - b.position[1],
+                                  a.position[2] - b.position[2]);
+            } else if (a.node >= 0 && b.node >= 0) {
+                cost = a.toCenter + graph.Distance(a.node, b.node) + b.toCenter;
+            }
+            costs[i * count + j] = costs[j * count + i] = cost;
+        }
+    }
+    return costs;
+}
@@ -0,0 +1,233 @@
+#include "TrackerState.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+const std::uint8_t SnapshotTag = 'S';
+const std::uint8_t DeltaTag = 'D';
+const std::uint8_t TogglesTag = 'T';
+
+void AppendVarint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((std::uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((std::uint8_t)value);
+}
+
+class MessageReader {
+public:
+    MessageReader(const std::uint8_t *data, std::size_t size) : m_data(data), m_size(size) {}
+
+    std::uint8_t Byte() {
+        if (m_offset >= m_size) {
+            throw std::runtime_error("Truncated tracker message");
+        }
+        return m_data[m_offset++];
+    }
+
+    std::uint32_t Varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const std::uint8_t byte = Byte();
+            value |= (std::uint64_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                if (value > 0xFFFFFFFFull) {
+                    break;
+                }
+                return (std::uint32_t)value;
+            }
+        }
+        throw std::runtime_error("Bad varint in tracker message");
+    }
+
+    bool AtEnd() const { return m_offset == m_size; }
+
+private:
+    const std::uint8_t *m_data;
+    std::size_t m_size;
+    std::size_t m_offset = 0;
+};
+
+bool Bit(const std::vector<std::uint64_t> &bits, std::uint32_t id) {
+    return (bits[id >> 6] >> (id & 63)) & 1;
+}
+
+void SetBit(std::vector<std::uint64_t> &bits, std::uint32_t id, bool value) {
+    const std::uint64_t mask = 1ull << (id & 63);
+    bits[id >> 6] = value ? bits[id >> 6] | mask : bits[id >> 6] & ~mask;
+}
+} // namespace
+
+TrackerState::TrackerState(const std::vector<ItemRecord> &items) {
+    const size_t words = (items.size() + 63) / 64;
+    m_current.assign(words, 0);
+    m_published.assign(words, 0);
+    m_touchedBits.assign(words, 0);
+    for (const ItemRecord &item : items) {
+        // Worlds count from 1, a 0 would be an item outside any world
+        const std::uint32_t world = std::max<std::uint32_t>(item.worldIndex, 1);
+        m_worldOf.push_back(world - 1);
+        if (world > m_progress.size()) {
+            m_progress.resize(world);
+        }
+        m_progress[world - 1].total++;
+    }
+}
+
+void TrackerState::Set(std::uint32_t id, bool collected) {
+    if (id >= m_worldOf.size()) {
+        return;
+    }
+    SetBit(m_current, id, collected);
+    if (!Bit(m_touchedBits, id)) {
+        SetBit(m_touchedBits, id, true);
+        m_touched.push_back(id);
+    }
+}
+
+bool TrackerState::ApplyToggles(const std::uint8_t *data, std::size_t size) {
+    std::vector<std::uint32_t> toggles;
+    try {
+        MessageReader reader(data, size);
+        if (reader.Byte() != TogglesTag) {
+            return false;
+        }
+        const std::uint32_t count = reader.Varint();
+        for (std::uint32_t i = 0; i < count; i++) {
+            toggles.push_back(reader.Varint());
+        }
+        if (!reader.AtEnd()) {
+            return false;
+        }
+    } catch (const std::runtime_error &) {
+        return false;
+    }
+    for (std::uint32_t toggle : toggles) {
+        Set(toggle >> 1, toggle & 1);
+    }
+    return true;
+}
+
+std::vector<std::uint8_t> TrackerState::TakeDelta() {
+    std::sort(m_touched.begin(), m_touched.end());
+    std::vector<std::uint32_t> changed;
+    for (std::uint32_t id : m_touched) {
+        SetBit(m_touchedBits, id, false);
+        if (Bit(m_current, id) != Bit(m_published, id)) {
+            changed.push_back(id);
+        }
+    }
+    m_touched.clear();
+    if (changed.empty()) {
+        return {};
+    }
+
+    m_version++;
+    std::vector<std::uint8_t> out;
+    out.push_back(DeltaTag);
+    AppendVarint(out, m_version);
+    AppendVarint(out, changed.size());
+    std::vector<std::uint32_t> worlds;
+    std::uint32_t previous = 0;
+    for (std::uint32_t id : changed) {
+        const bool collected = Bit(m_current, id);
+        SetBit(m_published, id, collected);
+        AppendVarint(out, (std::uint64_t)(id - previous) << 1 | (collected ? 1 : 0));
+        previous = id;
+
+        const std::uint32_t world = m_worldOf[id];
+        if (collected) {
+            m_progress[world].collected++;
+        } else {
+            m_progress[world].collected--;
+        }
+        if (std::find(worlds.begin(), worlds.end(), world) == worlds.end()) {
+            worlds.push_back(world);
+        }
+    }
+    AppendVarint(out, worlds.size());
+    for (std::uint32_t world : worlds) {
+        AppendVarint(out, world);
+        AppendVarint(out, m_progress[world].collected);
+    }
+    return out;
+}
+
+std::vector<std::uint8_t> TrackerState::Snapshot() const {
+    std::vector<std::uint8_t> out;
+    out.push_back(SnapshotTag);
+    AppendVarint(out, m_version);
+    AppendVarint(out, m_worldOf.size());
+    for (size_t i = 0; i < (m_worldOf.size() + 7) / 8; i++) {
+        out.push_back((std::uint8_t)(m_published[i / 8] >> (i % 8 * 8)));
+    }
+    AppendVarint(out, m_progress.size());
+    for (const WorldProgress &progress : m_progress) {
+        AppendVarint(out, progress.collected);
+        AppendVarint(out, progress.total);
+    }
+    return out;
+}
+
+void TrackerMirror::Apply(const std::uint8_t *data, std::size_t size) {
+    MessageReader reader(data, size);
+    const std::uint8_t tag = reader.Byte();
+    if (tag == SnapshotTag) {
+        m_version = reader.Varint();
+        m_count = reader.Varint();
+        m_collected.assign((m_count + 63) / 64, 0);
+        for (std::uint32_t i = 0; i < (m_count + 7) / 8; i++) {
+            m_collected[i / 8] |= (std::uint64_t)reader.Byte() << (i % 8 * 8);
+        }
+        m_progress.resize(reader.Varint());
+        for (WorldProgress &progress : m_progress) {
+            progress.collected = reader.Varint();
+            progress.total = reader.Varint();
+        }
+        m_joined = true;
+    } else if (tag == DeltaTag) {
+        if (!m_joined) {
+            throw std::runtime_error("Tracker delta before the snapshot");
+        }
+        const std::uint32_t version = reader.Varint();
+        if (version != m_version + 1) {
+            throw std::runtime_error("Tracker delta out of order");
+        }
+        const std::uint32_t changes = reader.Varint();
+        std::uint32_t id = 0;
+        for (std::uint32_t i = 0; i < changes; i++) {
+            const std::uint32_t change = reader.Varint();
+            id += change >> 1;
+            if (id >= m_count) {
+                throw std::runtime_error("Item out of range in tracker delta");
+            }
+            SetBit(m_collected, id, change & 1);
+        }
+        const std::uint32_t worlds = reader.Varint();
+        for (std::uint32_t i = 0; i < worlds; i++) {
+            const std::uint32_t world = reader.Varint();
+            if (world >= m_progress.size()) {
+                throw std::runtime_error("World out of range in tracker delta");
+            }
+            m_progress[world].collected = reader.Varint();
+        }
+        m_version = version;
+    } else {
+        throw std::runtime_error("Unknown tracker message");
+    }
+    if (!reader.AtEnd()) {
+        throw std::runtime_error("Trailing bytes in tracker message");
+    }
+}
+
+std::vector<std::uint8_t> EncodeTrackerToggles(const std::vector<std::pair<std::uint32_t, bool>> &toggles) {
+    std::vector<std::uint8_t> out;
+    out.push_back(TogglesTag);
+    AppendVarint(out, toggles.size());
+    for (const auto &[id, collected] : toggles) {
+        AppendVarint(out, (std::uint64_t)id << 1 | (collected ? 1 : 0));
+    }
+    return out;
+}
@@ -0,0 +1,39 @@
+#include "UploadPlanner.h"
+
+#include "Utility.h"
+
+#include <cstring>
+
+UploadPlan PlanUpload(const std::vector<SubresourceDesc> &subresources, const UploadPlanDesc &desc) {
+    UploadPlan plan;
+    plan.footprints.reserve(subresources.size());
+
+    for (const SubresourceDesc &subresource : subresources) {
+        const std::uint32_t blocksWide = RoundToNextMultiple(subresource.width, subresource.blockSize) /
+                                         subresource.blockSize;
+
+        SubresourceFootprint footprint;
+        footprint.offset = RoundToNextMultiple(plan.totalSize, (std::uint64_t)desc.placementAlignment);
+        footprint.rowBytes = blocksWide * subresource.bytesPerBlock;
+        footprint.rowPitch = RoundToNextMultiple(footprint.rowBytes, desc.rowPitchAlignment);
+        footprint.rowCount = RoundToNextMultiple(subresource.height, subresource.blockSize) /
+                             subresource.blockSize;
+
+        // The last row does not need its padding, like GetCopyableFootprints
+        if (footprint.rowCount > 0) {
+            const std::uint64_t paddedRows = (std::uint64_t)footprint.rowPitch * (footprint.rowCount - 1);
+            plan.totalSize = footprint.offset + paddedRows + footprint.rowBytes;
+        }
+        plan.footprints.push_back(footprint);
+    }
+    return plan;
+}
+
+void CopyToStaging(const SubresourceFootprint &footprint, const void *source, std::uint64_t sourceRowPitch,
+                   void *staging) {
+    const std::uint8_t *src = static_cast<const std::uint8_t *>(source);
+    std::uint8_t *dst = static_cast<std::uint8_t *>(staging) + footprint.offset;
+    for (std::uint32_t row = 0; row < footprint.rowCount; row++) {
+        memcpy(dst + (std::uint64_t)row * footprint.rowPitch, src + row * sourceRowPitch, footprint.rowBytes);
+    }
+}
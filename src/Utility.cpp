@@ -22,15 +22,20 @@
 
 #include "Utility.h"
 
-#include <stdio.h>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
 
 ///////////////////////////////////////////////////////////////////////////////
 std::vector<std::uint8_t> ReadFile(const char *filename) {
     std::vector<std::uint8_t> result;
     std::uint8_t buffer[4096];
 
-    FILE *handle = nullptr;
-    fopen_s(&handle, filename, "rb");
+    FILE *handle = std::fopen(filename, "rb");
+    if (!handle) {
+        throw std::runtime_error(std::string("Could not open ") + filename);
+    }
 
     for (;;) {
         const auto bytesRead = std::fread(buffer, 1, sizeof(buffer), handle);
@@ -46,3 +51,8 @@ std::vector<std::uint8_t> ReadFile(const char *filename) {
 
     return result;
 }
+
+///////////////////////////////////////////////////////////////////////////////
+double SteadyClockSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,702 @@
+#include "VoxelMap.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+// Empty voxels kept around the world and around every room, so the flood
+// fill of a room starts outside of its shell
+const std::int32_t Padding = 2;
+const std::int32_t BrickShift = 3;
+const std::int32_t NodeShift = 6;
+const std::int32_t DirX[6] = {-1, 1, 0, 0, 0, 0};
+const std::int32_t DirY[6] = {0, 0, -1, 1, 0, 0};
+const std::int32_t DirZ[6] = {0, 0, 0, 0, -1, 1};
+
+bool TestBit(const std::uint64_t *bits, std::int32_t x, std::int32_t y, std::int32_t z) {
+    return (bits[z] >> (x + y * 8)) & 1;
+}
+
+void SetBit(std::uint64_t *bits, std::int32_t x, std::int32_t y, std::int32_t z) {
+    bits[z] |= std::uint64_t(1) << (x + y * 8);
+}
+
+const std::uint64_t LowX = 0x0101010101010101ull;
+const std::uint64_t HighX = LowX << 7;
+const std::uint64_t LowY = 0xFFull;
+const std::uint64_t HighY = LowY << 56;
+
+// Voxels of a brick on its face towards dir, as the voxels they touch on the
+// facing side of the neighbor there
+void FaceBits(const std::uint64_t *bits, int dir, std::uint64_t *face) {
+    for (int z = 0; z < 8; z++) {
+        switch (dir) {
+        case 0:
+            face[z] = (bits[z] & LowX) << 7;
+            break;
+        case 1:
+            face[z] = (bits[z] & HighX) >> 7;
+            break;
+        case 2:
+            face[z] = (bits[z] & LowY) << 56;
+            break;
+        case 3:
+            face[z] = (bits[z] & HighY) >> 56;
+            break;
+        default:
+            face[z] = 0;
+        }
+    }
+    if (dir == 4) {
+        face[7] = bits[0];
+    } else if (dir == 5) {
+        face[0] = bits[7];
+    }
+}
+
+// Grows bits by a voxel along each axis at a time, all words at once, until
+// walls stop them
+void Dilate(std::uint64_t *bits, const std::uint64_t *walls) {
+    for (bool grown = true; grown;) {
+        grown = false;
+        std::uint64_t previous = 0;
+        for (int z = 0; z < 8; z++) {
+            const std::uint64_t word = bits[z];
+            std::uint64_t next = word | ((word << 1) & ~LowX) | ((word >> 1) & ~HighX) | (word << 8) |
+                                 (word >> 8) | previous | (z < 7 ? bits[z + 1] : 0);
+            next &= ~walls[z];
+            grown = grown || next != word;
+            previous = word;
+            bits[z] = next;
+        }
+    }
+}
+
+// Brick of a voxel within its node
+std::uint32_t BrickIndex(const std::int32_t voxel[3]) {
+    const std::int32_t mask = VoxelMap::NodeSize - 1;
+    return ((voxel[0] >> BrickShift) & mask) + ((voxel[1] >> BrickShift) & mask) * VoxelMap::NodeSize +
+           ((voxel[2] >> BrickShift) & mask) * VoxelMap::NodeSize * VoxelMap::NodeSize;
+}
+
+// Triangle against unit voxels, Schwarz and Seidel 2010: a voxel touches the
+// triangle when it touches its plane and the projections of both onto the
+// three axis planes overlap. Coordinates are in voxels.
+class TriangleTest {
+public:
+    // False for triangles without area
+    bool Setup(const float *a, const float *b, const float *c) {
+        const float *v[3] = {a, b, c};
+        float e[3][3];
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                e[i][k] = v[(i + 1) % 3][k] - v[i][k];
+            }
+        }
+        m_normal[0] = e[0][1] * e[1][2] - e[0][2] * e[1][1];
+        m_normal[1] = e[0][2] * e[1][0] - e[0][0] * e[1][2];
+        m_normal[2] = e[0][0] * e[1][1] - e[0][1] * e[1][0];
+        if (m_normal[0] == 0.f && m_normal[1] == 0.f && m_normal[2] == 0.f) {
+            return false;
+        }
+
+        // The voxel corners furthest along the normal and against it
+        m_near = m_far = 0.f;
+        for (int k = 0; k < 3; k++) {
+            const float critical = m_normal[k] > 0.f ? 1.f : 0.f;
+            m_near += m_normal[k] * (critical - a[k]);
+            m_far += m_normal[k] * (1.f - critical - a[k]);
+        }
+
+        // Edge normals in the plane dropping axis, facing into the triangle
+        for (int axis = 0; axis < 3; axis++) {
+            const int u = (axis + 1) % 3, w = (axis + 2) % 3;
+            const float sign = m_normal[axis] >= 0.f ? 1.f : -1.f;
+            for (int i = 0; i < 3; i++) {
+                Edge &edge = m_edges[axis][i];
+                edge.u = -e[i][w] * sign;
+                edge.w = e[i][u] * sign;
+                edge.d = -(edge.u * v[i][u] + edge.w * v[i][w]) + std::max(0.f, edge.u) +
+                         std::max(0.f, edge.w);
+            }
+        }
+        return true;
+    }
+
+    bool Overlaps(std::int32_t x, std::int32_t y, std::int32_t z) const {
+        const float p[3] = {(float)x, (float)y, (float)z};
+        const float plane = m_normal[0] * p[0] + m_normal[1] * p[1] + m_normal[2] * p[2];
+        if ((plane + m_near) * (plane + m_far) > 0.f) {
+            return false;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            const int u = (axis + 1) % 3, w = (axis + 2) % 3;
+            for (const Edge &edge : m_edges[axis]) {
+                if (edge.u * p[u] + edge.w * p[w] + edge.d < 0.f) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Edge {
+        float u, w, d;
+    };
+
+    float m_normal[3];
+    float m_near, m_far;
+    Edge m_edges[3][3];
+};
+} // namespace
+
+struct VoxelMap::RoomResult {
+    // Box of bricks around the room, in bricks of the map
+    std::int32_t brickMin[3] = {};
+    std::int32_t brickCount[3] = {};
+    // Bricks of the box the room's triangles touch, with the solid voxels and
+    // those of the room, the solid ones included
+    std::vector<std::uint32_t> surfaceBricks;
+    std::vector<Brick> solid;
+    std::vector<Brick> inside;
+    // Bricks of the box wholly in the room
+    std::vector<std::uint32_t> wholeBricks;
+    bool filled = false;
+};
+
+void VoxelMap::BuildRoom(const WorldMesh &mesh, const RoomMesh &room, RoomResult &result) const {
+    const float scale = 1.f / m_voxelSize;
+    std::int32_t size[3];
+    for (int k = 0; k < 3; k++) {
+        const std::int32_t last = m_nodes[k] * NodeSize * BrickSize - 1;
+        const std::int32_t low =
+            (std::int32_t)std::floor((room.boundsMin[k] - m_origin[k]) * scale) - Padding;
+        const std::int32_t high =
+            (std::int32_t)std::floor((room.boundsMax[k] - m_origin[k]) * scale) + Padding;
+        result.brickMin[k] = std::clamp(low, 0, last) >> BrickShift;
+        result.brickCount[k] = (std::clamp(high, 0, last) >> BrickShift) - result.brickMin[k] + 1;
+        size[k] = result.brickCount[k] * BrickSize;
+    }
+    const std::int32_t bricksX = result.brickCount[0], bricksY = result.brickCount[1];
+    auto brickOf = [&](std::int32_t x, std::int32_t y, std::int32_t z) {
+        return (std::uint32_t)((x >> BrickShift) +
+                               ((y >> BrickShift) + (z >> BrickShift) * bricksY) * bricksX);
+    };
+
+    // Voxels the room's triangles touch, in box voxels. The holes of the
+    // shell are capped for the flood fill, so a room isn't filled from its
+    // doors, but the caps aren't solid.
+    std::vector<std::uint32_t> slots((size_t)bricksX * bricksY * result.brickCount[2], NoIndex);
+    std::vector<Brick> walls;
+    TriangleTest test;
+    auto rasterize = [&](const float *a, const float *b, const float *c, bool cap) {
+        float p[3][3];
+        const float *corners[3] = {a, b, c};
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < 3; k++) {
+                p[j][k] = (corners[j][k] - m_origin[k]) * scale - (float)(result.brickMin[k] * BrickSize);
+            }
+        }
+        if (!test.Setup(p[0], p[1], p[2])) {
+            return;
+        }
+        std::int32_t low[3], high[3];
+        for (int k = 0; k < 3; k++) {
+            const float min = std::min({p[0][k], p[1][k], p[2][k]});
+            const float max = std::max({p[0][k], p[1][k], p[2][k]});
+            low[k] = std::clamp((std::int32_t)std::floor(min), 0, size[k] - 1);
+            high[k] = std::clamp((std::int32_t)std::floor(max), 0, size[k] - 1);
+        }
+        for (std::int32_t z = low[2]; z <= high[2]; z++) {
+            for (std::int32_t y = low[1]; y <= high[1]; y++) {
+                for (std::int32_t x = low[0]; x <= high[0]; x++) {
+                    if (!test.Overlaps(x, y, z)) {
+                        continue;
+                    }
+                    std::uint32_t &slot = slots[brickOf(x, y, z)];
+                    if (slot == NoIndex) {
+                        slot = (std::uint32_t)result.solid.size();
+                        result.solid.push_back(Brick{});
+                        walls.push_back(Brick{});
+                        result.surfaceBricks.push_back(brickOf(x, y, z));
+                    }
+                    SetBit(walls[slot].bits, x & 7, y & 7, z & 7);
+                    if (!cap) {
+                        SetBit(result.solid[slot].bits, x & 7, y & 7, z & 7);
+                    }
+                }
+            }
+        }
+    };
+
+    // Corners are welded by position, the OBJ splits them by normal
+    std::vector<std::array<float, 3>> corners(room.indexCount);
+    for (std::uint32_t i = 0; i < room.indexCount; i++) {
+        const float *position = mesh.vertices[room.firstVertex + mesh.indices[room.firstIndex + i]].position;
+        corners[i] = {position[0], position[1], position[2]};
+    }
+    std::vector<std::array<float, 3>> welded = corners;
+    std::sort(welded.begin(), welded.end());
+    welded.erase(std::unique(welded.begin(), welded.end()), welded.end());
+    auto weld = [&](std::uint32_t i) {
+        return (std::uint32_t)(std::lower_bound(welded.begin(), welded.end(), corners[i]) - welded.begin());
+    };
+
+    // Edges, as wound, kept when no other triangle has them
+    std::vector<std::array<std::uint32_t, 3>> edges;
+    for (std::uint32_t i = 0; i + 2 < room.indexCount; i += 3) {
+        rasterize(corners[i].data(), corners[i + 1].data(), corners[i + 2].data(), false);
+        for (std::uint32_t j = 0; j < 3; j++) {
+            const std::uint32_t a = weld(i + j), b = weld(i + (j + 1) % 3);
+            if (a != b) {
+                edges.push_back({std::min(a, b), std::max(a, b), a});
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> open;
+    for (size_t i = 0; i < edges.size();) {
+        size_t same = i + 1;
+        while (same < edges.size() && edges[same][0] == edges[i][0] && edges[same][1] == edges[i][1]) {
+            same++;
+        }
+        if (same == i + 1) {
+            const std::uint32_t other = edges[i][2] == edges[i][0] ? edges[i][1] : edges[i][0];
+            open.push_back({edges[i][2], other});
+        }
+        i = same;
+    }
+
+    // Open edges chained into loops, each capped by a fan from its centroid
+    std::sort(open.begin(), open.end());
+    std::vector<std::uint8_t> used(open.size(), 0);
+    std::vector<std::uint32_t> loop;
+    for (size_t first = 0; first < open.size(); first++) {
+        loop.clear();
+        for (size_t edge = first; edge < open.size() && !used[edge];) {
+            used[edge] = 1;
+            loop.push_back(open[edge].first);
+            auto next = std::lower_bound(open.begin(), open.end(), std::make_pair(open[edge].second, 0u));
+            while (next != open.end() && next->first == open[edge].second && used[next - open.begin()]) {
+                next++;
+            }
+            edge = next != open.end() && next->first == open[edge].second ? next - open.begin() : open.size();
+        }
+        if (loop.size() < 3) {
+            continue;
+        }
+        float center[3] = {};
+        for (std::uint32_t corner : loop) {
+            for (int k = 0; k < 3; k++) {
+                center[k] += welded[corner][k] / (float)loop.size();
+            }
+        }
+        for (size_t i = 0; i < loop.size(); i++) {
+            rasterize(center, welded[loop[i]].data(), welded[loop[(i + 1) % loop.size()]].data(), true);
+        }
+    }
+
+    // Flood fill of the outside from the faces of the box, a brick at a time.
+    // Bricks the room doesn't touch are reached whole, in the others the
+    // reached voxels grow by whole words until the walls stop them.
+    std::vector<Brick> reached(result.solid.size(), Brick{});
+    std::vector<std::uint8_t> queued(slots.size(), 0);
+    std::vector<std::uint32_t> stack;
+    auto seed = [&](std::int32_t bx, std::int32_t by, std::int32_t bz, const std::uint64_t *bits) {
+        if (bx < 0 || by < 0 || bz < 0 || bx >= bricksX || by >= bricksY || bz >= result.brickCount[2]) {
+            return;
+        }
+        const std::uint32_t brick = (std::uint32_t)(bx + (by + bz * bricksY) * bricksX);
+        const std::uint32_t slot = slots[brick];
+        if (slot == NoIndex) {
+            // Whole bricks stay marked once reached
+            if (!queued[brick] &&
+                std::any_of(bits, bits + BrickSize, [](std::uint64_t w) { return w != 0; })) {
+                queued[brick] = 1;
+                stack.push_back(brick);
+            }
+            return;
+        }
+        std::uint64_t added = 0;
+        for (int w = 0; w < BrickSize; w++) {
+            const std::uint64_t grown = bits[w] & ~walls[slot].bits[w] & ~reached[slot].bits[w];
+            reached[slot].bits[w] |= grown;
+            added |= grown;
+        }
+        if (added && !queued[brick]) {
+            queued[brick] = 1;
+            stack.push_back(brick);
+        }
+    };
+    Brick full, face;
+    std::fill_n(full.bits, BrickSize, ~std::uint64_t(0));
+    for (std::int32_t bz = 0; bz < result.brickCount[2]; bz++) {
+        for (std::int32_t by = 0; by < bricksY; by++) {
+            for (std::int32_t bx = 0; bx < bricksX; bx++) {
+                const std::int32_t b[3] = {bx, by, bz};
+                for (int axis = 0; axis < 3; axis++) {
+                    // The low face is what a brick below would pass up
+                    if (b[axis] == 0) {
+                        FaceBits(full.bits, axis * 2 + 1, face.bits);
+                        seed(bx, by, bz, face.bits);
+                    }
+                    if (b[axis] == result.brickCount[axis] - 1) {
+                        FaceBits(full.bits, axis * 2, face.bits);
+                        seed(bx, by, bz, face.bits);
+                    }
+                }
+            }
+        }
+    }
+    while (!stack.empty()) {
+        const std::uint32_t brick = stack.back();
+        stack.pop_back();
+        const std::int32_t bx = (std::int32_t)(brick % bricksX);
+        const std::int32_t by = (std::int32_t)(brick / bricksX % bricksY);
+        const std::int32_t bz = (std::int32_t)(brick / bricksX / bricksY);
+        const std::uint32_t slot = slots[brick];
+        const std::uint64_t *bits = full.bits;
+        if (slot != NoIndex) {
+            queued[brick] = 0;
+            Dilate(reached[slot].bits, walls[slot].bits);
+            bits = reached[slot].bits;
+        }
+        for (int dir = 0; dir < 6; dir++) {
+            FaceBits(bits, dir, face.bits);
+            seed(bx + DirX[dir], by + DirY[dir], bz + DirZ[dir], face.bits);
+        }
+    }
+
+    // What wasn't reached is the room
+    for (std::uint32_t brick = 0; brick < slots.size(); brick++) {
+        if (slots[brick] == NoIndex && !queued[brick]) {
+            result.wholeBricks.push_back(brick);
+        }
+    }
+    result.filled = !result.wholeBricks.empty();
+    result.inside.resize(result.solid.size());
+    for (size_t slot = 0; slot < result.solid.size(); slot++) {
+        for (int w = 0; w < BrickSize; w++) {
+            result.inside[slot].bits[w] = ~reached[slot].bits[w];
+            result.filled = result.filled || (result.inside[slot].bits[w] & ~walls[slot].bits[w]) != 0;
+        }
+    }
+}
+
+void VoxelMap::Build(const WorldMesh &mesh, float voxelSize, ThreadPool *pool) {
+    *this = VoxelMap();
+    m_voxelSize = voxelSize;
+    if (mesh.vertices.empty()) {
+        return;
+    }
+
+    float low[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, high[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (const MeshVertex &vertex : mesh.vertices) {
+        for (int k = 0; k < 3; k++) {
+            low[k] = std::min(low[k], vertex.position[k]);
+            high[k] = std::max(high[k], vertex.position[k]);
+        }
+    }
+    const float nodeWorld = voxelSize * BrickSize * NodeSize;
+    for (int k = 0; k < 3; k++) {
+        m_origin[k] = low[k] - Padding * voxelSize;
+        const float extent = high[k] + Padding * voxelSize - m_origin[k];
+        m_nodes[k] = std::max(1, (std::int32_t)std::ceil(extent / nodeWorld));
+        m_boundsMax[k] = m_origin[k] + m_nodes[k] * nodeWorld;
+    }
+    m_grid.assign((size_t)m_nodes[0] * m_nodes[1] * m_nodes[2], NoIndex);
+
+    std::vector<RoomResult> results(mesh.rooms.size());
+    auto buildRoom = [&](std::uint32_t room) {
+        if (mesh.rooms[room].indexCount >= 3) {
+            BuildRoom(mesh, mesh.rooms[room], results[room]);
+        }
+    };
+    if (pool) {
+        pool->ParallelFor((std::uint32_t)results.size(), buildRoom);
+    } else {
+        for (std::uint32_t room = 0; room < results.size(); room++) {
+            buildRoom(room);
+        }
+    }
+
+    // Merged in room order, so the first of overlapping rooms owns their
+    // shared voxels
+    Brick full;
+    std::fill_n(full.bits, BrickSize, ~std::uint64_t(0));
+    for (std::uint32_t room = 0; room < results.size(); room++) {
+        RoomResult &result = results[room];
+        auto voxelOf = [&](std::uint32_t brick, std::int32_t voxel[3]) {
+            const std::uint32_t bricksX = result.brickCount[0], bricksY = result.brickCount[1];
+            voxel[0] = (result.brickMin[0] + (std::int32_t)(brick % bricksX)) * BrickSize;
+            voxel[1] = (result.brickMin[1] + (std::int32_t)(brick / bricksX % bricksY)) * BrickSize;
+            voxel[2] = (result.brickMin[2] + (std::int32_t)(brick / bricksX / bricksY)) * BrickSize;
+        };
+        for (size_t i = 0; i < result.surfaceBricks.size(); i++) {
+            std::int32_t voxel[3];
+            voxelOf(result.surfaceBricks[i], voxel);
+            Node &node = NodeFor(voxel);
+            const std::uint32_t index = BrickIndex(voxel);
+            // Bricks only a cap touches have no solid voxel
+            const Brick &solid = result.solid[i];
+            if (std::any_of(solid.bits, solid.bits + BrickSize,
+                            [](std::uint64_t word) { return word != 0; })) {
+                if (node.bricks[index] == NoIndex) {
+                    node.bricks[index] = (std::uint32_t)m_bricks.size();
+                    m_bricks.push_back(Brick{});
+                }
+                Brick &brick = m_bricks[node.bricks[index]];
+                for (int w = 0; w < BrickSize; w++) {
+                    brick.bits[w] |= solid.bits[w];
+                }
+            }
+            AddRoomMask(node.rooms[index], room, result.inside[i]);
+        }
+        for (std::uint32_t whole : result.wholeBricks) {
+            std::int32_t voxel[3];
+            voxelOf(whole, voxel);
+            std::uint32_t &rooms = NodeFor(voxel).rooms[BrickIndex(voxel)];
+            if (rooms == NoIndex) {
+                rooms = WholeRoom | room;
+                m_stats.roomBricks++;
+            } else if (!(rooms & WholeRoom)) {
+                AddRoomMask(rooms, room, full);
+            }
+        }
+        m_stats.filledRooms += result.filled ? 1 : 0;
+        result = RoomResult();
+    }
+
+    m_nodeData.shrink_to_fit();
+    m_bricks.shrink_to_fit();
+    m_roomMasks.shrink_to_fit();
+    m_stats.nodes = (std::uint32_t)m_nodeData.size();
+    m_stats.bricks = (std::uint32_t)m_bricks.size();
+    m_stats.roomMasks = (std::uint32_t)m_roomMasks.size();
+    for (const Brick &brick : m_bricks) {
+        for (std::uint64_t word : brick.bits) {
+            m_stats.solidVoxels += std::popcount(word);
+        }
+    }
+}
+
+void VoxelMap::AddRoomMask(std::uint32_t &rooms, std::uint32_t room, const Brick &mask) {
+    const std::uint32_t added = (std::uint32_t)m_roomMasks.size();
+    if (rooms == NoIndex) {
+        rooms = added;
+        m_roomMasks.push_back({mask, room, NoIndex});
+        return;
+    }
+    if (rooms & WholeRoom) {
+        // The brick was wholly in another room, which keeps it
+        Brick full;
+        std::fill_n(full.bits, BrickSize, ~std::uint64_t(0));
+        m_roomMasks.push_back({full, rooms & ~WholeRoom, NoIndex});
+        rooms = added;
+    }
+    std::uint32_t last = rooms;
+    while (m_roomMasks[last].next != NoIndex) {
+        last = m_roomMasks[last].next;
+    }
+    m_roomMasks[last].next = (std::uint32_t)m_roomMasks.size();
+    m_roomMasks.push_back({mask, room, NoIndex});
+}
+
+bool VoxelMap::Voxel(const float point[3], std::int32_t voxel[3]) const {
+    for (int k = 0; k < 3; k++) {
+        const float f = (point[k] - m_origin[k]) / m_voxelSize;
+        if (!(f >= 0.f) || f >= (float)(m_nodes[k] * NodeSize * BrickSize)) {
+            return false;
+        }
+        voxel[k] = std::min((std::int32_t)f, m_nodes[k] * NodeSize * BrickSize - 1);
+    }
+    return true;
+}
+
+const VoxelMap::Node *VoxelMap::NodeAt(const std::int32_t voxel[3]) const {
+    const std::uint32_t node =
+        m_grid[(voxel[0] >> NodeShift) +
+               ((voxel[1] >> NodeShift) + (voxel[2] >> NodeShift) * m_nodes[1]) * m_nodes[0]];
+    return node == NoIndex ? nullptr : &m_nodeData[node];
+}
+
+VoxelMap::Node &VoxelMap::NodeFor(const std::int32_t voxel[3]) {
+    std::uint32_t &node =
+        m_grid[(voxel[0] >> NodeShift) +
+               ((voxel[1] >> NodeShift) + (voxel[2] >> NodeShift) * m_nodes[1]) * m_nodes[0]];
+    if (node == NoIndex) {
+        node = (std::uint32_t)m_nodeData.size();
+        m_nodeData.emplace_back();
+        std::fill_n(m_nodeData.back().bricks, NodeSize * NodeSize * NodeSize, NoIndex);
+        std::fill_n(m_nodeData.back().rooms, NodeSize * NodeSize * NodeSize, NoIndex);
+    }
+    return m_nodeData[node];
+}
+
+bool VoxelMap::SolidVoxel(const std::int32_t voxel[3]) const {
+    const Node *node = NodeAt(voxel);
+    if (!node) {
+        return false;
+    }
+    const std::uint32_t brick = node->bricks[BrickIndex(voxel)];
+    return brick != NoIndex && TestBit(m_bricks[brick].bits, voxel[0] & 7, voxel[1] & 7, voxel[2] & 7);
+}
+
+bool VoxelMap::Solid(const float point[3]) const {
+    std::int32_t voxel[3];
+    return Voxel(point, voxel) && SolidVoxel(voxel);
+}
+
+std::uint32_t VoxelMap::RoomAt(const float point[3]) const {
+    std::int32_t voxel[3];
+    const Node *node = Voxel(point, voxel) ? NodeAt(voxel) : nullptr;
+    if (!node) {
+        return NoRoom;
+    }
+    const std::uint32_t rooms = node->rooms[BrickIndex(voxel)];
+    if (rooms == NoIndex) {
+        return NoRoom;
+    }
+    if (rooms & WholeRoom) {
+        return rooms & ~WholeRoom;
+    }
+    for (std::uint32_t i = rooms; i != NoIndex; i = m_roomMasks[i].next) {
+        if (TestBit(m_roomMasks[i].mask.bits, voxel[0] & 7, voxel[1] & 7, voxel[2] & 7)) {
+            return m_roomMasks[i].room;
+        }
+    }
+    return NoRoom;
+}
+
+bool VoxelMap::Raycast(const float origin[3], const float direction[3], float maxDistance,
+                       VoxelHit &hit) const {
+    return March(origin, direction, maxDistance, true, hit);
+}
+
+bool VoxelMap::RaycastVoxels(const float origin[3], const float direction[3], float maxDistance,
+                             VoxelHit &hit) const {
+    return March(origin, direction, maxDistance, false, hit);
+}
+
+// Amanatides and Woo in voxel units. An empty node or brick is left through
+// the face the ray exits it by, and the walk picks up from the voxel past it.
+bool VoxelMap::March(const float origin[3], const float direction[3], float maxDistance, bool skipEmpty,
+                     VoxelHit &hit) const {
+    if (m_grid.empty()) {
+        return false;
+    }
+    const std::int32_t size[3] = {m_nodes[0] * NodeSize * BrickSize, m_nodes[1] * NodeSize * BrickSize,
+                                  m_nodes[2] * NodeSize * BrickSize};
+    float o[3], tEnter = 0.f, tExit = maxDistance / m_voxelSize;
+    for (int k = 0; k < 3; k++) {
+        o[k] = (origin[k] - m_origin[k]) / m_voxelSize;
+        if (direction[k] == 0.f) {
+            if (o[k] < 0.f || o[k] >= (float)size[k]) {
+                return false;
+            }
+            continue;
+        }
+        float t0 = -o[k] / direction[k], t1 = ((float)size[k] - o[k]) / direction[k];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+    }
+    if (tEnter > tExit) {
+        return false;
+    }
+
+    std::int32_t voxel[3], step[3];
+    for (int k = 0; k < 3; k++) {
+        step[k] = direction[k] > 0.f ? 1 : direction[k] < 0.f ? -1 : 0;
+    }
+    // Ray distance to the far face of the current voxel on an axis, computed
+    // from the face rather than summed, so skipping empty cells lands exactly
+    // where stepping voxel by voxel would
+    float tMax[3];
+    auto faceDistance = [&](int k) {
+        if (step[k] > 0) {
+            return ((float)voxel[k] + 1.f - o[k]) / direction[k];
+        }
+        return step[k] < 0 ? ((float)voxel[k] - o[k]) / direction[k] : FLT_MAX;
+    };
+    auto restart = [&] {
+        for (int k = 0; k < 3; k++) {
+            tMax[k] = faceDistance(k);
+        }
+    };
+    for (int k = 0; k < 3; k++) {
+        voxel[k] = std::clamp((std::int32_t)std::floor(o[k] + direction[k] * tEnter), 0, size[k] - 1);
+    }
+    float t = tEnter;
+    restart();
+
+    while (t <= tExit) {
+        std::int32_t empty = 0;
+        if (skipEmpty) {
+            const Node *node = NodeAt(voxel);
+            if (!node) {
+                empty = NodeSize * BrickSize;
+            } else if (node->bricks[BrickIndex(voxel)] == NoIndex) {
+                empty = BrickSize;
+            }
+        }
+        if (empty) {
+            // Out through the nearest face of the empty cell
+            std::int32_t first[3];
+            float faceT[3];
+            int axis = 0;
+            for (int k = 0; k < 3; k++) {
+                first[k] = voxel[k] & ~(empty - 1);
+                if (step[k] > 0) {
+                    faceT[k] = ((float)(first[k] + empty) - o[k]) / direction[k];
+                } else if (step[k] < 0) {
+                    faceT[k] = ((float)first[k] - o[k]) / direction[k];
+                } else {
+                    faceT[k] = FLT_MAX;
+                }
+                axis = faceT[k] < faceT[axis] ? k : axis;
+            }
+            t = std::max(t, faceT[axis]);
+            for (int k = 0; k < 3; k++) {
+                voxel[k] = k == axis ? (step[k] > 0 ? first[k] + empty : first[k] - 1)
+                                     : std::clamp((std::int32_t)std::floor(o[k] + direction[k] * t), first[k],
+                                                  first[k] + empty - 1);
+            }
+            if (voxel[axis] < 0 || voxel[axis] >= size[axis]) {
+                return false;
+            }
+            restart();
+            continue;
+        }
+
+        if (SolidVoxel(voxel)) {
+            hit.distance = t * m_voxelSize;
+            for (int k = 0; k < 3; k++) {
+                hit.position[k] = origin[k] + direction[k] * hit.distance;
+                hit.voxel[k] = voxel[k];
+            }
+            return true;
+        }
+        int axis = tMax[0] < tMax[1] ? 0 : 1;
+        axis = tMax[2] < tMax[axis] ? 2 : axis;
+        t = tMax[axis];
+        voxel[axis] += step[axis];
+        tMax[axis] = faceDistance(axis);
+        if (voxel[axis] < 0 || voxel[axis] >= size[axis]) {
+            return false;
+        }
+    }
+    return false;
+}
+
+size_t VoxelMap::MemoryBytes() const {
+    return m_grid.capacity() * sizeof(std::uint32_t) + m_nodeData.capacity() * sizeof(Node) +
+           m_bricks.capacity() * sizeof(Brick) + m_roomMasks.capacity() * sizeof(RoomMask);
+}
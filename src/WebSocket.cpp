@@ -0,0 +1,164 @@
+#include "WebSocket.h"
+
+#include <stdexcept>
+
+namespace {
+std::uint32_t RotateLeft(std::uint32_t value, int bits) { return value << bits | value >> (32 - bits); }
+
+// Only ever hashes handshake keys, speed doesn't matter
+void Sha1(const std::string &message, std::uint8_t digest[20]) {
+    std::uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    std::string padded = message;
+    padded += (char)0x80;
+    while (padded.size() % 64 != 56) {
+        padded += (char)0;
+    }
+    const std::uint64_t bits = (std::uint64_t)message.size() * 8;
+    for (int i = 7; i >= 0; i--) {
+        padded += (char)(bits >> (i * 8));
+    }
+
+    for (size_t block = 0; block < padded.size(); block += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const unsigned char *p = (const unsigned char *)padded.data() + block + i * 4;
+            w[i] = (std::uint32_t)p[0] << 24 | (std::uint32_t)p[1] << 16 | (std::uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = RotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            std::uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            const std::uint32_t temp = RotateLeft(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = RotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 20; i++) {
+        digest[i] = (std::uint8_t)(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+}
+
+std::string Base64(const std::uint8_t *data, size_t size) {
+    static const char Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3) {
+        const std::uint32_t group = (std::uint32_t)data[i] << 16 | (i + 1 < size ? data[i + 1] << 8 : 0) |
+                                    (i + 2 < size ? data[i + 2] : 0);
+        out += Alphabet[group >> 18 & 63];
+        out += Alphabet[group >> 12 & 63];
+        out += i + 1 < size ? Alphabet[group >> 6 & 63] : '=';
+        out += i + 2 < size ? Alphabet[group & 63] : '=';
+    }
+    return out;
+}
+} // namespace
+
+std::string WebSocketAccept(const std::string &key) {
+    std::uint8_t digest[20];
+    Sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    return Base64(digest, sizeof(digest));
+}
+
+void AppendWebSocketFrame(std::string &out, WebSocketOpcode opcode, const void *payload, std::size_t size,
+                          const std::uint8_t *mask) {
+    out += (char)(0x80 | (std::uint8_t)opcode);
+    const std::uint8_t maskBit = mask ? 0x80 : 0;
+    if (size < 126) {
+        out += (char)(maskBit | size);
+    } else if (size <= 0xFFFF) {
+        out += (char)(maskBit | 126);
+        out += (char)(size >> 8);
+        out += (char)size;
+    } else {
+        out += (char)(maskBit | 127);
+        for (int i = 7; i >= 0; i--) {
+            out += (char)((std::uint64_t)size >> (i * 8));
+        }
+    }
+
+    if (!mask) {
+        out.append((const char *)payload, size);
+        return;
+    }
+    out.append((const char *)mask, 4);
+    const size_t start = out.size();
+    out.append((const char *)payload, size);
+    for (size_t i = 0; i < size; i++) {
+        out[start + i] ^= (char)mask[i % 4];
+    }
+}
+
+std::size_t ParseWebSocketFrame(const char *data, std::size_t size, std::size_t maxPayload,
+                                WebSocketFrame &frame) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    if (size < 2) {
+        return 0;
+    }
+    if (bytes[0] & 0x70) {
+        throw std::runtime_error("Reserved bits set in WebSocket frame");
+    }
+    const std::uint8_t opcode = bytes[0] & 0x0F;
+    if (opcode > 0xA || (opcode > 0x2 && opcode < 0x8)) {
+        throw std::runtime_error("Unknown WebSocket opcode");
+    }
+
+    size_t offset = 2;
+    std::uint64_t length = bytes[1] & 0x7F;
+    if (length == 126 || length == 127) {
+        const size_t extra = length == 126 ? 2 : 8;
+        if (size < offset + extra) {
+            return 0;
+        }
+        length = 0;
+        for (size_t i = 0; i < extra; i++) {
+            length = length << 8 | bytes[offset + i];
+        }
+        offset += extra;
+    }
+    if (length > maxPayload) {
+        throw std::runtime_error("WebSocket message too big");
+    }
+    const bool masked = bytes[1] & 0x80;
+    const size_t maskOffset = offset;
+    offset += masked ? 4 : 0;
+    if (size < offset + length) {
+        return 0;
+    }
+
+    frame.opcode = (WebSocketOpcode)opcode;
+    frame.final = bytes[0] & 0x80;
+    frame.masked = masked;
+    frame.payload.assign(data + offset, (size_t)length);
+    if (masked) {
+        for (size_t i = 0; i < length; i++) {
+            frame.payload[i] ^= (char)bytes[maskOffset + i % 4];
+        }
+    }
+    return offset + (size_t)length;
+}
@@ -16,6 +16,8 @@
 
 #include "stdafx.h"
 
+#include <cmath>
+
 HWND Win32Application::m_hwnd = nullptr;
 
 int Win32Application::Run(DXSample *pSample, HINSTANCE hInstance, int nCmdShow) {
@@ -65,7 +67,20 @@ int Win32Application::Run(DXSample *pSample, HINSTANCE hInstance, int nCmdShow)
         if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
             TranslateMessage(&msg);
             DispatchMessage(&msg);
+            continue;
+        }
+
+        // Frames are drawn on demand, in between the thread sleeps until the
+        // sample wants one or a message arrives
+        const double wait = pSample->OnIdle();
+        if (wait > 0.0) {
+            MsgWaitForMultipleObjects(0, nullptr, FALSE, (DWORD)std::ceil(wait * 1000.0), QS_ALLINPUT);
+            continue;
         }
+
+        ImGui_ImplWin32_NewFrame();
+        pSample->OnUpdate();
+        pSample->OnRender();
     }
 
     ImGui_ImplWin32_Shutdown();
@@ -82,11 +97,18 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 
 // Main message handler for the sample.
 LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+    DXSample *pSample = reinterpret_cast<DXSample *>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+
+    // The UI reacts to input even when it keeps it from the sample
+    const bool input = (message >= WM_MOUSEFIRST && message <= WM_MOUSELAST) ||
+                       (message >= WM_KEYFIRST && message <= WM_KEYLAST);
+    if (pSample && (input || message == WM_SIZE || message == WM_ACTIVATE)) {
+        pSample->OnInvalidate();
+    }
+
     if (ImGui_ImplWin32_WndProcHandler(hWnd, message, wParam, lParam))
         return true;
 
-    DXSample *pSample = reinterpret_cast<DXSample *>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
-
     switch (message) {
     case WM_CREATE: {
         // Save the DXSample* passed in to CreateWindow.
@@ -122,11 +144,10 @@ LRESULT CALLBACK Win32Application::WindowProc(HWND hWnd, UINT message, WPARAM wP
         return 0;
 
     case WM_PAINT:
+        // Drawing happens in the main loop, this only asks for a frame
+        ValidateRect(hWnd, nullptr);
         if (pSample) {
-            ImGui_ImplWin32_NewFrame();
-
-            pSample->OnUpdate();
-            pSample->OnRender();
+            pSample->OnInvalidate();
         }
         return 0;
 
@@ -0,0 +1,224 @@
+#include "WorldMesh.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+struct Cursor {
+    const char *p;
+    const char *end;
+
+    void SkipSpaces() {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+    }
+
+    void SkipLine() {
+        while (p < end && *p != '\n') {
+            p++;
+        }
+        if (p < end) {
+            p++;
+        }
+    }
+
+    bool AtLineEnd() const { return p >= end || *p == '\n' || *p == '\r'; }
+
+    float Float() {
+        SkipSpaces();
+        float v = 0.f;
+        auto r = std::from_chars(p, end, v);
+        p = r.ptr;
+        return v;
+    }
+
+    long Int() {
+        long v = 0;
+        auto r = std::from_chars(p, end, v);
+        p = r.ptr;
+        return v;
+    }
+
+    std::string_view Rest() {
+        SkipSpaces();
+        const char *start = p;
+        while (!AtLineEnd()) {
+            p++;
+        }
+        return std::string_view(start, p - start);
+    }
+};
+
+// OBJ indices are 1 based, negative ones are relative to the end of the list
+long ResolveIndex(long index, size_t count) { return index < 0 ? (long)count + index : index - 1; }
+
+class RoomBuilder {
+public:
+    RoomBuilder(WorldMesh &mesh) : m_mesh(mesh) {}
+
+    void Begin(std::string_view name) {
+        End();
+
+        RoomMesh room{};
+        room.name = std::string(name);
+        room.roomIndex = -1;
+        std::from_chars(name.data(), name.data() + name.size(), room.roomIndex);
+        room.firstVertex = (std::uint32_t)m_mesh.vertices.size();
+        room.firstIndex = (std::uint32_t)m_mesh.indices.size();
+        std::fill_n(room.boundsMin, 3, 1e30f);
+        std::fill_n(room.boundsMax, 3, -1e30f);
+
+        m_room = room;
+        m_open = true;
+        m_lookup.clear();
+    }
+
+    std::uint32_t Vertex(const float *position, const float *normal, long positionIndex, long normalIndex) {
+        if (!m_open) {
+            Begin("");
+        }
+
+        const std::uint64_t key =
+            ((std::uint64_t)(positionIndex + 1) << 32) | (std::uint32_t)(normalIndex + 1);
+        auto it = m_lookup.find(key);
+        if (it != m_lookup.end()) {
+            return it->second;
+        }
+
+        MeshVertex v{};
+        v.position[0] = position[0];
+        v.position[1] = position[1];
+        v.position[2] = -position[2];
+        if (normal) {
+            v.normal[0] = normal[0];
+            v.normal[1] = normal[1];
+            v.normal[2] = -normal[2];
+        }
+
+        for (int i = 0; i < 3; i++) {
+            m_room.boundsMin[i] = std::min(m_room.boundsMin[i], v.position[i]);
+            m_room.boundsMax[i] = std::max(m_room.boundsMax[i], v.position[i]);
+        }
+
+        const std::uint32_t local = (std::uint32_t)(m_mesh.vertices.size() - m_room.firstVertex);
+        m_mesh.vertices.push_back(v);
+        m_lookup.emplace(key, local);
+        return local;
+    }
+
+    void End() {
+        if (!m_open) {
+            return;
+        }
+
+        m_room.vertexCount = (std::uint32_t)m_mesh.vertices.size() - m_room.firstVertex;
+        m_room.indexCount = (std::uint32_t)m_mesh.indices.size() - m_room.firstIndex;
+        if (m_room.indexCount > 0) {
+            m_mesh.rooms.push_back(m_room);
+        } else {
+            m_mesh.vertices.resize(m_room.firstVertex);
+            m_mesh.indices.resize(m_room.firstIndex);
+        }
+        m_open = false;
+    }
+
+private:
+    WorldMesh &m_mesh;
+    RoomMesh m_room{};
+    bool m_open = false;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_lookup;
+};
+} // namespace
+
+WorldMesh ParseWorldObj(const std::string &text) {
+    WorldMesh mesh;
+    RoomBuilder builder(mesh);
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<std::uint32_t> polygon;
+
+    Cursor c{text.data(), text.data() + text.size()};
+    while (c.p < c.end) {
+        c.SkipSpaces();
+
+        if (c.end - c.p >= 2 && c.p[0] == 'v' && c.p[1] == ' ') {
+            c.p += 2;
+            for (int i = 0; i < 3; i++) {
+                positions.push_back(c.Float());
+            }
+        } else if (c.end - c.p >= 3 && c.p[0] == 'v' && c.p[1] == 'n' && c.p[2] == ' ') {
+            c.p += 3;
+            for (int i = 0; i < 3; i++) {
+                normals.push_back(c.Float());
+            }
+        } else if (c.end - c.p >= 2 && (c.p[0] == 'o' || c.p[0] == 'g') && c.p[1] == ' ') {
+            c.p += 2;
+            builder.Begin(c.Rest());
+        } else if (c.end - c.p >= 2 && c.p[0] == 'f' && c.p[1] == ' ') {
+            c.p += 2;
+            polygon.clear();
+
+            for (c.SkipSpaces(); !c.AtLineEnd(); c.SkipSpaces()) {
+                const long v = ResolveIndex(c.Int(), positions.size() / 3);
+                long vn = -1;
+                if (c.p < c.end && *c.p == '/') {
+                    c.p++;
+                    if (c.p < c.end && *c.p != '/') {
+                        c.Int(); // Texture coordinates are not used
+                    }
+                    if (c.p < c.end && *c.p == '/') {
+                        c.p++;
+                        vn = ResolveIndex(c.Int(), normals.size() / 3);
+                    }
+                }
+                while (!c.AtLineEnd() && *c.p != ' ' && *c.p != '\t') {
+                    c.p++;
+                }
+
+                // Half written files can reference vertices that are not there yet
+                if (v < 0 || (size_t)v >= positions.size() / 3) {
+                    continue;
+                }
+                const float *normal = vn >= 0 && (size_t)vn < normals.size() / 3 ? &normals[vn * 3] : nullptr;
+                polygon.push_back(builder.Vertex(&positions[v * 3], normal, v, normal ? vn : -1));
+            }
+
+            // Fan triangulation, winding reversed for the left handed conversion
+            for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                mesh.indices.push_back(polygon[0]);
+                mesh.indices.push_back(polygon[i + 1]);
+                mesh.indices.push_back(polygon[i]);
+            }
+        }
+
+        c.SkipLine();
+    }
+    builder.End();
+
+    return mesh;
+}
+
+WorldMesh LoadWorldObj(const char *path) {
+    std::ifstream f(path, std::ios::binary);
+    std::stringstream ss;
+    ss << f.rdbuf();
+
+    return ParseWorldObj(ss.str());
+}
+
+std::string RoomDisplayName(std::string_view objectName) {
+    std::string_view name = objectName;
+    if (!name.empty() && name[0] >= '0' && name[0] <= '9' && name.find('_') != std::string_view::npos) {
+        name.remove_prefix(name.find('_') + 1);
+    }
+    name = name.substr(0, name.rfind("_MAP"));
+    std::string display(name);
+    std::replace(display.begin(), display.end(), '_', ' ');
+    return display;
+}
@@ -1,77 +1,241 @@
+// Draws one world served by `MP-MapTools serve`, pick it with ?world=1..7.
+// The binary layouts are described in include/MapData.h.
+
+const shaderCode = `
+  struct Uniforms {
+    viewProjection : mat4x4<f32>,
+    boundsMin : vec4<f32>,
+    boundsExtent : vec4<f32>,
+  };
+  @group(0) @binding(0) var<uniform> uniforms : Uniforms;
+
+  struct MeshOut {
+    @builtin(position) position : vec4<f32>,
+    @location(0) normal : vec3<f32>,
+  };
+
+  fn decodeNormal(e : vec2<f32>) -> vec3<f32> {
+    var n = vec3<f32>(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+      let signs = select(vec2<f32>(-1.0), vec2<f32>(1.0), n.xy >= vec2<f32>(0.0));
+      n = vec3<f32>((1.0 - abs(n.yx)) * signs, n.z);
+    }
+    return normalize(n);
+  }
+
+  // x and y in the first word, z and the octahedral normal in the second
+  @vertex
+  fn meshVertex(@location(0) packed : vec2<u32>) -> MeshOut {
+    let q = vec3<f32>(f32(packed.x & 0xffffu), f32(packed.x >> 16u), f32(packed.y & 0xffffu)) / 65535.0;
+    let position = uniforms.boundsMin.xyz + q * uniforms.boundsExtent.xyz;
+    var out : MeshOut;
+    out.position = uniforms.viewProjection * vec4<f32>(position, 1.0);
+    out.normal = decodeNormal(unpack4x8snorm(packed.y >> 16u).xy);
+    return out;
+  }
+
+  @fragment
+  fn meshFragment(in : MeshOut) -> @location(0) vec4<f32> {
+    let light = normalize(vec3<f32>(0.4, 1.0, 0.3));
+    let shade = 0.35 + 0.65 * abs(dot(normalize(in.normal), light));
+    return vec4<f32>(vec3<f32>(0.55, 0.7, 0.85) * shade, 1.0);
+  }
+
+  struct ItemOut {
+    @builtin(position) position : vec4<f32>,
+    @location(0) color : vec3<f32>,
+  };
+
+  @vertex
+  fn itemVertex(@location(0) typeAndPad : vec2<u32>, @location(1) position : vec3<f32>) -> ItemOut {
+    var out : ItemOut;
+    out.position = uniforms.viewProjection * vec4<f32>(position, 1.0);
+    // Energy tanks orange, missiles grey
+    out.color = select(vec3<f32>(0.8), vec3<f32>(1.0, 0.6, 0.1), typeAndPad.x == 0u);
+    return out;
+  }
+
+  @fragment
+  fn itemFragment(in : ItemOut) -> @location(0) vec4<f32> {
+    return vec4<f32>(in.color, 1.0);
+  }
+`;
+
+async function fetchBinary(path, magic) {
+  const response = await fetch(path);
+  if (!response.ok) {
+    throw new Error(`${path}: ${response.status}`);
+  }
+  const buffer = await response.arrayBuffer();
+  const tag = String.fromCharCode(...new Uint8Array(buffer, 0, 4));
+  if (tag !== magic) {
+    throw new Error(`${path} is not ${magic}`);
+  }
+  return buffer;
+}
+
+function createBuffer(device, data, usage) {
+  const buffer = device.createBuffer({size: data.byteLength, usage: usage | GPUBufferUsage.COPY_DST});
+  device.queue.writeBuffer(buffer, 0, data);
+  return buffer;
+}
+
+// Column major, depth from 0 to 1
+function perspective(fovY, aspect, near, far) {
+  const f = 1 / Math.tan(fovY / 2);
+  return [f / aspect, 0, 0, 0, 0, f, 0, 0, 0, 0, far / (near - far), -1, 0, 0, near * far / (near - far), 0];
+}
+
+function lookAt(eye, target, up) {
+  const sub = (a, b) => a.map((v, i) => v - b[i]);
+  const normalize = (a) => a.map((v) => v / Math.hypot(...a));
+  const cross = (a, b) => [a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]];
+  const dot = (a, b) => a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+  const z = normalize(sub(eye, target));
+  const x = normalize(cross(up, z));
+  const y = cross(z, x);
+  return [x[0], y[0], z[0], 0, x[1], y[1], z[1], 0, x[2], y[2], z[2], 0, -dot(x, eye), -dot(y, eye), -dot(z, eye), 1];
+}
+
+function multiply(a, b) {
+  const out = new Array(16).fill(0);
+  for (let column = 0; column < 4; column++) {
+    for (let row = 0; row < 4; row++) {
+      for (let k = 0; k < 4; k++) {
+        out[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+      }
+    }
+  }
+  return out;
+}
+
 async function init() {
-  // Get the canvas element and its WebGL 2 context
   const canvas = document.getElementById('canvas');
-  console.log(canvas);
+  canvas.width = Math.floor(window.innerWidth * window.devicePixelRatio);
+  canvas.height = Math.floor(window.innerHeight * window.devicePixelRatio);
+  canvas.style.width = window.innerWidth + 'px';
+  canvas.style.height = window.innerHeight + 'px';
   const context = canvas.getContext('webgpu');
-  console.log(context);
 
-  // Create the WebGPU device
-  console.log(navigator);
-  console.log(navigator.gpu);
   const adapter = await navigator.gpu.requestAdapter();
   const device = await adapter.requestDevice();
+  const format = navigator.gpu.getPreferredCanvasFormat();
+  context.configure({device, format, alphaMode: 'opaque'});
 
-  // Set up the render pipeline
-  const pipeline = device.createRenderPipeline({
+  const world = new URLSearchParams(window.location.search).get('world') || '2';
+  const [geometry, items] = await Promise.all([
+    fetchBinary(`/world/${world}/geometry`, 'MPWG'),
+    fetchBinary(`/world/${world}/items`, 'MPIM'),
+  ]);
+
+  // 44 byte header, 8 bytes per vertex, indices padded to 4 bytes
+  const header = new DataView(geometry);
+  const vertexCount = header.getUint32(8, true);
+  const indexCount = header.getUint32(12, true);
+  const indexSize = header.getUint32(16, true);
+  const boundsMin = [0, 1, 2].map((i) => header.getFloat32(20 + i * 4, true));
+  const boundsMax = [0, 1, 2].map((i) => header.getFloat32(32 + i * 4, true));
+  const indicesOffset = 44 + vertexCount * 8;
+  const vertexBuffer = createBuffer(device, new Uint8Array(geometry, 44, vertexCount * 8), GPUBufferUsage.VERTEX);
+  const indexBuffer = createBuffer(device, new Uint8Array(geometry, indicesOffset), GPUBufferUsage.INDEX);
+
+  const itemCount = new DataView(items).getUint32(8, true);
+  const itemBuffer = itemCount > 0 ?
+      createBuffer(device, new Uint8Array(items, 12, itemCount * 16), GPUBufferUsage.VERTEX) : null;
+
+  const uniformBuffer = device.createBuffer({size: 96, usage: GPUBufferUsage.UNIFORM | GPUBufferUsage.COPY_DST});
+  const bindGroupLayout = device.createBindGroupLayout({
+    entries: [{binding: 0, visibility: GPUShaderStage.VERTEX, buffer: {}}],
+  });
+  const layout = device.createPipelineLayout({bindGroupLayouts: [bindGroupLayout]});
+  const module = device.createShaderModule({code: shaderCode});
+  const depthStencil = {format: 'depth24plus', depthWriteEnabled: true, depthCompare: 'less'};
+  const meshPipeline = device.createRenderPipeline({
+    layout,
     vertex: {
-      module: device.createShaderModule({
-        code: `
-          [[stage(vertex)]]
-          fn main([[location(0)]] position : vec2<f32>) -> [[builtin(position)]] vec4<f32> {
-            return vec4<f32>(position, 0.0, 1.0);
-          }
-        `,
-      }),
-      entryPoint: 'main',
-      buffers: [{
-        arrayStride: 2 * 4,
-        attributes: [{
-          shaderLocation: 0,
-          offset: 0,
-          format: 'float32x2'
-        }]
-      }]
+      module,
+      entryPoint: 'meshVertex',
+      buffers: [{arrayStride: 8, attributes: [{shaderLocation: 0, offset: 0, format: 'uint32x2'}]}],
     },
-    fragment: {
-      module: device.createShaderModule({
-        code: `
-          [[stage(fragment)]]
-          fn main() -> [[location(0)]] vec4<f32> {
-            return vec4<f32>(1.0, 0.0, 0.0, 1.0);
-          }
-        `,
-      }),
-      entryPoint: 'main',
-      targets: [{
-        format: 'bgra8unorm'
-      }]
+    fragment: {module, entryPoint: 'meshFragment', targets: [{format}]},
+    primitive: {topology: 'triangle-list', cullMode: 'none'},
+    depthStencil,
+  });
+  const itemPipeline = device.createRenderPipeline({
+    layout,
+    vertex: {
+      module,
+      entryPoint: 'itemVertex',
+      buffers: [{
+        arrayStride: 16,
+        attributes: [
+          {shaderLocation: 0, offset: 0, format: 'uint8x2'},
+          {shaderLocation: 1, offset: 4, format: 'float32x3'},
+        ],
+      }],
     },
-    primitive: {
-      topology: 'triangle-list',
-      frontFace: 'ccw',
-      cullMode: 'none'
-    }
+    fragment: {module, entryPoint: 'itemFragment', targets: [{format}]},
+    primitive: {topology: 'point-list'},
+    depthStencil,
+  });
+  const bindGroup = device.createBindGroup({
+    layout: bindGroupLayout,
+    entries: [{binding: 0, resource: {buffer: uniformBuffer}}],
+  });
+  const depthTexture = device.createTexture({
+    size: [canvas.width, canvas.height],
+    format: 'depth24plus',
+    usage: GPUTextureUsage.RENDER_ATTACHMENT,
   });
 
-  // Create the command encoder and render pass descriptor
-  const commandEncoder = device.createCommandEncoder();
-  const renderPassDescriptor = {
-    colorAttachments: [{
-      view: context.getCurrentTexture().createView(),
-      loadValue: [0.0, 0.0, 0.0, 1.0],
-      storeOp: 'store'
-    }]
-  };
+  // Orbits the middle of the world, meshes are left handed so z is flipped
+  // back before the right handed camera
+  const center = boundsMin.map((v, i) => (v + boundsMax[i]) / 2);
+  const radius = Math.hypot(...boundsMax.map((v, i) => v - boundsMin[i])) * 0.6;
+  const flipZ = [1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 0, 1];
+  const uniforms = new Float32Array(24);
+  uniforms.set([...boundsMin, 0], 16);
+  uniforms.set([...boundsMax.map((v, i) => v - boundsMin[i]), 0], 20);
 
-  // Encode the commands to draw the triangle
-  const passEncoder = commandEncoder.beginRenderPass(renderPassDescriptor);
-  passEncoder.setPipeline(pipeline);
-  passEncoder.setVertexBuffer(0, vertexBuffer);
-  passEncoder.draw(3, 1, 0, 0);
-  passEncoder.endPass();
+  function frame(time) {
+    const angle = time / 10000;
+    const target = [center[0], center[1], -center[2]];
+    const eye = [target[0] + radius * Math.sin(angle), target[1] + radius * 0.6, target[2] + radius * Math.cos(angle)];
+    const view = multiply(lookAt(eye, target, [0, 1, 0]), flipZ);
+    const projection = perspective(Math.PI / 4, canvas.width / canvas.height, radius * 0.01, radius * 10);
+    uniforms.set(multiply(projection, view), 0);
+    device.queue.writeBuffer(uniformBuffer, 0, uniforms);
 
-  // Submit the commands to the GPU
-  device.queue.submit([commandEncoder.finish()]);
+    const commandEncoder = device.createCommandEncoder();
+    const passEncoder = commandEncoder.beginRenderPass({
+      colorAttachments: [{
+        view: context.getCurrentTexture().createView(),
+        clearValue: [0.0, 0.0, 0.0, 1.0],
+        loadOp: 'clear',
+        storeOp: 'store',
+      }],
+      depthStencilAttachment: {
+        view: depthTexture.createView(),
+        depthClearValue: 1.0,
+        depthLoadOp: 'clear',
+        depthStoreOp: 'store',
+      },
+    });
+    passEncoder.setBindGroup(0, bindGroup);
+    passEncoder.setPipeline(meshPipeline);
+    passEncoder.setVertexBuffer(0, vertexBuffer);
+    passEncoder.setIndexBuffer(indexBuffer, indexSize === 2 ? 'uint16' : 'uint32');
+    passEncoder.drawIndexed(indexCount);
+    if (itemBuffer) {
+      passEncoder.setPipeline(itemPipeline);
+      passEncoder.setVertexBuffer(0, itemBuffer);
+      passEncoder.draw(itemCount);
+    }
+    passEncoder.end();
+    device.queue.submit([commandEncoder.finish()]);
+    requestAnimationFrame(frame);
+  }
+  requestAnimationFrame(frame);
 }
 
 init();